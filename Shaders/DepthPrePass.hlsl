@@ -40,15 +40,12 @@ struct PSInput
 	float3 vertNormal  : COLOR0;
 	float3 vertTangent : COLOR1;
 	float2 uv          : TEXCOORD0;
-#ifdef INSTANCED
-	uint instanceID    : SV_InstanceID;
-#endif
 };
 
 
 #ifdef INSTANCED
 	#ifndef INSTANCE_COUNT
-	#define INSTANCE_COUNT 50 // 50 instances assumed per default, this should be provided by the app
+	#define INSTANCE_COUNT MAX_INSTANCE_COUNT__SCENE_MESHES
 	#endif
 #endif
 
@@ -91,7 +88,8 @@ PSInput VSMain(VSInput vertex)
 	
 #ifdef INSTANCED
 	result.position    = mul(cbPerObject[vertex.instanceID].matWorldViewProj, float4(vertex.position, 1.0f));
-	result.vertNormal  = mul(cbPerObject[vertex.instanceID].matNormal, vertex.normal );
+	result.vertNormal  = mul(cbPerObject[vertex.instanceID].matNormal, float4(vertex.normal , 0.0f));
+	result.vertTangent = mul(cbPerObject[vertex.instanceID].matNormal, float4(vertex.tangent, 0.0f));
 #else
 	result.position    = mul(cbPerObject.matWorldViewProj, float4(vertex.position, 1.0f));
 	result.vertNormal  = mul(cbPerObject.matNormal, float4(vertex.normal , 0.0f));
@@ -107,7 +105,12 @@ float4 PSMain(PSInput In) : SV_TARGET
 {
 	const float2 uv = In.uv;
 	
-	const int TEX_CFG = cbPerObject.materialData.textureConfig;	
+#ifdef INSTANCED
+	const MaterialData Material = cbPerObject[0].materialData; // instances of a draw share the material
+#else
+	const MaterialData Material = cbPerObject.materialData;
+#endif
+	const int TEX_CFG = Material.textureConfig;
 	
 	float4 AlbedoAlpha = texDiffuse.Sample(AnisoSampler, uv);
 	if (HasDiffuseMap(TEX_CFG) && AlbedoAlpha.a < 0.01f)
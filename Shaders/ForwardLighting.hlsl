@@ -44,9 +44,6 @@ struct PSInput
 	float3 vertNormal  : COLOR0;
 	float3 vertTangent : COLOR1;
 	float2 uv          : TEXCOORD0;
-#ifdef INSTANCED
-	uint instanceID    : SV_InstanceID;
-#endif
 #if PS_OUTPUT_MOTION_VECTORS
 	float4 svPositionCurr : TEXCOORD1;
 	float4 svPositionPrev : TEXCOORD2;
@@ -70,7 +67,7 @@ struct PSOutput
 
 #ifdef INSTANCED
 	#ifndef INSTANCE_COUNT
-	#define INSTANCE_COUNT 50 // 50 instances assumed per default, this should be provided by the app
+	#define INSTANCE_COUNT MAX_INSTANCE_COUNT__SCENE_MESHES
 	#endif
 #endif
 
@@ -116,10 +113,24 @@ TextureCube texEnvMapDiff   : register(t10);
 TextureCube texEnvMapSpec   : register(t11);
 Texture2D   texBRDFIntegral : register(t12);
 
-Texture2D        texDirectionalLightShadowMap : register(t13);
+Texture2DArray   texDirectionalLightShadowMaps : register(t13);
 Texture2DArray   texSpotLightShadowMaps       : register(t16);
 TextureCubeArray texPointLightShadowMaps      : register(t22);
 
+// clustered lighting, see LightClusterBinner on the CPU side
+StructuredBuffer<PointLight> PointLights   : register(t0, space1);
+StructuredBuffer<SpotLight>  SpotLights    : register(t1, space1);
+StructuredBuffer<uint2>      LightClusters : register(t2, space1); // x: light index offset, y: point light count | (spot light count << 16)
+StructuredBuffer<uint>       LightIndices  : register(t3, space1); // per cluster: point light indices, then spot light indices
+
+
+uint GetLightClusterIndex(float2 SVPosition, float ViewSpaceDepth)
+{
+	const uint3 NumClusters = uint3(cbPerView.NumLightClustersX, cbPerView.NumLightClustersY, cbPerView.NumLightClustersZ);
+	const uint2 Tile  = min(uint2(SVPosition / cbPerView.ScreenDimensions * float2(NumClusters.xy)), NumClusters.xy - 1);
+	const uint  Slice = (uint) clamp(floor(log(ViewSpaceDepth) * cbPerView.LightClusterSliceScale + cbPerView.LightClusterSliceBias), 0.0f, float(NumClusters.z - 1));
+	return Tile.x + Tile.y * NumClusters.x + Slice * NumClusters.x * NumClusters.y;
+}
 
 
 //---------------------------------------------------------------------------------------------------
@@ -164,7 +175,12 @@ PSOutput PSMain(PSInput In)
 	PSOutput o = (PSOutput)0;
 
 	const float2 uv = In.uv;
-	const int TEX_CFG = cbPerObject.materialData.textureConfig;
+#ifdef INSTANCED
+	const MaterialData Material = cbPerObject[0].materialData; // instances of a draw share the material
+#else
+	const MaterialData Material = cbPerObject.materialData;
+#endif
+	const int TEX_CFG = Material.textureConfig;
 	
 	float4 AlbedoAlpha = texDiffuse  .Sample(AnisoSampler, uv);
 	float3 Normal      = texNormals  .Sample(AnisoSampler, uv).rgb;
@@ -184,10 +200,10 @@ PSOutput PSMain(PSInput In)
 	// read textures/cbuffer & assign sufrace material data
 	float ao = cbPerFrame.fAmbientLightingFactor;
 	BRDF_Surface Surface = (BRDF_Surface)0;
-	Surface.diffuseColor      = HasDiffuseMap(TEX_CFG)   ? AlbedoAlpha.rgb : cbPerObject.materialData.diffuse;
+	Surface.diffuseColor      = HasDiffuseMap(TEX_CFG)   ? AlbedoAlpha.rgb : Material.diffuse;
 	Surface.specularColor     = float3(1,1,1);
-	Surface.emissiveColor     = HasEmissiveMap(TEX_CFG)  ? Emissive        : cbPerObject.materialData.emissiveColor;
-	Surface.emissiveIntensity = cbPerObject.materialData.emissiveIntensity;
+	Surface.emissiveColor     = HasEmissiveMap(TEX_CFG)  ? Emissive        : Material.emissiveColor;
+	Surface.emissiveIntensity = Material.emissiveIntensity;
 	
 	const float3  N = normalize(In.vertNormal);
 	const float3  T = normalize(In.vertTangent);
@@ -196,8 +212,8 @@ PSOutput PSMain(PSInput In)
 	const bool bReadsRoughnessMapData = HasRoughnessMap(TEX_CFG) || HasOcclusionRoughnessMetalnessMap(TEX_CFG);
 	const bool bReadsMetalnessMapData =  HasMetallicMap(TEX_CFG) || HasOcclusionRoughnessMetalnessMap(TEX_CFG);
 	
-	if (!bReadsRoughnessMapData) Surface.roughness = cbPerObject.materialData.roughness;
-	if (!bReadsMetalnessMapData) Surface.metalness = cbPerObject.materialData.metalness;
+	if (!bReadsRoughnessMapData) Surface.roughness = Material.roughness;
+	if (!bReadsMetalnessMapData) Surface.metalness = Material.metalness;
 	if (HasAmbientOcclusionMap           (TEX_CFG)) ao *= LocalAO;
 	if (HasRoughnessMap                  (TEX_CFG)) Surface.roughness = Roughness;
 	if (HasMetallicMap                   (TEX_CFG)) Surface.metalness = Metalness;
@@ -238,14 +254,17 @@ PSOutput PSMain(PSInput In)
 	}
 	
 	
-	// Non-shadowing lights
-	for (int p = 0; p < cbPerFrame.Lights.numPointLights; ++p)
+	// Non-shadowing lights: only the ones binned to this pixel's cluster (SV_Position.w = view space depth)
+	const uint2 Cluster = LightClusters[GetLightClusterIndex(In.position.xy, In.position.w)];
+	const uint NumClusterPointLights = Cluster.y & 0xFFFF;
+	const uint NumClusterSpotLights  = Cluster.y >> 16;
+	for (uint p = 0; p < NumClusterPointLights; ++p)
 	{
-		I_total += CalculatePointLightIllumination(cbPerFrame.Lights.point_lights[p], Surface, P, V);
+		I_total += CalculatePointLightIllumination(PointLights[LightIndices[Cluster.x + p]], Surface, P, V);
 	}
-	for (int s = 0; s < cbPerFrame.Lights.numSpotLights; ++s)
+	for (uint s = 0; s < NumClusterSpotLights; ++s)
 	{
-		I_total += CalculateSpotLightIllumination(cbPerFrame.Lights.spot_lights[s], Surface, P, V);
+		I_total += CalculateSpotLightIllumination(SpotLights[LightIndices[Cluster.x + NumClusterPointLights + s]], Surface, P, V);
 	}
 	
 	
@@ -297,11 +316,26 @@ PSOutput PSMain(PSInput In)
 			float ShadowingFactor = 1.0f; // no shadows
 			if (l.shadowing)
 			{
-				const float3 L = normalize(-l.lightDirection);
-				pcfData.lightSpacePos = mul(cbPerFrame.Lights.shadowViewDirectional, float4(P, 1));
-				pcfData.NdotL = saturate(dot(Surface.N, L));
-				pcfData.depthBias = l.depthBias;
-				ShadowingFactor = ShadowTestPCF_Directional(pcfData, texDirectionalLightShadowMap, PointSampler, cbPerFrame.f2DirectionalLightShadowMapDimensions, cbPerFrame.Lights.shadowViewDirectional);
+				// pick the first cascade that covers the pixel, leaving a border for the PCF kernel
+				const float CASCADE_BORDER = 0.98f;
+				int iCascade = -1;
+				for (int c = 0; c < l.numCascades; ++c)
+				{
+					pcfData.lightSpacePos = mul(cbPerFrame.Lights.shadowViewDirectional[c], float4(P, 1));
+					if (all(abs(pcfData.lightSpacePos.xy) < CASCADE_BORDER) && pcfData.lightSpacePos.z >= 0.0f && pcfData.lightSpacePos.z <= 1.0f)
+					{
+						iCascade = c;
+						break;
+					}
+				}
+				
+				if (iCascade >= 0) // pixels past the last cascade aren't shadowed
+				{
+					const float3 L = normalize(-l.lightDirection);
+					pcfData.NdotL = saturate(dot(Surface.N, L));
+					pcfData.depthBias = l.depthBias;
+					ShadowingFactor = ShadowTestPCF_Directional(pcfData, texDirectionalLightShadowMaps, PointSampler, cbPerFrame.f2DirectionalLightShadowMapDimensions, iCascade);
+				}
 			}
 			
 			I_total += CalculateDirectionalLightIllumination(l, Surface, V) * ShadowingFactor;
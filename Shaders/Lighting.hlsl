@@ -222,10 +222,10 @@ float ShadowTestPCF(in ShadowTestPCFData pcfTestLightData, Texture2DArray shadow
 
 float ShadowTestPCF_Directional(
 	in ShadowTestPCFData pcfTestLightData
-	, Texture2D shadowMapArr
+	, Texture2DArray shadowMapArr
 	, SamplerState shadowSampler
 	, in float2 shadowMapDimensions
-	, in matrix lightProj
+	, in int cascadeIndex
 )
 {
 	// homogeneous position after interpolation
@@ -258,11 +258,9 @@ float ShadowTestPCF_Directional(
 		for (int y = -ROW_HALF_SIZE; y <= ROW_HALF_SIZE; ++y)
 		{
 			float2 texelOffset = float2(x, y) * texelSize;
-			float closestDepthInLSpace = shadowMapArr.SampleLevel(shadowSampler, shadowTexCoords + texelOffset, 0).x;
+			float closestDepthInLSpace = shadowMapArr.SampleLevel(shadowSampler, float3(shadowTexCoords + texelOffset, cascadeIndex), 0).x;
 
 			// depth check
-			const float linearCurrentPx = LinearDepth(pxDepthInLSpace, lightProj);
-			const float linearClosestPx = LinearDepth(closestDepthInLSpace, lightProj);
 			shadow += (pxDepthInLSpace - pcfTestLightData.depthBias > closestDepthInLSpace) ? 1.0f : 0.0f;
 		}
 	}
@@ -326,9 +324,12 @@ float3 CalculateSpotLightIllumination(in const SpotLight l, in BRDF_Surface s, c
 	float3 IdIs = 0.0f.xxx;
 	
 	const float3 Wi = normalize(l.position - P);
-	const float3 radiance = SpotlightIntensity(l, P) * l.color * l.brightness * AttenuationBRDF(length(l.position - P));
+	const float D = length(l.position - P);
+	const float3 radiance = SpotlightIntensity(l, P) * l.color * l.brightness * AttenuationBRDF(D);
 	const float NdotL = saturate(dot(s.N, Wi));
-	IdIs += BRDF(s, Wi, V) * radiance * NdotL;
+	
+	if (D < l.range)
+		IdIs += BRDF(s, Wi, V) * radiance * NdotL;
 	
 	return IdIs;
 }
@@ -36,13 +36,11 @@ namespace VQ_SHADER_DATA {
 // LIGHTS
 //----------------------------------------------------------
 
-// defines maximum number of dynamic lights
-// don't forget to update CPU define too (RenderPasses.h)
-#define NUM_LIGHTS__POINT 100
-#define NUM_LIGHTS__SPOT  20
-
+// non-shadowing point & spot lights aren't limited by a constant: they're read from structured
+// buffers through the light cluster grid, see LightClusterBinner (ClusteredLighting.h)
 #define NUM_SHADOWING_LIGHTS__POINT 5
 #define NUM_SHADOWING_LIGHTS__SPOT  5
+#define NUM_SHADOW_CASCADES__DIRECTIONAL 4
 
 #define LIGHT_INDEX_SPOT       0
 #define LIGHT_INDEX_POINT      1
@@ -72,14 +70,14 @@ struct SpotLight
 	float  depthBias;
 	//---------------
 	float innerConeAngle;
-	float dummy;
+	float range;
 	float dummy1;
 	float dummy2;
 	//---------------
 };
 
 struct DirectionalLight
-{	// 40 bytes
+{	// 44 bytes
 	float3 lightDirection;
 	float  brightness;
 	//---------------
@@ -88,6 +86,7 @@ struct DirectionalLight
 	//---------------
 	int shadowing;
 	int enabled;
+	int numCascades; // shadowViewDirectional[] count, fit to the main view each frame
 };
 
 struct SceneLighting
@@ -100,12 +99,10 @@ struct SceneLighting
 	int numSpotCasters;
 	//----------------------------------------------
 	DirectionalLight directional;
-	matrix shadowViewDirectional;
+	matrix shadowViewDirectional[NUM_SHADOW_CASCADES__DIRECTIONAL];
 	//----------------------------------------------
-	PointLight point_lights[NUM_LIGHTS__POINT];
 	PointLight point_casters[NUM_SHADOWING_LIGHTS__POINT];
 	//----------------------------------------------
-	SpotLight spot_lights[NUM_LIGHTS__SPOT];
 	SpotLight spot_casters[NUM_SHADOWING_LIGHTS__SPOT];
 	//----------------------------------------------
 	matrix shadowViews[NUM_SHADOWING_LIGHTS__SPOT];
@@ -150,6 +147,9 @@ struct MaterialData
 //----------------------------------------------------------
 // SHADER CONSTANT BUFFER INTERFACE
 //----------------------------------------------------------
+// PerObjectData array size of the INSTANCED shader permutations: 64 x 320B = 20KB, well under the 64KB cbuffer limit
+#define MAX_INSTANCE_COUNT__SCENE_MESHES 64
+
 struct PerFrameData
 {
 	SceneLighting Lights;
@@ -170,6 +170,13 @@ struct PerViewData
 	float2 ScreenDimensions;
 	int    EnvironmentMapDiffuseOnlyIllumination;
 	float pad1;
+
+	// light cluster grid: slice = log(ViewSpaceDepth) * LightClusterSliceScale + LightClusterSliceBias
+	int   NumLightClustersX;
+	int   NumLightClustersY;
+	int   NumLightClustersZ;
+	float LightClusterSliceScale;
+	float LightClusterSliceBias;
 };
 struct PerObjectData
 {
@@ -0,0 +1,88 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+// Linear blend skinning of an animated mesh into the skinned vertex buffer,
+// mirrors SkeletalAnimation::SkinVertices() on the CPU.
+
+#define MAX_BONE_INFLUENCES 4
+
+struct FVertex // FVertexWithNormalAndTangent
+{
+	float3 Position;
+	float3 Normal;
+	float3 Tangent;
+	float2 UV;
+};
+struct FVertexSkinWeights
+{
+	uint2  BoneIndices; // 4x uint16
+	float4 Weights;
+};
+struct FPaletteMatrix
+{
+	row_major float4x4 M; // XMFLOAT4X4, row vectors
+};
+
+StructuredBuffer<FVertex>            Vertices : register(t0); // bind pose
+StructuredBuffer<FVertexSkinWeights> Weights  : register(t1);
+StructuredBuffer<FPaletteMatrix>     Palette  : register(t2);
+
+RWStructuredBuffer<FVertex> SkinnedVertices : register(u0);
+
+cbuffer SkinningParameters : register(b0)
+{
+	uint NumVertices;
+}
+
+
+[numthreads(64, 1, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	const uint v = dispatchThreadId.x;
+	if (v >= NumVertices)
+	{
+		return;
+	}
+
+	const FVertexSkinWeights w = Weights[v];
+	const uint BoneIndices[MAX_BONE_INFLUENCES] =
+	{
+		w.BoneIndices.x & 0xFFFF, w.BoneIndices.x >> 16,
+		w.BoneIndices.y & 0xFFFF, w.BoneIndices.y >> 16
+	};
+
+	// blend the palette matrices, then transform
+	float4x4 m = (float4x4)0;
+	[unroll]
+	for (uint k = 0; k < MAX_BONE_INFLUENCES; ++k)
+	{
+		if (w.Weights[k] > 0.0f)
+		{
+			m += Palette[BoneIndices[k]].M * w.Weights[k];
+		}
+	}
+
+	// the normals & tangents are transformed w/ the 3x3 part: assumes uniform scaling
+	const FVertex In = Vertices[v];
+	FVertex Out;
+	Out.Position = mul(float4(In.Position, 1.0f), m).xyz;
+	Out.Normal   = normalize(mul(In.Normal , (float3x3)m));
+	Out.Tangent  = normalize(mul(In.Tangent, (float3x3)m));
+	Out.UV       = In.UV;
+	SkinnedVertices[v] = Out;
+}
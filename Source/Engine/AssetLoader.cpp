@@ -20,6 +20,8 @@
 #include "Scene/Mesh.h"
 #include "Scene/Material.h"
 #include "Scene/Scene.h"
+#include "GeometryDeduplication.h"
+#include "SkeletalAnimation.h"
 
 #include "../Renderer/Renderer.h"
 
@@ -33,6 +35,13 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <unordered_set>
+
 using namespace Assimp;
 using namespace DirectX;
 
@@ -47,7 +56,9 @@ AssetLoader::AssetLoader(ThreadPool& WorkerThreads_Model, ThreadPool& WorkerThre
 	: mWorkers_ModelLoad(WorkerThreads_Model)
 	, mWorkers_TextureLoad(WorkerThreads_Texture)
 	, mRenderer(renderer)
-{}
+{
+	mStreamingScheduler.Initialize(this);
+}
 
 //----------------------------------------------------------------------------------------------------------------
 // MODEL LOADER
@@ -228,14 +239,16 @@ AssetLoader::TextureLoadResults_t AssetLoader::StartLoadingTextures(TaskID taskI
 			// dispatch worker thread
 			std::shared_future<TextureID> texLoadResult = std::move(mWorkers_TextureLoad.AddTask([this, TexLoadParams, ProcTex]()
 			{
+				SCOPED_MEMORY_TAG(EMemoryTag::AssetLoader);
 				constexpr bool GENERATE_MIPS = true;
+				constexpr bool TRACK_RESIDENCY = true; // the scene reports the textures of the visible materials
 				const bool IS_PROCEDURAL = ProcTex != EProceduralTextures::NUM_PROCEDURAL_TEXTURES;
 				if (IS_PROCEDURAL)
 				{
 					return mRenderer.GetProceduralTexture(ProcTex);
 				}
 
-				return mRenderer.CreateTextureFromFile(TexLoadParams.TexturePath.c_str(), GENERATE_MIPS);
+				return mRenderer.CreateTextureFromFile(TexLoadParams.TexturePath.c_str(), GENERATE_MIPS, TRACK_RESIDENCY);
 			}));
 
 			// update results lookup for the shared textures (among different materials)
@@ -442,15 +455,25 @@ static std::vector<AssetLoader::FTextureLoadParams> GenerateTextureLoadParams(
 	return TexLoadParams;
 }
 
-static Mesh ProcessAssimpMesh(
-	VQRenderer*          pRenderer
-	, aiMesh*            pMesh
-	, const aiScene*     pScene
-	, const std::string& ModelName
-)
+struct FAssimpMeshGeometry
 {
 	std::vector<FVertexWithNormalAndTangent> Vertices;
 	std::vector<unsigned> Indices;
+};
+
+// a mesh referenced by a node of the imported scene
+struct FAssimpMeshOccurrence
+{
+	unsigned   iAiMesh;
+	MaterialID matID;
+	bool       bTransparent;
+};
+
+static FAssimpMeshGeometry ProcessAssimpMesh(aiMesh* pMesh)
+{
+	FAssimpMeshGeometry Geometry;
+	std::vector<FVertexWithNormalAndTangent>& Vertices = Geometry.Vertices;
+	std::vector<unsigned>& Indices = Geometry.Indices;
 
 	// Walk through each of the mesh's vertices
 	for (unsigned int i = 0; i < pMesh->mNumVertices; i++)
@@ -502,23 +525,208 @@ static Mesh ProcessAssimpMesh(
 			Indices.push_back(face.mIndices[j]);
 	}
 
-	return Mesh(pRenderer, Vertices, Indices, ModelName);;
+	return Geometry;
 }
 
-static Model::Data ProcessAssimpNode(
-	const std::string& ModelName,
+// assimp matrices transform column vectors
+static XMFLOAT4X4 ToRowVectorMatrix(const aiMatrix4x4& m)
+{
+	return XMFLOAT4X4(
+		m.a1, m.b1, m.c1, m.d1,
+		m.a2, m.b2, m.c2, m.d2,
+		m.a3, m.b3, m.c3, m.d3,
+		m.a4, m.b4, m.c4, m.d4
+	);
+}
+
+// the bones of the meshes & their ancestor nodes, parents first. The bind pose is taken from the
+// bones' offset matrices (so the bind pose palette is the identity), the other nodes keep their transform.
+static bool ImportAssimpSkeleton(const aiScene* pAiScene, FSkeleton& Skeleton)
+{
+	std::unordered_map<std::string, XMFLOAT4X4> BoneOffsets;
+	for (unsigned iMesh = 0; iMesh < pAiScene->mNumMeshes; ++iMesh)
+	{
+		const aiMesh* pMesh = pAiScene->mMeshes[iMesh];
+		for (unsigned iBone = 0; iBone < pMesh->mNumBones; ++iBone)
+			BoneOffsets.emplace(pMesh->mBones[iBone]->mName.C_Str(), ToRowVectorMatrix(pMesh->mBones[iBone]->mOffsetMatrix));
+	}
+	if (BoneOffsets.empty())
+		return false;
+
+	std::unordered_set<const aiNode*> SkeletonNodes;
+	std::function<bool(const aiNode*)> fnFindSkeletonNodes = [&](const aiNode* pNode)
+	{
+		bool bSkeletonNode = BoneOffsets.count(pNode->mName.C_Str()) != 0;
+		for (unsigned i = 0; i < pNode->mNumChildren; ++i)
+			bSkeletonNode |= fnFindSkeletonNodes(pNode->mChildren[i]);
+		if (bSkeletonNode)
+			SkeletonNodes.insert(pNode);
+		return bSkeletonNode;
+	};
+	fnFindSkeletonNodes(pAiScene->mRootNode);
+
+	std::vector<XMMATRIX> BindModelSpaceMatrices;
+	std::function<void(const aiNode*, int32, const XMMATRIX&)> fnAddBones = [&](const aiNode* pNode, int32 iParent, const XMMATRIX& ParentNodeTransform)
+	{
+		if (SkeletonNodes.count(pNode) == 0)
+			return;
+
+		const XMFLOAT4X4 NodeTransform = ToRowVectorMatrix(pNode->mTransformation);
+		const XMMATRIX NodeModelSpace = XMMatrixMultiply(XMLoadFloat4x4(&NodeTransform), ParentNodeTransform);
+		auto itOffset = BoneOffsets.find(pNode->mName.C_Str());
+		const XMMATRIX BindModelSpace = itOffset != BoneOffsets.end() ? XMMatrixInverse(nullptr, XMLoadFloat4x4(&itOffset->second)) : NodeModelSpace;
+		const XMMATRIX BindLocal = iParent == INVALID_BONE ? BindModelSpace : XMMatrixMultiply(BindModelSpace, XMMatrixInverse(nullptr, BindModelSpaceMatrices[iParent]));
+
+		FBonePose Bind = { XMQuaternionIdentity(), XMVectorZero(), XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f) };
+		XMVECTOR S, R, T;
+		if (XMMatrixDecompose(&S, &R, &T, BindLocal))
+			Bind = { R, XMVectorSetW(T, 0.0f), XMVectorSetW(S, 0.0f) };
+		else
+			Log::Warning("   Skeleton: can't decompose the bind pose of bone '%s'", pNode->mName.C_Str());
+
+		XMFLOAT4X4 InverseBindMatrix;
+		XMStoreFloat4x4(&InverseBindMatrix, XMMatrixInverse(nullptr, BindModelSpace));
+		const int32 iBone = static_cast<int32>(Skeleton.GetNumBones());
+		Skeleton.BoneNames.push_back(pNode->mName.C_Str());
+		Skeleton.ParentIndices.push_back(iParent);
+		Skeleton.BindPose.push_back(Bind);
+		Skeleton.InverseBindMatrices.push_back(itOffset != BoneOffsets.end() ? itOffset->second : InverseBindMatrix);
+		BindModelSpaceMatrices.push_back(BindModelSpace);
+
+		for (unsigned i = 0; i < pNode->mNumChildren; ++i)
+			fnAddBones(pNode->mChildren[i], iBone, NodeModelSpace);
+	};
+	fnAddBones(pAiScene->mRootNode, INVALID_BONE, XMMatrixIdentity());
+
+	if (!Skeleton.IsValid())
+	{
+		Log::Error("   Skeleton: %u bones aren't supported", Skeleton.GetNumBones());
+		Skeleton = {};
+		return false;
+	}
+	return true;
+}
+
+// keeps the MAX_BONE_INFLUENCES largest weights per vertex, renormalized
+static std::vector<FVertexSkinWeights> ImportAssimpSkinWeights(const aiMesh* pMesh, const FSkeleton& Skeleton)
+{
+	std::vector<FVertexSkinWeights> Weights(pMesh->mNumVertices, FVertexSkinWeights{});
+	for (unsigned iAiBone = 0; iAiBone < pMesh->mNumBones; ++iAiBone)
+	{
+		const aiBone* pBone = pMesh->mBones[iAiBone];
+		const int32 iBone = Skeleton.FindBone(pBone->mName.C_Str());
+		assert(iBone != INVALID_BONE); // the skeleton has all the bones of the meshes
+		for (unsigned iWeight = 0; iWeight < pBone->mNumWeights; ++iWeight)
+		{
+			const aiVertexWeight& w = pBone->mWeights[iWeight];
+			if (w.mVertexId >= pMesh->mNumVertices)
+				continue;
+
+			FVertexSkinWeights& v = Weights[w.mVertexId];
+			uint32 iSmallest = 0;
+			for (uint32 k = 1; k < MAX_BONE_INFLUENCES; ++k)
+				if (v.Weights[k] < v.Weights[iSmallest])
+					iSmallest = k;
+			if (w.mWeight > v.Weights[iSmallest])
+			{
+				v.BoneIndices[iSmallest] = static_cast<uint16>(iBone);
+				v.Weights[iSmallest] = w.mWeight;
+			}
+		}
+	}
+
+	uint32 NumUnweightedVertices = 0;
+	for (FVertexSkinWeights& v : Weights)
+	{
+		float WeightSum = 0.0f;
+		for (uint32 k = 0; k < MAX_BONE_INFLUENCES; ++k)
+			WeightSum += v.Weights[k];
+		if (WeightSum > 0.0f)
+		{
+			for (uint32 k = 0; k < MAX_BONE_INFLUENCES; ++k)
+				v.Weights[k] /= WeightSum;
+		}
+		else
+		{
+			v.Weights[0] = 1.0f; // follows the root
+			++NumUnweightedVertices;
+		}
+	}
+	if (NumUnweightedVertices > 0)
+		Log::Warning("   Skeleton: mesh '%s' has %u vertices w/o bone weights", pMesh->mName.C_Str(), NumUnweightedVertices);
+	return Weights;
+}
+
+static std::vector<FAnimationClip> ImportAssimpAnimations(const aiScene* pAiScene, const FSkeleton& Skeleton)
+{
+	std::vector<FAnimationClip> Clips;
+	AnimationClipCompressor::FStatistics Total;
+	uint32 NumIgnoredChannels = 0;
+	for (unsigned iAnim = 0; iAnim < pAiScene->mNumAnimations; ++iAnim)
+	{
+		const aiAnimation* pAnim = pAiScene->mAnimations[iAnim];
+		const double TicksPerSecond = pAnim->mTicksPerSecond > 0.0 ? pAnim->mTicksPerSecond : 25.0; // assimp's default
+
+		FRawAnimationClip RawClip;
+		RawClip.Name = pAnim->mName.length > 0 ? pAnim->mName.C_Str() : "Animation#" + std::to_string(iAnim);
+		RawClip.Duration = static_cast<float>(pAnim->mDuration / TicksPerSecond);
+		RawClip.Tracks.resize(Skeleton.GetNumBones());
+		for (unsigned iChannel = 0; iChannel < pAnim->mNumChannels; ++iChannel)
+		{
+			const aiNodeAnim* pChannel = pAnim->mChannels[iChannel];
+			const int32 iBone = Skeleton.FindBone(pChannel->mNodeName.C_Str());
+			if (iBone == INVALID_BONE)
+			{
+				++NumIgnoredChannels; // doesn't animate the skeleton
+				continue;
+			}
+
+			FRawAnimationClip::FBoneTrack& Track = RawClip.Tracks[iBone];
+			for (unsigned k = 0; k < pChannel->mNumRotationKeys; ++k)
+			{
+				const aiQuatKey& Key = pChannel->mRotationKeys[k];
+				Track.Rotations.push_back({ static_cast<float>(Key.mTime / TicksPerSecond), XMFLOAT4(Key.mValue.x, Key.mValue.y, Key.mValue.z, Key.mValue.w) });
+			}
+			for (unsigned k = 0; k < pChannel->mNumPositionKeys; ++k)
+			{
+				const aiVectorKey& Key = pChannel->mPositionKeys[k];
+				Track.Translations.push_back({ static_cast<float>(Key.mTime / TicksPerSecond), XMFLOAT3(Key.mValue.x, Key.mValue.y, Key.mValue.z) });
+			}
+			for (unsigned k = 0; k < pChannel->mNumScalingKeys; ++k)
+			{
+				const aiVectorKey& Key = pChannel->mScalingKeys[k];
+				Track.Scales.push_back({ static_cast<float>(Key.mTime / TicksPerSecond), XMFLOAT3(Key.mValue.x, Key.mValue.y, Key.mValue.z) });
+			}
+		}
+
+		AnimationClipCompressor::FStatistics s;
+		Clips.push_back(AnimationClipCompressor::Compress(Skeleton, RawClip, AnimationClipCompressor::FSettings(), &s));
+		Total.NumTracks         += s.NumTracks;
+		Total.RawBytes          += s.RawBytes;
+		Total.CompressedBytes   += s.CompressedBytes;
+		Total.CompressionTimeMs += s.CompressionTimeMs;
+	}
+
+	if (!Clips.empty())
+	{
+		Log::Info("   Animations: %u clips, %u tracks, %.2f KB keys -> %.2f KB in %.2fms%s"
+			, static_cast<uint32>(Clips.size()), Total.NumTracks, Total.RawBytes / 1024.0, Total.CompressedBytes / 1024.0, Total.CompressionTimeMs
+			, NumIgnoredChannels > 0 ? (", ignored " + std::to_string(NumIgnoredChannels) + " non-skeleton channels").c_str() : "");
+	}
+	return Clips;
+}
+
+static void ProcessAssimpNode(
 	aiNode* const      pNode,
 	const aiScene*     pAiScene,
 	const std::string& modelDirectory,
 	AssetLoader*       pAssetLoader,
 	Scene*             pScene,
-	VQRenderer*        pRenderer,
 	AssetLoader::FMaterialTextureAssignments& MaterialTextureAssignments,
-	TaskID                                    taskID
+	TaskID                                    taskID,
+	std::vector<FAssimpMeshOccurrence>&       MeshOccurrences
 )
 {
-	Model::Data modelData;
-
 	for (unsigned int i = 0; i < pNode->mNumMeshes; i++)
 	{	// process all the node's meshes (if any)
 		aiMesh* pAiMesh = pAiScene->mMeshes[pNode->mMeshes[i]];
@@ -631,34 +839,186 @@ static Model::Data ProcessAssimpNode(
 		// AI_MATKEY_BLEND_FUNC
 		// AI_MATKEY_BUMPSCALING
 		
-		Mesh mesh = ProcessAssimpMesh(pRenderer, pAiMesh, pAiScene, ModelName);
-		MeshID id = pScene->AddMesh(std::move(mesh));
-		modelData.mOpaueMeshIDs.push_back(id);
-		
-		modelData.mOpaqueMaterials[modelData.mOpaueMeshIDs.back()] = matID;
-		if (mat.IsTransparent())
-		{
-			modelData.mTransparentMeshIDs.push_back(modelData.mOpaueMeshIDs.back());
-		}
+		// the meshes are created after the traversal, once their geometry is deduplicated
+		MeshOccurrences.push_back({ pNode->mMeshes[i], matID, mat.IsTransparent() });
 	} // for: NumMeshes
 
 	for (unsigned int i = 0; i < pNode->mNumChildren; i++)
 	{	// then do the same for each of its children
-		Model::Data childModelData = ProcessAssimpNode(ModelName, pNode->mChildren[i], pAiScene, modelDirectory, pAssetLoader, pScene, pRenderer, MaterialTextureAssignments, taskID);
-		std::vector<MeshID>& ChildMeshes = childModelData.mOpaueMeshIDs;
-		std::vector<MeshID>& ChildMeshesTransparent = childModelData.mTransparentMeshIDs;
+		ProcessAssimpNode(pNode->mChildren[i], pAiScene, modelDirectory, pAssetLoader, pScene, MaterialTextureAssignments, taskID, MeshOccurrences);
+	} // for: NumChildren
+}
+
+//
+// COOKED MESHES
+//
+// The meshlets of the imported meshes are cooked to Cache/Meshes on the first import and read back on
+// later runs. A cooked mesh is used if it's newer than the model file and its vertices match the
+// imported ones, otherwise the meshlets are rebuilt and the file is overwritten.
+//
+static const std::string COOKED_MESH_DIRECTORY = "Cache/Meshes";
+
+static std::string GetCookedMeshFilePath(const std::string& ModelFilePath, unsigned iAiMesh)
+{
+	// the path hash keeps the models w/ the same file name apart
+	std::error_code ec;
+	const size_t PathHash = std::hash<std::string>()(std::filesystem::absolute(ModelFilePath, ec).generic_string());
+	char HashString[17] = {};
+	snprintf(HashString, sizeof(HashString), "%016llx", static_cast<unsigned long long>(PathHash));
+	return COOKED_MESH_DIRECTORY + "/" + DirectoryUtil::GetFileNameWithoutExtension(ModelFilePath) + "_" + HashString + "_" + std::to_string(iAiMesh) + ".vqmesh";
+}
+
+static bool ReadCookedMeshlets(const std::string& CookedFilePath, const std::string& ModelFilePath, const FAssimpMeshGeometry& Geometry, FMeshletData& OutMeshlets)
+{
+	std::error_code ec;
+	const std::filesystem::file_time_type CookedTime = std::filesystem::last_write_time(CookedFilePath, ec);
+	if (ec)
+		return false;
+	const std::filesystem::file_time_type ModelTime = std::filesystem::last_write_time(ModelFilePath, ec);
+	if (ec || CookedTime < ModelTime)
+		return false;
+
+	CookedMeshFile::FCookedMesh Cooked;
+	if (!CookedMeshFile::Read(CookedFilePath, Cooked))
+		return false;
+
+	const size_t VertexDataSize = sizeof(FVertexWithNormalAndTangent) * Geometry.Vertices.size();
+	const bool bMatchingGeometry = Cooked.VertexStride == sizeof(FVertexWithNormalAndTangent)
+		&& Cooked.VertexData.size() == VertexDataSize
+		&& Cooked.Meshlets.Indices.size() == Geometry.Indices.size()
+		&& std::memcmp(Cooked.VertexData.data(), Geometry.Vertices.data(), VertexDataSize) == 0;
+	if (!bMatchingGeometry)
+		return false;
+
+	OutMeshlets = std::move(Cooked.Meshlets);
+	return true;
+}
+
+static void WriteCookedMeshlets(const std::string& CookedFilePath, const FAssimpMeshGeometry& Geometry, const FMeshletData& Meshlets)
+{
+	if (Meshlets.Meshlets.empty())
+		return;
+
+	CookedMeshFile::FCookedMesh Cooked;
+	Cooked.VertexStride = sizeof(FVertexWithNormalAndTangent);
+	Cooked.VertexData.resize(sizeof(FVertexWithNormalAndTangent) * Geometry.Vertices.size());
+	std::memcpy(Cooked.VertexData.data(), Geometry.Vertices.data(), Cooked.VertexData.size());
+	Cooked.Meshlets = Meshlets;
+
+	// written next to the final file & renamed so the models importing the same file don't read a partial one
+	const std::string TempFilePath = CookedFilePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::error_code ec;
+	std::filesystem::create_directories(COOKED_MESH_DIRECTORY, ec);
+	if (CookedMeshFile::Write(TempFilePath, Cooked))
+		std::filesystem::rename(TempFilePath, CookedFilePath, ec);
+	if (ec)
+		Log::Warning("Couldn't write cooked mesh %s: %s", CookedFilePath.c_str(), ec.message().c_str());
+	std::filesystem::remove(TempFilePath, ec);
+}
+
+// creates a mesh per occurrence: geometries that duplicate a previous one, exactly or w/ a transformation,
+// become instances sharing its buffers. Skinned meshes are kept unique & get their skin weights.
+static Model::Data CreateAssimpMeshes(
+	const std::string& ModelFilePath,
+	const std::string& ModelName,
+	const aiScene*     pAiScene,
+	Scene*             pScene,
+	VQRenderer*        pRenderer,
+	ThreadPool*        pWorkerThreadPool,
+	const std::vector<FAssimpMeshOccurrence>& MeshOccurrences,
+	FModelAnimationData* pAnimationData
+)
+{
+	std::vector<FAssimpMeshGeometry> Geometries(pAiScene->mNumMeshes);
+	std::vector<bool> bGeometryExtracted(pAiScene->mNumMeshes, false);
+	std::vector<GeometryDeduplicator::FGeometry> GeometryViews(MeshOccurrences.size());
+	for (size_t i = 0; i < MeshOccurrences.size(); ++i)
+	{
+		const unsigned iAiMesh = MeshOccurrences[i].iAiMesh;
+		if (!bGeometryExtracted[iAiMesh])
+		{
+			Geometries[iAiMesh] = ProcessAssimpMesh(pAiScene->mMeshes[iAiMesh]);
+			bGeometryExtracted[iAiMesh] = true;
+		}
+
+		// nodes referencing the same aiMesh share the same view data & are matched w/o comparing the vertices.
+		// an empty view keeps a skinned mesh unique: its copies would need the same skin too
+		const FAssimpMeshGeometry& g = Geometries[iAiMesh];
+		if (!pAnimationData || !pAiScene->mMeshes[iAiMesh]->HasBones())
+			GeometryViews[i] = { g.Vertices.data(), static_cast<uint32>(g.Vertices.size()), g.Indices.data(), static_cast<uint32>(g.Indices.size()) };
+	}
+
+	const GeometryDeduplicator::FResult Dedup = GeometryDeduplicator::Deduplicate(GeometryViews, GeometryDeduplicator::FSettings(), pWorkerThreadPool);
 
-		std::copy(ChildMeshes.begin(), ChildMeshes.end(), std::back_inserter(modelData.mOpaueMeshIDs));
-		std::copy(ChildMeshesTransparent.begin(), ChildMeshesTransparent.end(), std::back_inserter(modelData.mTransparentMeshIDs));
-		for (auto& kvp : childModelData.mOpaqueMaterials)
+	Model::Data modelData;
+	std::vector<Mesh> SourceMeshes(MeshOccurrences.size()); // sources always precede their copies
+	uint32 NumSourceMeshes = 0;
+	uint32 NumCookedMeshes = 0;
+	for (size_t i = 0; i < MeshOccurrences.size(); ++i)
+	{
+		const FAssimpMeshOccurrence& Occurrence = MeshOccurrences[i];
+		const FAssimpMeshGeometry& g = Geometries[Occurrence.iAiMesh];
+		const uint32 iSource = Dedup.SourceIndices[i];
+
+		MeshID id = INVALID_ID;
+		if (iSource == i)
 		{
-#if _DEBUG
-			assert(modelData.mOpaqueMaterials.find(kvp.first) == modelData.mOpaqueMaterials.end());
-#endif
-			modelData.mOpaqueMaterials[kvp.first] = kvp.second;
+			++NumSourceMeshes;
+			const std::string CookedFilePath = GetCookedMeshFilePath(ModelFilePath, Occurrence.iAiMesh);
+			FMeshletData Meshlets;
+			if (ReadCookedMeshlets(CookedFilePath, ModelFilePath, g, Meshlets))
+			{
+				++NumCookedMeshes;
+			}
+			else
+			{
+				Meshlets = Mesh::BuildMeshlets(g.Vertices, g.Indices);
+				WriteCookedMeshlets(CookedFilePath, g, Meshlets);
+			}
+			SourceMeshes[i] = Mesh(pRenderer, g.Vertices, std::move(Meshlets), ModelName);
+			id = pScene->AddMesh(SourceMeshes[i]);
 		}
-	} // for: NumChildren
+		else
+		{
+			id = pScene->AddMesh(Mesh::CreateInstance(SourceMeshes[iSource], Dedup.Transforms[i], g.Vertices));
+		}
+
+		const aiMesh* pAiMesh = pAiScene->mMeshes[Occurrence.iAiMesh];
+		if (pAnimationData && pAiMesh->HasBones())
+		{
+			const std::vector<FVertexSkinWeights> SkinWeights = ImportAssimpSkinWeights(pAiMesh, pAnimationData->Skeleton);
+			FBufferDesc desc = {};
+			desc.Type        = VERTEX_BUFFER;
+			desc.NumElements = static_cast<uint>(SkinWeights.size());
+			desc.Stride      = sizeof(FVertexSkinWeights);
+			desc.pData       = SkinWeights.data();
+			desc.Name        = ModelName + "_SkinWeights";
+
+			FModelAnimationData::FSkin& Skin = pAnimationData->Skins[id];
+			Skin.SkinWeightsBufferID = pRenderer->CreateBuffer(desc);
+			Skin.NumVertices         = static_cast<uint32>(SkinWeights.size());
+		}
+
+		modelData.mOpaueMeshIDs.push_back(id);
+		modelData.mOpaqueMaterials[id] = Occurrence.matID;
+		if (Occurrence.bTransparent)
+		{
+			modelData.mTransparentMeshIDs.push_back(id);
+		}
+	}
+
+	if (NumCookedMeshes > 0)
+	{
+		Log::Info("   Cooked meshes: read the meshlets of %u/%u meshes from %s", NumCookedMeshes, NumSourceMeshes, COOKED_MESH_DIRECTORY.c_str());
+	}
 
+	const GeometryDeduplicator::FStatistics& s = Dedup.Stats;
+	if (s.NumExactDuplicates + s.NumTransformedCopies > 0)
+	{
+		Log::Info("   Geometry dedup: %u meshes -> %u unique (%u duplicates, %u transformed copies), %.2f MB saved (%.2fx) in %.2fms"
+			, s.NumGeometries, s.NumUniqueGeometries, s.NumExactDuplicates, s.NumTransformedCopies
+			, s.SavedBytes / (1024.0 * 1024.0), s.DedupRatio, s.DeduplicationTimeMs);
+	}
 	return modelData;
 }
 
@@ -666,8 +1026,9 @@ static Model::Data ProcessAssimpNode(
 //----------------------------------------------------------------------------------------------------------------
 // IMPORT MODEL FUNCTION FOR WORKER THREADS
 //----------------------------------------------------------------------------------------------------------------
-ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName)
+static const aiScene* ReadModelFile(Importer& importer, const std::string& objFilePath)
 {
+	SCOPED_MEMORY_TAG(EMemoryTag::ModelImport);
 	constexpr auto ASSIMP_LOAD_FLAGS
 		= aiProcess_Triangulate
 		| aiProcess_CalcTangentSpace
@@ -677,31 +1038,49 @@ ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRen
 		//| aiProcess_TransformUVCoords 
 		//| aiProcess_FixInfacingNormals
 		| aiProcess_JoinIdenticalVertices
-		| aiProcess_GenSmoothNormals;
-
-
-	TaskID taskID = GenerateModelLoadTaskID();
-	//-----------------------------------------------
-	const std::string modelDirectory = DirectoryUtil::GetFolderPath(objFilePath);
+		| aiProcess_GenSmoothNormals
+		| aiProcess_LimitBoneWeights; // MAX_BONE_INFLUENCES
 
-	Log::Info("ImportModel: %s - %s", ModelName.c_str(), objFilePath.c_str());
-	Timer t;
-	t.Start();
-
-	// Import Assimp Scene
-	Importer importer;
 	const aiScene* pAiScene = importer.ReadFile(objFilePath, ASSIMP_LOAD_FLAGS);
 	if (!pAiScene || pAiScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !pAiScene->mRootNode)
 	{
 		Log::Error("Assimp error: %s", importer.GetErrorString());
-		return INVALID_ID;
+		return nullptr;
 	}
-	t.Tick(); float fTimeReadFile = t.DeltaTime();
-	Log::Info("   [%.2fs] ReadFile=%s ", fTimeReadFile, objFilePath.c_str());
+	return pAiScene;
+}
+
+// creates the meshes, materials & the model of the imported scene and starts loading its textures
+static ModelID CreateModelFromAssimpScene(
+	Scene*             pScene,
+	AssetLoader*       pAssetLoader,
+	VQRenderer*        pRenderer,
+	const aiScene*     pAiScene,
+	const std::string& objFilePath,
+	const std::string& ModelName,
+	AssetLoader::FMaterialTextureAssignments& MaterialTextureAssignments,
+	ThreadPool*        pWorkerThreadPool
+)
+{
+	const TaskID taskID = AssetLoader::GenerateModelLoadTaskID();
+	const std::string modelDirectory = DirectoryUtil::GetFolderPath(objFilePath);
 
 	// parse scene and initialize model data
-	FMaterialTextureAssignments MaterialTextureAssignments(pAssetLoader->mWorkers_TextureLoad);
-	Model::Data data = ProcessAssimpNode(ModelName, pAiScene->mRootNode, pAiScene, modelDirectory, pAssetLoader, pScene, pRenderer, MaterialTextureAssignments, taskID);
+	std::vector<FAssimpMeshOccurrence> MeshOccurrences;
+	ProcessAssimpNode(pAiScene->mRootNode, pAiScene, modelDirectory, pAssetLoader, pScene, MaterialTextureAssignments, taskID, MeshOccurrences);
+
+	// skinned models: skeleton, skin weights & animation clips
+	std::shared_ptr<FModelAnimationData> pAnimationData = std::make_shared<FModelAnimationData>();
+	if (!ImportAssimpSkeleton(pAiScene, pAnimationData->Skeleton))
+		pAnimationData.reset();
+
+	Model::Data data = CreateAssimpMeshes(objFilePath, ModelName, pAiScene, pScene, pRenderer, pWorkerThreadPool, MeshOccurrences, pAnimationData.get());
+	if (pAnimationData)
+	{
+		Log::Info("   Skeleton: %u bones, %u skinned meshes", pAnimationData->Skeleton.GetNumBones(), static_cast<uint32>(pAnimationData->Skins.size()));
+		pAnimationData->Clips = ImportAssimpAnimations(pAiScene, pAnimationData->Skeleton);
+		data.mpAnimationData = std::move(pAnimationData);
+	}
 
 	pRenderer->UploadVertexAndIndexBufferHeaps(); // load VB/IBs
 
@@ -712,6 +1091,29 @@ ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRen
 	ModelID mID = pScene->CreateModel();
 	Model& model = pScene->GetModel(mID);
 	model = Model(objFilePath, ModelName, std::move(data));
+	return mID;
+}
+
+ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName)
+{
+	Log::Info("ImportModel: %s - %s", ModelName.c_str(), objFilePath.c_str());
+	SCOPED_MEMORY_TAG(EMemoryTag::AssetLoader);
+	Timer t;
+	t.Start();
+
+	// Import Assimp Scene
+	Importer importer;
+	const aiScene* pAiScene = ReadModelFile(importer, objFilePath);
+	if (!pAiScene)
+	{
+		return INVALID_ID;
+	}
+	t.Tick(); float fTimeReadFile = t.DeltaTime();
+	Log::Info("   [%.2fs] ReadFile=%s ", fTimeReadFile, objFilePath.c_str());
+
+	FMaterialTextureAssignments MaterialTextureAssignments(pAssetLoader->mWorkers_TextureLoad);
+	// runs on a model loading worker: deduplicate the geometry on the texture workers so the model workers never wait on each other
+	ModelID mID = CreateModelFromAssimpScene(pScene, pAssetLoader, pRenderer, pAiScene, objFilePath, ModelName, MaterialTextureAssignments, &pAssetLoader->mWorkers_TextureLoad);
 
 	// SYNC POINT : wait for textures to load
 	{
@@ -726,3 +1128,164 @@ ModelID AssetLoader::ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRen
 	return mID;
 }
 
+
+//----------------------------------------------------------------------------------------------------------------
+// MODEL STREAMING
+//----------------------------------------------------------------------------------------------------------------
+static bool IsReady(const std::shared_future<bool>& f)
+{
+	return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void AssetLoader::StartStreamingModels(Scene* pScene)
+{
+	assert(mpStreamingScene == nullptr || mpStreamingScene == pScene); // if you hit this, CancelModelStreaming() before switching scenes
+	mpStreamingScene = pScene;
+
+	std::unique_lock<std::mutex> lk(mMtxQueue_ModelLoad);
+	while (!mModelLoadQueue.empty())
+	{
+		FModelLoadParams ModelLoadParams = std::move(mModelLoadQueue.front());
+		mModelLoadQueue.pop();
+
+		// the file size is the I/O estimate, requests are unique per path
+		std::error_code ec;
+		const uint64 FileSize = std::filesystem::file_size(ModelLoadParams.ModelPath, ec);
+		const AssetRequestID ID = mStreamingScheduler.Request(ModelLoadParams.ModelPath, ec ? 0 : FileSize);
+
+		FModelStreamingRequest& r = mStreamingRequests[ID];
+		r.ModelPath = ModelLoadParams.ModelPath;
+		r.ModelName = ModelLoadParams.ModelName;
+		r.pObjects.push_back(ModelLoadParams.pObject);
+	}
+	Log::Info("AssetLoader: streaming %u models", static_cast<uint32>(mStreamingRequests.size()));
+}
+
+void AssetLoader::UpdateModelStreaming(const FAssetStreamingView& View, const std::vector<Transform*>& pTransforms, float PlaceholderRadius, std::vector<GameObject*>& OutStreamedObjects)
+{
+	// the model bounds aren't known until it's loaded: use the placeholder's
+	for (const auto& it : mStreamingRequests)
+	{
+		if (!mStreamingScheduler.IsRequested(it.first))
+			continue;
+
+		mStreamingBoundingSpheres.clear();
+		for (const GameObject* pObj : it.second.pObjects)
+		{
+			const Transform* pTF = pTransforms[pObj->mTransformID];
+			const float MaxScale = std::max(std::abs(pTF->_scale.x), std::max(std::abs(pTF->_scale.y), std::abs(pTF->_scale.z)));
+			mStreamingBoundingSpheres.push_back(XMFLOAT4(pTF->_position.x, pTF->_position.y, pTF->_position.z, MaxScale * PlaceholderRadius));
+		}
+		mStreamingScheduler.SetInstanceBounds(it.first, mStreamingBoundingSpheres.data(), mStreamingBoundingSpheres.size());
+	}
+
+	mStreamedObjects.clear();
+	mStreamingScheduler.Update(View); // calls Finalize() for the loaded models
+	OutStreamedObjects = mStreamedObjects;
+
+	// materials of the finalized models keep the default textures until all of their textures are loaded
+	auto itEnd = std::remove_if(mStreamingTextureAssignments.begin(), mStreamingTextureAssignments.end(), [&](const std::unique_ptr<FMaterialTextureAssignments>& pAssignments)
+	{
+		for (const auto& it : pAssignments->mTextureLoadResults)
+			if (it.second.texLoadResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				return false;
+		pAssignments->DoAssignments(mpStreamingScene, &mRenderer);
+		return true;
+	});
+	mStreamingTextureAssignments.erase(itEnd, mStreamingTextureAssignments.end());
+
+	mCancelledStreamingReads.erase(std::remove_if(mCancelledStreamingReads.begin(), mCancelledStreamingReads.end(), IsReady), mCancelledStreamingReads.end());
+}
+
+void AssetLoader::CancelModelStreaming()
+{
+	mStreamingScheduler.CancelAll();
+
+	// the workers don't outlive the scene objects & materials
+	for (const std::shared_future<bool>& ReadResult : mCancelledStreamingReads)
+	{
+		if (mWorkers_ModelLoad.IsExiting())
+			break;
+		ReadResult.wait();
+	}
+	for (std::unique_ptr<FMaterialTextureAssignments>& pAssignments : mStreamingTextureAssignments)
+	{
+		pAssignments->WaitForTextureLoads();
+	}
+
+	mCancelledStreamingReads.clear();
+	mStreamingTextureAssignments.clear();
+	mStreamingRequests.clear();
+	mStreamedObjects.clear();
+	mpStreamingScene = nullptr;
+}
+
+void AssetLoader::BeginLoad(AssetRequestID ID, const std::string& Path)
+{
+	FModelStreamingRequest& r = mStreamingRequests.at(ID);
+	r.pImporter = std::make_shared<Importer>();
+	r.pbCancelled = std::make_shared<std::atomic<bool>>(false);
+
+	// check whether Exit signal is given to the app before dispatching workers
+	if (mWorkers_ModelLoad.IsExiting())
+	{
+		std::promise<bool> Failed;
+		Failed.set_value(false);
+		r.ReadResult = Failed.get_future().share();
+		return;
+	}
+
+	// only the file read happens on the worker, Finalize() creates the GPU resources
+	std::shared_ptr<Importer> pImporter = r.pImporter;
+	std::shared_ptr<std::atomic<bool>> pbCancelled = r.pbCancelled;
+	r.ReadResult = std::move(mWorkers_ModelLoad.AddTask([pImporter, pbCancelled, Path]()
+	{
+		if (pbCancelled->load())
+			return false;
+		return ReadModelFile(*pImporter, Path) != nullptr;
+	}));
+}
+
+bool AssetLoader::IsLoaded(AssetRequestID ID)
+{
+	return IsReady(mStreamingRequests.at(ID).ReadResult);
+}
+
+float AssetLoader::Finalize(AssetRequestID ID)
+{
+	Timer t;
+	t.Start();
+
+	auto it = mStreamingRequests.find(ID);
+	FModelStreamingRequest& r = it->second;
+
+	// objects keep the placeholder model if the file couldn't be read
+	const aiScene* pAiScene = r.ReadResult.get() ? r.pImporter->GetScene() : nullptr;
+	if (pAiScene)
+	{
+		std::unique_ptr<FMaterialTextureAssignments> pAssignments = std::make_unique<FMaterialTextureAssignments>(mWorkers_TextureLoad);
+		const ModelID mID = CreateModelFromAssimpScene(mpStreamingScene, this, &mRenderer, pAiScene, r.ModelPath, r.ModelName, *pAssignments, &mWorkers_TextureLoad);
+		if (!pAssignments->mAssignments.empty())
+			mStreamingTextureAssignments.push_back(std::move(pAssignments));
+
+		for (GameObject* pObj : r.pObjects)
+		{
+			pObj->mModelID = mID;
+			mStreamedObjects.push_back(pObj);
+		}
+	}
+
+	const float FinalizeMs = t.Tick() * 1000.0f;
+	Log::Info("AssetLoader: streamed model '%s' in %.2fms", r.ModelName.c_str(), FinalizeMs);
+	mStreamingRequests.erase(it);
+	return FinalizeMs;
+}
+
+void AssetLoader::Cancel(AssetRequestID ID)
+{
+	// a read that already started can't be interrupted, it's waited on before the scene is unloaded
+	FModelStreamingRequest& r = mStreamingRequests.at(ID);
+	r.pbCancelled->store(true);
+	mCancelledStreamingReads.push_back(std::move(r.ReadResult));
+	r.pImporter.reset();
+}
@@ -18,17 +18,22 @@
 #pragma once
 
 #include "Scene/Model.h"
+#include "AssetStreaming.h"
 
 #include <set>
 #include <queue>
 #include <mutex>
 #include <future>
+#include <atomic>
+#include <memory>
 
 class ThreadPool;
 class Scene;
 class GameObject;
+struct Transform;
+namespace Assimp { class Importer; }
 
-class AssetLoader
+class AssetLoader : private FAssetStreamingBackend
 {
 public:
 	// 
@@ -122,9 +127,34 @@ public:
 	ModelLoadResults_t   StartLoadingModels(Scene* pScene);
 	TextureLoadResults_t StartLoadingTextures(TaskID taskID);
 
+	//
+	// MODEL STREAMING
+	//
+	// When enabled, the queued models are requested from the streaming scheduler instead of being loaded all at once:
+	// workers only read the files, the meshes & materials are created on the update thread within the frame budget,
+	// nearest to the camera first. Objects keep their placeholder model until then.
+	inline void SetModelStreamingEnabled(bool bEnabled) { mbStreamModels = bEnabled; }
+	inline bool IsModelStreamingEnabled() const { return mbStreamModels; }
+	inline const AssetStreamingScheduler& GetStreamingScheduler() const { return mStreamingScheduler; }
+
+	void StartStreamingModels(Scene* pScene);
+
+	// Returns the objects whose model was finalized this frame. Until their model is loaded, objects are
+	// prioritized w/ a sphere of PlaceholderRadius scaled by their transform.
+	void UpdateModelStreaming(const FAssetStreamingView& View, const std::vector<Transform*>& pTransforms, float PlaceholderRadius, std::vector<GameObject*>& OutStreamedObjects);
+
+	// Cancels the requests and waits for the in-flight reads, call before the requesting objects are released.
+	void CancelModelStreaming();
+
 private:
 	static ModelID ImportModel(Scene* pScene, AssetLoader* pAssetLoader, VQRenderer* pRenderer, const std::string& objFilePath, std::string ModelName = "NONE");
 
+	// FAssetStreamingBackend
+	void  BeginLoad(AssetRequestID ID, const std::string& Path) override;
+	bool  IsLoaded(AssetRequestID ID) override;
+	float Finalize(AssetRequestID ID) override;
+	void  Cancel(AssetRequestID ID) override;
+
 	//
 	// DATA
 	//
@@ -146,4 +176,23 @@ private:
 	std::mutex                   mMtxQueue_ModelLoad;
 
 	std::unordered_map<std::string, ModelID> mLoadedModels;
+
+	// streaming
+	struct FModelStreamingRequest
+	{
+		std::string                        ModelPath;
+		std::string                        ModelName;
+		std::vector<GameObject*>           pObjects;
+		std::shared_ptr<Assimp::Importer>  pImporter;   // owns the file data read by the worker
+		std::shared_ptr<std::atomic<bool>> pbCancelled; // checked by the worker before reading
+		std::shared_future<bool>           ReadResult;
+	};
+	bool                                                      mbStreamModels = false;
+	AssetStreamingScheduler                                   mStreamingScheduler;
+	Scene*                                                    mpStreamingScene = nullptr;
+	std::unordered_map<AssetRequestID, FModelStreamingRequest> mStreamingRequests;
+	std::vector<std::shared_future<bool>>                     mCancelledStreamingReads;
+	std::vector<std::unique_ptr<FMaterialTextureAssignments>> mStreamingTextureAssignments; // assigned once all their textures are loaded
+	std::vector<GameObject*>                                  mStreamedObjects;             // finalized during the current update
+	std::vector<DirectX::XMFLOAT4>                            mStreamingBoundingSpheres;
 };
\ No newline at end of file
@@ -0,0 +1,204 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "AssetStreaming.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void AssetStreamingScheduler::Initialize(FAssetStreamingBackend* pBackend, const FAssetStreamingBudget& Budget)
+{
+	assert(pBackend);
+	assert(mRequests.empty()); // if you hit this, CancelAll() before re-initializing
+	mpBackend = pBackend;
+	mBudget = Budget;
+	mStats = {};
+}
+
+AssetRequestID AssetStreamingScheduler::Request(const std::string& Path, uint64 EstimatedSizeBytes)
+{
+	auto it = mRequestLookup.find(Path);
+	if (it != mRequestLookup.end())
+		return it->second;
+
+	const AssetRequestID ID = mNextRequestID++;
+	FRequest& r = mRequests[ID];
+	r.Path = Path;
+	r.EstimatedSizeBytes = EstimatedSizeBytes;
+	mRequestLookup[Path] = ID;
+	return ID;
+}
+
+void AssetStreamingScheduler::SetInstanceBounds(AssetRequestID ID, const DirectX::XMFLOAT4* pBoundingSpheres, size_t NumSpheres)
+{
+	auto it = mRequests.find(ID);
+	if (it == mRequests.end())
+		return; // finalized or cancelled
+	it->second.BoundingSpheres.assign(pBoundingSpheres, pBoundingSpheres + NumSpheres);
+}
+
+void AssetStreamingScheduler::Cancel(AssetRequestID ID)
+{
+	auto it = mRequests.find(ID);
+	if (it == mRequests.end())
+		return;
+	if (it->second.State != PENDING)
+		mpBackend->Cancel(ID);
+	++mStats.NumTotalCancelled;
+	Remove(it);
+}
+
+void AssetStreamingScheduler::CancelAll()
+{
+	for (auto& it : mRequests)
+	{
+		if (it.second.State != PENDING)
+			mpBackend->Cancel(it.first);
+		++mStats.NumTotalCancelled;
+	}
+	mRequests.clear();
+	mRequestLookup.clear();
+}
+
+bool AssetStreamingScheduler::IsRequested(AssetRequestID ID) const
+{
+	return mRequests.find(ID) != mRequests.end();
+}
+
+AssetStreamingScheduler::ERequestState AssetStreamingScheduler::GetState(AssetRequestID ID) const
+{
+	auto it = mRequests.find(ID);
+	return it == mRequests.end() ? NUM_REQUEST_STATES : it->second.State;
+}
+
+float AssetStreamingScheduler::GetPriority(AssetRequestID ID) const
+{
+	auto it = mRequests.find(ID);
+	return it == mRequests.end() ? 0.0f : it->second.Priority;
+}
+
+float AssetStreamingScheduler::CalculatePriority(const FAssetStreamingView& View, const DirectX::XMFLOAT4* pBoundingSpheres, size_t NumSpheres)
+{
+	constexpr float MIN_DISTANCE = 1e-4f;
+	float Priority = 0.0f;
+	for (size_t i = 0; i < NumSpheres; ++i)
+	{
+		const DirectX::XMFLOAT4& s = pBoundingSpheres[i];
+		const float dx = s.x - View.Position.x;
+		const float dy = s.y - View.Position.y;
+		const float dz = s.z - View.Position.z;
+		const float Distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		// projected radius, clamped when the camera is inside the sphere
+		Priority = std::max(Priority, View.ProjectionScale * s.w / std::max(std::max(Distance, s.w), MIN_DISTANCE));
+	}
+	return Priority;
+}
+
+void AssetStreamingScheduler::Update(const FAssetStreamingView& View)
+{
+	assert(mpBackend);
+
+	// per-frame stats
+	mStats.NumLoadsStarted = 0;
+	mStats.NumFinalized    = 0;
+	mStats.IOBytesStarted  = 0;
+	mStats.FinalizeMs      = 0.0f;
+	std::fill(std::begin(mStats.NumRequests), std::end(mStats.NumRequests), 0u);
+
+	for (auto& it : mRequests)
+	{
+		FRequest& r = it.second;
+		r.Priority = CalculatePriority(View, r.BoundingSpheres.data(), r.BoundingSpheres.size());
+		if (r.State == LOADING && mpBackend->IsLoaded(it.first))
+			r.State = LOADED;
+	}
+
+	// finalize the loaded assets within the CPU budget
+	std::vector<RequestIterator_t> Requests;
+	GatherRequests(LOADED, Requests, true);
+	for (RequestIterator_t it : Requests)
+	{
+		if (mStats.NumFinalized > 0 && mStats.FinalizeMs >= mBudget.MaxFinalizeMsPerFrame)
+			break;
+		mStats.FinalizeMs += mpBackend->Finalize(it->first);
+		++mStats.NumFinalized;
+		++mStats.NumTotalFinalized;
+		Remove(it);
+	}
+
+	std::vector<RequestIterator_t> Pending, Loading;
+	GatherRequests(PENDING, Pending, true);
+	GatherRequests(LOADING, Loading, false);
+	uint32 NumInFlight = static_cast<uint32>(Loading.size());
+
+	// preempt the lowest priority in-flight loads for the pending requests that would start this frame
+	if (mBudget.PreemptionRatio > 0.0f)
+	{
+		const size_t NumCandidates = std::min<size_t>(Pending.size(), mBudget.MaxLoadsPerFrame);
+		for (size_t i = 0; i < NumCandidates && i < Loading.size() && NumInFlight >= mBudget.MaxLoadsInFlight; ++i)
+		{
+			FRequest& r = Loading[i]->second;
+			if (Pending[i]->second.Priority <= r.Priority * mBudget.PreemptionRatio)
+				break;
+			mpBackend->Cancel(Loading[i]->first);
+			r.State = PENDING;
+			++mStats.NumTotalPreempted;
+			--NumInFlight;
+		}
+	}
+
+	// start the pending loads within the I/O budget
+	for (RequestIterator_t it : Pending)
+	{
+		FRequest& r = it->second;
+		if (mStats.NumLoadsStarted >= mBudget.MaxLoadsPerFrame || NumInFlight >= mBudget.MaxLoadsInFlight)
+			break;
+		if (mStats.NumLoadsStarted > 0 && mStats.IOBytesStarted + r.EstimatedSizeBytes > mBudget.MaxIOBytesPerFrame)
+			break;
+		r.State = LOADING;
+		mStats.IOBytesStarted += r.EstimatedSizeBytes;
+		++mStats.NumLoadsStarted;
+		++NumInFlight;
+		mpBackend->BeginLoad(it->first, r.Path);
+	}
+
+	for (const auto& it : mRequests)
+		++mStats.NumRequests[it.second.State];
+}
+
+void AssetStreamingScheduler::GatherRequests(ERequestState State, std::vector<RequestIterator_t>& OutRequests, bool bHighestPriorityFirst)
+{
+	OutRequests.clear();
+	for (RequestIterator_t it = mRequests.begin(); it != mRequests.end(); ++it)
+		if (it->second.State == State)
+			OutRequests.push_back(it);
+
+	// stable: ties stay in request order
+	if (bHighestPriorityFirst)
+		std::stable_sort(OutRequests.begin(), OutRequests.end(), [](const RequestIterator_t& l, const RequestIterator_t& r) { return l->second.Priority > r->second.Priority; });
+	else
+		std::stable_sort(OutRequests.begin(), OutRequests.end(), [](const RequestIterator_t& l, const RequestIterator_t& r) { return l->second.Priority < r->second.Priority; });
+}
+
+void AssetStreamingScheduler::Remove(RequestIterator_t it)
+{
+	mRequestLookup.erase(it->second.Path);
+	mRequests.erase(it);
+}
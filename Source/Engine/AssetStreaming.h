@@ -0,0 +1,139 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <DirectXMath.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using AssetRequestID = uint32;
+
+struct FAssetStreamingView
+{
+	DirectX::XMFLOAT3 Position        = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	float             ProjectionScale = 1.0f; // ViewportHeight / (2 * tan(FoV/2)): radius/distance -> pixels
+};
+struct FAssetStreamingBudget
+{
+	uint64 MaxIOBytesPerFrame    = 32ull << 20; // estimated size of the loads started in a frame, the first load of a frame always starts
+	uint32 MaxLoadsPerFrame      = 4;
+	uint32 MaxLoadsInFlight      = 8;
+	float  MaxFinalizeMsPerFrame = 2.0f;        // CPU time spent finalizing loaded assets in a frame, at least one is finalized
+	float  PreemptionRatio       = 4.0f;        // a pending request w/ this many times the priority of an in-flight load preempts it, 0: off
+};
+
+// The I/O & CPU side of streaming. The asset loader implements this w/ its worker threads
+// and VQETests w/ a fake backend that completes the loads after a simulated latency.
+struct FAssetStreamingBackend
+{
+	virtual void  BeginLoad(AssetRequestID ID, const std::string& Path) = 0; // starts the I/O, e.g. on a worker thread
+	virtual bool  IsLoaded(AssetRequestID ID) = 0;                           // polled once per frame for each in-flight load
+	virtual float Finalize(AssetRequestID ID) = 0;                           // creates the asset & replaces its placeholders, returns the CPU time in ms
+	virtual void  Cancel(AssetRequestID ID) = 0;                             // the in-flight load won't be finalized, its data can be discarded
+};
+
+//
+// ASSET STREAMING SCHEDULER
+//
+// Orders asset loads by how much the requesting objects cover on screen, so the assets close
+// to the camera arrive first and the first frame doesn't wait for the whole scene.
+//
+// - Each request is a unique asset path w/ the bounding spheres of the objects that use it.
+//   Priority is the largest projected radius of the spheres and is recomputed every Update()
+//   for the pending, in-flight and loaded requests.
+// - Update() polls the in-flight loads, finalizes the loaded ones in priority order within the
+//   CPU budget and starts the pending ones in priority order within the I/O budget.
+// - When the in-flight slots are full, a pending request w/ PreemptionRatio times the priority
+//   of an in-flight load cancels that load and takes its slot, the preempted request is pending again.
+// - Cancel() removes a request in any state, the backend is told if its load is in flight.
+// - Doesn't measure time itself and breaks priority ties by request order, so it is deterministic
+//   for a given sequence of views & backend responses.
+//
+class AssetStreamingScheduler
+{
+public:
+	static constexpr AssetRequestID INVALID_REQUEST = 0xFFFFFFFF;
+
+	enum ERequestState : uint8
+	{
+		PENDING = 0,
+		LOADING,
+		LOADED,    // waiting to be finalized
+
+		NUM_REQUEST_STATES
+	};
+	struct FStatistics
+	{
+		uint32 NumRequests[NUM_REQUEST_STATES] = {};
+		uint32 NumLoadsStarted      = 0; // this frame
+		uint32 NumFinalized         = 0; // this frame
+		uint64 IOBytesStarted       = 0; // this frame
+		float  FinalizeMs           = 0.0f; // this frame
+		uint32 NumTotalFinalized    = 0;
+		uint32 NumTotalCancelled    = 0;
+		uint32 NumTotalPreempted    = 0;
+	};
+
+public:
+	void Initialize(FAssetStreamingBackend* pBackend, const FAssetStreamingBudget& Budget = {});
+
+	// Returns the existing request if the path is already requested
+	AssetRequestID Request(const std::string& Path, uint64 EstimatedSizeBytes);
+	void           SetInstanceBounds(AssetRequestID ID, const DirectX::XMFLOAT4* pBoundingSpheres, size_t NumSpheres); // xyz: center, w: radius
+	void           Cancel(AssetRequestID ID);
+	void           CancelAll();
+
+	void           Update(const FAssetStreamingView& View);
+
+	inline bool    IsIdle() const { return mRequests.empty(); }
+	bool           IsRequested(AssetRequestID ID) const;
+	ERequestState  GetState(AssetRequestID ID) const;
+	float          GetPriority(AssetRequestID ID) const;
+	inline const FStatistics&           GetStatistics() const { return mStats; }
+	inline const FAssetStreamingBudget& GetBudget()     const { return mBudget; }
+	inline void                         SetBudget(const FAssetStreamingBudget& Budget) { mBudget = Budget; }
+
+	static float CalculatePriority(const FAssetStreamingView& View, const DirectX::XMFLOAT4* pBoundingSpheres, size_t NumSpheres);
+
+private:
+	struct FRequest
+	{
+		std::string                    Path;
+		uint64                         EstimatedSizeBytes = 0;
+		std::vector<DirectX::XMFLOAT4> BoundingSpheres;
+		float                          Priority = 0.0f;
+		ERequestState                  State = PENDING;
+	};
+	using RequestIterator_t = std::map<AssetRequestID, FRequest>::iterator;
+
+	void GatherRequests(ERequestState State, std::vector<RequestIterator_t>& OutRequests, bool bHighestPriorityFirst);
+	void Remove(RequestIterator_t it);
+
+private:
+	FAssetStreamingBackend*                         mpBackend = nullptr;
+	FAssetStreamingBudget                           mBudget;
+	std::map<AssetRequestID, FRequest>              mRequests; // ordered for deterministic iteration
+	std::unordered_map<std::string, AssetRequestID> mRequestLookup;
+	AssetRequestID                                  mNextRequestID = 0;
+	FStatistics                                     mStats;
+};
@@ -0,0 +1,108 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "CameraBenchmark.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+bool CameraBenchmark::Initialize(const std::string& TrackFilePath, float FixedTimestep)
+{
+	mFrameStats.clear();
+	mFrameIndex = 0;
+	mbFinished = false;
+	mFixedTimestep = FixedTimestep;
+	mTrackFilePath = TrackFilePath;
+
+	if (!mTrack.Load(TrackFilePath) || mTrack.IsEmpty())
+	{
+		Log::Error("CameraBenchmark: couldn't load camera track %s", TrackFilePath.c_str());
+		mTrack.Clear();
+		return false;
+	}
+	assert(FixedTimestep > 0.0f);
+
+	const unsigned NumFrames = static_cast<unsigned>(mTrack.GetDuration() / FixedTimestep) + 1;
+	mFrameStats.reserve(NumFrames);
+	Log::Info("CameraBenchmark: %s, %.2fs, %u frames @ %.2fms", TrackFilePath.c_str(), mTrack.GetDuration(), NumFrames, FixedTimestep * 1000.0f);
+	return true;
+}
+
+FCameraTrackKey CameraBenchmark::GetCurrentCameraKey() const
+{
+	// time from the frame index instead of accumulating the timestep, for reproducibility
+	return mTrack.Sample(mTrack.GetStartTime() + static_cast<float>(mFrameIndex) * mFixedTimestep);
+}
+
+void CameraBenchmark::EndFrame(float UpdateMs, float UIMs, float RenderMs)
+{
+	if (!IsRunning())
+		return;
+
+	FFrameStats Stats = {};
+	Stats.FrameIndex = mFrameIndex;
+	Stats.Camera     = GetCurrentCameraKey();
+	Stats.UpdateMs   = UpdateMs;
+	Stats.UIMs       = UIMs;
+	Stats.RenderMs   = RenderMs;
+	Stats.FrameMs    = UpdateMs + UIMs + RenderMs;
+	mFrameStats.push_back(Stats);
+
+	++mFrameIndex;
+	mbFinished = mTrack.GetStartTime() + static_cast<float>(mFrameIndex) * mFixedTimestep > mTrack.GetEndTime();
+}
+
+bool CameraBenchmark::WriteResults(const std::string& CSVFilePath) const
+{
+	FILE* pFile = fopen(CSVFilePath.c_str(), "w");
+	if (!pFile)
+	{
+		Log::Error("CameraBenchmark: couldn't open %s for writing", CSVFilePath.c_str());
+		return false;
+	}
+
+	// camera columns are printed w/ 9 significant digits: float round-trips exactly
+	fprintf(pFile, "Frame,Time,PosX,PosY,PosZ,RotX,RotY,RotZ,RotW,FoV,NearZ,FarZ,UpdateMs,UIMs,RenderMs,FrameMs\n");
+	for (const FFrameStats& s : mFrameStats)
+	{
+		const FCameraTrackKey& c = s.Camera;
+		fprintf(pFile, "%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.3f,%.3f,%.3f,%.3f\n"
+			, s.FrameIndex, c.Time
+			, c.Position.x, c.Position.y, c.Position.z
+			, c.Rotation.x, c.Rotation.y, c.Rotation.z, c.Rotation.w
+			, c.FieldOfView, c.NearZ, c.FarZ
+			, s.UpdateMs, s.UIMs, s.RenderMs, s.FrameMs
+		);
+	}
+	fclose(pFile);
+
+	if (!mFrameStats.empty())
+	{
+		std::vector<float> FrameTimes(mFrameStats.size());
+		std::transform(mFrameStats.begin(), mFrameStats.end(), FrameTimes.begin(), [](const FFrameStats& s) { return s.FrameMs; });
+		std::sort(FrameTimes.begin(), FrameTimes.end());
+		float Sum = 0.0f;
+		for (float t : FrameTimes) Sum += t;
+		Log::Info("CameraBenchmark: %u frames, CPU frame time avg=%.2fms median=%.2fms max=%.2fms -> %s"
+			, static_cast<unsigned>(FrameTimes.size()), Sum / FrameTimes.size(), FrameTimes[FrameTimes.size() / 2], FrameTimes.back(), CSVFilePath.c_str());
+	}
+	return true;
+}
@@ -0,0 +1,65 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Scene/CameraTrack.h"
+
+#include <string>
+#include <vector>
+
+//
+// CAMERA BENCHMARK
+//
+// Fixed-timestep run over a camera track: frame N samples the track at StartTime + N * FixedTimestep,
+// so the camera sequence of a track is identical across runs. The CPU timings of each frame are
+// recorded next to the camera sample and written out as CSV at the end of the run.
+//
+class CameraBenchmark
+{
+public:
+	struct FFrameStats
+	{
+		unsigned        FrameIndex;
+		FCameraTrackKey Camera;
+		float           UpdateMs;
+		float           UIMs;
+		float           RenderMs;
+		float           FrameMs;
+	};
+
+	bool Initialize(const std::string& TrackFilePath, float FixedTimestep);
+
+	inline bool  IsRunning()         const { return !mTrack.IsEmpty() && !mbFinished; }
+	inline bool  IsFinished()        const { return mbFinished; }
+	inline float GetFixedTimestep()  const { return mFixedTimestep; }
+	inline const std::vector<FFrameStats>& GetFrameStats() const { return mFrameStats; }
+
+	FCameraTrackKey GetCurrentCameraKey() const;
+	void            EndFrame(float UpdateMs, float UIMs, float RenderMs);
+
+	bool WriteResults(const std::string& CSVFilePath) const;
+	inline const std::string& GetTrackFilePath() const { return mTrackFilePath; }
+
+private:
+	CameraTrack              mTrack;
+	std::string              mTrackFilePath;
+	float                    mFixedTimestep = 1.0f / 60.0f;
+	unsigned                 mFrameIndex = 0;
+	bool                     mbFinished = false;
+	std::vector<FFrameStats> mFrameStats;
+};
@@ -0,0 +1,123 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "CascadedShadowMaps.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+void CalculateCascadeSplitDistances(float NearZ, float FarZ, uint32 NumCascades, float Lambda, float* pOutSplitDistances)
+{
+	assert(NearZ > 0.0f && FarZ > NearZ && NumCascades > 0);
+	for (uint32 i = 0; i <= NumCascades; ++i)
+	{
+		const float p = static_cast<float>(i) / NumCascades;
+		const float Logarithmic = NearZ * std::pow(FarZ / NearZ, p);
+		const float Uniform     = NearZ + (FarZ - NearZ) * p;
+		pOutSplitDistances[i] = Uniform + (Logarithmic - Uniform) * Lambda;
+	}
+	pOutSplitDistances[0] = NearZ;
+	pOutSplitDistances[NumCascades] = FarZ;
+}
+
+void CalculateFrustumSliceBoundingSphere(float SplitNear, float SplitFar, float FieldOfViewY, float AspectRatio, float& OutCenterDistance, float& OutRadius)
+{
+	// the center is on the view axis, equidistant to the near & far corners:
+	//   n^2*k^2 + (n - c)^2 = f^2*k^2 + (f - c)^2  ->  c = (n + f) * (1 + k^2) / 2
+	// where k^2 = tan(fovX/2)^2 + tan(fovY/2)^2 is the squared corner slope.
+	const float TanY = std::tan(FieldOfViewY * 0.5f);
+	const float TanX = TanY * AspectRatio;
+	const float k2 = TanX * TanX + TanY * TanY;
+
+	float c = 0.5f * (SplitNear + SplitFar) * (1.0f + k2);
+	if (c >= SplitFar) // wide slices: the far plane's circumscribed circle encloses the near corners too
+	{
+		OutCenterDistance = SplitFar;
+		OutRadius = SplitFar * std::sqrt(k2);
+		return;
+	}
+	OutCenterDistance = c;
+	OutRadius = std::sqrt((SplitFar - c) * (SplitFar - c) + SplitFar * SplitFar * k2);
+}
+
+FShadowCascade FitShadowCascade(const FCascadedShadowMapParameters& Params, float SplitNear, float SplitFar)
+{
+	FShadowCascade Cascade = {};
+	Cascade.SplitNear = SplitNear;
+	Cascade.SplitFar  = SplitFar;
+
+	float CenterDistance = 0.0f;
+	float Radius = 0.0f;
+	CalculateFrustumSliceBoundingSphere(SplitNear, SplitFar, Params.FieldOfViewY, Params.AspectRatio, CenterDistance, Radius);
+	Radius = std::ceil(Radius * 16.0f) / 16.0f; // keep float noise from changing the projection
+	// snapping moves the center by up to a texel: one texel of margin keeps the sphere inside the projection,
+	// i.e. HalfExtent = Radius + TexelSize w/ TexelSize = 2 * HalfExtent / Resolution
+	const float TexelSize = 2.0f * Radius / (Params.ShadowMapResolution - 2);
+	const float HalfExtent = Radius + TexelSize;
+
+	// light space basis, rotation only
+	const XMVECTOR L = XMVector3Normalize(XMLoadFloat3(&Params.LightDirection));
+	const XMVECTOR Up = std::abs(XMVectorGetY(L)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	const XMMATRIX matLightRotation = XMMatrixLookToLH(XMVectorZero(), L, Up);
+
+	// snap the sphere center to texels in light space
+	const XMVECTOR Center = XMVectorAdd(XMLoadFloat3(&Params.CameraPosition), XMVectorScale(XMVector3Normalize(XMLoadFloat3(&Params.CameraForward)), CenterDistance));
+	XMFLOAT3 CenterLS;
+	XMStoreFloat3(&CenterLS, XMVector3TransformCoord(Center, matLightRotation));
+	CenterLS.x = std::floor(CenterLS.x / TexelSize) * TexelSize;
+	CenterLS.y = std::floor(CenterLS.y / TexelSize) * TexelSize;
+
+	// extrude the near plane toward the light so that it encloses the scene
+	float Extrusion = Radius;
+	for (const XMVECTOR& Corner : Params.SceneBoundingBox.GetCornerPointsV3())
+	{
+		const float CornerZ = XMVectorGetZ(XMVector3TransformCoord(Corner, matLightRotation));
+		Extrusion = std::max(Extrusion, CenterLS.z - CornerZ);
+	}
+	Extrusion = std::ceil(Extrusion);
+
+	const XMFLOAT3 EyeLS(CenterLS.x, CenterLS.y, CenterLS.z - Extrusion);
+	Cascade.matView     = matLightRotation * XMMatrixTranslation(-EyeLS.x, -EyeLS.y, -EyeLS.z);
+	Cascade.matProj     = XMMatrixOrthographicLH(2.0f * HalfExtent, 2.0f * HalfExtent, 0.0f, Extrusion + Radius);
+	Cascade.matViewProj = Cascade.matView * Cascade.matProj;
+
+	XMStoreFloat3(&Cascade.BoundingSphereCenter, XMVector3TransformCoord(XMLoadFloat3(&CenterLS), XMMatrixTranspose(matLightRotation)));
+	Cascade.BoundingSphereRadius = Radius;
+	Cascade.TexelSize = TexelSize;
+	return Cascade;
+}
+
+uint32 FitShadowCascades(const FCascadedShadowMapParameters& Params, FShadowCascade* pOutCascades)
+{
+	constexpr uint32 MAX_NUM_CASCADES = 16;
+	assert(Params.NumCascades > 0 && Params.NumCascades <= MAX_NUM_CASCADES);
+	const uint32 NumCascades = std::min(Params.NumCascades, MAX_NUM_CASCADES);
+
+	const float FarZ = std::min(Params.FarZ, Params.MaxShadowDistance);
+	if (FarZ <= Params.NearZ)
+		return 0;
+
+	float SplitDistances[MAX_NUM_CASCADES + 1];
+	CalculateCascadeSplitDistances(Params.NearZ, FarZ, NumCascades, Params.SplitLambda, SplitDistances);
+	for (uint32 i = 0; i < NumCascades; ++i)
+		pOutCascades[i] = FitShadowCascade(Params, SplitDistances[i], SplitDistances[i + 1]);
+	return NumCascades;
+}
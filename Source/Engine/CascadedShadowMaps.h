@@ -0,0 +1,70 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Culling.h"
+
+struct FShadowCascade
+{
+	DirectX::XMMATRIX matView;
+	DirectX::XMMATRIX matProj;
+	DirectX::XMMATRIX matViewProj;          // its frustum planes are the cascade's culling volume
+	DirectX::XMFLOAT3 BoundingSphereCenter; // world space, snapped to the shadow map texels
+	float             BoundingSphereRadius;
+	float             SplitNear;            // distances along the camera's forward axis
+	float             SplitFar;
+	float             TexelSize;            // world units
+};
+
+struct FCascadedShadowMapParameters
+{
+	// main view
+	DirectX::XMFLOAT3 CameraPosition;
+	DirectX::XMFLOAT3 CameraForward;
+	float NearZ;
+	float FarZ;
+	float FieldOfViewY; // radians
+	float AspectRatio;
+
+	// light
+	DirectX::XMFLOAT3 LightDirection;
+	FBoundingBox      SceneBoundingBox; // the near planes are extruded toward the light to enclose it
+
+	uint32 NumCascades         = 4;
+	uint32 ShadowMapResolution = 2048;
+	float  MaxShadowDistance   = 500.0f; // the last split is min(FarZ, MaxShadowDistance)
+	float  SplitLambda         = 0.8f;   // [0, 1] : uniform -> logarithmic split distribution
+};
+
+//
+// CASCADED SHADOW MAPS
+//
+// CPU side fitting of the directional light's shadow cascades.
+//
+// - The split distances blend the uniform and logarithmic distributions (practical split scheme).
+// - Each cascade is fit around the bounding sphere of its view frustum slice, which only depends on the
+//   split distances and the field of view: the cascade's extents don't change when the camera rotates.
+// - The sphere center is snapped to the shadow map texels in light space, so sub-texel camera motion
+//   moves the cascade by whole texels or not at all and the shadow edges don't shimmer.
+// - The near plane is pulled back toward the light until the scene bounds are enclosed, so the casters
+//   outside of the sphere still cast shadows into it.
+//
+void CalculateCascadeSplitDistances(float NearZ, float FarZ, uint32 NumCascades, float Lambda, float* pOutSplitDistances); // writes NumCascades + 1 distances
+void CalculateFrustumSliceBoundingSphere(float SplitNear, float SplitFar, float FieldOfViewY, float AspectRatio, float& OutCenterDistance, float& OutRadius);
+FShadowCascade FitShadowCascade(const FCascadedShadowMapParameters& Params, float SplitNear, float SplitFar);
+uint32         FitShadowCascades(const FCascadedShadowMapParameters& Params, FShadowCascade* pOutCascades); // returns the number of cascades written
@@ -0,0 +1,400 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "ClusteredLighting.h"
+
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+void LightClusterBinner::Initialize(uint32 NumClustersX, uint32 NumClustersY, uint32 NumClustersZ)
+{
+	assert(NumClustersX > 0 && NumClustersY > 0 && NumClustersZ > 0);
+	mNumClustersX = NumClustersX;
+	mNumClustersY = NumClustersY;
+	mNumClustersZ = NumClustersZ;
+
+	const size_t NumClusters = static_cast<size_t>(NumClustersX) * NumClustersY * NumClustersZ;
+	for (std::vector<float>* pArr : { &mMinX, &mMinY, &mMinZ, &mMaxX, &mMaxY, &mMaxZ, &mCenterX, &mCenterY, &mCenterZ, &mRadius })
+		pArr->assign(NumClusters + 3, 0.0f);
+	mPointCounts.assign(NumClusters, 0);
+	mSpotCounts.assign(NumClusters, 0);
+
+	mStats = {};
+	mStats.NumClusters = static_cast<uint32>(NumClusters);
+	mbClusterBoundsDirty = true;
+}
+
+void LightClusterBinner::Bin(
+	  const XMMATRIX& matView
+	, const XMMATRIX& matProj
+	, float NearZ
+	, float FarZ
+	, const std::vector<VQ_SHADER_DATA::PointLight>& PointLights
+	, const std::vector<VQ_SHADER_DATA::SpotLight>&  SpotLights
+	, FLightClusterGrid& OutGrid
+)
+{
+	assert(mNumClustersX > 0); // Initialize() not called
+	assert(NearZ > 0.0f && FarZ > NearZ);
+	Timer t; t.Start();
+
+	XMFLOAT4X4 Proj;
+	XMStoreFloat4x4(&Proj, matProj);
+	if (mbClusterBoundsDirty || NearZ != mNearZ || FarZ != mFarZ || std::memcmp(&Proj, &mMatProj, sizeof(Proj)) != 0)
+	{
+		mMatProj = Proj;
+		BuildClusterBounds(matProj, NearZ, FarZ);
+		mbClusterBoundsDirty = false;
+	}
+
+	std::fill(mPointCounts.begin(), mPointCounts.end(), 0);
+	std::fill(mSpotCounts.begin(), mSpotCounts.end(), 0);
+	mPointAssignments.clear();
+	mSpotAssignments.clear();
+
+	FClusterRange Range;
+	for (uint32 i = 0; i < static_cast<uint32>(PointLights.size()); ++i)
+	{
+		const VQ_SHADER_DATA::PointLight& l = PointLights[i];
+
+		FSphere Sphere;
+		XMStoreFloat3(&Sphere.Center, XMVector3TransformCoord(XMLoadFloat3(&l.position), matView));
+		Sphere.Radius = l.range;
+
+		if (GetClusterRange(Sphere, Range))
+			BinSphere(Range, Sphere, i);
+	}
+
+	for (uint32 i = 0; i < static_cast<uint32>(SpotLights.size()); ++i)
+	{
+		const VQ_SHADER_DATA::SpotLight& l = SpotLights[i];
+
+		FCone Cone;
+		const XMVECTOR vOrigin    = XMVector3TransformCoord(XMLoadFloat3(&l.position), matView);
+		const XMVECTOR vDirection = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&l.spotDir), matView));
+		XMStoreFloat3(&Cone.Origin, vOrigin);
+		XMStoreFloat3(&Cone.Direction, vDirection);
+		Cone.Range    = l.range;
+		Cone.CosAngle = std::cos(l.outerConeAngle);
+		Cone.SinAngle = std::sin(l.outerConeAngle);
+
+		// tightest bounding sphere of the cone
+		float SphereOffset = 0.0f;
+		if (l.outerConeAngle >= XM_PIDIV2)
+		{
+			Cone.BoundingSphere.Radius = l.range;
+		}
+		else if (l.outerConeAngle > XM_PIDIV4)
+		{
+			SphereOffset = l.range * Cone.CosAngle;
+			Cone.BoundingSphere.Radius = l.range * Cone.SinAngle;
+		}
+		else
+		{
+			SphereOffset = l.range / (2.0f * Cone.CosAngle);
+			Cone.BoundingSphere.Radius = SphereOffset;
+		}
+		XMStoreFloat3(&Cone.BoundingSphere.Center, XMVectorAdd(vOrigin, XMVectorScale(vDirection, SphereOffset)));
+
+		if (GetClusterRange(Cone.BoundingSphere, Range))
+			BinCone(Range, Cone, i);
+	}
+
+	Compact(OutGrid);
+
+	mStats.NumPointLights = static_cast<uint32>(PointLights.size());
+	mStats.NumSpotLights  = static_cast<uint32>(SpotLights.size());
+	mStats.BinningTimeMs  = t.Tick() * 1000.0f;
+}
+
+void LightClusterBinner::BuildClusterBounds(const XMMATRIX& matProj, float NearZ, float FarZ)
+{
+	mNearZ = NearZ;
+	mFarZ  = FarZ;
+
+	// slice k covers [Near * (Far/Near)^(k/N), Near * (Far/Near)^((k+1)/N)]
+	const float LogFarOverNear = std::log(FarZ / NearZ);
+	mSliceScale = mNumClustersZ / LogFarOverNear;
+	mSliceBias  = -(mNumClustersZ * std::log(NearZ)) / LogFarOverNear;
+
+	std::vector<float> SliceDepths(mNumClustersZ + 1);
+	for (uint32 z = 0; z <= mNumClustersZ; ++z)
+		SliceDepths[z] = NearZ * std::pow(FarZ / NearZ, static_cast<float>(z) / mNumClustersZ);
+
+	const XMMATRIX matProjInverse = XMMatrixInverse(nullptr, matProj);
+	const uint32 NumClustersXY = mNumClustersX * mNumClustersY;
+
+	for (uint32 y = 0; y < mNumClustersY; ++y)
+	for (uint32 x = 0; x < mNumClustersX; ++x)
+	{
+		// the tile's corner rays in view space, as segments between the near & far planes
+		XMFLOAT3 CornersNear[4];
+		XMFLOAT3 CornersFar[4];
+		for (uint32 c = 0; c < 4; ++c)
+		{
+			const float NDCX = -1.0f + 2.0f * static_cast<float>(x + (c & 1)) / mNumClustersX;
+			const float NDCY =  1.0f - 2.0f * static_cast<float>(y + (c >> 1)) / mNumClustersY;
+			XMStoreFloat3(&CornersNear[c], XMVector3TransformCoord(XMVectorSet(NDCX, NDCY, 0.0f, 1.0f), matProjInverse));
+			XMStoreFloat3(&CornersFar[c] , XMVector3TransformCoord(XMVectorSet(NDCX, NDCY, 1.0f, 1.0f), matProjInverse));
+		}
+
+		for (uint32 z = 0; z < mNumClustersZ; ++z)
+		{
+			XMVECTOR vMin = XMVectorReplicate( FLT_MAX);
+			XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+			for (uint32 c = 0; c < 4; ++c)
+			{
+				const XMVECTOR vNear = XMLoadFloat3(&CornersNear[c]);
+				const XMVECTOR vFar  = XMLoadFloat3(&CornersFar[c]);
+				const float DepthRange = CornersFar[c].z - CornersNear[c].z;
+				for (uint32 s = 0; s < 2; ++s)
+				{
+					const float T = (SliceDepths[z + s] - CornersNear[c].z) / DepthRange;
+					const XMVECTOR vCorner = XMVectorLerp(vNear, vFar, T);
+					vMin = XMVectorMin(vMin, vCorner);
+					vMax = XMVectorMax(vMax, vCorner);
+				}
+			}
+
+			XMFLOAT3 f3Min, f3Max, f3Center;
+			XMStoreFloat3(&f3Min, vMin);
+			XMStoreFloat3(&f3Max, vMax);
+			XMStoreFloat3(&f3Center, XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+
+			const uint32 i = x + y * mNumClustersX + z * NumClustersXY;
+			mMinX[i] = f3Min.x; mMinY[i] = f3Min.y; mMinZ[i] = f3Min.z;
+			mMaxX[i] = f3Max.x; mMaxY[i] = f3Max.y; mMaxZ[i] = f3Max.z;
+			mCenterX[i] = f3Center.x; mCenterY[i] = f3Center.y; mCenterZ[i] = f3Center.z;
+			mRadius[i] = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(vMax, vMin)));
+		}
+	}
+}
+
+uint32 LightClusterBinner::GetSlice(float ViewSpaceDepth) const
+{
+	const int Slice = static_cast<int>(std::floor(std::log(ViewSpaceDepth) * mSliceScale + mSliceBias));
+	return static_cast<uint32>(std::clamp(Slice, 0, static_cast<int>(mNumClustersZ) - 1));
+}
+
+bool LightClusterBinner::GetClusterRange(const FSphere& Sphere, FClusterRange& Range) const
+{
+	const XMFLOAT3& C = Sphere.Center;
+	const float     R = Sphere.Radius;
+	const float MinDepth = C.z - R;
+	const float MaxDepth = C.z + R;
+	if (MaxDepth < mNearZ || MinDepth > mFarZ)
+		return false;
+
+	const bool bCrossesNearPlane = MinDepth <= mNearZ;
+	Range.z0 = bCrossesNearPlane ? 0 : GetSlice(MinDepth);
+	Range.z1 = GetSlice(std::min(MaxDepth, mFarZ));
+
+	if (bCrossesNearPlane)
+	{
+		Range.x0 = 0; Range.x1 = mNumClustersX - 1;
+		Range.y0 = 0; Range.y1 = mNumClustersY - 1;
+		return true;
+	}
+
+	// project the corners of the sphere's view space AABB, all of them are in front of the near plane
+	const XMMATRIX matProj = XMLoadFloat4x4(&mMatProj);
+	float NDCMinX =  FLT_MAX, NDCMinY =  FLT_MAX;
+	float NDCMaxX = -FLT_MAX, NDCMaxY = -FLT_MAX;
+	for (uint32 c = 0; c < 8; ++c)
+	{
+		const XMVECTOR vCorner = XMVectorSet(
+			  (c & 1) ? C.x + R : C.x - R
+			, (c & 2) ? C.y + R : C.y - R
+			, (c & 4) ? C.z + R : C.z - R
+			, 1.0f
+		);
+		XMFLOAT3 NDC;
+		XMStoreFloat3(&NDC, XMVector3TransformCoord(vCorner, matProj));
+		NDCMinX = std::min(NDCMinX, NDC.x); NDCMaxX = std::max(NDCMaxX, NDC.x);
+		NDCMinY = std::min(NDCMinY, NDC.y); NDCMaxY = std::max(NDCMaxY, NDC.y);
+	}
+	if (NDCMaxX < -1.0f || NDCMinX > 1.0f || NDCMaxY < -1.0f || NDCMinY > 1.0f)
+		return false;
+
+	auto fnTile = [](float ScreenUV, uint32 NumTiles) -> uint32
+	{
+		const int Tile = static_cast<int>(std::floor(std::clamp(ScreenUV, 0.0f, 1.0f) * NumTiles));
+		return static_cast<uint32>(std::min(Tile, static_cast<int>(NumTiles) - 1));
+	};
+	Range.x0 = fnTile(NDCMinX * 0.5f + 0.5f, mNumClustersX);
+	Range.x1 = fnTile(NDCMaxX * 0.5f + 0.5f, mNumClustersX);
+	Range.y0 = fnTile(0.5f - NDCMaxY * 0.5f, mNumClustersY); // screen y points down
+	Range.y1 = fnTile(0.5f - NDCMinY * 0.5f, mNumClustersY);
+	return true;
+}
+
+static inline int GetLaneMask(uint32 NumRemainingClusters)
+{
+	return NumRemainingClusters >= 4 ? 0xF : ((1 << NumRemainingClusters) - 1);
+}
+
+void LightClusterBinner::AppendAssignments(int LaneMask, uint32 iFirstCluster, uint32 LightIndex, std::vector<uint32>& Counts, std::vector<FAssignment>& Assignments)
+{
+	for (uint32 Lane = 0; Lane < 4; ++Lane)
+	{
+		if (!(LaneMask & (1 << Lane)))
+			continue;
+		const uint32 iCluster = iFirstCluster + Lane;
+		if (Counts[iCluster] == MAX_LIGHTS_PER_CLUSTER)
+			continue;
+		++Counts[iCluster];
+		Assignments.push_back({ iCluster, LightIndex });
+	}
+}
+
+__m128 LightClusterBinner::GetClusterAABBDistanceSq(uint32 i, __m128 CX, __m128 CY, __m128 CZ) const
+{
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 DX = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinX[i]), CX), Zero), _mm_max_ps(_mm_sub_ps(CX, _mm_loadu_ps(&mMaxX[i])), Zero));
+	const __m128 DY = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinY[i]), CY), Zero), _mm_max_ps(_mm_sub_ps(CY, _mm_loadu_ps(&mMaxY[i])), Zero));
+	const __m128 DZ = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinZ[i]), CZ), Zero), _mm_max_ps(_mm_sub_ps(CZ, _mm_loadu_ps(&mMaxZ[i])), Zero));
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ));
+}
+
+void LightClusterBinner::BinSphere(const FClusterRange& Range, const FSphere& Sphere, uint32 LightIndex)
+{
+	const __m128 CX = _mm_set1_ps(Sphere.Center.x);
+	const __m128 CY = _mm_set1_ps(Sphere.Center.y);
+	const __m128 CZ = _mm_set1_ps(Sphere.Center.z);
+	const __m128 RadiusSq = _mm_set1_ps(Sphere.Radius * Sphere.Radius);
+	const uint32 NumClustersXY = mNumClustersX * mNumClustersY;
+
+	for (uint32 z = Range.z0; z <= Range.z1; ++z)
+	for (uint32 y = Range.y0; y <= Range.y1; ++y)
+	{
+		const uint32 iRow = y * mNumClustersX + z * NumClustersXY;
+		for (uint32 x = Range.x0; x <= Range.x1; x += 4)
+		{
+			const uint32 i = iRow + x;
+			const __m128 DistSq = GetClusterAABBDistanceSq(i, CX, CY, CZ);
+			const int Mask = _mm_movemask_ps(_mm_cmple_ps(DistSq, RadiusSq)) & GetLaneMask(Range.x1 - x + 1);
+			if (Mask)
+				AppendAssignments(Mask, i, LightIndex, mPointCounts, mPointAssignments);
+		}
+	}
+}
+
+void LightClusterBinner::BinCone(const FClusterRange& Range, const FCone& Cone, uint32 LightIndex)
+{
+	const __m128 CX = _mm_set1_ps(Cone.BoundingSphere.Center.x);
+	const __m128 CY = _mm_set1_ps(Cone.BoundingSphere.Center.y);
+	const __m128 CZ = _mm_set1_ps(Cone.BoundingSphere.Center.z);
+	const __m128 RadiusSq = _mm_set1_ps(Cone.BoundingSphere.Radius * Cone.BoundingSphere.Radius);
+	const __m128 OX = _mm_set1_ps(Cone.Origin.x);
+	const __m128 OY = _mm_set1_ps(Cone.Origin.y);
+	const __m128 OZ = _mm_set1_ps(Cone.Origin.z);
+	const __m128 DX = _mm_set1_ps(Cone.Direction.x);
+	const __m128 DY = _mm_set1_ps(Cone.Direction.y);
+	const __m128 DZ = _mm_set1_ps(Cone.Direction.z);
+	const __m128 CosAngle  = _mm_set1_ps(Cone.CosAngle);
+	const __m128 SinAngle  = _mm_set1_ps(Cone.SinAngle);
+	const __m128 ConeRange = _mm_set1_ps(Cone.Range);
+	const __m128 Zero = _mm_setzero_ps();
+	const uint32 NumClustersXY = mNumClustersX * mNumClustersY;
+
+	for (uint32 z = Range.z0; z <= Range.z1; ++z)
+	for (uint32 y = Range.y0; y <= Range.y1; ++y)
+	{
+		const uint32 iRow = y * mNumClustersX + z * NumClustersXY;
+		for (uint32 x = Range.x0; x <= Range.x1; x += 4)
+		{
+			const uint32 i = iRow + x;
+
+			// cone bounding sphere vs cluster AABB
+			const __m128 DistSq = GetClusterAABBDistanceSq(i, CX, CY, CZ);
+			const __m128 bSphere = _mm_cmple_ps(DistSq, RadiusSq);
+
+			// cone vs cluster bounding sphere: distance from the sphere center to the cone surface,
+			// and the sphere being behind the origin or beyond the range
+			const __m128 VX = _mm_sub_ps(_mm_loadu_ps(&mCenterX[i]), OX);
+			const __m128 VY = _mm_sub_ps(_mm_loadu_ps(&mCenterY[i]), OY);
+			const __m128 VZ = _mm_sub_ps(_mm_loadu_ps(&mCenterZ[i]), OZ);
+			const __m128 R  = _mm_loadu_ps(&mRadius[i]);
+			const __m128 LenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(VX, VX), _mm_mul_ps(VY, VY)), _mm_mul_ps(VZ, VZ));
+			const __m128 V1Len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(VX, DX), _mm_mul_ps(VY, DY)), _mm_mul_ps(VZ, DZ));
+			const __m128 DistToCone = _mm_sub_ps(
+				  _mm_mul_ps(CosAngle, _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(LenSq, _mm_mul_ps(V1Len, V1Len)), Zero)))
+				, _mm_mul_ps(V1Len, SinAngle)
+			);
+			const __m128 bCone = _mm_and_ps(
+				  _mm_cmple_ps(DistToCone, R)
+				, _mm_and_ps(_mm_cmple_ps(V1Len, _mm_add_ps(R, ConeRange)), _mm_cmpge_ps(V1Len, _mm_sub_ps(Zero, R)))
+			);
+
+			const int Mask = _mm_movemask_ps(_mm_and_ps(bSphere, bCone)) & GetLaneMask(Range.x1 - x + 1);
+			if (Mask)
+				AppendAssignments(Mask, i, LightIndex, mSpotCounts, mSpotAssignments);
+		}
+	}
+}
+
+void LightClusterBinner::Compact(FLightClusterGrid& OutGrid)
+{
+	const uint32 NumClusters = mNumClustersX * mNumClustersY * mNumClustersZ;
+	OutGrid.NumClustersX = mNumClustersX;
+	OutGrid.NumClustersY = mNumClustersY;
+	OutGrid.NumClustersZ = mNumClustersZ;
+	OutGrid.SliceScale   = mSliceScale;
+	OutGrid.SliceBias    = mSliceBias;
+	OutGrid.Clusters.resize(NumClusters);
+
+	// prefix sum of the counts
+	uint32 Offset = 0;
+	mStats.NumOccupiedClusters = 0;
+	mStats.MaxLightsPerCluster = 0;
+	for (uint32 i = 0; i < NumClusters; ++i)
+	{
+		const uint32 NumLights = mPointCounts[i] + mSpotCounts[i];
+		OutGrid.Clusters[i].LightIndexOffset = Offset;
+		OutGrid.Clusters[i].LightCounts = mPointCounts[i] | (mSpotCounts[i] << 16);
+		Offset += NumLights;
+
+		mStats.NumOccupiedClusters += NumLights > 0 ? 1 : 0;
+		mStats.MaxLightsPerCluster = std::max(mStats.MaxLightsPerCluster, NumLights);
+	}
+	mStats.NumLightIndices = Offset;
+	mStats.AvgLightsPerOccupiedCluster = mStats.NumOccupiedClusters > 0 ? static_cast<float>(Offset) / mStats.NumOccupiedClusters : 0.0f;
+
+	// scatter: the assignments are in light order, walking them backwards while counting down
+	// keeps each cluster's light indices sorted. Counts end up at 0, ready for the next frame.
+	OutGrid.LightIndices.resize(Offset);
+	for (auto it = mPointAssignments.rbegin(); it != mPointAssignments.rend(); ++it)
+	{
+		const FLightCluster& c = OutGrid.Clusters[it->Cluster];
+		OutGrid.LightIndices[c.LightIndexOffset + --mPointCounts[it->Cluster]] = it->Light;
+	}
+	for (auto it = mSpotAssignments.rbegin(); it != mSpotAssignments.rend(); ++it)
+	{
+		const FLightCluster& c = OutGrid.Clusters[it->Cluster];
+		OutGrid.LightIndices[c.LightIndexOffset + (c.LightCounts & 0xFFFF) + --mSpotCounts[it->Cluster]] = it->Light;
+	}
+}
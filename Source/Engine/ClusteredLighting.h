@@ -0,0 +1,145 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+#include "Shaders/LightingConstantBufferData.h"
+
+#include <vector>
+
+struct FLightCluster
+{
+	uint32 LightIndexOffset;
+	uint32 LightCounts; // [0-15]: point lights, [16-31]: spot lights
+};
+
+// Output of the light binning, laid out the way ForwardLighting.hlsl reads it:
+// clusters are indexed with x + y * NumClustersX + z * NumClustersX * NumClustersY where
+// y=0 is the top row of the screen, and each cluster's point light indices are followed
+// by its spot light indices in the light index list.
+struct FLightClusterGrid
+{
+	uint32 NumClustersX = 0;
+	uint32 NumClustersY = 0;
+	uint32 NumClustersZ = 0;
+	float  SliceScale   = 0.0f; // slice = log(ViewSpaceDepth) * SliceScale + SliceBias
+	float  SliceBias    = 0.0f;
+
+	std::vector<FLightCluster> Clusters;
+	std::vector<uint32>        LightIndices;
+};
+
+//
+// LIGHT CLUSTER BINNER
+//
+// Clustered light assignment on the CPU: the view frustum is divided into a froxel grid of
+// screen tiles and exponentially distributed depth slices, and each light is tested against
+// the clusters its screen/depth bounds overlap, 4 clusters at a time w/ SSE.
+//
+// - Point lights are tested as spheres against the cluster AABBs.
+// - Spot lights are tested w/ the bounding sphere of the cone against the cluster AABBs, and
+//   the cone against the bounding spheres of the clusters.
+// - Assignments are compacted with a counting sort, so the number of lights per cluster is
+//   only limited by the 16-bit count packing, not by a global light budget.
+//
+class LightClusterBinner
+{
+public:
+	static constexpr uint32 DEFAULT_NUM_CLUSTERS_X = 16;
+	static constexpr uint32 DEFAULT_NUM_CLUSTERS_Y = 9;
+	static constexpr uint32 DEFAULT_NUM_CLUSTERS_Z = 24;
+	static constexpr uint32 MAX_LIGHTS_PER_CLUSTER = 0xFFFF; // per light type
+
+	struct FStatistics
+	{
+		uint32 NumClusters                 = 0;
+		uint32 NumOccupiedClusters         = 0;
+		uint32 NumPointLights              = 0;
+		uint32 NumSpotLights               = 0;
+		uint32 NumLightIndices             = 0;
+		uint32 MaxLightsPerCluster         = 0;
+		float  AvgLightsPerOccupiedCluster = 0.0f;
+		float  BinningTimeMs               = 0.0f;
+	};
+
+public:
+	void Initialize(uint32 NumClustersX = DEFAULT_NUM_CLUSTERS_X, uint32 NumClustersY = DEFAULT_NUM_CLUSTERS_Y, uint32 NumClustersZ = DEFAULT_NUM_CLUSTERS_Z);
+
+	// Lights are in world space. The cluster bounds are rebuilt when the projection changes.
+	void Bin(
+		  const DirectX::XMMATRIX& matView
+		, const DirectX::XMMATRIX& matProj
+		, float NearZ
+		, float FarZ
+		, const std::vector<VQ_SHADER_DATA::PointLight>& PointLights
+		, const std::vector<VQ_SHADER_DATA::SpotLight>&  SpotLights
+		, FLightClusterGrid& OutGrid
+	);
+
+	inline const FStatistics& GetStatistics() const { return mStats; }
+
+private:
+	struct FClusterRange { uint32 x0, x1, y0, y1, z0, z1; };
+	struct FAssignment   { uint32 Cluster, Light; };
+	struct FSphere       { DirectX::XMFLOAT3 Center; float Radius; };
+	struct FCone
+	{
+		DirectX::XMFLOAT3 Origin;
+		DirectX::XMFLOAT3 Direction;
+		float Range;
+		float CosAngle;
+		float SinAngle;
+		FSphere BoundingSphere;
+	};
+
+	void   BuildClusterBounds(const DirectX::XMMATRIX& matProj, float NearZ, float FarZ);
+	uint32 GetSlice(float ViewSpaceDepth) const;
+	bool   GetClusterRange(const FSphere& ViewSpaceSphere, FClusterRange& Range) const;
+	void   BinSphere(const FClusterRange& Range, const FSphere& Sphere, uint32 LightIndex);
+	void   BinCone(const FClusterRange& Range, const FCone& Cone, uint32 LightIndex);
+	void   Compact(FLightClusterGrid& OutGrid);
+
+	// squared distances between a point and the AABBs of the 4 clusters starting at i
+	__m128 GetClusterAABBDistanceSq(uint32 i, __m128 CX, __m128 CY, __m128 CZ) const;
+
+	static void AppendAssignments(int LaneMask, uint32 iFirstCluster, uint32 LightIndex, std::vector<uint32>& Counts, std::vector<FAssignment>& Assignments);
+
+private:
+	uint32 mNumClustersX = 0;
+	uint32 mNumClustersY = 0;
+	uint32 mNumClustersZ = 0;
+	float  mNearZ = 0.0f;
+	float  mFarZ  = 0.0f;
+	float  mSliceScale = 0.0f;
+	float  mSliceBias  = 0.0f;
+	DirectX::XMFLOAT4X4 mMatProj = {};
+	bool   mbClusterBoundsDirty = true;
+
+	// view space cluster bounds, SoA & padded by 3 so that the last row can be read 4-wide
+	std::vector<float> mMinX, mMinY, mMinZ;
+	std::vector<float> mMaxX, mMaxY, mMaxZ;
+	std::vector<float> mCenterX, mCenterY, mCenterZ, mRadius;
+
+	// scratch
+	std::vector<uint32>      mPointCounts;
+	std::vector<uint32>      mSpotCounts;
+	std::vector<FAssignment> mPointAssignments;
+	std::vector<FAssignment> mSpotAssignments;
+
+	FStatistics mStats;
+};
@@ -0,0 +1,192 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "CommandRecordingScheduler.h"
+
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void CommandRecordingScheduler::Schedule(const std::vector<FRecordingWorkItem>& WorkItems, uint32 MaxNumCommandLists, const FCommandRecordingCostModel& CostModel)
+{
+	Timer t; t.Start();
+	assert(MaxNumCommandLists > 0);
+	assert(CostModel.CostPerChunk > 0.0f);
+
+	mCostModel = CostModel;
+	mWorkItems = WorkItems;
+	mChunks.clear();
+	mCommandLists.clear();
+	mStats = {};
+
+	if (mWorkItems.empty())
+		return;
+
+	float TotalCost = 0.0f;
+	for (const FRecordingWorkItem& Item : mWorkItems)
+	{
+		assert(Item.iDrawBegin <= Item.iDrawEnd);
+		TotalCost += GetChunkCost(Item.iDrawEnd - Item.iDrawBegin);
+	}
+
+	// don't spread light frames over more command lists than it's worth
+	const uint32 NumCommandLists = std::clamp(static_cast<uint32>(TotalCost / std::max(mCostModel.MinCostPerCommandList, 1.0f)), 1u, MaxNumCommandLists);
+	const float TargetChunkCost = TotalCost / (NumCommandLists * std::max(mCostModel.NumChunksPerCommandList, 1u));
+
+	std::vector<FRecordingChunk> Chunks;
+	SplitWorkItems(TargetChunkCost, Chunks);
+	PartitionChunks(Chunks, NumCommandLists);
+
+	mStats.NumWorkItems    = static_cast<uint32>(mWorkItems.size());
+	mStats.NumChunks       = static_cast<uint32>(mChunks.size());
+	mStats.NumCommandLists = static_cast<uint32>(mCommandLists.size());
+	for (const FCommandListRecording& CmdList : mCommandLists)
+	{
+		mStats.TotalCost += CmdList.Cost;
+		mStats.MaxCommandListCost = std::max(mStats.MaxCommandListCost, CmdList.Cost);
+	}
+	mStats.Imbalance = mStats.MaxCommandListCost / (mStats.TotalCost / mStats.NumCommandLists);
+	mStats.SchedulingTimeMs = t.Tick() * 1000.0f;
+}
+
+void CommandRecordingScheduler::RecordCommandList(FCommandRecorder& Recorder, uint32 iCommandList) const
+{
+	assert(iCommandList < mCommandLists.size());
+	const FCommandListRecording& CmdList = mCommandLists[iCommandList];
+	for (uint32 iChunk = CmdList.iChunkBegin; iChunk < CmdList.iChunkEnd; ++iChunk)
+	{
+		const FRecordingChunk& Chunk = mChunks[iChunk];
+		Recorder.RecordChunk(iCommandList, mWorkItems[Chunk.iWorkItem], Chunk.iDrawBegin, Chunk.iDrawEnd);
+	}
+}
+
+float CommandRecordingScheduler::GetChunkCost(uint32 NumDraws) const
+{
+	return mCostModel.CostPerChunk + NumDraws * mCostModel.CostPerDraw;
+}
+
+void CommandRecordingScheduler::SplitWorkItems(float TargetChunkCost, std::vector<FRecordingChunk>& OutChunks) const
+{
+	for (uint32 iItem = 0; iItem < mWorkItems.size(); ++iItem)
+	{
+		const FRecordingWorkItem& Item = mWorkItems[iItem];
+		const uint32 NumDraws = Item.iDrawEnd - Item.iDrawBegin;
+
+		uint32 NumSplits = 1;
+		if (Item.bSplittable && NumDraws > 0 && TargetChunkCost > 0.0f)
+		{
+			NumSplits = static_cast<uint32>(std::ceil(GetChunkCost(NumDraws) / TargetChunkCost));
+			NumSplits = std::min(NumSplits, NumDraws / std::max(mCostModel.MinDrawsPerChunk, 1u));
+			NumSplits = std::max(NumSplits, 1u);
+		}
+
+		// the remainder is distributed so the chunk sizes differ by at most 1 draw
+		for (uint32 iSplit = 0; iSplit < NumSplits; ++iSplit)
+		{
+			FRecordingChunk Chunk;
+			Chunk.iWorkItem  = iItem;
+			Chunk.iDrawBegin = Item.iDrawBegin + static_cast<uint32>((static_cast<uint64>(NumDraws) * iSplit) / NumSplits);
+			Chunk.iDrawEnd   = Item.iDrawBegin + static_cast<uint32>((static_cast<uint64>(NumDraws) * (iSplit + 1)) / NumSplits);
+			Chunk.Cost       = GetChunkCost(Chunk.iDrawEnd - Chunk.iDrawBegin);
+			OutChunks.push_back(Chunk);
+		}
+	}
+}
+
+void CommandRecordingScheduler::PartitionChunks(const std::vector<FRecordingChunk>& Chunks, uint32 NumCommandLists)
+{
+	assert(!Chunks.empty());
+
+	// number of contiguous command lists needed to record the chunks w/o exceeding the capacity
+	auto fnCountCommandLists = [&Chunks](float Capacity)
+	{
+		uint32 NumLists = 1;
+		float ListCost = 0.0f;
+		for (const FRecordingChunk& Chunk : Chunks)
+		{
+			if (ListCost > 0.0f && ListCost + Chunk.Cost > Capacity)
+			{
+				++NumLists;
+				ListCost = 0.0f;
+			}
+			ListCost += Chunk.Cost;
+		}
+		return NumLists;
+	};
+
+	// binary search the smallest capacity that fits in NumCommandLists
+	float CapacityLo = 0.0f;
+	float CapacityHi = 0.0f;
+	for (const FRecordingChunk& Chunk : Chunks)
+	{
+		CapacityLo = std::max(CapacityLo, Chunk.Cost);
+		CapacityHi += Chunk.Cost;
+	}
+	float Capacity = CapacityHi;
+	if (fnCountCommandLists(CapacityLo) <= NumCommandLists)
+	{
+		Capacity = CapacityLo;
+	}
+	else
+	{
+		constexpr int NUM_SEARCH_ITERATIONS = 32;
+		for (int i = 0; i < NUM_SEARCH_ITERATIONS; ++i)
+		{
+			const float Mid = 0.5f * (CapacityLo + CapacityHi);
+			if (fnCountCommandLists(Mid) <= NumCommandLists) CapacityHi = Mid;
+			else                                              CapacityLo = Mid;
+		}
+		Capacity = CapacityHi;
+	}
+
+	// fill the command lists, merging the consecutive chunks of the same work item
+	float ListCost = 0.0f;
+	for (const FRecordingChunk& Chunk : Chunks)
+	{
+		const bool bNewCommandList = mCommandLists.empty() || (ListCost > 0.0f && ListCost + Chunk.Cost > Capacity);
+		if (bNewCommandList)
+		{
+			FCommandListRecording& CmdList = mCommandLists.emplace_back();
+			CmdList.iChunkBegin = CmdList.iChunkEnd = static_cast<uint32>(mChunks.size());
+			ListCost = 0.0f;
+		}
+		ListCost += Chunk.Cost;
+
+		FCommandListRecording& CmdList = mCommandLists.back();
+		const bool bMerge = CmdList.iChunkEnd > CmdList.iChunkBegin
+			&& mChunks.back().iWorkItem == Chunk.iWorkItem
+			&& mChunks.back().iDrawEnd  == Chunk.iDrawBegin;
+		if (bMerge)
+		{
+			FRecordingChunk& Merged = mChunks.back();
+			CmdList.Cost -= Merged.Cost;
+			Merged.iDrawEnd = Chunk.iDrawEnd;
+			Merged.Cost = GetChunkCost(Merged.iDrawEnd - Merged.iDrawBegin);
+			CmdList.Cost += Merged.Cost;
+		}
+		else
+		{
+			mChunks.push_back(Chunk);
+			CmdList.Cost += Chunk.Cost;
+			++CmdList.iChunkEnd;
+		}
+	}
+	assert(mCommandLists.size() <= NumCommandLists);
+}
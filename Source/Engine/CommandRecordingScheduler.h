@@ -0,0 +1,116 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <vector>
+
+// A pass over a view in submission order, e.g. the depth pre-pass of the main view or a shadow view.
+// The draws of a splittable item can be recorded across multiple command lists.
+struct FRecordingWorkItem
+{
+	uint32 PassID      = 0; // caller-defined, what to record
+	uint32 ViewIndex   = 0; // caller-defined, which view of the pass
+	uint32 iDrawBegin  = 0;
+	uint32 iDrawEnd    = 0;
+	bool   bSplittable = false;
+};
+struct FRecordingChunk
+{
+	uint32 iWorkItem  = 0;
+	uint32 iDrawBegin = 0;
+	uint32 iDrawEnd   = 0;
+	float  Cost       = 0.0f;
+};
+struct FCommandListRecording // consecutive chunks recorded into one command list
+{
+	uint32 iChunkBegin = 0;
+	uint32 iChunkEnd   = 0;
+	float  Cost        = 0.0f;
+};
+struct FCommandRecordingCostModel // costs are in units of a draw call
+{
+	float  CostPerChunk             = 32.0f;  // state setup, render target binding, barriers
+	float  CostPerDraw              = 1.0f;
+	float  MinCostPerCommandList    = 512.0f; // fewer command lists are used for light frames
+	uint32 NumChunksPerCommandList  = 4;      // split granularity, finer chunks balance better
+	uint32 MinDrawsPerChunk         = 64;
+};
+
+// Records a chunk of a work item into a command list. The renderer implements this with the
+// D3D12 command lists and VQETests with a mock command list.
+struct FCommandRecorder
+{
+	virtual void RecordChunk(uint32 iCommandList, const FRecordingWorkItem& WorkItem, uint32 iDrawBegin, uint32 iDrawEnd) = 0;
+};
+
+//
+// COMMAND RECORDING SCHEDULER
+//
+// Distributes a frame's command recording work over multiple command lists that are recorded
+// in parallel and submitted in order.
+//
+// - Splittable work items are split into chunks of nearly equal draw ranges, sized so each
+//   command list gets ~NumChunksPerCommandList chunks.
+// - The chunks are partitioned into contiguous ranges, one per command list, minimizing the
+//   most expensive command list. Contiguity keeps the GPU execution order of the draws
+//   identical to the single threaded recording when the command lists are submitted in order.
+// - Consecutive chunks of the same work item that end up in the same command list are merged.
+// - The first chunk of a work item starts at WorkItem.iDrawBegin and its last chunk ends at
+//   WorkItem.iDrawEnd, recorders use this to emit the pass prologue (clears, barriers) and
+//   epilogue (resolves) only once.
+//
+class CommandRecordingScheduler
+{
+public:
+	struct FStatistics
+	{
+		uint32 NumWorkItems        = 0;
+		uint32 NumChunks           = 0;
+		uint32 NumCommandLists     = 0;
+		float  TotalCost           = 0.0f;
+		float  MaxCommandListCost  = 0.0f;
+		float  Imbalance           = 0.0f; // max / avg command list cost, 1.0 is perfectly balanced
+		float  SchedulingTimeMs    = 0.0f;
+	};
+
+public:
+	void Schedule(const std::vector<FRecordingWorkItem>& WorkItems, uint32 MaxNumCommandLists, const FCommandRecordingCostModel& CostModel = {});
+
+	// Records the chunks of the command list in order, safe to call concurrently for different command lists
+	void RecordCommandList(FCommandRecorder& Recorder, uint32 iCommandList) const;
+
+	inline uint32                                     GetNumCommandLists() const { return static_cast<uint32>(mCommandLists.size()); }
+	inline const std::vector<FRecordingWorkItem>&     GetWorkItems()       const { return mWorkItems; }
+	inline const std::vector<FRecordingChunk>&        GetChunks()          const { return mChunks; }
+	inline const std::vector<FCommandListRecording>&  GetCommandLists()    const { return mCommandLists; }
+	inline const FStatistics&                         GetStatistics()      const { return mStats; }
+
+private:
+	float GetChunkCost(uint32 NumDraws) const;
+	void  SplitWorkItems(float TargetChunkCost, std::vector<FRecordingChunk>& OutChunks) const;
+	void  PartitionChunks(const std::vector<FRecordingChunk>& Chunks, uint32 NumCommandLists);
+
+private:
+	FCommandRecordingCostModel         mCostModel;
+	std::vector<FRecordingWorkItem>    mWorkItems;
+	std::vector<FRecordingChunk>       mChunks;
+	std::vector<FCommandListRecording> mCommandLists;
+	FStatistics                        mStats;
+};
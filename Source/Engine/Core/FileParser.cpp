@@ -17,202 +17,93 @@
 //	Contact: volkanilbeyli@gmail.com
 
 #include "../VQEngine.h"
+#include "SettingsRegistry.h"
 
 #include "Libs/VQUtils/Source/utils.h"
 #include "Libs/VQUtils/Libs/tinyxml2/tinyxml2.h"
 
 #include <fstream>
+#include <filesystem>
 #include <cassert>
 
 using namespace DirectX;
 
-static std::pair<std::string, std::string> ParseLineINI(const std::string& iniLine, bool* pbSectionTag)
+// settings files -----------------------------------------------
+static constexpr FSettingNamedValue DISPLAY_MODE_NAMES[] =
 {
-	assert(!iniLine.empty());
-	std::pair<std::string, std::string> SettingNameValuePair;
-
-	const bool bSectionTag = iniLine[0] == '[';
-	if(pbSectionTag) 
-		*pbSectionTag = bSectionTag;
-
-	if (bSectionTag)
-	{
-		auto vecSettingNameValue = StrUtil::split(iniLine.substr(1), ']');
-		SettingNameValuePair.first = vecSettingNameValue[0];
-	}
-	else
-	{
-		auto vecSettingNameValue = StrUtil::split(iniLine, '=');
-		assert(vecSettingNameValue.size() >= 2);
-		SettingNameValuePair.first = vecSettingNameValue[0];
-		SettingNameValuePair.second = vecSettingNameValue[1];
-	}
-
-	return SettingNameValuePair;
-}
-
-static std::unordered_map<std::string, EDisplayMode> S_LOOKUP_STR_TO_DISPLAYMODE =
-{
-	  //{ "Fullscreen"           , EDisplayMode::EXCLUSIVE_FULLSCREEN   }
+	  //{ "Fullscreen"         , EDisplayMode::EXCLUSIVE_FULLSCREEN   }
 	  { "Fullscreen"           , EDisplayMode::BORDERLESS_FULLSCREEN  }
 	, { "Borderless"           , EDisplayMode::BORDERLESS_FULLSCREEN  }
 	, { "BorderlessFullscreen" , EDisplayMode::BORDERLESS_FULLSCREEN  }
 	, { "BorderlessWindowed"   , EDisplayMode::BORDERLESS_FULLSCREEN  }
 	, { "Windowed"             , EDisplayMode::WINDOWED               }
 };
+static constexpr FSettingNamedValue MAX_FRAME_RATE_NAMES[] = // see Settings.h:FGraphicsSettings
+{
+	  { "Auto"                 , -1 }
+	, { "Automatic"            , -1 }
+	, { "Unlimited"            ,  0 }
+};
 
+#define ENGINE_SETTING(Section, Key, Alias, Field, OverrideFlag)                    VQ_SETTING(FStartupParameters, Section, Key, Alias, EngineSettings.Field, p.OverrideFlag = true)
+#define ENGINE_SETTING_NAMED(Section, Key, Alias, Field, NamedValues, OverrideFlag) VQ_SETTING_NAMED(FStartupParameters, Section, Key, Alias, EngineSettings.Field, NamedValues, p.OverrideFlag = true)
+static constexpr TSettingDesc<FStartupParameters> ENGINE_SETTINGS_SCHEMA[] =
+{
+	  ENGINE_SETTING      ("Graphics", "VSync"                      , nullptr , gfx.bVsync                  , bOverrideGFXSetting_bVSync)
+	, ENGINE_SETTING      ("Graphics", "RenderScale"                , nullptr , gfx.RenderScale             , bOverrideGFXSetting_RenderScale)
+	, ENGINE_SETTING      ("Graphics", "TripleBuffer"               , nullptr , gfx.bUseTripleBuffering     , bOverrideGFXSetting_bUseTripleBuffering)
+	, ENGINE_SETTING      ("Graphics", "AntiAliasing"               , "AA"    , gfx.bAntiAliasing           , bOverrideGFXSetting_bAA)
+	, ENGINE_SETTING_NAMED("Graphics", "MaxFrameRate"               , "MaxFPS", gfx.MaxFrameRate            , MAX_FRAME_RATE_NAMES, bOverrideGFXSetting_bMaxFrameRate)
+	, ENGINE_SETTING      ("Graphics", "EnvironmentMapResolution"   , nullptr , gfx.EnvironmentMapResolution, bOverrideGFXSetting_EnvironmentMapResolution)
+	, ENGINE_SETTING      ("Graphics", "Reflections"                , nullptr , gfx.Reflections             , bOverrideGFXSettings_Reflections)
+	, ENGINE_SETTING      ("Graphics", "TextureMemoryBudget"        , nullptr , gfx.TextureMemoryBudgetMB   , bOverrideGFXSetting_TextureMemoryBudgetMB)
+	, ENGINE_SETTING      ("Graphics", "HDR"                        , nullptr , WndMain.bEnableHDR          , bOverrideGFXSetting_bHDR)
+
+	, ENGINE_SETTING      ("Engine"  , "Width"                      , nullptr , WndMain.Width               , bOverrideENGSetting_MainWindowWidth)
+	, ENGINE_SETTING      ("Engine"  , "Height"                     , nullptr , WndMain.Height              , bOverrideENGSetting_MainWindowHeight)
+	, ENGINE_SETTING_NAMED("Engine"  , "DisplayMode"                , nullptr , WndMain.DisplayMode         , DISPLAY_MODE_NAMES, bOverrideENGSetting_bDisplayMode)
+	, ENGINE_SETTING      ("Engine"  , "PreferredDisplay"           , nullptr , WndMain.PreferredDisplay    , bOverrideENGSetting_PreferredDisplay)
+	, ENGINE_SETTING      ("Engine"  , "Scene"                      , nullptr , StartupScene                , bOverrideENGSetting_StartupScene)
+	, ENGINE_SETTING      ("Engine"  , "StreamAssets"               , nullptr , bStreamAssets               , bOverrideENGSetting_bStreamAssets)
+
+	, ENGINE_SETTING      ("Engine"  , "DebugWindow"                , nullptr , bShowDebugWindow            , bOverrideENGSetting_bDebugWindowEnable)
+	, ENGINE_SETTING      ("Engine"  , "DebugWindowWidth"           , nullptr , WndDebug.Width              , bOverrideENGSetting_DebugWindowWidth)
+	, ENGINE_SETTING      ("Engine"  , "DebugWindowHeight"          , nullptr , WndDebug.Height             , bOverrideENGSetting_DebugWindowHeight)
+	, ENGINE_SETTING_NAMED("Engine"  , "DebugWindowDisplayMode"     , nullptr , WndDebug.DisplayMode        , DISPLAY_MODE_NAMES, bOverrideENGSetting_DebugWindowDisplayMode)
+	, ENGINE_SETTING      ("Engine"  , "DebugWindowPreferredDisplay", nullptr , WndDebug.PreferredDisplay   , bOverrideENGSetting_DebugWindowPreferredDisplay)
+};
+#undef ENGINE_SETTING
+#undef ENGINE_SETTING_NAMED
 
+// each section of these files is a record, e.g. [VondelPark] for an environment map
+static constexpr TSettingDesc<FEnvironmentMapDescriptor> ENVIRONMENT_MAP_SCHEMA[] =
+{
+	  VQ_SETTING(FEnvironmentMapDescriptor, nullptr, "Path"  , nullptr, FilePath            , (void)0)
+	, VQ_SETTING(FEnvironmentMapDescriptor, nullptr, "MaxCLL", nullptr, MaxContentLightLevel, (void)0)
+};
+static constexpr TSettingDesc<FDisplayHDRProfile> HDR_PROFILE_SCHEMA[] =
+{
+	  VQ_SETTING(FDisplayHDRProfile, nullptr, "MinBrightness", nullptr, MinBrightness, (void)0)
+	, VQ_SETTING(FDisplayHDRProfile, nullptr, "MaxBrightness", nullptr, MaxBrightness, (void)0)
+};
 
 FStartupParameters VQEngine::ParseEngineSettingsFile()
 {
 	constexpr char* ENGINE_SETTINGS_FILE_NAME = "Data/EngineSettings.ini";
 	FStartupParameters params = {};
 
-	std::ifstream file(ENGINE_SETTINGS_FILE_NAME);
-	if (file.is_open())
+	INIFile file;
+	if (file.Open(ENGINE_SETTINGS_FILE_NAME))
 	{
-		std::string line;
-		std::string currSection;
-		bool bReadingSection = false;
-		while (std::getline(file, line))
-		{
-			if (line[0] == ';') continue; // skip comment lines
-			if (line == "") continue; // skip empty lines
-
-			const std::pair<std::string, std::string> SettingNameValuePair = ParseLineINI(line, &bReadingSection);
-			const std::string& SettingName  = SettingNameValuePair.first;
-			const std::string& SettingValue = SettingNameValuePair.second;
-
-			// Header sections;
-			if (bReadingSection)
-			{
-				currSection = SettingName;
-				continue;
-			}
-
-
-			// 
-			// Graphics
-			//
-			if (SettingName == "VSync")
-			{
-				params.bOverrideGFXSetting_bVSync = true;
-				params.EngineSettings.gfx.bVsync = StrUtil::ParseBool(SettingValue);
-			}
-			if (SettingName == "RenderScale")
-			{
-				params.bOverrideGFXSetting_RenderScale = true;
-				params.EngineSettings.gfx.RenderScale = StrUtil::ParseFloat(SettingValue);
-			}
-			if (SettingName == "TripleBuffer")
-			{
-				params.bOverrideGFXSetting_bUseTripleBuffering = true;
-				params.EngineSettings.gfx.bUseTripleBuffering = StrUtil::ParseBool(SettingValue);
-			}
-			if (SettingName == "AntiAliasing" || SettingName == "AA")
-			{
-				params.bOverrideGFXSetting_bAA = true;
-				params.EngineSettings.gfx.bAntiAliasing = StrUtil::ParseBool(SettingValue);
-			}
-			if (SettingName == "MaxFrameRate" || SettingName == "MaxFPS")
-			{
-				params.bOverrideGFXSetting_bMaxFrameRate = true;
-				if (SettingValue == "Unlimited" || SettingValue == "0")
-					params.EngineSettings.gfx.MaxFrameRate = 0;
-				else if (SettingValue == "Auto" || SettingValue == "Automatic" || SettingValue == "-1")
-					params.EngineSettings.gfx.MaxFrameRate = -1;
-				else
-					params.EngineSettings.gfx.MaxFrameRate = StrUtil::ParseInt(SettingValue);
-			}
-			if (SettingName == "EnvironmentMapResolution")
-			{
-				params.EngineSettings.gfx.EnvironmentMapResolution = StrUtil::ParseInt(SettingValue);
-				params.bOverrideGFXSetting_EnvironmentMapResolution = true;
-			}
-			if (SettingName == "Reflections")
-			{
-				params.bOverrideGFXSettings_Reflections = true;
-				params.EngineSettings.gfx.Reflections = static_cast<EReflections>(StrUtil::ParseInt(SettingValue));
-			}
-
-			// 
-			// Engine
-			//
-			if (SettingName == "Width")
-			{
-				params.bOverrideENGSetting_MainWindowWidth = true;
-				params.EngineSettings.WndMain.Width = StrUtil::ParseInt(SettingValue);
-			}
-			if (SettingName == "Height")
-			{
-				params.bOverrideENGSetting_MainWindowHeight = true;
-				params.EngineSettings.WndMain.Height = StrUtil::ParseInt(SettingValue);
-			}
-			if (SettingName == "DisplayMode")
-			{
-				if (S_LOOKUP_STR_TO_DISPLAYMODE.find(SettingValue) != S_LOOKUP_STR_TO_DISPLAYMODE.end())
-				{
-					params.bOverrideENGSetting_bDisplayMode = true;
-					params.EngineSettings.WndMain.DisplayMode = S_LOOKUP_STR_TO_DISPLAYMODE.at(SettingValue);
-				}
-			}
-			if (SettingName == "PreferredDisplay")
-			{
-				params.bOverrideENGSetting_PreferredDisplay = true;
-				params.EngineSettings.WndMain.PreferredDisplay = StrUtil::ParseInt(SettingValue);
-			}
-			if (SettingName == "HDR")
-			{
-				params.bOverrideGFXSetting_bHDR = true;
-				params.EngineSettings.WndMain.bEnableHDR = StrUtil::ParseBool(SettingValue);
-			}
-
-
-			if (SettingName == "DebugWindow")
-			{
-				params.bOverrideENGSetting_bDebugWindowEnable = true;
-				params.EngineSettings.bShowDebugWindow = StrUtil::ParseBool(SettingValue);
-			}
-			if (SettingName == "DebugWindowWidth")
-			{
-				params.bOverrideENGSetting_DebugWindowWidth = true;
-				params.EngineSettings.WndDebug.Width = StrUtil::ParseInt(SettingValue);
-			}
-			if (SettingName == "DebugWindowHeight")
-			{
-				params.bOverrideENGSetting_DebugWindowHeight = true;
-				params.EngineSettings.WndDebug.Height = StrUtil::ParseInt(SettingValue);
-			}
-			if (SettingName == "DebugWindowDisplayMode")
-			{
-				if (S_LOOKUP_STR_TO_DISPLAYMODE.find(SettingValue) != S_LOOKUP_STR_TO_DISPLAYMODE.end())
-				{
-					params.bOverrideENGSetting_DebugWindowDisplayMode = true;
-					params.EngineSettings.WndDebug.DisplayMode = S_LOOKUP_STR_TO_DISPLAYMODE.at(SettingValue);
-				}
-			}
-			if (SettingName == "DebugWindowPreferredDisplay")
-			{
-				params.bOverrideENGSetting_DebugWindowPreferredDisplay = true;
-				params.EngineSettings.WndDebug.PreferredDisplay = StrUtil::ParseInt(SettingValue);
-			}
-
-			if (SettingName == "Scene")
-			{
-				params.bOverrideENGSetting_StartupScene = true;
-				params.EngineSettings.StartupScene = SettingValue;
-			}
-			
-		}
+		for (const INIFile::FSection& Section : file.GetSections())
+			ApplySettingsSection(file, Section, ENGINE_SETTINGS_SCHEMA, params);
 	}
 	else
 	{
 		Log::Warning("Cannot find settings file %s in current directory: %s", ENGINE_SETTINGS_FILE_NAME, DirectoryUtil::GetCurrentPath().c_str());
-		Log::Warning("Will use default settings for Engine & Graphics.", ENGINE_SETTINGS_FILE_NAME, DirectoryUtil::GetCurrentPath().c_str());
+		Log::Warning("Will use default settings for Engine & Graphics.");
 	}
 
-	file.close();
-
 	return params;
 }
 
@@ -222,31 +113,19 @@ std::vector<std::pair<std::string, int>> VQEngine::ParseSceneIndexMappingFile()
 
 	std::vector<std::pair<std::string, int>> SceneIndexMappings;
 
-	std::ifstream file(SCENE_MAPPING_FILE_NAME);
-	if (file.is_open())
+	INIFile file;
+	if (file.Open(SCENE_MAPPING_FILE_NAME))
 	{
-		std::string line;
-		std::string currSection;
-		bool bReadingSection = false;
-		while (std::getline(file, line))
+		// keys are the scene names, no schema
+		for (const INIFile::FEntry& Entry : file.GetEntries())
 		{
-			if (line[0] == ';') continue; // skip comment lines
-			if (line == "") continue; // skip empty lines
-
-			const std::pair<std::string, std::string> SettingNameValuePair = ParseLineINI(line, &bReadingSection);
-			const std::string& SettingName = SettingNameValuePair.first;
-			const std::string& SettingValue = SettingNameValuePair.second;
-
-			// Header sections;
-			if (bReadingSection)
+			int SceneIndex = 0;
+			if (!ParseSettingValue(Entry.Value, SceneIndex, nullptr, 0))
 			{
-				currSection = SettingName;
+				ReportInvalidSettingValue(file, Entry, ESettingType::INT);
 				continue;
 			}
-
-			const int          SceneIndex = StrUtil::ParseInt(SettingValue);
-			const std::string& SceneName = SettingName;
-			SceneIndexMappings.push_back(std::make_pair(SceneName, SceneIndex));
+			SceneIndexMappings.push_back(std::make_pair(std::string(Entry.Key), SceneIndex));
 		}
 	}
 	else
@@ -266,52 +145,16 @@ std::vector<FEnvironmentMapDescriptor> VQEngine::ParseEnvironmentMapsFile()
 
 	std::vector<FEnvironmentMapDescriptor> EnvironmentMapDescriptors;
 
-	std::ifstream file(SETTINGS_FILE_NAME);
-	if (file.is_open())
+	INIFile file;
+	if (file.Open(SETTINGS_FILE_NAME))
 	{
-		std::string line;
-		bool bReadingSection = false;
-		bool bRecentlyReadEmptyLine = false;
-		bool bCurrentlyReadingEnvMap = false;
-		FEnvironmentMapDescriptor desc = {};
-		while (std::getline(file, line))
+		const std::vector<INIFile::FSection>& Sections = file.GetSections();
+		for (size_t iSection = 1; iSection < Sections.size(); ++iSection) // skip the unnamed section
 		{
-			if (line[0] == ';') continue; // skip comment lines
-			if (line == "") { bRecentlyReadEmptyLine = true; continue; } // skip empty lines
-
-			const std::pair<std::string, std::string> SettingNameValuePair = ParseLineINI(line, &bReadingSection);
-			const std::string& SettingName = SettingNameValuePair.first;
-			const std::string& SettingValue = SettingNameValuePair.second;
-
-			// Header sections;
-			if (bReadingSection)
-			{
-				bCurrentlyReadingEnvMap = true;
-				if (bRecentlyReadEmptyLine)
-				{
-					EnvironmentMapDescriptors.push_back(desc);
-					desc = {};
-					bRecentlyReadEmptyLine = false;
-				}
-				desc.Name = SettingName;
-				continue;
-			}
-
-			if (SettingName == "Path")
-			{
-				desc.FilePath = SettingValue;
-			}
-			if (SettingName == "MaxCLL")
-			{
-				desc.MaxContentLightLevel = StrUtil::ParseFloat(SettingValue);
-			}
-			bRecentlyReadEmptyLine = false;
-		}
-		if (bCurrentlyReadingEnvMap)
-		{
-			EnvironmentMapDescriptors.push_back(desc);
-			desc = {};
-			bCurrentlyReadingEnvMap = false;
+			FEnvironmentMapDescriptor desc = {};
+			desc.Name = Sections[iSection].Name;
+			ApplySettingsSection(file, Sections[iSection], ENVIRONMENT_MAP_SCHEMA, desc);
+			EnvironmentMapDescriptors.push_back(std::move(desc));
 		}
 	}
 	else
@@ -328,52 +171,16 @@ std::vector<FDisplayHDRProfile> VQEngine::ParseHDRProfilesFile()
 
 	std::vector<FDisplayHDRProfile> HDRProfiles;
 
-	std::ifstream file(SETTINGS_FILE_NAME);
-	if (file.is_open())
+	INIFile file;
+	if (file.Open(SETTINGS_FILE_NAME))
 	{
-		std::string line;
-		bool bReadingSection = false; // Section is an .ini term
-		bool bRecentlyReadEmptyLine = false;
-		bool bCurrentlyReadingProfile = false;
-		FDisplayHDRProfile profile = {};
-		while (std::getline(file, line))
+		const std::vector<INIFile::FSection>& Sections = file.GetSections();
+		for (size_t iSection = 1; iSection < Sections.size(); ++iSection) // skip the unnamed section
 		{
-			if (line[0] == ';') continue; // skip comment lines
-			if (line == "") { bRecentlyReadEmptyLine = true; continue; } // skip empty lines
-
-			const std::pair<std::string, std::string> SettingNameValuePair = ParseLineINI(line, &bReadingSection);
-			const std::string& SettingName = SettingNameValuePair.first;
-			const std::string& SettingValue = SettingNameValuePair.second;
-
-			// Header sections;
-			if (bReadingSection)
-			{
-				bCurrentlyReadingProfile = true;
-				if (bRecentlyReadEmptyLine)
-				{
-					HDRProfiles.push_back(profile);
-					profile = {};
-					bRecentlyReadEmptyLine = false;
-				}
-				profile.DisplayName = SettingName;
-				continue;
-			}
-
-			if (SettingName == "MaxBrightness")
-			{
-				profile.MaxBrightness = StrUtil::ParseFloat(SettingValue);
-			}
-			if (SettingName == "MinBrightness")
-			{
-				profile.MinBrightness = StrUtil::ParseFloat(SettingValue);
-			}
-			bRecentlyReadEmptyLine = false;
-		}
-		if (bCurrentlyReadingProfile) // Take into account the last item we're reading (.push_back() isn't called above for the last item)
-		{
-			HDRProfiles.push_back(profile);
-			profile = {};
-			bCurrentlyReadingProfile = false;
+			FDisplayHDRProfile profile = {};
+			profile.DisplayName = Sections[iSection].Name;
+			ApplySettingsSection(file, Sections[iSection], HDR_PROFILE_SCHEMA, profile);
+			HDRProfiles.push_back(std::move(profile));
 		}
 	}
 	else
@@ -460,7 +267,7 @@ static FMaterialRepresentation XMLParseMaterial(tinyxml2::XMLElement* pMat)
 	//------------------------------------------------------------------
 	if (pDiff) XMLParseFVecVal<XMFLOAT3>(pDiff, mat.DiffuseColor);
 	if (pAlph) XMLParseFloatVal(pAlph, mat.Alpha);
-	if (pEmsv) XMLParseFVecVal<XMFLOAT3>(pEmsI, mat.EmissiveColor);
+	if (pEmsv) XMLParseFVecVal<XMFLOAT3>(pEmsv, mat.EmissiveColor);
 	if (pEmsI) XMLParseFloatVal(pEmsI, mat.EmissiveIntensity);
 	if (pRgh ) XMLParseFloatVal(pRgh , mat.Roughness);
 	if (pMtl ) XMLParseFloatVal(pMtl , mat.Metalness);
@@ -476,17 +283,11 @@ static FMaterialRepresentation XMLParseMaterial(tinyxml2::XMLElement* pMat)
 	return mat;
 }
 
-unsigned GetNumSiblings(XMLElement* pEle)
+static unsigned GetNumValues(XMLElement* pEle)
 {
 	assert(pEle);
-	unsigned numSiblings = 0;
-	while (pEle != nullptr)
-	{
-		numSiblings += static_cast<int>(StrUtil::split(pEle->FirstChild()->Value()).size());
-		//++numSiblings;
-		pEle = pEle->NextSiblingElement();
-	}
-	return numSiblings;
+	tinyxml2::XMLNode* pNode = pEle->FirstChild();
+	return pNode ? static_cast<unsigned>(StrUtil::split(pNode->Value()).size()) : 0;
 }
 
 FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
@@ -512,7 +313,7 @@ FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
 		XMLElement* pQuat = pTransform->FirstChildElement("Quaternion");
 		XMLElement* pRot  = pTransform->FirstChildElement("Rotation");
 		XMLElement* pScl  = pTransform->FirstChildElement("Scale");
-		const uint NumScaleValues = pScl ? GetNumSiblings(pScl) : 0;
+		const uint NumScaleValues = pScl ? GetNumValues(pScl) : 0;
 		
 		if (pPos) XMLParseFVecVal<XMFLOAT3>(pPos, tf._position);
 		if (pScl)
@@ -520,7 +321,7 @@ FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
 			if (NumScaleValues == 3) XMLParseFVecVal<XMFLOAT3>(pScl, tf._scale);
 			else
 			{
-				float s; XMLParseFloatVal(pScl, s);
+				float s = 1.0f; XMLParseFloatVal(pScl, s);
 				tf._scale = DirectX::XMFLOAT3(s, s, s);
 			}
 		}
@@ -543,6 +344,7 @@ FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
 		FGameObjectRepresentation obj = {};
 		XMLElement* pTransform = pObj->FirstChildElement("Transform");
 		XMLElement* pModel     = pObj->FirstChildElement("Model");
+		XMLElement* pOccluder  = pObj->FirstChildElement("Occluder");
 
 		// Transform
 		if (pTransform)
@@ -564,6 +366,13 @@ FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
 			if (pModelName) XMLParseStringVal(pModelName, obj.ModelName);
 		}
 
+		// Occlusion culling
+		if (pOccluder)
+		{
+			std::string val; XMLParseStringVal(pOccluder, val);
+			obj.bOccluder = StrUtil::ParseBool(val);
+		}
+
 		return obj;
 	};
 	auto fnParseCamera    = [&](XMLElement* pCam) ->FCameraParameters
@@ -787,6 +596,29 @@ FSceneRepresentation VQEngine::ParseSceneFile(const std::string& SceneFile)
 	return SceneRep;
 }
 
+FSceneRepresentation VQEngine::LoadSceneFile(const std::string& SceneFile)
+{
+	FSceneRepresentation SceneRep = {};
+
+	// converted levels are read from the binary scene cache as long as the xml doesn't change
+	const std::string BinarySceneFilePath = BinarySceneFile::GetFilePath(SceneFile);
+	if (BinarySceneFile::IsUpToDate(BinarySceneFilePath, SceneFile) && BinarySceneFile::Read(BinarySceneFilePath, SceneRep))
+	{
+		return SceneRep;
+	}
+
+	if (!SceneStreamingParser::ParseFile(SceneFile, SceneRep))
+	{
+		Log::Warning("Falling back to the DOM parser for %s", SceneFile.c_str());
+		return VQEngine::ParseSceneFile(SceneFile);
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(BinarySceneFilePath).parent_path(), ec);
+	BinarySceneFile::Write(BinarySceneFilePath, SceneRep);
+	return SceneRep;
+}
+
 
 std::vector<FMaterialRepresentation> VQEngine::ParseMaterialFile(const std::string& MaterialFilePath)
 {
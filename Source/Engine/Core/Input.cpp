@@ -18,12 +18,14 @@
 #define NOMINMAX
 
 #include "Input.h"
+#include "Types.h"
 
 #include "Libs/VQUtils/Source/Log.h"
 #include "Libs/VQUtils/Source/Utils.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cctype>
 
 #define VERBOSE_LOGGING 0
 
@@ -71,6 +73,15 @@ static const Input::KeyMapping KEY_MAP = []()
 	return std::move(m);
 }();
 
+static constexpr size_t GetMouseButtonInputCode(Input::EMouseButtons mbtn)
+{
+	return NUM_MAX_KEYS + (mbtn == Input::EMouseButtons::MOUSE_BUTTON_LEFT ? 0 : (mbtn == Input::EMouseButtons::MOUSE_BUTTON_RIGHT ? 1 : 2));
+}
+static const std::array<Input::EMouseButtons, NUM_MOUSE_BUTTONS> MOUSE_BUTTONS = 
+{
+	Input::EMouseButtons::MOUSE_BUTTON_LEFT, Input::EMouseButtons::MOUSE_BUTTON_RIGHT, Input::EMouseButtons::MOUSE_BUTTON_MIDDLE
+};
+
 static constexpr bool IsMouseKey(WPARAM wparam)
 {
 	return wparam == Input::EMouseButtons::MOUSE_BUTTON_LEFT
@@ -83,6 +94,119 @@ static constexpr bool IsMouseKey(WPARAM wparam)
 }
 
 
+bool Input::GetInputCode(const std::string& KeyName, size_t& OutInputCode)
+{
+	if (KeyName == "MouseLeft")   { OutInputCode = GetMouseButtonInputCode(EMouseButtons::MOUSE_BUTTON_LEFT);   return true; }
+	if (KeyName == "MouseRight")  { OutInputCode = GetMouseButtonInputCode(EMouseButtons::MOUSE_BUTTON_RIGHT);  return true; }
+	if (KeyName == "MouseMiddle") { OutInputCode = GetMouseButtonInputCode(EMouseButtons::MOUSE_BUTTON_MIDDLE); return true; }
+
+	auto it = KEY_MAP.find(KeyName);
+	if (it != KEY_MAP.end())
+	{
+		OutInputCode = it->second;
+		return true;
+	}
+
+	// letters & digits that aren't in the key map: windows key codes match the uppercase ASCII
+	if (KeyName.size() == 1 && std::isalnum(static_cast<unsigned char>(KeyName[0])))
+	{
+		OutInputCode = static_cast<size_t>(std::toupper(static_cast<unsigned char>(KeyName[0])));
+		return true;
+	}
+	return false;
+}
+
+
+//
+// INPUT ACTION MAP
+//
+ActionID InputActionMap::RegisterAction(const std::string& ActionName, const std::vector<std::string>& Bindings)
+{
+	std::vector<FBinding> CompiledBindings(Bindings.size());
+	for (size_t i = 0; i < Bindings.size(); ++i)
+	{
+		if (!CompileBinding(Bindings[i], CompiledBindings[i]))
+		{
+			Log::Error("InputActionMap: couldn't parse binding '%s' of action %s", Bindings[i].c_str(), ActionName.c_str());
+			return INVALID_ID;
+		}
+	}
+
+	ActionID id = GetActionID(ActionName);
+	if (id == INVALID_ID)
+	{
+		if (mActionNames.size() == MAX_ACTIONS)
+		{
+			Log::Error("InputActionMap: MAX_ACTIONS=%d reached, couldn't register action %s", MAX_ACTIONS, ActionName.c_str());
+			assert(false);
+			return INVALID_ID;
+		}
+		id = static_cast<ActionID>(mActionNames.size());
+		mActionNames.push_back(ActionName);
+		mActionIDLookup[ActionName] = id;
+	}
+
+	for (FBinding& Binding : CompiledBindings)
+	{
+		Binding.Action = id;
+		mBindings.push_back(Binding);
+	}
+	return id;
+}
+
+ActionID InputActionMap::GetActionID(const std::string& ActionName) const
+{
+	auto it = mActionIDLookup.find(ActionName);
+	return it == mActionIDLookup.end() ? INVALID_ID : it->second;
+}
+
+bool InputActionMap::CompileBinding(const std::string& Binding, FBinding& OutBinding) const
+{
+	// split on '+', a '+' at the beginning or the end of a token is part of the key name: "Numpad+", "Ctrl++"
+	std::vector<std::string> KeyNames;
+	size_t iBegin = 0;
+	while (iBegin < Binding.size())
+	{
+		const size_t iSeparator = Binding.find('+', iBegin + 1);
+		if (iSeparator == std::string::npos || iSeparator == Binding.size() - 1)
+		{
+			KeyNames.push_back(Binding.substr(iBegin));
+			break;
+		}
+		KeyNames.push_back(Binding.substr(iBegin, iSeparator - iBegin));
+		iBegin = iSeparator + 1;
+	}
+	if (KeyNames.empty())
+		return false;
+
+	OutBinding.Modifiers.reset();
+	OutBinding.ExcludedModifiers.reset();
+	OutBinding.Keys.reset();
+	for (const std::string& KeyName : KeyNames)
+	{
+		size_t InputCode = 0;
+		if (!Input::GetInputCode(KeyName, InputCode))
+			return false;
+
+		const bool bModifier = InputCode == VK_SHIFT || InputCode == VK_CONTROL || InputCode == VK_MENU;
+		if (bModifier && KeyNames.size() > 1)
+			OutBinding.Modifiers.set(InputCode);
+		else
+			OutBinding.Keys.set(InputCode);
+	}
+
+	for (size_t Modifier : { VK_SHIFT, VK_CONTROL, VK_MENU })
+	{
+		if (!OutBinding.Modifiers[Modifier] && !OutBinding.Keys[Modifier])
+			OutBinding.ExcludedModifiers.set(Modifier);
+	}
+	return OutBinding.Keys.any();
+}
+
+
+//
+// INPUT
+//
 bool Input::ReadRawInput_Mouse(LPARAM lParam, MouseInputEventData* pDataOut)
 {
 	constexpr UINT RAW_INPUT_SIZE_IN_BYTES = 48;
@@ -255,40 +379,62 @@ void Input::InitRawInputDevices(HWND hwnd)
 
 Input::Input()
 	: mbIgnoreInput(false)
+	, mpActionMap(nullptr)
 	, mMouseDelta{0, 0}
 	, mMousePosition{0, 0}
 	, mMouseScroll(0)
-{
-	mMouseButtons[EMouseButtons::MOUSE_BUTTON_LEFT]   = 0;
-	mMouseButtons[EMouseButtons::MOUSE_BUTTON_RIGHT]  = 0;
-	mMouseButtons[EMouseButtons::MOUSE_BUTTON_MIDDLE] = 0;
-	
-	mMouseButtonDoubleClicks = mMouseButtonsPrevious = mMouseButtons;
-
-	mKeys.fill(0);
-	mKeysPrevious.fill(0);
-}
+{}
 
 Input::Input(Input&& other)
 
 	: mbIgnoreInput(other.mbIgnoreInput.load())
 
+	, mKeys(other.mKeys)
+	, mKeysPrevious(other.mKeysPrevious)
+	, mMouseButtonDoubleClicks(other.mMouseButtonDoubleClicks)
+
+	, mpActionMap(other.mpActionMap)
+	, mActionsDown(other.mActionsDown)
+	, mActionsTriggered(other.mActionsTriggered)
+	, mActionsReleased(other.mActionsReleased)
+
 	, mMouseDelta   (other.mMouseDelta)
 	, mMousePosition(other.mMousePosition)
 	, mMouseScroll  (other.mMouseScroll)
-	, mMouseButtons (other.mMouseButtons)
-	, mMouseButtonsPrevious(other.mMouseButtonsPrevious)
-	, mMouseButtonDoubleClicks(other.mMouseButtonsPrevious)
-
-	, mKeys(other.mKeys)
-	, mKeysPrevious(other.mKeysPrevious)
 {}
 
+// called after the input events are processed, before the update
+void Input::PreUpdate()
+{
+	if (!mpActionMap)
+		return;
+
+	// evaluate all bindings against the key state bitsets: a binding is down if its modifiers & keys are down
+	// while no other modifier is, and triggered if its keys weren't all down in the previous frame.
+	InputActionMap::ActionSet_t ActionsDown;
+	InputActionMap::ActionSet_t ActionsTriggered;
+	for (const InputActionMap::FBinding& Binding : mpActionMap->GetBindings())
+	{
+		const bool bDown = (mKeys & Binding.Modifiers) == Binding.Modifiers
+			&& (mKeys & Binding.Keys) == Binding.Keys
+			&& (mKeys & Binding.ExcludedModifiers).none();
+		if (!bDown)
+			continue;
+
+		ActionsDown.set(Binding.Action);
+		if ((mKeysPrevious & Binding.Keys) != Binding.Keys)
+			ActionsTriggered.set(Binding.Action);
+	}
+
+	mActionsReleased  = mActionsDown & ~ActionsDown;
+	mActionsDown      = ActionsDown;
+	mActionsTriggered = ActionsTriggered;
+}
+
 // called at the end of the frame
 void Input::PostUpdate()
 {
 	mKeysPrevious = mKeys;
-	mMouseButtonsPrevious = mMouseButtons;
 
 	// Reset Mouse Data
 	mMouseDelta[0] = mMouseDelta[1] = 0;
@@ -315,14 +461,13 @@ void Input::UpdateKeyDown(KeyDownEventData data)
 		// if left & right mouse is clicked the same time, @key will be
 		// Input::EMouseButtons::MOUSE_BUTTON_LEFT | Input::EMouseButtons::MOUSE_BUTTON_RIGHT.
 		// Here, we decode that into distinct state variables.
-		if (mouseBtn & EMouseButtons::MOUSE_BUTTON_LEFT)   mMouseButtons[EMouseButtons::MOUSE_BUTTON_LEFT] = true;
-		if (mouseBtn & EMouseButtons::MOUSE_BUTTON_RIGHT)  mMouseButtons[EMouseButtons::MOUSE_BUTTON_RIGHT] = true;
-		if (mouseBtn & EMouseButtons::MOUSE_BUTTON_MIDDLE) mMouseButtons[EMouseButtons::MOUSE_BUTTON_MIDDLE] = true;
-		if (data.mouse.bDoubleClick)
+		for (EMouseButtons btn : MOUSE_BUTTONS)
 		{
-			if (mouseBtn & EMouseButtons::MOUSE_BUTTON_LEFT)   mMouseButtonDoubleClicks[EMouseButtons::MOUSE_BUTTON_LEFT] = true;
-			if (mouseBtn & EMouseButtons::MOUSE_BUTTON_RIGHT)  mMouseButtonDoubleClicks[EMouseButtons::MOUSE_BUTTON_RIGHT] = true;
-			if (mouseBtn & EMouseButtons::MOUSE_BUTTON_MIDDLE) mMouseButtonDoubleClicks[EMouseButtons::MOUSE_BUTTON_MIDDLE] = true;
+			if (!(mouseBtn & btn))
+				continue;
+			mKeys.set(GetMouseButtonInputCode(btn));
+			if (data.mouse.bDoubleClick)
+				mMouseButtonDoubleClicks.set(GetMouseButtonInputCode(btn) - NUM_MAX_KEYS);
 		}
 #if VERBOSE_LOGGING
 		if (data.mouse.bDoubleClick) Log::Info("Double Click!!");
@@ -335,7 +480,7 @@ void Input::UpdateKeyDown(KeyDownEventData data)
 	// KEYBOARD KEY
 	else
 	{
-		mKeys[key] = true;
+		mKeys.set(key);
 	}
 }
 
@@ -344,15 +489,19 @@ void Input::UpdateKeyUp(KeyCode key, bool bIsMouseKey)
 	if (bIsMouseKey)
 	{
 		const EMouseButtons mouseBtn = static_cast<EMouseButtons>(key);
-		
-		mMouseButtons[mouseBtn] = false;
-		mMouseButtonDoubleClicks[mouseBtn] = false;
+		for (EMouseButtons btn : MOUSE_BUTTONS)
+		{
+			if (!(mouseBtn & btn))
+				continue;
+			mKeys.reset(GetMouseButtonInputCode(btn));
+			mMouseButtonDoubleClicks.reset(GetMouseButtonInputCode(btn) - NUM_MAX_KEYS);
+		}
 #if VERBOSE_LOGGING
 		Log::Info("Mouse Button Up %x", key);
 #endif
 	}
 	else
-		mKeys[key] = false;
+		mKeys.reset(key);
 }
 
 void Input::UpdateMousePos(long x, long y, short scroll)
@@ -442,29 +591,32 @@ bool Input::IsKeyTriggered(const std::string & key) const
 
 bool Input::IsMouseDown(EMouseButtons mbtn) const
 {
-	return !mbIgnoreInput && mMouseButtons.at(mbtn);
+	return !mbIgnoreInput && mKeys[GetMouseButtonInputCode(mbtn)];
 }
 
 bool Input::IsMouseDoubleClick(EMouseButtons mbtn) const
 {
-	return !mbIgnoreInput && mMouseButtonDoubleClicks.at(mbtn);
+	return !mbIgnoreInput && mMouseButtonDoubleClicks[GetMouseButtonInputCode(mbtn) - NUM_MAX_KEYS];
 }
 
 bool Input::IsMouseUp(EMouseButtons mbtn) const
 {
-	const bool bButtonUp = !mMouseButtons.at(mbtn) && mMouseButtonsPrevious.at(mbtn);
+	const size_t code = GetMouseButtonInputCode(mbtn);
+	const bool bButtonUp = !mKeys[code] && mKeysPrevious[code];
 	return !mbIgnoreInput && bButtonUp;
 }
 
 bool Input::IsMouseTriggered(EMouseButtons mbtn) const
 {
-	const bool bButtonTriggered = mMouseButtons.at(mbtn) && !mMouseButtonsPrevious.at(mbtn);
+	const size_t code = GetMouseButtonInputCode(mbtn);
+	const bool bButtonTriggered = mKeys[code] && !mKeysPrevious[code];
 	return !mbIgnoreInput && bButtonTriggered;
 }
 
 bool Input::IsMouseReleased(EMouseButtons mbtn) const
 {
-	const bool bButtonReleased = !mMouseButtons.at(mbtn) && mMouseButtonsPrevious.at(mbtn);
+	const size_t code = GetMouseButtonInputCode(mbtn);
+	const bool bButtonReleased = !mKeys[code] && mKeysPrevious[code];
 	return !mbIgnoreInput && bButtonReleased;
 }
 
@@ -484,15 +636,9 @@ bool Input::IsMouseScrollDown() const
 
 bool Input::IsAnyMouseDown() const
 {
-	return 
-		   mMouseButtons.at(EMouseButtons::MOUSE_BUTTON_LEFT)
-		|| mMouseButtons.at(EMouseButtons::MOUSE_BUTTON_RIGHT)
-		|| mMouseButtons.at(EMouseButtons::MOUSE_BUTTON_MIDDLE)
-
-		|| mMouseButtonDoubleClicks.at(EMouseButtons::MOUSE_BUTTON_RIGHT)
-		|| mMouseButtonDoubleClicks.at(EMouseButtons::MOUSE_BUTTON_MIDDLE)
-		|| mMouseButtonDoubleClicks.at(EMouseButtons::MOUSE_BUTTON_LEFT)
+	return mKeys[GetMouseButtonInputCode(EMouseButtons::MOUSE_BUTTON_LEFT)]
+		|| mKeys[GetMouseButtonInputCode(EMouseButtons::MOUSE_BUTTON_RIGHT)]
+		|| mKeys[GetMouseButtonInputCode(EMouseButtons::MOUSE_BUTTON_MIDDLE)]
+		|| mMouseButtonDoubleClicks.any()
 	;
 }
-
-
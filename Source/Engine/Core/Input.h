@@ -21,8 +21,10 @@
 #include "Events.h"
 
 #include <array>
+#include <bitset>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include <atomic>
 
 #define ENABLE_RAW_INPUT 1
@@ -32,6 +34,52 @@
 
 #include "Window.h"
 using KeyCode = WPARAM;
+using ActionID = int;
+
+// Input codes: keyboard keys [0, NUM_MAX_KEYS) followed by the mouse buttons
+#define NUM_MOUSE_BUTTONS 3
+#define NUM_INPUT_CODES (NUM_MAX_KEYS + NUM_MOUSE_BUTTONS)
+using InputCodeSet_t = std::bitset<NUM_INPUT_CODES>;
+
+//
+// INPUT ACTION MAP
+//
+// Named actions with one or more bindings, compiled into dense action IDs and input code masks at registration.
+// A binding is a '+' separated chord of key names, e.g. "V", "Shift+PageUp", "Ctrl+Shift+Z", "MouseLeft":
+// Shift/Ctrl/Alt are modifiers that have to be held, the rest of the keys form the chord that triggers the action.
+// Modifiers that aren't part of a binding must not be held: "PageUp" doesn't fire on Shift+PageUp.
+// Actions are evaluated for all bindings at once by Input::PreUpdate() and queried with their ID in O(1).
+//
+class InputActionMap
+{
+public:
+	static constexpr int MAX_ACTIONS = 128;
+	using ActionSet_t = std::bitset<MAX_ACTIONS>;
+
+	struct FBinding
+	{
+		InputCodeSet_t Modifiers;
+		InputCodeSet_t ExcludedModifiers;
+		InputCodeSet_t Keys;
+		ActionID       Action;
+	};
+
+	// Returns the ID of the action, or INVALID_ID if a binding can't be parsed or the map is full.
+	// Registering an existing action name adds the bindings to it.
+	ActionID RegisterAction(const std::string& ActionName, const std::vector<std::string>& Bindings);
+	ActionID GetActionID(const std::string& ActionName) const; // INVALID_ID if the action doesn't exist
+
+	inline const std::vector<FBinding>& GetBindings() const { return mBindings; }
+	inline int                          GetNumActions() const { return static_cast<int>(mActionNames.size()); }
+
+private:
+	bool CompileBinding(const std::string& Binding, FBinding& OutBinding) const;
+
+private:
+	std::vector<FBinding>                     mBindings;
+	std::vector<std::string>                  mActionNames; // indexed by ActionID
+	std::unordered_map<std::string, ActionID> mActionIDLookup;
+};
 
 class Input
 {
@@ -43,12 +91,11 @@ public:
 		MOUSE_BUTTON_MIDDLE = MK_MBUTTON
 	};
 	// ---------------------------------------------------------------------------------------------
-	using KeyState         = char;
 	using KeyMapping       = std::unordered_map<std::string_view, KeyCode>;
-	using ButtonStateMap_t = std::unordered_map<EMouseButtons, KeyState>;
 	// ---------------------------------------------------------------------------------------------
 
 	static void InitRawInputDevices(HWND hwnd);
+	static bool GetInputCode(const std::string& KeyName, size_t& OutInputCode); // key names of IsKeyDown() + MouseLeft/MouseRight/MouseMiddle
 	static bool ReadRawInput_Mouse(LPARAM lParam, MouseInputEventData* pDataOut);
 	
 	// ---------------------------------------------------------------------------------------------
@@ -66,8 +113,15 @@ public:
 	void UpdateKeyUp(KeyCode, bool bIsMouseKey);
 	void UpdateMousePos(long x, long y, short scroll);
 	void UpdateMousePos_Raw(int relativeX, int relativeY, short scroll);
+	void PreUpdate(); // evaluates the actions, call after the input events of the frame are processed
 	void PostUpdate();
 
+	// actions
+	inline void SetActionMap(const InputActionMap* pActionMap) { mpActionMap = pActionMap; }
+	inline bool IsActionDown(ActionID id)      const { return !mbIgnoreInput && mActionsDown[id]; }
+	inline bool IsActionTriggered(ActionID id) const { return !mbIgnoreInput && mActionsTriggered[id]; }
+	inline bool IsActionReleased(ActionID id)  const { return !mbIgnoreInput && mActionsReleased[id]; }
+
 	// state check
 	bool IsKeyDown(KeyCode) const;
 	bool IsKeyDown(const char*) const;
@@ -80,6 +134,7 @@ public:
 	bool IsKeyTriggered(const std::string&) const;
 
 	inline const std::array<float, 2>& GetMouseDelta() const { return mMouseDelta; }
+	inline const std::array<long, 2>&  GetMousePosition() const { return mMousePosition; } // client area pixels
 	inline float MouseDeltaX() const { return mMouseDelta[0] && !mbIgnoreInput; };
 	inline float MouseDeltaY() const { return mMouseDelta[1] && !mbIgnoreInput; };
 
@@ -97,15 +152,18 @@ private:
 	// state
 	std::atomic<bool>                    mbIgnoreInput;
 
-	// keyboard
-	std::array<KeyState, NUM_MAX_KEYS>   mKeys;
-	std::array<KeyState, NUM_MAX_KEYS>   mKeysPrevious;
+	// keyboard & mouse buttons
+	InputCodeSet_t                       mKeys;
+	InputCodeSet_t                       mKeysPrevious;
+	std::bitset<NUM_MOUSE_BUTTONS>       mMouseButtonDoubleClicks;
 
-	// mouse
-	ButtonStateMap_t                     mMouseButtons;
-	ButtonStateMap_t                     mMouseButtonsPrevious;
-	ButtonStateMap_t                     mMouseButtonDoubleClicks;
+	// actions
+	const InputActionMap*                mpActionMap;
+	InputActionMap::ActionSet_t          mActionsDown;
+	InputActionMap::ActionSet_t          mActionsTriggered;
+	InputActionMap::ActionSet_t          mActionsReleased;
 
+	// mouse
 	std::array<float, 2>                 mMouseDelta;
 	std::array<long, 2>                  mMousePosition;
 	short                                mMouseScroll;
@@ -17,6 +17,14 @@
 //	Contact: volkanilbeyli@gmail.com
 #pragma once
 
+#include "MemoryTracking.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/utils.h"
+
+#include <cassert>
+#include <cstdlib>
+
 //
 // Resources on memory management
 //
@@ -37,10 +45,6 @@ inline constexpr size_t AlignTo(size_t size, size_t alignment = 64)
 
 #define MEMORY_POOL__ENABLE_DEBUG_LOG 0
 #define MEMORY_POOL__LOG_VERBOSE      0
-#if MEMORY_POOL__ENABLE_DEBUG_LOG
-#include "../../Libs/VQUtils/Source/Log.h"
-#include "../../Libs/VQUtils/Source/utils.h"
-#endif
 
 
 //
@@ -50,7 +54,7 @@ template<class TObject>
 class MemoryPool
 {
 public:
-	MemoryPool(size_t NumBlocks, size_t Alignment);
+	MemoryPool(size_t NumBlocks, size_t Alignment, EMemoryTag Tag = MemoryTracking::GetCurrentTag()); // the backing store is tracked under Tag
 	~MemoryPool();
 	
 	TObject* Allocate(size_t NumBlocks = 1);
@@ -71,6 +75,9 @@ private:
 	size_t mNumMaxBlocks = 0;
 	size_t mNumUsedBlocks = 0;
 	size_t mAllocSize = 0;
+#if MEMORY_TRACKING__ENABLE
+	EMemoryTag mTag = EMemoryTag::Untagged;
+#endif
 };
 
 
@@ -80,7 +87,7 @@ private:
 // MemoryPool Template Implementation
 //
 template<class TObject>
-inline MemoryPool<TObject>::MemoryPool(size_t NumBlocks, size_t Alignment)
+inline MemoryPool<TObject>::MemoryPool(size_t NumBlocks, size_t Alignment, EMemoryTag Tag)
 	: mNumMaxBlocks(NumBlocks)
 {
 	// calc alloc size
@@ -95,6 +102,10 @@ inline MemoryPool<TObject>::MemoryPool(size_t NumBlocks, size_t Alignment)
 	assert(this->mpNextFreeBlock);
 	this->mpAlloc = this->mpNextFreeBlock;
 	this->mAllocSize = AllocSize;
+#if MEMORY_TRACKING__ENABLE
+	this->mTag = Tag;
+	MemoryTracking::RecordAllocation(Tag, AllocSize);
+#endif
 
 	// setup list structure
 	Block* pWalk = this->mpNextFreeBlock;
@@ -139,7 +150,12 @@ inline MemoryPool<TObject>::~MemoryPool()
 	}
 
 	if (mpAlloc)
+	{
 		free(mpAlloc);
+#if MEMORY_TRACKING__ENABLE
+		MemoryTracking::RecordFree(mTag, mAllocSize);
+#endif
+	}
 }
 
 template<class TObject>
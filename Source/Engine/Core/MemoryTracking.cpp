@@ -0,0 +1,402 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "MemoryTracking.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/utils.h"
+
+#include "Memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+constexpr size_t NUM_MEMORY_TAGS = static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS);
+
+static const char* MEMORY_TAG_NAMES[NUM_MEMORY_TAGS] =
+{
+	"Untagged",
+	"Scene",
+	"SceneLoading",
+	"AssetLoader",
+	"ModelImport",
+	"Streaming",
+	"Animation",
+	"RayQueries",
+	"RenderCommands",
+	"Renderer",
+	"UI",
+};
+
+const char* MemoryTracking::GetTagName(EMemoryTag Tag)
+{
+	const size_t i = static_cast<size_t>(Tag);
+	return i < NUM_MEMORY_TAGS ? MEMORY_TAG_NAMES[i] : "Invalid";
+}
+
+static void WriteTagStatsJSON(FILE* pFile, const char* pPrefix, const char* pName, const FMemoryTagStats& s, const char* pSuffix)
+{
+	fprintf(pFile, "%s{ \"name\": \"%s\", \"current_bytes\": %lld, \"peak_bytes\": %lld, \"live_allocations\": %lld, \"allocations\": %llu, \"allocated_bytes\": %llu, \"frame_allocations\": %llu, \"frame_allocated_bytes\": %llu }%s\n"
+		, pPrefix
+		, pName, s.CurrentBytes, s.PeakBytes, s.NumLiveAllocations, s.NumAllocations, s.AllocatedBytes, s.NumFrameAllocations, s.FrameAllocatedBytes
+		, pSuffix
+	);
+}
+
+bool MemoryTracking::WriteSnapshotJSON(const FMemorySnapshot& Snapshot, const std::string& FilePath)
+{
+	FILE* pFile = fopen(FilePath.c_str(), "w");
+	if (!pFile)
+	{
+		Log::Error("MemoryTracking: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "\t\"frame\": %llu,\n", Snapshot.FrameIndex);
+	fprintf(pFile, "\t\"tracking_enabled\": %s,\n", IsEnabled() ? "true" : "false");
+	fprintf(pFile, "\t\"tags\": [\n");
+	for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i)
+		WriteTagStatsJSON(pFile, "\t\t", MEMORY_TAG_NAMES[i], Snapshot.Tags[i], i == NUM_MEMORY_TAGS - 1 ? "" : ",");
+	fprintf(pFile, "\t],\n");
+	WriteTagStatsJSON(pFile, "\t\"total\": ", "Total", Snapshot.Total, "");
+	fprintf(pFile, "}\n");
+	const bool bWriteError = ferror(pFile) != 0;
+	fclose(pFile);
+	if (bWriteError)
+	{
+		Log::Error("MemoryTracking: couldn't write %s", FilePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+void MemoryTracking::LogSnapshotDiff(const char* pLabel, const FMemorySnapshot& Before, const FMemorySnapshot& After)
+{
+	if (!IsEnabled())
+		return;
+	Log::Info("Memory %s: %+lld bytes, %llu allocations (frame %llu -> %llu)"
+		, pLabel
+		, After.Total.CurrentBytes - Before.Total.CurrentBytes
+		, After.Total.NumAllocations - Before.Total.NumAllocations
+		, Before.FrameIndex, After.FrameIndex
+	);
+	for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i)
+	{
+		const FMemoryTagStats& b = Before.Tags[i];
+		const FMemoryTagStats& a = After.Tags[i];
+		if (a.NumAllocations == b.NumAllocations && a.CurrentBytes == b.CurrentBytes)
+			continue;
+		Log::Info("  %-14s : %+lld bytes (%lld live), %llu allocations, %llu bytes allocated, peak %lld"
+			, MEMORY_TAG_NAMES[i]
+			, a.CurrentBytes - b.CurrentBytes, a.NumLiveAllocations
+			, a.NumAllocations - b.NumAllocations, a.AllocatedBytes - b.AllocatedBytes
+			, a.PeakBytes
+		);
+	}
+}
+
+
+#if MEMORY_TRACKING__ENABLE
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// COUNTERS
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+namespace
+{
+	constexpr uint32 MAX_TAG_STACK_DEPTH    = 32;
+	constexpr size_t ALLOCATION_HEADER_SIZE = 16; // keeps the 16B alignment of malloc()
+
+	struct FAllocationHeader
+	{
+		uint64 NumBytes;
+		uint8  Tag;
+	};
+	static_assert(sizeof(FAllocationHeader) <= ALLOCATION_HEADER_SIZE, "");
+
+	// written by the owning thread only, read by anyone w/ relaxed loads
+	struct alignas(64) FThreadCounters
+	{
+		struct FTag
+		{
+			std::atomic<int64>  CurrentBytes;
+			std::atomic<int64>  NumLiveAllocations;
+			std::atomic<uint64> NumAllocations;
+			std::atomic<uint64> AllocatedBytes;
+		};
+		FTag             Tags[NUM_MEMORY_TAGS];
+		FThreadCounters* pNext;
+	};
+
+	struct FFrameState
+	{
+		uint64          FrameIndex = 0;
+		int64           PeakBytes[NUM_MEMORY_TAGS] = {};
+		int64           PeakTotalBytes = 0;
+		uint64          FrameStartNumAllocations[NUM_MEMORY_TAGS] = {};
+		uint64          FrameStartAllocatedBytes[NUM_MEMORY_TAGS] = {};
+		FMemorySnapshot LastFrame;
+	};
+}
+
+// all of these are constant-initialized: usable by allocations during static initialization & from any thread
+static std::atomic<FThreadCounters*> g_pThreadCounters{ nullptr }; // lock-free list, never shrinks
+static thread_local FThreadCounters* tl_pCounters = nullptr;
+static thread_local uint8            tl_TagStack[MAX_TAG_STACK_DEPTH];
+static thread_local uint32           tl_TagStackDepth = 0;
+
+// frame bookkeeping, off the allocation path
+static std::mutex  g_MtxFrameState;
+static FFrameState g_FrameState;
+
+static FThreadCounters& GetThreadCounters()
+{
+	FThreadCounters* pCounters = tl_pCounters;
+	if (!pCounters)
+	{
+		// malloc'd: can't go through operator new. Threads don't give their counters back on exit,
+		// what they've allocated & not freed is still in there.
+		void* pMem = _aligned_malloc(sizeof(FThreadCounters), alignof(FThreadCounters));
+		assert(pMem);
+		pCounters = new (pMem) FThreadCounters(); // value-init: zeroed counters
+		pCounters->pNext = g_pThreadCounters.load(std::memory_order_relaxed);
+		while (!g_pThreadCounters.compare_exchange_weak(pCounters->pNext, pCounters, std::memory_order_release, std::memory_order_relaxed));
+		tl_pCounters = pCounters;
+	}
+	return *pCounters;
+}
+
+template<class T> static inline void OwnerAdd(std::atomic<T>& Counter, T Value)
+{
+	Counter.store(Counter.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+}
+
+static inline void CountAllocation(uint8 Tag, size_t NumBytes)
+{
+	FThreadCounters::FTag& c = GetThreadCounters().Tags[Tag];
+	OwnerAdd<int64>(c.CurrentBytes, static_cast<int64>(NumBytes));
+	OwnerAdd<int64>(c.NumLiveAllocations, 1);
+	OwnerAdd<uint64>(c.NumAllocations, 1);
+	OwnerAdd<uint64>(c.AllocatedBytes, NumBytes);
+}
+static inline void CountFree(uint8 Tag, size_t NumBytes)
+{
+	FThreadCounters::FTag& c = GetThreadCounters().Tags[Tag];
+	OwnerAdd<int64>(c.CurrentBytes, -static_cast<int64>(NumBytes));
+	OwnerAdd<int64>(c.NumLiveAllocations, -1);
+}
+
+static inline uint8 GetTopTag()
+{
+	const uint32 Depth = tl_TagStackDepth;
+	return Depth == 0 ? 0 : tl_TagStack[std::min(Depth, MAX_TAG_STACK_DEPTH) - 1];
+}
+
+void MemoryTracking::PushTag(EMemoryTag Tag)
+{
+	assert(Tag < EMemoryTag::NUM_MEMORY_TAGS);
+	// past the max depth, the deepest tag that fits keeps getting the allocations
+	if (tl_TagStackDepth < MAX_TAG_STACK_DEPTH)
+		tl_TagStack[tl_TagStackDepth] = static_cast<uint8>(Tag);
+	++tl_TagStackDepth;
+}
+void MemoryTracking::PopTag()
+{
+	assert(tl_TagStackDepth > 0);
+	--tl_TagStackDepth;
+}
+EMemoryTag MemoryTracking::GetCurrentTag() { return static_cast<EMemoryTag>(GetTopTag()); }
+
+void MemoryTracking::RecordAllocation(EMemoryTag Tag, size_t NumBytes) { CountAllocation(static_cast<uint8>(Tag), NumBytes); }
+void MemoryTracking::RecordFree      (EMemoryTag Tag, size_t NumBytes) { CountFree(static_cast<uint8>(Tag), NumBytes); }
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// SNAPSHOTS
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+static void SumThreadCounters(FMemorySnapshot& s)
+{
+	for (FMemoryTagStats& t : s.Tags)
+		t = {};
+	for (const FThreadCounters* p = g_pThreadCounters.load(std::memory_order_acquire); p; p = p->pNext)
+	{
+		for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i)
+		{
+			const FThreadCounters::FTag& c = p->Tags[i];
+			s.Tags[i].CurrentBytes       += c.CurrentBytes.load(std::memory_order_relaxed);
+			s.Tags[i].NumLiveAllocations += c.NumLiveAllocations.load(std::memory_order_relaxed);
+			s.Tags[i].NumAllocations     += c.NumAllocations.load(std::memory_order_relaxed);
+			s.Tags[i].AllocatedBytes     += c.AllocatedBytes.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+static FMemoryTagStats SumTagStats(const FMemoryTagStats* pTags)
+{
+	FMemoryTagStats Sum = {};
+	for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i)
+	{
+		Sum.CurrentBytes        += pTags[i].CurrentBytes;
+		Sum.NumLiveAllocations  += pTags[i].NumLiveAllocations;
+		Sum.NumAllocations      += pTags[i].NumAllocations;
+		Sum.AllocatedBytes      += pTags[i].AllocatedBytes;
+		Sum.NumFrameAllocations += pTags[i].NumFrameAllocations;
+		Sum.FrameAllocatedBytes += pTags[i].FrameAllocatedBytes;
+	}
+	return Sum;
+}
+
+// call w/ g_MtxFrameState locked
+static FMemorySnapshot CaptureSnapshot_Locked()
+{
+	FFrameState& f = g_FrameState;
+	FMemorySnapshot s;
+	SumThreadCounters(s);
+	s.FrameIndex = f.FrameIndex;
+	for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i)
+	{
+		FMemoryTagStats& t = s.Tags[i];
+		f.PeakBytes[i] = std::max(f.PeakBytes[i], t.CurrentBytes);
+		t.PeakBytes           = f.PeakBytes[i];
+		t.NumFrameAllocations = t.NumAllocations - f.FrameStartNumAllocations[i];
+		t.FrameAllocatedBytes = t.AllocatedBytes - f.FrameStartAllocatedBytes[i];
+	}
+	s.Total = SumTagStats(s.Tags);
+	f.PeakTotalBytes = std::max(f.PeakTotalBytes, s.Total.CurrentBytes);
+	s.Total.PeakBytes = f.PeakTotalBytes;
+	return s;
+}
+
+void MemoryTracking::EndFrame()
+{
+	std::lock_guard<std::mutex> lk(g_MtxFrameState);
+	FFrameState& f = g_FrameState;
+	f.LastFrame = CaptureSnapshot_Locked();
+	for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i)
+	{
+		f.FrameStartNumAllocations[i] = f.LastFrame.Tags[i].NumAllocations;
+		f.FrameStartAllocatedBytes[i] = f.LastFrame.Tags[i].AllocatedBytes;
+	}
+	++f.FrameIndex;
+}
+
+FMemorySnapshot MemoryTracking::GetFrameSnapshot()
+{
+	std::lock_guard<std::mutex> lk(g_MtxFrameState);
+	return g_FrameState.LastFrame;
+}
+
+FMemorySnapshot MemoryTracking::CaptureSnapshot()
+{
+	std::lock_guard<std::mutex> lk(g_MtxFrameState);
+	return CaptureSnapshot_Locked();
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// GLOBAL OPERATOR NEW / DELETE
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+// memory layout: [padding][FAllocationHeader][user memory], the header always sits right in front of the user memory
+// and the padding is there only for over-aligned allocations so that the user memory keeps its alignment.
+static inline void* WriteHeader(void* pUser, size_t NumBytes)
+{
+	const uint8 Tag = GetTopTag();
+	FAllocationHeader* pHeader = reinterpret_cast<FAllocationHeader*>(static_cast<uint8*>(pUser) - ALLOCATION_HEADER_SIZE);
+	pHeader->NumBytes = NumBytes;
+	pHeader->Tag = Tag;
+	CountAllocation(Tag, NumBytes);
+	return pUser;
+}
+static inline void ReadHeaderAndCountFree(void* pUser)
+{
+	const FAllocationHeader* pHeader = reinterpret_cast<const FAllocationHeader*>(static_cast<uint8*>(pUser) - ALLOCATION_HEADER_SIZE);
+	CountFree(pHeader->Tag, static_cast<size_t>(pHeader->NumBytes));
+}
+
+static void* TrackedAllocate(size_t NumBytes) noexcept
+{
+	void* pMem = malloc(NumBytes + ALLOCATION_HEADER_SIZE);
+	return pMem ? WriteHeader(static_cast<uint8*>(pMem) + ALLOCATION_HEADER_SIZE, NumBytes) : nullptr;
+}
+static void TrackedFree(void* pUser) noexcept
+{
+	if (!pUser)
+		return;
+	ReadHeaderAndCountFree(pUser);
+	free(static_cast<uint8*>(pUser) - ALLOCATION_HEADER_SIZE);
+}
+static void* TrackedAllocateAligned(size_t NumBytes, std::align_val_t Alignment) noexcept
+{
+	const size_t Offset = std::max(static_cast<size_t>(Alignment), ALLOCATION_HEADER_SIZE);
+	void* pMem = _aligned_malloc(NumBytes + Offset, Offset);
+	return pMem ? WriteHeader(static_cast<uint8*>(pMem) + Offset, NumBytes) : nullptr;
+}
+static void TrackedFreeAligned(void* pUser, std::align_val_t Alignment) noexcept
+{
+	if (!pUser)
+		return;
+	const size_t Offset = std::max(static_cast<size_t>(Alignment), ALLOCATION_HEADER_SIZE);
+	ReadHeaderAndCountFree(pUser);
+	_aligned_free(static_cast<uint8*>(pUser) - Offset);
+}
+
+template<class TAllocate> static void* AllocateOrThrow(TAllocate&& fnAllocate)
+{
+	for (;;)
+	{
+		if (void* p = fnAllocate())
+			return p;
+		std::new_handler pfnHandler = std::get_new_handler();
+		if (!pfnHandler)
+			throw std::bad_alloc();
+		pfnHandler();
+	}
+}
+
+void* operator new  (size_t n)                                                  { return AllocateOrThrow([n]() { return TrackedAllocate(n); }); }
+void* operator new[](size_t n)                                                  { return AllocateOrThrow([n]() { return TrackedAllocate(n); }); }
+void* operator new  (size_t n, const std::nothrow_t&) noexcept                  { return TrackedAllocate(n); }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept                  { return TrackedAllocate(n); }
+void* operator new  (size_t n, std::align_val_t a)                              { return AllocateOrThrow([n, a]() { return TrackedAllocateAligned(n, a); }); }
+void* operator new[](size_t n, std::align_val_t a)                              { return AllocateOrThrow([n, a]() { return TrackedAllocateAligned(n, a); }); }
+void* operator new  (size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return TrackedAllocateAligned(n, a); }
+void* operator new[](size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return TrackedAllocateAligned(n, a); }
+
+void operator delete  (void* p) noexcept                                        { TrackedFree(p); }
+void operator delete[](void* p) noexcept                                        { TrackedFree(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept                 { TrackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept                 { TrackedFree(p); }
+void operator delete  (void* p, size_t) noexcept                                { TrackedFree(p); }
+void operator delete[](void* p, size_t) noexcept                                { TrackedFree(p); }
+void operator delete  (void* p, std::align_val_t a) noexcept                    { TrackedFreeAligned(p, a); }
+void operator delete[](void* p, std::align_val_t a) noexcept                    { TrackedFreeAligned(p, a); }
+void operator delete  (void* p, size_t, std::align_val_t a) noexcept            { TrackedFreeAligned(p, a); }
+void operator delete[](void* p, size_t, std::align_val_t a) noexcept            { TrackedFreeAligned(p, a); }
+void operator delete  (void* p, std::align_val_t a, const std::nothrow_t&) noexcept { TrackedFreeAligned(p, a); }
+void operator delete[](void* p, std::align_val_t a, const std::nothrow_t&) noexcept { TrackedFreeAligned(p, a); }
+#endif // MEMORY_TRACKING__ENABLE
+
@@ -0,0 +1,118 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Types.h"
+
+#include <cstddef>
+#include <string>
+
+// 0: no operator new/delete replacement, tag scopes & pool hooks compile to nothing
+#ifndef MEMORY_TRACKING__ENABLE
+#define MEMORY_TRACKING__ENABLE 1
+#endif
+
+//
+// MEMORY TRACKING
+//
+// CPU allocation counters per engine subsystem.
+// - Each thread keeps a stack of tags, SCOPED_MEMORY_TAG() pushes one for the rest of the scope.
+// - The global operator new/delete are replaced: an allocation is attributed to the tag on top of the
+//   allocating thread's stack, size & tag are kept in a 16B header in front of the returned memory.
+// - Counters are per thread and only written by their thread (no locks or atomic RMW on the allocation path),
+//   they're summed up on request. A free on another thread than the allocation nets out in the sum.
+// - Peaks are sampled on EndFrame() & CaptureSnapshot(): allocations that live shorter than a frame don't show up in them.
+//
+enum class EMemoryTag : uint8
+{
+	Untagged = 0,
+	Scene,
+	SceneLoading,
+	AssetLoader,
+	ModelImport,    // engine allocations during model import, assimp's own heap isn't tracked (separate DLL)
+	Streaming,
+	Animation,
+	RayQueries,
+	RenderCommands,
+	Renderer,
+	UI,
+
+	NUM_MEMORY_TAGS
+};
+
+struct FMemoryTagStats
+{
+	int64  CurrentBytes;
+	int64  PeakBytes;
+	int64  NumLiveAllocations;
+	uint64 NumAllocations;      // since startup
+	uint64 AllocatedBytes;      // since startup
+	uint64 NumFrameAllocations; // during the last frame
+	uint64 FrameAllocatedBytes; // during the last frame
+};
+
+struct FMemorySnapshot
+{
+	uint64          FrameIndex = 0;
+	FMemoryTagStats Tags[static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS)] = {};
+	FMemoryTagStats Total = {};
+};
+
+namespace MemoryTracking
+{
+	constexpr bool IsEnabled() { return MEMORY_TRACKING__ENABLE != 0; }
+	const char*    GetTagName(EMemoryTag Tag);
+
+	// JSON w/ one line per tag, in EMemoryTag order so that two reports diff line by line
+	bool WriteSnapshotJSON(const FMemorySnapshot& Snapshot, const std::string& FilePath);
+	void LogSnapshotDiff(const char* pLabel, const FMemorySnapshot& Before, const FMemorySnapshot& After); // tags w/ changes only
+
+#if MEMORY_TRACKING__ENABLE
+	void       PushTag(EMemoryTag Tag);
+	void       PopTag();
+	EMemoryTag GetCurrentTag();
+
+	// for allocators that don't go through operator new, e.g. the MemoryPool backing store
+	void RecordAllocation(EMemoryTag Tag, size_t NumBytes);
+	void RecordFree(EMemoryTag Tag, size_t NumBytes);
+
+	void            EndFrame();                           // samples peaks & per-frame counts, call once per frame from a single thread
+	FMemorySnapshot GetFrameSnapshot();                   // as of the last EndFrame()
+	FMemorySnapshot CaptureSnapshot();                    // current counters, the frame counts cover the frame in progress
+#else
+	inline void       PushTag(EMemoryTag) {}
+	inline void       PopTag() {}
+	inline EMemoryTag GetCurrentTag() { return EMemoryTag::Untagged; }
+	inline void       RecordAllocation(EMemoryTag, size_t) {}
+	inline void       RecordFree(EMemoryTag, size_t) {}
+	inline void            EndFrame() {}
+	inline FMemorySnapshot GetFrameSnapshot() { return FMemorySnapshot{}; }
+	inline FMemorySnapshot CaptureSnapshot() { return FMemorySnapshot{}; }
+#endif
+}
+
+#if MEMORY_TRACKING__ENABLE
+struct ScopedMemoryTag
+{
+	ScopedMemoryTag(EMemoryTag Tag) { MemoryTracking::PushTag(Tag); }
+	~ScopedMemoryTag()              { MemoryTracking::PopTag(); }
+};
+#define SCOPED_MEMORY_TAG(Tag) ScopedMemoryTag MemoryTag(Tag)
+#else
+#define SCOPED_MEMORY_TAG(Tag)
+#endif
@@ -45,6 +45,7 @@ struct FStartupParameters
 	uint8 bOverrideGFXSetting_bHDR                        : 1;
 	uint8 bOverrideGFXSetting_EnvironmentMapResolution    : 1;
 	uint8 bOverrideGFXSettings_Reflections                : 1;
+	uint8 bOverrideGFXSetting_TextureMemoryBudgetMB       : 1;
 
 	uint8 bOverrideENGSetting_MainWindowHeight            : 1;
 	uint8 bOverrideENGSetting_MainWindowWidth             : 1;
@@ -60,6 +61,12 @@ struct FStartupParameters
 	uint8 bOverrideENGSetting_bAutomatedTest              : 1;
 	uint8 bOverrideENGSetting_bTestFrames                 : 1;
 	uint8 bOverrideENGSetting_StartupScene                : 1;
+	uint8 bOverrideENGSetting_bBuildShaderArchive         : 1;
+	uint8 bOverrideENGSetting_CameraTrackRecordFile       : 1;
+	uint8 bOverrideENGSetting_BenchmarkCameraTrackFile    : 1;
+	uint8 bOverrideENGSetting_BenchmarkTimestep           : 1;
+	uint8 bOverrideENGSetting_bStreamAssets               : 1;
+	uint8 bOverrideENGSetting_TextureTraceRecordFile      : 1;
 };
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -22,25 +22,59 @@
 #include <DirectXMath.h>
 #include <string>
 
+constexpr uint32 MAX_SKINNED_VERTICES = 512 * 1024; // capacity of the skinned vertex buffer, see SkinningPass
+
 struct FMeshRenderCommandBase
 {
 	MeshID meshID = INVALID_ID;
+	int iFirstSkinnedVertex = INVALID_ID; // into the skinned vertex buffer if the mesh is animated, see FSkinningCommand
 	DirectX::XMMATRIX matWorldTransformation;
 	DirectX::XMMATRIX matWorldTransformationPrev;
 };
+struct FIndexRange
+{
+	uint32 FirstIndex = 0;
+	uint32 NumIndices = 0;
+};
 struct FMeshRenderCommand : public FMeshRenderCommandBase
 {
 	MaterialID matID = INVALID_ID;
 	DirectX::XMMATRIX matNormalTransformation; //ID ?
 	std::string ModelName;
 	std::string MaterialName;
+	uint32 iFirstIndexRange = 0; // into the cluster culled FIndexRange list, see MeshletCuller
+	uint32 NumIndexRanges   = 0; // 0: draw the whole mesh
+};
+struct FMeshInstanceData
+{
+	DirectX::XMMATRIX matWorldTransformation;
+	DirectX::XMMATRIX matWorldTransformationPrev;
+	DirectX::XMMATRIX matNormalTransformation;
+};
+struct FInstancedMeshRenderCommand // meshRenderCommands that share the mesh & material, see MeshInstanceBatcher
+{
+	MeshID     meshID = INVALID_ID;
+	MaterialID matID  = INVALID_ID;
+	uint32     iFirstInstance = 0; // into the FMeshInstanceData list
+	uint32     NumInstances   = 0;
+	int        iFirstSkinnedVertex = INVALID_ID; // skinned meshes aren't instanced
 };
 struct FShadowMeshRenderCommand : public FMeshRenderCommandBase
 {
 	DirectX::XMMATRIX matWorldViewProj;
+	TransformID transformID = INVALID_ID; // identifies the caster for the shadow cache
 	MaterialID matID = INVALID_ID;
 	std::string ModelName;
 };
+struct FSkinningCommand // skins a mesh of an animated object into the skinned vertex buffer, see SkinningPass
+{
+	MeshID   meshID              = INVALID_ID;
+	BufferID VertexBufferID      = INVALID_ID; // bind pose
+	BufferID SkinWeightsBufferID = INVALID_ID; // FVertexSkinWeights per vertex
+	uint32   iFirstPaletteMatrix = 0;          // into the skinning palettes of the scene view
+	uint32   iFirstSkinnedVertex = 0;
+	uint32   NumVertices         = 0;
+};
 struct FWireframeRenderCommand : public FMeshRenderCommandBase
 {
 	DirectX::XMFLOAT3 color;
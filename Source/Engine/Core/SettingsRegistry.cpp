@@ -0,0 +1,420 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "SettingsRegistry.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <Windows.h>
+
+namespace
+{
+	inline bool IsWhitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+	std::string_view Trim(std::string_view s)
+	{
+		while (!s.empty() && IsWhitespace(s.front())) s.remove_prefix(1);
+		while (!s.empty() && IsWhitespace(s.back()))  s.remove_suffix(1);
+		return s;
+	}
+
+	bool EqualsNoCase(std::string_view a, const char* b)
+	{
+		size_t i = 0;
+		for (; i < a.size() && b[i]; ++i)
+		{
+			const char ca = (a[i] >= 'A' && a[i] <= 'Z') ? a[i] - 'A' + 'a' : a[i];
+			const char cb = (b[i] >= 'A' && b[i] <= 'Z') ? b[i] - 'A' + 'a' : b[i];
+			if (ca != cb)
+				return false;
+		}
+		return i == a.size() && b[i] == '\0';
+	}
+
+	const FSettingNamedValue* FindNamedValue(std::string_view Text, const FSettingNamedValue* pNames, uint32 NumNames)
+	{
+		for (uint32 i = 0; i < NumNames; ++i)
+			if (EqualsNoCase(Text, pNames[i].Name))
+				return &pNames[i];
+		return nullptr;
+	}
+
+	template<class TInt>
+	bool ParseInteger(std::string_view Text, TInt& Value)
+	{
+		if (!Text.empty() && Text.front() == '+')
+			Text.remove_prefix(1);
+		TInt v = 0;
+		const std::from_chars_result r = std::from_chars(Text.data(), Text.data() + Text.size(), v);
+		if (Text.empty() || r.ec != std::errc() || r.ptr != Text.data() + Text.size())
+			return false;
+		Value = v;
+		return true;
+	}
+}
+
+//
+// INI FILE
+//
+INIFile::~INIFile()
+{
+	Close();
+}
+
+bool INIFile::Open(const char* pFilePath)
+{
+	Close();
+
+	HANDLE hFile = CreateFileA(pFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	mhFile = hFile;
+
+	LARGE_INTEGER FileSize = {};
+	if (!GetFileSizeEx(hFile, &FileSize))
+	{
+		Close();
+		return false;
+	}
+
+	if (FileSize.QuadPart > 0) // empty files can't be mapped
+	{
+		mhMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		mpData = mhMapping ? static_cast<const char*>(MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (!mpData)
+		{
+			Log::Error("INIFile: couldn't map %s", pFilePath);
+			Close();
+			return false;
+		}
+	}
+
+	Parse(std::string_view(mpData, static_cast<size_t>(FileSize.QuadPart)), pFilePath);
+	return true;
+}
+
+void INIFile::Parse(std::string_view Text, const char* pSourceName)
+{
+	mSections.clear();
+	mEntries.clear();
+	mSourceName = pSourceName ? pSourceName : "";
+
+	if (Text.size() >= 3 && Text.compare(0, 3, "\xEF\xBB\xBF") == 0) // UTF-8 BOM
+		Text.remove_prefix(3);
+
+	mSections.push_back(FSection{}); // entries before the first section header
+
+	uint32 Line = 0;
+	size_t iLineBegin = 0;
+	while (iLineBegin < Text.size())
+	{
+		++Line;
+		size_t iLineEnd = Text.find('\n', iLineBegin);
+		if (iLineEnd == std::string_view::npos)
+			iLineEnd = Text.size();
+		const std::string_view Str = Trim(Text.substr(iLineBegin, iLineEnd - iLineBegin));
+		iLineBegin = iLineEnd + 1;
+
+		if (Str.empty() || Str[0] == ';' || Str[0] == '#')
+			continue;
+
+		if (Str[0] == '[')
+		{
+			const size_t iClose = Str.find(']');
+			if (iClose == std::string_view::npos)
+			{
+				Log::Warning("%s:%u: missing ']' in section header, skipping the line", mSourceName.c_str(), Line);
+				continue;
+			}
+			FSection Section;
+			Section.Name        = Trim(Str.substr(1, iClose - 1));
+			Section.Line        = Line;
+			Section.iFirstEntry = static_cast<uint32>(mEntries.size());
+			mSections.push_back(Section);
+			continue;
+		}
+
+		const size_t iEquals = Str.find('=');
+		if (iEquals == std::string_view::npos || iEquals == 0)
+		{
+			Log::Warning("%s:%u: expected Key=Value, skipping '%.*s'", mSourceName.c_str(), Line, static_cast<int>(Str.size()), Str.data());
+			continue;
+		}
+
+		FEntry Entry;
+		Entry.Key      = Trim(Str.substr(0, iEquals));
+		Entry.Value    = Trim(Str.substr(iEquals + 1));
+		Entry.Line     = Line;
+		Entry.iSection = static_cast<uint32>(mSections.size() - 1);
+		mEntries.push_back(Entry);
+		++mSections.back().NumEntries;
+	}
+}
+
+void INIFile::Close()
+{
+	if (mpData)    UnmapViewOfFile(mpData);
+	if (mhMapping) CloseHandle(mhMapping);
+	if (mhFile)    CloseHandle(mhFile);
+	mpData    = nullptr;
+	mhMapping = nullptr;
+	mhFile    = nullptr;
+
+	mSections.clear();
+	mEntries.clear();
+	mSourceName.clear();
+}
+
+
+//
+// SETTING VALUES
+//
+const char* GetSettingTypeName(ESettingType Type)
+{
+	switch (Type)
+	{
+	case ESettingType::BOOL  : return "bool";
+	case ESettingType::INT   : return "int";
+	case ESettingType::FLOAT : return "float";
+	case ESettingType::STRING: return "string";
+	case ESettingType::ENUM  : return "enum";
+	default: break;
+	}
+	return "unknown";
+}
+
+bool ParseSettingValue(std::string_view Text, bool& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	if (EqualsNoCase(Text, "true") || EqualsNoCase(Text, "1") || EqualsNoCase(Text, "yes") || EqualsNoCase(Text, "on"))
+	{
+		Value = true;
+		return true;
+	}
+	if (EqualsNoCase(Text, "false") || EqualsNoCase(Text, "0") || EqualsNoCase(Text, "no") || EqualsNoCase(Text, "off"))
+	{
+		Value = false;
+		return true;
+	}
+	return false;
+}
+
+bool ParseSettingValue(std::string_view Text, int& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	if (const FSettingNamedValue* pNamed = FindNamedValue(Text, pNames, NumNames))
+	{
+		Value = pNamed->Value;
+		return true;
+	}
+	return ParseInteger(Text, Value);
+}
+
+bool ParseSettingValue(std::string_view Text, unsigned& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	if (const FSettingNamedValue* pNamed = FindNamedValue(Text, pNames, NumNames))
+	{
+		Value = static_cast<unsigned>(pNamed->Value);
+		return true;
+	}
+	return ParseInteger(Text, Value);
+}
+
+bool ParseSettingValue(std::string_view Text, float& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	if (const FSettingNamedValue* pNamed = FindNamedValue(Text, pNames, NumNames))
+	{
+		Value = static_cast<float>(pNamed->Value);
+		return true;
+	}
+
+	// the token isn't null terminated, copy it for strtof()
+	char Buffer[64];
+	if (Text.empty() || Text.size() >= sizeof(Buffer))
+		return false;
+	memcpy(Buffer, Text.data(), Text.size());
+	Buffer[Text.size()] = '\0';
+
+	char* pEnd = nullptr;
+	const float f = strtof(Buffer, &pEnd);
+	if (pEnd != Buffer + Text.size())
+		return false;
+	Value = f;
+	return true;
+}
+
+bool ParseSettingValue(std::string_view Text, std::string& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	Value.assign(Text.data(), Text.size());
+	return true;
+}
+
+bool ParseSettingEnumValue(std::string_view Text, int& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	if (const FSettingNamedValue* pNamed = FindNamedValue(Text, pNames, NumNames))
+	{
+		Value = pNamed->Value;
+		return true;
+	}
+
+	int i = 0;
+	if (!ParseInteger(Text, i) || i < 0)
+		return false;
+
+	if (NumNames > 0) // named enums only accept the listed values
+	{
+		bool bListed = false;
+		for (uint32 iName = 0; iName < NumNames; ++iName)
+			bListed = bListed || pNames[iName].Value == i;
+		if (!bListed)
+			return false;
+	}
+	Value = i;
+	return true;
+}
+
+std::string SettingValueToString(bool Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	return Value ? "true" : "false";
+}
+
+std::string SettingValueToString(int Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	for (uint32 i = 0; i < NumNames; ++i)
+		if (pNames[i].Value == Value)
+			return pNames[i].Name;
+	return std::to_string(Value);
+}
+
+std::string SettingValueToString(unsigned Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	for (uint32 i = 0; i < NumNames; ++i)
+		if (static_cast<unsigned>(pNames[i].Value) == Value)
+			return pNames[i].Name;
+	return std::to_string(Value);
+}
+
+std::string SettingValueToString(float Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	// %g keeps the written values short, 9 significant digits are needed to read back the same float
+	char Buffer[32];
+	snprintf(Buffer, sizeof(Buffer), "%g", Value);
+	if (strtof(Buffer, nullptr) != Value)
+		snprintf(Buffer, sizeof(Buffer), "%.9g", Value);
+	return Buffer;
+}
+
+std::string SettingValueToString(const std::string& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	return Value;
+}
+
+void ReportUnknownSetting(const INIFile& File, const INIFile::FEntry& Entry)
+{
+	const std::string_view Section = File.GetSections()[Entry.iSection].Name;
+	Log::Warning("%s:%u: unknown setting '%.*s' in section [%.*s], ignoring"
+		, File.GetSourceName().c_str(), Entry.Line
+		, static_cast<int>(Entry.Key.size()), Entry.Key.data()
+		, static_cast<int>(Section.size()), Section.data()
+	);
+}
+
+void ReportInvalidSettingValue(const INIFile& File, const INIFile::FEntry& Entry, ESettingType Type)
+{
+	Log::Warning("%s:%u: invalid %s value '%.*s' for '%.*s', ignoring"
+		, File.GetSourceName().c_str(), Entry.Line, GetSettingTypeName(Type)
+		, static_cast<int>(Entry.Value.size()), Entry.Value.data()
+		, static_cast<int>(Entry.Key.size()), Entry.Key.data()
+	);
+}
+
+
+//
+// CONSOLE VARIABLES
+//
+void ConsoleVariables::Clear()
+{
+	mVariables.clear();
+}
+
+const ConsoleVariables::FVariable* ConsoleVariables::Find(std::string_view Name) const
+{
+	auto it = std::lower_bound(mVariables.begin(), mVariables.end(), Name, [](const FVariable& l, std::string_view r) { return std::string_view(l.Name) < r; });
+	return (it != mVariables.end() && it->Name == Name) ? &(*it) : nullptr;
+}
+
+std::string ConsoleVariables::GetValueString(const FVariable& Variable) const
+{
+	return Variable.pfnToString(Variable.pValue, Variable.pNames, Variable.NumNames);
+}
+
+bool ConsoleVariables::Set(std::string_view Name, std::string_view Value)
+{
+	const FVariable* pVariable = Find(Name);
+	if (!pVariable)
+	{
+		Log::Error("ConsoleVariables: unknown variable '%.*s'", static_cast<int>(Name.size()), Name.data());
+		return false;
+	}
+
+	Value = Trim(Value);
+	if (!pVariable->pfnSet(pVariable->pValue, Value, pVariable->pNames, pVariable->NumNames))
+	{
+		Log::Error("ConsoleVariables: invalid %s value '%.*s' for %s", GetSettingTypeName(pVariable->Type), static_cast<int>(Value.size()), Value.data(), pVariable->Name.c_str());
+		return false;
+	}
+
+	Log::Info("%s = %s", pVariable->Name.c_str(), GetValueString(*pVariable).c_str());
+	if (pVariable->OnChanged)
+		pVariable->OnChanged();
+	return true;
+}
+
+bool ConsoleVariables::Execute(std::string_view Command)
+{
+	Command = Trim(Command);
+	if (Command.empty())
+		return false;
+
+	size_t iSeparator = 0;
+	while (iSeparator < Command.size() && !IsWhitespace(Command[iSeparator]) && Command[iSeparator] != '=')
+		++iSeparator;
+
+	const std::string_view Name  = Command.substr(0, iSeparator);
+	std::string_view       Value = Trim(Command.substr(iSeparator));
+	if (!Value.empty() && Value.front() == '=')
+		Value = Trim(Value.substr(1));
+
+	if (Value.empty())
+	{
+		const FVariable* pVariable = Find(Name);
+		if (!pVariable)
+		{
+			Log::Error("ConsoleVariables: unknown variable '%.*s'", static_cast<int>(Name.size()), Name.data());
+			return false;
+		}
+		Log::Info("%s = %s | %s", pVariable->Name.c_str(), GetValueString(*pVariable).c_str(), pVariable->Description.c_str());
+		return true;
+	}
+
+	return Set(Name, Value);
+}
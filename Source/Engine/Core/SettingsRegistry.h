@@ -0,0 +1,290 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Types.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+//
+// INI FILE
+//
+// Memory-maps an .ini file and tokenizes it in a single pass into [Section]s and Key=Value entries.
+// The tokens are string_views into the mapped file and are valid until Close().
+// - Lines starting with ';' or '#' are comments, whitespace around keys and values is trimmed.
+// - Entries before the first [Section] belong to the unnamed section at index 0.
+// - Malformed lines are reported w/ their line number and skipped.
+//
+class INIFile
+{
+public:
+	struct FSection
+	{
+		std::string_view Name;
+		uint32 Line        = 0;
+		uint32 iFirstEntry = 0;
+		uint32 NumEntries  = 0;
+	};
+	struct FEntry
+	{
+		std::string_view Key;
+		std::string_view Value;
+		uint32 Line     = 0;
+		uint32 iSection = 0;
+	};
+
+public:
+	INIFile() = default;
+	~INIFile();
+	INIFile(const INIFile&) = delete;
+	INIFile& operator=(const INIFile&) = delete;
+
+	bool Open(const char* pFilePath); // false if the file can't be opened
+	void Parse(std::string_view Text, const char* pSourceName); // tokenizes a buffer owned by the caller
+	void Close();
+
+	inline const std::vector<FSection>& GetSections() const { return mSections; }
+	inline const std::vector<FEntry>&   GetEntries()  const { return mEntries; }
+	inline const std::string&           GetSourceName() const { return mSourceName; }
+
+private:
+	std::vector<FSection> mSections;
+	std::vector<FEntry>   mEntries;
+	std::string           mSourceName;
+
+	void*       mhFile    = nullptr;
+	void*       mhMapping = nullptr;
+	const char* mpData    = nullptr;
+};
+
+
+//
+// SETTING VALUES
+//
+enum class ESettingType
+{
+	BOOL = 0,
+	INT,
+	FLOAT,
+	STRING,
+	ENUM,
+
+	NUM_SETTING_TYPES
+};
+const char* GetSettingTypeName(ESettingType Type);
+
+template<class T, class = void> struct TSettingType;
+template<> struct TSettingType<bool>        { static constexpr ESettingType Value = ESettingType::BOOL; };
+template<> struct TSettingType<int>         { static constexpr ESettingType Value = ESettingType::INT; };
+template<> struct TSettingType<unsigned>    { static constexpr ESettingType Value = ESettingType::INT; };
+template<> struct TSettingType<float>       { static constexpr ESettingType Value = ESettingType::FLOAT; };
+template<> struct TSettingType<std::string> { static constexpr ESettingType Value = ESettingType::STRING; };
+template<class T> struct TSettingType<T, std::enable_if_t<std::is_enum_v<T>>> { static constexpr ESettingType Value = ESettingType::ENUM; };
+
+// Named values of a setting, e.g. DisplayMode=Windowed or MaxFrameRate=Unlimited.
+// Enums only accept the listed names & values, ints accept the names in addition to any number.
+struct FSettingNamedValue
+{
+	const char* Name;
+	int         Value;
+};
+
+// The parsers require the whole token to be consumed, e.g. "1.5" is not a valid int.
+bool ParseSettingValue(std::string_view Text, bool&        Value, const FSettingNamedValue* pNames, uint32 NumNames);
+bool ParseSettingValue(std::string_view Text, int&         Value, const FSettingNamedValue* pNames, uint32 NumNames);
+bool ParseSettingValue(std::string_view Text, unsigned&    Value, const FSettingNamedValue* pNames, uint32 NumNames);
+bool ParseSettingValue(std::string_view Text, float&       Value, const FSettingNamedValue* pNames, uint32 NumNames);
+bool ParseSettingValue(std::string_view Text, std::string& Value, const FSettingNamedValue* pNames, uint32 NumNames);
+bool ParseSettingEnumValue(std::string_view Text, int& Value, const FSettingNamedValue* pNames, uint32 NumNames);
+template<class TEnum, std::enable_if_t<std::is_enum_v<TEnum>, int> = 0>
+bool ParseSettingValue(std::string_view Text, TEnum& Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	static_assert(sizeof(TEnum) <= sizeof(int), "");
+	int i = 0;
+	if (!ParseSettingEnumValue(Text, i, pNames, NumNames))
+		return false;
+	Value = static_cast<TEnum>(i);
+	return true;
+}
+
+std::string SettingValueToString(bool               Value, const FSettingNamedValue* pNames, uint32 NumNames);
+std::string SettingValueToString(int                Value, const FSettingNamedValue* pNames, uint32 NumNames);
+std::string SettingValueToString(unsigned           Value, const FSettingNamedValue* pNames, uint32 NumNames);
+std::string SettingValueToString(float              Value, const FSettingNamedValue* pNames, uint32 NumNames);
+std::string SettingValueToString(const std::string& Value, const FSettingNamedValue* pNames, uint32 NumNames);
+template<class TEnum, std::enable_if_t<std::is_enum_v<TEnum>, int> = 0>
+std::string SettingValueToString(TEnum Value, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	return SettingValueToString(static_cast<int>(Value), pNames, NumNames);
+}
+
+
+//
+// SETTINGS SCHEMA
+//
+// A constexpr table that binds [Section] Key pairs to the typed fields of a record, e.g.
+//
+//   constexpr TSettingDesc<FStartupParameters> SCHEMA[] =
+//   {
+//       VQ_SETTING(FStartupParameters, "Graphics", "VSync", nullptr, EngineSettings.gfx.bVsync, p.bOverrideGFXSetting_bVSync = true),
+//   };
+//
+// The field type is deduced and the value is parsed straight into the field, the last
+// argument is a statement run on the record 'p' after a successful parse.
+//
+template<class TRecord>
+struct TSettingDesc
+{
+	const char*               Section;  // nullptr: any section, used when each section is a record
+	const char*               Key;
+	const char*               Alias;    // nullptr or an alternative key
+	ESettingType              Type;
+	const FSettingNamedValue* pNames;
+	uint32                    NumNames;
+	bool (*pfnParse)(TRecord& p, std::string_view Value, const FSettingNamedValue* pNames, uint32 NumNames);
+};
+
+#define VQ_SETTING_NAMED(TRecord, Section, Key, Alias, Field, NamedValues, OnParsed)                             \
+	TSettingDesc<TRecord>{ Section, Key, Alias                                                                    \
+		, TSettingType<std::remove_cv_t<std::remove_reference_t<decltype(std::declval<TRecord&>().Field)>>>::Value \
+		, NamedValues, static_cast<uint32>(std::size(NamedValues))                                                \
+		, [](TRecord& p, std::string_view v, const FSettingNamedValue* pN, uint32 N) -> bool                      \
+		{ if (!ParseSettingValue(v, p.Field, pN, N)) return false; OnParsed; return true; } }
+
+#define VQ_SETTING(TRecord, Section, Key, Alias, Field, OnParsed)                                                \
+	TSettingDesc<TRecord>{ Section, Key, Alias                                                                    \
+		, TSettingType<std::remove_cv_t<std::remove_reference_t<decltype(std::declval<TRecord&>().Field)>>>::Value \
+		, nullptr, 0u                                                                                             \
+		, [](TRecord& p, std::string_view v, const FSettingNamedValue* pN, uint32 N) -> bool                      \
+		{ if (!ParseSettingValue(v, p.Field, pN, N)) return false; OnParsed; return true; } }
+
+void ReportUnknownSetting(const INIFile& File, const INIFile::FEntry& Entry);
+void ReportInvalidSettingValue(const INIFile& File, const INIFile::FEntry& Entry, ESettingType Type);
+
+// Parses the entries of a section into the record, returns the number of errors reported.
+// Descs w/ a section only match the entries of that section, the others match any section.
+template<class TRecord, size_t NUM_DESCS>
+uint32 ApplySettingsSection(const INIFile& File, const INIFile::FSection& Section, const TSettingDesc<TRecord>(&Schema)[NUM_DESCS], TRecord& Record)
+{
+	uint32 NumErrors = 0;
+	for (uint32 iEntry = Section.iFirstEntry; iEntry < Section.iFirstEntry + Section.NumEntries; ++iEntry)
+	{
+		const INIFile::FEntry& Entry = File.GetEntries()[iEntry];
+
+		const TSettingDesc<TRecord>* pDesc = nullptr;
+		for (const TSettingDesc<TRecord>& Desc : Schema)
+		{
+			if (Desc.Section && Section.Name != Desc.Section)
+				continue;
+			if (Entry.Key == Desc.Key || (Desc.Alias && Entry.Key == Desc.Alias))
+			{
+				pDesc = &Desc;
+				break;
+			}
+		}
+
+		if (!pDesc)
+		{
+			ReportUnknownSetting(File, Entry);
+			++NumErrors;
+		}
+		else if (!pDesc->pfnParse(Record, Entry.Value, pDesc->pNames, pDesc->NumNames))
+		{
+			ReportInvalidSettingValue(File, Entry, pDesc->Type);
+			++NumErrors;
+		}
+	}
+	return NumErrors;
+}
+
+
+//
+// CONSOLE VARIABLES
+//
+// Named views of live engine variables that can be changed at runtime w/o restarting the engine,
+// e.g. for A/B testing a setting from the UI console. Values are set from strings w/ the same
+// parsers as the settings files and the change callback runs after the value is written.
+// Not thread safe: register and set the variables from the update thread.
+//
+class ConsoleVariables
+{
+public:
+	using OnChangedCallback_t = std::function<void()>;
+	struct FVariable
+	{
+		std::string               Name;
+		std::string               Description;
+		ESettingType              Type;
+		void*                     pValue;
+		const FSettingNamedValue* pNames;
+		uint32                    NumNames;
+		OnChangedCallback_t       OnChanged;
+
+		bool        (*pfnSet)(void* pValue, std::string_view Text, const FSettingNamedValue* pNames, uint32 NumNames);
+		std::string (*pfnToString)(const void* pValue, const FSettingNamedValue* pNames, uint32 NumNames);
+	};
+
+public:
+	template<class T>
+	inline void Register(const char* pName, T* pValue, const char* pDescription, OnChangedCallback_t OnChanged = nullptr) { RegisterVariable(pName, pValue, pDescription, std::move(OnChanged), nullptr, 0); }
+	template<class T, size_t NUM_NAMES>
+	inline void Register(const char* pName, T* pValue, const char* pDescription, OnChangedCallback_t OnChanged, const FSettingNamedValue(&Names)[NUM_NAMES]) { RegisterVariable(pName, pValue, pDescription, std::move(OnChanged), Names, static_cast<uint32>(NUM_NAMES)); }
+	void Clear();
+
+	bool Set(std::string_view Name, std::string_view Value); // logs an error if the variable doesn't exist or the value is invalid
+	bool Execute(std::string_view Command);                  // "Name Value" sets the variable, "Name" logs its value
+
+	const FVariable* Find(std::string_view Name) const;
+	std::string      GetValueString(const FVariable& Variable) const;
+	inline const std::vector<FVariable>& GetVariables() const { return mVariables; }
+
+private:
+	template<class T>
+	void RegisterVariable(const char* pName, T* pValue, const char* pDescription, OnChangedCallback_t OnChanged, const FSettingNamedValue* pNames, uint32 NumNames);
+
+private:
+	std::vector<FVariable> mVariables; // sorted by name
+};
+
+template<class T>
+void ConsoleVariables::RegisterVariable(const char* pName, T* pValue, const char* pDescription, OnChangedCallback_t OnChanged, const FSettingNamedValue* pNames, uint32 NumNames)
+{
+	FVariable v;
+	v.Name        = pName;
+	v.Description = pDescription ? pDescription : "";
+	v.Type        = TSettingType<T>::Value;
+	v.pValue      = pValue;
+	v.pNames      = pNames;
+	v.NumNames    = NumNames;
+	v.OnChanged   = std::move(OnChanged);
+	v.pfnSet      = [](void* p, std::string_view Text, const FSettingNamedValue* pN, uint32 N) { return ParseSettingValue(Text, *static_cast<T*>(p), pN, N); };
+	v.pfnToString = [](const void* p, const FSettingNamedValue* pN, uint32 N) { return SettingValueToString(*static_cast<const T*>(p), pN, N); };
+
+	auto it = std::lower_bound(mVariables.begin(), mVariables.end(), v.Name, [](const FVariable& l, const std::string& r) { return l.Name < r; });
+	if (it != mVariables.end() && it->Name == v.Name)
+		*it = std::move(v); // re-registering replaces the binding, e.g. after a scene change
+	else
+		mVariables.insert(it, std::move(v));
+}
@@ -17,6 +17,7 @@
 //	Contact: volkanilbeyli@gmail.com
 
 #include "Culling.h"
+#include "OcclusionCulling.h"
 #include "Math.h"
 #include "Scene/Scene.h"
 #include "Libs/VQUtils/Source/Multithreading.h"
@@ -31,120 +32,28 @@
 
 using namespace DirectX;
 
-//------------------------------------------------------------------------------------------------------------------------------
-//
-// CULLING FUNCTIONS
-//
-//------------------------------------------------------------------------------------------------------------------------------
-bool IsSphereIntersectingFurstum(const FFrustumPlaneset& FrustumPlanes, const FSphere& Sphere)
-{
-#if 1 
-	// approximate sphere as a bounding box and utilize bounding box 
-	// until the implementaiton is complete for sphere-frustum check below
-	return IsBoundingBoxIntersectingFrustum(FrustumPlanes, FBoundingBox(Sphere));
-#else
-	bool bIntersecting = true;
-
-	// check each frustum plane against sphere
-	for (size_t i = 0; i < 6; ++i)
-	{
-		// plane eq : 0 = ax + by + cz + d
-		// plane Normal : Normalized(a, b, c)
-		// plane translation along plane normal: d
-		XMVECTOR vPlaneNormal = XMLoadFloat4(&FrustumPlanes.abcd[i]);
-		XMVECTOR vPlaneDistanceInNormalDirection = XMVectorSwizzle(vPlaneNormal, 3, 3, 3, 3);
-		vPlaneNormal.m128_f32[3] = 1.0f;
-		vPlaneNormal = XMVector3Normalize(vPlaneNormal);
-		
-		XMVECTOR vSpherePosition = XMLoadFloat3(&Sphere.CenterPosition);
-		XMVECTOR vSphereRadius = XMLoadFloat(&Sphere.Radius);
-
-		// project sphere position vector onto plane normal : move sphere up/down parallel to the plane so that N and ProjectedPosition aligns
-		//                                                    ^ this makes intersection test easier by considering the sphere radius at the projected position
-		XMVECTOR vSpherePositionProjected = XMVector3Dot(vSpherePosition, vPlaneNormal);
-
-		XMVECTOR vSpherePositionProjectedLengthSq = XMVector3Dot(vSpherePositionProjected, vSpherePositionProjected);
-		XMVECTOR vSpherePositionProjectedLength = XMVectorSqrt(vSpherePositionProjectedLengthSq);
-		{
-			XMVECTOR Tmp0 = vSpherePositionProjectedLength + vSphereRadius;
-			XMVECTOR Tmp1 = vSpherePositionProjectedLength - vSphereRadius;
-			vSpherePositionProjectedLength.m128_f32[1] = Tmp1.m128_f32[0]; // min extent
-			vSpherePositionProjectedLength.m128_f32[2] = Tmp0.m128_f32[0]; // max extent
-		}
-
-		// [0]: center, [1] center-radius, [2] center+radius
-		XMVECTOR vResult = vPlaneDistanceInNormalDirection - vSpherePositionProjectedLength;
-		const bool bCenterOutsideFrustum = vResult.m128_f32[0] > 0;
-		const bool bCenterMinExtentOutsideFrustum = vResult.m128_f32[1] > 0;
-		const bool bCenterMaxExtentOutsideFrustum = vResult.m128_f32[2] > 0;
-		if (bCenterOutsideFrustum && bCenterMinExtentOutsideFrustum && bCenterMaxExtentOutsideFrustum)
-		{
-			bIntersecting = false;
-		}
-	}
-
-	assert(false); // not done yet
-	return bIntersecting;
-#endif
-}
-
-bool IsBoundingBoxIntersectingFrustum(const FFrustumPlaneset& FrustumPlanes, const FBoundingBox& BBox)
-{
-	constexpr float EPSILON = 0.000002f;
-
-	// this is a hotspot: GetCornerPointsV4() creating the bounding box on the stack may slow it down.
-	//                    TODO: test with a pre-generated set of corners instead of doing it on the fly.
-	const std::array<XMFLOAT4, 8> vPoints = BBox.GetCornerPointsF4(); // TODO: optimize XMLoadFloat4
-
-	for (int p = 0; p < 6; ++p)	// for each plane
-	{
-		bool bInside = false;
-		for (const XMFLOAT4& f4Point : vPoints)
-		{
-			XMVECTOR vPoint = XMLoadFloat4(&f4Point);
-			XMVECTOR vPlane = XMLoadFloat4(&FrustumPlanes.abcd[p]);
-			if (XMVector4Dot(vPoint, vPlane).m128_f32[0] > EPSILON)
-			{
-				bInside = true;
-				break;
-			}
-		}
-		if (!bInside) // if all the BB points are outside the frustum plane
-			return false;
-	}
-	
-	return true;
-}
-
-bool IsFrustumIntersectingFrustum(const FFrustumPlaneset& FrustumPlanes0, const FFrustumPlaneset& FrustumPlanes1)
-{
-	return true; // TODO:
-	assert(false); // not done yet
-	return true;
-}
-
-
-
 //------------------------------------------------------------------------------------------------------------------------------
 //
 // THREADING
 //
 //------------------------------------------------------------------------------------------------------------------------------
-size_t FFrustumCullWorkerContext::AddWorkerItem(FFrustumPlaneset&& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects)
+size_t FFrustumCullWorkerContext::AddWorkerItem(FFrustumPlaneset&& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects, const OcclusionCuller* pOcclusionCuller)
 {
 	SCOPED_CPU_MARKER("FFrustumCullWorkerContext::AddWorkerItem()");
 	vFrustumPlanes.emplace_back(FrustumPlaneSet);
 	vBoundingBoxLists.push_back(vBoundingBoxList);
 	vGameObjectPointerLists.push_back(pGameObjects);
+	vpOcclusionCullers.push_back(pOcclusionCuller);
 	assert(vFrustumPlanes.size() == vBoundingBoxLists.size());
 	return vFrustumPlanes.size() - 1;
 }
-size_t FFrustumCullWorkerContext::AddWorkerItem(const FFrustumPlaneset& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects)
+size_t FFrustumCullWorkerContext::AddWorkerItem(const FFrustumPlaneset& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects, const OcclusionCuller* pOcclusionCuller)
 {
 	SCOPED_CPU_MARKER("FFrustumCullWorkerContext::AddWorkerItem()");
 	vFrustumPlanes.emplace_back(FrustumPlaneSet);
 	vBoundingBoxLists.push_back(vBoundingBoxList);
 	vGameObjectPointerLists.push_back(pGameObjects);
+	vpOcclusionCullers.push_back(pOcclusionCuller);
 	assert(vFrustumPlanes.size() == vBoundingBoxLists.size());
 	return vFrustumPlanes.size() - 1;
 }
@@ -280,13 +189,17 @@ void FFrustumCullWorkerContext::Process(size_t iRangeBegin, size_t iRangeEnd)
 	// process each frustum
 	for (size_t iWork = iRangeBegin; iWork <= iRangeEnd; ++iWork)
 	{
+		const OcclusionCuller* pOcclusionCuller = vpOcclusionCullers[iWork];
+
 		// process bounding box list per frustum
 		for (size_t bb = 0; bb < vBoundingBoxLists[iWork].size(); ++bb)
 		{
-			if (IsBoundingBoxIntersectingFrustum(vFrustumPlanes[iWork], vBoundingBoxLists[iWork][bb]))
-			{
-				vCulledBoundingBoxIndexListPerView[iWork].push_back(bb); // grows as we go (no pre-alloc)
-			}
+			const FBoundingBox& BBox = vBoundingBoxLists[iWork][bb];
+			if (!IsBoundingBoxIntersectingFrustum(vFrustumPlanes[iWork], BBox))
+				continue;
+			if (pOcclusionCuller && pOcclusionCuller->IsBoundingBoxOccluded(BBox))
+				continue;
+			vCulledBoundingBoxIndexListPerView[iWork].push_back(bb); // grows as we go (no pre-alloc)
 		}
 	}
 }
@@ -297,59 +210,6 @@ void FFrustumCullWorkerContext::Process(size_t iRangeBegin, size_t iRangeEnd)
 // BOX HIERARCHY
 //
 //------------------------------------------------------------------------------------------------------------------------------
-std::array<DirectX::XMFLOAT4, 8> FBoundingBox::GetCornerPointsF4() const
-{
-	return std::array<XMFLOAT4, 8>
-	{
-		XMFLOAT4(ExtentMin.x, ExtentMin.y, ExtentMin.z, 1.0f),
-		XMFLOAT4(ExtentMax.x, ExtentMin.y, ExtentMin.z, 1.0f),
-		XMFLOAT4(ExtentMax.x, ExtentMax.y, ExtentMin.z, 1.0f),
-		XMFLOAT4(ExtentMin.x, ExtentMax.y, ExtentMin.z, 1.0f),
-
-		XMFLOAT4(ExtentMin.x, ExtentMin.y, ExtentMax.z, 1.0f),
-		XMFLOAT4(ExtentMax.x, ExtentMin.y, ExtentMax.z, 1.0f),
-		XMFLOAT4(ExtentMax.x, ExtentMax.y, ExtentMax.z, 1.0f),
-		XMFLOAT4(ExtentMin.x, ExtentMax.y, ExtentMax.z, 1.0f)
-	};
-}
-std::array<DirectX::XMFLOAT3, 8> FBoundingBox::GetCornerPointsF3() const
-{
-	return std::array<XMFLOAT3, 8>
-	{
-		XMFLOAT3(ExtentMin.x, ExtentMin.y, ExtentMin.z),
-		XMFLOAT3(ExtentMax.x, ExtentMin.y, ExtentMin.z),
-		XMFLOAT3(ExtentMax.x, ExtentMax.y, ExtentMin.z),
-		XMFLOAT3(ExtentMin.x, ExtentMax.y, ExtentMin.z),
-
-		XMFLOAT3(ExtentMin.x, ExtentMin.y, ExtentMax.z),
-		XMFLOAT3(ExtentMax.x, ExtentMin.y, ExtentMax.z),
-		XMFLOAT3(ExtentMax.x, ExtentMax.y, ExtentMax.z),
-		XMFLOAT3(ExtentMin.x, ExtentMax.y, ExtentMax.z)
-	};
-}
-FBoundingBox::FBoundingBox(const FSphere& s)
-{
-	const XMFLOAT3& P = s.CenterPosition;
-	const float   & R = s.Radius;
-	this->ExtentMax = XMFLOAT3(P.x + R, P.y + R, P.z + R);
-	this->ExtentMin = XMFLOAT3(P.x - R, P.y - R, P.z - R);
-}
-
-std::array<DirectX::XMVECTOR, 8> FBoundingBox::GetCornerPointsV4() const
-{
-	std::array<DirectX::XMFLOAT4, 8> Points_F4 = GetCornerPointsF4();
-	std::array<DirectX::XMVECTOR, 8> Points_V;
-	for(int i=0; i<8; ++i) Points_V[i] = XMLoadFloat4(&Points_F4[i]);
-	return Points_V;
-}
-std::array<DirectX::XMVECTOR, 8> FBoundingBox::GetCornerPointsV3() const
-{
-	std::array<DirectX::XMFLOAT3, 8> Points_F3 = GetCornerPointsF3();
-	std::array<DirectX::XMVECTOR, 8> Points_V;
-	for (int i = 0; i < 8; ++i) Points_V[i] = XMLoadFloat3(&Points_F3[i]);
-	return Points_V;
-}
-
 static constexpr float max_f = std::numeric_limits<float>::max();
 static constexpr float min_f = -(max_f - 1.0f);
 static const XMFLOAT3 MINS = XMFLOAT3(max_f, max_f, max_f);
@@ -24,6 +24,7 @@
 
 class GameObject;
 class ThreadPool;
+class OcclusionCuller;
 
 //------------------------------------------------------------------------------------------------------------------------------
 //
@@ -145,6 +146,7 @@ struct FFrustumCullWorkerContext : public FThreadWorkerContext
 	// Hot Data : used during culling --------------------------------------------------------------------------------------
 	/*in */ std::vector<FFrustumPlaneset         > vFrustumPlanes;
 	/*in */ std::vector<std::vector<FBoundingBox>> vBoundingBoxLists;
+	/*in */ std::vector<const OcclusionCuller*   > vpOcclusionCullers; // optional, tested after the frustum
 
 	// store the index of the surviving bounding box in a list, per view frustum
 	/*out*/ std::vector<IndexList_t> vCulledBoundingBoxIndexListPerView; 
@@ -156,8 +158,8 @@ struct FFrustumCullWorkerContext : public FThreadWorkerContext
 	//std::vector<int> vLightMovementTypeID; // index to access light type vectors: [0]:static, [1]:stationary, [2]:dynamic
 
 
-	size_t AddWorkerItem(     FFrustumPlaneset&& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects);
-	size_t AddWorkerItem(const FFrustumPlaneset& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects);
+	size_t AddWorkerItem(     FFrustumPlaneset&& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects, const OcclusionCuller* pOcclusionCuller = nullptr);
+	size_t AddWorkerItem(const FFrustumPlaneset& FrustumPlaneSet, const std::vector<FBoundingBox>& vBoundingBoxList, const std::vector<const GameObject*>& pGameObjects, const OcclusionCuller* pOcclusionCuller = nullptr);
 
 	void ProcessWorkItems_SingleThreaded();
 	void ProcessWorkItems_MultiThreaded(const size_t NumThreadsIncludingThisThread, ThreadPool& WorkerThreadPool);
@@ -372,7 +372,10 @@ void VQEngine::UnloadEnvironmentMap()
 		mRenderer.DestroySRV(env.SRV_IrradianceSpec);
 		mRenderer.DestroySRV(env.SRV_BlurTemp);
 		mRenderer.DestroySRV(env.SRV_IrradianceDiffBlurred);
-		// mRenderer.DestroyUAV(); // TODO:?
+		mRenderer.DestroyUAV(env.UAV_BlurTemp);
+		mRenderer.DestroyUAV(env.UAV_IrradianceDiffBlurred);
+		mRenderer.DestroyRTV(env.RTV_IrradianceDiff);
+		mRenderer.DestroyRTV(env.RTV_IrradianceSpec);
 		mRenderer.DestroyTexture(env.Tex_HDREnvironment);
 		mRenderer.DestroyTexture(env.Tex_IrradianceDiff);
 		mRenderer.DestroyTexture(env.Tex_IrradianceSpec);
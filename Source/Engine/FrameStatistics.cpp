@@ -0,0 +1,469 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// P2 QUANTILE
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+void P2Quantile::Reset(float Quantile)
+{
+	assert(Quantile > 0.0f && Quantile < 1.0f);
+	const double p = Quantile;
+	mQuantile = Quantile;
+	mNumSamples = 0;
+	for (int i = 0; i < 5; ++i)
+	{
+		mHeights[i] = 0.0;
+		mPositions[i] = i + 1.0;
+	}
+	mDesiredPositions[0] = 1.0; mDesiredPositions[1] = 1.0 + 2.0 * p; mDesiredPositions[2] = 1.0 + 4.0 * p; mDesiredPositions[3] = 3.0 + 2.0 * p; mDesiredPositions[4] = 5.0;
+	mDesiredIncrements[0] = 0.0; mDesiredIncrements[1] = p / 2.0; mDesiredIncrements[2] = p; mDesiredIncrements[3] = (1.0 + p) / 2.0; mDesiredIncrements[4] = 1.0;
+}
+
+void P2Quantile::Add(float Value)
+{
+	const double x = Value;
+	if (mNumSamples < 5)
+	{
+		mHeights[mNumSamples++] = x;
+		if (mNumSamples == 5)
+			std::sort(mHeights, mHeights + 5);
+		return;
+	}
+	++mNumSamples;
+
+	// cell k of the sample, extend the extremes if needed
+	int k;
+	if      (x < mHeights[0]) { mHeights[0] = x; k = 0; }
+	else if (x >= mHeights[4]) { mHeights[4] = x; k = 3; }
+	else
+	{
+		k = 0;
+		while (x >= mHeights[k + 1])
+			++k;
+	}
+	for (int i = k + 1; i < 5; ++i) mPositions[i] += 1.0;
+	for (int i = 0; i < 5; ++i)     mDesiredPositions[i] += mDesiredIncrements[i];
+
+	// move the middle markers towards their desired positions by at most 1
+	for (int i = 1; i <= 3; ++i)
+	{
+		const double d = mDesiredPositions[i] - mPositions[i];
+		if ((d >= 1.0 && mPositions[i + 1] - mPositions[i] > 1.0) || (d <= -1.0 && mPositions[i - 1] - mPositions[i] < -1.0))
+		{
+			const double s = d >= 0.0 ? 1.0 : -1.0;
+			const double* q = mHeights;
+			const double* n = mPositions;
+			const double Parabolic = q[i] + s / (n[i + 1] - n[i - 1]) *
+				( (n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])
+				+ (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]) );
+			if (q[i - 1] < Parabolic && Parabolic < q[i + 1])
+			{
+				mHeights[i] = Parabolic;
+			}
+			else
+			{
+				const int j = i + static_cast<int>(s);
+				mHeights[i] = q[i] + s * (q[j] - q[i]) / (n[j] - n[i]);
+			}
+			mPositions[i] += s;
+		}
+	}
+}
+
+float P2Quantile::Get() const
+{
+	if (mNumSamples == 0)
+		return 0.0f;
+	if (mNumSamples < 5)
+	{
+		double Sorted[5];
+		std::copy(mHeights, mHeights + mNumSamples, Sorted);
+		std::sort(Sorted, Sorted + mNumSamples);
+		const size_t Rank = static_cast<size_t>(std::lround(mQuantile * (mNumSamples - 1)));
+		return static_cast<float>(Sorted[Rank]);
+	}
+	return static_cast<float>(mHeights[2]);
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// FRAME STATISTICS
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+static constexpr float CHANNEL_QUANTILES[5] = { 0.25f, 0.50f, 0.75f, 0.90f, 0.99f };
+enum EChannelQuantile { P25 = 0, P50, P75, P90, P99 };
+
+void FrameStatistics::Initialize(size_t HistorySize)
+{
+	assert(HistorySize > 0);
+	mHistorySize = HistorySize;
+	for (FChannel& c : mChannels)
+		c.History.assign(mHistorySize, 0.0f);
+	Reset();
+}
+
+FrameStatistics::ChannelID FrameStatistics::RegisterChannel(const std::string& Name, bool bDetectOutliers)
+{
+	FChannel c;
+	c.Name = Name;
+	c.bDetectOutliers = bDetectOutliers;
+	c.History.assign(mHistorySize, 0.0f);
+	mChannels.push_back(std::move(c));
+	mFrameValues.push_back(0.0f);
+	Reset();
+	return static_cast<ChannelID>(mChannels.size() - 1);
+}
+
+void FrameStatistics::Reset()
+{
+	for (FChannel& c : mChannels)
+	{
+		std::fill(c.History.begin(), c.History.end(), 0.0f);
+		c.Sum = 0.0;
+		c.Min = FLT_MAX;
+		c.Max = -FLT_MAX;
+		for (int q = 0; q < 5; ++q)
+			c.Quantiles[q].Reset(CHANNEL_QUANTILES[q]);
+		c.NumOutliers = 0;
+	}
+	std::fill(mFrameValues.begin(), mFrameValues.end(), 0.0f);
+	mOutlierFrames.clear();
+	mHistoryHead = 0;
+	mHistoryCount = 0;
+	mNumFrames = 0;
+}
+
+void FrameStatistics::EndFrame()
+{
+	assert(mHistorySize > 0);
+	for (ChannelID i = 0; i < static_cast<ChannelID>(mChannels.size()); ++i)
+	{
+		FChannel& c = mChannels[i];
+		const float Value = mFrameValues[i];
+
+		// against the estimates before this frame, so that the outlier doesn't move its own fence
+		if (c.bDetectOutliers && c.Quantiles[P50].GetNumSamples() >= MIN_OUTLIER_DETECTION_SAMPLES)
+		{
+			const float Q1 = c.Quantiles[P25].Get();
+			const float Q3 = c.Quantiles[P75].Get();
+			const float Fence = Q3 + 3.0f * (Q3 - Q1);
+			if (Value > Fence)
+			{
+				++c.NumOutliers;
+				if (mOutlierFrames.size() == MAX_OUTLIER_FRAMES)
+					mOutlierFrames.pop_front();
+				mOutlierFrames.push_back({ mNumFrames, i, Value, Fence });
+			}
+		}
+
+		c.History[mHistoryHead] = Value;
+		c.Sum += Value;
+		c.Min = std::min(c.Min, Value);
+		c.Max = std::max(c.Max, Value);
+		for (P2Quantile& q : c.Quantiles)
+			q.Add(Value);
+	}
+	std::fill(mFrameValues.begin(), mFrameValues.end(), 0.0f);
+	mHistoryHead = (mHistoryHead + 1) % mHistorySize;
+	mHistoryCount = std::min(mHistoryCount + 1, mHistorySize);
+	++mNumFrames;
+}
+
+FrameStatistics::FChannelSummary FrameStatistics::GetSummary(ChannelID Channel) const
+{
+	const FChannel& c = mChannels[Channel];
+	FChannelSummary s = {};
+	s.NumSamples = mNumFrames;
+	if (mNumFrames == 0)
+		return s;
+	s.Mean = static_cast<float>(c.Sum / mNumFrames);
+	s.Min  = c.Min;
+	s.Max  = c.Max;
+	s.P25  = c.Quantiles[P25].Get();
+	s.P50  = c.Quantiles[P50].Get();
+	s.P75  = c.Quantiles[P75].Get();
+	s.P90  = c.Quantiles[P90].Get();
+	s.P99  = c.Quantiles[P99].Get();
+	s.NumOutliers = c.NumOutliers;
+	return s;
+}
+
+bool FrameStatistics::WriteCSV(const std::string& FilePath) const
+{
+	FILE* pFile = fopen(FilePath.c_str(), "w");
+	if (!pFile)
+		return false;
+	fprintf(pFile, "Frame");
+	for (const FChannel& c : mChannels)
+		fprintf(pFile, ",%s", c.Name.c_str());
+	fprintf(pFile, "\n");
+
+	const size_t iOldest = GetHistoryOffset();
+	const uint64 FirstFrame = mNumFrames - mHistoryCount;
+	for (size_t i = 0; i < mHistoryCount; ++i)
+	{
+		const size_t iRing = (iOldest + i) % mHistorySize;
+		fprintf(pFile, "%llu", FirstFrame + i);
+		for (const FChannel& c : mChannels)
+			fprintf(pFile, ",%.9g", c.History[iRing]);
+		fprintf(pFile, "\n");
+	}
+	fclose(pFile);
+	return true;
+}
+
+bool FrameStatistics::WriteJSON(const std::string& FilePath) const
+{
+	FILE* pFile = fopen(FilePath.c_str(), "w");
+	if (!pFile)
+		return false;
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "\t\"frames\": %llu,\n", mNumFrames);
+	fprintf(pFile, "\t\"channels\": [\n");
+	for (ChannelID i = 0; i < GetNumChannels(); ++i)
+	{
+		const FChannelSummary s = GetSummary(i);
+		fprintf(pFile, "\t\t{ \"name\": \"%s\", \"mean\": %.9g, \"min\": %.9g, \"max\": %.9g, \"p25\": %.9g, \"p50\": %.9g, \"p75\": %.9g, \"p90\": %.9g, \"p99\": %.9g, \"outliers\": %u }%s\n"
+			, mChannels[i].Name.c_str(), s.Mean, s.Min, s.Max, s.P25, s.P50, s.P75, s.P90, s.P99, s.NumOutliers
+			, i + 1 == GetNumChannels() ? "" : ","
+		);
+	}
+	fprintf(pFile, "\t],\n");
+	fprintf(pFile, "\t\"outlier_frames\": [\n");
+	for (size_t i = 0; i < mOutlierFrames.size(); ++i)
+	{
+		const FOutlierFrame& o = mOutlierFrames[i];
+		fprintf(pFile, "\t\t{ \"frame\": %llu, \"channel\": \"%s\", \"value\": %.9g, \"fence\": %.9g }%s\n"
+			, o.FrameIndex, mChannels[o.Channel].Name.c_str(), o.Value, o.Fence
+			, i + 1 == mOutlierFrames.size() ? "" : ","
+		);
+	}
+	fprintf(pFile, "\t]\n");
+	fprintf(pFile, "}\n");
+	fclose(pFile);
+	return true;
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// REGRESSION GATE
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+static std::vector<std::string> SplitCSVLine(const std::string& Line)
+{
+	std::vector<std::string> Tokens;
+	std::stringstream ss(Line);
+	std::string Token;
+	while (std::getline(ss, Token, ','))
+		Tokens.push_back(Token);
+	if (!Line.empty() && Line.back() == ',')
+		Tokens.push_back("");
+	return Tokens;
+}
+
+bool FrameStatistics::ReadCSV(const std::string& FilePath, std::vector<std::string>& OutColumns, std::vector<std::vector<float>>& OutColumnValues, std::string& OutError)
+{
+	OutColumns.clear();
+	OutColumnValues.clear();
+
+	std::ifstream file(FilePath);
+	if (!file.is_open())
+	{
+		OutError = "couldn't open " + FilePath;
+		return false;
+	}
+
+	std::string Line;
+	int iLine = 0;
+	while (std::getline(file, Line))
+	{
+		++iLine;
+		if (!Line.empty() && Line.back() == '\r')
+			Line.pop_back();
+		if (Line.empty())
+			continue;
+
+		const std::vector<std::string> Tokens = SplitCSVLine(Line);
+		if (OutColumns.empty())
+		{
+			OutColumns = Tokens;
+			OutColumnValues.resize(OutColumns.size());
+			continue;
+		}
+		if (Tokens.size() != OutColumns.size())
+		{
+			OutError = FilePath + ":" + std::to_string(iLine) + " has " + std::to_string(Tokens.size()) + " values, expected " + std::to_string(OutColumns.size());
+			return false;
+		}
+		for (size_t i = 0; i < Tokens.size(); ++i)
+			OutColumnValues[i].push_back(std::strtof(Tokens[i].c_str(), nullptr));
+	}
+
+	if (OutColumns.empty())
+	{
+		OutError = FilePath + " is empty";
+		return false;
+	}
+	return true;
+}
+
+double FrameStatistics::MannWhitneyPValue(const std::vector<float>& Baseline, const std::vector<float>& Candidate)
+{
+	const size_t n0 = Baseline.size();
+	const size_t n1 = Candidate.size();
+	if (n0 == 0 || n1 == 0)
+		return 1.0;
+
+	// rank the pooled samples, ties get their average rank
+	std::vector<std::pair<float, bool>> Pooled; // value, bCandidate
+	Pooled.reserve(n0 + n1);
+	for (float v : Baseline)  Pooled.push_back({ v, false });
+	for (float v : Candidate) Pooled.push_back({ v, true });
+	std::sort(Pooled.begin(), Pooled.end(), [](const std::pair<float, bool>& a, const std::pair<float, bool>& b) { return a.first < b.first; });
+
+	const double N = static_cast<double>(n0 + n1);
+	double CandidateRankSum = 0.0;
+	double TieCorrection = 0.0; // sum(t^3 - t) over the tie groups
+	for (size_t i = 0; i < Pooled.size();)
+	{
+		size_t j = i + 1;
+		while (j < Pooled.size() && Pooled[j].first == Pooled[i].first)
+			++j;
+		const double AverageRank = 0.5 * (static_cast<double>(i + 1) + static_cast<double>(j));
+		for (size_t k = i; k < j; ++k)
+			if (Pooled[k].second)
+				CandidateRankSum += AverageRank;
+		const double t = static_cast<double>(j - i);
+		TieCorrection += t * t * t - t;
+		i = j;
+	}
+
+	// normal approximation of U w/ tie & continuity corrections
+	const double U        = CandidateRankSum - 0.5 * n1 * (n1 + 1.0);
+	const double Mean     = 0.5 * n0 * n1;
+	const double Variance = n0 * n1 / 12.0 * ((N + 1.0) - TieCorrection / (N * (N - 1.0)));
+	if (Variance <= 0.0)
+		return 1.0; // all samples equal
+	const double z = (U - Mean - 0.5) / std::sqrt(Variance);
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+static float Median(std::vector<float> Values)
+{
+	if (Values.empty())
+		return 0.0f;
+	const size_t Mid = Values.size() / 2;
+	std::nth_element(Values.begin(), Values.begin() + Mid, Values.end());
+	if (Values.size() % 2 == 1)
+		return Values[Mid];
+	const float Upper = Values[Mid];
+	return 0.5f * (Upper + *std::max_element(Values.begin(), Values.begin() + Mid));
+}
+
+static bool IsTimingColumn(const std::string& Name)
+{
+	return Name.size() > 2 && Name.compare(Name.size() - 2, 2, "Ms") == 0;
+}
+
+bool FrameStatistics::CompareRuns(const std::string& BaselineCSVFilePath, const std::string& CandidateCSVFilePath, const FRegressionTestParameters& Params, FRunComparison& OutComparison)
+{
+	constexpr size_t MIN_FRAMES = 8;
+	OutComparison = {};
+
+	std::vector<std::string> BaselineColumns, CandidateColumns;
+	std::vector<std::vector<float>> BaselineValues, CandidateValues;
+	if (!ReadCSV(BaselineCSVFilePath, BaselineColumns, BaselineValues, OutComparison.Error) || !ReadCSV(CandidateCSVFilePath, CandidateColumns, CandidateValues, OutComparison.Error))
+		return false;
+
+	for (size_t iBaseline = 0; iBaseline < BaselineColumns.size(); ++iBaseline)
+	{
+		const std::string& Name = BaselineColumns[iBaseline];
+		if (!IsTimingColumn(Name))
+			continue;
+		const auto itCandidate = std::find(CandidateColumns.begin(), CandidateColumns.end(), Name);
+		if (itCandidate == CandidateColumns.end())
+		{
+			OutComparison.SkippedStages.push_back(Name + " : missing in the candidate run");
+			continue;
+		}
+		const std::vector<float>& b = BaselineValues[iBaseline];
+		const std::vector<float>& c = CandidateValues[itCandidate - CandidateColumns.begin()];
+		if (b.size() < MIN_FRAMES || c.size() < MIN_FRAMES)
+		{
+			OutComparison.SkippedStages.push_back(Name + " : too few frames (" + std::to_string(b.size()) + ", " + std::to_string(c.size()) + ")");
+			continue;
+		}
+
+		FStageComparison r;
+		r.Name               = Name;
+		r.NumBaselineFrames  = static_cast<uint32>(b.size());
+		r.NumCandidateFrames = static_cast<uint32>(c.size());
+		r.BaselineMedian     = Median(b);
+		r.CandidateMedian    = Median(c);
+		r.ChangePercent      = r.BaselineMedian > 0.0f ? 100.0f * (r.CandidateMedian - r.BaselineMedian) / r.BaselineMedian : 0.0f;
+		r.PValue             = MannWhitneyPValue(b, c);
+		r.bRegression        = r.PValue < Params.SignificanceLevel
+			&& r.ChangePercent > Params.MaxRegressionPercent
+			&& r.CandidateMedian - r.BaselineMedian > Params.MinRegressionMs;
+		OutComparison.NumRegressions += r.bRegression ? 1 : 0;
+		OutComparison.Stages.push_back(std::move(r));
+	}
+
+	if (OutComparison.Stages.empty())
+	{
+		OutComparison.Error = "no common timing columns";
+		return false;
+	}
+	return OutComparison.NumRegressions == 0;
+}
+
+std::string FrameStatistics::FormatComparison(const FRunComparison& Comparison, const FRegressionTestParameters& Params)
+{
+	if (!Comparison.Error.empty())
+		return "error: " + Comparison.Error + "\n";
+
+	std::string Report;
+	char Line[256];
+	for (const FStageComparison& r : Comparison.Stages)
+	{
+		snprintf(Line, sizeof(Line), "  %-28s : median %8.3f -> %8.3f ms (%+6.1f%%)  p=%.4f%s\n"
+			, r.Name.c_str(), r.BaselineMedian, r.CandidateMedian, r.ChangePercent, r.PValue, r.bRegression ? "  REGRESSION" : "");
+		Report += Line;
+	}
+	for (const std::string& Skipped : Comparison.SkippedStages)
+		Report += "  " + Skipped + ", skipped\n";
+	snprintf(Line, sizeof(Line), "%d stages, %u regressions (threshold %.1f%% & %.2fms, p < %.3f)\n"
+		, static_cast<int>(Comparison.Stages.size()), Comparison.NumRegressions, Params.MaxRegressionPercent, Params.MinRegressionMs, Params.SignificanceLevel);
+	Report += Line;
+	return Report;
+}
@@ -0,0 +1,168 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+//
+// P2 QUANTILE
+//
+// Streaming quantile estimate in O(1) memory: the P-square algorithm of Jain & Chlamtac (1985).
+// Five markers track min, p/2, p, (1+p)/2 and max, the middle ones are moved w/ piecewise-parabolic
+// interpolation as the samples come in. Exact for the first 5 samples.
+//
+class P2Quantile
+{
+public:
+	P2Quantile(float Quantile = 0.5f) { Reset(Quantile); }
+	void  Reset(float Quantile);
+	void  Add(float Value);
+	float Get() const;
+	inline uint64 GetNumSamples() const { return mNumSamples; }
+
+private:
+	float  mQuantile;
+	uint64 mNumSamples;
+	double mHeights[5];          // marker values
+	double mPositions[5];        // actual marker positions (1-based ranks)
+	double mDesiredPositions[5];
+	double mDesiredIncrements[5];
+};
+
+//
+// FRAME STATISTICS
+//
+// Per-frame history of named channels (CPU stage timings, scene counters).
+// - Record() the channel values during a frame, EndFrame() commits them: the last HistorySize frames are kept
+//   in a ring buffer per channel & every frame since the last Reset() goes into the running mean/min/max and
+//   P2 estimates of P25, P50, P75, P90, P99.
+// - Outlier frames: channels registered w/ bDetectOutliers flag a frame whose value is above the Tukey far-out
+//   fence P75 + 3 * (P75 - P25) of the running estimates, after MIN_OUTLIER_DETECTION_SAMPLES frames.
+// - WriteCSV() exports the history (one row per frame, one column per channel), WriteJSON() the summaries & outliers.
+//
+// CompareRuns() is the regression gate: the timing columns (name ending in "Ms") of two CSVs, e.g. from WriteCSV()
+// or CameraBenchmark::WriteResults(), are compared w/ a one-sided Mann-Whitney U test. A stage regresses when the
+// candidate is significantly slower and its median grew beyond both the relative and the absolute thresholds.
+// Only depends on the standard library: Tools/FrameStatsCompare.cpp runs the gate outside the engine.
+//
+class FrameStatistics
+{
+public:
+	using ChannelID = uint32;
+	static constexpr uint32 MIN_OUTLIER_DETECTION_SAMPLES = 32;
+	static constexpr size_t MAX_OUTLIER_FRAMES            = 256; // most recent ones are kept
+
+	struct FChannelSummary
+	{
+		uint64 NumSamples;
+		float  Mean;
+		float  Min;
+		float  Max;
+		float  P25;
+		float  P50;
+		float  P75;
+		float  P90;
+		float  P99;
+		uint32 NumOutliers;
+	};
+	struct FOutlierFrame
+	{
+		uint64    FrameIndex;
+		ChannelID Channel;
+		float     Value;
+		float     Fence;
+	};
+
+	struct FRegressionTestParameters
+	{
+		float MaxRegressionPercent = 5.0f;  // median increase allowed
+		float MinRegressionMs      = 0.05f; // ignore regressions smaller than this, for the sub-millisecond stages
+		float SignificanceLevel    = 0.01f; // one-sided p-value
+	};
+	struct FStageComparison
+	{
+		std::string Name;
+		uint32      NumBaselineFrames;
+		uint32      NumCandidateFrames;
+		float       BaselineMedian;
+		float       CandidateMedian;
+		float       ChangePercent;
+		double      PValue; // P(candidate isn't slower), small when it is
+		bool        bRegression;
+	};
+	struct FRunComparison
+	{
+		std::vector<FStageComparison> Stages;
+		std::vector<std::string>      SkippedStages;  // "<name> : <reason>"
+		std::string                   Error;          // set if the runs couldn't be compared
+		uint32                        NumRegressions = 0;
+	};
+
+public:
+	void Initialize(size_t HistorySize);
+	ChannelID RegisterChannel(const std::string& Name, bool bDetectOutliers);
+	void Reset(); // clears the history, estimates & outliers, keeps the channels
+
+	inline void Record(ChannelID Channel, float Value) { mFrameValues[Channel] = Value; }
+	void        EndFrame();
+
+	inline uint32             GetNumChannels() const                 { return static_cast<uint32>(mChannels.size()); }
+	inline const std::string& GetChannelName(ChannelID Channel) const { return mChannels[Channel].Name; }
+	inline uint64             GetNumFrames() const                   { return mNumFrames; }
+	FChannelSummary           GetSummary(ChannelID Channel) const;
+	inline const std::deque<FOutlierFrame>& GetOutlierFrames() const { return mOutlierFrames; }
+
+	// ring buffer access for plotting, e.g. ImGui::PlotLines(..., GetHistoryData(c), GetHistoryCount(), GetHistoryOffset())
+	inline const float* GetHistoryData(ChannelID Channel) const { return mChannels[Channel].History.data(); }
+	inline size_t       GetHistoryCount() const                 { return mHistoryCount; }
+	inline size_t       GetHistoryOffset() const                { return mHistoryCount < mHistorySize ? 0 : mHistoryHead; } // oldest frame
+
+	bool WriteCSV(const std::string& FilePath) const;  // false if the file can't be opened
+	bool WriteJSON(const std::string& FilePath) const; // false if the file can't be opened
+
+	// regression gate
+	static bool        ReadCSV(const std::string& FilePath, std::vector<std::string>& OutColumns, std::vector<std::vector<float>>& OutColumnValues, std::string& OutError);
+	static double      MannWhitneyPValue(const std::vector<float>& Baseline, const std::vector<float>& Candidate); // H1: candidate > baseline
+	static bool        CompareRuns(const std::string& BaselineCSVFilePath, const std::string& CandidateCSVFilePath, const FRegressionTestParameters& Params, FRunComparison& OutComparison); // false on regression or error
+	static std::string FormatComparison(const FRunComparison& Comparison, const FRegressionTestParameters& Params); // one line per stage + summary
+
+private:
+	struct FChannel
+	{
+		std::string        Name;
+		bool               bDetectOutliers;
+		std::vector<float> History;
+		double             Sum;
+		float              Min;
+		float              Max;
+		P2Quantile         Quantiles[5]; // P25, P50, P75, P90, P99
+		uint32             NumOutliers;
+	};
+
+	std::vector<FChannel>     mChannels;
+	std::vector<float>        mFrameValues;
+	std::deque<FOutlierFrame> mOutlierFrames;
+	size_t                    mHistorySize = 0;
+	size_t                    mHistoryHead = 0; // next write
+	size_t                    mHistoryCount = 0;
+	uint64                    mNumFrames = 0;
+};
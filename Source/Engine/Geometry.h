@@ -498,7 +498,7 @@ namespace GeometryGenerator
 				// Cap center vertex.
 				TVertex capCenter;
 				                            SetFVec<3>(capCenter.position, { 0.0f, y, 0.0f });
-				                            SetFVec<3>(capCenter.uv      , {0.5f, 0.5f});
+				                            SetFVec<2>(capCenter.uv      , {0.5f, 0.5f});
 				if constexpr (bHasNormals)  SetFVec<3>(capCenter.normal  , {0.0f, 1.0f, 0.0f});
 				if constexpr (bHasTangents) SetFVec<3>(capCenter.tangent , {1.0f, 0.0f, 0.0f});
 				Vertices.push_back(capCenter);
@@ -541,7 +541,7 @@ namespace GeometryGenerator
 				// Cap center vertex
 				TVertex capCenter;
 				                            SetFVec<3>(capCenter.position, { 0.0f, y, 0.0f });
-				                            SetFVec<3>(capCenter.uv      , {0.5f, 0.5f});
+				                            SetFVec<2>(capCenter.uv      , {0.5f, 0.5f});
 				if constexpr (bHasNormals)  SetFVec<3>(capCenter.normal  , {0.0f, -1.0f, 0.0f});
 				if constexpr (bHasTangents) SetFVec<3>(capCenter.tangent , {-1.0f, 0.0f, 0.0f});
 				Vertices.push_back(capCenter);
@@ -656,8 +656,10 @@ namespace GeometryGenerator
 			// Add one because we duplicate the first and last vertex per ring since the texture coordinates are different.
 			unsigned ringVertexCount = LODSliceCounts[LOD] + 1;
 
-			// Compute indices for each stack.
-			for (unsigned i = 0; i < LODRingCounts[LOD]; ++i)
+			// Compute indices for each stack: the phi loop above may generate one less ring due to float error,
+			// derive the ring count from the vertices so the indices stay in range.
+			const unsigned numRings = static_cast<unsigned>(Vertices.size()) / ringVertexCount;
+			for (unsigned i = 0; i + 1 < numRings; ++i)
 			{
 				for (unsigned j = 0; j < LODSliceCounts[LOD]; ++j)
 				{
@@ -699,7 +701,7 @@ namespace GeometryGenerator
 		// using a simple lerp between min levels and given parameters
 		for (int LOD = 0; LOD < numLODLevels; ++LOD)
 		{
-			const float t = static_cast<float>(LOD) / (numLODLevels - 1);
+			const float t = static_cast<float>(LOD) / (numLODLevels > 1 ? (numLODLevels - 1) : 1);
 			LODSliceCounts[LOD] = MathUtil::lerp(MIN_SLICE_COUNT, numSlices, 1.0f - t);
 		}
 
@@ -854,5 +856,75 @@ namespace GeometryGenerator
 		return data[0];
 	}
 
+	//
+	// GRID
+	//
+	// flat grid on the XZ plane w/ tilingX x tilingY quads, centered at the origin
+	// 
+	//		  V(0,0)          V(tilingX,0)  ^ Z
+	//		^	+-------+-------+ ^         |
+	//		|	|     / |     / | |         |
+	//		d	|   /   |   /   | dz        +--------> X
+	//		|	| /     | /     | v
+	//		v	+-------+-------+
+	//			<--dx--->         V(tilingX, tilingY)
+	//			<------ w ------>
+	//
+	template<class TVertex, class TIndex>
+	constexpr GeometryData<TVertex, TIndex> Grid(float width, float depth, unsigned tilingX, unsigned tilingY, int numLODLevels /*= 1*/)
+	{
+		assert(numLODLevels == 1); // currently only 1 LOD level is supported: function signature will need updating
+		assert(tilingX > 0 && tilingY > 0);
+
+		constexpr bool bHasTangents = std::is_same<TVertex, FVertexWithNormalAndTangent>();
+		constexpr bool bHasNormals  = std::is_same<TVertex, FVertexWithNormal>() || std::is_same<TVertex, FVertexWithNormalAndTangent>();
+
+		GeometryData<TVertex, TIndex> data;
+		std::vector<TVertex>& Vertices = data.Vertices;
+		std::vector<TIndex>&  Indices  = data.Indices;
+
+		const unsigned NumVertsX = tilingX + 1;
+		const unsigned NumVertsZ = tilingY + 1;
+		const float dx = width / tilingX;
+		const float dz = depth / tilingY;
+
+		Vertices.reserve(NumVertsX * NumVertsZ);
+		for (unsigned i = 0; i < NumVertsZ; ++i)
+		{
+			for (unsigned j = 0; j < NumVertsX; ++j)
+			{
+				TVertex vertex;
+				SetFVec<3>(vertex.position, { -0.5f * width + j * dx, 0.0f, 0.5f * depth - i * dz });
+				SetFVec<2>(vertex.uv, { static_cast<float>(j) / tilingX, static_cast<float>(i) / tilingY });
+				if constexpr (bHasNormals) { SetFVec<3>(vertex.normal , { 0.0f, 1.0f, 0.0f }); }
+				if constexpr (bHasTangents){ SetFVec<3>(vertex.tangent, { 1.0f, 0.0f, 0.0f }); }
+				Vertices.push_back(vertex);
+			}
+		}
+
+		//	  A	+------+ B
+		//		|	 / |
+		//		|	/  |
+		//		|  /   |
+		//	  C	+------+ D
+		//
+		//	ABC, CBD
+		Indices.reserve(tilingX * tilingY * 6);
+		for (unsigned i = 0; i < tilingY; ++i)
+		{
+			for (unsigned j = 0; j < tilingX; ++j)
+			{
+				const TIndex A = static_cast<TIndex>(i * NumVertsX + j);
+				const TIndex B = static_cast<TIndex>(A + 1);
+				const TIndex C = static_cast<TIndex>(A + NumVertsX);
+				const TIndex D = static_cast<TIndex>(C + 1);
+				Indices.push_back(A); Indices.push_back(B); Indices.push_back(C);
+				Indices.push_back(C); Indices.push_back(B); Indices.push_back(D);
+			}
+		}
+
+		return data;
+	}
+
 }; // namespace GeometryGenerator
 
@@ -0,0 +1,432 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "GeometryDeduplication.h"
+#include "../Renderer/Buffer.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <future>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	using FTriangle = std::array<uint32, 3>;
+
+	struct FCanonicalGeometry
+	{
+		bool                   bValid = false;
+		uint64                 Key = 0;
+		std::vector<FTriangle> Triangles; // rotated to start at the smallest index & sorted
+		double                 Diagonal = 0.0;
+	};
+
+	// row vector convention: p' = p * L + T
+	struct FAffineTransform
+	{
+		double L[3][3];
+		double T[3];
+	};
+}
+
+static uint64 HashBytes(const void* pData, size_t NumBytes, uint64 Hash)
+{
+	// FNV-1a
+	const uint8* p = static_cast<const uint8*>(pData);
+	for (size_t i = 0; i < NumBytes; ++i)
+	{
+		Hash ^= p[i];
+		Hash *= 1099511628211ull;
+	}
+	return Hash;
+}
+
+template<class TFunc>
+static void ParallelFor(size_t NumItems, ThreadPool* pWorkerThreadPool, TFunc&& fnProcess)
+{
+	const size_t NumThreads = pWorkerThreadPool ? std::min(NumItems, pWorkerThreadPool->GetThreadPoolSize() + 1) : 1;
+	if (NumThreads <= 1)
+	{
+		for (size_t i = 0; i < NumItems; ++i)
+			fnProcess(i);
+		return;
+	}
+
+	// contiguous ranges, the first one is processed on this thread
+	std::vector<std::future<void>> Tasks;
+	const size_t NumItemsPerThread = (NumItems + NumThreads - 1) / NumThreads;
+	for (size_t iBegin = NumItemsPerThread; iBegin < NumItems; iBegin += NumItemsPerThread)
+	{
+		const size_t iEnd = std::min(iBegin + NumItemsPerThread, NumItems);
+		Tasks.push_back(pWorkerThreadPool->AddTask([&fnProcess, iBegin, iEnd]()
+		{
+			for (size_t i = iBegin; i < iEnd; ++i)
+				fnProcess(i);
+		}));
+	}
+	for (size_t i = 0; i < std::min(NumItemsPerThread, NumItems); ++i)
+		fnProcess(i);
+	for (std::future<void>& Task : Tasks)
+		Task.wait();
+}
+
+static void CanonicalizeGeometry(const GeometryDeduplicator::FGeometry& g, FCanonicalGeometry& c)
+{
+	c.bValid = g.pVertices && g.pIndices && g.NumVertices > 0 && g.NumIndices > 0 && g.NumIndices % 3 == 0;
+	if (!c.bValid)
+		return;
+
+	c.Triangles.resize(g.NumIndices / 3);
+	for (size_t iTri = 0; iTri < c.Triangles.size(); ++iTri)
+	{
+		const uint32 i0 = g.pIndices[iTri * 3 + 0];
+		const uint32 i1 = g.pIndices[iTri * 3 + 1];
+		const uint32 i2 = g.pIndices[iTri * 3 + 2];
+		if (i0 >= g.NumVertices || i1 >= g.NumVertices || i2 >= g.NumVertices)
+		{
+			c.bValid = false; // out of range indices, keep the geometry as is
+			return;
+		}
+
+		// rotate, keeping the winding order
+		if      (i1 < i0 && i1 < i2) c.Triangles[iTri] = { i1, i2, i0 };
+		else if (i2 < i0 && i2 < i1) c.Triangles[iTri] = { i2, i0, i1 };
+		else                         c.Triangles[iTri] = { i0, i1, i2 };
+	}
+	std::sort(c.Triangles.begin(), c.Triangles.end());
+
+	c.Key = HashBytes(&g.NumVertices, sizeof(g.NumVertices), 14695981039346656037ull);
+	c.Key = HashBytes(c.Triangles.data(), c.Triangles.size() * sizeof(FTriangle), c.Key);
+
+	double Min[3] = { g.pVertices[0].position[0], g.pVertices[0].position[1], g.pVertices[0].position[2] };
+	double Max[3] = { Min[0], Min[1], Min[2] };
+	for (uint32 i = 1; i < g.NumVertices; ++i)
+	{
+		for (int d = 0; d < 3; ++d)
+		{
+			Min[d] = std::min<double>(Min[d], g.pVertices[i].position[d]);
+			Max[d] = std::max<double>(Max[d], g.pVertices[i].position[d]);
+		}
+	}
+	c.Diagonal = std::sqrt((Max[0] - Min[0]) * (Max[0] - Min[0]) + (Max[1] - Min[1]) * (Max[1] - Min[1]) + (Max[2] - Min[2]) * (Max[2] - Min[2]));
+}
+
+//
+// VECTOR MATH
+//
+static inline double Dot(const double a[3], const double b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+static inline void Cross(const double a[3], const double b[3], double o[3])
+{
+	o[0] = a[1] * b[2] - a[2] * b[1];
+	o[1] = a[2] * b[0] - a[0] * b[2];
+	o[2] = a[0] * b[1] - a[1] * b[0];
+}
+static inline void Sub(const float a[3], const float b[3], double o[3]) { for (int d = 0; d < 3; ++d) o[d] = static_cast<double>(a[d]) - b[d]; }
+static inline double Determinant(const double m[3][3])
+{
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+		 - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+		 + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+static bool Inverse(const double m[3][3], double o[3][3])
+{
+	const double Det = Determinant(m);
+	if (std::abs(Det) < 1e-30)
+		return false;
+	const double InvDet = 1.0 / Det;
+	o[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * InvDet;
+	o[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * InvDet;
+	o[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * InvDet;
+	o[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * InvDet;
+	o[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * InvDet;
+	o[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * InvDet;
+	o[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * InvDet;
+	o[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * InvDet;
+	o[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * InvDet;
+	return true;
+}
+static inline void TransformRow(const double v[3], const double m[3][3], double o[3])
+{
+	for (int c = 0; c < 3; ++c)
+		o[c] = v[0] * m[0][c] + v[1] * m[1][c] + v[2] * m[2][c];
+}
+
+// zero vectors only match zero vectors: geometries w/o normals or tangents
+static bool DirectionsMatch(const double a[3], const float b[3], float AttributeTolerance)
+{
+	const double LenA = std::sqrt(Dot(a, a));
+	const double LenB = std::sqrt(static_cast<double>(b[0]) * b[0] + static_cast<double>(b[1]) * b[1] + static_cast<double>(b[2]) * b[2]);
+	if (LenA < 1e-12 || LenB < 1e-12)
+		return LenA < 1e-12 && LenB < 1e-12;
+	const double CosAngle = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / (LenA * LenB);
+	return 1.0 - CosAngle <= AttributeTolerance;
+}
+
+static bool UVsMatch(const FVertexWithNormalAndTangent& a, const FVertexWithNormalAndTangent& b, float AttributeTolerance)
+{
+	return std::abs(a.uv[0] - b.uv[0]) <= AttributeTolerance && std::abs(a.uv[1] - b.uv[1]) <= AttributeTolerance;
+}
+
+static bool MatchExact(const GeometryDeduplicator::FGeometry& Src, const GeometryDeduplicator::FGeometry& Dst, double PositionTolerance, float AttributeTolerance)
+{
+	const double PositionTolerance2 = PositionTolerance * PositionTolerance;
+	for (uint32 i = 0; i < Dst.NumVertices; ++i)
+	{
+		const FVertexWithNormalAndTangent& s = Src.pVertices[i];
+		const FVertexWithNormalAndTangent& d = Dst.pVertices[i];
+		double Delta[3]; Sub(s.position, d.position, Delta);
+		const double n[3] = { s.normal[0], s.normal[1], s.normal[2] };
+		const double t[3] = { s.tangent[0], s.tangent[1], s.tangent[2] };
+		if (!(Dot(Delta, Delta) <= PositionTolerance2) // NaNs don't match
+			|| !UVsMatch(s, d, AttributeTolerance)
+			|| !DirectionsMatch(n, d.normal, AttributeTolerance)
+			|| !DirectionsMatch(t, d.tangent, AttributeTolerance))
+			return false;
+	}
+	return true;
+}
+
+// Solves the transform from 4 anchor vertices of Src: the first one, the farthest one from it, the farthest one
+// from the line they make & the farthest one from the plane of the 3. Planar geometries get a 4th anchor along
+// the plane normal, scaled w/ the first edge. Fails on degenerate anchors & mirroring transforms.
+static bool SolveTransform(const GeometryDeduplicator::FGeometry& Src, const GeometryDeduplicator::FGeometry& Dst, FAffineTransform& Out)
+{
+	const float* a0 = Src.pVertices[0].position;
+	uint32 i1 = 0, i2 = 0, i3 = 0;
+	double MaxDist = 0.0;
+	for (uint32 i = 1; i < Src.NumVertices; ++i)
+	{
+		double v[3]; Sub(Src.pVertices[i].position, a0, v);
+		const double Dist = Dot(v, v);
+		if (Dist > MaxDist) { MaxDist = Dist; i1 = i; }
+	}
+	if (MaxDist < 1e-20)
+		return false;
+
+	double e1[3]; Sub(Src.pVertices[i1].position, a0, e1);
+	MaxDist = 0.0;
+	for (uint32 i = 1; i < Src.NumVertices; ++i)
+	{
+		double v[3], c[3]; Sub(Src.pVertices[i].position, a0, v);
+		Cross(e1, v, c);
+		const double Dist = Dot(c, c);
+		if (Dist > MaxDist) { MaxDist = Dist; i2 = i; }
+	}
+	if (MaxDist < 1e-12 * Dot(e1, e1) * Dot(e1, e1))
+		return false; // collinear
+
+	double e2[3], n[3]; Sub(Src.pVertices[i2].position, a0, e2);
+	Cross(e1, e2, n);
+	MaxDist = 0.0;
+	for (uint32 i = 1; i < Src.NumVertices; ++i)
+	{
+		double v[3]; Sub(Src.pVertices[i].position, a0, v);
+		const double Dist = std::abs(Dot(v, n));
+		if (Dist > MaxDist) { MaxDist = Dist; i3 = i; }
+	}
+
+	const float* b0 = Dst.pVertices[0].position;
+	double A[3][3], B[3][3];
+	Sub(Src.pVertices[i1].position, a0, A[0]); Sub(Dst.pVertices[i1].position, b0, B[0]);
+	Sub(Src.pVertices[i2].position, a0, A[1]); Sub(Dst.pVertices[i2].position, b0, B[1]);
+	const double LenE1 = std::sqrt(Dot(A[0], A[0]));
+	const double LenN  = std::sqrt(Dot(n, n));
+	const bool bPlanar = MaxDist < 1e-6 * LenN * LenE1;
+	if (bPlanar)
+	{
+		double nb[3]; Cross(B[0], B[1], nb);
+		const double LenNB = std::sqrt(Dot(nb, nb));
+		const double LenB1 = std::sqrt(Dot(B[0], B[0]));
+		if (LenNB < 1e-20)
+			return false;
+		for (int d = 0; d < 3; ++d)
+		{
+			A[2][d] = n[d] / LenN * LenE1;
+			B[2][d] = nb[d] / LenNB * LenB1;
+		}
+	}
+	else
+	{
+		Sub(Src.pVertices[i3].position, a0, A[2]); Sub(Dst.pVertices[i3].position, b0, B[2]);
+	}
+
+	// A * L = B
+	double InvA[3][3];
+	if (!Inverse(A, InvA))
+		return false;
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 3; ++c)
+			Out.L[r][c] = InvA[r][0] * B[0][c] + InvA[r][1] * B[1][c] + InvA[r][2] * B[2][c];
+	if (Determinant(Out.L) <= 0.0)
+		return false; // mirrored: the winding order would flip
+
+	const double a0d[3] = { a0[0], a0[1], a0[2] };
+	double a0L[3]; TransformRow(a0d, Out.L, a0L);
+	for (int d = 0; d < 3; ++d)
+		Out.T[d] = b0[d] - a0L[d];
+	return true;
+}
+
+static bool MatchTransformed(const GeometryDeduplicator::FGeometry& Src, const GeometryDeduplicator::FGeometry& Dst, const FAffineTransform& Xform, double PositionTolerance, float AttributeTolerance)
+{
+	// normals transform w/ the inverse transpose
+	double InvL[3][3], NormalMatrix[3][3];
+	if (!Inverse(Xform.L, InvL))
+		return false;
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 3; ++c)
+			NormalMatrix[r][c] = InvL[c][r];
+
+	const double PositionTolerance2 = PositionTolerance * PositionTolerance;
+	for (uint32 i = 0; i < Dst.NumVertices; ++i)
+	{
+		const FVertexWithNormalAndTangent& s = Src.pVertices[i];
+		const FVertexWithNormalAndTangent& d = Dst.pVertices[i];
+
+		const double p[3] = { s.position[0], s.position[1], s.position[2] };
+		double pT[3]; TransformRow(p, Xform.L, pT);
+		const double Delta[3] = { pT[0] + Xform.T[0] - d.position[0], pT[1] + Xform.T[1] - d.position[1], pT[2] + Xform.T[2] - d.position[2] };
+		if (!(Dot(Delta, Delta) <= PositionTolerance2) || !UVsMatch(s, d, AttributeTolerance))
+			return false;
+
+		const double n[3] = { s.normal[0], s.normal[1], s.normal[2] };
+		const double t[3] = { s.tangent[0], s.tangent[1], s.tangent[2] };
+		double nT[3], tT[3];
+		TransformRow(n, NormalMatrix, nT);
+		TransformRow(t, Xform.L, tT);
+		if (!DirectionsMatch(nT, d.normal, AttributeTolerance) || !DirectionsMatch(tT, d.tangent, AttributeTolerance))
+			return false;
+	}
+	return true;
+}
+
+static XMFLOAT4X4 ToFloat4x4(const FAffineTransform& Xform)
+{
+	XMFLOAT4X4 m = {};
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 3; ++c)
+			m.m[r][c] = static_cast<float>(Xform.L[r][c]);
+	for (int c = 0; c < 3; ++c)
+		m.m[3][c] = static_cast<float>(Xform.T[c]);
+	m.m[3][3] = 1.0f;
+	return m;
+}
+
+static XMFLOAT4X4 IdentityFloat4x4()
+{
+	XMFLOAT4X4 m = {};
+	m.m[0][0] = m.m[1][1] = m.m[2][2] = m.m[3][3] = 1.0f;
+	return m;
+}
+
+GeometryDeduplicator::FResult GeometryDeduplicator::Deduplicate(const std::vector<FGeometry>& Geometries, const FSettings& Settings, ThreadPool* pWorkerThreadPool)
+{
+	Timer t; t.Start();
+	const size_t NumGeometries = Geometries.size();
+
+	FResult Result;
+	Result.SourceIndices.resize(NumGeometries);
+	Result.Matches.resize(NumGeometries, EMatch::UNIQUE);
+	Result.Transforms.resize(NumGeometries, IdentityFloat4x4());
+	for (size_t i = 0; i < NumGeometries; ++i)
+		Result.SourceIndices[i] = static_cast<uint32>(i);
+
+	std::vector<FCanonicalGeometry> Canonical(NumGeometries);
+	ParallelFor(NumGeometries, pWorkerThreadPool, [&](size_t i) { CanonicalizeGeometry(Geometries[i], Canonical[i]); });
+
+	// buckets & the geometries in them are in input order
+	std::unordered_map<uint64, uint32> BucketLookup;
+	std::vector<std::vector<uint32>> Buckets;
+	for (size_t i = 0; i < NumGeometries; ++i)
+	{
+		if (!Canonical[i].bValid)
+			continue;
+		auto it = BucketLookup.find(Canonical[i].Key);
+		if (it == BucketLookup.end())
+		{
+			it = BucketLookup.emplace(Canonical[i].Key, static_cast<uint32>(Buckets.size())).first;
+			Buckets.emplace_back();
+		}
+		Buckets[it->second].push_back(static_cast<uint32>(i));
+	}
+
+	ParallelFor(Buckets.size(), pWorkerThreadPool, [&](size_t iBucket)
+	{
+		std::vector<uint32> Sources;
+		for (uint32 i : Buckets[iBucket])
+		{
+			const FGeometry& g = Geometries[i];
+			const double PositionTolerance = Settings.PositionTolerance * Canonical[i].Diagonal;
+			auto fnSameTopology = [&](uint32 s) { return Canonical[s].Triangles == Canonical[i].Triangles; }; // the key may collide
+
+			uint32 iSource = i;
+			for (uint32 s : Sources)
+			{
+				const FGeometry& src = Geometries[s];
+				const bool bSameData = src.pVertices == g.pVertices && src.pIndices == g.pIndices && src.NumIndices == g.NumIndices;
+				if (bSameData || (fnSameTopology(s) && MatchExact(src, g, PositionTolerance, Settings.AttributeTolerance)))
+				{
+					iSource = s;
+					Result.Matches[i] = EMatch::EXACT_DUPLICATE;
+					break;
+				}
+			}
+			for (size_t iSrc = 0; iSource == i && Settings.bDetectTransformedCopies && iSrc < Sources.size(); ++iSrc)
+			{
+				const uint32 s = Sources[iSrc];
+				FAffineTransform Xform;
+				if (fnSameTopology(s) && SolveTransform(Geometries[s], g, Xform) && MatchTransformed(Geometries[s], g, Xform, PositionTolerance, Settings.AttributeTolerance))
+				{
+					iSource = s;
+					Result.Matches[i] = EMatch::TRANSFORMED_COPY;
+					Result.Transforms[i] = ToFloat4x4(Xform);
+				}
+			}
+
+			Result.SourceIndices[i] = iSource;
+			if (iSource == i)
+				Sources.push_back(i);
+		}
+	});
+
+	FStatistics& s = Result.Stats;
+	s.NumGeometries = static_cast<uint32>(NumGeometries);
+	for (size_t i = 0; i < NumGeometries; ++i)
+	{
+		const uint64 Bytes = static_cast<uint64>(Geometries[i].NumVertices) * sizeof(FVertexWithNormalAndTangent) + static_cast<uint64>(Geometries[i].NumIndices) * sizeof(uint32);
+		s.InputBytes += Bytes;
+		switch (Result.Matches[i])
+		{
+		case EMatch::UNIQUE          : ++s.NumUniqueGeometries; s.UniqueBytes += Bytes; break;
+		case EMatch::EXACT_DUPLICATE : ++s.NumExactDuplicates;   break;
+		case EMatch::TRANSFORMED_COPY: ++s.NumTransformedCopies; break;
+		default: assert(false); break;
+		}
+	}
+	s.SavedBytes = s.InputBytes - s.UniqueBytes;
+	s.DedupRatio = s.UniqueBytes > 0 ? static_cast<float>(static_cast<double>(s.InputBytes) / s.UniqueBytes) : 1.0f;
+	s.DeduplicationTimeMs = t.Tick() * 1000.0f;
+	return Result;
+}
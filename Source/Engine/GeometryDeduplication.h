@@ -0,0 +1,97 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <DirectXMath.h>
+
+#include <vector>
+
+struct FVertexWithNormalAndTangent;
+class ThreadPool;
+
+//
+// GEOMETRY DEDUPLICATOR
+//
+// Finds the geometries of an imported model that can share the vertex & index buffers of another one.
+//
+// - Geometries are bucketed by their vertex count and a hash of their canonicalized index stream:
+//   triangles are rotated to start at their smallest index (winding is kept) and sorted, so copies
+//   w/ a different triangle order land in the same bucket and can share the same buffers.
+// - Vertex streams aren't hashed: positions differ between transformed copies and a tolerance grid
+//   would split near-equal values. Candidates are verified vertex by vertex instead, against the
+//   geometries already kept in their bucket: first as exact duplicates, then as transformed copies
+//   w/ an affine, non-mirroring transform solved from 4 anchor vertices. Normals, tangents & UVs
+//   have to match too, within the attribute tolerance.
+// - Canonicalization runs in parallel per geometry, matching in parallel per bucket. The first
+//   geometry of a group is its source and groups are formed in input order, so the result
+//   doesn't depend on the thread count.
+//
+class GeometryDeduplicator
+{
+public:
+	struct FGeometry // non-owning, triangle list
+	{
+		const FVertexWithNormalAndTangent* pVertices = nullptr;
+		uint32                             NumVertices = 0;
+		const uint32*                      pIndices = nullptr;
+		uint32                             NumIndices = 0;
+	};
+
+	struct FSettings
+	{
+		float PositionTolerance  = 1e-4f; // relative to the bounding box diagonal of the geometry
+		float AttributeTolerance = 1e-3f; // UV distance & 1 - cos(angle) between the normals & tangents
+		bool  bDetectTransformedCopies = true;
+	};
+
+	enum EMatch
+	{
+		UNIQUE = 0,         // source of its group
+		EXACT_DUPLICATE,
+		TRANSFORMED_COPY,
+
+		NUM_MATCH_TYPES
+	};
+
+	struct FStatistics
+	{
+		uint32 NumGeometries        = 0;
+		uint32 NumUniqueGeometries  = 0;
+		uint32 NumExactDuplicates   = 0;
+		uint32 NumTransformedCopies = 0;
+		uint64 InputBytes           = 0; // vertex + index bytes of all the geometries
+		uint64 UniqueBytes          = 0; // vertex + index bytes of the sources
+		uint64 SavedBytes           = 0;
+		float  DedupRatio           = 1.0f; // InputBytes / UniqueBytes
+		float  DeduplicationTimeMs  = 0.0f;
+	};
+
+	struct FResult
+	{
+		std::vector<uint32>              SourceIndices; // per geometry: index of the geometry whose buffers it can use, itself if unique
+		std::vector<EMatch>              Matches;
+		std::vector<DirectX::XMFLOAT4X4> Transforms;    // per geometry: source -> geometry, row vectors (p * M), identity unless a transformed copy
+		FStatistics                      Stats;
+	};
+
+public:
+	// Processes the geometries on this thread and pWorkerThreadPool if specified.
+	static FResult Deduplicate(const std::vector<FGeometry>& Geometries, const FSettings& Settings, ThreadPool* pWorkerThreadPool = nullptr);
+};
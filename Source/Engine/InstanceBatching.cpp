@@ -0,0 +1,120 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "InstanceBatching.h"
+
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+void MeshInstanceBatcher::Batch(
+	  const std::vector<FMeshRenderCommand>& MeshRenderCommands
+	, uint32 MaxInstancesPerBatch
+	, std::vector<FInstancedMeshRenderCommand>& OutBatches
+	, std::vector<FMeshInstanceData>& OutInstanceData
+)
+{
+	Timer t; t.Start();
+	assert(MaxInstancesPerBatch > 0);
+	MaxInstancesPerBatch = std::max(MaxInstancesPerBatch, 1u);
+
+	const uint32 NumCmds = static_cast<uint32>(MeshRenderCommands.size());
+	mSortKeys.resize(NumCmds);
+	for (uint32 i = 0; i < NumCmds; ++i)
+	{
+		const FMeshRenderCommand& cmd = MeshRenderCommands[i];
+		mSortKeys[i].Key   = (static_cast<uint64>(static_cast<uint32>(cmd.meshID)) << 32) | static_cast<uint32>(cmd.matID);
+		mSortKeys[i].Index = i;
+	}
+	SortKeys();
+
+	OutBatches.clear();
+	OutInstanceData.resize(NumCmds);
+	for (uint32 i = 0; i < NumCmds; ++i)
+	{
+		const FMeshRenderCommand& cmd = MeshRenderCommands[mSortKeys[i].Index];
+
+		FMeshInstanceData& Instance = OutInstanceData[i];
+		Instance.matWorldTransformation     = cmd.matWorldTransformation;
+		Instance.matWorldTransformationPrev = cmd.matWorldTransformationPrev;
+		Instance.matNormalTransformation    = cmd.matNormalTransformation;
+
+		const bool bNewBatch = i == 0
+			|| mSortKeys[i].Key != mSortKeys[i - 1].Key
+			|| OutBatches.back().NumInstances == MaxInstancesPerBatch
+			|| OutBatches.back().iFirstSkinnedVertex != INVALID_ID
+			|| cmd.iFirstSkinnedVertex != INVALID_ID;
+		if (bNewBatch)
+		{
+			FInstancedMeshRenderCommand& Batch = OutBatches.emplace_back();
+			Batch.meshID = cmd.meshID;
+			Batch.matID  = cmd.matID;
+			Batch.iFirstInstance = i;
+			Batch.iFirstSkinnedVertex = cmd.iFirstSkinnedVertex;
+		}
+		++OutBatches.back().NumInstances;
+	}
+
+	mStats = {};
+	mStats.NumMeshRenderCommands = NumCmds;
+	mStats.NumBatches = static_cast<uint32>(OutBatches.size());
+	for (const FInstancedMeshRenderCommand& Batch : OutBatches)
+	{
+		mStats.NumInstancedBatches += Batch.NumInstances > 1 ? 1 : 0;
+		mStats.MaxInstancesPerBatch = std::max(mStats.MaxInstancesPerBatch, Batch.NumInstances);
+	}
+	mStats.BatchingTimeMs = t.Tick() * 1000.0f;
+}
+
+// LSD radix sort w/ 8-bit digits: stable, so the command index is the tie breaker. The digit histograms are
+// built in a single pass and the digits all keys share are skipped: mesh & material IDs are small so most
+// of the 64-bit key is zeros and only ~3 scatter passes are needed.
+void MeshInstanceBatcher::SortKeys()
+{
+	constexpr uint32 NUM_DIGITS = sizeof(uint64);
+	const uint32 NumKeys = static_cast<uint32>(mSortKeys.size());
+
+	uint32 Histograms[NUM_DIGITS][256] = {};
+	for (const FSortKey& k : mSortKeys)
+	{
+		for (uint32 d = 0; d < NUM_DIGITS; ++d)
+			++Histograms[d][(k.Key >> (d * 8)) & 0xFF];
+	}
+
+	mSortKeysScratch.resize(NumKeys);
+	for (uint32 d = 0; d < NUM_DIGITS; ++d)
+	{
+		uint32* pHistogram = Histograms[d];
+		if (NumKeys == 0 || pHistogram[(mSortKeys[0].Key >> (d * 8)) & 0xFF] == NumKeys)
+			continue; // all keys share this digit
+
+		uint32 Offset = 0;
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			const uint32 Count = pHistogram[i];
+			pHistogram[i] = Offset;
+			Offset += Count;
+		}
+		for (const FSortKey& k : mSortKeys)
+			mSortKeysScratch[pHistogram[(k.Key >> (d * 8)) & 0xFF]++] = k;
+		mSortKeys.swap(mSortKeysScratch);
+	}
+}
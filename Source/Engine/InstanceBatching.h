@@ -0,0 +1,72 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/RenderCommands.h"
+
+#include <vector>
+
+//
+// MESH INSTANCE BATCHER
+//
+// Groups the visible mesh render commands into instanced draws after culling.
+//
+// - Commands are grouped by (mesh, material): the scene meshes are all drawn with the same
+//   pipeline state per pass and only use LOD0, so the rest of the draw state is shared.
+// - Grouping is a stable radix sort on a 64-bit (mesh, material) key, the command index is the tie breaker
+//   so batches and the instance order within them are deterministic for a given command list.
+// - Per-instance world, previous world & normal matrices are packed contiguously per batch,
+//   groups larger than the max batch size are split into multiple batches.
+// - Skinned meshes get a batch per command: each instance has its own skinned vertices.
+//
+class MeshInstanceBatcher
+{
+public:
+	struct FStatistics
+	{
+		uint32 NumMeshRenderCommands = 0;
+		uint32 NumBatches            = 0;
+		uint32 NumInstancedBatches   = 0; // batches w/ more than 1 instance
+		uint32 MaxInstancesPerBatch  = 0;
+		float  BatchingTimeMs        = 0.0f;
+	};
+
+public:
+	void Batch(
+		  const std::vector<FMeshRenderCommand>& MeshRenderCommands
+		, uint32 MaxInstancesPerBatch
+		, std::vector<FInstancedMeshRenderCommand>& OutBatches
+		, std::vector<FMeshInstanceData>& OutInstanceData
+	);
+
+	inline const FStatistics& GetStatistics() const { return mStats; }
+
+private:
+	struct FSortKey
+	{
+		uint64 Key; // mesh | material
+		uint32 Index;
+	};
+
+	void SortKeys();
+
+private:
+	std::vector<FSortKey> mSortKeys;        // scratch
+	std::vector<FSortKey> mSortKeysScratch; // radix sort ping-pong buffer
+	FStatistics mStats;
+};
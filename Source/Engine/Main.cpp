@@ -160,12 +160,49 @@ void ParseCommandLineParameters(FStartupParameters& refStartupParams, PSTR pScmd
 			else
 				refStartupParams.EngineSettings.gfx.MaxFrameRate = StrUtil::ParseInt(paramValue);
 		}
+		if (paramName == "-TextureMemoryBudget")
+		{
+			refStartupParams.bOverrideGFXSetting_TextureMemoryBudgetMB = true;
+			refStartupParams.EngineSettings.gfx.TextureMemoryBudgetMB = StrUtil::ParseInt(paramValue);
+		}
 
 		if (paramName == "-Scene")
 		{
 			refStartupParams.bOverrideENGSetting_StartupScene = true;
 			refStartupParams.EngineSettings.StartupScene = paramValue;
 		}
+
+		if (paramName == "-BuildShaderArchive")
+		{
+			refStartupParams.bOverrideENGSetting_bBuildShaderArchive = true;
+			refStartupParams.EngineSettings.bBuildShaderArchive = true;
+		}
+
+		if (paramName == "-RecordCameraTrack")
+		{
+			refStartupParams.bOverrideENGSetting_CameraTrackRecordFile = true;
+			refStartupParams.EngineSettings.CameraTrackRecordFile = paramValue;
+		}
+		if (paramName == "-Benchmark")
+		{
+			refStartupParams.bOverrideENGSetting_BenchmarkCameraTrackFile = true;
+			refStartupParams.EngineSettings.BenchmarkCameraTrackFile = paramValue;
+		}
+		if (paramName == "-BenchmarkTimestep")
+		{
+			refStartupParams.bOverrideENGSetting_BenchmarkTimestep = true;
+			refStartupParams.EngineSettings.BenchmarkTimestep = StrUtil::ParseFloat(paramValue);
+		}
+		if (paramName == "-RecordTextureTrace")
+		{
+			refStartupParams.bOverrideENGSetting_TextureTraceRecordFile = true;
+			refStartupParams.EngineSettings.TextureTraceRecordFile = paramValue;
+		}
+		if (paramName == "-StreamAssets")
+		{
+			refStartupParams.bOverrideENGSetting_bStreamAssets = true;
+			refStartupParams.EngineSettings.bStreamAssets = paramValue.empty() ? true : StrUtil::ParseBool(paramValue);
+		}
 	}
 }
 
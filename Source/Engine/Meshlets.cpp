@@ -0,0 +1,612 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Meshlets.h"
+#include "Culling.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+using namespace DirectX;
+
+static constexpr uint32 INVALID_INDEX = 0xFFFFFFFF;
+static constexpr float  CONE_DISABLED = 2.0f;
+
+static inline XMFLOAT3 Add  (const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+static inline XMFLOAT3 Sub  (const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+static inline XMFLOAT3 Scale(const XMFLOAT3& a, float s)           { return XMFLOAT3(a.x * s, a.y * s, a.z * s); }
+static inline float    Dot  (const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+static inline float    DistanceSq(const XMFLOAT3& a, const XMFLOAT3& b) { const XMFLOAT3 d = Sub(a, b); return Dot(d, d); }
+
+static FMeshletBounds CalculateMeshletBounds(const std::vector<XMFLOAT3>& Positions, const uint32* pVertices, uint32 NumVertices, const uint32* pIndices, uint32 NumTriangles)
+{
+	FMeshletBounds b = {};
+
+	// AABB & the sphere around its center
+	XMFLOAT3 Min = Positions[pVertices[0]];
+	XMFLOAT3 Max = Min;
+	for (uint32 v = 1; v < NumVertices; ++v)
+	{
+		const XMFLOAT3& p = Positions[pVertices[v]];
+		Min = XMFLOAT3(std::min(Min.x, p.x), std::min(Min.y, p.y), std::min(Min.z, p.z));
+		Max = XMFLOAT3(std::max(Max.x, p.x), std::max(Max.y, p.y), std::max(Max.z, p.z));
+	}
+	b.AABBMin = Min;
+	b.AABBMax = Max;
+	b.Center  = Scale(Add(Min, Max), 0.5f);
+	float RadiusSq = 0.0f;
+	for (uint32 v = 0; v < NumVertices; ++v)
+		RadiusSq = std::max(RadiusSq, DistanceSq(Positions[pVertices[v]], b.Center));
+	b.Radius = std::sqrt(RadiusSq);
+
+	// normal cone: the axis is the average of the triangle normals, the cutoff comes from the widest normal
+	// and the apex is moved back along the axis until it's behind all the triangle planes, see MeshletCuller::Cull()
+	b.ConeApex   = b.Center;
+	b.ConeAxis   = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	b.ConeCutoff = CONE_DISABLED;
+
+	std::array<XMFLOAT3, 256> Normals;
+	std::array<XMFLOAT3, 256> Points;
+	assert(NumTriangles <= Normals.size());
+	uint32 NumNormals = 0;
+	XMFLOAT3 AxisSum(0.0f, 0.0f, 0.0f);
+	for (uint32 t = 0; t < NumTriangles; ++t)
+	{
+		const XMFLOAT3& p0 = Positions[pIndices[t * 3 + 0]];
+		const XMFLOAT3& p1 = Positions[pIndices[t * 3 + 1]];
+		const XMFLOAT3& p2 = Positions[pIndices[t * 3 + 2]];
+		const XMFLOAT3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+		const float Length = std::sqrt(Dot(n, n));
+		if (!(Length > 0.0f) || !std::isfinite(Length)) // degenerate triangles don't rasterize
+			continue;
+		Normals[NumNormals] = Scale(n, 1.0f / Length);
+		Points[NumNormals] = p0;
+		AxisSum = Add(AxisSum, Normals[NumNormals]);
+		++NumNormals;
+	}
+	const float AxisLength = std::sqrt(Dot(AxisSum, AxisSum));
+	if (NumNormals == 0 || !(AxisLength > 0.0f))
+		return b;
+
+	const XMFLOAT3 Axis = Scale(AxisSum, 1.0f / AxisLength);
+	float MinDot = 1.0f;
+	for (uint32 i = 0; i < NumNormals; ++i)
+		MinDot = std::min(MinDot, Dot(Normals[i], Axis));
+	if (MinDot <= 0.1f)
+		return b;
+
+	float MaxT = 0.0f;
+	for (uint32 i = 0; i < NumNormals; ++i)
+		MaxT = std::max(MaxT, Dot(Sub(b.Center, Points[i]), Normals[i]) / Dot(Axis, Normals[i]));
+
+	b.ConeAxis   = Axis;
+	b.ConeApex   = Sub(b.Center, Scale(Axis, MaxT));
+	b.ConeCutoff = std::sqrt(1.0f - MinDot * MinDot);
+	return b;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// MESHLET BUILDER
+//
+//------------------------------------------------------------------------------------------------------------------------------
+FMeshletData MeshletBuilder::Build(const float* pPositions, uint32 PositionStride, uint32 NumVertices, const uint32* pIndices, uint32 NumIndices, const FSettings& Settings, FStatistics* pStats)
+{
+	Timer t; t.Start();
+	FMeshletData Data;
+	if (pStats)
+		*pStats = {};
+
+	bool bValid = pPositions && pIndices && PositionStride >= sizeof(float) * 3 && NumIndices % 3 == 0;
+	for (uint32 i = 0; bValid && i < NumIndices; ++i)
+		bValid = pIndices[i] < NumVertices;
+	if (!bValid)
+	{
+		Log::Warning("MeshletBuilder: invalid triangle list (%u indices, %u vertices)", NumIndices, NumVertices);
+		return Data;
+	}
+	const uint32 NumTriangles = NumIndices / 3;
+	if (NumTriangles == 0)
+		return Data;
+
+	// local vertex indices are 8 bits, the bounds use a fixed size scratch
+	const uint32 MaxVertices  = std::clamp(Settings.MaxVertices , 3u, 256u);
+	const uint32 MaxTriangles = std::clamp(Settings.MaxTriangles, 1u, 256u);
+
+	// weld the positions for the adjacency: sort by the position bits, the first vertex of a run represents it
+	std::vector<XMFLOAT3> Positions(NumVertices);
+	std::vector<uint32>   WeldedVertices(NumVertices);
+	{
+		std::vector<std::array<uint32, 4>> SortKeys(NumVertices); // position bits, vertex
+		for (uint32 v = 0; v < NumVertices; ++v)
+		{
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8*>(pPositions) + static_cast<size_t>(v) * PositionStride);
+			Positions[v] = XMFLOAT3(p[0], p[1], p[2]);
+			std::memcpy(SortKeys[v].data(), &Positions[v], sizeof(XMFLOAT3));
+			SortKeys[v][3] = v;
+		}
+		std::sort(SortKeys.begin(), SortKeys.end());
+		for (uint32 i = 0, iRun = 0; i < NumVertices; ++i)
+		{
+			if (std::memcmp(SortKeys[i].data(), SortKeys[iRun].data(), sizeof(XMFLOAT3)) != 0)
+				iRun = i;
+			WeldedVertices[SortKeys[i][3]] = SortKeys[iRun][3];
+		}
+	}
+
+	// welded vertex -> triangles
+	std::vector<uint32> AdjacencyOffsets(NumVertices + 1, 0);
+	std::vector<uint32> Adjacency(NumIndices);
+	for (uint32 i = 0; i < NumIndices; ++i)
+		++AdjacencyOffsets[WeldedVertices[pIndices[i]] + 1];
+	for (uint32 v = 0; v < NumVertices; ++v)
+		AdjacencyOffsets[v + 1] += AdjacencyOffsets[v];
+	{
+		std::vector<uint32> Cursors(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+		for (uint32 i = 0; i < NumIndices; ++i)
+			Adjacency[Cursors[WeldedVertices[pIndices[i]]]++] = i / 3;
+	}
+
+	std::vector<XMFLOAT3> Centroids(NumTriangles);
+	for (uint32 tri = 0; tri < NumTriangles; ++tri)
+		Centroids[tri] = Scale(Add(Add(Positions[pIndices[tri * 3 + 0]], Positions[pIndices[tri * 3 + 1]]), Positions[pIndices[tri * 3 + 2]]), 1.0f / 3.0f);
+
+	std::vector<uint8>  bEmitted(NumTriangles, 0);
+	std::vector<uint32> CandidateMeshlet(NumTriangles, INVALID_INDEX); // meshlet index the triangle was last added as a candidate for
+	std::vector<uint32> LocalVertexIndices(NumVertices, INVALID_INDEX);
+	std::vector<uint32> Candidates;        // triangles sharing a position w/ the meshlet
+	std::vector<uint32> EdgeCandidates;    // candidates w/ 1 vertex missing from the meshlet
+	std::vector<uint32> ClosingCandidates; // candidates w/ all their vertices in the meshlet
+	std::vector<uint32> MeshletVertices;
+	std::vector<uint32> MeshletIndices;
+	XMFLOAT3 CentroidSum(0.0f, 0.0f, 0.0f);
+	uint32 Cursor = 0; // first triangle that may not be emitted yet
+
+	Data.Indices.reserve(NumIndices);
+	Data.TriangleIndices.reserve(NumIndices);
+	Data.VertexIndices.reserve(NumVertices);
+
+	auto fnCountNewVertices = [&](uint32 tri) -> uint32
+	{
+		const uint32 i0 = pIndices[tri * 3 + 0];
+		const uint32 i1 = pIndices[tri * 3 + 1];
+		const uint32 i2 = pIndices[tri * 3 + 2];
+		return (LocalVertexIndices[i0] == INVALID_INDEX ? 1 : 0)
+			 + (LocalVertexIndices[i1] == INVALID_INDEX && i1 != i0 ? 1 : 0)
+			 + (LocalVertexIndices[i2] == INVALID_INDEX && i2 != i0 && i2 != i1 ? 1 : 0);
+	};
+	auto fnFlushMeshlet = [&]()
+	{
+		FMeshlet m;
+		m.VertexOffset   = static_cast<uint32>(Data.VertexIndices.size());
+		m.NumVertices    = static_cast<uint32>(MeshletVertices.size());
+		m.TriangleOffset = static_cast<uint32>(Data.TriangleIndices.size() / 3);
+		m.NumTriangles   = static_cast<uint32>(MeshletIndices.size() / 3);
+		m.FirstIndex     = static_cast<uint32>(Data.Indices.size());
+		Data.Meshlets.push_back(m);
+		Data.Bounds.push_back(CalculateMeshletBounds(Positions, MeshletVertices.data(), m.NumVertices, MeshletIndices.data(), m.NumTriangles));
+
+		Data.VertexIndices.insert(Data.VertexIndices.end(), MeshletVertices.begin(), MeshletVertices.end());
+		Data.Indices.insert(Data.Indices.end(), MeshletIndices.begin(), MeshletIndices.end());
+		for (uint32 Index : MeshletIndices)
+			Data.TriangleIndices.push_back(static_cast<uint8>(LocalVertexIndices[Index]));
+
+		for (uint32 v : MeshletVertices)
+			LocalVertexIndices[v] = INVALID_INDEX;
+		MeshletVertices.clear();
+		MeshletIndices.clear();
+		Candidates.clear();
+		EdgeCandidates.clear();
+		ClosingCandidates.clear();
+		CentroidSum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	};
+
+	uint32 Seed = INVALID_INDEX; // first triangle of the next meshlet
+	uint32 NumEmitted = 0;
+	while (NumEmitted < NumTriangles)
+	{
+		const uint32 NumMeshletTriangles = static_cast<uint32>(MeshletIndices.size() / 3);
+		const XMFLOAT3 MeshletCentroid = Scale(CentroidSum, NumMeshletTriangles > 0 ? 1.0f / NumMeshletTriangles : 0.0f);
+
+		uint32 Next = INVALID_INDEX;
+		uint32 NextNewVertices = 4;
+		float  NextDistanceSq = std::numeric_limits<float>::max();
+		auto fnConsider = [&](uint32 tri)
+		{
+			const uint32 NewVertices = fnCountNewVertices(tri);
+			const float  DistSq = DistanceSq(Centroids[tri], MeshletCentroid);
+			if (NewVertices < NextNewVertices || (NewVertices == NextNewVertices && (DistSq < NextDistanceSq || (DistSq == NextDistanceSq && tri < Next))))
+			{
+				Next = tri;
+				NextNewVertices = NewVertices;
+				NextDistanceSq = DistSq;
+			}
+		};
+
+		if (NumMeshletTriangles == 0)
+		{
+			while (bEmitted[Cursor])
+				++Cursor;
+			Next = (Seed != INVALID_INDEX && !bEmitted[Seed]) ? Seed : Cursor;
+			NextNewVertices = fnCountNewVertices(Next);
+		}
+		else
+		{
+			// triangles w/o new vertices first: they don't affect the vertex limit
+			while (!ClosingCandidates.empty() && bEmitted[ClosingCandidates.back()])
+				ClosingCandidates.pop_back();
+			const bool bClosing = !ClosingCandidates.empty();
+			if (bClosing)
+			{
+				Next = ClosingCandidates.back();
+				NextNewVertices = 0;
+			}
+
+			// adjacent triangles, the ones w/ a single new vertex first, dropping the emitted & outdated entries
+			for (size_t i = 0; !bClosing && i < EdgeCandidates.size();)
+			{
+				if (bEmitted[EdgeCandidates[i]] || fnCountNewVertices(EdgeCandidates[i]) != 1)
+				{
+					EdgeCandidates[i] = EdgeCandidates.back();
+					EdgeCandidates.pop_back();
+					continue;
+				}
+				fnConsider(EdgeCandidates[i]);
+				++i;
+			}
+			for (size_t i = 0; Next == INVALID_INDEX && i < Candidates.size();)
+			{
+				if (bEmitted[Candidates[i]])
+				{
+					Candidates[i] = Candidates.back();
+					Candidates.pop_back();
+					continue;
+				}
+				fnConsider(Candidates[i]);
+				++i;
+			}
+
+			// no adjacent triangle left: closest of the next unassigned ones
+			if (Next == INVALID_INDEX)
+			{
+				constexpr uint32 FALLBACK_WINDOW = 256;
+				while (bEmitted[Cursor])
+					++Cursor;
+				for (uint32 tri = Cursor; tri < NumTriangles && tri < Cursor + FALLBACK_WINDOW; ++tri)
+					if (!bEmitted[tri])
+						fnConsider(tri);
+			}
+		}
+		assert(Next != INVALID_INDEX);
+
+		if (NumMeshletTriangles > 0 && (NumMeshletTriangles == MaxTriangles || MeshletVertices.size() + NextNewVertices > MaxVertices))
+		{
+			Seed = Next;
+			fnFlushMeshlet();
+			continue;
+		}
+
+		// emit
+		const uint32 iMeshlet = static_cast<uint32>(Data.Meshlets.size());
+		for (uint32 k = 0; k < 3; ++k)
+		{
+			const uint32 v = pIndices[Next * 3 + k];
+			MeshletIndices.push_back(v);
+			if (LocalVertexIndices[v] != INVALID_INDEX)
+				continue;
+			LocalVertexIndices[v] = static_cast<uint32>(MeshletVertices.size());
+			MeshletVertices.push_back(v);
+
+			const uint32 w = WeldedVertices[v];
+			for (uint32 a = AdjacencyOffsets[w]; a < AdjacencyOffsets[w + 1]; ++a)
+			{
+				const uint32 tri = Adjacency[a];
+				if (bEmitted[tri] || tri == Next)
+					continue;
+				if (CandidateMeshlet[tri] != iMeshlet)
+				{
+					CandidateMeshlet[tri] = iMeshlet;
+					Candidates.push_back(tri);
+				}
+				const uint32 NewVertices = fnCountNewVertices(tri);
+				if (NewVertices == 0)
+					ClosingCandidates.push_back(tri);
+				else if (NewVertices == 1)
+					EdgeCandidates.push_back(tri);
+			}
+		}
+		CentroidSum = Add(CentroidSum, Centroids[Next]);
+		bEmitted[Next] = 1;
+		++NumEmitted;
+	}
+	fnFlushMeshlet();
+
+	if (pStats)
+	{
+		FStatistics& s = *pStats;
+		s.NumMeshlets        = static_cast<uint32>(Data.Meshlets.size());
+		s.NumTriangles       = NumTriangles;
+		s.NumVertices        = NumVertices;
+		s.NumMeshletVertices = static_cast<uint32>(Data.VertexIndices.size());
+		for (const FMeshletBounds& b : Data.Bounds)
+			s.NumDisabledCones += b.ConeCutoff > 1.0f ? 1 : 0;
+		s.AvgVerticesPerMeshlet  = static_cast<float>(s.NumMeshletVertices) / s.NumMeshlets;
+		s.AvgTrianglesPerMeshlet = static_cast<float>(NumTriangles) / s.NumMeshlets;
+		s.VertexDuplication      = NumVertices > 0 ? static_cast<float>(s.NumMeshletVertices) / NumVertices : 0.0f;
+		s.BuildTimeMs            = t.Tick() * 1000.0f;
+	}
+	return Data;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// MESHLET CULLER
+//
+//------------------------------------------------------------------------------------------------------------------------------
+void MeshletCuller::BeginFrame()
+{
+	mFrameStats = {};
+	mTimer.Start();
+}
+
+void MeshletCuller::EndFrame()
+{
+	mFrameStats.CullingTimeMs = mTimer.Tick() * 1000.0f;
+	mStats = mFrameStats;
+}
+
+uint32 MeshletCuller::Cull(
+	  const FMeshletData& Data
+	, const XMMATRIX& matWorld
+	, const XMMATRIX& matViewProj
+	, const XMFLOAT3& CameraPosition
+	, std::vector<FIndexRange>& OutRanges
+)
+{
+	const FFrustumPlaneset FrustumPlanes = FFrustumPlaneset::ExtractFromMatrix(matWorld * matViewProj); // mesh space
+	std::array<float, 6> PlaneNormalLengths;
+	for (int p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& pl = FrustumPlanes.abcd[p];
+		PlaneNormalLengths[p] = std::sqrt(pl.x * pl.x + pl.y * pl.y + pl.z * pl.z);
+	}
+
+	// mirroring transforms flip the winding on screen
+	XMFLOAT4X4 w;
+	XMStoreFloat4x4(&w, matWorld);
+	const float Determinant = w.m[0][0] * (w.m[1][1] * w.m[2][2] - w.m[1][2] * w.m[2][1])
+		                    - w.m[0][1] * (w.m[1][0] * w.m[2][2] - w.m[1][2] * w.m[2][0])
+		                    + w.m[0][2] * (w.m[1][0] * w.m[2][1] - w.m[1][1] * w.m[2][0]);
+	const bool bConeCulling = Determinant > 0.0f;
+	XMFLOAT3 Eye;
+	XMStoreFloat3(&Eye, XMVector3TransformCoord(XMLoadFloat3(&CameraPosition), XMMatrixInverse(nullptr, matWorld)));
+
+	const size_t FirstRange = OutRanges.size();
+	for (size_t i = 0; i < Data.Meshlets.size(); ++i)
+	{
+		const FMeshlet& Meshlet = Data.Meshlets[i];
+		const FMeshletBounds& b = Data.Bounds[i];
+		mFrameStats.NumTestedTriangles += Meshlet.NumTriangles;
+
+		// frustum: sphere, then the AABB's corner furthest along the plane normal if the sphere straddles a plane
+		bool bCulled = false;
+		bool bStraddling = false;
+		for (int p = 0; p < 6 && !bCulled; ++p)
+		{
+			const XMFLOAT4& pl = FrustumPlanes.abcd[p];
+			const float Distance = pl.x * b.Center.x + pl.y * b.Center.y + pl.z * b.Center.z + pl.w;
+			const float Radius = b.Radius * PlaneNormalLengths[p];
+			bCulled = Distance < -Radius;
+			bStraddling |= Distance < Radius;
+		}
+		for (int p = 0; p < 6 && !bCulled && bStraddling; ++p)
+		{
+			const XMFLOAT4& pl = FrustumPlanes.abcd[p];
+			const float x = pl.x >= 0.0f ? b.AABBMax.x : b.AABBMin.x;
+			const float y = pl.y >= 0.0f ? b.AABBMax.y : b.AABBMin.y;
+			const float z = pl.z >= 0.0f ? b.AABBMax.z : b.AABBMin.z;
+			bCulled = pl.x * x + pl.y * y + pl.z * z + pl.w < 0.0f;
+		}
+		if (bCulled)
+		{
+			++mFrameStats.NumFrustumCulledMeshlets;
+			continue;
+		}
+
+		// backface: all the triangles face away if the view direction to the apex is inside the cone
+		if (bConeCulling && b.ConeCutoff <= 1.0f)
+		{
+			const XMFLOAT3 ViewDirection = Sub(b.ConeApex, Eye);
+			const float Length = std::sqrt(Dot(ViewDirection, ViewDirection));
+			if (Dot(ViewDirection, b.ConeAxis) >= b.ConeCutoff * Length && Length > 0.0f)
+			{
+				++mFrameStats.NumBackfaceCulledMeshlets;
+				continue;
+			}
+		}
+
+		mFrameStats.NumVisibleTriangles += Meshlet.NumTriangles;
+		const uint32 NumIndices = Meshlet.NumTriangles * 3;
+		if (OutRanges.size() > FirstRange && OutRanges.back().FirstIndex + OutRanges.back().NumIndices == Meshlet.FirstIndex)
+			OutRanges.back().NumIndices += NumIndices;
+		else
+			OutRanges.push_back({ Meshlet.FirstIndex, NumIndices });
+	}
+
+	const uint32 NumRanges = static_cast<uint32>(OutRanges.size() - FirstRange);
+	++mFrameStats.NumTestedMeshes;
+	mFrameStats.NumCulledMeshes   += NumRanges == 0 ? 1 : 0;
+	mFrameStats.NumTestedMeshlets += static_cast<uint32>(Data.Meshlets.size());
+	mFrameStats.NumIndexRanges    += NumRanges;
+	return NumRanges;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// COOKED MESH FILE
+//
+//------------------------------------------------------------------------------------------------------------------------------
+template<class T>
+static bool IsEqualBitwise(const std::vector<T>& l, const std::vector<T>& r)
+{
+	return l.size() == r.size() && (l.empty() || std::memcmp(l.data(), r.data(), sizeof(T) * l.size()) == 0);
+}
+
+static bool IsEqual(const FMeshletData& l, const FMeshletData& r)
+{
+	return IsEqualBitwise(l.Meshlets, r.Meshlets)
+		&& IsEqualBitwise(l.Bounds, r.Bounds)
+		&& IsEqualBitwise(l.VertexIndices, r.VertexIndices)
+		&& IsEqualBitwise(l.TriangleIndices, r.TriangleIndices)
+		&& IsEqualBitwise(l.Indices, r.Indices);
+}
+
+static size_t AlignTo4(size_t Size) { return (Size + 3) & ~static_cast<size_t>(3); }
+
+bool CookedMeshFile::IsEqual(const FCookedMesh& l, const FCookedMesh& r)
+{
+	return l.VertexStride == r.VertexStride && IsEqualBitwise(l.VertexData, r.VertexData) && ::IsEqual(l.Meshlets, r.Meshlets);
+}
+
+bool CookedMeshFile::Write(const std::string& FilePath, const FCookedMesh& Mesh)
+{
+	const FMeshletData& d = Mesh.Meshlets;
+	if (Mesh.VertexStride == 0 || Mesh.VertexData.size() % Mesh.VertexStride != 0 || d.Bounds.size() != d.Meshlets.size())
+	{
+		Log::Error("CookedMeshFile: invalid mesh data for %s", FilePath.c_str());
+		return false;
+	}
+
+	FHeader Header = {};
+	Header.Magic              = MAGIC;
+	Header.Version            = VERSION;
+	Header.VertexStride       = Mesh.VertexStride;
+	Header.NumVertices        = static_cast<uint32>(Mesh.VertexData.size() / Mesh.VertexStride);
+	Header.NumMeshlets        = static_cast<uint32>(d.Meshlets.size());
+	Header.NumVertexIndices   = static_cast<uint32>(d.VertexIndices.size());
+	Header.NumTriangleIndices = static_cast<uint32>(d.TriangleIndices.size());
+	Header.NumIndices         = static_cast<uint32>(d.Indices.size());
+
+	std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("CookedMeshFile: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+	const char Padding[4] = {};
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(Mesh.VertexData.data()), Mesh.VertexData.size());
+	file.write(Padding, AlignTo4(Mesh.VertexData.size()) - Mesh.VertexData.size());
+	file.write(reinterpret_cast<const char*>(d.Meshlets.data())       , sizeof(FMeshlet)       * d.Meshlets.size());
+	file.write(reinterpret_cast<const char*>(d.Bounds.data())         , sizeof(FMeshletBounds) * d.Bounds.size());
+	file.write(reinterpret_cast<const char*>(d.VertexIndices.data())  , sizeof(uint32)         * d.VertexIndices.size());
+	file.write(reinterpret_cast<const char*>(d.TriangleIndices.data()), d.TriangleIndices.size());
+	file.write(Padding, AlignTo4(d.TriangleIndices.size()) - d.TriangleIndices.size());
+	file.write(reinterpret_cast<const char*>(d.Indices.data())        , sizeof(uint32)         * d.Indices.size());
+	return file.good();
+}
+
+bool CookedMeshFile::Read(const std::string& FilePath, FCookedMesh& Mesh)
+{
+	std::ifstream file(FilePath, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	const std::streamsize Size = file.tellg();
+	std::vector<char> Bytes(Size > 0 ? static_cast<size_t>(Size) : 0);
+	file.seekg(0);
+	const bool bRead = !Bytes.empty() && file.read(Bytes.data(), Size) && Read(Bytes.data(), Bytes.size(), Mesh);
+	if (!bRead)
+		Log::Warning("CookedMeshFile: %s is invalid or out of date, ignoring", FilePath.c_str());
+	return bRead;
+}
+
+bool CookedMeshFile::Read(const void* pData, size_t Size, FCookedMesh& Mesh)
+{
+	const char* pBytes = static_cast<const char*>(pData);
+	if (Size < sizeof(FHeader))
+		return false;
+
+	FHeader Header;
+	std::memcpy(&Header, pBytes, sizeof(Header));
+	const uint64 VertexDataSize = static_cast<uint64>(Header.VertexStride) * Header.NumVertices;
+	const uint64 ExpectedSize = sizeof(FHeader)
+		+ AlignTo4(VertexDataSize)
+		+ (sizeof(FMeshlet) + sizeof(FMeshletBounds)) * static_cast<uint64>(Header.NumMeshlets)
+		+ sizeof(uint32) * static_cast<uint64>(Header.NumVertexIndices)
+		+ AlignTo4(Header.NumTriangleIndices)
+		+ sizeof(uint32) * static_cast<uint64>(Header.NumIndices);
+	const bool bValidHeader = Header.Magic == MAGIC
+		&& Header.Version == VERSION
+		&& Header.VertexStride > 0
+		&& Header.NumIndices == Header.NumTriangleIndices
+		&& ExpectedSize == Size;
+	if (!bValidHeader)
+		return false;
+
+	FCookedMesh Cooked;
+	FMeshletData& d = Cooked.Meshlets;
+	auto fnRead = [&](auto& Vector, size_t Count, size_t Offset) -> size_t
+	{
+		using T = typename std::remove_reference_t<decltype(Vector)>::value_type;
+		Vector.resize(Count);
+		if (Count > 0)
+			std::memcpy(Vector.data(), pBytes + Offset, sizeof(T) * Count);
+		return Offset + sizeof(T) * Count;
+	};
+	size_t Offset = sizeof(FHeader);
+	Cooked.VertexStride = Header.VertexStride;
+	Offset = AlignTo4(fnRead(Cooked.VertexData, static_cast<size_t>(VertexDataSize), Offset));
+	Offset = fnRead(d.Meshlets       , Header.NumMeshlets       , Offset);
+	Offset = fnRead(d.Bounds         , Header.NumMeshlets       , Offset);
+	Offset = fnRead(d.VertexIndices  , Header.NumVertexIndices  , Offset);
+	Offset = AlignTo4(fnRead(d.TriangleIndices, Header.NumTriangleIndices, Offset));
+	Offset = fnRead(d.Indices        , Header.NumIndices        , Offset);
+	assert(Offset == Size);
+
+	// the meshlets have to reference valid ranges
+	uint32 NextFirstIndex = 0;
+	for (const FMeshlet& m : d.Meshlets)
+	{
+		const bool bValidMeshlet = m.FirstIndex == NextFirstIndex
+			&& static_cast<uint64>(m.VertexOffset) + m.NumVertices <= d.VertexIndices.size()
+			&& (static_cast<uint64>(m.TriangleOffset) + m.NumTriangles) * 3 <= d.TriangleIndices.size()
+			&& static_cast<uint64>(m.FirstIndex) + m.NumTriangles * 3ull <= d.Indices.size();
+		if (!bValidMeshlet)
+			return false;
+		for (uint32 i = 0; i < m.NumTriangles * 3; ++i)
+			if (d.TriangleIndices[m.TriangleOffset * 3 + i] >= m.NumVertices)
+				return false;
+		NextFirstIndex += m.NumTriangles * 3;
+	}
+	if (NextFirstIndex != d.Indices.size())
+		return false;
+	for (uint32 v : d.VertexIndices) if (v >= Header.NumVertices) return false;
+	for (uint32 i : d.Indices)       if (i >= Header.NumVertices) return false;
+
+	Mesh = std::move(Cooked);
+	return true;
+}
@@ -0,0 +1,192 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/RenderCommands.h"
+
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <DirectXMath.h>
+
+#include <string>
+#include <vector>
+
+struct FMeshlet
+{
+	uint32 VertexOffset;   // into FMeshletData::VertexIndices
+	uint32 NumVertices;
+	uint32 TriangleOffset; // into FMeshletData::TriangleIndices, in triangles
+	uint32 NumTriangles;
+	uint32 FirstIndex;     // into FMeshletData::Indices
+};
+
+struct FMeshletBounds
+{
+	DirectX::XMFLOAT3 Center;
+	float             Radius;
+	DirectX::XMFLOAT3 AABBMin;
+	DirectX::XMFLOAT3 AABBMax;
+	DirectX::XMFLOAT3 ConeApex;
+	DirectX::XMFLOAT3 ConeAxis;
+	float             ConeCutoff; // backfacing if dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff, > 1 : cone disabled
+};
+
+struct FMeshletData
+{
+	std::vector<FMeshlet>       Meshlets;
+	std::vector<FMeshletBounds> Bounds;          // per meshlet
+	std::vector<uint32>         VertexIndices;   // per meshlet: mesh vertex indices in the order of first use
+	std::vector<uint8>          TriangleIndices; // per meshlet: 3 local vertex indices per triangle
+	std::vector<uint32>         Indices;         // triangle list w/ mesh vertex indices, in meshlet order
+};
+
+//
+// MESHLET BUILDER
+//
+// Splits an indexed triangle list into meshlets: clusters of at most MaxVertices unique vertices
+// and MaxTriangles triangles, w/ the bounds needed to cull them individually.
+//
+// - Meshlets grow greedily over the triangle adjacency: the next triangle is the one adding the fewest
+//   new vertices, then the one closest to the meshlet's centroid. Adjacency is built on welded positions
+//   so the seams of the imported meshes (split normals & UVs) don't break the growth. When a meshlet has
+//   no adjacent triangle left, it continues w/ the closest of the next unassigned triangles in input order.
+// - Triangles are emitted in the growth order, the output index list can replace the mesh's index buffer
+//   and keeps the triangles of a meshlet contiguous for the culler's index ranges.
+// - Bounds: AABB, the sphere around the AABB center and the normal cone of the triangles' geometric normals
+//   (front faces wind clockwise). Cones wider than ~84 degrees are disabled as they'd rarely cull anything.
+//
+class MeshletBuilder
+{
+public:
+	struct FSettings
+	{
+		uint32 MaxVertices  = 64;
+		uint32 MaxTriangles = 124;
+	};
+
+	struct FStatistics
+	{
+		uint32 NumMeshlets         = 0;
+		uint32 NumTriangles        = 0;
+		uint32 NumVertices         = 0; // of the mesh
+		uint32 NumMeshletVertices  = 0; // sum of the unique vertices per meshlet
+		uint32 NumDisabledCones    = 0;
+		float  AvgVerticesPerMeshlet  = 0.0f;
+		float  AvgTrianglesPerMeshlet = 0.0f;
+		float  VertexDuplication      = 0.0f; // NumMeshletVertices / NumVertices
+		float  BuildTimeMs            = 0.0f;
+	};
+
+public:
+	// Returns empty data if the indices aren't a valid triangle list
+	static FMeshletData Build(const float* pPositions, uint32 PositionStride, uint32 NumVertices, const uint32* pIndices, uint32 NumIndices, const FSettings& Settings, FStatistics* pStats = nullptr);
+};
+
+//
+// MESHLET CULLER
+//
+// Culls the meshlets of a mesh against the view frustum and their normal cones, and outputs the
+// index ranges of the visible ones. Tests run in mesh space: the frustum planes come from the
+// world-view-projection matrix and the camera position is transformed by the inverse world matrix.
+//
+// - Frustum: bounding sphere against each plane, then the AABB if the sphere straddles the frustum.
+// - Backface: normal cone against the camera position. Skipped for mirroring world transforms as the
+//   rasterizer culls the other side then.
+// - Visible meshlets that are adjacent in the index list are merged into a single range.
+//
+class MeshletCuller
+{
+public:
+	struct FStatistics
+	{
+		uint32 NumTestedMeshes          = 0;
+		uint32 NumCulledMeshes          = 0; // all meshlets culled
+		uint32 NumTestedMeshlets        = 0;
+		uint32 NumFrustumCulledMeshlets = 0;
+		uint32 NumBackfaceCulledMeshlets = 0;
+		uint32 NumIndexRanges           = 0;
+		uint32 NumTestedTriangles       = 0;
+		uint32 NumVisibleTriangles      = 0;
+		float  CullingTimeMs            = 0.0f;
+	};
+
+public:
+	// Cull() accumulates the statistics of the frame, EndFrame() publishes them
+	void BeginFrame();
+	void EndFrame();
+
+	// Appends the index ranges of the visible meshlets to OutRanges, returns the number of ranges appended.
+	// @CameraPosition is in world space.
+	uint32 Cull(
+		  const FMeshletData& Data
+		, const DirectX::XMMATRIX& matWorld
+		, const DirectX::XMMATRIX& matViewProj
+		, const DirectX::XMFLOAT3& CameraPosition
+		, std::vector<FIndexRange>& OutRanges
+	);
+
+	inline const FStatistics& GetStatistics() const { return mStats; }
+
+private:
+	FStatistics mStats;
+	FStatistics mFrameStats;
+	Timer       mTimer;
+};
+
+//
+// COOKED MESH FILE
+//
+// Mesh vertices & meshlets in a single file:
+//
+//  [FHeader][vertex data][FMeshlet x NumMeshlets][FMeshletBounds x NumMeshlets][uint32 x NumVertexIndices][uint8 x NumTriangleIndices, padded to 4][uint32 x NumIndices]
+//
+// The vertex data is stored as is w/ its stride, the index list is in meshlet order and is the
+// index buffer of the mesh.
+//
+class CookedMeshFile
+{
+public:
+	struct FCookedMesh
+	{
+		uint32             VertexStride = 0;
+		std::vector<uint8> VertexData;
+		FMeshletData       Meshlets;
+	};
+
+	static bool Write(const std::string& FilePath, const FCookedMesh& Mesh);
+	static bool Read(const std::string& FilePath, FCookedMesh& Mesh);
+	static bool Read(const void* pData, size_t Size, FCookedMesh& Mesh);
+
+	static bool IsEqual(const FCookedMesh& l, const FCookedMesh& r); // bitwise
+
+private:
+	static constexpr uint32 MAGIC   = 0x534D5156; // "VQMS"
+	static constexpr uint32 VERSION = 1; // bump w/ the changes to MeshletBuilder::Build()'s output so the cooked meshes are rebuilt
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 VertexStride;
+		uint32 NumVertices;
+		uint32 NumMeshlets;
+		uint32 NumVertexIndices;
+		uint32 NumTriangleIndices;
+		uint32 NumIndices;
+	};
+};
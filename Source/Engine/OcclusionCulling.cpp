@@ -0,0 +1,383 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "OcclusionCulling.h"
+
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+OcclusionCuller::OcclusionCuller()
+	: mNumTestedBoundingBoxes(0)
+	, mNumOccludedBoundingBoxes(0)
+{
+	XMStoreFloat4x4(&mMatViewProj, XMMatrixIdentity());
+}
+
+bool OcclusionCuller::IsAVX2Supported()
+{
+#ifdef _MSC_VER
+	int CPUInfo[4] = {};
+	__cpuid(CPUInfo, 0);
+	if (CPUInfo[0] < 7)
+		return false;
+	__cpuidex(CPUInfo, 7, 0);
+	const bool bAVX2 = (CPUInfo[1] & (1 << 5)) != 0;
+
+	// the OS has to save the YMM registers too
+	__cpuid(CPUInfo, 1);
+	const bool bOSXSAVE = (CPUInfo[2] & (1 << 27)) != 0;
+	const bool bYMMEnabled = bOSXSAVE && (_xgetbv(0) & 0x6) == 0x6;
+	return bAVX2 && bYMMEnabled;
+#elif defined(__AVX2__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void OcclusionCuller::Initialize(uint32 Width, uint32 Height)
+{
+	assert(Width > 0 && Height > 0);
+	const uint32 COARSE_TILE_SIZE_PX = TILE_SIZE * COARSE_TILE_SIZE;
+	mWidth  = ((Width  + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+	mHeight = ((Height + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE;
+	mNumTilesX = mWidth  / TILE_SIZE;
+	mNumTilesY = mHeight / TILE_SIZE;
+	mNumCoarseTilesX = (mWidth  + COARSE_TILE_SIZE_PX - 1) / COARSE_TILE_SIZE_PX;
+	mNumCoarseTilesY = (mHeight + COARSE_TILE_SIZE_PX - 1) / COARSE_TILE_SIZE_PX;
+
+	mDepthBuffer.assign(mWidth * mHeight, 1.0f);
+	mTileMaxDepth.assign(mNumTilesX * mNumTilesY, 1.0f);
+	mCoarseTileMaxDepth.assign(mNumCoarseTilesX * mNumCoarseTilesY, 1.0f);
+
+	mbUseAVX2 = IsAVX2Supported();
+}
+
+void OcclusionCuller::BeginFrame(const XMMATRIX& matViewProj)
+{
+	assert(mWidth > 0); // Initialize() not called?
+	XMStoreFloat4x4(&mMatViewProj, matViewProj);
+	std::fill(mDepthBuffer.begin(), mDepthBuffer.end(), 1.0f);
+
+	// publish the previous frame's statistics: the culling workers are done with it at this point
+	{
+		FStatistics s = mStats;
+		s.NumTestedBoundingBoxes   = mNumTestedBoundingBoxes.load();
+		s.NumOccludedBoundingBoxes = mNumOccludedBoundingBoxes.load();
+		std::lock_guard<std::mutex> lk(mMtxPublishedStats);
+		mPublishedStats = s;
+	}
+
+	mStats = {};
+	mNumTestedBoundingBoxes.store(0);
+	mNumOccludedBoundingBoxes.store(0);
+}
+
+void OcclusionCuller::EndFrame()
+{
+	Timer t; t.Start();
+	BuildDepthHierarchy();
+	mStats.RasterizationTimeMs += t.Tick() * 1000.0f;
+}
+
+OcclusionCuller::FStatistics OcclusionCuller::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lk(mMtxPublishedStats);
+	return mPublishedStats;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// RASTERIZATION
+//
+//------------------------------------------------------------------------------------------------------------------------------
+void OcclusionCuller::RasterizeOccluder(const FOccluderMesh& Occluder)
+{
+	assert(Occluder.NumIndices % 3 == 0);
+	if (!Occluder.pVertices || !Occluder.pIndices || Occluder.NumIndices == 0)
+		return;
+
+	Timer t; t.Start();
+
+	// transform the vertices referenced by the index buffer to clip space
+	uint32 NumVertices = 0;
+	for (uint32 i = 0; i < Occluder.NumIndices; ++i)
+		NumVertices = std::max(NumVertices, Occluder.pIndices[i] + 1);
+	mClipSpaceVertices.resize(NumVertices);
+
+	const XMMATRIX matWorldViewProj = Occluder.matWorld * XMLoadFloat4x4(&mMatViewProj);
+	XMVector3TransformStream(mClipSpaceVertices.data(), sizeof(XMFLOAT4), Occluder.pVertices, sizeof(XMFLOAT3), NumVertices, matWorldViewProj);
+
+	const float W = static_cast<float>(mWidth);
+	const float H = static_cast<float>(mHeight);
+	auto fnToScreen = [W, H](const XMFLOAT4& v) -> FScreenVertex
+	{
+		const float InvW = 1.0f / v.w;
+		return { (v.x * InvW * 0.5f + 0.5f) * W, (0.5f - v.y * InvW * 0.5f) * H, v.z * InvW };
+	};
+	auto fnLerp = [](const XMFLOAT4& a, const XMFLOAT4& b, float t) -> XMFLOAT4
+	{
+		return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+	};
+
+	const uint32 NumTriangles = Occluder.NumIndices / 3;
+	for (uint32 tri = 0; tri < NumTriangles; ++tri)
+	{
+		const XMFLOAT4 v[3] =
+		{
+			  mClipSpaceVertices[Occluder.pIndices[tri * 3 + 0]]
+			, mClipSpaceVertices[Occluder.pIndices[tri * 3 + 1]]
+			, mClipSpaceVertices[Occluder.pIndices[tri * 3 + 2]]
+		};
+
+		// trivial reject: all vertices outside the same clip plane (D3D clip space: -w<=x,y<=w, 0<=z<=w)
+		if ((v[0].z < 0.0f     && v[1].z < 0.0f     && v[2].z < 0.0f    )
+		||  (v[0].x < -v[0].w  && v[1].x < -v[1].w  && v[2].x < -v[2].w )
+		||  (v[0].x >  v[0].w  && v[1].x >  v[1].w  && v[2].x >  v[2].w )
+		||  (v[0].y < -v[0].w  && v[1].y < -v[1].w  && v[2].y < -v[2].w )
+		||  (v[0].y >  v[0].w  && v[1].y >  v[1].w  && v[2].y >  v[2].w ))
+			continue;
+
+		const bool bCrossesNearPlane = v[0].z < 0.0f || v[1].z < 0.0f || v[2].z < 0.0f;
+		if (!bCrossesNearPlane)
+		{
+			RasterizeTriangle(fnToScreen(v[0]), fnToScreen(v[1]), fnToScreen(v[2]));
+			continue;
+		}
+
+		// clip against the near plane (z=0): results in a triangle or a quad
+		XMFLOAT4 Clipped[4];
+		int NumClipped = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			const XMFLOAT4& a = v[i];
+			const XMFLOAT4& b = v[(i + 1) % 3];
+			if (a.z >= 0.0f)
+				Clipped[NumClipped++] = a;
+			if ((a.z >= 0.0f) != (b.z >= 0.0f))
+				Clipped[NumClipped++] = fnLerp(a, b, a.z / (a.z - b.z));
+		}
+		for (int i = 1; i + 1 < NumClipped; ++i)
+			RasterizeTriangle(fnToScreen(Clipped[0]), fnToScreen(Clipped[i]), fnToScreen(Clipped[i + 1]));
+	}
+
+	++mStats.NumOccluders;
+	mStats.NumOccluderTriangles += NumTriangles;
+	mStats.RasterizationTimeMs += t.Tick() * 1000.0f;
+}
+
+void OcclusionCuller::RasterizeTriangle(FScreenVertex v0, FScreenVertex v1, FScreenVertex v2)
+{
+	// orient the triangle so that the edge functions are positive inside
+	float Area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (Area < 0.0f)
+	{
+		std::swap(v1, v2);
+		Area = -Area;
+	}
+	if (!(Area > 1e-6f)) // also rejects NaNs
+		return;
+
+	// bounding rectangle of the pixel centers, clamped to the buffer
+	const int x0 = std::max(0                        , static_cast<int>(std::ceil (std::min({ v0.x, v1.x, v2.x }) - 0.5f)));
+	const int x1 = std::min(static_cast<int>(mWidth ) - 1, static_cast<int>(std::floor(std::max({ v0.x, v1.x, v2.x }) - 0.5f)));
+	const int y0 = std::max(0                        , static_cast<int>(std::ceil (std::min({ v0.y, v1.y, v2.y }) - 0.5f)));
+	const int y1 = std::min(static_cast<int>(mHeight) - 1, static_cast<int>(std::floor(std::max({ v0.y, v1.y, v2.y }) - 0.5f)));
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	// edge functions E(x, y) = A*x + B*y + C, E_ij is opposite of vertex k
+	const float A01 = v0.y - v1.y, B01 = v1.x - v0.x, C01 = -(A01 * v0.x + B01 * v0.y);
+	const float A12 = v1.y - v2.y, B12 = v2.x - v1.x, C12 = -(A12 * v1.x + B12 * v1.y);
+	const float A20 = v2.y - v0.y, B20 = v0.x - v2.x, C20 = -(A20 * v2.x + B20 * v2.y);
+
+	// the edge functions of a shared edge are evaluated w/ different rounding in each triangle, which
+	// leaves pixel cracks along the edge. A 1/256 px outward bias closes them (C is used for the depth plane below).
+	constexpr float EDGE_BIAS = 1.0f / 256.0f;
+	const float C01b = C01 + (std::abs(A01) + std::abs(B01)) * EDGE_BIAS;
+	const float C12b = C12 + (std::abs(A12) + std::abs(B12)) * EDGE_BIAS;
+	const float C20b = C20 + (std::abs(A20) + std::abs(B20)) * EDGE_BIAS;
+
+	// depth plane Z(x, y) = Zx*x + Zy*y + Zc from the barycentrics
+	const float InvArea = 1.0f / Area;
+	const float Zx = (A12 * v0.z + A20 * v1.z + A01 * v2.z) * InvArea;
+	const float Zy = (B12 * v0.z + B20 * v1.z + B01 * v2.z) * InvArea;
+	const float Zc = (C12 * v0.z + C20 * v1.z + C01 * v2.z) * InvArea;
+
+	++mStats.NumRasterizedTriangles;
+
+	// rows are processed in 8-pixel aligned blocks, mWidth is a multiple of TILE_SIZE=8
+	static_assert(TILE_SIZE % 8 == 0, "Rasterizer processes 8 pixels at a time");
+	const int xBegin = x0 & ~7;
+
+	if (mbUseAVX2)
+	{
+		const __m256 vLaneOffset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256 vZero = _mm256_setzero_ps();
+		const __m256 vA01 = _mm256_set1_ps(A01), vA12 = _mm256_set1_ps(A12), vA20 = _mm256_set1_ps(A20);
+		const __m256 vZx = _mm256_set1_ps(Zx);
+		for (int y = y0; y <= y1; ++y)
+		{
+			const float fy = static_cast<float>(y) + 0.5f;
+			const __m256 vRow01 = _mm256_set1_ps(B01 * fy + C01b);
+			const __m256 vRow12 = _mm256_set1_ps(B12 * fy + C12b);
+			const __m256 vRow20 = _mm256_set1_ps(B20 * fy + C20b);
+			const __m256 vRowZ  = _mm256_set1_ps(Zy  * fy + Zc );
+			float* pRow = &mDepthBuffer[y * mWidth];
+			for (int x = xBegin; x <= x1; x += 8)
+			{
+				const __m256 vx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), vLaneOffset);
+				const __m256 e01 = _mm256_add_ps(_mm256_mul_ps(vA01, vx), vRow01);
+				const __m256 e12 = _mm256_add_ps(_mm256_mul_ps(vA12, vx), vRow12);
+				const __m256 e20 = _mm256_add_ps(_mm256_mul_ps(vA20, vx), vRow20);
+				const __m256 vInside = _mm256_and_ps(_mm256_and_ps(
+					  _mm256_cmp_ps(e01, vZero, _CMP_GE_OQ)
+					, _mm256_cmp_ps(e12, vZero, _CMP_GE_OQ))
+					, _mm256_cmp_ps(e20, vZero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(vInside) == 0)
+					continue;
+
+				const __m256 vZ     = _mm256_add_ps(_mm256_mul_ps(vZx, vx), vRowZ);
+				const __m256 vDepth = _mm256_loadu_ps(pRow + x);
+				_mm256_storeu_ps(pRow + x, _mm256_blendv_ps(vDepth, _mm256_min_ps(vDepth, vZ), vInside));
+			}
+		}
+	}
+	else
+	{
+		for (int y = y0; y <= y1; ++y)
+		{
+			const float fy = static_cast<float>(y) + 0.5f;
+			const float Row01 = B01 * fy + C01b;
+			const float Row12 = B12 * fy + C12b;
+			const float Row20 = B20 * fy + C20b;
+			const float RowZ  = Zy  * fy + Zc;
+			float* pRow = &mDepthBuffer[y * mWidth];
+			for (int x = xBegin; x < xBegin + ((x1 - xBegin) / 8 + 1) * 8; ++x)
+			{
+				const float fx = static_cast<float>(x) + 0.5f;
+				if (A01 * fx + Row01 >= 0.0f && A12 * fx + Row12 >= 0.0f && A20 * fx + Row20 >= 0.0f)
+				{
+					pRow[x] = std::min(pRow[x], Zx * fx + RowZ);
+				}
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildDepthHierarchy()
+{
+	// level 0: farthest depth of each TILE_SIZE x TILE_SIZE block of pixels
+	for (uint32 ty = 0; ty < mNumTilesY; ++ty)
+	for (uint32 tx = 0; tx < mNumTilesX; ++tx)
+	{
+		float MaxDepth = 0.0f;
+		for (uint32 y = ty * TILE_SIZE; y < (ty + 1) * TILE_SIZE; ++y)
+		{
+			const float* pRow = &mDepthBuffer[y * mWidth + tx * TILE_SIZE];
+			for (uint32 x = 0; x < TILE_SIZE; ++x)
+				MaxDepth = std::max(MaxDepth, pRow[x]);
+		}
+		mTileMaxDepth[ty * mNumTilesX + tx] = MaxDepth;
+	}
+
+	// level 1: farthest depth of each COARSE_TILE_SIZE x COARSE_TILE_SIZE block of tiles
+	for (uint32 cy = 0; cy < mNumCoarseTilesY; ++cy)
+	for (uint32 cx = 0; cx < mNumCoarseTilesX; ++cx)
+	{
+		float MaxDepth = 0.0f;
+		for (uint32 ty = cy * COARSE_TILE_SIZE; ty < std::min((cy + 1) * COARSE_TILE_SIZE, mNumTilesY); ++ty)
+		for (uint32 tx = cx * COARSE_TILE_SIZE; tx < std::min((cx + 1) * COARSE_TILE_SIZE, mNumTilesX); ++tx)
+			MaxDepth = std::max(MaxDepth, mTileMaxDepth[ty * mNumTilesX + tx]);
+		mCoarseTileMaxDepth[cy * mNumCoarseTilesX + cx] = MaxDepth;
+	}
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// TESTING
+//
+//------------------------------------------------------------------------------------------------------------------------------
+bool OcclusionCuller::IsRectOccluded(const std::vector<float>& TileMaxDepths, uint32 NumTilesX, int x0, int y0, int x1, int y1, float MinDepth) const
+{
+	for (int y = y0; y <= y1; ++y)
+	for (int x = x0; x <= x1; ++x)
+	{
+		if (TileMaxDepths[y * NumTilesX + x] >= MinDepth)
+			return false;
+	}
+	return true;
+}
+
+bool OcclusionCuller::IsBoundingBoxOccluded(const FBoundingBox& BBox) const
+{
+	mNumTestedBoundingBoxes.fetch_add(1, std::memory_order_relaxed);
+
+	const XMMATRIX matViewProj = XMLoadFloat4x4(&mMatViewProj);
+	const std::array<XMFLOAT4, 8> Corners = BBox.GetCornerPointsF4();
+
+	float MinX = +FLT_MAX, MinY = +FLT_MAX, MinZ = +FLT_MAX;
+	float MaxX = -FLT_MAX, MaxY = -FLT_MAX;
+	for (const XMFLOAT4& Corner : Corners)
+	{
+		XMFLOAT4 v;
+		XMStoreFloat4(&v, XMVector4Transform(XMLoadFloat4(&Corner), matViewProj));
+		if (v.z < 0.0f) // in front of the near plane: the box contains or is too close to the camera
+			return false;
+
+		const float InvW = 1.0f / v.w;
+		const float x = (v.x * InvW * 0.5f + 0.5f) * mWidth;
+		const float y = (0.5f - v.y * InvW * 0.5f) * mHeight;
+		MinX = std::min(MinX, x); MaxX = std::max(MaxX, x);
+		MinY = std::min(MinY, y); MaxY = std::max(MaxY, y);
+		MinZ = std::min(MinZ, v.z * InvW);
+	}
+
+	// off-screen boxes are left to the frustum culling
+	if (MaxX < 0.0f || MaxY < 0.0f || MinX >= mWidth || MinY >= mHeight)
+		return false;
+
+	const int px0 = std::max(0, static_cast<int>(MinX));
+	const int py0 = std::max(0, static_cast<int>(MinY));
+	const int px1 = std::min(static_cast<int>(mWidth ) - 1, static_cast<int>(MaxX));
+	const int py1 = std::min(static_cast<int>(mHeight) - 1, static_cast<int>(MaxY));
+
+	// coarse level covers a superset of the rectangle: occluded there means occluded
+	const int COARSE_TILE_SIZE_PX = TILE_SIZE * COARSE_TILE_SIZE;
+	bool bOccluded = IsRectOccluded(mCoarseTileMaxDepth, mNumCoarseTilesX
+		, px0 / COARSE_TILE_SIZE_PX, py0 / COARSE_TILE_SIZE_PX, px1 / COARSE_TILE_SIZE_PX, py1 / COARSE_TILE_SIZE_PX, MinZ);
+	if (!bOccluded)
+	{
+		bOccluded = IsRectOccluded(mTileMaxDepth, mNumTilesX, px0 / TILE_SIZE, py0 / TILE_SIZE, px1 / TILE_SIZE, py1 / TILE_SIZE, MinZ);
+	}
+
+	if (bOccluded)
+		mNumOccludedBoundingBoxes.fetch_add(1, std::memory_order_relaxed);
+	return bOccluded;
+}
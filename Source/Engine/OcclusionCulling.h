@@ -0,0 +1,117 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Culling.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+struct FOccluderMesh
+{
+	const DirectX::XMFLOAT3* pVertices  = nullptr;
+	const uint32*            pIndices   = nullptr;
+	uint32                   NumIndices = 0;
+	DirectX::XMMATRIX        matWorld;
+};
+
+//
+// OCCLUSION CULLER
+//
+// Software occlusion culling on the CPU: a budgeted set of occluder meshes is rasterized into a
+// low resolution depth buffer, which is reduced into a hierarchy of max-depth tiles that the
+// bounding boxes are tested against.
+//
+// - Depth is the post-projection z/w in [0, 1] (near, far), the buffer is cleared to 1.0.
+// - Occluders are clipped against the near plane, the screen bounds are handled by the scissor.
+// - A box is occluded if its nearest depth is behind the farthest occluder depth of every
+//   tile its screen rectangle touches. Boxes crossing the near plane are never occluded.
+// - The rasterizer processes 8 pixels per iteration w/ AVX2 if the CPU supports it,
+//   the scalar path produces the same results.
+//
+class OcclusionCuller
+{
+public:
+	static constexpr uint32 DEFAULT_WIDTH  = 320;
+	static constexpr uint32 DEFAULT_HEIGHT = 192;
+	static constexpr uint32 TILE_SIZE      = 8;  // px, hierarchy level 0
+	static constexpr uint32 COARSE_TILE_SIZE = 4; // tiles, hierarchy level 1
+
+	struct FStatistics
+	{
+		uint32 NumOccluders             = 0;
+		uint32 NumOccluderTriangles     = 0;
+		uint32 NumRasterizedTriangles   = 0; // after near clipping, screen and degenerate rejection
+		uint32 NumTestedBoundingBoxes   = 0;
+		uint32 NumOccludedBoundingBoxes = 0;
+		float  RasterizationTimeMs      = 0.0f;
+	};
+
+public:
+	OcclusionCuller();
+
+	// Width & Height are rounded up to a multiple of TILE_SIZE
+	void Initialize(uint32 Width = DEFAULT_WIDTH, uint32 Height = DEFAULT_HEIGHT);
+
+	// Single threaded: BeginFrame() -> RasterizeOccluder() x N -> EndFrame()
+	void BeginFrame(const DirectX::XMMATRIX& matViewProj);
+	void RasterizeOccluder(const FOccluderMesh& Occluder);
+	void EndFrame();
+
+	// Thread safe between EndFrame() and the next BeginFrame()
+	bool IsBoundingBoxOccluded(const FBoundingBox& WorldSpaceBoundingBox) const;
+
+	// Statistics of the previous frame, published by BeginFrame(). Thread safe.
+	FStatistics GetStatistics() const;
+	inline uint32 GetWidth()  const { return mWidth; }
+	inline uint32 GetHeight() const { return mHeight; }
+	inline const std::vector<float>& GetDepthBuffer() const { return mDepthBuffer; }
+
+	inline void SetUseAVX2(bool bUseAVX2) { mbUseAVX2 = bUseAVX2 && IsAVX2Supported(); }
+	static bool IsAVX2Supported();
+
+private:
+	struct FScreenVertex { float x, y, z; }; // x, y: pixels, z: NDC depth
+
+	void RasterizeTriangle(FScreenVertex v0, FScreenVertex v1, FScreenVertex v2);
+	void BuildDepthHierarchy();
+	bool IsRectOccluded(const std::vector<float>& TileMaxDepths, uint32 NumTilesX, int x0, int y0, int x1, int y1, float MinDepth) const;
+
+private:
+	uint32 mWidth  = 0;
+	uint32 mHeight = 0;
+	uint32 mNumTilesX = 0;
+	uint32 mNumTilesY = 0;
+	uint32 mNumCoarseTilesX = 0;
+	uint32 mNumCoarseTilesY = 0;
+	bool   mbUseAVX2 = false;
+
+	DirectX::XMFLOAT4X4 mMatViewProj;
+
+	std::vector<float> mDepthBuffer;           // mWidth x mHeight
+	std::vector<float> mTileMaxDepth;          // farthest depth per TILE_SIZE^2 pixels
+	std::vector<float> mCoarseTileMaxDepth;    // farthest depth per COARSE_TILE_SIZE^2 tiles
+	std::vector<DirectX::XMFLOAT4> mClipSpaceVertices; // scratch
+
+	FStatistics                 mStats; // current frame, written by the thread that rasterizes
+	mutable std::atomic<uint32> mNumTestedBoundingBoxes;
+	mutable std::atomic<uint32> mNumOccludedBoundingBoxes;
+	FStatistics                 mPublishedStats;
+	mutable std::mutex          mMtxPublishedStats;
+};
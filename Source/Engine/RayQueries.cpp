@@ -0,0 +1,647 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "RayQueries.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <future>
+
+using namespace DirectX;
+
+static constexpr uint32 NUM_SAH_BINS          = 16;
+static constexpr float  SAH_TRAVERSAL_COST    = 1.0f;  // relative to a triangle packet / instance test
+static constexpr uint32 MAX_SAH_BUILD_DEPTH   = 48;    // median splits below, bounds the traversal stack
+static constexpr uint32 TRAVERSAL_STACK_SIZE  = 96;
+static constexpr uint32 TRIANGLES_PER_PACKET  = 4;
+
+struct RayQueryAccelerationStructure::FBuildPrimitive
+{
+	XMFLOAT3 Min;
+	XMFLOAT3 Max;
+	XMFLOAT3 Centroid;
+};
+
+namespace
+{
+	struct FRaySoA
+	{
+		XMVECTOR Ox, Oy, Oz;
+		XMVECTOR Dx, Dy, Dz;
+	};
+
+	struct FTraversalEntry
+	{
+		uint32 iNode;
+		float  TEntry;
+	};
+}
+
+template<class TFunc>
+static void ParallelForRanges(size_t NumItems, ThreadPool* pWorkerThreadPool, TFunc&& fnProcessRange)
+{
+	const size_t NumThreads = pWorkerThreadPool ? std::min(NumItems, pWorkerThreadPool->GetThreadPoolSize() + 1) : 1;
+	if (NumThreads <= 1)
+	{
+		fnProcessRange(size_t(0), NumItems);
+		return;
+	}
+
+	// contiguous ranges, the first one is processed on this thread
+	std::vector<std::future<void>> Tasks;
+	const size_t NumItemsPerThread = (NumItems + NumThreads - 1) / NumThreads;
+	for (size_t iBegin = NumItemsPerThread; iBegin < NumItems; iBegin += NumItemsPerThread)
+	{
+		const size_t iEnd = std::min(iBegin + NumItemsPerThread, NumItems);
+		Tasks.push_back(pWorkerThreadPool->AddTask([&fnProcessRange, iBegin, iEnd]() { fnProcessRange(iBegin, iEnd); }));
+	}
+	fnProcessRange(size_t(0), std::min(NumItemsPerThread, NumItems));
+	for (std::future<void>& Task : Tasks)
+		Task.wait();
+}
+
+static inline float GetComponent(const XMFLOAT3& f3, uint32 Axis) { return (&f3.x)[Axis]; }
+
+static float CalculateSurfaceArea(const XMFLOAT3& Min, const XMFLOAT3& Max)
+{
+	const float dx = Max.x - Min.x;
+	const float dy = Max.y - Min.y;
+	const float dz = Max.z - Min.z;
+	return dx < 0.0f ? 0.0f : 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static void GrowBounds(XMFLOAT3& Min, XMFLOAT3& Max, const XMFLOAT3& PrimMin, const XMFLOAT3& PrimMax)
+{
+	Min = XMFLOAT3(std::min(Min.x, PrimMin.x), std::min(Min.y, PrimMin.y), std::min(Min.z, PrimMin.z));
+	Max = XMFLOAT3(std::max(Max.x, PrimMax.x), std::max(Max.y, PrimMax.y), std::max(Max.z, PrimMax.z));
+}
+
+// zero components would make the slab test produce NaNs (0 * inf)
+static inline XMVECTOR XM_CALLCONV CalculateSafeReciprocal(FXMVECTOR D)
+{
+	const XMVECTOR Tiny = XMVectorReplicate(1e-30f);
+	const XMVECTOR SignedTiny = XMVectorSelect(Tiny, XMVectorNegate(Tiny), XMVectorLess(D, XMVectorZero()));
+	return XMVectorReciprocal(XMVectorSelect(D, SignedTiny, XMVectorLess(XMVectorAbs(D), Tiny)));
+}
+
+template<class TNode>
+static inline bool XM_CALLCONV IntersectBox(const TNode& Node, FXMVECTOR O, FXMVECTOR InvD, float TMin, float TMax, float& OutTEntry)
+{
+	const XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&Node.Min), O), InvD);
+	const XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&Node.Max), O), InvD);
+	const XMVECTOR tNear = XMVectorMin(t0, t1);
+	const XMVECTOR tFar  = XMVectorMax(t0, t1);
+	const float Entry = std::max(XMVectorGetX(XMVectorMax(XMVectorSplatX(tNear), XMVectorMax(XMVectorSplatY(tNear), XMVectorSplatZ(tNear)))), TMin);
+	const float Exit  = std::min(XMVectorGetX(XMVectorMin(XMVectorSplatX(tFar) , XMVectorMin(XMVectorSplatY(tFar) , XMVectorSplatZ(tFar)))) , TMax);
+	OutTEntry = Entry;
+	return Entry <= Exit;
+}
+
+// Moller-Trumbore on 4 triangles: returns the lane of the closest hit in [TMin, TMax) or -1
+template<class TPacket>
+static inline int IntersectTrianglePacket(const TPacket& p, const FRaySoA& r, float TMin, float TMax, float& OutT, float& OutU, float& OutV)
+{
+	const XMVECTOR e1x = XMLoadFloat4A(&p.E1[0]), e1y = XMLoadFloat4A(&p.E1[1]), e1z = XMLoadFloat4A(&p.E1[2]);
+	const XMVECTOR e2x = XMLoadFloat4A(&p.E2[0]), e2y = XMLoadFloat4A(&p.E2[1]), e2z = XMLoadFloat4A(&p.E2[2]);
+
+	// P = D x E2
+	const XMVECTOR px = XMVectorNegativeMultiplySubtract(r.Dz, e2y, XMVectorMultiply(r.Dy, e2z));
+	const XMVECTOR py = XMVectorNegativeMultiplySubtract(r.Dx, e2z, XMVectorMultiply(r.Dz, e2x));
+	const XMVECTOR pz = XMVectorNegativeMultiplySubtract(r.Dy, e2x, XMVectorMultiply(r.Dx, e2y));
+	const XMVECTOR Det = XMVectorMultiplyAdd(e1x, px, XMVectorMultiplyAdd(e1y, py, XMVectorMultiply(e1z, pz)));
+	const XMVECTOR InvDet = XMVectorReciprocal(Det);
+
+	// S = O - V0, Q = S x E1
+	const XMVECTOR sx = XMVectorSubtract(r.Ox, XMLoadFloat4A(&p.V0[0]));
+	const XMVECTOR sy = XMVectorSubtract(r.Oy, XMLoadFloat4A(&p.V0[1]));
+	const XMVECTOR sz = XMVectorSubtract(r.Oz, XMLoadFloat4A(&p.V0[2]));
+	const XMVECTOR qx = XMVectorNegativeMultiplySubtract(sz, e1y, XMVectorMultiply(sy, e1z));
+	const XMVECTOR qy = XMVectorNegativeMultiplySubtract(sx, e1z, XMVectorMultiply(sz, e1x));
+	const XMVECTOR qz = XMVectorNegativeMultiplySubtract(sy, e1x, XMVectorMultiply(sx, e1y));
+
+	const XMVECTOR u = XMVectorMultiply(XMVectorMultiplyAdd(sx, px, XMVectorMultiplyAdd(sy, py, XMVectorMultiply(sz, pz))), InvDet);
+	const XMVECTOR v = XMVectorMultiply(XMVectorMultiplyAdd(r.Dx, qx, XMVectorMultiplyAdd(r.Dy, qy, XMVectorMultiply(r.Dz, qz))), InvDet);
+	const XMVECTOR t = XMVectorMultiply(XMVectorMultiplyAdd(e2x, qx, XMVectorMultiplyAdd(e2y, qy, XMVectorMultiply(e2z, qz))), InvDet);
+
+	// comparisons against NaNs (degenerate & padding triangles) fail
+	const XMVECTOR Zero = XMVectorZero();
+	XMVECTOR Mask = XMVectorNotEqual(Det, Zero);
+	Mask = XMVectorAndInt(Mask, XMVectorGreaterOrEqual(u, Zero));
+	Mask = XMVectorAndInt(Mask, XMVectorGreaterOrEqual(v, Zero));
+	Mask = XMVectorAndInt(Mask, XMVectorLessOrEqual(XMVectorAdd(u, v), XMVectorSplatOne()));
+	Mask = XMVectorAndInt(Mask, XMVectorGreaterOrEqual(t, XMVectorReplicate(TMin)));
+	Mask = XMVectorAndInt(Mask, XMVectorLess(t, XMVectorReplicate(TMax)));
+	if (XMVector4EqualInt(Mask, XMVectorFalseInt()))
+		return -1;
+
+	XMFLOAT4A T, U, V;
+	XMStoreFloat4A(&T, XMVectorSelect(XMVectorReplicate(FLT_MAX), t, Mask));
+	XMStoreFloat4A(&U, u);
+	XMStoreFloat4A(&V, v);
+	const float* pT = &T.x;
+	int iLane = 0;
+	for (int i = 1; i < 4; ++i)
+		iLane = pT[i] < pT[iLane] ? i : iLane;
+	OutT = pT[iLane];
+	OutU = (&U.x)[iLane];
+	OutV = (&V.x)[iLane];
+	return iLane;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// BUILD
+//
+//------------------------------------------------------------------------------------------------------------------------------
+FRay FRay::FromSegment(const XMFLOAT3& From, const XMFLOAT3& To, float Epsilon)
+{
+	FRay Ray;
+	Ray.Origin    = From;
+	Ray.Direction = XMFLOAT3(To.x - From.x, To.y - From.y, To.z - From.z);
+	Ray.TMin      = Epsilon;
+	Ray.TMax      = 1.0f - Epsilon;
+	return Ray;
+}
+
+void RayQueryAccelerationStructure::BuildBVH(const std::vector<FBuildPrimitive>& Primitives, uint32 MaxLeafSize, uint32 LeafCostGranularity, std::vector<FNode>& OutNodes, std::vector<uint32>& OutOrder)
+{
+	const uint32 NumPrimitives = static_cast<uint32>(Primitives.size());
+	OutNodes.clear();
+	OutOrder.resize(NumPrimitives);
+	for (uint32 i = 0; i < NumPrimitives; ++i)
+		OutOrder[i] = i;
+	if (NumPrimitives == 0)
+		return;
+
+	auto fnLeafCost = [LeafCostGranularity](uint32 Count) { return static_cast<float>((Count + LeafCostGranularity - 1) / LeafCostGranularity); };
+
+	struct FBuildTask { uint32 iNode, Begin, End, Depth; };
+	std::vector<FBuildTask> Tasks;
+	OutNodes.reserve(NumPrimitives * 2);
+	OutNodes.push_back({});
+	Tasks.push_back({ 0, 0, NumPrimitives, 0 });
+	while (!Tasks.empty())
+	{
+		const FBuildTask Task = Tasks.back();
+		Tasks.pop_back();
+		const uint32 NumNodePrimitives = Task.End - Task.Begin;
+
+		XMFLOAT3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		XMFLOAT3 CentroidMin = Min, CentroidMax = Max;
+		for (uint32 i = Task.Begin; i < Task.End; ++i)
+		{
+			const FBuildPrimitive& Prim = Primitives[OutOrder[i]];
+			GrowBounds(Min, Max, Prim.Min, Prim.Max);
+			GrowBounds(CentroidMin, CentroidMax, Prim.Centroid, Prim.Centroid);
+		}
+		{
+			FNode& Node = OutNodes[Task.iNode];
+			Node.Min = Min;
+			Node.Max = Max;
+			Node.LeftOrFirst = Task.Begin;
+			Node.Count = NumNodePrimitives;
+		}
+		if (NumNodePrimitives == 1)
+			continue;
+
+		// binned SAH over the centroid bounds
+		const float NodeArea = CalculateSurfaceArea(Min, Max);
+		float  BestCost = FLT_MAX;
+		uint32 BestAxis = 0;
+		uint32 BestBin  = 0;
+		if (Task.Depth < MAX_SAH_BUILD_DEPTH)
+		{
+			for (uint32 Axis = 0; Axis < 3; ++Axis)
+			{
+				const float AxisMin = GetComponent(CentroidMin, Axis);
+				const float AxisExtent = GetComponent(CentroidMax, Axis) - AxisMin;
+				if (AxisExtent <= 0.0f)
+					continue;
+
+				struct FBin { XMFLOAT3 Min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX); XMFLOAT3 Max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX); uint32 Count = 0; };
+				std::array<FBin, NUM_SAH_BINS> Bins;
+				const float BinScale = NUM_SAH_BINS / AxisExtent;
+				for (uint32 i = Task.Begin; i < Task.End; ++i)
+				{
+					const FBuildPrimitive& Prim = Primitives[OutOrder[i]];
+					const uint32 iBin = std::min(NUM_SAH_BINS - 1, static_cast<uint32>((GetComponent(Prim.Centroid, Axis) - AxisMin) * BinScale));
+					GrowBounds(Bins[iBin].Min, Bins[iBin].Max, Prim.Min, Prim.Max);
+					++Bins[iBin].Count;
+				}
+
+				// sweep from the right, then evaluate the splits from the left
+				std::array<float, NUM_SAH_BINS> RightCosts;
+				FBin Right;
+				for (uint32 iBin = NUM_SAH_BINS - 1; iBin > 0; --iBin)
+				{
+					GrowBounds(Right.Min, Right.Max, Bins[iBin].Min, Bins[iBin].Max);
+					Right.Count += Bins[iBin].Count;
+					RightCosts[iBin] = Right.Count > 0 ? CalculateSurfaceArea(Right.Min, Right.Max) * fnLeafCost(Right.Count) : 0.0f;
+				}
+				FBin Left;
+				for (uint32 iBin = 0; iBin < NUM_SAH_BINS - 1; ++iBin)
+				{
+					GrowBounds(Left.Min, Left.Max, Bins[iBin].Min, Bins[iBin].Max);
+					Left.Count += Bins[iBin].Count;
+					if (Left.Count == 0 || Left.Count == NumNodePrimitives)
+						continue;
+					const float Cost = SAH_TRAVERSAL_COST + (CalculateSurfaceArea(Left.Min, Left.Max) * fnLeafCost(Left.Count) + RightCosts[iBin + 1]) / std::max(NodeArea, FLT_MIN);
+					if (Cost < BestCost)
+					{
+						BestCost = Cost;
+						BestAxis = Axis;
+						BestBin  = iBin;
+					}
+				}
+			}
+		}
+
+		const bool bFoundSplit = BestCost < FLT_MAX;
+		if (NumNodePrimitives <= MaxLeafSize && (!bFoundSplit || fnLeafCost(NumNodePrimitives) <= BestCost))
+			continue;
+
+		uint32 Mid = 0;
+		if (bFoundSplit)
+		{
+			const float AxisMin = GetComponent(CentroidMin, BestAxis);
+			const float BinScale = NUM_SAH_BINS / (GetComponent(CentroidMax, BestAxis) - AxisMin);
+			uint32* pMid = std::partition(OutOrder.data() + Task.Begin, OutOrder.data() + Task.End, [&](uint32 iPrim)
+			{
+				const uint32 iBin = std::min(NUM_SAH_BINS - 1, static_cast<uint32>((GetComponent(Primitives[iPrim].Centroid, BestAxis) - AxisMin) * BinScale));
+				return iBin <= BestBin;
+			});
+			Mid = static_cast<uint32>(pMid - OutOrder.data());
+		}
+		else
+		{
+			// coincident centroids or too deep: median split along the longest axis
+			const XMFLOAT3 Extent(CentroidMax.x - CentroidMin.x, CentroidMax.y - CentroidMin.y, CentroidMax.z - CentroidMin.z);
+			const uint32 Axis = (Extent.x >= Extent.y && Extent.x >= Extent.z) ? 0 : (Extent.y >= Extent.z ? 1 : 2);
+			Mid = Task.Begin + NumNodePrimitives / 2;
+			std::nth_element(OutOrder.data() + Task.Begin, OutOrder.data() + Mid, OutOrder.data() + Task.End, [&](uint32 a, uint32 b)
+			{
+				return GetComponent(Primitives[a].Centroid, Axis) < GetComponent(Primitives[b].Centroid, Axis);
+			});
+		}
+		assert(Mid > Task.Begin && Mid < Task.End);
+
+		const uint32 iLeft = static_cast<uint32>(OutNodes.size());
+		OutNodes.push_back({});
+		OutNodes.push_back({});
+		OutNodes[Task.iNode].LeftOrFirst = iLeft;
+		OutNodes[Task.iNode].Count = 0;
+		Tasks.push_back({ iLeft + 1, Mid, Task.End, Task.Depth + 1 });
+		Tasks.push_back({ iLeft, Task.Begin, Mid, Task.Depth + 1 });
+	}
+}
+
+uint32 RayQueryAccelerationStructure::AddMesh(const float* pPositions, uint32 PositionStride, uint32 NumVertices, const uint32* pIndices, uint32 NumIndices)
+{
+	Timer t; t.Start();
+
+	auto fnPosition = [&](uint32 iVertex)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8*>(pPositions) + static_cast<size_t>(iVertex) * PositionStride);
+		return XMFLOAT3(p[0], p[1], p[2]);
+	};
+
+	// degenerate triangles are kept, the intersection test rejects them
+	std::vector<FBuildPrimitive> Primitives;
+	std::vector<uint32> PrimitiveTriangles;
+	const uint32 NumTriangles = NumIndices / 3;
+	Primitives.reserve(NumTriangles);
+	PrimitiveTriangles.reserve(NumTriangles);
+	for (uint32 iTriangle = 0; iTriangle < NumTriangles; ++iTriangle)
+	{
+		const uint32* i = &pIndices[iTriangle * 3];
+		if (i[0] >= NumVertices || i[1] >= NumVertices || i[2] >= NumVertices)
+		{
+			assert(false);
+			continue;
+		}
+		const XMFLOAT3 p0 = fnPosition(i[0]), p1 = fnPosition(i[1]), p2 = fnPosition(i[2]);
+		FBuildPrimitive Prim;
+		Prim.Min = p0;
+		Prim.Max = p0;
+		GrowBounds(Prim.Min, Prim.Max, p1, p1);
+		GrowBounds(Prim.Min, Prim.Max, p2, p2);
+		Prim.Centroid = XMFLOAT3((Prim.Min.x + Prim.Max.x) * 0.5f, (Prim.Min.y + Prim.Max.y) * 0.5f, (Prim.Min.z + Prim.Max.z) * 0.5f);
+		Primitives.push_back(Prim);
+		PrimitiveTriangles.push_back(iTriangle);
+	}
+
+	FMesh Mesh;
+	std::vector<uint32> Order;
+	BuildBVH(Primitives, MAX_LEAF_TRIANGLES, TRIANGLES_PER_PACKET, Mesh.Nodes, Order);
+	Mesh.NumTriangles = static_cast<uint32>(Primitives.size());
+
+	// leaves: primitive ranges -> packet ranges
+	for (FNode& Node : Mesh.Nodes)
+	{
+		if (Node.Count == 0)
+			continue;
+		const uint32 FirstPacket = static_cast<uint32>(Mesh.Packets.size());
+		for (uint32 iFirst = 0; iFirst < Node.Count; iFirst += TRIANGLES_PER_PACKET)
+		{
+			FTrianglePacket Packet = {};
+			for (uint32 iLane = 0; iLane < TRIANGLES_PER_PACKET; ++iLane)
+			{
+				if (iFirst + iLane >= Node.Count)
+				{
+					Packet.TriangleIndex[iLane] = FRayHit::INVALID_INDEX;
+					continue;
+				}
+				const uint32 iTriangle = PrimitiveTriangles[Order[Node.LeftOrFirst + iFirst + iLane]];
+				const uint32* i = &pIndices[iTriangle * 3];
+				const XMFLOAT3 p0 = fnPosition(i[0]), p1 = fnPosition(i[1]), p2 = fnPosition(i[2]);
+				const float V0[3] = { p0.x, p0.y, p0.z };
+				const float E1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+				const float E2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+				for (int c = 0; c < 3; ++c)
+				{
+					(&Packet.V0[c].x)[iLane] = V0[c];
+					(&Packet.E1[c].x)[iLane] = E1[c];
+					(&Packet.E2[c].x)[iLane] = E2[c];
+				}
+				Packet.TriangleIndex[iLane] = iTriangle;
+			}
+			Mesh.Packets.push_back(Packet);
+		}
+		Node.LeftOrFirst = FirstPacket;
+		Node.Count = static_cast<uint32>(Mesh.Packets.size()) - FirstPacket;
+	}
+
+	mStats.NumMeshes        += 1;
+	mStats.NumMeshTriangles += Mesh.NumTriangles;
+	mStats.NumMeshNodes     += static_cast<uint32>(Mesh.Nodes.size());
+	mStats.MemoryBytes      += Mesh.Nodes.size() * sizeof(FNode) + Mesh.Packets.size() * sizeof(FTrianglePacket);
+	mStats.MeshBuildTimeMs  += t.Tick() * 1000.0f;
+
+	mMeshes.push_back(std::move(Mesh));
+	return static_cast<uint32>(mMeshes.size() - 1);
+}
+
+void RayQueryAccelerationStructure::BuildTopLevel(const FRayQueryInstance* pInstances, uint32 NumInstances)
+{
+	Timer t; t.Start();
+	mStats.MemoryBytes -= mInstances.size() * sizeof(FInstance) + mTopLevelNodes.size() * sizeof(FNode) + mTopLevelInstanceIndices.size() * sizeof(uint32);
+	mStats.NumInstanceTriangles = 0;
+	mInstances.resize(NumInstances);
+
+	// instances of empty meshes & w/ singular transformations can't be hit, they're left out of the hierarchy
+	std::vector<FBuildPrimitive> Primitives;
+	std::vector<uint32> PrimitiveInstances;
+	Primitives.reserve(NumInstances);
+	PrimitiveInstances.reserve(NumInstances);
+	for (uint32 iInstance = 0; iInstance < NumInstances; ++iInstance)
+	{
+		const FRayQueryInstance& Instance = pInstances[iInstance];
+		FInstance& Inst = mInstances[iInstance];
+		Inst.MeshIndex = Instance.MeshIndex;
+		Inst.matWorldToMesh = {};
+		if (Instance.MeshIndex >= mMeshes.size() || mMeshes[Instance.MeshIndex].Nodes.empty())
+		{
+			assert(Instance.MeshIndex < mMeshes.size());
+			continue;
+		}
+
+		const XMMATRIX matWorld = XMLoadFloat4x4(&Instance.matWorld);
+		XMVECTOR Determinant;
+		const XMMATRIX matWorldToMesh = XMMatrixInverse(&Determinant, matWorld);
+		if (XMVectorGetX(Determinant) == 0.0f)
+			continue;
+		XMStoreFloat4x4(&Inst.matWorldToMesh, matWorldToMesh);
+
+		const FNode& Root = mMeshes[Instance.MeshIndex].Nodes[0];
+		FBuildPrimitive Prim;
+		XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for (uint32 iCorner = 0; iCorner < 8; ++iCorner)
+		{
+			const XMVECTOR Corner = XMVectorSet(iCorner & 1 ? Root.Max.x : Root.Min.x, iCorner & 2 ? Root.Max.y : Root.Min.y, iCorner & 4 ? Root.Max.z : Root.Min.z, 1.0f);
+			const XMVECTOR WorldCorner = XMVector3Transform(Corner, matWorld);
+			vMin = XMVectorMin(vMin, WorldCorner);
+			vMax = XMVectorMax(vMax, WorldCorner);
+		}
+		XMStoreFloat3(&Prim.Min, vMin);
+		XMStoreFloat3(&Prim.Max, vMax);
+		XMStoreFloat3(&Prim.Centroid, XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+		Primitives.push_back(Prim);
+		PrimitiveInstances.push_back(iInstance);
+		mStats.NumInstanceTriangles += mMeshes[Instance.MeshIndex].NumTriangles;
+	}
+
+	BuildBVH(Primitives, MAX_LEAF_INSTANCES, 1, mTopLevelNodes, mTopLevelInstanceIndices);
+	for (uint32& iInstance : mTopLevelInstanceIndices)
+		iInstance = PrimitiveInstances[iInstance];
+
+	mStats.NumInstances        = NumInstances;
+	mStats.NumInstanceNodes    = static_cast<uint32>(mTopLevelNodes.size());
+	mStats.MemoryBytes        += mInstances.size() * sizeof(FInstance) + mTopLevelNodes.size() * sizeof(FNode) + mTopLevelInstanceIndices.size() * sizeof(uint32);
+	mStats.TopLevelBuildTimeMs = t.Tick() * 1000.0f;
+}
+
+void RayQueryAccelerationStructure::Clear()
+{
+	mMeshes.clear();
+	mInstances.clear();
+	mTopLevelNodes.clear();
+	mTopLevelInstanceIndices.clear();
+	mStats = {};
+}
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// QUERIES
+//
+//------------------------------------------------------------------------------------------------------------------------------
+template<bool bAnyHit>
+bool RayQueryAccelerationStructure::TraceMesh(const FMesh& Mesh, const FRay& Ray, FRayHit& Hit) const
+{
+	const XMVECTOR O = XMLoadFloat3(&Ray.Origin);
+	const XMVECTOR D = XMLoadFloat3(&Ray.Direction);
+	const XMVECTOR InvD = CalculateSafeReciprocal(D);
+	const FRaySoA RaySoA = { XMVectorSplatX(O), XMVectorSplatY(O), XMVectorSplatZ(O), XMVectorSplatX(D), XMVectorSplatY(D), XMVectorSplatZ(D) };
+	float TMax = std::min(Ray.TMax, Hit.T);
+	bool bHit = false;
+
+	FTraversalEntry Stack[TRAVERSAL_STACK_SIZE];
+	uint32 StackSize = 0;
+	float TEntry = 0.0f;
+	if (!IntersectBox(Mesh.Nodes[0], O, InvD, Ray.TMin, TMax, TEntry))
+		return false;
+	Stack[StackSize++] = { 0, TEntry };
+	while (StackSize > 0)
+	{
+		const FTraversalEntry Entry = Stack[--StackSize];
+		if (Entry.TEntry > TMax) // a closer hit was found since it was pushed
+			continue;
+
+		uint32 iNode = Entry.iNode;
+		for (;;)
+		{
+			const FNode& Node = Mesh.Nodes[iNode];
+			if (Node.Count > 0)
+			{
+				for (uint32 iPacket = Node.LeftOrFirst; iPacket < Node.LeftOrFirst + Node.Count; ++iPacket)
+				{
+					const FTrianglePacket& Packet = Mesh.Packets[iPacket];
+					float T, U, V;
+					const int iLane = IntersectTrianglePacket(Packet, RaySoA, Ray.TMin, TMax, T, U, V);
+					if (iLane < 0)
+						continue;
+					Hit.T = T;
+					Hit.TriangleIndex = Packet.TriangleIndex[iLane];
+					Hit.U = U;
+					Hit.V = V;
+					TMax = T;
+					bHit = true;
+					if (bAnyHit)
+						return true;
+				}
+				break;
+			}
+
+			// visit the nearest child first
+			float TLeft = 0.0f, TRight = 0.0f;
+			const bool bLeft  = IntersectBox(Mesh.Nodes[Node.LeftOrFirst    ], O, InvD, Ray.TMin, TMax, TLeft);
+			const bool bRight = IntersectBox(Mesh.Nodes[Node.LeftOrFirst + 1], O, InvD, Ray.TMin, TMax, TRight);
+			if (bLeft && bRight)
+			{
+				const bool bLeftFirst = TLeft <= TRight;
+				assert(StackSize < TRAVERSAL_STACK_SIZE);
+				Stack[StackSize++] = { Node.LeftOrFirst + (bLeftFirst ? 1 : 0), bLeftFirst ? TRight : TLeft };
+				iNode = Node.LeftOrFirst + (bLeftFirst ? 0 : 1);
+			}
+			else if (bLeft || bRight)
+			{
+				iNode = Node.LeftOrFirst + (bLeft ? 0 : 1);
+			}
+			else break;
+		}
+	}
+	return bHit;
+}
+
+template<bool bAnyHit>
+bool RayQueryAccelerationStructure::Trace(const FRay& Ray, FRayHit& Hit) const
+{
+	Hit = {};
+	if (mTopLevelNodes.empty())
+		return false;
+
+	const XMVECTOR O = XMLoadFloat3(&Ray.Origin);
+	const XMVECTOR D = XMLoadFloat3(&Ray.Direction);
+	const XMVECTOR InvD = CalculateSafeReciprocal(D);
+	bool bHit = false;
+
+	FTraversalEntry Stack[TRAVERSAL_STACK_SIZE];
+	uint32 StackSize = 0;
+	float TEntry = 0.0f;
+	if (!IntersectBox(mTopLevelNodes[0], O, InvD, Ray.TMin, std::min(Ray.TMax, Hit.T), TEntry))
+		return false;
+	Stack[StackSize++] = { 0, TEntry };
+	while (StackSize > 0)
+	{
+		const FTraversalEntry Entry = Stack[--StackSize];
+		if (Entry.TEntry > std::min(Ray.TMax, Hit.T))
+			continue;
+
+		uint32 iNode = Entry.iNode;
+		for (;;)
+		{
+			const FNode& Node = mTopLevelNodes[iNode];
+			const float TMax = std::min(Ray.TMax, Hit.T);
+			if (Node.Count > 0)
+			{
+				for (uint32 i = Node.LeftOrFirst; i < Node.LeftOrFirst + Node.Count; ++i)
+				{
+					// to mesh space, T is preserved as the direction isn't normalized
+					const uint32 iInstance = mTopLevelInstanceIndices[i];
+					const FInstance& Instance = mInstances[iInstance];
+					const XMMATRIX matWorldToMesh = XMLoadFloat4x4(&Instance.matWorldToMesh);
+					FRay MeshRay;
+					XMStoreFloat3(&MeshRay.Origin, XMVector3Transform(O, matWorldToMesh));
+					XMStoreFloat3(&MeshRay.Direction, XMVector3TransformNormal(D, matWorldToMesh));
+					MeshRay.TMin = Ray.TMin;
+					MeshRay.TMax = std::min(Ray.TMax, Hit.T);
+					if (TraceMesh<bAnyHit>(mMeshes[Instance.MeshIndex], MeshRay, Hit))
+					{
+						Hit.InstanceIndex = iInstance;
+						bHit = true;
+						if (bAnyHit)
+							return true;
+					}
+				}
+				break;
+			}
+
+			float TLeft = 0.0f, TRight = 0.0f;
+			const bool bLeft  = IntersectBox(mTopLevelNodes[Node.LeftOrFirst    ], O, InvD, Ray.TMin, TMax, TLeft);
+			const bool bRight = IntersectBox(mTopLevelNodes[Node.LeftOrFirst + 1], O, InvD, Ray.TMin, TMax, TRight);
+			if (bLeft && bRight)
+			{
+				const bool bLeftFirst = TLeft <= TRight;
+				assert(StackSize < TRAVERSAL_STACK_SIZE);
+				Stack[StackSize++] = { Node.LeftOrFirst + (bLeftFirst ? 1 : 0), bLeftFirst ? TRight : TLeft };
+				iNode = Node.LeftOrFirst + (bLeftFirst ? 0 : 1);
+			}
+			else if (bLeft || bRight)
+			{
+				iNode = Node.LeftOrFirst + (bLeft ? 0 : 1);
+			}
+			else break;
+		}
+	}
+	return bHit;
+}
+
+bool RayQueryAccelerationStructure::Intersect(const FRay& Ray, FRayHit& Hit) const
+{
+	return Trace<false>(Ray, Hit);
+}
+
+bool RayQueryAccelerationStructure::IsOccluded(const FRay& Ray) const
+{
+	FRayHit Hit;
+	return Trace<true>(Ray, Hit);
+}
+
+void RayQueryAccelerationStructure::IntersectBatch(const FRay* pRays, uint32 NumRays, FRayHit* pHits, ThreadPool* pWorkerThreadPool) const
+{
+	ParallelForRanges(NumRays, pWorkerThreadPool, [&](size_t iBegin, size_t iEnd)
+	{
+		for (size_t i = iBegin; i < iEnd; ++i)
+			Trace<false>(pRays[i], pHits[i]);
+	});
+}
+
+void RayQueryAccelerationStructure::IsOccludedBatch(const FRay* pRays, uint32 NumRays, bool* pOccluded, ThreadPool* pWorkerThreadPool) const
+{
+	ParallelForRanges(NumRays, pWorkerThreadPool, [&](size_t iBegin, size_t iEnd)
+	{
+		FRayHit Hit;
+		for (size_t i = iBegin; i < iEnd; ++i)
+			pOccluded[i] = Trace<true>(pRays[i], Hit);
+	});
+}
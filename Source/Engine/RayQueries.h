@@ -0,0 +1,149 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <DirectXMath.h>
+
+#include <cfloat>
+#include <vector>
+
+class ThreadPool;
+
+struct FRay
+{
+	DirectX::XMFLOAT3 Origin;
+	DirectX::XMFLOAT3 Direction; // doesn't need to be normalized, T is in units of its length
+	float             TMin = 0.0f;
+	float             TMax = FLT_MAX;
+
+	// T in [0, 1] along the segment, the end points are excluded by Epsilon
+	static FRay FromSegment(const DirectX::XMFLOAT3& From, const DirectX::XMFLOAT3& To, float Epsilon = 1e-4f);
+};
+
+struct FRayHit
+{
+	static constexpr uint32 INVALID_INDEX = 0xFFFFFFFF;
+
+	float  T             = FLT_MAX;
+	uint32 InstanceIndex = INVALID_INDEX; // into the instances of BuildTopLevel()
+	uint32 TriangleIndex = INVALID_INDEX; // primitive index in the index list of the mesh
+	float  U             = 0.0f;          // barycentrics of the 2nd & 3rd vertices of the triangle
+	float  V             = 0.0f;
+
+	inline bool IsHit() const { return InstanceIndex != INVALID_INDEX; }
+};
+
+struct FRayQueryInstance
+{
+	uint32              MeshIndex = 0; // returned by AddMesh()
+	DirectX::XMFLOAT4X4 matWorld;      // mesh local space -> world space
+};
+
+//
+// RAY QUERY ACCELERATION STRUCTURE
+//
+// Two-level BVH for ray & segment queries against triangle meshes on the CPU.
+//
+// - Bottom level: a BVH per mesh, built once w/ binned SAH. Leaves hold up to MAX_LEAF_TRIANGLES triangles
+//   stored as 4-wide SoA packets (first vertex & edges) that are intersected w/ one SIMD Moller-Trumbore test.
+// - Top level: a BVH over the world space boxes of the instances, rebuilt w/ BuildTopLevel() whenever the
+//   instances move. Rays are transformed into the mesh space of the instances they reach, T is preserved.
+// - Nodes are tested w/ the SIMD slab test, the children are visited near to far. Triangles are double sided.
+// - Intersect() returns the closest hit, IsOccluded() stops at the first one. The queries are thread safe
+//   between the builds and the batched versions split the rays over the worker threads.
+//
+class RayQueryAccelerationStructure
+{
+public:
+	static constexpr uint32 MAX_LEAF_TRIANGLES = 8;
+	static constexpr uint32 MAX_LEAF_INSTANCES = 2;
+
+	struct FStatistics
+	{
+		uint32 NumMeshes            = 0;
+		uint32 NumMeshTriangles     = 0; // sum over the meshes
+		uint32 NumMeshNodes         = 0;
+		uint32 NumInstances         = 0;
+		uint32 NumInstanceTriangles = 0; // sum over the instances
+		uint32 NumInstanceNodes     = 0;
+		size_t MemoryBytes          = 0;
+		float  MeshBuildTimeMs      = 0.0f; // sum over the meshes
+		float  TopLevelBuildTimeMs  = 0.0f; // last BuildTopLevel()
+	};
+
+public:
+	// Builds the bottom level BVH of an indexed triangle list, the positions are copied.
+	// Returns the mesh index for FRayQueryInstance::MeshIndex.
+	uint32 AddMesh(const float* pPositions, uint32 PositionStride, uint32 NumVertices, const uint32* pIndices, uint32 NumIndices);
+	void   BuildTopLevel(const FRayQueryInstance* pInstances, uint32 NumInstances);
+	void   Clear();
+
+	bool Intersect(const FRay& Ray, FRayHit& Hit) const; // closest hit, Hit is reset
+	bool IsOccluded(const FRay& Ray) const;              // any hit
+	void IntersectBatch(const FRay* pRays, uint32 NumRays, FRayHit* pHits, ThreadPool* pWorkerThreadPool = nullptr) const;
+	void IsOccludedBatch(const FRay* pRays, uint32 NumRays, bool* pOccluded, ThreadPool* pWorkerThreadPool = nullptr) const;
+
+	inline uint32             GetNumMeshes()    const { return static_cast<uint32>(mMeshes.size()); }
+	inline uint32             GetNumInstances() const { return static_cast<uint32>(mInstances.size()); }
+	inline const FStatistics& GetStatistics()   const { return mStats; }
+
+private:
+	struct alignas(16) FNode
+	{
+		DirectX::XMFLOAT3 Min;
+		uint32            LeftOrFirst; // interior: left child, the right one follows it. leaf: first packet / instance
+		DirectX::XMFLOAT3 Max;
+		uint32            Count;       // leaf: # packets / instances, 0 for interior nodes
+	};
+
+	struct alignas(16) FTrianglePacket // 4 triangles, lane i = triangle i, unused lanes are degenerate
+	{
+		DirectX::XMFLOAT4A V0[3]; // x, y, z
+		DirectX::XMFLOAT4A E1[3]; // V1 - V0
+		DirectX::XMFLOAT4A E2[3]; // V2 - V0
+		uint32             TriangleIndex[4];
+	};
+
+	struct FMesh
+	{
+		std::vector<FNode>           Nodes;
+		std::vector<FTrianglePacket> Packets;
+		uint32                       NumTriangles = 0;
+	};
+
+	struct FInstance
+	{
+		uint32              MeshIndex;
+		DirectX::XMFLOAT4X4 matWorldToMesh;
+	};
+
+	struct FBuildPrimitive;
+	static void BuildBVH(const std::vector<FBuildPrimitive>& Primitives, uint32 MaxLeafSize, uint32 LeafCostGranularity, std::vector<FNode>& OutNodes, std::vector<uint32>& OutOrder);
+
+	template<bool bAnyHit> bool TraceMesh(const FMesh& Mesh, const FRay& Ray, FRayHit& Hit) const;
+	template<bool bAnyHit> bool Trace(const FRay& Ray, FRayHit& Hit) const;
+
+private:
+	std::vector<FMesh>     mMeshes;
+	std::vector<FInstance> mInstances;
+	std::vector<FNode>     mTopLevelNodes;
+	std::vector<uint32>    mTopLevelInstanceIndices; // leaf order
+	FStatistics            mStats;
+};
@@ -0,0 +1,181 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Skinning.h"
+
+#include "../GPUMarker.h"
+
+constexpr UINT SKINNED_VERTEX_STRIDE = sizeof(FVertexWithNormalAndTangent);
+
+SkinningPass::SkinningPass(VQRenderer& Renderer)
+	: RenderPassBase(Renderer)
+{
+}
+
+bool SkinningPass::Initialize()
+{
+	LoadRootSignatures();
+
+	// read as a vertex buffer by the draws, written as a UAV only while skinning
+	TextureCreateDesc desc("SkinnedVertexBuffer");
+	desc.d3d12Desc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(MAX_SKINNED_VERTICES) * SKINNED_VERTEX_STRIDE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	desc.ResourceState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+	mSkinnedVertexBuffer = mRenderer.CreateTexture(desc);
+	mSkinnedVertexBufferAddress = mRenderer.GetTextureResource(mSkinnedVertexBuffer)->GetGPUVirtualAddress();
+	return true;
+}
+
+void SkinningPass::Destroy()
+{
+	if (mSkinnedVertexBuffer != INVALID_ID)
+		mRenderer.DestroyTexture(mSkinnedVertexBuffer);
+	mSkinnedVertexBufferAddress = 0;
+	DestroyRootSignatures();
+}
+
+void SkinningPass::OnCreateWindowSizeDependentResources(unsigned Width, unsigned Height, const IRenderPassResourceCollection* pRscParameters)
+{
+}
+
+void SkinningPass::OnDestroyWindowSizeDependentResources()
+{
+}
+
+void SkinningPass::RecordCommands(const IRenderPassDrawParameters* pDrawParameters)
+{
+	const FDrawParameters* pParams = static_cast<const FDrawParameters*>(pDrawParameters);
+
+	// shorthands
+	ID3D12GraphicsCommandList* pCmd = pParams->pCmd;
+	DynamicBufferHeap* pCBufferHeap = pParams->pCBufferHeap;
+	assert(pCmd);
+	assert(pCBufferHeap);
+	assert(pParams->pSkinningCommands && pParams->pSkinningPalettes);
+	const std::vector<FSkinningCommand>& SkinningCommands = *pParams->pSkinningCommands;
+	const std::vector<DirectX::XMFLOAT4X4>& Palettes = *pParams->pSkinningPalettes;
+	if (SkinningCommands.empty())
+		return;
+
+	// upload the palettes of all the animated objects once
+	DirectX::XMFLOAT4X4* pPaletteData = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS PaletteAddr = {};
+	pCBufferHeap->AllocStructuredBuffer(static_cast<uint32_t>(Palettes.size()), sizeof(DirectX::XMFLOAT4X4), (void**)&pPaletteData, &PaletteAddr);
+	memcpy(pPaletteData, Palettes.data(), Palettes.size() * sizeof(DirectX::XMFLOAT4X4));
+
+	ID3D12Resource* pRscSkinnedVertices = mRenderer.GetTextureResource(mSkinnedVertexBuffer);
+
+	SCOPED_GPU_MARKER(pCmd, "Skinning");
+	{
+		const CD3DX12_RESOURCE_BARRIER Barrier = CD3DX12_RESOURCE_BARRIER::Transition(pRscSkinnedVertices, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		pCmd->ResourceBarrier(1, &Barrier);
+	}
+
+	pCmd->SetPipelineState(mRenderer.GetPSO(mPSO));
+	pCmd->SetComputeRootSignature(mpRS);
+
+	// the commands write to disjoint ranges of the skinned vertex buffer: no UAV barriers in between
+	constexpr int DispatchGroupDimensionX = 64;
+	for (const FSkinningCommand& cmd : SkinningCommands)
+	{
+		assert(cmd.iFirstSkinnedVertex + cmd.NumVertices <= MAX_SKINNED_VERTICES);
+		pCmd->SetComputeRootShaderResourceView(0, mRenderer.GetVertexBufferView(cmd.VertexBufferID).BufferLocation);
+		pCmd->SetComputeRootShaderResourceView(1, mRenderer.GetVertexBufferView(cmd.SkinWeightsBufferID).BufferLocation);
+		pCmd->SetComputeRootShaderResourceView(2, PaletteAddr + cmd.iFirstPaletteMatrix * sizeof(DirectX::XMFLOAT4X4));
+		pCmd->SetComputeRootUnorderedAccessView(3, mSkinnedVertexBufferAddress + static_cast<UINT64>(cmd.iFirstSkinnedVertex) * SKINNED_VERTEX_STRIDE);
+		pCmd->SetComputeRoot32BitConstant(4, cmd.NumVertices, 0);
+		pCmd->Dispatch(DIV_AND_ROUND_UP(cmd.NumVertices, DispatchGroupDimensionX), 1, 1);
+	}
+
+	{
+		const CD3DX12_RESOURCE_BARRIER Barrier = CD3DX12_RESOURCE_BARRIER::Transition(pRscSkinnedVertices, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		pCmd->ResourceBarrier(1, &Barrier);
+	}
+}
+
+VBV SkinningPass::GetVertexBufferView(const VBV& MeshVBV, int iFirstSkinnedVertex) const
+{
+	if (iFirstSkinnedVertex == INVALID_ID)
+		return MeshVBV;
+	assert(MeshVBV.StrideInBytes == SKINNED_VERTEX_STRIDE);
+	VBV vbv = {};
+	vbv.BufferLocation = mSkinnedVertexBufferAddress + static_cast<UINT64>(iFirstSkinnedVertex) * SKINNED_VERTEX_STRIDE;
+	vbv.SizeInBytes    = MeshVBV.SizeInBytes;
+	vbv.StrideInBytes  = SKINNED_VERTEX_STRIDE;
+	return vbv;
+}
+
+std::vector<FPSOCreationTaskParameters> SkinningPass::CollectPSOCreationParameters()
+{
+	FPSOCreationTaskParameters param = {};
+	param.pID = &mPSO;
+
+	FShaderStageCompileDesc shaderDesc = {};
+	shaderDesc.EntryPoint = "CSMain";
+	shaderDesc.FilePath = VQRenderer::GetFullPathOfShader("Skinning.hlsl");
+	shaderDesc.ShaderModel = "cs_5_0";
+
+	FPSODesc& psoDesc = param.Desc;
+	psoDesc.PSOName = "SkinningCS";
+	psoDesc.ShaderStageCompileDescs = { shaderDesc };
+	D3D12_COMPUTE_PIPELINE_STATE_DESC& desc = psoDesc.D3D12ComputeDesc;
+	desc.pRootSignature = mpRS;
+	desc.NodeMask = 0;
+	desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+
+	return { param };
+}
+
+void SkinningPass::LoadRootSignatures()
+{
+	ID3D12Device* pDevice = mRenderer.GetDevicePtr();
+
+	//==============================RootSignature============================================
+	{
+		// root views: the buffers are bound at the offsets of each skinning command
+		CD3DX12_ROOT_PARAMETER RTSlot[5] = {};
+		RTSlot[0].InitAsShaderResourceView(0); // bind pose vertices
+		RTSlot[1].InitAsShaderResourceView(1); // skin weights
+		RTSlot[2].InitAsShaderResourceView(2); // palette
+		RTSlot[3].InitAsUnorderedAccessView(0); // skinned vertices
+		RTSlot[4].InitAsConstants(1, 0);        // NumVertices
+
+		CD3DX12_ROOT_SIGNATURE_DESC descRootSignature = CD3DX12_ROOT_SIGNATURE_DESC();
+		descRootSignature.NumParameters = _countof(RTSlot);
+		descRootSignature.pParameters = RTSlot;
+		descRootSignature.NumStaticSamplers = 0;
+		descRootSignature.pStaticSamplers = nullptr;
+		descRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+		ID3DBlob* pOutBlob = nullptr;
+		ID3DBlob* pErrorBlob = nullptr;
+		HRESULT hr = D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &pOutBlob, &pErrorBlob);
+		ThrowIfFailed(
+			pDevice->CreateRootSignature(0, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(), IID_PPV_ARGS(&mpRS))
+		);
+		SetName(mpRS, "Skinning");
+
+		pOutBlob->Release();
+		if (pErrorBlob)
+			pErrorBlob->Release();
+	}
+}
+
+void SkinningPass::DestroyRootSignatures()
+{
+	if (mpRS) mpRS->Release();
+}
@@ -0,0 +1,61 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "RenderPass.h"
+#include "../Core/RenderCommands.h"
+
+// Skins the animated meshes into a vertex buffer w/ a compute shader before the depth prepass,
+// draws of the skinned meshes then bind their range of the skinned vertex buffer instead of the bind pose.
+class SkinningPass : public RenderPassBase
+{
+public:
+	struct FResourceCollection : public IRenderPassResourceCollection {};
+	struct FDrawParameters : public IRenderPassDrawParameters
+	{
+		ID3D12GraphicsCommandList* pCmd = nullptr;
+		DynamicBufferHeap* pCBufferHeap = nullptr;
+		const std::vector<FSkinningCommand>*   pSkinningCommands = nullptr;
+		const std::vector<DirectX::XMFLOAT4X4>* pSkinningPalettes = nullptr;
+	};
+
+	SkinningPass(VQRenderer& Renderer);
+	SkinningPass() = delete;
+	virtual ~SkinningPass() override {}
+
+	virtual bool Initialize() override;
+	virtual void Destroy() override;
+	virtual void OnCreateWindowSizeDependentResources(unsigned Width, unsigned Height, const IRenderPassResourceCollection* pRscParameters = nullptr) override;
+	virtual void OnDestroyWindowSizeDependentResources() override;
+	virtual void RecordCommands(const IRenderPassDrawParameters* pDrawParameters = nullptr) override;
+
+	virtual std::vector<FPSOCreationTaskParameters> CollectPSOCreationParameters() override;
+
+	// returns MeshVBV if the mesh isn't skinned (iFirstSkinnedVertex == INVALID_ID)
+	VBV GetVertexBufferView(const VBV& MeshVBV, int iFirstSkinnedVertex) const;
+
+private:
+	void LoadRootSignatures();
+	void DestroyRootSignatures();
+
+private:
+	PSO_ID mPSO = INVALID_ID;
+	ID3D12RootSignature* mpRS = nullptr;
+	TextureID mSkinnedVertexBuffer = INVALID_ID; // MAX_SKINNED_VERTICES x FVertexWithNormalAndTangent
+	D3D12_GPU_VIRTUAL_ADDRESS mSkinnedVertexBufferAddress = 0;
+};
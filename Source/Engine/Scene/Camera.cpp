@@ -171,6 +171,37 @@ void Camera::Rotate(float yaw, float pitch)
 	if (mYaw < (-XM_PI*2.0f)) mYaw += (XM_PI * 2.0f);
 }
 
+FCameraTrackKey Camera::GetTrackKey(float Time) const
+{
+	FCameraTrackKey Key = {};
+	Key.Time        = Time;
+	Key.Position    = mPosition;
+	Key.FieldOfView = mProjParams.FieldOfView;
+	Key.NearZ       = mProjParams.NearZ;
+	Key.FarZ        = mProjParams.FarZ;
+	XMStoreFloat4(&Key.Rotation, XMQuaternionRotationRollPitchYaw(mPitch, mYaw, 0.0f));
+	return Key;
+}
+
+void Camera::ApplyTrackKey(const FCameraTrackKey& Key)
+{
+	// the camera has no roll: recover yaw & pitch from the forward vector of the rotation
+	const XMVECTOR Q = XMLoadFloat4(&Key.Rotation);
+	XMFLOAT3 f3Forward;
+	XMStoreFloat3(&f3Forward, XMVector3Rotate(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), Q));
+
+	mPosition = Key.Position;
+	mYaw   = std::atan2(f3Forward.x, f3Forward.z);
+	const float SinPitch = -f3Forward.y;
+	mPitch = std::asin(SinPitch > 1.0f ? 1.0f : (SinPitch < -1.0f ? -1.0f : SinPitch));
+
+	mProjParams.FieldOfView = Key.FieldOfView;
+	mProjParams.NearZ       = Key.NearZ;
+	mProjParams.FarZ        = Key.FarZ;
+	SetProjectionMatrix(mProjParams);
+	UpdateViewMatrix();
+}
+
 void Camera::LookAt(const XMVECTOR& target)
 {
 	// figure out target direction we want to look at
@@ -21,6 +21,7 @@
 #include <DirectXMath.h>
 
 #include "../Math.h"
+#include "CameraTrack.h"
 
 #include <array>
 #include <memory>
@@ -154,6 +155,10 @@ public:
 	       void LookAt(const DirectX::XMVECTOR& point);
 	inline void LookAt(const DirectX::XMFLOAT3& point) { DirectX::XMVECTOR p = XMLoadFloat3(&point); LookAt(p); }
 
+	// camera track recording/playback: ApplyTrackKey() overrides the controllers and updates the matrices
+	FCameraTrackKey GetTrackKey(float Time) const;
+	void            ApplyTrackKey(const FCameraTrackKey& Key);
+
 private:
 	//--------------------------
 	DirectX::XMFLOAT3 mPosition;
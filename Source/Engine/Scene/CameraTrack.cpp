@@ -0,0 +1,146 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "CameraTrack.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+using namespace DirectX;
+
+void CameraTrack::AddKey(const FCameraTrackKey& Key)
+{
+	assert(mKeys.empty() || Key.Time >= mKeys.back().Time);
+	if (!mKeys.empty() && Key.Time == mKeys.back().Time)
+	{
+		mKeys.back() = Key; // same timestamp: keep the latest
+		return;
+	}
+	mKeys.push_back(Key);
+}
+
+FCameraTrackKey CameraTrack::Sample(float Time) const
+{
+	assert(!mKeys.empty());
+	const size_t NumKeys = mKeys.size();
+	if (NumKeys == 1 || Time <= mKeys.front().Time) return mKeys.front();
+	if (Time >= mKeys.back().Time)                  return mKeys.back();
+
+	// find the segment [i1, i2] containing @Time, i0 & i3 are the neighbor keys clamped to the track
+	const auto itUpper = std::upper_bound(mKeys.begin(), mKeys.end(), Time, [](float t, const FCameraTrackKey& k) { return t < k.Time; });
+	const size_t i2 = static_cast<size_t>(itUpper - mKeys.begin());
+	const size_t i1 = i2 - 1;
+	const size_t i0 = i1 > 0 ? i1 - 1 : i1;
+	const size_t i3 = std::min(i2 + 1, NumKeys - 1);
+
+	const FCameraTrackKey& k0 = mKeys[i0];
+	const FCameraTrackKey& k1 = mKeys[i1];
+	const FCameraTrackKey& k2 = mKeys[i2];
+	const FCameraTrackKey& k3 = mKeys[i3];
+	const float t = (Time - k1.Time) / (k2.Time - k1.Time);
+
+	FCameraTrackKey Key = {};
+	Key.Time = Time;
+
+	// position: Catmull-Rom
+	const XMVECTOR P = XMVectorCatmullRom(XMLoadFloat3(&k0.Position), XMLoadFloat3(&k1.Position), XMLoadFloat3(&k2.Position), XMLoadFloat3(&k3.Position), t);
+	XMStoreFloat3(&Key.Position, P);
+
+	// rotation: squad
+	const XMVECTOR Q1 = XMLoadFloat4(&k1.Rotation);
+	XMVECTOR A, B, C; // C is Q2 in the hemisphere of Q1
+	XMQuaternionSquadSetup(&A, &B, &C, XMLoadFloat4(&k0.Rotation), Q1, XMLoadFloat4(&k2.Rotation), XMLoadFloat4(&k3.Rotation));
+	XMStoreFloat4(&Key.Rotation, XMQuaternionNormalize(XMQuaternionSquad(Q1, A, B, C, t)));
+
+	// projection
+	Key.FieldOfView = k1.FieldOfView + (k2.FieldOfView - k1.FieldOfView) * t;
+	Key.NearZ       = k1.NearZ       + (k2.NearZ       - k1.NearZ      ) * t;
+	Key.FarZ        = k1.FarZ        + (k2.FarZ        - k1.FarZ       ) * t;
+	return Key;
+}
+
+bool CameraTrack::Save(const std::string& FilePath) const
+{
+	std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("CameraTrack: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+
+	const FHeader Header = { MAGIC, VERSION, static_cast<unsigned>(mKeys.size()), static_cast<unsigned>(sizeof(FCameraTrackKey)) };
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(mKeys.data()), sizeof(FCameraTrackKey) * mKeys.size());
+	return file.good();
+}
+
+bool CameraTrack::Load(const std::string& FilePath)
+{
+	std::ifstream file(FilePath, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::Error("CameraTrack: couldn't open %s", FilePath.c_str());
+		return false;
+	}
+
+	FHeader Header = {};
+	file.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+	if (!file.good() || Header.Magic != MAGIC || Header.Version != VERSION || Header.KeySize != sizeof(FCameraTrackKey))
+	{
+		Log::Error("CameraTrack: %s is not a valid camera track file", FilePath.c_str());
+		return false;
+	}
+
+	// don't trust NumKeys before allocating: the keys have to fit in the rest of the file
+	const std::streamoff KeysBegin = file.tellg();
+	file.seekg(0, std::ios::end);
+	const std::streamoff FileSize = file.tellg();
+	file.seekg(KeysBegin, std::ios::beg);
+	const uint64_t KeysSize = static_cast<uint64_t>(Header.NumKeys) * sizeof(FCameraTrackKey);
+	if (KeysBegin < 0 || FileSize < KeysBegin || KeysSize > static_cast<uint64_t>(FileSize - KeysBegin))
+	{
+		Log::Error("CameraTrack: %s is truncated or corrupt: %u keys don't fit in %lld bytes", FilePath.c_str(), Header.NumKeys, static_cast<long long>(FileSize));
+		return false;
+	}
+
+	std::vector<FCameraTrackKey> Keys(Header.NumKeys);
+	file.read(reinterpret_cast<char*>(Keys.data()), KeysSize);
+	if (!file.good())
+	{
+		Log::Error("CameraTrack: %s is truncated", FilePath.c_str());
+		return false;
+	}
+
+	// Sample() relies on finite, increasing key times
+	for (size_t i = 0; i < Keys.size(); ++i)
+	{
+		if (!std::isfinite(Keys[i].Time) || (i > 0 && Keys[i].Time < Keys[i - 1].Time))
+		{
+			Log::Error("CameraTrack: %s is corrupt: key %d has an invalid time", FilePath.c_str(), static_cast<int>(i));
+			return false;
+		}
+	}
+
+	mKeys = std::move(Keys);
+	return true;
+}
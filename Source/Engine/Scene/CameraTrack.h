@@ -0,0 +1,75 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <string>
+#include <vector>
+
+//
+// CAMERA TRACK
+//
+// Timestamped camera keyframes that can be recorded, saved/loaded and sampled at arbitrary times.
+// Positions are interpolated w/ Catmull-Rom splines, rotations w/ quaternion squad and the projection
+// parameters linearly. Sampling only depends on the keyframes and the sample time: sampling a track
+// at the same times produces bit-identical results.
+//
+struct FCameraTrackKey
+{
+	float             Time;        // seconds
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT4 Rotation;    // quaternion
+	float             FieldOfView; // radians
+	float             NearZ;
+	float             FarZ;
+};
+
+class CameraTrack
+{
+public:
+	// Appends a key, keys have to be added in increasing time order
+	void AddKey(const FCameraTrackKey& Key);
+	inline void Clear() { mKeys.clear(); }
+
+	FCameraTrackKey Sample(float Time) const; // @Time is clamped to the track duration
+
+	inline bool   IsEmpty()       const { return mKeys.empty(); }
+	inline size_t GetNumKeys()    const { return mKeys.size(); }
+	inline float  GetStartTime()  const { return mKeys.empty() ? 0.0f : mKeys.front().Time; }
+	inline float  GetEndTime()    const { return mKeys.empty() ? 0.0f : mKeys.back().Time; }
+	inline float  GetDuration()   const { return GetEndTime() - GetStartTime(); }
+	inline const std::vector<FCameraTrackKey>& GetKeys() const { return mKeys; }
+
+	// Binary file: [FHeader][FCameraTrackKey x NumKeys]
+	bool Save(const std::string& FilePath) const;
+	bool Load(const std::string& FilePath);
+
+private:
+	static constexpr unsigned MAGIC   = 0x54435156; // "VQCT"
+	static constexpr unsigned VERSION = 1;
+	struct FHeader
+	{
+		unsigned Magic;
+		unsigned Version;
+		unsigned NumKeys;
+		unsigned KeySize;
+	};
+
+	std::vector<FCameraTrackKey> mKeys;
+};
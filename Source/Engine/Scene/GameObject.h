@@ -27,4 +27,5 @@ public:
 	TransformID  mTransformID = INVALID_ID;
 	ModelID      mModelID     = INVALID_ID;
 	FBoundingBox mLocalSpaceBoundingBox;
+	bool         mbOccluder   = false; // always considered for software occlusion culling
 };
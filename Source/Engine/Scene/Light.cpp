@@ -63,6 +63,7 @@ Light::Light()
 	, bEnabled(true)
 	, bCastingShadows(false)
 	, Mobility(EMobility::DYNAMIC)
+	, Type(EType::POINT)
 	, Color(XMFLOAT3(1,1,1))
 	, Brightness(300.0f)
 	, ShadowData(FShadowData(0.00005f, 0.01f, 1500.0f))
@@ -116,6 +117,7 @@ void Light::GetGPUData(VQ_SHADER_DATA::SpotLight* pLight) const
 
 	XMStoreFloat3(&pLight->spotDir, FWD);
 	pLight->position = this->Position;
+	pLight->range = this->Range;
 	pLight->innerConeAngle = this->SpotInnerConeAngleDegrees * DEG2RAD;
 	pLight->outerConeAngle = this->SpotOuterConeAngleDegrees * DEG2RAD;
 }
@@ -0,0 +1,400 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "LightContainer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+static LightContainer::FColdData MakeColdData(const Light& l)
+{
+	return LightContainer::FColdData
+	{
+		  l.RotationQuaternion
+		, l.RenderScale
+		, l.Color
+		, l.Brightness
+		, l.ShadowData
+		, { l.ViewportX, l.ViewportY, l.DistanceFromOrigin } // aliases the other types' fields through the union
+	};
+}
+
+//-------------------------------------------------------------------------------
+//
+// ADD / REMOVE
+//
+//-------------------------------------------------------------------------------
+LightHandle LightContainer::Add(const Light& l)
+{
+	const uint32 iLight = GetNumLights();
+
+	uint32 iSlot = 0;
+	if (!mFreeSlots.empty())
+	{
+		iSlot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		iSlot = static_cast<uint32>(mSlotToDense.size());
+		mSlotToDense.push_back(LightHandle::INVALID_INDEX);
+		mSlotGenerations.push_back(0);
+	}
+	mSlotToDense[iSlot] = iLight;
+	mDenseToSlot.push_back(iSlot);
+
+	ForEachHotArray([](auto& v) { v.emplace_back(); });
+	mColdData.push_back(MakeColdData(l));
+	WriteLight(iLight, l);
+
+	return { iSlot, mSlotGenerations[iSlot] };
+}
+
+void LightContainer::Add(const std::vector<Light>& Lights, std::vector<LightHandle>* pOutHandles)
+{
+	const size_t NumLights = GetNumLights() + Lights.size();
+	ForEachHotArray([NumLights](auto& v) { v.reserve(NumLights); });
+	mColdData.reserve(NumLights);
+	mDenseToSlot.reserve(NumLights);
+	if (pOutHandles)
+		pOutHandles->reserve(pOutHandles->size() + Lights.size());
+
+	for (const Light& l : Lights)
+	{
+		const LightHandle hLight = Add(l);
+		if (pOutHandles)
+			pOutHandles->push_back(hLight);
+	}
+}
+
+void LightContainer::Remove(LightHandle hLight)
+{
+	if (!IsValid(hLight))
+	{
+		assert(false); // stale or invalid handle
+		return;
+	}
+	RemoveAt(mSlotToDense[hLight.Index]);
+}
+
+void LightContainer::Remove(const std::vector<LightHandle>& hLights)
+{
+	std::vector<uint32> LightIndices;
+	LightIndices.reserve(hLights.size());
+	for (const LightHandle& hLight : hLights)
+	{
+		assert(IsValid(hLight));
+		if (IsValid(hLight))
+			LightIndices.push_back(mSlotToDense[hLight.Index]);
+	}
+
+	// removing from the back keeps the pending indices valid: the light swapped into a hole is never one of them
+	std::sort(LightIndices.begin(), LightIndices.end(), std::greater<uint32>());
+	LightIndices.erase(std::unique(LightIndices.begin(), LightIndices.end()), LightIndices.end());
+	for (uint32 iLight : LightIndices)
+		RemoveAt(iLight);
+}
+
+void LightContainer::RemoveAt(uint32 iLight)
+{
+	assert(iLight < GetNumLights());
+	const uint32 iSlot = mDenseToSlot[iLight];
+
+	ForEachHotArray([iLight](auto& v) { SwapRemove(v, iLight); });
+	SwapRemove(mColdData, iLight);
+	SwapRemove(mDenseToSlot, iLight);
+	if (iLight < GetNumLights())
+		mSlotToDense[mDenseToSlot[iLight]] = iLight;
+
+	mSlotToDense[iSlot] = LightHandle::INVALID_INDEX;
+	++mSlotGenerations[iSlot];
+	mFreeSlots.push_back(iSlot);
+}
+
+void LightContainer::Clear()
+{
+	ForEachHotArray([](auto& v) { v.clear(); });
+	mColdData.clear();
+	mDenseToSlot.clear();
+
+	// invalidate the outstanding handles
+	mFreeSlots.clear();
+	for (uint32 iSlot = 0; iSlot < static_cast<uint32>(mSlotToDense.size()); ++iSlot)
+	{
+		if (mSlotToDense[iSlot] != LightHandle::INVALID_INDEX)
+			++mSlotGenerations[iSlot];
+		mSlotToDense[iSlot] = LightHandle::INVALID_INDEX;
+		mFreeSlots.push_back(iSlot);
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// ACCESS
+//
+//-------------------------------------------------------------------------------
+bool LightContainer::IsValid(LightHandle hLight) const
+{
+	return hLight.Index < mSlotToDense.size()
+		&& mSlotToDense[hLight.Index] != LightHandle::INVALID_INDEX
+		&& mSlotGenerations[hLight.Index] == hLight.Generation;
+}
+
+Light LightContainer::GetLight(LightHandle hLight) const
+{
+	assert(IsValid(hLight));
+	return GetLightAt(mSlotToDense[hLight.Index]);
+}
+
+Light LightContainer::GetLightAt(uint32 iLight) const
+{
+	assert(iLight < GetNumLights());
+	const FHotData&  h = mHotData;
+	const FColdData& c = mColdData[iLight];
+
+	Light l;
+	l.Position           = XMFLOAT3(h.PositionX[iLight], h.PositionY[iLight], h.PositionZ[iLight]);
+	l.Range              = h.Range[iLight];
+	l.bEnabled           = (h.Flags[iLight] & ENABLED) != 0;
+	l.bCastingShadows    = (h.Flags[iLight] & CASTING_SHADOWS) != 0;
+	l.Type               = static_cast<Light::EType>(h.Type[iLight]);
+	l.Mobility           = static_cast<Light::EMobility>(h.Mobility[iLight]);
+	l.RotationQuaternion = c.Rotation;
+	l.RenderScale        = c.RenderScale;
+	l.Color              = c.Color;
+	l.Brightness         = c.Brightness;
+	l.ShadowData         = c.ShadowData;
+	l.ViewportX          = c.TypeData[0];
+	l.ViewportY          = c.TypeData[1];
+	l.DistanceFromOrigin = c.TypeData[2];
+	return l;
+}
+
+void LightContainer::SetLight(LightHandle hLight, const Light& l)
+{
+	assert(IsValid(hLight));
+	if (IsValid(hLight))
+		WriteLight(mSlotToDense[hLight.Index], l);
+}
+
+void LightContainer::SetEnabled(LightHandle hLight, bool bEnabled)
+{
+	assert(IsValid(hLight));
+	if (!IsValid(hLight))
+		return;
+	uint8& Flags = mHotData.Flags[mSlotToDense[hLight.Index]];
+	Flags = bEnabled ? (Flags | ENABLED) : (Flags & ~ENABLED);
+}
+
+void LightContainer::WriteLight(uint32 iLight, const Light& l)
+{
+	FHotData& h = mHotData;
+	h.PositionX[iLight] = l.Position.x;
+	h.PositionY[iLight] = l.Position.y;
+	h.PositionZ[iLight] = l.Position.z;
+	h.Range[iLight]     = l.Range;
+
+	// default orientations: spot lights look forward, directional lights look down
+	XMVECTOR vDirection = XMVectorZero();
+	if (l.Type == Light::EType::SPOT)        vDirection = XMVector3Normalize(l.RotationQuaternion.TransformVector(XMVectorSet(0.0f,  0.0f, 1.0f, 0.0f)));
+	if (l.Type == Light::EType::DIRECTIONAL) vDirection = XMVector3Normalize(l.RotationQuaternion.TransformVector(XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f)));
+	XMFLOAT3 Direction;
+	XMStoreFloat3(&Direction, vDirection);
+	h.DirectionX[iLight] = Direction.x;
+	h.DirectionY[iLight] = Direction.y;
+	h.DirectionZ[iLight] = Direction.z;
+
+	const float OuterConeAngle = l.Type == Light::EType::SPOT ? l.SpotOuterConeAngleDegrees * DEG2RAD : 0.0f;
+	h.CosOuterConeAngle[iLight] = std::cos(OuterConeAngle);
+	h.SinOuterConeAngle[iLight] = std::sin(OuterConeAngle);
+
+	// bounding sphere
+	XMFLOAT3 BoundsCenter = l.Position;
+	float    BoundsRadius = l.Range;
+	switch (l.Type)
+	{
+	case Light::EType::DIRECTIONAL:
+		BoundsRadius = -1.0f;
+		break;
+	case Light::EType::SPOT:
+		if (OuterConeAngle < XM_PIDIV2) // tightest sphere around the cone, keep the range sphere for wider cones
+		{
+			const float Offset = OuterConeAngle > XM_PIDIV4 ? l.Range * h.CosOuterConeAngle[iLight] : l.Range / (2.0f * h.CosOuterConeAngle[iLight]);
+			BoundsRadius       = OuterConeAngle > XM_PIDIV4 ? l.Range * h.SinOuterConeAngle[iLight] : Offset;
+			XMStoreFloat3(&BoundsCenter, XMVectorAdd(XMLoadFloat3(&l.Position), XMVectorScale(vDirection, Offset)));
+		}
+		break;
+	default:
+		break;
+	}
+	h.BoundsX[iLight]      = BoundsCenter.x;
+	h.BoundsY[iLight]      = BoundsCenter.y;
+	h.BoundsZ[iLight]      = BoundsCenter.z;
+	h.BoundsRadius[iLight] = BoundsRadius;
+
+	h.Flags[iLight]    = (l.bEnabled ? ENABLED : 0) | (l.bCastingShadows ? CASTING_SHADOWS : 0);
+	h.Type[iLight]     = static_cast<uint8>(l.Type);
+	h.Mobility[iLight] = static_cast<uint8>(l.Mobility);
+
+	mColdData[iLight] = MakeColdData(l);
+}
+
+//-------------------------------------------------------------------------------
+//
+// CULLING
+//
+//-------------------------------------------------------------------------------
+void LightContainer::GatherVisibleLights(const FFrustumPlaneset& FrustumPlanesInWorldSpace, uint8 RequiredFlags, std::vector<uint32>& OutLightIndices) const
+{
+	// the plane normals aren't normalized: a sphere is outside if dot(N, C) + d < -r * |N|
+	__m128 PlaneA[6], PlaneB[6], PlaneC[6], PlaneD[6], PlaneNormalLength[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& abcd = FrustumPlanesInWorldSpace.abcd[p];
+		PlaneA[p] = _mm_set1_ps(abcd.x);
+		PlaneB[p] = _mm_set1_ps(abcd.y);
+		PlaneC[p] = _mm_set1_ps(abcd.z);
+		PlaneD[p] = _mm_set1_ps(abcd.w);
+		PlaneNormalLength[p] = _mm_set1_ps(std::sqrt(abcd.x * abcd.x + abcd.y * abcd.y + abcd.z * abcd.z));
+	}
+
+	const FHotData& h = mHotData;
+	const uint32 NumLights = GetNumLights();
+	const __m128 Zero = _mm_setzero_ps();
+	for (uint32 i = 0; i < NumLights; i += 4)
+	{
+		const uint32 NumLanes = std::min(NumLights - i, 4u);
+
+		// the tail is copied out so the loads never read past the arrays
+		alignas(16) float X[4] = {}, Y[4] = {}, Z[4] = {}, R[4] = {};
+		for (uint32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			X[Lane] = h.BoundsX[i + Lane];
+			Y[Lane] = h.BoundsY[i + Lane];
+			Z[Lane] = h.BoundsZ[i + Lane];
+			R[Lane] = h.BoundsRadius[i + Lane];
+		}
+		const __m128 CX = _mm_load_ps(X);
+		const __m128 CY = _mm_load_ps(Y);
+		const __m128 CZ = _mm_load_ps(Z);
+		const __m128 Radius = _mm_load_ps(R);
+
+		__m128 bVisible = _mm_cmplt_ps(Radius, Zero); // unbounded
+		__m128 bInside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p)
+		{
+			const __m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PlaneA[p], CX), _mm_mul_ps(PlaneB[p], CY)), _mm_add_ps(_mm_mul_ps(PlaneC[p], CZ), PlaneD[p]));
+			bInside = _mm_and_ps(bInside, _mm_cmpge_ps(Dist, _mm_sub_ps(Zero, _mm_mul_ps(Radius, PlaneNormalLength[p]))));
+		}
+		bVisible = _mm_or_ps(bVisible, bInside);
+
+		const int Mask = _mm_movemask_ps(bVisible);
+		for (uint32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			if ((Mask & (1 << Lane)) && (h.Flags[i + Lane] & RequiredFlags) == RequiredFlags)
+				OutLightIndices.push_back(i + Lane);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------
+//
+// GPU EXPORT
+//
+//-------------------------------------------------------------------------------
+void LightContainer::ExportGPUData(
+	  VQ_SHADER_DATA::SceneLighting& OutData
+	, std::vector<VQ_SHADER_DATA::PointLight>& OutPointLights
+	, std::vector<VQ_SHADER_DATA::SpotLight>&  OutSpotLights
+) const
+{
+	const FHotData& h = mHotData;
+	OutPointLights.clear();
+	OutSpotLights.clear();
+	OutData.directional = {};
+
+	int iPointCaster = 0;
+	int iSpotCaster = 0;
+	for (uint32 i = 0; i < GetNumLights(); ++i)
+	{
+		if (!(h.Flags[i] & ENABLED))
+			continue;
+
+		const FColdData& c = mColdData[i];
+		const XMFLOAT3 Position (h.PositionX[i] , h.PositionY[i] , h.PositionZ[i]);
+		const XMFLOAT3 Direction(h.DirectionX[i], h.DirectionY[i], h.DirectionZ[i]);
+		const bool bCastingShadows = (h.Flags[i] & CASTING_SHADOWS) != 0;
+
+		switch (h.Type[i])
+		{
+		case Light::EType::DIRECTIONAL:
+		{
+			VQ_SHADER_DATA::DirectionalLight& l = OutData.directional;
+			l.lightDirection = Direction;
+			l.brightness     = c.Brightness;
+			l.color          = c.Color;
+			l.depthBias      = c.ShadowData.DepthBias;
+			l.shadowing      = bCastingShadows;
+			l.enabled        = 1;
+			l.numCascades    = 0; // shadow cascades are fit to the main view, see Scene::FitDirectionalShadowCascades()
+		} break;
+
+		case Light::EType::SPOT:
+		{
+			// shadow casters over the shadow map budget still contribute as non-shadowing lights
+			const bool bShadowMapped = bCastingShadows && iSpotCaster < NUM_SHADOWING_LIGHTS__SPOT;
+			if (bShadowMapped)
+				OutData.shadowViews[iSpotCaster] = GetLightAt(i).GetViewProjectionMatrix();
+
+			VQ_SHADER_DATA::SpotLight& l = bShadowMapped ? OutData.spot_casters[iSpotCaster++] : OutSpotLights.emplace_back();
+			l.position       = Position;
+			l.outerConeAngle = c.TypeData[0] * DEG2RAD; // SpotOuterConeAngleDegrees
+			l.color          = c.Color;
+			l.brightness     = c.Brightness;
+			l.spotDir        = Direction;
+			l.depthBias      = c.ShadowData.DepthBias;
+			l.innerConeAngle = c.TypeData[1] * DEG2RAD; // SpotInnerConeAngleDegrees
+			l.range          = h.Range[i];
+		} break;
+
+		case Light::EType::POINT:
+		{
+			const bool bShadowMapped = bCastingShadows && iPointCaster < NUM_SHADOWING_LIGHTS__POINT;
+			VQ_SHADER_DATA::PointLight& l = bShadowMapped ? OutData.point_casters[iPointCaster++] : OutPointLights.emplace_back();
+			l.position   = Position;
+			l.range      = h.Range[i];
+			l.color      = c.Color;
+			l.brightness = c.Brightness;
+			l.depthBias  = c.ShadowData.DepthBias;
+		} break;
+
+		default:
+			break;
+		}
+	}
+
+	OutData.numPointCasters = iPointCaster;
+	OutData.numSpotCasters  = iSpotCaster;
+	OutData.numPointLights  = static_cast<int>(OutPointLights.size());
+	OutData.numSpotLights   = static_cast<int>(OutSpotLights.size());
+}
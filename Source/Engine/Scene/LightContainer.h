@@ -0,0 +1,133 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Light.h"
+#include "../Culling.h"
+#include "../Core/Types.h"
+
+#include <vector>
+
+// Typed handle into a LightContainer, stays valid until the light is removed.
+// Index addresses the container's slot table, Generation detects stale handles.
+struct LightHandle
+{
+	static constexpr uint32 INVALID_INDEX = 0xFFFFFFFF;
+	uint32 Index      = INVALID_INDEX;
+	uint32 Generation = 0;
+
+	inline bool IsValid() const { return Index != INVALID_INDEX; }
+	inline bool operator==(const LightHandle& h) const { return Index == h.Index && Generation == h.Generation; }
+	inline bool operator!=(const LightHandle& h) const { return !(*this == h); }
+};
+
+//
+// LIGHT CONTAINER
+//
+// Stores all the lights of a scene split into hot and cold data:
+//
+// - Hot data is what culling, binning and GPU packing iterate over every frame: position, range,
+//   direction, cone and the bounding sphere in structure-of-arrays form, plus the type/mobility/flag bytes.
+// - Cold data is the authoring data that's only needed for the GPU export and the shadow matrices:
+//   rotation, color, brightness, shadow parameters and the type specific fields.
+//
+// Both are densely packed: removal swaps the last light into the hole, so dense indices
+// aren't stable across Remove() calls, handles are.
+//
+class LightContainer
+{
+public:
+	enum EFlags : uint8
+	{
+		ENABLED         = 1 << 0,
+		CASTING_SHADOWS = 1 << 1,
+	};
+
+	struct FHotData
+	{
+		std::vector<float> PositionX, PositionY, PositionZ, Range;
+		std::vector<float> DirectionX, DirectionY, DirectionZ;           // spot & directional lights
+		std::vector<float> CosOuterConeAngle, SinOuterConeAngle;         // spot lights
+		std::vector<float> BoundsX, BoundsY, BoundsZ, BoundsRadius;       // world space bounding sphere, radius < 0: unbounded
+		std::vector<uint8> Flags;
+		std::vector<uint8> Type;
+		std::vector<uint8> Mobility;
+	};
+	struct FColdData
+	{
+		Quaternion         Rotation;
+		DirectX::XMFLOAT3  RenderScale;
+		DirectX::XMFLOAT3  Color;
+		float              Brightness;
+		Light::FShadowData ShadowData;
+		float              TypeData[3]; // Light's type specific union
+	};
+
+public:
+	LightHandle Add(const Light& l);
+	void        Add(const std::vector<Light>& Lights, std::vector<LightHandle>* pOutHandles = nullptr);
+	void        Remove(LightHandle hLight);
+	void        Remove(const std::vector<LightHandle>& hLights);
+	void        Clear();
+
+	bool        IsValid(LightHandle hLight) const;
+	Light       GetLight(LightHandle hLight) const; // reassembles the authoring struct from the hot & cold data
+	void        SetLight(LightHandle hLight, const Light& l);
+	void        SetEnabled(LightHandle hLight, bool bEnabled);
+
+	inline uint32          GetNumLights() const { return static_cast<uint32>(mColdData.size()); }
+	inline const FHotData& GetHotData()   const { return mHotData; }
+	inline LightHandle     GetHandle(uint32 iLight) const { return { mDenseToSlot[iLight], mSlotGenerations[mDenseToSlot[iLight]] }; }
+	Light                  GetLightAt(uint32 iLight) const;
+
+	// Appends the dense indices of the lights that have all the RequiredFlags set and whose bounding
+	// spheres intersect the frustum, 4 lights at a time. Directional lights always pass the frustum test.
+	void GatherVisibleLights(const FFrustumPlaneset& FrustumPlanesInWorldSpace, uint8 RequiredFlags, std::vector<uint32>& OutLightIndices) const;
+
+	// Packs the enabled lights straight from the hot & cold arrays: the directional light and the shadow
+	// casters into the constant buffer data, the non-shadowing point & spot lights into the arrays.
+	void ExportGPUData(
+		  VQ_SHADER_DATA::SceneLighting& OutData
+		, std::vector<VQ_SHADER_DATA::PointLight>& OutPointLights
+		, std::vector<VQ_SHADER_DATA::SpotLight>&  OutSpotLights
+	) const;
+
+private:
+	void WriteLight(uint32 iLight, const Light& l);
+	void RemoveAt(uint32 iLight);
+
+	template<class T> static void SwapRemove(std::vector<T>& v, uint32 i) { v[i] = v.back(); v.pop_back(); }
+	template<class TFn> void ForEachHotArray(TFn&& fn)
+	{
+		FHotData& h = mHotData;
+		fn(h.PositionX); fn(h.PositionY); fn(h.PositionZ); fn(h.Range);
+		fn(h.DirectionX); fn(h.DirectionY); fn(h.DirectionZ);
+		fn(h.CosOuterConeAngle); fn(h.SinOuterConeAngle);
+		fn(h.BoundsX); fn(h.BoundsY); fn(h.BoundsZ); fn(h.BoundsRadius);
+		fn(h.Flags); fn(h.Type); fn(h.Mobility);
+	}
+
+private:
+	FHotData               mHotData;
+	std::vector<FColdData> mColdData;
+
+	std::vector<uint32>    mDenseToSlot;
+	std::vector<uint32>    mSlotToDense;
+	std::vector<uint32>    mSlotGenerations;
+	std::vector<uint32>    mFreeSlots;
+};
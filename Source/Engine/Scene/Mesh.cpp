@@ -25,6 +25,9 @@
 #endif
 
 
+const std::vector<DirectX::XMFLOAT3> Mesh::EMPTY_OCCLUDER_VERTICES;
+const std::vector<uint32>            Mesh::EMPTY_OCCLUDER_INDICES;
+
 EBuiltInMeshes Mesh::GetBuiltInMeshType(const std::string& MeshTypeStr)
 {
 	static std::unordered_map<std::string, EBuiltInMeshes> MESH_TYPE_LOOKUP = 
@@ -19,10 +19,12 @@
 
 #include "../../Renderer/Renderer.h"
 #include "../Culling.h"
+#include "../Meshlets.h"
 
 #include <string>
 #include <vector>
 #include <limits>
+#include <memory>
 
 #include <DirectXMath.h>
 
@@ -69,7 +71,10 @@ struct MeshLODData
 
 // A Mesh is represented by a Vertex & Index buffer ID pair,
 // where the buffers contain the local space vertex and connectivity data.
-// Meshes can have multiple LOD levels, and a single local-space bounding box
+// Meshes can have multiple LOD levels, and a single local-space bounding box.
+// The LOD0 index buffer is in meshlet order so the meshlets can be drawn as index ranges (see MeshletCuller).
+// Instance meshes share the buffers of a source mesh, placed w/ a local transformation
+// (see GeometryDeduplicator) and don't own them.
 struct Mesh
 {
 public:
@@ -85,23 +90,62 @@ public:
 		const std::string&           name
 	);
 
+	// @Meshlets come from BuildMeshlets() or a cooked mesh file, their index list becomes the index buffer
+	template<class TVertex>
+	Mesh(
+		VQRenderer* pRenderer,
+		const std::vector<TVertex>&  vertices,
+		FMeshletData&&               Meshlets,
+		const std::string&           name
+	);
+
 	template<class TVertex, class TIndex>
 	Mesh(VQRenderer* pRenderer, const MeshLODData<TVertex, TIndex>& meshLODData);
 
 	Mesh() = default;
 
+	// @vertices are the instance's own vertices, used for its bounding box only
+	template<class TVertex>
+	static Mesh CreateInstance(const Mesh& SourceMesh, const DirectX::XMFLOAT4X4& matLocalTransformation, const std::vector<TVertex>& vertices);
+
+	// reorders the triangles into meshlets. If they can't be built, the result has no meshlets and @indices as is.
+	template<class TVertex, class TIndex = unsigned>
+	static FMeshletData BuildMeshlets(const std::vector<TVertex>& vertices, const std::vector<TIndex>& indices);
+
 	//
 	// Interface
 	//
 	std::pair<BufferID, BufferID> GetIABufferIDs(int lod = 0) const;
 	inline uint GetNumIndices(int lod = 0) const { return mNumIndicesPerLODLevel[lod]; }
+	inline int  GetNumLODs() const { return static_cast<int>(mLODBufferPairs.size()); }
 	const FBoundingBox GetLocalSpaceBoundingBox() const { return mLocalSpaceBoundingBox; }
+	inline const std::vector<DirectX::XMFLOAT3>& GetOccluderVertices() const { return mpOccluderVertices ? *mpOccluderVertices : EMPTY_OCCLUDER_VERTICES; }
+	inline const std::vector<uint32>&            GetOccluderIndices()  const { return mpOccluderIndices  ? *mpOccluderIndices  : EMPTY_OCCLUDER_INDICES; }
+	inline const FMeshletData*                   GetMeshletData()      const { return mpMeshletData.get(); } // nullptr if the mesh has no meshlets
+	inline bool IsInstance() const { return mbInstance; }
+	inline bool HasLocalTransformation() const { return mbHasLocalTransformation; }
+	inline DirectX::XMMATRIX GetLocalTransformationMatrix() const { return DirectX::XMLoadFloat4x4(&mMatLocalTransformation); }
 	
 private:
 	std::vector<VertexIndexBufferIDPair> mLODBufferPairs;
 	std::vector<uint> mNumIndicesPerLODLevel;
 	FBoundingBox mLocalSpaceBoundingBox;
 
+	// LOD0 positions & indices kept on the CPU for the software occlusion culling, shared w/ the instances
+	std::shared_ptr<const std::vector<DirectX::XMFLOAT3>> mpOccluderVertices;
+	std::shared_ptr<const std::vector<uint32>>            mpOccluderIndices;
+
+	// LOD0 meshlets & bounds for the cluster culling, shared w/ the instances
+	std::shared_ptr<const FMeshletData> mpMeshletData;
+
+	// instances: source mesh local space -> mesh local space
+	DirectX::XMFLOAT4X4 mMatLocalTransformation = {};
+	bool mbHasLocalTransformation = false;
+	bool mbInstance = false;
+
+	static const std::vector<DirectX::XMFLOAT3> EMPTY_OCCLUDER_VERTICES;
+	static const std::vector<uint32>            EMPTY_OCCLUDER_INDICES;
+
 private:
 
 	template<class TVertex>
@@ -117,6 +161,16 @@ Mesh::Mesh(
 	const std::vector<TVertex>& vertices,
 	const std::vector<TIndex>& indices,
 	const std::string& name
+)
+	: Mesh(pRenderer, vertices, BuildMeshlets(vertices, indices), name)
+{}
+
+template<class TVertex>
+Mesh::Mesh(
+	VQRenderer* pRenderer,
+	const std::vector<TVertex>& vertices,
+	FMeshletData&& Meshlets,
+	const std::string& name
 )
 {
 	assert(pRenderer);
@@ -125,6 +179,16 @@ Mesh::Mesh(
 	const std::string VBName = name + "_LOD[0]_VB";
 	const std::string IBName = name + "_LOD[0]_IB";
 
+	// only the meshlets & their bounds are kept for the culling
+	std::vector<uint32> Indices = std::move(Meshlets.Indices);
+	if (!Meshlets.Meshlets.empty())
+	{
+		FMeshletData CullingData;
+		CullingData.Meshlets = std::move(Meshlets.Meshlets);
+		CullingData.Bounds   = std::move(Meshlets.Bounds);
+		mpMeshletData = std::make_shared<const FMeshletData>(std::move(CullingData));
+	}
+
 	bufferDesc.Type         = VERTEX_BUFFER;
 	//bufferDesc.Usage        = GPU_READ_WRITE;
 	bufferDesc.NumElements  = static_cast<unsigned>(vertices.size());
@@ -135,15 +199,49 @@ Mesh::Mesh(
 
 	bufferDesc.Type        = INDEX_BUFFER;
 	//bufferDesc.Usage       = GPU_READ_WRITE;
-	bufferDesc.NumElements = static_cast<unsigned>(indices.size());
+	bufferDesc.NumElements = static_cast<unsigned>(Indices.size());
 	bufferDesc.Stride      = sizeof(unsigned);
-	bufferDesc.pData       = static_cast<const void*>(indices.data());
+	bufferDesc.pData       = static_cast<const void*>(Indices.data());
 	BufferID indexBufferID = pRenderer->CreateBuffer(bufferDesc);
 
 	mLODBufferPairs.push_back({ vertexBufferID, indexBufferID }); // LOD[0]
 	mNumIndicesPerLODLevel.push_back(bufferDesc.NumElements);
 
 	mLocalSpaceBoundingBox = CalculateBoundingBox(vertices);
+
+	std::vector<DirectX::XMFLOAT3> OccluderVertices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+		OccluderVertices[i] = DirectX::XMFLOAT3(vertices[i].position[0], vertices[i].position[1], vertices[i].position[2]);
+	mpOccluderVertices = std::make_shared<const std::vector<DirectX::XMFLOAT3>>(std::move(OccluderVertices));
+	mpOccluderIndices  = std::make_shared<const std::vector<uint32>>(std::move(Indices));
+}
+
+template<class TVertex, class TIndex>
+FMeshletData Mesh::BuildMeshlets(const std::vector<TVertex>& vertices, const std::vector<TIndex>& indices)
+{
+	const std::vector<uint32> Indices(indices.begin(), indices.end());
+	FMeshletData Meshlets;
+	if (!vertices.empty() && !Indices.empty())
+		Meshlets = MeshletBuilder::Build(vertices[0].position, sizeof(TVertex), static_cast<uint32>(vertices.size()), Indices.data(), static_cast<uint32>(Indices.size()), MeshletBuilder::FSettings());
+	if (Meshlets.Meshlets.empty())
+		Meshlets.Indices = Indices;
+	return Meshlets;
+}
+
+template<class TVertex>
+Mesh Mesh::CreateInstance(const Mesh& SourceMesh, const DirectX::XMFLOAT4X4& matLocalTransformation, const std::vector<TVertex>& vertices)
+{
+	Mesh mesh = SourceMesh;
+	mesh.mbInstance = true;
+	mesh.mLocalSpaceBoundingBox = CalculateBoundingBox(vertices);
+
+	// exact duplicates don't need a transformation
+	mesh.mMatLocalTransformation = matLocalTransformation;
+	mesh.mbHasLocalTransformation = false;
+	for (int r = 0; r < 4; ++r)
+		for (int c = 0; c < 4; ++c)
+			mesh.mbHasLocalTransformation |= matLocalTransformation.m[r][c] != (r == c ? 1.0f : 0.0f);
+	return mesh;
 }
 
 template<class TVertex, class TIndex>
@@ -18,7 +18,9 @@
 #pragma once
 
 #include "../Core/Types.h"
+#include "../SkeletalAnimation.h"
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -40,6 +42,20 @@ struct MeshRenderSettings
 using MeshMaterialLookup_t       = std::unordered_map<MeshID, MaterialID>;
 using MeshRenderSettingsLookup_t = std::unordered_map<MeshID, MeshRenderSettings>;
 
+// skeleton, skins & animation clips of a skinned model
+struct FModelAnimationData
+{
+	struct FSkin
+	{
+		BufferID SkinWeightsBufferID = INVALID_ID; // FVertexSkinWeights in the order of the mesh's vertices, read by SkinningPass
+		uint32   NumVertices         = 0;
+	};
+
+	FSkeleton                         Skeleton;
+	std::vector<FAnimationClip>       Clips;
+	std::unordered_map<MeshID, FSkin> Skins; // per skinned mesh
+};
+
 
 //
 // MODEL 
@@ -54,6 +70,7 @@ public:
 		std::vector<MeshID>  mTransparentMeshIDs;
 		MeshMaterialLookup_t mOpaqueMaterials;
 		MeshMaterialLookup_t mTransparentMaterials;
+		std::shared_ptr<const FModelAnimationData> mpAnimationData; // nullptr if the model isn't skinned
 		inline bool HasMaterial() const { return !mOpaqueMaterials.empty() || !mTransparentMaterials.empty(); }
 		bool AddMaterial(MeshID meshID, MaterialID matID, bool bTransparent = false);
 	};
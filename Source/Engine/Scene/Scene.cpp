@@ -24,9 +24,12 @@
 #include "../Core/Window.h"
 #include "../VQEngine.h"
 #include "../Culling.h"
+#include "../VQEngine_RenderCommon.h"
 
 #include "Libs/VQUtils/Source/utils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 
 //-------------------------------------------------------------------------------
@@ -42,6 +45,11 @@
 //-------------------------------------------------------------------------------
 #define ENABLE_VIEW_FRUSTUM_CULLING 1
 #define ENABLE_LIGHT_CULLING        1
+#define ENABLE_OCCLUSION_CULLING    1 // requires ENABLE_VIEW_FRUSTUM_CULLING
+
+// occluder budget for the software occlusion culling, the largest meshes are picked first
+constexpr size_t OCCLUSION_CULLING_MAX_OCCLUDERS          = 64;
+constexpr size_t OCCLUSION_CULLING_MAX_OCCLUDER_TRIANGLES = 64 * 1024;
 //-------------------------------------------------------------------------------
 
 
@@ -58,6 +66,12 @@ using namespace DirectX;
 
 static MeshID LAST_USED_MESH_ID = EBuiltInMeshes::NUM_BUILTIN_MESHES;
 
+// instance meshes are placed in their object's space w/ a local transformation
+static XMMATRIX CalculateMeshWorldTransformation(const Mesh& mesh, const XMMATRIX& matObjectWorld)
+{
+	return mesh.HasLocalTransformation() ? mesh.GetLocalTransformationMatrix() * matObjectWorld : matObjectWorld;
+}
+
 //-------------------------------------------------------------------------------
 //
 // RESOURCE MANAGEMENT
@@ -154,44 +168,99 @@ FSceneStats Scene::GetSceneRenderStats(int FRAME_DATA_INDEX) const
 	const FSceneView& view = mFrameSceneViews[FRAME_DATA_INDEX];
 	const FSceneShadowView& shadowView = mFrameShadowViews[FRAME_DATA_INDEX];
 
-	stats.NumStaticLights         = static_cast<uint>(mLightsStatic.size()    );
-	stats.NumDynamicLights        = static_cast<uint>(mLightsDynamic.size()   );
-	stats.NumStationaryLights     = static_cast<uint>(mLightsStationary.size());
 	stats.NumShadowingPointLights = shadowView.NumPointShadowViews;
 	stats.NumShadowingSpotLights  = shadowView.NumSpotShadowViews;
-	auto fnCountLights = [&stats](const std::vector<Light>& vLights)
+	const LightContainer::FHotData& Lights = mLights.GetHotData();
+	for (uint32 i = 0; i < mLights.GetNumLights(); ++i)
 	{
-		for (const Light& l : vLights)
+		const bool bEnabled = (Lights.Flags[i] & LightContainer::ENABLED) != 0;
+		switch (Lights.Mobility[i])
 		{
-			switch (l.Type)
-			{
-			case Light::EType::DIRECTIONAL: 
-				++stats.NumDirectionalLights;
-				if (!l.bEnabled) ++stats.NumDisabledDirectionalLights;
-				break;
-			case Light::EType::POINT: 
-				++stats.NumPointLights; 
-				if (!l.bEnabled) ++stats.NumDisabledPointLights;
-				break;
-			case Light::EType::SPOT: 
-				++stats.NumSpotLights; 
-				if (!l.bEnabled) ++stats.NumDisabledSpotLights;
-				break;
-
-			//case Light::EType::DIRECTIONAL: break;
-			default:
-				//assert(false); // Area lights are WIP atm, so will hit this on Default scene, as defined in the Default.xml
-				break;
-			}
+		case Light::EMobility::STATIC:     ++stats.NumStaticLights;     break;
+		case Light::EMobility::STATIONARY: ++stats.NumStationaryLights; break;
+		case Light::EMobility::DYNAMIC:    ++stats.NumDynamicLights;    break;
+		default: break;
 		}
-	};
-	fnCountLights(mLightsStationary);
-	fnCountLights(mLightsDynamic);
-	fnCountLights(mLightsStatic);
+		switch (Lights.Type[i])
+		{
+		case Light::EType::DIRECTIONAL: 
+			++stats.NumDirectionalLights;
+			if (!bEnabled) ++stats.NumDisabledDirectionalLights;
+			break;
+		case Light::EType::POINT: 
+			++stats.NumPointLights; 
+			if (!bEnabled) ++stats.NumDisabledPointLights;
+			break;
+		case Light::EType::SPOT: 
+			++stats.NumSpotLights; 
+			if (!bEnabled) ++stats.NumDisabledSpotLights;
+			break;
+
+		default:
+			//assert(false); // Area lights are WIP atm, so will hit this on Default scene, as defined in the Default.xml
+			break;
+		}
+	}
 
 
 	stats.NumMeshRenderCommands        = static_cast<uint>(view.meshRenderCommands.size() + view.lightRenderCommands.size() + view.lightBoundsRenderCommands.size() /*+ view.boundingBoxRenderCommands.size()*/);
 	stats.NumBoundingBoxRenderCommands = static_cast<uint>(view.boundingBoxRenderCommands.size());
+	if (view.sceneParameters.bOcclusionCulling)
+	{
+		const OcclusionCuller::FStatistics OcclusionStats = mOcclusionCuller.GetStatistics();
+		stats.NumOccluders                 = OcclusionStats.NumOccluders;
+		stats.NumOccluderTriangles         = OcclusionStats.NumOccluderTriangles;
+		stats.NumOcclusionTestedMeshes     = OcclusionStats.NumTestedBoundingBoxes;
+		stats.NumOccludedMeshes            = OcclusionStats.NumOccludedBoundingBoxes;
+		stats.OcclusionRasterizationTimeMs = OcclusionStats.RasterizationTimeMs;
+	}
+	if (view.sceneParameters.bInstancedDraws)
+	{
+		const MeshInstanceBatcher::FStatistics& BatchingStats = mInstanceBatcher.GetStatistics();
+		stats.NumDrawBatches          = BatchingStats.NumBatches;
+		stats.NumInstancedDrawBatches = BatchingStats.NumInstancedBatches;
+		stats.InstanceBatchingTimeMs  = BatchingStats.BatchingTimeMs;
+	}
+	if (view.sceneParameters.bMeshletCulling && !view.sceneParameters.bInstancedDraws)
+	{
+		const MeshletCuller::FStatistics& MeshletStats = mMeshletCuller.GetStatistics();
+		stats.NumTestedMeshlets          = MeshletStats.NumTestedMeshlets;
+		stats.NumFrustumCulledMeshlets   = MeshletStats.NumFrustumCulledMeshlets;
+		stats.NumBackfaceCulledMeshlets  = MeshletStats.NumBackfaceCulledMeshlets;
+		stats.NumMeshletCulledMeshes     = MeshletStats.NumCulledMeshes;
+		stats.NumMeshletIndexRanges      = MeshletStats.NumIndexRanges;
+		stats.NumMeshletTestedTriangles  = MeshletStats.NumTestedTriangles;
+		stats.NumMeshletVisibleTriangles = MeshletStats.NumVisibleTriangles;
+		stats.MeshletCullingTimeMs       = MeshletStats.CullingTimeMs;
+	}
+	{
+		stats.NumAnimatedInstances      = mAnimationStats.NumInstances;
+		stats.NumAnimatedBones          = mAnimationStats.NumBones;
+		stats.AnimationEvaluationTimeMs = mAnimationStats.EvaluationTimeMs;
+	}
+	{
+		const RayQueryAccelerationStructure::FStatistics& RayQueryStats = mRayQueryAS.GetStatistics();
+		stats.NumRayQueryMeshes    = RayQueryStats.NumMeshes;
+		stats.NumRayQueryTriangles = RayQueryStats.NumInstanceTriangles;
+		stats.NumRayQueryInstances = RayQueryStats.NumInstances;
+		stats.NumRayQueries        = mNumRayQueries;
+		stats.RayQueryBuildTimeMs  = RayQueryStats.TopLevelBuildTimeMs;
+	}
+	{
+		const LightClusterBinner::FStatistics& BinningStats = mLightClusterBinner.GetStatistics();
+		stats.NumLightClusters         = BinningStats.NumClusters;
+		stats.NumOccupiedLightClusters = BinningStats.NumOccupiedClusters;
+		stats.NumLightClusterIndices   = BinningStats.NumLightIndices;
+		stats.MaxLightsPerCluster      = BinningStats.MaxLightsPerCluster;
+		stats.LightBinningTimeMs       = BinningStats.BinningTimeMs;
+	}
+	if (view.sceneParameters.bCacheShadowMaps)
+	{
+		const ShadowCache::FStatistics& ShadowCacheStats = mShadowCache.GetStatistics();
+		stats.NumCachedShadowViews         = ShadowCacheStats.NumReusedViews;
+		stats.NumDynamicRedrawnShadowViews = ShadowCacheStats.NumDynamicRedraws;
+		stats.NumFullyRedrawnShadowViews   = ShadowCacheStats.NumFullRedraws;
+	}
 	auto fnCountShadowMeshRenderCommands = [](const FSceneShadowView& shadowView) -> uint
 	{
 		uint NumShadowRenderCmds = 0;
@@ -200,7 +269,8 @@ FSceneStats Scene::GetSceneRenderStats(int FRAME_DATA_INDEX) const
 			NumShadowRenderCmds += static_cast<uint>(shadowView.ShadowViews_Point[i * 6 + face].meshRenderCommands.size());
 		for (uint i = 0; i < shadowView.NumSpotShadowViews; ++i)
 			NumShadowRenderCmds += static_cast<uint>(shadowView.ShadowViews_Spot[i].meshRenderCommands.size());
-		NumShadowRenderCmds += static_cast<uint>(shadowView.ShadowView_Directional.meshRenderCommands.size());
+		for (uint i = 0; i < shadowView.NumDirectionalCascades; ++i)
+			NumShadowRenderCmds += static_cast<uint>(shadowView.ShadowViews_Directional[i].meshRenderCommands.size());
 		return NumShadowRenderCmds;
 	};
 	stats.NumShadowMeshRenderCommands = fnCountShadowMeshRenderCommands(shadowView);
@@ -220,48 +290,6 @@ FSceneStats Scene::GetSceneRenderStats(int FRAME_DATA_INDEX) const
 // STATIC HELPERS
 //
 //-------------------------------------------------------------------------------
-// returns true if culled
-static bool ShouldCullLight(const Light& l, const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace)
-{
-	bool bCulled = false;
-	switch (l.Type)
-	{
-	case Light::EType::DIRECTIONAL: break; // no culling for directional lights
-	case Light::EType::SPOT:
-		bCulled = !IsFrustumIntersectingFrustum(MainViewFrustumPlanesInWorldSpace, FFrustumPlaneset::ExtractFromMatrix(l.GetViewProjectionMatrix()));
-		break;
-	case Light::EType::POINT:
-		bCulled = !IsSphereIntersectingFurstum(MainViewFrustumPlanesInWorldSpace, FSphere(l.GetTransform()._position, l.Range));
-		break;
-	default: assert(false); break; // unknown light type for culling
-	}
-	return bCulled;
-}
-static std::vector<size_t> GetActiveAndCulledLightIndices(const std::vector<Light> vLights, const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace)
-{
-	SCOPED_CPU_MARKER("GetActiveAndCulledLightIndices()");
-	constexpr bool bCULL_LIGHTS = true;
-
-	std::vector<size_t> ActiveLightIndices;
-
-	for (size_t i = 0; i < vLights.size(); ++i)
-	{
-		const Light& l = vLights[i];
-
-		// skip disabled and non-shadow casting lights
-		if (!l.bEnabled || !l.bCastingShadows)
-			continue;
-
-#if ENABLE_LIGHT_CULLING	
-		if (ShouldCullLight(l, MainViewFrustumPlanesInWorldSpace))
-			continue;
-#endif
-
-		ActiveLightIndices.push_back(i);
-	}
-
-	return ActiveLightIndices;
-}
 static std::string DumpCameraInfo(int index, const Camera& cam)
 {
 	const XMFLOAT3 pos = cam.GetPositionF();
@@ -287,6 +315,7 @@ static void ToggleBool(bool& b) { b = !b; }
 //-------------------------------------------------------------------------------
 Scene::Scene(VQEngine& engine, int NumFrameBuffers, const Input& input, const std::unique_ptr<Window>& pWin, VQRenderer& renderer)
 	: mInput(input)
+	, mInputActions(engine.GetSceneInputActions())
 	, mpWindow(pWin)
 	, mEngine(engine)
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
@@ -298,14 +327,18 @@ Scene::Scene(VQEngine& engine, int NumFrameBuffers, const Input& input, const st
 #endif
 	, mIndex_SelectedCamera(0)
 	, mIndex_ActiveEnvironmentMapPreset(-1)
-	, mGameObjectPool(NUM_GAMEOBJECT_POOL_SIZE, GAMEOBJECT_BYTE_ALIGNMENT)
-	, mTransformPool(NUM_GAMEOBJECT_POOL_SIZE, GAMEOBJECT_BYTE_ALIGNMENT)
+	, mGameObjectPool(NUM_GAMEOBJECT_POOL_SIZE, GAMEOBJECT_BYTE_ALIGNMENT, EMemoryTag::Scene)
+	, mTransformPool(NUM_GAMEOBJECT_POOL_SIZE, GAMEOBJECT_BYTE_ALIGNMENT, EMemoryTag::Scene)
 	, mResourceNames(engine.GetResourceNames())
 	, mAssetLoader(engine.GetAssetLoader())
 	, mRenderer(renderer)
 	, mMaterialAssignments(engine.GetAssetLoader().GetThreadPool_TextureLoad())
 	, mBoundingBoxHierarchy(mMeshes, mModels, mMaterials, mpTransforms)
-{}
+{
+	mOcclusionCuller.Initialize(OcclusionCuller::DEFAULT_WIDTH, OcclusionCuller::DEFAULT_HEIGHT);
+	mLightClusterBinner.Initialize();
+	mShadowCache.Initialize(NUM_SHADOWING_LIGHTS__SPOT + NUM_SHADOWING_LIGHTS__POINT * 6 + NUM_SHADOW_CASCADES__DIRECTIONAL);
+}
 
 
 void Scene::PreUpdate(int FRAME_DATA_INDEX, int FRAME_DATA_PREV_INDEX)
@@ -328,20 +361,57 @@ void Scene::PreUpdate(int FRAME_DATA_INDEX, int FRAME_DATA_PREV_INDEX)
 void Scene::Update(float dt, int FRAME_DATA_INDEX)
 {
 	SCOPED_CPU_MARKER("Scene::Update()");
+	SCOPED_MEMORY_TAG(EMemoryTag::Scene);
 
 	assert(FRAME_DATA_INDEX < mFrameSceneViews.size());
 	FSceneView& SceneView = mFrameSceneViews[FRAME_DATA_INDEX];
 
 	Camera& Cam = this->mCameras[this->mIndex_SelectedCamera];
 
+	// objects may have moved since the last frame, the first ray query rebuilds the top level
+	mbRayQueryTopLevelDirty = true;
+	mNumRayQueries = mNumFrameRayQueries;
+	mNumFrameRayQueries = 0;
+
 	Cam.Update(dt, mInput);
 	this->HandleInput(SceneView);
 	this->UpdateScene(dt, SceneView);
+	mAnimationTime += dt;
+
+	if (mAssetLoader.IsModelStreamingEnabled())
+		this->UpdateModelStreaming();
+}
+
+void Scene::UpdateModelStreaming()
+{
+	SCOPED_CPU_MARKER("Scene::UpdateModelStreaming()");
+	SCOPED_MEMORY_TAG(EMemoryTag::Streaming);
+	const Camera& Cam = mCameras[mIndex_SelectedCamera];
+	const FProjectionMatrixParameters& Proj = Cam.GetProjectionParameters();
+
+	// radius/distance -> pixels
+	FAssetStreamingView View;
+	View.Position = Cam.GetPositionF();
+	View.ProjectionScale = Proj.bPerspectiveProjection
+		? Proj.ViewportHeight / (2.0f * std::tan(Proj.FieldOfView * 0.5f))
+		: Proj.ViewportHeight;
+
+	const FBoundingBox& PlaceholderAABB = mMeshes.at(EBuiltInMeshes::CUBE).GetLocalSpaceBoundingBox();
+	const XMVECTOR vPlaceholderExtent = XMVectorSubtract(XMLoadFloat3(&PlaceholderAABB.ExtentMax), XMLoadFloat3(&PlaceholderAABB.ExtentMin));
+	const float PlaceholderRadius = 0.5f * XMVectorGetX(XMVector3Length(vPlaceholderExtent));
+
+	std::vector<GameObject*> pStreamedObjects;
+	mAssetLoader.UpdateModelStreaming(View, mpTransforms, PlaceholderRadius, pStreamedObjects);
+
+	// the bounding box hierarchy is rebuilt from these in PostUpdate()
+	for (GameObject* pObj : pStreamedObjects)
+		CalculateGameObjectLocalSpaceBoundingBox(pObj);
 }
 
 void Scene::PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX)
 {
 	SCOPED_CPU_MARKER("Scene::PostUpdate()");
+	SCOPED_MEMORY_TAG(EMemoryTag::Scene);
 	assert(FRAME_DATA_INDEX < mFrameSceneViews.size());
 	FSceneView& SceneView = mFrameSceneViews[FRAME_DATA_INDEX];
 	FSceneShadowView& ShadowView = mFrameShadowViews[FRAME_DATA_INDEX];
@@ -378,11 +448,18 @@ void Scene::PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX)
 		mBoundingBoxHierarchy.BuildMeshBoundingBoxes(mpObjects);
 	}
 
+	UpdateSkeletalAnimations(SceneView, UpdateWorkerThreadPool); // before the render commands, they reference the skinned vertices
+
 	if constexpr (!UPDATE_THREAD__ENABLE_WORKERS)
 	{
-		PrepareSceneMeshRenderParams(ViewFrustumPlanes, SceneView.meshRenderCommands);
+		PrepareSceneMeshRenderParams(ViewFrustumPlanes, SceneView.viewProj, SceneView.sceneParameters.bOcclusionCulling, SceneView.meshRenderCommands);
+		BatchSceneMeshRenderCommands(SceneView);
+		CullSceneMeshlets(SceneView);
 		GatherSceneLightData(SceneView);
+		FitDirectionalShadowCascades(SceneView, ShadowView);
+		BinSceneLights(SceneView);
 		PrepareShadowMeshRenderParams(ShadowView, ViewFrustumPlanes, UpdateWorkerThreadPool);
+		UpdateShadowCache(ShadowView, SceneView.sceneParameters.bCacheShadowMaps);
 		PrepareLightMeshRenderParams(SceneView);
 		PrepareBoundingBoxRenderParams(SceneView);
 	}
@@ -390,10 +467,15 @@ void Scene::PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX)
 	{
 		UpdateWorkerThreadPool.AddTask([=, &SceneView]()
 		{
-			PrepareSceneMeshRenderParams(ViewFrustumPlanes, SceneView.meshRenderCommands);
+			PrepareSceneMeshRenderParams(ViewFrustumPlanes, SceneView.viewProj, SceneView.sceneParameters.bOcclusionCulling, SceneView.meshRenderCommands);
+			BatchSceneMeshRenderCommands(SceneView);
+			CullSceneMeshlets(SceneView);
 		});
 		GatherSceneLightData(SceneView);
+		FitDirectionalShadowCascades(SceneView, ShadowView);
+		BinSceneLights(SceneView);
 		PrepareShadowMeshRenderParams(ShadowView, ViewFrustumPlanes, UpdateWorkerThreadPool);
+		UpdateShadowCache(ShadowView, SceneView.sceneParameters.bCacheShadowMaps);
 		PrepareLightMeshRenderParams(SceneView);
 		{
 			SCOPED_CPU_MARKER_C("BUSY_WAIT_WORKER", 0xFFFF0000);
@@ -401,6 +483,8 @@ void Scene::PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX)
 		}
 		PrepareBoundingBoxRenderParams(SceneView);
 	}
+
+	UpdateTextureResidency(SceneView);
 }
 
 
@@ -454,48 +538,47 @@ void Scene::RenderUI(FUIState& UIState, uint32_t W, uint32_t H)
 
 void Scene::HandleInput(FSceneView& SceneView)
 {
-	const bool bIsShiftDown = mInput.IsKeyDown("Shift");
-	const bool bIsCtrlDown = mInput.IsKeyDown("Ctrl");
 	const int NumEnvMaps = static_cast<int>(mResourceNames.mEnvironmentMapPresetNames.size());
+	const int NumCameras = static_cast<int>(mCameras.size());
 
-	if (mInput.IsKeyTriggered("C"))
-	{
-		if (bIsCtrlDown) // CTRL + C : Dump Camera Info
-		{
-			std::string camInfo = DumpCameraInfo(mIndex_SelectedCamera, mCameras[mIndex_SelectedCamera]);
-			Log::Info(camInfo.c_str());
-		}
-		else
-		{
-			const int NumCameras = static_cast<int>(mCameras.size());
-			mIndex_SelectedCamera = bIsShiftDown
-				? CircularDecrement(mIndex_SelectedCamera, NumCameras)
-				: CircularIncrement(mIndex_SelectedCamera, NumCameras);
-		}
-	}
-	if (mInput.IsKeyTriggered("L"))
+	if (mInput.IsActionTriggered(mInputActions.DumpCameraInfo))
 	{
-		ToggleBool(SceneView.sceneParameters.bDrawLightBounds);
+		std::string camInfo = DumpCameraInfo(mIndex_SelectedCamera, mCameras[mIndex_SelectedCamera]);
+		Log::Info(camInfo.c_str());
 	}
-	if (mInput.IsKeyTriggered("N"))
+	if (mInput.IsActionTriggered(mInputActions.NextCamera))     mIndex_SelectedCamera = CircularIncrement(mIndex_SelectedCamera, NumCameras);
+	if (mInput.IsActionTriggered(mInputActions.PreviousCamera)) mIndex_SelectedCamera = CircularDecrement(mIndex_SelectedCamera, NumCameras);
+	if (mInput.IsActionTriggered(mInputActions.ToggleLightBounds))             ToggleBool(SceneView.sceneParameters.bDrawLightBounds);
+	if (mInput.IsActionTriggered(mInputActions.ToggleMeshBoundingBoxes))       ToggleBool(SceneView.sceneParameters.bDrawMeshBoundingBoxes);
+	if (mInput.IsActionTriggered(mInputActions.ToggleGameObjectBoundingBoxes)) ToggleBool(SceneView.sceneParameters.bDrawGameObjectBoundingBoxes);
+	if (mInput.IsMouseTriggered(Input::EMouseButtons::MOUSE_BUTTON_MIDDLE)) // pick the object under the cursor
 	{
-		if(bIsShiftDown) ToggleBool(SceneView.sceneParameters.bDrawGameObjectBoundingBoxes);
-		else             ToggleBool(SceneView.sceneParameters.bDrawMeshBoundingBoxes);
+		const std::array<long, 2>& MousePosition = mInput.GetMousePosition();
+		const float u = (MousePosition[0] + 0.5f) / std::max(1, mpWindow->GetWidth());
+		const float v = (MousePosition[1] + 0.5f) / std::max(1, mpWindow->GetHeight());
+		FSceneRayHit Hit;
+		if (RayCast(CalculateCameraRay(u, v), Hit))
+		{
+			Log::Info("Picked %s : mesh %d, triangle %u, %.2f units away"
+				, mModels.at(Hit.pObject->mModelID).mModelName.c_str(), Hit.meshID, Hit.TriangleIndex, Hit.T);
+		}
 	}
 
 	
 	// if there's no EnvMap selected and the user wants the change the env map,
 	// temporarily assign 0 so that Circular*crement() can work
-	if ((mInput.IsKeyTriggered("PageUp")|| mInput.IsKeyTriggered("PageDown")) && mIndex_ActiveEnvironmentMapPreset == -1)
+	const bool bNextEnvMap     = mInput.IsActionTriggered(mInputActions.NextEnvironmentMap);
+	const bool bPreviousEnvMap = mInput.IsActionTriggered(mInputActions.PreviousEnvironmentMap);
+	if ((bNextEnvMap || bPreviousEnvMap) && mIndex_ActiveEnvironmentMapPreset == -1)
 	{
 		mIndex_ActiveEnvironmentMapPreset = 0;
 	}
-	if (mInput.IsKeyTriggered("PageUp"))
+	if (bNextEnvMap)
 	{
 		mIndex_ActiveEnvironmentMapPreset = CircularIncrement(mIndex_ActiveEnvironmentMapPreset, NumEnvMaps);
 		mEngine.StartLoadingEnvironmentMap(mIndex_ActiveEnvironmentMapPreset);
 	}
-	if (mInput.IsKeyTriggered("PageDown"))
+	if (bPreviousEnvMap)
 	{
 		mIndex_ActiveEnvironmentMapPreset = CircularDecrement(mIndex_ActiveEnvironmentMapPreset, NumEnvMaps - 1);
 		mEngine.StartLoadingEnvironmentMap(mIndex_ActiveEnvironmentMapPreset);
@@ -509,147 +592,618 @@ void Scene::GatherSceneLightData(FSceneView& SceneView) const
 	SceneView.lightBoundsRenderCommands.clear();
 	SceneView.lightRenderCommands.clear();
 
-	VQ_SHADER_DATA::SceneLighting& data = SceneView.GPULightingData;
+	mLights.ExportGPUData(SceneView.GPULightingData, SceneView.GPUPointLights, SceneView.GPUSpotLights);
+}
 
-	int iGPUSpot = 0;  int iGPUSpotShadow = 0;
-	int iGPUPoint = 0; int iGPUPointShadow = 0;
-	auto fnGatherLightData = [&](const std::vector<Light>& vLights, Light::EMobility eLightMobility)
+void Scene::FitDirectionalShadowCascades(FSceneView& SceneView, FSceneShadowView& ShadowView) const
+{
+	SCOPED_CPU_MARKER("Scene::FitDirectionalShadowCascades()");
+	ShadowView.NumDirectionalCascades = 0;
+	SceneView.GPULightingData.directional.numCascades = 0;
+
+	// first enabled, shadow casting directional light
+	constexpr uint8 ShadowingLightFlags = LightContainer::ENABLED | LightContainer::CASTING_SHADOWS;
+	const LightContainer::FHotData& Lights = mLights.GetHotData();
+	uint32 iDirectionalLight = mLights.GetNumLights();
+	for (uint32 i = 0; i < mLights.GetNumLights(); ++i)
 	{
-		for (const Light& l : vLights)
+		if (Lights.Type[i] == Light::EType::DIRECTIONAL && (Lights.Flags[i] & ShadowingLightFlags) == ShadowingLightFlags)
 		{
-			if (!l.bEnabled) continue;
-			if (l.Mobility != eLightMobility) continue;
+			iDirectionalLight = i;
+			break;
+		}
+	}
+	if (iDirectionalLight == mLights.GetNumLights())
+		return;
 
-			switch (l.Type)
+	// scene bounds for extruding the cascades toward the light
+	FBoundingBox SceneBoundingBox;
+	if (!mBoundingBoxHierarchy.mGameObjectBoundingBoxes.empty())
+	{
+		XMVECTOR vMin = XMLoadFloat3(&mBoundingBoxHierarchy.mGameObjectBoundingBoxes[0].ExtentMin);
+		XMVECTOR vMax = XMLoadFloat3(&mBoundingBoxHierarchy.mGameObjectBoundingBoxes[0].ExtentMax);
+		for (const FBoundingBox& BB : mBoundingBoxHierarchy.mGameObjectBoundingBoxes)
+		{
+			vMin = XMVectorMin(vMin, XMLoadFloat3(&BB.ExtentMin));
+			vMax = XMVectorMax(vMax, XMLoadFloat3(&BB.ExtentMax));
+		}
+		XMStoreFloat3(&SceneBoundingBox.ExtentMin, vMin);
+		XMStoreFloat3(&SceneBoundingBox.ExtentMax, vMax);
+	}
+
+	const Camera& cam = mCameras[mIndex_SelectedCamera];
+	const FProjectionMatrixParameters& ProjParams = cam.GetProjectionParameters();
+
+	FCascadedShadowMapParameters Params;
+	Params.CameraPosition = cam.GetPositionF();
+	XMStoreFloat3(&Params.CameraForward, XMVector3Normalize(SceneView.viewInverse.r[2]));
+	Params.NearZ               = ProjParams.NearZ;
+	Params.FarZ                = ProjParams.FarZ;
+	Params.FieldOfViewY        = ProjParams.FieldOfView;
+	Params.AspectRatio         = ProjParams.ViewportWidth / ProjParams.ViewportHeight;
+	Params.LightDirection      = XMFLOAT3(Lights.DirectionX[iDirectionalLight], Lights.DirectionY[iDirectionalLight], Lights.DirectionZ[iDirectionalLight]);
+	Params.SceneBoundingBox    = SceneBoundingBox;
+	Params.NumCascades         = NUM_SHADOW_CASCADES__DIRECTIONAL;
+	Params.ShadowMapResolution = SHADOW_MAP_DIMENSION_DIRECTIONAL;
+	Params.MaxShadowDistance   = SceneView.sceneParameters.fDirectionalShadowDistance;
+	Params.SplitLambda         = SceneView.sceneParameters.fCascadeSplitLambda;
+
+	const uint32 NumCascades = FitShadowCascades(Params, ShadowView.DirectionalCascades.data());
+	for (uint32 i = 0; i < NumCascades; ++i)
+	{
+		ShadowView.ShadowViews_Directional[i].matViewProj = ShadowView.DirectionalCascades[i].matViewProj;
+		SceneView.GPULightingData.shadowViewDirectional[i] = ShadowView.DirectionalCascades[i].matViewProj;
+	}
+	ShadowView.NumDirectionalCascades = NumCascades;
+	SceneView.GPULightingData.directional.numCascades = static_cast<int>(NumCascades);
+}
+
+void Scene::BinSceneLights(FSceneView& SceneView)
+{
+	SCOPED_CPU_MARKER("Scene::BinSceneLights()");
+	const FProjectionMatrixParameters& ProjParams = mCameras[mIndex_SelectedCamera].GetProjectionParameters();
+	mLightClusterBinner.Bin(SceneView.view, SceneView.proj, ProjParams.NearZ, ProjParams.FarZ, SceneView.GPUPointLights, SceneView.GPUSpotLights, SceneView.LightClusterGrid);
+}
+
+void Scene::UpdateShadowCache(FSceneShadowView& ShadowView, bool bCacheShadowMaps)
+{
+	SCOPED_CPU_MARKER("Scene::UpdateShadowCache()");
+	mShadowCache.BeginFrame();
+
+	std::vector<FShadowMeshRenderCommand> DynamicCasters;
+	auto fnUpdateShadowView = [&](FSceneShadowView::FShadowView& View, uint32 iView)
+	{
+		if (!bCacheShadowMaps)
+		{
+			mShadowCache.Invalidate(iView);
+			View.NumStaticMeshRenderCommands = 0;
+			View.CacheUpdate = ShadowCache::EViewUpdate::REDRAW_ALL;
+			return;
+		}
+
+		ShadowCache::FViewSignature Signature;
+		Signature.LightHash = ShadowCache::HashMatrix(View.matViewProj);
+
+		// move the static casters to the front, keep their relative order
+		std::vector<FShadowMeshRenderCommand>& vMeshRenderList = View.meshRenderCommands;
+		DynamicCasters.clear();
+		size_t NumStaticCasters = 0;
+		for (size_t i = 0; i < vMeshRenderList.size(); ++i)
+		{
+			FShadowMeshRenderCommand& cmd = vMeshRenderList[i];
+			const bool bSkinned = cmd.iFirstSkinnedVertex != INVALID_ID;
+			const bool bStaticCaster = mShadowCache.UpdateCaster(cmd.transformID, mpTransforms.at(cmd.transformID)->matWorldTransformation()) && !bSkinned; // object, not mesh transform
+			mShadowCache.AddCaster(Signature, cmd.transformID, cmd.meshID, bSkinned);
+
+			if (!bStaticCaster)
 			{
-			case Light::EType::DIRECTIONAL:
-				l.GetGPUData(&data.directional);
-				if (l.bCastingShadows)
-				{
-					data.shadowViewDirectional = l.GetViewProjectionMatrix();
-				}
-				break;
-			case Light::EType::SPOT:
-				l.GetGPUData(l.bCastingShadows ? &data.spot_casters[iGPUSpotShadow++] : &data.spot_lights[iGPUSpot++]);
-				if (l.bCastingShadows)
-				{
-					data.shadowViews[iGPUSpotShadow - 1] = l.GetViewProjectionMatrix();
-				}
-				break;
-			case Light::EType::POINT:
-				l.GetGPUData(l.bCastingShadows ? &data.point_casters[iGPUPointShadow++] : &data.point_lights[iGPUPoint++]);
-				// TODO: 
-				break;
-			default:
-				break;
+				DynamicCasters.push_back(std::move(cmd));
+				continue;
 			}
-
+			if (i != NumStaticCasters)
+				vMeshRenderList[NumStaticCasters] = std::move(cmd);
+			++NumStaticCasters;
 		}
+		std::move(DynamicCasters.begin(), DynamicCasters.end(), vMeshRenderList.begin() + NumStaticCasters);
+
+		View.NumStaticMeshRenderCommands = static_cast<uint>(NumStaticCasters);
+		View.CacheUpdate = mShadowCache.UpdateView(iView, Signature);
 	};
-	fnGatherLightData(mLightsStatic, Light::EMobility::STATIC);
-	fnGatherLightData(mLightsStationary, Light::EMobility::STATIONARY);
-	fnGatherLightData(mLightsDynamic, Light::EMobility::DYNAMIC);
-
-	data.numPointCasters = iGPUPointShadow;
-	data.numPointLights = iGPUPoint;
-	data.numSpotCasters = iGPUSpotShadow;
-	data.numSpotLights = iGPUSpot;
+
+	// view indices: [spots | point faces | directional cascades]
+	for (uint i = 0; i < ShadowView.NumSpotShadowViews; ++i)
+		fnUpdateShadowView(ShadowView.ShadowViews_Spot[i], i);
+	for (uint i = 0; i < ShadowView.NumPointShadowViews * 6; ++i)
+		fnUpdateShadowView(ShadowView.ShadowViews_Point[i], NUM_SHADOWING_LIGHTS__SPOT + i);
+	for (uint i = 0; i < ShadowView.NumDirectionalCascades; ++i)
+		fnUpdateShadowView(ShadowView.ShadowViews_Directional[i], NUM_SHADOWING_LIGHTS__SPOT + NUM_SHADOWING_LIGHTS__POINT * 6 + i);
 }
 
 void Scene::PrepareLightMeshRenderParams(FSceneView& SceneView) const
 {
 	SCOPED_CPU_MARKER("Scene::PrepareLightMeshRenderParams()");
+	SCOPED_MEMORY_TAG(EMemoryTag::RenderCommands);
 	if (!SceneView.sceneParameters.bDrawLightBounds && !SceneView.sceneParameters.bDrawLightMeshes)
 		return;
 
-	auto fnGatherLightRenderData = [&](const std::vector<Light>& vLights)
+	const LightContainer::FHotData& Lights = mLights.GetHotData();
+	for (uint32 i = 0; i < mLights.GetNumLights(); ++i)
 	{
-		for (const Light& l : vLights)
+		if (!(Lights.Flags[i] & LightContainer::ENABLED) || Lights.Type[i] == Light::EType::DIRECTIONAL)
+			continue;
+
+		const Light l = mLights.GetLightAt(i);
+
+		FLightRenderCommand cmd;
+		cmd.color = XMFLOAT3(l.Color.x * l.Brightness, l.Color.y * l.Brightness, l.Color.z * l.Brightness);
+		cmd.matWorldTransformation = l.GetWorldTransformationMatrix();
+
+		switch (l.Type)
 		{
-			if (!l.bEnabled)
-				continue;
+		case Light::EType::DIRECTIONAL:
+			continue; // don't draw directional light mesh
+			break;
 
-			FLightRenderCommand cmd;
-			cmd.color = XMFLOAT3(l.Color.x * l.Brightness, l.Color.y * l.Brightness, l.Color.z * l.Brightness);
-			cmd.matWorldTransformation = l.GetWorldTransformationMatrix();
+		case Light::EType::SPOT:
+		{
+			// light mesh
+			if (SceneView.sceneParameters.bDrawLightMeshes)
+			{
+				cmd.meshID = EBuiltInMeshes::SPHERE;
+				SceneView.lightRenderCommands.push_back(cmd);
+			}
 
-			switch (l.Type)
+			// light bounds
+			if (SceneView.sceneParameters.bDrawLightBounds)
 			{
-			case Light::EType::DIRECTIONAL:
-				continue; // don't draw directional light mesh
-				break;
+				cmd.meshID = EBuiltInMeshes::CONE;
+				Transform tf = l.GetTransform();
+				tf.SetScale(1, 1, 1); // reset scale as it holds the scale value for light's render mesh
+				tf.RotateAroundLocalXAxisDegrees(-90.0f); // align with spot light's local space
+
+				XMMATRIX alignConeToSpotLightTransformation = XMMatrixIdentity();
+				alignConeToSpotLightTransformation.r[3].m128_f32[0] = 0.0f;
+				alignConeToSpotLightTransformation.r[3].m128_f32[1] = -l.Range;
+				alignConeToSpotLightTransformation.r[3].m128_f32[2] = 0.0f;
+
+				const float coneBaseRadius = std::tanf(l.SpotOuterConeAngleDegrees * DEG2RAD) * l.Range;
+				XMMATRIX scaleConeToRange = XMMatrixIdentity();
+				scaleConeToRange.r[0].m128_f32[0] = coneBaseRadius;
+				scaleConeToRange.r[1].m128_f32[1] = l.Range;
+				scaleConeToRange.r[2].m128_f32[2] = coneBaseRadius;
+
+				//wvp = alignConeToSpotLightTransformation * tf.WorldTransformationMatrix() * viewProj;
+				cmd.matWorldTransformation = scaleConeToRange * alignConeToSpotLightTransformation * tf.matWorldTransformation();
+				cmd.color = l.Color;  // drop the brightness multiplier for bounds rendering
+				SceneView.lightBoundsRenderCommands.push_back(cmd);
+			}
+		}	break;
 
-			case Light::EType::SPOT:
+		case Light::EType::POINT:
+		{
+			// light mesh
+			if (SceneView.sceneParameters.bDrawLightMeshes)
 			{
-				// light mesh
-				if (SceneView.sceneParameters.bDrawLightMeshes)
-				{
-					cmd.meshID = EBuiltInMeshes::SPHERE;
-					SceneView.lightRenderCommands.push_back(cmd);
-				}
+				cmd.meshID = EBuiltInMeshes::SPHERE;
+				SceneView.lightRenderCommands.push_back(cmd);
+			}
 
-				// light bounds
-				if (SceneView.sceneParameters.bDrawLightBounds)
-				{
-					cmd.meshID = EBuiltInMeshes::CONE;
-					Transform tf = l.GetTransform();
-					tf.SetScale(1, 1, 1); // reset scale as it holds the scale value for light's render mesh
-					tf.RotateAroundLocalXAxisDegrees(-90.0f); // align with spot light's local space
-
-					XMMATRIX alignConeToSpotLightTransformation = XMMatrixIdentity();
-					alignConeToSpotLightTransformation.r[3].m128_f32[0] = 0.0f;
-					alignConeToSpotLightTransformation.r[3].m128_f32[1] = -l.Range;
-					alignConeToSpotLightTransformation.r[3].m128_f32[2] = 0.0f;
-
-					const float coneBaseRadius = std::tanf(l.SpotOuterConeAngleDegrees * DEG2RAD) * l.Range;
-					XMMATRIX scaleConeToRange = XMMatrixIdentity();
-					scaleConeToRange.r[0].m128_f32[0] = coneBaseRadius;
-					scaleConeToRange.r[1].m128_f32[1] = l.Range;
-					scaleConeToRange.r[2].m128_f32[2] = coneBaseRadius;
-
-					//wvp = alignConeToSpotLightTransformation * tf.WorldTransformationMatrix() * viewProj;
-					cmd.matWorldTransformation = scaleConeToRange * alignConeToSpotLightTransformation * tf.matWorldTransformation();
-					cmd.color = l.Color;  // drop the brightness multiplier for bounds rendering
-					SceneView.lightBoundsRenderCommands.push_back(cmd);
-				}
-			}	break;
+			// light bounds
+			if (SceneView.sceneParameters.bDrawLightBounds)
+			{
+				Transform tf = l.GetTransform();
+				tf._scale = XMFLOAT3(l.Range, l.Range, l.Range);
+				cmd.matWorldTransformation = tf.matWorldTransformation();
+				cmd.color = l.Color; // drop the brightness multiplier for bounds rendering
+				SceneView.lightBoundsRenderCommands.push_back(cmd);
+			}
+		}  break;
+		} // swicth
+	} // for: Lights
+}
 
-			case Light::EType::POINT:
+
+void Scene::BatchSceneMeshRenderCommands(FSceneView& SceneView)
+{
+	SCOPED_CPU_MARKER("Scene::BatchSceneMeshRenderCommands()");
+	SCOPED_MEMORY_TAG(EMemoryTag::RenderCommands);
+	if (!SceneView.sceneParameters.bInstancedDraws)
+	{
+		SceneView.instancedMeshRenderCommands.clear();
+		SceneView.meshInstanceData.clear();
+		return;
+	}
+
+	const int MaxInstancesPerBatch = std::clamp(SceneView.sceneParameters.iMaxInstancesPerBatch, 1, MAX_INSTANCE_COUNT__SCENE_MESHES);
+	mInstanceBatcher.Batch(SceneView.meshRenderCommands, static_cast<uint32>(MaxInstancesPerBatch), SceneView.instancedMeshRenderCommands, SceneView.meshInstanceData);
+}
+
+void Scene::CullSceneMeshlets(FSceneView& SceneView)
+{
+	SCOPED_CPU_MARKER("Scene::CullSceneMeshlets()");
+	SceneView.meshIndexRanges.clear();
+	if (!SceneView.sceneParameters.bMeshletCulling || SceneView.sceneParameters.bInstancedDraws)
+		return;
+
+	XMFLOAT3 CameraPosition;
+	XMStoreFloat3(&CameraPosition, SceneView.cameraPosition);
+
+	// commands w/ all their meshlets culled are dropped
+	std::vector<FMeshRenderCommand>& MeshRenderCommands = SceneView.meshRenderCommands;
+	size_t NumVisibleCommands = 0;
+	mMeshletCuller.BeginFrame();
+	for (size_t i = 0; i < MeshRenderCommands.size(); ++i)
+	{
+		FMeshRenderCommand& cmd = MeshRenderCommands[i];
+		auto it = mMeshes.find(cmd.meshID);
+		const bool bSkinned = cmd.iFirstSkinnedVertex != INVALID_ID; // meshlet bounds are in bind pose
+		const FMeshletData* pMeshletData = it != mMeshes.end() && !bSkinned ? it->second.GetMeshletData() : nullptr;
+		if (pMeshletData)
+		{
+			const uint32 iFirstIndexRange = static_cast<uint32>(SceneView.meshIndexRanges.size());
+			const uint32 NumIndexRanges = mMeshletCuller.Cull(*pMeshletData, cmd.matWorldTransformation, SceneView.viewProj, CameraPosition, SceneView.meshIndexRanges);
+			if (NumIndexRanges == 0)
+				continue;
+			cmd.iFirstIndexRange = iFirstIndexRange;
+			cmd.NumIndexRanges = NumIndexRanges;
+		}
+		if (NumVisibleCommands != i)
+			MeshRenderCommands[NumVisibleCommands] = std::move(cmd);
+		++NumVisibleCommands;
+	}
+	MeshRenderCommands.resize(NumVisibleCommands);
+	mMeshletCuller.EndFrame();
+}
+
+void Scene::UpdateSkeletalAnimations(FSceneView& SceneView, ThreadPool& UpdateWorkerThreadPool)
+{
+	SCOPED_CPU_MARKER("Scene::UpdateSkeletalAnimations()");
+	SCOPED_MEMORY_TAG(EMemoryTag::Animation);
+	mAnimationInstances.clear();
+	mAnimationStats = {};
+	mSkinnedVertexOffsets.clear();
+	SceneView.skinningCommands.clear();
+	SceneView.skinningPalettes.clear();
+
+	// gather the skinned objects, grouped by their animation data so each group shares a skeleton
+	struct FAnimatedObject { const FModelAnimationData* pData; size_t iObject; };
+	std::vector<FAnimatedObject> AnimatedObjects;
+	{
+		std::unique_lock<std::mutex> lk(mMtx_Models);
+		for (size_t iObj = 0; iObj < mpObjects.size(); ++iObj)
+		{
+			auto it = mModels.find(mpObjects[iObj]->mModelID);
+			if (it == mModels.end() || !it->second.mbLoaded)
+				continue;
+			const FModelAnimationData* pData = it->second.mData.mpAnimationData.get();
+			if (pData && !pData->Clips.empty())
+				AnimatedObjects.push_back({ pData, iObj });
+		}
+	}
+	if (AnimatedObjects.empty())
+		return;
+	std::stable_sort(AnimatedObjects.begin(), AnimatedObjects.end(), [](const FAnimatedObject& a, const FAnimatedObject& b) { return a.pData < b.pData; });
+
+	// objects cycle through the clips w/ a phase offset so the copies of a model don't play in lockstep
+	size_t NumPaletteMatrices = 0;
+	for (const FAnimatedObject& o : AnimatedObjects)
+	{
+		const FAnimationClip& Clip = o.pData->Clips[o.iObject % o.pData->Clips.size()];
+		SkeletalAnimation::FAnimationInstance Instance;
+		Instance.pClip = &Clip;
+		Instance.Time  = mAnimationTime + Clip.Duration * std::fmod(o.iObject * 0.618f, 1.0f);
+		mAnimationInstances.push_back(Instance);
+		NumPaletteMatrices += o.pData->Skeleton.GetNumBones();
+	}
+	std::vector<XMFLOAT4X4>& Palettes = SceneView.skinningPalettes;
+	Palettes.resize(NumPaletteMatrices);
+
+	size_t iPalette = 0;
+	for (size_t iBegin = 0; iBegin < AnimatedObjects.size(); )
+	{
+		const FModelAnimationData* pData = AnimatedObjects[iBegin].pData;
+		size_t iEnd = iBegin + 1;
+		while (iEnd < AnimatedObjects.size() && AnimatedObjects[iEnd].pData == pData)
+			++iEnd;
+
+		const uint32 NumInstances = static_cast<uint32>(iEnd - iBegin);
+		SkeletalAnimation::FStatistics GroupStats;
+		SkeletalAnimation::EvaluateInstances(pData->Skeleton, &mAnimationInstances[iBegin], NumInstances, &Palettes[iPalette], &UpdateWorkerThreadPool, &GroupStats);
+
+		mAnimationStats.NumInstances     += GroupStats.NumInstances;
+		mAnimationStats.NumBones         += GroupStats.NumBones;
+		mAnimationStats.NumBlendedPoses  += GroupStats.NumBlendedPoses;
+		mAnimationStats.EvaluationTimeMs += GroupStats.EvaluationTimeMs;
+
+		iPalette += NumInstances * pData->Skeleton.GetNumBones();
+		iBegin = iEnd;
+	}
+	mAnimationStats.BonesPerSecond = mAnimationStats.EvaluationTimeMs > 0.0f ? mAnimationStats.NumBones / (mAnimationStats.EvaluationTimeMs * 0.001) : 0.0;
+
+	// every skinned mesh of an animated object gets its own range in the skinned vertex buffer, see SkinningPass
+	uint32 iFirstPaletteMatrix = 0;
+	uint32 NumSkinnedVertices = 0;
+	for (const FAnimatedObject& o : AnimatedObjects)
+	{
+		const GameObject* pObj = mpObjects[o.iObject];
+		const Model& model = mModels.at(pObj->mModelID);
+		for (const MeshID meshID : model.mData.mOpaueMeshIDs)
+		{
+			auto itSkin = o.pData->Skins.find(meshID);
+			if (itSkin == o.pData->Skins.end())
+				continue;
+			const FModelAnimationData::FSkin& Skin = itSkin->second;
+			if (NumSkinnedVertices + Skin.NumVertices > MAX_SKINNED_VERTICES)
 			{
-				// light mesh
-				if (SceneView.sceneParameters.bDrawLightMeshes)
-				{
-					cmd.meshID = EBuiltInMeshes::SPHERE;
-					SceneView.lightRenderCommands.push_back(cmd);
-				}
+				Log::Warning("[Scene] Skinned vertex buffer is full (%u vertices), remaining animated meshes are drawn in bind pose", MAX_SKINNED_VERTICES);
+				return;
+			}
+
+			FSkinningCommand cmd;
+			cmd.meshID = meshID;
+			cmd.VertexBufferID = mMeshes.at(meshID).GetIABufferIDs().first;
+			cmd.SkinWeightsBufferID = Skin.SkinWeightsBufferID;
+			cmd.iFirstPaletteMatrix = iFirstPaletteMatrix;
+			cmd.iFirstSkinnedVertex = NumSkinnedVertices;
+			cmd.NumVertices = Skin.NumVertices;
+			SceneView.skinningCommands.push_back(cmd);
+
+			mSkinnedVertexOffsets[pObj][meshID] = static_cast<int>(NumSkinnedVertices);
+			NumSkinnedVertices += Skin.NumVertices;
+		}
+		iFirstPaletteMatrix += o.pData->Skeleton.GetNumBones();
+	}
+}
+
+int Scene::GetFirstSkinnedVertex(const GameObject* pObj, MeshID meshID) const
+{
+	auto itObj = mSkinnedVertexOffsets.find(pObj);
+	if (itObj == mSkinnedVertexOffsets.end())
+		return INVALID_ID;
+	auto itMesh = itObj->second.find(meshID);
+	return itMesh == itObj->second.end() ? INVALID_ID : itMesh->second;
+}
+
+void Scene::UpdateRayQueryAccelerationStructure()
+{
+	if (!mbRayQueryTopLevelDirty)
+		return;
+	SCOPED_CPU_MARKER("Scene::UpdateRayQueryAccelerationStructure()");
+	SCOPED_MEMORY_TAG(EMemoryTag::RayQueries);
+	mbRayQueryTopLevelDirty = false;
 
-				// light bounds
-				if (SceneView.sceneParameters.bDrawLightBounds)
+	std::vector<FRayQueryInstance> Instances;
+	mRayQueryInstanceMeshes.clear();
+
+	std::unique_lock<std::mutex> lkModels(mMtx_Models);
+	std::unique_lock<std::mutex> lkMeshes(mMtx_Meshes);
+	for (const GameObject* pObj : mpObjects)
+	{
+		auto itModel = mModels.find(pObj->mModelID);
+		if (itModel == mModels.end() || !itModel->second.mbLoaded)
+			continue;
+		const Model::Data& ModelData = itModel->second.mData;
+		const XMMATRIX matObjectWorld = mpTransforms.at(pObj->mTransformID)->matWorldTransformation();
+		for (const std::vector<MeshID>* pMeshIDs : { &ModelData.mOpaueMeshIDs, &ModelData.mTransparentMeshIDs })
+		{
+			for (MeshID meshID : *pMeshIDs)
+			{
+				auto itMesh = mMeshes.find(meshID);
+				if (itMesh == mMeshes.end())
+					continue;
+				const Mesh& mesh = itMesh->second;
+				const std::vector<XMFLOAT3>& Vertices = mesh.GetOccluderVertices();
+				const std::vector<uint32>& Indices = mesh.GetOccluderIndices();
+				if (Vertices.empty() || Indices.empty())
+					continue;
+
+				// bottom level: once per unique geometry, instance meshes share the vertices of their source mesh
+				auto itMeshIndex = mRayQueryMeshIndices.find(Vertices.data());
+				if (itMeshIndex == mRayQueryMeshIndices.end())
 				{
-					Transform tf = l.GetTransform();
-					tf._scale = XMFLOAT3(l.Range, l.Range, l.Range);
-					cmd.matWorldTransformation = tf.matWorldTransformation();
-					cmd.color = l.Color; // drop the brightness multiplier for bounds rendering
-					SceneView.lightBoundsRenderCommands.push_back(cmd);
+					const uint32 MeshIndex = mRayQueryAS.AddMesh(&Vertices[0].x, sizeof(XMFLOAT3), static_cast<uint32>(Vertices.size()), Indices.data(), static_cast<uint32>(Indices.size()));
+					itMeshIndex = mRayQueryMeshIndices.emplace(Vertices.data(), MeshIndex).first;
 				}
-			}  break;
-			} // swicth
-		} // for: Lights
-	};
 
+				FRayQueryInstance Instance;
+				Instance.MeshIndex = itMeshIndex->second;
+				XMStoreFloat4x4(&Instance.matWorld, CalculateMeshWorldTransformation(mesh, matObjectWorld));
+				Instances.push_back(Instance);
+				mRayQueryInstanceMeshes.push_back({ pObj, meshID });
+			}
+		}
+	}
+	lkMeshes.unlock();
+	lkModels.unlock();
+
+	mRayQueryAS.BuildTopLevel(Instances.data(), static_cast<uint32>(Instances.size()));
+}
+
+void Scene::ResolveRayHit(const FRay& Ray, const FRayHit& RayHit, FSceneRayHit& Hit) const
+{
+	Hit = {};
+	if (!RayHit.IsHit())
+		return;
+	Hit.pObject       = mRayQueryInstanceMeshes[RayHit.InstanceIndex].first;
+	Hit.meshID        = mRayQueryInstanceMeshes[RayHit.InstanceIndex].second;
+	Hit.TriangleIndex = RayHit.TriangleIndex;
+	Hit.T             = RayHit.T;
+	Hit.Barycentrics  = XMFLOAT2(RayHit.U, RayHit.V);
+	XMStoreFloat3(&Hit.Position, XMVectorMultiplyAdd(XMLoadFloat3(&Ray.Direction), XMVectorReplicate(RayHit.T), XMLoadFloat3(&Ray.Origin)));
+}
+
+bool Scene::RayCast(const FRay& Ray, FSceneRayHit& Hit)
+{
+	UpdateRayQueryAccelerationStructure();
+	++mNumFrameRayQueries;
+	FRayHit RayHit;
+	mRayQueryAS.Intersect(Ray, RayHit);
+	ResolveRayHit(Ray, RayHit, Hit);
+	return Hit.pObject != nullptr;
+}
+
+void Scene::RayCast(const FRay* pRays, uint32 NumRays, FSceneRayHit* pHits, ThreadPool* pWorkerThreadPool)
+{
+	SCOPED_CPU_MARKER("Scene::RayCast()");
+	SCOPED_MEMORY_TAG(EMemoryTag::RayQueries);
+	UpdateRayQueryAccelerationStructure();
+	mNumFrameRayQueries += NumRays;
+	std::vector<FRayHit> RayHits(NumRays);
+	mRayQueryAS.IntersectBatch(pRays, NumRays, RayHits.data(), pWorkerThreadPool);
+	for (uint32 i = 0; i < NumRays; ++i)
+		ResolveRayHit(pRays[i], RayHits[i], pHits[i]);
+}
 
-	fnGatherLightRenderData(mLightsStatic);
-	fnGatherLightRenderData(mLightsStationary);
-	fnGatherLightRenderData(mLightsDynamic);
+bool Scene::IsVisible(const XMFLOAT3& From, const XMFLOAT3& To)
+{
+	UpdateRayQueryAccelerationStructure();
+	++mNumFrameRayQueries;
+	return !mRayQueryAS.IsOccluded(FRay::FromSegment(From, To));
 }
 
+FRay Scene::CalculateCameraRay(float ScreenU, float ScreenV) const
+{
+	const Camera& Cam = mCameras[mIndex_SelectedCamera];
+	const XMMATRIX matViewProjInverse = XMMatrixInverse(nullptr, Cam.GetViewMatrix() * Cam.GetProjectionMatrix());
+	const XMFLOAT3 CameraPosition = Cam.GetPositionF();
+	const XMVECTOR vCameraPosition = XMLoadFloat3(&CameraPosition);
+
+	// unproject onto the depth range limits & start from the one closer to the camera, works for reversed depth too
+	const float NDCx = 2.0f * ScreenU - 1.0f;
+	const float NDCy = 1.0f - 2.0f * ScreenV;
+	const XMVECTOR p0 = XMVector3TransformCoord(XMVectorSet(NDCx, NDCy, 0.0f, 1.0f), matViewProjInverse);
+	const XMVECTOR p1 = XMVector3TransformCoord(XMVectorSet(NDCx, NDCy, 1.0f, 1.0f), matViewProjInverse);
+	const bool bP0Near = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p0, vCameraPosition))) <= XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p1, vCameraPosition)));
+	const XMVECTOR vNear = bP0Near ? p0 : p1;
+	const XMVECTOR vFar  = bP0Near ? p1 : p0;
+
+	FRay Ray;
+	XMStoreFloat3(&Ray.Origin, vNear);
+	XMStoreFloat3(&Ray.Direction, XMVector3Normalize(XMVectorSubtract(vFar, vNear)));
+	Ray.TMax = XMVectorGetX(XMVector3Length(XMVectorSubtract(vFar, vNear)));
+	return Ray;
+}
 
-void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, std::vector<FMeshRenderCommand>& MeshRenderCommands)
+void Scene::UpdateTextureResidency(const FSceneView& SceneView)
+{
+	SCOPED_CPU_MARKER("Scene::UpdateTextureResidency()");
+	mFrameUsedTextures.clear();
+	std::unique_lock<std::mutex> lk(mMtx_Materials);
+	for (const FMeshRenderCommand& cmd : SceneView.meshRenderCommands)
+	{
+		auto it = mMaterials.find(cmd.matID);
+		if (it == mMaterials.end())
+			continue;
+		const Material& mat = it->second;
+		for (TextureID ID : { mat.TexDiffuseMap, mat.TexNormalMap, mat.TexEmissiveMap, mat.TexHeightMap, mat.TexAlphaMaskMap
+			, mat.TexMetallicMap, mat.TexRoughnessMap, mat.TexOcclusionRoughnessMetalnessMap, mat.TexAmbientOcclusionMap })
+		{
+			if (ID != INVALID_ID)
+				mFrameUsedTextures.push_back(ID);
+		}
+	}
+	std::sort(mFrameUsedTextures.begin(), mFrameUsedTextures.end());
+	mFrameUsedTextures.erase(std::unique(mFrameUsedTextures.begin(), mFrameUsedTextures.end()), mFrameUsedTextures.end());
+	lk.unlock();
+
+	mRenderer.UpdateTextureResidency(mFrameUsedTextures, mFrameRelocatedSRVs);
+	if (mFrameRelocatedSRVs.empty())
+		return;
+	lk.lock();
+	for (auto& it : mMaterials)
+	{
+		Material& mat = it.second;
+		for (const std::pair<SRV_ID, SRV_ID>& Relocated : mFrameRelocatedSRVs)
+		{
+			if (mat.SRVMaterialMaps == Relocated.first)
+				mat.SRVMaterialMaps = Relocated.second;
+		}
+	}
+}
+
+void Scene::GatherOccluders(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, std::vector<FOccluderMesh>& Occluders) const
+{
+	SCOPED_CPU_MARKER("GatherOccluders");
+	const SceneBoundingBoxHierarchy& BBH = mBoundingBoxHierarchy;
+
+	// candidates: visible opaque meshes w/o alpha masking, scene-flagged occluders first, then by bounding box volume
+	struct FOccluderCandidate { bool bFlagged; float Volume; size_t BBIndex; };
+	std::vector<FOccluderCandidate> Candidates;
+	for (size_t BBIndex = 0; BBIndex < BBH.mMeshBoundingBoxes.size(); ++BBIndex)
+	{
+		const MeshID meshID = BBH.mMeshBoundingBoxMeshIDMapping[BBIndex];
+		const GameObject* pObj = BBH.mMeshBoundingBoxGameObjectPointerMapping[BBIndex];
+		const Model& model = mModels.at(pObj->mModelID);
+
+		auto itMat = model.mData.mOpaqueMaterials.find(meshID);
+		if (itMat == model.mData.mOpaqueMaterials.end())
+			continue; // transparent
+		const Material& mat = mMaterials.at(itMat->second);
+		if (mat.IsTransparent() || mat.TexAlphaMaskMap != INVALID_ID)
+			continue;
+		if (mMeshes.at(meshID).GetOccluderIndices().empty())
+			continue;
+
+		const FBoundingBox& BB = BBH.mMeshBoundingBoxes[BBIndex];
+		if (!IsBoundingBoxIntersectingFrustum(MainViewFrustumPlanesInWorldSpace, BB))
+			continue;
+
+		const float Volume = (BB.ExtentMax.x - BB.ExtentMin.x) * (BB.ExtentMax.y - BB.ExtentMin.y) * (BB.ExtentMax.z - BB.ExtentMin.z);
+		Candidates.push_back({ pObj->mbOccluder, Volume, BBIndex });
+	}
+	std::sort(Candidates.begin(), Candidates.end(), [](const FOccluderCandidate& l, const FOccluderCandidate& r)
+	{
+		if (l.bFlagged != r.bFlagged) return l.bFlagged;
+		if (l.Volume   != r.Volume  ) return l.Volume > r.Volume;
+		return l.BBIndex < r.BBIndex;
+	});
+
+	Occluders.clear();
+	size_t NumTriangles = 0;
+	for (const FOccluderCandidate& Candidate : Candidates)
+	{
+		if (Occluders.size() == OCCLUSION_CULLING_MAX_OCCLUDERS)
+			break;
+
+		const size_t BBIndex = Candidate.BBIndex;
+		const Mesh& mesh = mMeshes.at(BBH.mMeshBoundingBoxMeshIDMapping[BBIndex]);
+		const size_t NumMeshTriangles = mesh.GetOccluderIndices().size() / 3;
+		if (NumTriangles + NumMeshTriangles > OCCLUSION_CULLING_MAX_OCCLUDER_TRIANGLES)
+			continue; // try the smaller ones
+
+		const GameObject* pObj = BBH.mMeshBoundingBoxGameObjectPointerMapping[BBIndex];
+		FOccluderMesh Occluder;
+		Occluder.pVertices  = mesh.GetOccluderVertices().data();
+		Occluder.pIndices   = mesh.GetOccluderIndices().data();
+		Occluder.NumIndices = static_cast<uint32>(mesh.GetOccluderIndices().size());
+		Occluder.matWorld   = CalculateMeshWorldTransformation(mesh, mpTransforms.at(pObj->mTransformID)->matWorldTransformation());
+		Occluders.push_back(Occluder);
+		NumTriangles += NumMeshTriangles;
+	}
+}
+
+void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, const XMMATRIX& MainViewProj, bool bOcclusionCulling, std::vector<FMeshRenderCommand>& MeshRenderCommands)
 {
 	SCOPED_CPU_MARKER("Scene::PrepareSceneMeshRenderParams()");
+	SCOPED_MEMORY_TAG(EMemoryTag::RenderCommands);
 
 #if ENABLE_VIEW_FRUSTUM_CULLING
 
+#if ENABLE_OCCLUSION_CULLING
+	if (bOcclusionCulling)
+	{
+		GatherOccluders(MainViewFrustumPlanesInWorldSpace, mOccluders);
+
+		SCOPED_CPU_MARKER("RasterizeOccluders");
+		mOcclusionCuller.BeginFrame(MainViewProj);
+		for (const FOccluderMesh& Occluder : mOccluders)
+			mOcclusionCuller.RasterizeOccluder(Occluder);
+		mOcclusionCuller.EndFrame();
+	}
+#else
+	bOcclusionCulling = false;
+#endif
+
 	FFrustumCullWorkerContext GameObjectFrustumCullWorkerContext;
 	
 	GameObjectFrustumCullWorkerContext.AddWorkerItem(MainViewFrustumPlanesInWorldSpace
@@ -661,6 +1215,7 @@ void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustum
 	MeshFrustumCullWorkerContext.AddWorkerItem(MainViewFrustumPlanesInWorldSpace
 		, mBoundingBoxHierarchy.mMeshBoundingBoxes
 		, mBoundingBoxHierarchy.mMeshBoundingBoxGameObjectPointerMapping
+		, bOcclusionCulling ? &mOcclusionCuller : nullptr
 	);
 
 	constexpr bool SINGLE_THREADED_CULL = true; // !UPDATE_THREAD__ENABLE_WORKERS;
@@ -715,12 +1270,14 @@ void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustum
 			mTransformWorldMatrixHistory[pTF] = matWorld;
 
 			// record ShadowMeshRenderCommand
+			const Mesh& mesh = mMeshes.at(meshID);
 			FMeshRenderCommand meshRenderCmd;
 			meshRenderCmd.meshID = meshID;
-			meshRenderCmd.matWorldTransformation = matWorld;
+			meshRenderCmd.matWorldTransformation = CalculateMeshWorldTransformation(mesh, matWorld);
 			meshRenderCmd.matNormalTransformation = pTF->NormalMatrix(meshRenderCmd.matWorldTransformation);
 			meshRenderCmd.matID = model.mData.mOpaqueMaterials.at(meshID);
-			meshRenderCmd.matWorldTransformationPrev = matWorldHistory;
+			meshRenderCmd.matWorldTransformationPrev = CalculateMeshWorldTransformation(mesh, matWorldHistory);
+			meshRenderCmd.iFirstSkinnedVertex = GetFirstSkinnedVertex(pGameObject, meshID);
 			MeshRenderCommands.push_back(meshRenderCmd);
 		}
 	}
@@ -746,9 +1303,10 @@ void Scene::PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustum
 		{
 			FMeshRenderCommand meshRenderCmd;
 			meshRenderCmd.meshID = id;
-			meshRenderCmd.matWorldTransformation = pTF->matWorldTransformation();
+			meshRenderCmd.matWorldTransformation = CalculateMeshWorldTransformation(mMeshes.at(id), pTF->matWorldTransformation());
 			meshRenderCmd.matNormalTransformation = pTF->NormalMatrix(meshRenderCmd.matWorldTransformation);
 			meshRenderCmd.matID = model.mData.mOpaqueMaterials.at(id);
+			meshRenderCmd.iFirstSkinnedVertex = GetFirstSkinnedVertex(pObj, id);
 
 			meshRenderCmd.ModelName = model.mModelName;
 			meshRenderCmd.MaterialName = ""; // TODO
@@ -784,6 +1342,7 @@ void Scene::GatherSpotLightFrustumParameters(
 void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, ThreadPool& UpdateWorkerThreadPool) const
 {
 	SCOPED_CPU_MARKER("Scene::PrepareShadowMeshRenderParams()");
+	SCOPED_MEMORY_TAG(EMemoryTag::RenderCommands);
 #if ENABLE_VIEW_FRUSTUM_CULLING
 	constexpr bool bCULL_LIGHT_VIEWS     = false;
 	constexpr bool bSINGLE_THREADED_CULL = !UPDATE_THREAD__ENABLE_WORKERS;
@@ -799,8 +1358,7 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 	int iPoint = 0;
 	int iSpot = 0;
 	auto fnGatherShadowingLightFrustumCullParameters = [&](
-		const std::vector<Light>& vLights
-		, const std::vector<size_t>& vActiveLightIndices
+		const std::vector<uint32>& vActiveLightIndices
 		, FFrustumCullWorkerContext& DispatchContext
 		, const std::vector<FBoundingBox>& BoundingBoxList
 		, const std::vector<const GameObject*>& pGameObjects
@@ -809,22 +1367,26 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 	{
 		SCOPED_CPU_MARKER("GatherLightFrustumCullParams");
 		// prepare frustum cull work context
-		for(const size_t& LightIndex : vActiveLightIndices)
+		for(const uint32& LightIndex : vActiveLightIndices)
 		{
-			const Light& l = vLights[LightIndex];
-			const bool bIsLastLight = LightIndex == vActiveLightIndices.back();
+			const Light l = mLights.GetLightAt(LightIndex);
 
 			switch (l.Type)
 			{
 			case Light::EType::DIRECTIONAL:
 			{
-				FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowView_Directional;
-				ShadowView.matViewProj = l.GetViewProjectionMatrix();
-				const size_t FrustumIndex = DispatchContext.AddWorkerItem(FFrustumPlaneset::ExtractFromMatrix(ShadowView.matViewProj), BoundingBoxList, pGameObjects);
-				FrustumIndex_pShadowViewLookup[FrustumIndex] = &ShadowView;
+				// cascades are fit in FitDirectionalShadowCascades(), their near planes are extruded toward the light
+				for (uint iCascade = 0; iCascade < SceneShadowView.NumDirectionalCascades; ++iCascade)
+				{
+					FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Directional[iCascade];
+					const size_t FrustumIndex = DispatchContext.AddWorkerItem(FFrustumPlaneset::ExtractFromMatrix(ShadowView.matViewProj), BoundingBoxList, pGameObjects);
+					FrustumIndex_pShadowViewLookup[FrustumIndex] = &ShadowView;
+				}
 			}	break;
 			case Light::EType::SPOT:
 			{
+				if (iSpot == NUM_SHADOWING_LIGHTS__SPOT)
+					break; // shaded as a non-shadowing light, see LightContainer::ExportGPUData()
 				XMMATRIX matViewProj = l.GetViewProjectionMatrix();
 				const size_t FrustumIndex = DispatchContext.AddWorkerItem(FFrustumPlaneset::ExtractFromMatrix(matViewProj), BoundingBoxList, pGameObjects);
 
@@ -836,6 +1398,8 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 			} break;
 			case Light::EType::POINT:
 			{
+				if (iPoint == NUM_SHADOWING_LIGHTS__POINT)
+					break;
 				for (int face = 0; face < 6; ++face)
 				{
 					XMMATRIX matViewProj = l.GetViewProjectionMatrix(static_cast<Texture::CubemapUtility::ECubeMapLookDirections>(face));
@@ -858,10 +1422,20 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 	static const size_t HW_CORE_COUNT = ThreadPool::sHardwareThreadCount / 2;
 	const size_t NumThreadsIncludingThisThread = HW_CORE_COUNT - 1; // -1 to leave RenderThread a physical core
 
-	// distance-cull and get active shadowing lights from various light containers
-	const std::vector<size_t> vActiveLightIndices_Static     = GetActiveAndCulledLightIndices(mLightsStatic, MainViewFrustumPlanesInWorldSpace);
-	const std::vector<size_t> vActiveLightIndices_Stationary = GetActiveAndCulledLightIndices(mLightsStationary, MainViewFrustumPlanesInWorldSpace);
-	const std::vector<size_t> vActiveLightIndices_Dynamic    = GetActiveAndCulledLightIndices(mLightsDynamic, MainViewFrustumPlanesInWorldSpace);
+	// distance-cull and get active shadowing lights
+	std::vector<uint32> vActiveLightIndices;
+	{
+		SCOPED_CPU_MARKER("GatherVisibleLights");
+		constexpr uint8 ShadowingLightFlags = LightContainer::ENABLED | LightContainer::CASTING_SHADOWS;
+#if ENABLE_LIGHT_CULLING
+		mLights.GatherVisibleLights(MainViewFrustumPlanesInWorldSpace, ShadowingLightFlags, vActiveLightIndices);
+#else
+		const LightContainer::FHotData& Lights = mLights.GetHotData();
+		for (uint32 i = 0; i < mLights.GetNumLights(); ++i)
+			if ((Lights.Flags[i] & ShadowingLightFlags) == ShadowingLightFlags)
+				vActiveLightIndices.push_back(i);
+#endif
+	}
 	
 	// frustum cull memory containers
 	std::unordered_map<size_t, FSceneShadowView::FShadowView*> FrustumIndex_pShadowViewLookup;
@@ -874,9 +1448,7 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 	//
 	// Coarse Culling : cull the game object bounding boxes against view frustums
 	//
-	fnGatherShadowingLightFrustumCullParameters(mLightsStatic    , vActiveLightIndices_Static    , GameObjectFrustumCullWorkerContext, mBoundingBoxHierarchy.mGameObjectBoundingBoxes, mBoundingBoxHierarchy.mGameObjectBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
-	fnGatherShadowingLightFrustumCullParameters(mLightsStationary, vActiveLightIndices_Stationary, GameObjectFrustumCullWorkerContext, mBoundingBoxHierarchy.mGameObjectBoundingBoxes, mBoundingBoxHierarchy.mGameObjectBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
-	fnGatherShadowingLightFrustumCullParameters(mLightsDynamic   , vActiveLightIndices_Dynamic   , GameObjectFrustumCullWorkerContext, mBoundingBoxHierarchy.mGameObjectBoundingBoxes, mBoundingBoxHierarchy.mGameObjectBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
+	fnGatherShadowingLightFrustumCullParameters(vActiveLightIndices, GameObjectFrustumCullWorkerContext, mBoundingBoxHierarchy.mGameObjectBoundingBoxes, mBoundingBoxHierarchy.mGameObjectBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
 	if constexpr (bSINGLE_THREADED_CULL) GameObjectFrustumCullWorkerContext.ProcessWorkItems_SingleThreaded();
 	else                                 GameObjectFrustumCullWorkerContext.ProcessWorkItems_MultiThreaded(NumThreadsIncludingThisThread, UpdateWorkerThreadPool);
 	//------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -902,9 +1474,7 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 #if ENABLE_THREADED_SHADOW_FRUSTUM_GATHER
 
 #else
-	fnGatherShadowingLightFrustumCullParameters(mLightsStatic    , vActiveLightIndices_Static    , MeshFrustumCullWorkerContext, mBoundingBoxHierarchy.mMeshBoundingBoxes, mBoundingBoxHierarchy.mMeshBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
-	fnGatherShadowingLightFrustumCullParameters(mLightsStationary, vActiveLightIndices_Stationary, MeshFrustumCullWorkerContext, mBoundingBoxHierarchy.mMeshBoundingBoxes, mBoundingBoxHierarchy.mMeshBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
-	fnGatherShadowingLightFrustumCullParameters(mLightsDynamic   , vActiveLightIndices_Dynamic   , MeshFrustumCullWorkerContext, mBoundingBoxHierarchy.mMeshBoundingBoxes, mBoundingBoxHierarchy.mMeshBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
+	fnGatherShadowingLightFrustumCullParameters(vActiveLightIndices, MeshFrustumCullWorkerContext, mBoundingBoxHierarchy.mMeshBoundingBoxes, mBoundingBoxHierarchy.mMeshBoundingBoxGameObjectPointerMapping, FrustumIndex_pShadowViewLookup);
 #endif
 	{
 		SCOPED_CPU_MARKER("Cull Frustums");
@@ -938,8 +1508,10 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 				// record ShadowMeshRenderCommand
 				FShadowMeshRenderCommand meshRenderCmd;
 				meshRenderCmd.meshID = meshID;
-				meshRenderCmd.matWorldTransformation = pTF->matWorldTransformation();
+				meshRenderCmd.transformID = pGameObject->mTransformID;
+				meshRenderCmd.matWorldTransformation = CalculateMeshWorldTransformation(mMeshes.at(meshID), pTF->matWorldTransformation());
 				meshRenderCmd.matWorldViewProj = meshRenderCmd.matWorldTransformation * pShadowView->matViewProj;
+				meshRenderCmd.iFirstSkinnedVertex = GetFirstSkinnedVertex(pGameObject, meshID);
 				vMeshRenderList.push_back(meshRenderCmd);
 			}
 		}
@@ -970,53 +1542,54 @@ void Scene::PrepareShadowMeshRenderParams(FSceneShadowView& SceneShadowView, con
 			{
 				FShadowMeshRenderCommand meshRenderCmd;
 				meshRenderCmd.meshID = id;
-				meshRenderCmd.matWorldTransformation = pTF->matWorldTransformation();
+				meshRenderCmd.transformID = pObj->mTransformID;
+				meshRenderCmd.matWorldTransformation = CalculateMeshWorldTransformation(mMeshes.at(id), pTF->matWorldTransformation());
+				meshRenderCmd.iFirstSkinnedVertex = GetFirstSkinnedVertex(pObj, id);
 				vMeshRenderList.push_back(meshRenderCmd);
 			}
 		}
 	};
-	auto fnGatherShadowingLightData = [&](const std::vector<Light>& vLights)
+	const LightContainer::FHotData& Lights = mLights.GetHotData();
+	for (uint32 i = 0; i < mLights.GetNumLights(); ++i)
 	{
-		for (const Light& l : vLights)
-		{
-			if (!l.bEnabled || !l.bCastingShadows)
-				continue;
+		constexpr uint8 ShadowingLightFlags = LightContainer::ENABLED | LightContainer::CASTING_SHADOWS;
+		if ((Lights.Flags[i] & ShadowingLightFlags) != ShadowingLightFlags)
+			continue;
 
-			switch (l.Type)
-			{
-			case Light::EType::DIRECTIONAL:
-			{
-				FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowView_Directional;
-				ShadowView.matViewProj = l.GetViewProjectionMatrix();
-				fnGatherMeshRenderParamsForLight(l, ShadowView);
-			}	break;
-			case Light::EType::SPOT:
+		const Light l = mLights.GetLightAt(i);
+
+		switch (l.Type)
+		{
+		case Light::EType::DIRECTIONAL:
+		{
+			for (uint iCascade = 0; iCascade < SceneShadowView.NumDirectionalCascades; ++iCascade)
+				fnGatherMeshRenderParamsForLight(l, SceneShadowView.ShadowViews_Directional[iCascade]);
+		}	break;
+		case Light::EType::SPOT:
+		{
+			if (iSpot == NUM_SHADOWING_LIGHTS__SPOT)
+				break;
+			FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Spot[iSpot++];
+			ShadowView.matViewProj = l.GetViewProjectionMatrix();
+			fnGatherMeshRenderParamsForLight(l, ShadowView);
+		} break;
+		case Light::EType::POINT:
+		{
+			if (iPoint == NUM_SHADOWING_LIGHTS__POINT)
+				break;
+			for (int face = 0; face < 6; ++face)
 			{
-				FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Spot[iSpot++];
-				ShadowView.matViewProj = l.GetViewProjectionMatrix();
+				FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Point[(size_t)iPoint * 6 + face];
+				ShadowView.matViewProj = l.GetViewProjectionMatrix(static_cast<Texture::CubemapUtility::ECubeMapLookDirections>(face));
 				fnGatherMeshRenderParamsForLight(l, ShadowView);
-			} break;
-			case Light::EType::POINT:
-			{
-
-				for (int face = 0; face < 6; ++face)
-				{
-					FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Point[(size_t)iPoint * 6 + face];
-					ShadowView.matViewProj = l.GetViewProjectionMatrix(static_cast<Texture::CubemapUtility::ECubeMapLookDirections>(face));
-					fnGatherMeshRenderParamsForLight(l, ShadowView);
-				}
-
-				SceneShadowView.PointLightLinearDepthParams[iPoint].fFarPlane = l.Range;
-				SceneShadowView.PointLightLinearDepthParams[iPoint].vWorldPos = l.Position;
-				++iPoint;
-			} break;
 			}
-		}
-	};
 
-	fnGatherShadowingLightData(mLightsStatic);
-	fnGatherShadowingLightData(mLightsStationary);
-	fnGatherShadowingLightData(mLightsDynamic);
+			SceneShadowView.PointLightLinearDepthParams[iPoint].fFarPlane = l.Range;
+			SceneShadowView.PointLightLinearDepthParams[iPoint].vWorldPos = l.Position;
+			++iPoint;
+		} break;
+		}
+	}
 	SceneShadowView.NumPointShadowViews = iPoint;
 	SceneShadowView.NumSpotShadowViews = iSpot;
 #endif // ENABLE_VIEW_FRUSTUM_CULLING
@@ -22,16 +22,26 @@
 #include "Material.h"
 #include "Model.h"
 #include "Light.h"
+#include "LightContainer.h"
 #include "Transform.h"
 #include "GameObject.h"
 #include "Serialization.h"
+#include "SceneSnapshot.h"
+#include "../Core/Input.h"
 #include "../Core/Memory.h"
 #include "../Core/RenderCommands.h"
 #include "../AssetLoader.h"
+#include "../OcclusionCulling.h"
+#include "../ClusteredLighting.h"
+#include "../ShadowCache.h"
+#include "../CascadedShadowMaps.h"
+#include "../InstanceBatching.h"
+#include "../Meshlets.h"
+#include "../SkeletalAnimation.h"
+#include "../RayQueries.h"
 #include "../PostProcess/PostProcess.h"
 
 // fwd decl
-class Input;
 struct Material;
 struct FResourceNames;
 struct FFrustumPlaneset;
@@ -43,6 +53,26 @@ using ModelLookup_t    = std::unordered_map<ModelID, Model>;
 using MaterialLookup_t = std::unordered_map<MaterialID, Material>;
 
 
+//
+// SCENE INPUT ACTIONS
+//
+// Hotkeys shared by the scenes, registered once to the engine's input action map
+struct FSceneInputActions
+{
+	ActionID NextCamera;
+	ActionID PreviousCamera;
+	ActionID DumpCameraInfo;
+	ActionID ToggleLightBounds;
+	ActionID ToggleMeshBoundingBoxes;
+	ActionID ToggleGameObjectBoundingBoxes;
+	ActionID NextEnvironmentMap;
+	ActionID PreviousEnvironmentMap;
+	ActionID ToggleAnimation;
+	ActionID ResetCamera;
+	ActionID LookAtOrigin;
+};
+
+
 //--- Pass Parameters ---
 struct FPostProcessParameters;
 struct FSceneRenderParameters
@@ -64,6 +94,13 @@ struct FSceneRenderParameters
 	bool bDrawMeshBoundingBoxes = false;
 	bool bDrawGameObjectBoundingBoxes = false;
 	bool bDrawLightMeshes = true;
+	bool bOcclusionCulling = true;
+	bool bCacheShadowMaps = true;
+	float fDirectionalShadowDistance = 500.0f;
+	float fCascadeSplitLambda = 0.8f;
+	bool bInstancedDraws = true;
+	int iMaxInstancesPerBatch = MAX_INSTANCE_COUNT__SCENE_MESHES;
+	bool bMeshletCulling = true; // non-instanced draws only
 	float fYawSliderValue = 0.0f;
 	float fAmbientLightingFactor = 0.055f;
 	bool bScreenSpaceAO = true;
@@ -93,11 +130,19 @@ struct FSceneView
 	//EnvironmentMap	environmentMap;
 
 	VQ_SHADER_DATA::SceneLighting GPULightingData;
+	std::vector<VQ_SHADER_DATA::PointLight> GPUPointLights; // non-shadowing, indexed by LightClusterGrid
+	std::vector<VQ_SHADER_DATA::SpotLight>  GPUSpotLights;  // non-shadowing, indexed by LightClusterGrid
+	FLightClusterGrid LightClusterGrid;
 
 	FSceneRenderParameters sceneParameters;
 	FPostProcessParameters postProcessParameters;
 
 	std::vector<FMeshRenderCommand>  meshRenderCommands;
+	std::vector<FInstancedMeshRenderCommand> instancedMeshRenderCommands; // meshRenderCommands batched when sceneParameters.bInstancedDraws
+	std::vector<FMeshInstanceData>           meshInstanceData;            // indexed by instancedMeshRenderCommands
+	std::vector<FIndexRange>                 meshIndexRanges;             // visible meshlets of meshRenderCommands when sceneParameters.bMeshletCulling
+	std::vector<FSkinningCommand>            skinningCommands;            // animated meshes, skinned before the depth prepass
+	std::vector<DirectX::XMFLOAT4X4>         skinningPalettes;            // indexed by skinningCommands
 	std::vector<FLightRenderCommand> lightRenderCommands;
 	std::vector<FLightRenderCommand> lightBoundsRenderCommands;
 	std::vector<FBoundingBoxRenderCommand> boundingBoxRenderCommands;
@@ -108,7 +153,9 @@ struct FSceneShadowView
 	struct FShadowView
 	{
 		DirectX::XMMATRIX matViewProj;
-		std::vector<FShadowMeshRenderCommand> meshRenderCommands;
+		std::vector<FShadowMeshRenderCommand> meshRenderCommands; // static casters first
+		uint NumStaticMeshRenderCommands = 0;
+		ShadowCache::EViewUpdate CacheUpdate = ShadowCache::EViewUpdate::REDRAW_ALL;
 	};
 	struct FPointLightLinearDepthParams
 	{
@@ -119,10 +166,22 @@ struct FSceneShadowView
 	std::array<FShadowView, NUM_SHADOWING_LIGHTS__SPOT>                   ShadowViews_Spot;
 	std::array<FShadowView, NUM_SHADOWING_LIGHTS__POINT * 6>              ShadowViews_Point;
 	std::array<FPointLightLinearDepthParams, NUM_SHADOWING_LIGHTS__POINT> PointLightLinearDepthParams;
-	FShadowView ShadowView_Directional;
+	std::array<FShadowView, NUM_SHADOW_CASCADES__DIRECTIONAL>            ShadowViews_Directional;
+	std::array<FShadowCascade, NUM_SHADOW_CASCADES__DIRECTIONAL>         DirectionalCascades;
 
 	uint NumSpotShadowViews;
 	uint NumPointShadowViews;
+	uint NumDirectionalCascades;
+};
+
+struct FSceneRayHit
+{
+	const GameObject* pObject       = nullptr; // nullptr if nothing was hit
+	MeshID            meshID        = INVALID_ID;
+	uint32            TriangleIndex = FRayHit::INVALID_INDEX; // in the LOD0 index buffer of the mesh
+	float             T             = FLT_MAX;
+	DirectX::XMFLOAT3 Position      = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	DirectX::XMFLOAT2 Barycentrics  = DirectX::XMFLOAT2(0.0f, 0.0f); // of the 2nd & 3rd vertices
 };
 
 struct FSceneStats
@@ -145,6 +204,52 @@ struct FSceneStats
 	uint NumShadowMeshRenderCommands;
 	uint NumBoundingBoxRenderCommands;
 
+	// occlusion culling ------------
+	uint  NumOccluders;
+	uint  NumOccluderTriangles;
+	uint  NumOcclusionTestedMeshes;
+	uint  NumOccludedMeshes;
+	float OcclusionRasterizationTimeMs;
+
+	// clustered lighting -----------
+	uint  NumLightClusters;
+	uint  NumOccupiedLightClusters;
+	uint  NumLightClusterIndices;
+	uint  MaxLightsPerCluster;
+	float LightBinningTimeMs;
+
+	// instancing -------------------
+	uint  NumInstancedDrawBatches;
+	uint  NumDrawBatches;
+	float InstanceBatchingTimeMs;
+
+	// meshlet culling --------------
+	uint  NumTestedMeshlets;
+	uint  NumFrustumCulledMeshlets;
+	uint  NumBackfaceCulledMeshlets;
+	uint  NumMeshletCulledMeshes;
+	uint  NumMeshletIndexRanges;
+	uint  NumMeshletTestedTriangles;
+	uint  NumMeshletVisibleTriangles;
+	float MeshletCullingTimeMs;
+
+	// skeletal animation -----------
+	uint  NumAnimatedInstances;
+	uint  NumAnimatedBones;
+	float AnimationEvaluationTimeMs;
+
+	// ray queries ------------------
+	uint  NumRayQueryMeshes;
+	uint  NumRayQueryTriangles;
+	uint  NumRayQueryInstances;
+	uint  NumRayQueries;
+	float RayQueryBuildTimeMs;
+
+	// shadow cache -----------------
+	uint NumCachedShadowViews;
+	uint NumDynamicRedrawnShadowViews;
+	uint NumFullyRedrawnShadowViews;
+
 	// scene ------------------------
 	uint NumMeshes;
 	uint NumModels;
@@ -258,17 +363,31 @@ protected:
 private: // Derived Scenes shouldn't access these functions
 	void PreUpdate(int FRAME_DATA_INDEX, int FRAME_DATA_PREV_INDEX);
 	void Update(float dt, int FRAME_DATA_INDEX = 0);
+	void UpdateModelStreaming();
 	void PostUpdate(ThreadPool& UpdateWorkerThreadPool, int FRAME_DATA_INDEX = 0);
 	void StartLoading(const BuiltinMeshArray_t& builtinMeshes, FSceneRepresentation& scene);
 	void OnLoadComplete();
 	void Unload(); // serial-only for now. maybe MT later.
+	void CaptureSnapshot(FSceneSnapshot& Snapshot) const;
+	void RestoreSnapshot(const FSceneSnapshot& Snapshot);
 	void RenderUI(FUIState& UIState, uint32_t W, uint32_t H);
 	void HandleInput(FSceneView& SceneView);
 
 	void GatherSceneLightData(FSceneView& SceneView) const;
+	void FitDirectionalShadowCascades(FSceneView& SceneView, FSceneShadowView& ShadowView) const;
+	void BinSceneLights(FSceneView& SceneView);
+	void UpdateShadowCache(FSceneShadowView& ShadowView, bool bCacheShadowMaps);
 
 	void PrepareLightMeshRenderParams(FSceneView& SceneView) const;
-	void PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, std::vector<FMeshRenderCommand>& MeshRenderCommands);
+	void PrepareSceneMeshRenderParams(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, const DirectX::XMMATRIX& MainViewProj, bool bOcclusionCulling, std::vector<FMeshRenderCommand>& MeshRenderCommands);
+	void BatchSceneMeshRenderCommands(FSceneView& SceneView);
+	void CullSceneMeshlets(FSceneView& SceneView);
+	void UpdateTextureResidency(const FSceneView& SceneView);
+	void UpdateSkeletalAnimations(FSceneView& SceneView, ThreadPool& UpdateWorkerThreadPool);
+	int  GetFirstSkinnedVertex(const GameObject* pObj, MeshID meshID) const; // INVALID_ID if the mesh isn't skinned this frame
+	void UpdateRayQueryAccelerationStructure();
+	void ResolveRayHit(const FRay& Ray, const FRayHit& RayHit, FSceneRayHit& Hit) const;
+	void GatherOccluders(const FFrustumPlaneset& MainViewFrustumPlanesInWorldSpace, std::vector<FOccluderMesh>& Occluders) const;
 	void PrepareShadowMeshRenderParams(FSceneShadowView& ShadowView, const FFrustumPlaneset& ViewFrustumPlanesInWorldSpace, ThreadPool& UpdateWorkerThreadPool) const;
 	void PrepareBoundingBoxRenderParams(FSceneView& SceneView) const;
 	
@@ -286,6 +405,7 @@ private: // Derived Scenes shouldn't access these functions
 	void LoadPostProcessSettings();
 
 	void CalculateGameObjectLocalSpaceBoundingBoxes();
+	void CalculateGameObjectLocalSpaceBoundingBox(GameObject* pGameObj);
 public:
 	Scene(VQEngine& engine
 		, int NumFrameBuffers
@@ -320,6 +440,13 @@ public:
 	Model&     GetModel(ModelID);
 	FSceneStats GetSceneRenderStats(int FRAME_DATA_INDEX) const;
 
+	// Ray & segment queries against the LOD0 triangles of the scene meshes, on the update thread.
+	// The acceleration structure is updated by the first query of the frame.
+	bool RayCast(const FRay& Ray, FSceneRayHit& Hit);
+	void RayCast(const FRay* pRays, uint32 NumRays, FSceneRayHit* pHits, ThreadPool* pWorkerThreadPool = nullptr);
+	bool IsVisible(const DirectX::XMFLOAT3& From, const DirectX::XMFLOAT3& To);
+	FRay CalculateCameraRay(float ScreenU, float ScreenV) const; // [0, 1] on the active camera's viewport, (0, 0) : top left
+
 //----------------------------------------------------------------------------------------------------------------
 // SCENE DATA
 //----------------------------------------------------------------------------------------------------------------
@@ -343,9 +470,7 @@ protected:
 	
 	Light                    mDirectionalLight;
 
-	std::vector<Light>       mLightsStatic;      //     static lights (See Light::EMobility enum for details)
-	std::vector<Light>       mLightsStationary;  // stationary lights (See Light::EMobility enum for details)
-	std::vector<Light>       mLightsDynamic;     //     moving lights (See Light::EMobility enum for details)
+	LightContainer           mLights;            // static, stationary & moving lights (See Light::EMobility enum for details)
 	//Skybox                   mSkybox;
 
 	//
@@ -359,6 +484,36 @@ protected:
 	// CULLING DATA
 	//
 	SceneBoundingBoxHierarchy mBoundingBoxHierarchy;
+	OcclusionCuller           mOcclusionCuller;
+	std::vector<FOccluderMesh> mOccluders;
+	MeshInstanceBatcher       mInstanceBatcher;
+	MeshletCuller             mMeshletCuller;
+	std::vector<TextureID>    mFrameUsedTextures; // textures of the visible materials, see UpdateTextureResidency()
+	std::vector<std::pair<SRV_ID, SRV_ID>> mFrameRelocatedSRVs; // material tables rewritten w/ the reallocated textures
+
+	//
+	// RAY QUERY DATA
+	//
+	RayQueryAccelerationStructure                            mRayQueryAS;
+	std::unordered_map<const DirectX::XMFLOAT3*, uint32>     mRayQueryMeshIndices;    // CPU-side vertices -> AS mesh, shared by the instance meshes
+	std::vector<std::pair<const GameObject*, MeshID>>        mRayQueryInstanceMeshes; // AS instance -> object & mesh
+	bool                                                     mbRayQueryTopLevelDirty = true;
+	uint32                                                   mNumFrameRayQueries = 0;
+	uint32                                                   mNumRayQueries = 0; // last frame
+
+	//
+	// ANIMATION DATA
+	//
+	float                                           mAnimationTime = 0.0f;
+	std::vector<SkeletalAnimation::FAnimationInstance> mAnimationInstances;
+	std::unordered_map<const GameObject*, std::unordered_map<MeshID, int>> mSkinnedVertexOffsets; // this frame's iFirstSkinnedVertex of the animated meshes
+	SkeletalAnimation::FStatistics                  mAnimationStats;
+
+	//
+	// LIGHTING DATA
+	//
+	LightClusterBinner        mLightClusterBinner;
+	ShadowCache               mShadowCache;
 
 	//
 	// MATERIAL DATA
@@ -379,6 +534,7 @@ public:
 
 protected:
 	const Input&                   mInput;
+	const FSceneInputActions&      mInputActions;
 	const std::unique_ptr<Window>& mpWindow;
 	VQEngine&                      mEngine;
 	const FResourceNames&          mResourceNames;
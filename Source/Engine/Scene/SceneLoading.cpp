@@ -24,6 +24,7 @@
 
 #include "Libs/VQUtils/Source/utils.h"
 
+#include <algorithm>
 #include <fstream>
 
 #define LOG_CACHED_RESOURCES_ON_LOAD 0
@@ -78,6 +79,7 @@ MaterialID Scene::LoadMaterial(const FMaterialRepresentation& matRep, TaskID tas
 
 void Scene::StartLoading(const BuiltinMeshArray_t& builtinMeshes, FSceneRepresentation& sceneRep)
 {
+	SCOPED_MEMORY_TAG(EMemoryTag::SceneLoading);
 	mRenderer.WaitForLoadCompletion();
 
 	Log::Info("[Scene] Loading Scene: %s", sceneRep.SceneName.c_str());
@@ -168,6 +170,8 @@ void Scene::LoadBuiltinMeshes(const BuiltinMeshArray_t& builtinMeshes)
 void Scene::LoadGameObjects(std::vector<FGameObjectRepresentation>&& GameObjects)
 {
 	constexpr bool B_LOAD_GAMEOBJECTS_SERIAL = true;
+	const bool bStreamModels = mAssetLoader.IsModelStreamingEnabled();
+	ModelID PlaceholderModelID = INVALID_ID;
 
 	if constexpr (B_LOAD_GAMEOBJECTS_SERIAL)
 	{
@@ -177,6 +181,7 @@ void Scene::LoadGameObjects(std::vector<FGameObjectRepresentation>&& GameObjects
 			GameObject* pObj = mGameObjectPool.Allocate(1);
 			pObj->mModelID = INVALID_ID;
 			pObj->mTransformID = INVALID_ID;
+			pObj->mbOccluder = ObjRep.bOccluder;
 
 			// Transform
 			Transform* pTransform = mTransformPool.Allocate(1);
@@ -215,6 +220,19 @@ void Scene::LoadGameObjects(std::vector<FGameObjectRepresentation>&& GameObjects
 			}
 			else
 			{
+				// streamed objects are drawn w/ a default material cube until their model is loaded
+				if (bStreamModels)
+				{
+					if (PlaceholderModelID == INVALID_ID)
+					{
+						PlaceholderModelID = this->CreateModel();
+						Model& model = mModels.at(PlaceholderModelID);
+						model.mData.mOpaueMeshIDs.push_back(EBuiltInMeshes::CUBE);
+						model.mData.mOpaqueMaterials[EBuiltInMeshes::CUBE] = this->mDefaultMaterialID;
+						model.mbLoaded = true;
+					}
+					pObj->mModelID = PlaceholderModelID;
+				}
 				mAssetLoader.QueueModelLoad(pObj, ObjRep.ModelFilePath, ObjRep.ModelName);
 			}
 
@@ -229,6 +247,13 @@ void Scene::LoadGameObjects(std::vector<FGameObjectRepresentation>&& GameObjects
 	}
 
 	// kickoff workers for loading models
+	if (bStreamModels)
+	{
+		mModelLoadResults.clear();
+		mAssetLoader.StartStreamingModels(this);
+		Log::Info("[Scene] Start streaming models...");
+		return;
+	}
 	mModelLoadResults = mAssetLoader.StartLoadingModels(this);
 	Log::Info("[Scene] Start loading models...");
 
@@ -257,23 +282,19 @@ void Scene::LoadSceneMaterials(const std::vector<FMaterialRepresentation>& Mater
 
 void Scene::LoadLights(const std::vector<Light>& SceneLights)
 {
-	for (const Light& l : SceneLights)
+	// keep the static -> stationary -> dynamic order so that static lights get the shadow map slots first
+	std::vector<Light> Lights = SceneLights;
+	for (Light& l : Lights)
 	{
-		std::vector<Light>& LightContainer = [&]() -> std::vector<Light>&{
-			switch (l.Mobility)
-			{
-			case Light::EMobility::DYNAMIC: return mLightsDynamic;
-			case Light::EMobility::STATIC: return mLightsStatic;
-			case Light::EMobility::STATIONARY: return mLightsStationary;
-			default:
-				Log::Warning("Invalid light mobility!");
-				break;
-			}
-			return mLightsStationary;
-		}();
-
-		LightContainer.push_back(l);
+		if (l.Mobility < 0 || l.Mobility >= Light::EMobility::NUM_LIGHT_MOBILITY_TYPES)
+		{
+			Log::Warning("Invalid light mobility!");
+			l.Mobility = Light::EMobility::STATIONARY;
+		}
 	}
+	std::stable_sort(Lights.begin(), Lights.end(), [](const Light& l0, const Light& l1) { return l0.Mobility < l1.Mobility; });
+
+	mLights.Add(Lights);
 }
 
 void Scene::LoadCameras(std::vector<FCameraParameters>& CameraParams)
@@ -360,6 +381,7 @@ void Scene::OnLoadComplete()
 
 void Scene::Unload()
 {
+	mAssetLoader.CancelModelStreaming();
 	this->UnloadScene();
 
 	mSceneRepresentation = {};
@@ -370,7 +392,20 @@ void Scene::Unload()
 	mFrameSceneViews.resize(sz);
 	mFrameShadowViews.resize(sz);
 
-	//mMeshes.clear(); // TODO
+	// release the geometry of the scene meshes, builtin meshes are owned by the engine
+	// and instance meshes share the buffers of their source mesh
+	for (auto& it : mMeshes)
+	{
+		if (it.first < EBuiltInMeshes::NUM_BUILTIN_MESHES || it.second.IsInstance())
+			continue;
+		for (int lod = 0; lod < it.second.GetNumLODs(); ++lod)
+		{
+			std::pair<BufferID, BufferID> IABuffers = it.second.GetIABufferIDs(lod);
+			mRenderer.DestroyVertexBuffer(IABuffers.first);
+			mRenderer.DestroyIndexBuffer(IABuffers.second);
+		}
+	}
+	mMeshes.clear();
 
 	for (Transform* pTf : mpTransforms) mTransformPool.Free(pTf);
 	mpTransforms.clear();
@@ -381,68 +416,223 @@ void Scene::Unload()
 	mCameras.clear();
 
 	mDirectionalLight = {};
-	mLightsStatic.clear();
-	mLightsDynamic.clear();
+	mLights.Clear();
+	mShadowCache.InvalidateAll();
 
 	mBoundingBoxHierarchy.Clear();
 
+	mRayQueryAS.Clear();
+	mRayQueryMeshIndices.clear();
+	mRayQueryInstanceMeshes.clear();
+	mbRayQueryTopLevelDirty = true;
+
 	mIndex_SelectedCamera = 0;
 	mIndex_ActiveEnvironmentMapPreset = -1;
 	mEngine.UnloadEnvironmentMap();
-
-	mLightsDynamic.clear();
-	mLightsStatic.clear();
-	mLightsStationary.clear();
 }
 
 
-void Scene::CalculateGameObjectLocalSpaceBoundingBoxes()
+void Scene::CaptureSnapshot(FSceneSnapshot& s) const
 {
-	constexpr float max_f = std::numeric_limits<float>::max();
-	constexpr float min_f = -(max_f - 1.0f);
+	s.Clear();
 
-	for (GameObject* pGameObj : mpObjects)
-	{
-		FBoundingBox& AABB = pGameObj->mLocalSpaceBoundingBox;
+	// materials, sorted by ID so the snapshot is deterministic
+	std::unordered_map<MaterialID, const std::string*> MaterialNames;
+	for (const auto& it : mLoadedMaterials)
+		MaterialNames[it.second] = &it.first;
 
-		// reset AABB
-		AABB.ExtentMin = XMFLOAT3(max_f, max_f, max_f);
-		AABB.ExtentMax = XMFLOAT3(min_f, min_f, min_f);
+	std::vector<MaterialID> MaterialIDs;
+	for (const auto& it : mMaterials)
+		MaterialIDs.push_back(it.first);
+	std::sort(MaterialIDs.begin(), MaterialIDs.end());
 
-		// load
-		XMVECTOR vMins = XMLoadFloat3(&AABB.ExtentMin);
-		XMVECTOR vMaxs = XMLoadFloat3(&AABB.ExtentMax);
+	std::unordered_map<MaterialID, uint32> MaterialIndices;
+	for (MaterialID matID : MaterialIDs)
+	{
+		auto itName = MaterialNames.find(matID);
+		MaterialIndices[matID] = static_cast<uint32>(s.Materials.size());
+		s.Materials.push_back({ matID, itName == MaterialNames.end() ? 0u : s.AddString(*itName->second) });
+	}
 
-		// go through all meshes and generate the AABB
-		if (pGameObj->mModelID == -1)
-		{
-			Log::Warning("Game object doesn't have a valid model ID!");
-			continue;
-		}
-		const Model& model = mModels.at(pGameObj->mModelID);
-		auto fnProcessMeshAABB = [&vMins, &vMaxs](const FBoundingBox& AABB_Mesh)
-		{
-			XMVECTOR vMinMesh = XMLoadFloat3(&AABB_Mesh.ExtentMin);
-			XMVECTOR vMaxMesh = XMLoadFloat3(&AABB_Mesh.ExtentMax);
-
-			vMins = XMVectorMin(vMins, vMinMesh);
-			vMins = XMVectorMin(vMins, vMaxMesh);
-			vMaxs = XMVectorMax(vMaxs, vMinMesh);
-			vMaxs = XMVectorMax(vMaxs, vMaxMesh);
-		};
-		for (MeshID mesh : model.mData.mOpaueMeshIDs)
+	// models
+	std::vector<ModelID> ModelIDs;
+	for (const auto& it : mModels)
+		ModelIDs.push_back(it.first);
+	std::sort(ModelIDs.begin(), ModelIDs.end());
+
+	auto fnAddMeshMaterials = [&](const std::vector<MeshID>& Meshes, const MeshMaterialLookup_t& Materials)
+	{
+		for (MeshID meshID : Meshes)
 		{
-			const FBoundingBox& AABB_Mesh = mMeshes.at(mesh).GetLocalSpaceBoundingBox();
-			fnProcessMeshAABB(AABB_Mesh);
+			auto itMat = Materials.find(meshID);
+			auto itIndex = itMat == Materials.end() ? MaterialIndices.end() : MaterialIndices.find(itMat->second);
+			s.MeshMaterials.push_back({ meshID, itIndex == MaterialIndices.end() ? FSceneSnapshot::INVALID_INDEX : itIndex->second });
 		}
-		for (MeshID mesh : model.mData.mTransparentMeshIDs)
+	};
+
+	std::unordered_map<ModelID, uint32> ModelIndices;
+	for (ModelID modelID : ModelIDs)
+	{
+		const Model& model = mModels.at(modelID);
+		FSceneSnapshot::FModelRecord m = {};
+		m.ID                   = modelID;
+		m.Name                 = s.AddString(model.mModelName);
+		m.Path                 = s.AddString(model.mModelPath);
+		m.iFirstMeshMaterial   = static_cast<uint32>(s.MeshMaterials.size());
+		m.NumOpaqueMeshes      = static_cast<uint32>(model.mData.mOpaueMeshIDs.size());
+		m.NumTransparentMeshes = static_cast<uint32>(model.mData.mTransparentMeshIDs.size());
+		m.bLoaded              = model.mbLoaded ? 1 : 0;
+		fnAddMeshMaterials(model.mData.mOpaueMeshIDs, model.mData.mOpaqueMaterials);
+		fnAddMeshMaterials(model.mData.mTransparentMeshIDs, model.mData.mTransparentMaterials);
+
+		ModelIndices[modelID] = static_cast<uint32>(s.Models.size());
+		s.Models.push_back(m);
+	}
+
+	// objects
+	SceneSnapshot::CaptureObjects(mpObjects, mpTransforms, ModelIndices, s);
+
+	// lights & cameras
+	s.Lights.reserve(mLights.GetNumLights());
+	for (uint32 i = 0; i < mLights.GetNumLights(); ++i)
+		s.Lights.push_back(mLights.GetLightAt(i));
+	s.DirectionalLight = mDirectionalLight;
+
+	for (const Camera& c : mCameras)
+		s.Cameras.push_back(c.GetTrackKey(0.0f));
+	s.iSelectedCamera = mIndex_SelectedCamera;
+}
+
+void Scene::RestoreSnapshot(const FSceneSnapshot& s)
+{
+	if (s.Objects.size() > NUM_GAMEOBJECT_POOL_SIZE || s.Transforms.size() > NUM_GAMEOBJECT_POOL_SIZE)
+	{
+		Log::Error("[Scene] Snapshot has %u game objects, pool size is %u: not restoring", static_cast<uint32>(s.Objects.size()), static_cast<uint32>(NUM_GAMEOBJECT_POOL_SIZE));
+		return;
+	}
+
+	// the streaming requests refer to the objects being replaced
+	mAssetLoader.CancelModelStreaming();
+
+	// materials: match by name, then by ID, fall back to the default material
+	std::vector<MaterialID> MaterialIDs(s.Materials.size(), mDefaultMaterialID);
+	for (size_t i = 0; i < s.Materials.size(); ++i)
+	{
+		const FSceneSnapshot::FMaterialRecord& r = s.Materials[i];
+		auto itName = mLoadedMaterials.find(s.GetString(r.Name));
+		if (itName != mLoadedMaterials.end())
+			MaterialIDs[i] = itName->second;
+		else if (mMaterials.find(r.ID) != mMaterials.end())
+			MaterialIDs[i] = r.ID;
+	}
+
+	// models: update in place if the scene still has the model so the asset loader's cached IDs stay valid
+	uint32 NumDroppedMeshes = 0;
+	std::vector<ModelID> ModelIDs(s.Models.size());
+	for (size_t i = 0; i < s.Models.size(); ++i)
+	{
+		const FSceneSnapshot::FModelRecord& r = s.Models[i];
+		const ModelID modelID = mModels.find(r.ID) != mModels.end() ? r.ID : this->CreateModel();
+		Model& model = mModels.at(modelID);
+		model = Model();
+		model.mModelName = s.GetString(r.Name);
+		model.mModelPath = s.GetString(r.Path);
+		model.mbLoaded   = r.bLoaded != 0;
+
+		for (uint32 iMesh = 0; iMesh < r.NumOpaqueMeshes + r.NumTransparentMeshes; ++iMesh)
 		{
-			const FBoundingBox& AABB_Mesh = mMeshes.at(mesh).GetLocalSpaceBoundingBox();
-			fnProcessMeshAABB(AABB_Mesh);
+			const FSceneSnapshot::FMeshMaterialRecord& mm = s.MeshMaterials[r.iFirstMeshMaterial + iMesh];
+			if (mMeshes.find(mm.Mesh) == mMeshes.end())
+			{
+				++NumDroppedMeshes;
+				continue;
+			}
+			const bool bTransparent = iMesh >= r.NumOpaqueMeshes;
+			(bTransparent ? model.mData.mTransparentMeshIDs : model.mData.mOpaueMeshIDs).push_back(mm.Mesh);
+			if (mm.iMaterial != FSceneSnapshot::INVALID_INDEX)
+				(bTransparent ? model.mData.mTransparentMaterials : model.mData.mOpaqueMaterials)[mm.Mesh] = MaterialIDs[mm.iMaterial];
 		}
+		ModelIDs[i] = modelID;
+	}
+	if (NumDroppedMeshes > 0)
+		Log::Warning("[Scene] Snapshot references %u meshes that don't exist in the scene, dropped.", NumDroppedMeshes);
+
+	// objects
+	mTransformWorldMatrixHistory.clear(); // keyed by the transform pointers which are reallocated
+	SceneSnapshot::RestoreObjects(s, ModelIDs, mGameObjectPool, mTransformPool, mpObjects, mpTransforms);
+	mBoundingBoxHierarchy.Clear();
+
+	// lights
+	mLights.Clear();
+	mLights.Add(s.Lights);
+	mDirectionalLight = s.DirectionalLight;
+	mShadowCache.InvalidateAll();
+
+	// cameras
+	const size_t NumCameras = std::min(s.Cameras.size(), mCameras.size());
+	if (s.Cameras.size() != mCameras.size())
+		Log::Warning("[Scene] Snapshot has %u cameras, scene has %u: restoring the first %u.", static_cast<uint32>(s.Cameras.size()), static_cast<uint32>(mCameras.size()), static_cast<uint32>(NumCameras));
+	for (size_t i = 0; i < NumCameras; ++i)
+		mCameras[i].ApplyTrackKey(s.Cameras[i]);
+	if (s.iSelectedCamera >= 0 && s.iSelectedCamera < static_cast<int>(mCameras.size()))
+		mIndex_SelectedCamera = s.iSelectedCamera;
+
+	Log::Info("[Scene] Restored snapshot: %u game objects, %u models, %u lights"
+		, static_cast<uint32>(s.Objects.size()), static_cast<uint32>(s.Models.size()), static_cast<uint32>(s.Lights.size()));
+}
 
-		// store 
-		XMStoreFloat3(&AABB.ExtentMin, vMins);
-		XMStoreFloat3(&AABB.ExtentMax, vMaxs);
+void Scene::CalculateGameObjectLocalSpaceBoundingBoxes()
+{
+	for (GameObject* pGameObj : mpObjects)
+	{
+		CalculateGameObjectLocalSpaceBoundingBox(pGameObj);
 	}
+}
+
+void Scene::CalculateGameObjectLocalSpaceBoundingBox(GameObject* pGameObj)
+{
+	constexpr float max_f = std::numeric_limits<float>::max();
+	constexpr float min_f = -(max_f - 1.0f);
+
+	FBoundingBox& AABB = pGameObj->mLocalSpaceBoundingBox;
+
+	// reset AABB
+	AABB.ExtentMin = XMFLOAT3(max_f, max_f, max_f);
+	AABB.ExtentMax = XMFLOAT3(min_f, min_f, min_f);
+
+	// load
+	XMVECTOR vMins = XMLoadFloat3(&AABB.ExtentMin);
+	XMVECTOR vMaxs = XMLoadFloat3(&AABB.ExtentMax);
+
+	// go through all meshes and generate the AABB
+	if (pGameObj->mModelID == -1)
+	{
+		Log::Warning("Game object doesn't have a valid model ID!");
+		return;
+	}
+	const Model& model = mModels.at(pGameObj->mModelID);
+	auto fnProcessMeshAABB = [&vMins, &vMaxs](const FBoundingBox& AABB_Mesh)
+	{
+		XMVECTOR vMinMesh = XMLoadFloat3(&AABB_Mesh.ExtentMin);
+		XMVECTOR vMaxMesh = XMLoadFloat3(&AABB_Mesh.ExtentMax);
+
+		vMins = XMVectorMin(vMins, vMinMesh);
+		vMins = XMVectorMin(vMins, vMaxMesh);
+		vMaxs = XMVectorMax(vMaxs, vMinMesh);
+		vMaxs = XMVectorMax(vMaxs, vMaxMesh);
+	};
+	for (MeshID mesh : model.mData.mOpaueMeshIDs)
+	{
+		const FBoundingBox& AABB_Mesh = mMeshes.at(mesh).GetLocalSpaceBoundingBox();
+		fnProcessMeshAABB(AABB_Mesh);
+	}
+	for (MeshID mesh : model.mData.mTransparentMeshIDs)
+	{
+		const FBoundingBox& AABB_Mesh = mMeshes.at(mesh).GetLocalSpaceBoundingBox();
+		fnProcessMeshAABB(AABB_Mesh);
+	}
+
+	// store 
+	XMStoreFloat3(&AABB.ExtentMin, vMins);
+	XMStoreFloat3(&AABB.ExtentMax, vMaxs);
 }
\ No newline at end of file
@@ -0,0 +1,1121 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "SceneSerialization.h"
+
+#include "../VQEngine.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+using namespace DirectX;
+
+//
+// STREAMING SCENE PARSER
+//
+namespace
+{
+// what an element contains
+enum EElementContext
+{
+	DOCUMENT = 0,
+	SCENE,
+	ENVIRONMENT_MAP,
+	CAMERA,
+	FIRST_PERSON,
+	MATERIAL,
+	LIGHT,
+	SHADOWS,
+	SPOT,
+	DIRECTIONAL,
+	POINT,
+	GAMEOBJECT,
+	MODEL,
+	TRANSFORM,
+	VALUE,   // text
+	IGNORED, // unknown or repeated element, skipped w/ its children
+
+	NUM_ELEMENT_CONTEXTS
+};
+
+// which representation field an element fills, also its bit in the seen/parsed field masks
+enum EElementField
+{
+	FIELD_NONE = 0,
+	FIELD_SCENE,
+	FIELD_ENVIRONMENT_MAP, FIELD_CAMERA, FIELD_MATERIAL, FIELD_LIGHT, FIELD_GAMEOBJECT,
+	FIELD_ENVIRONMENT_MAP_PRESET,
+	FIELD_CAM_POSITION, FIELD_CAM_PITCH, FIELD_CAM_YAW, FIELD_CAM_PROJECTION, FIELD_CAM_FOV, FIELD_CAM_NEAR, FIELD_CAM_FAR, FIELD_CAM_FIRST_PERSON, FIELD_CAM_ORBIT,
+	FIELD_CAM_TRANSLATION_SPEED, FIELD_CAM_ANGULAR_SPEED, FIELD_CAM_DRAG,
+	FIELD_MAT_NAME, FIELD_MAT_DIFFUSE, FIELD_MAT_ALPHA, FIELD_MAT_EMISSIVE, FIELD_MAT_EMISSIVE_INTENSITY, FIELD_MAT_ROUGHNESS, FIELD_MAT_METALNESS,
+	FIELD_MAT_DIFFUSE_MAP, FIELD_MAT_NORMAL_MAP, FIELD_MAT_EMISSIVE_MAP, FIELD_MAT_ALPHA_MASK_MAP, FIELD_MAT_METALLIC_MAP, FIELD_MAT_ROUGHNESS_MAP, FIELD_MAT_AO_MAP,
+	FIELD_LIGHT_TRANSFORM, FIELD_LIGHT_COLOR, FIELD_LIGHT_RANGE, FIELD_LIGHT_BRIGHTNESS, FIELD_LIGHT_MOBILITY, FIELD_LIGHT_ENABLED,
+	FIELD_LIGHT_SHADOWS, FIELD_LIGHT_SPOT, FIELD_LIGHT_DIRECTIONAL, FIELD_LIGHT_POINT,
+	FIELD_LIGHT_NEAR_PLANE, FIELD_LIGHT_FAR_PLANE, FIELD_LIGHT_DEPTH_BIAS,
+	FIELD_LIGHT_OUTER_CONE_ANGLE, FIELD_LIGHT_INNER_CONE_ANGLE,
+	FIELD_LIGHT_VIEWPORT_X, FIELD_LIGHT_VIEWPORT_Y, FIELD_LIGHT_DISTANCE,
+	FIELD_LIGHT_ATTENUATION,
+	FIELD_OBJ_TRANSFORM, FIELD_OBJ_MODEL, FIELD_OBJ_OCCLUDER,
+	FIELD_OBJ_MESH, FIELD_OBJ_MATERIAL_NAME, FIELD_OBJ_MODEL_PATH, FIELD_OBJ_MODEL_NAME,
+	FIELD_TF_POSITION, FIELD_TF_QUATERNION, FIELD_TF_ROTATION, FIELD_TF_SCALE,
+
+	NUM_ELEMENT_FIELDS
+};
+static_assert(NUM_ELEMENT_FIELDS <= 64, "Element field masks are 64-bit");
+
+struct FChildElement
+{
+	const char*     Name;
+	EElementField   Field;
+	EElementContext Context;
+};
+struct FChildElementList
+{
+	const FChildElement* pElements;
+	size_t               NumElements;
+};
+
+static const FChildElement DOCUMENT_CHILDREN[] =
+{
+	{ "Scene", FIELD_SCENE, SCENE },
+};
+static const FChildElement SCENE_CHILDREN[] =
+{
+	{ "EnvironmentMap", FIELD_ENVIRONMENT_MAP, ENVIRONMENT_MAP },
+	{ "Camera"        , FIELD_CAMERA         , CAMERA },
+	{ "Material"      , FIELD_MATERIAL       , MATERIAL },
+	{ "Light"         , FIELD_LIGHT          , LIGHT },
+	{ "GameObject"    , FIELD_GAMEOBJECT     , GAMEOBJECT },
+};
+static const FChildElement ENVIRONMENT_MAP_CHILDREN[] =
+{
+	{ "Preset", FIELD_ENVIRONMENT_MAP_PRESET, VALUE },
+};
+static const FChildElement CAMERA_CHILDREN[] =
+{
+	{ "Position"   , FIELD_CAM_POSITION    , VALUE },
+	{ "Pitch"      , FIELD_CAM_PITCH       , VALUE },
+	{ "Yaw"        , FIELD_CAM_YAW         , VALUE },
+	{ "Projection" , FIELD_CAM_PROJECTION  , VALUE },
+	{ "FoV"        , FIELD_CAM_FOV         , VALUE },
+	{ "Near"       , FIELD_CAM_NEAR        , VALUE },
+	{ "Far"        , FIELD_CAM_FAR         , VALUE },
+	{ "FirstPerson", FIELD_CAM_FIRST_PERSON, FIRST_PERSON },
+	{ "Orbit"      , FIELD_CAM_ORBIT       , IGNORED },
+};
+static const FChildElement FIRST_PERSON_CHILDREN[] =
+{
+	{ "TranslationSpeed", FIELD_CAM_TRANSLATION_SPEED, VALUE },
+	{ "AngularSpeed"    , FIELD_CAM_ANGULAR_SPEED    , VALUE },
+	{ "Drag"            , FIELD_CAM_DRAG             , VALUE },
+};
+static const FChildElement MATERIAL_CHILDREN[] =
+{
+	{ "Name"             , FIELD_MAT_NAME              , VALUE },
+	{ "Diffuse"          , FIELD_MAT_DIFFUSE           , VALUE },
+	{ "Alpha"            , FIELD_MAT_ALPHA             , VALUE },
+	{ "Emissive"         , FIELD_MAT_EMISSIVE          , VALUE },
+	{ "EmissiveIntensity", FIELD_MAT_EMISSIVE_INTENSITY, VALUE },
+	{ "Roughness"        , FIELD_MAT_ROUGHNESS         , VALUE },
+	{ "Metalness"        , FIELD_MAT_METALNESS         , VALUE },
+	{ "DiffuseMap"       , FIELD_MAT_DIFFUSE_MAP       , VALUE },
+	{ "NormalMap"        , FIELD_MAT_NORMAL_MAP        , VALUE },
+	{ "EmissiveMap"      , FIELD_MAT_EMISSIVE_MAP      , VALUE },
+	{ "AlphaMaskMap"     , FIELD_MAT_ALPHA_MASK_MAP    , VALUE },
+	{ "MetallicMap"      , FIELD_MAT_METALLIC_MAP      , VALUE },
+	{ "RoughnessMap"     , FIELD_MAT_ROUGHNESS_MAP     , VALUE },
+	{ "AOMap"            , FIELD_MAT_AO_MAP            , VALUE },
+};
+static const FChildElement LIGHT_CHILDREN[] =
+{
+	{ "Transform"  , FIELD_LIGHT_TRANSFORM  , TRANSFORM },
+	{ "Color"      , FIELD_LIGHT_COLOR      , VALUE },
+	{ "Range"      , FIELD_LIGHT_RANGE      , VALUE },
+	{ "Brightness" , FIELD_LIGHT_BRIGHTNESS , VALUE },
+	{ "Mobility"   , FIELD_LIGHT_MOBILITY   , VALUE },
+	{ "Enabled"    , FIELD_LIGHT_ENABLED    , VALUE },
+	{ "Shadows"    , FIELD_LIGHT_SHADOWS    , SHADOWS },
+	{ "Spot"       , FIELD_LIGHT_SPOT       , SPOT },
+	{ "Directional", FIELD_LIGHT_DIRECTIONAL, DIRECTIONAL },
+	{ "Point"      , FIELD_LIGHT_POINT      , POINT },
+};
+static const FChildElement SHADOWS_CHILDREN[] =
+{
+	{ "NearPlane", FIELD_LIGHT_NEAR_PLANE, VALUE },
+	{ "FarPlane" , FIELD_LIGHT_FAR_PLANE , VALUE },
+	{ "DepthBias", FIELD_LIGHT_DEPTH_BIAS, VALUE },
+};
+static const FChildElement SPOT_CHILDREN[] =
+{
+	{ "OuterConeAngleDegrees", FIELD_LIGHT_OUTER_CONE_ANGLE, VALUE },
+	{ "InnerConeAngleDegrees", FIELD_LIGHT_INNER_CONE_ANGLE, VALUE },
+};
+static const FChildElement DIRECTIONAL_CHILDREN[] =
+{
+	{ "ViewPortX", FIELD_LIGHT_VIEWPORT_X, VALUE },
+	{ "ViewPortY", FIELD_LIGHT_VIEWPORT_Y, VALUE },
+	{ "Distance" , FIELD_LIGHT_DISTANCE  , VALUE },
+};
+static const FChildElement POINT_CHILDREN[] =
+{
+	{ "Attenuation", FIELD_LIGHT_ATTENUATION, VALUE },
+};
+static const FChildElement GAMEOBJECT_CHILDREN[] =
+{
+	{ "Transform", FIELD_OBJ_TRANSFORM, TRANSFORM },
+	{ "Model"    , FIELD_OBJ_MODEL    , MODEL },
+	{ "Occluder" , FIELD_OBJ_OCCLUDER , VALUE },
+};
+static const FChildElement MODEL_CHILDREN[] =
+{
+	{ "Mesh"        , FIELD_OBJ_MESH         , VALUE },
+	{ "MaterialName", FIELD_OBJ_MATERIAL_NAME, VALUE },
+	{ "Path"        , FIELD_OBJ_MODEL_PATH   , VALUE },
+	{ "Name"        , FIELD_OBJ_MODEL_NAME   , VALUE },
+};
+static const FChildElement TRANSFORM_CHILDREN[] =
+{
+	{ "Position"  , FIELD_TF_POSITION  , VALUE },
+	{ "Quaternion", FIELD_TF_QUATERNION, VALUE },
+	{ "Rotation"  , FIELD_TF_ROTATION  , VALUE },
+	{ "Scale"     , FIELD_TF_SCALE     , VALUE },
+};
+
+#define CHILD_ELEMENT_LIST(Arr) { Arr, sizeof(Arr) / sizeof(Arr[0]) }
+static const FChildElementList CHILD_ELEMENTS[NUM_ELEMENT_CONTEXTS] =
+{
+	CHILD_ELEMENT_LIST(DOCUMENT_CHILDREN),
+	CHILD_ELEMENT_LIST(SCENE_CHILDREN),
+	CHILD_ELEMENT_LIST(ENVIRONMENT_MAP_CHILDREN),
+	CHILD_ELEMENT_LIST(CAMERA_CHILDREN),
+	CHILD_ELEMENT_LIST(FIRST_PERSON_CHILDREN),
+	CHILD_ELEMENT_LIST(MATERIAL_CHILDREN),
+	CHILD_ELEMENT_LIST(LIGHT_CHILDREN),
+	CHILD_ELEMENT_LIST(SHADOWS_CHILDREN),
+	CHILD_ELEMENT_LIST(SPOT_CHILDREN),
+	CHILD_ELEMENT_LIST(DIRECTIONAL_CHILDREN),
+	CHILD_ELEMENT_LIST(POINT_CHILDREN),
+	CHILD_ELEMENT_LIST(GAMEOBJECT_CHILDREN),
+	CHILD_ELEMENT_LIST(MODEL_CHILDREN),
+	CHILD_ELEMENT_LIST(TRANSFORM_CHILDREN),
+	{ nullptr, 0 }, // VALUE
+	{ nullptr, 0 }, // IGNORED
+};
+#undef CHILD_ELEMENT_LIST
+
+static const FChildElement* FindChildElement(EElementContext Context, std::string_view Name)
+{
+	const FChildElementList& List = CHILD_ELEMENTS[Context];
+	for (size_t i = 0; i < List.NumElements; ++i)
+		if (Name == List.pElements[i].Name)
+			return &List.pElements[i];
+	return nullptr;
+}
+
+static inline bool IsWhitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+static inline uint64 FieldBit(EElementField Field) { return 1ull << Field; }
+
+// text nodes point into the source buffer, they are followed by '<' or ']]>' so strtof() stops before the end
+struct FText
+{
+	const char* pData  = nullptr;
+	size_t      Length = 0;
+	bool        bCData = false;
+};
+
+static float ParseFloat(const FText& Text)
+{
+	return Text.pData ? strtof(Text.pData, nullptr) : 0.0f;
+}
+static void ParseFloats(const FText& Text, float* pValues, int NumValues)
+{
+	const char* p = Text.pData;
+	for (int i = 0; i < NumValues; ++i)
+	{
+		char* pNext = nullptr;
+		pValues[i] = strtof(p, &pNext);
+		p = pNext;
+	}
+}
+static int CountTokens(const FText& Text)
+{
+	int NumTokens = 0;
+	bool bInToken = false;
+	for (size_t i = 0; i < Text.Length; ++i)
+	{
+		const bool bSpace = IsWhitespace(Text.pData[i]);
+		NumTokens += (!bSpace && !bInToken) ? 1 : 0;
+		bInToken = !bSpace;
+	}
+	return NumTokens;
+}
+
+static void AppendUTF8(std::string& Str, uint32 CodePoint)
+{
+	if (CodePoint < 0x80) { Str += static_cast<char>(CodePoint); }
+	else if (CodePoint < 0x800)
+	{
+		Str += static_cast<char>(0xC0 | (CodePoint >> 6));
+		Str += static_cast<char>(0x80 | (CodePoint & 0x3F));
+	}
+	else if (CodePoint < 0x10000)
+	{
+		Str += static_cast<char>(0xE0 | (CodePoint >> 12));
+		Str += static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F));
+		Str += static_cast<char>(0x80 | (CodePoint & 0x3F));
+	}
+	else
+	{
+		Str += static_cast<char>(0xF0 | (CodePoint >> 18));
+		Str += static_cast<char>(0x80 | ((CodePoint >> 12) & 0x3F));
+		Str += static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F));
+		Str += static_cast<char>(0x80 | (CodePoint & 0x3F));
+	}
+}
+
+// trimmed string value w/ the entities resolved
+static std::string ParseString(const FText& Text)
+{
+	size_t iBegin = 0;
+	size_t iEnd = Text.Length;
+	while (iBegin < iEnd && IsWhitespace(Text.pData[iBegin])) ++iBegin;
+	while (iEnd > iBegin && IsWhitespace(Text.pData[iEnd - 1])) --iEnd;
+
+	const std::string_view Trimmed(Text.pData + iBegin, iEnd - iBegin);
+	if (Text.bCData || Trimmed.find('&') == std::string_view::npos)
+		return std::string(Trimmed);
+
+	static const std::pair<std::string_view, char> ENTITIES[] =
+	{
+		{ "&lt;", '<' }, { "&gt;", '>' }, { "&amp;", '&' }, { "&quot;", '"' }, { "&apos;", '\'' }
+	};
+
+	std::string Str;
+	Str.reserve(Trimmed.size());
+	for (size_t i = 0; i < Trimmed.size(); ++i)
+	{
+		if (Trimmed[i] != '&')
+		{
+			Str += Trimmed[i];
+			continue;
+		}
+
+		const size_t iSemicolon = Trimmed.find(';', i);
+		const std::string_view Entity = iSemicolon == std::string_view::npos ? std::string_view() : Trimmed.substr(i, iSemicolon - i + 1);
+		bool bResolved = false;
+		if (Entity.size() > 3 && Entity[1] == '#')
+		{
+			const bool bHex = Entity[2] == 'x';
+			const std::string Digits(Entity.substr(bHex ? 3 : 2, Entity.size() - (bHex ? 4 : 3)));
+			char* pEnd = nullptr;
+			const unsigned long CodePoint = strtoul(Digits.c_str(), &pEnd, bHex ? 16 : 10);
+			if (!Digits.empty() && *pEnd == '\0')
+			{
+				AppendUTF8(Str, static_cast<uint32>(CodePoint));
+				bResolved = true;
+			}
+		}
+		for (size_t e = 0; !bResolved && e < sizeof(ENTITIES) / sizeof(ENTITIES[0]); ++e)
+		{
+			if (Entity == ENTITIES[e].first)
+			{
+				Str += ENTITIES[e].second;
+				bResolved = true;
+			}
+		}
+
+		if (bResolved) i = iSemicolon;
+		else           Str += '&'; // unknown entities are kept as is
+	}
+	return Str;
+}
+
+struct FElement
+{
+	std::string_view Name;
+	EElementContext  Context    = IGNORED;
+	EElementField    Field      = FIELD_NONE;
+	uint64           SeenFields = 0; // child elements already encountered, the first one of each is used
+	bool             bHasChildNode = false;
+	FText            Text; // first child node, if it's text
+};
+
+// Fills the scene representation as the elements close, applying the fields of a record in the same
+// order as the tinyxml2 loader so the order of the elements in the file doesn't change the result.
+class FSceneElementHandler
+{
+public:
+	FSceneElementHandler(FSceneRepresentation& SceneRep) : mSceneRep(SceneRep) {}
+
+	void BeginElement(FElement& Parent, FElement& Child)
+	{
+		Parent.bHasChildNode = true;
+
+		const FChildElement* pChild = FindChildElement(Parent.Context, Child.Name);
+		const bool bRepeatable = Parent.Context == SCENE;
+		if (!pChild || (!bRepeatable && (Parent.SeenFields & FieldBit(pChild->Field))))
+			return; // ignored
+
+		Parent.SeenFields |= FieldBit(pChild->Field);
+		Child.Context = pChild->Context;
+		Child.Field   = pChild->Field;
+		mOpenedFields |= FieldBit(pChild->Field);
+
+		switch (Child.Field)
+		{
+		case FIELD_CAMERA     : mCamera = {};                        mOpenedFields = mParsedFields = 0; break;
+		case FIELD_MATERIAL   : mMaterial = FMaterialRepresentation(); mOpenedFields = mParsedFields = 0; break;
+		case FIELD_LIGHT      : mLight = FPendingLight();            mOpenedFields = mParsedFields = 0; break;
+		case FIELD_GAMEOBJECT : mObject = {};                        mOpenedFields = mParsedFields = 0; break;
+		case FIELD_LIGHT_TRANSFORM:
+		case FIELD_OBJ_TRANSFORM  : mTransform = FPendingTransform(); break;
+		default: break;
+		}
+	}
+
+	void EndElement(const FElement& Element)
+	{
+		switch (Element.Context)
+		{
+		case VALUE     : ParseValue(Element.Field, Element.Text); break;
+		case TRANSFORM : EndTransform(Element.Field); break;
+		case CAMERA    : EndCamera(); break;
+		case MATERIAL  : mSceneRep.Materials.push_back(std::move(mMaterial)); break;
+		case LIGHT     : EndLight(); break;
+		case GAMEOBJECT: mSceneRep.Objects.push_back(std::move(mObject)); break;
+		default: break;
+		}
+	}
+
+private:
+	struct FPendingTransform
+	{
+		bool     bPosition = false, bScale = false, bQuaternion = false, bRotation = false;
+		XMFLOAT3 Position;
+		XMFLOAT3 Scale;
+		XMFLOAT4 Quaternion;
+		XMFLOAT3 RotationDegrees;
+	};
+	struct FPendingLight
+	{
+		Light    l;
+		// the light type specific data share a union, written in order when the light closes
+		float    OuterConeAngle = 0.0f, InnerConeAngle = 0.0f;
+		float    ViewportX = 0.0f, ViewportY = 0.0f, Distance = 0.0f;
+		XMFLOAT3 Attenuation = XMFLOAT3(0, 0, 0);
+	};
+
+	void ParseValue(EElementField Field, const FText& Text)
+	{
+		// boolean & enum values are assigned even when the element is empty, like the tinyxml2 loader does
+		switch (Field)
+		{
+		case FIELD_CAM_PROJECTION: mCamera.ProjectionParams.bPerspectiveProjection = ParseString(Text) == "Perspective"; return;
+		case FIELD_LIGHT_ENABLED : mLight.l.bEnabled = StrUtil::ParseBool(ParseString(Text)); return;
+		case FIELD_OBJ_OCCLUDER  : mObject.bOccluder = StrUtil::ParseBool(ParseString(Text)); return;
+		default: break;
+		}
+
+		if (!Text.pData)
+			return;
+		mParsedFields |= FieldBit(Field);
+
+		switch (Field)
+		{
+		case FIELD_ENVIRONMENT_MAP_PRESET: mSceneRep.EnvironmentMapPreset = ParseString(Text); break;
+
+		case FIELD_CAM_POSITION         : { float xyz[3]; ParseFloats(Text, xyz, 3); mCamera.x = xyz[0]; mCamera.y = xyz[1]; mCamera.z = xyz[2]; } break;
+		case FIELD_CAM_PITCH            : mCamera.Pitch = ParseFloat(Text); break;
+		case FIELD_CAM_YAW              : mCamera.Yaw   = ParseFloat(Text); break;
+		case FIELD_CAM_FOV              : mCamera.ProjectionParams.FieldOfView = ParseFloat(Text); break;
+		case FIELD_CAM_NEAR             : mCamera.ProjectionParams.NearZ       = ParseFloat(Text); break;
+		case FIELD_CAM_FAR              : mCamera.ProjectionParams.FarZ        = ParseFloat(Text); break;
+		case FIELD_CAM_TRANSLATION_SPEED: mCamera.TranslationSpeed = ParseFloat(Text); break;
+		case FIELD_CAM_ANGULAR_SPEED    : mCamera.AngularSpeed     = ParseFloat(Text); break;
+		case FIELD_CAM_DRAG             : mCamera.Drag             = ParseFloat(Text); break;
+
+		case FIELD_MAT_NAME              : mMaterial.Name = ParseString(Text); break;
+		case FIELD_MAT_DIFFUSE           : ParseFloats(Text, &mMaterial.DiffuseColor.x, 3); break;
+		case FIELD_MAT_ALPHA             : mMaterial.Alpha = ParseFloat(Text); break;
+		case FIELD_MAT_EMISSIVE          : ParseFloats(Text, &mMaterial.EmissiveColor.x, 3); break;
+		case FIELD_MAT_EMISSIVE_INTENSITY: mMaterial.EmissiveIntensity = ParseFloat(Text); break;
+		case FIELD_MAT_ROUGHNESS         : mMaterial.Roughness = ParseFloat(Text); break;
+		case FIELD_MAT_METALNESS         : mMaterial.Metalness = ParseFloat(Text); break;
+		case FIELD_MAT_DIFFUSE_MAP       : mMaterial.DiffuseMapFilePath   = ParseString(Text); break;
+		case FIELD_MAT_NORMAL_MAP        : mMaterial.NormalMapFilePath    = ParseString(Text); break;
+		case FIELD_MAT_EMISSIVE_MAP      : mMaterial.EmissiveMapFilePath  = ParseString(Text); break;
+		case FIELD_MAT_ALPHA_MASK_MAP    : mMaterial.AlphaMaskMapFilePath = ParseString(Text); break;
+		case FIELD_MAT_METALLIC_MAP      : mMaterial.MetallicMapFilePath  = ParseString(Text); break;
+		case FIELD_MAT_ROUGHNESS_MAP     : mMaterial.RoughnessMapFilePath = ParseString(Text); break;
+		case FIELD_MAT_AO_MAP            : mMaterial.AOMapFilePath        = ParseString(Text); break;
+
+		case FIELD_LIGHT_COLOR          : ParseFloats(Text, &mLight.l.Color.x, 3); break;
+		case FIELD_LIGHT_RANGE          : mLight.l.Range      = ParseFloat(Text); break;
+		case FIELD_LIGHT_BRIGHTNESS     : mLight.l.Brightness = ParseFloat(Text); break;
+		case FIELD_LIGHT_NEAR_PLANE     : mLight.l.ShadowData.NearPlane = ParseFloat(Text); break;
+		case FIELD_LIGHT_FAR_PLANE      : mLight.l.ShadowData.FarPlane  = ParseFloat(Text); break;
+		case FIELD_LIGHT_DEPTH_BIAS     : mLight.l.ShadowData.DepthBias = ParseFloat(Text); break;
+		case FIELD_LIGHT_OUTER_CONE_ANGLE: mLight.OuterConeAngle = ParseFloat(Text); break;
+		case FIELD_LIGHT_INNER_CONE_ANGLE: mLight.InnerConeAngle = ParseFloat(Text); break;
+		case FIELD_LIGHT_VIEWPORT_X     : mLight.ViewportX = ParseFloat(Text); break;
+		case FIELD_LIGHT_VIEWPORT_Y     : mLight.ViewportY = ParseFloat(Text); break;
+		case FIELD_LIGHT_DISTANCE       : mLight.Distance  = ParseFloat(Text); break;
+		case FIELD_LIGHT_ATTENUATION    : ParseFloats(Text, &mLight.Attenuation.x, 3); break;
+		case FIELD_LIGHT_MOBILITY:
+		{
+			std::string Mobility = ParseString(Text);
+			std::transform(Mobility.begin(), Mobility.end(), Mobility.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+			if (Mobility == "static")     mLight.l.Mobility = Light::EMobility::STATIC;
+			if (Mobility == "dynamic")    mLight.l.Mobility = Light::EMobility::DYNAMIC;
+			if (Mobility == "stationary") mLight.l.Mobility = Light::EMobility::STATIONARY;
+		} break;
+
+		case FIELD_OBJ_MESH         : mObject.BuiltinMeshName = ParseString(Text); break;
+		case FIELD_OBJ_MATERIAL_NAME: mObject.MaterialName    = ParseString(Text); break;
+		case FIELD_OBJ_MODEL_PATH   : mObject.ModelFilePath   = ParseString(Text); break;
+		case FIELD_OBJ_MODEL_NAME   : mObject.ModelName       = ParseString(Text); break;
+
+		case FIELD_TF_POSITION  : mTransform.bPosition   = true; ParseFloats(Text, &mTransform.Position.x, 3); break;
+		case FIELD_TF_QUATERNION: mTransform.bQuaternion = true; ParseFloats(Text, &mTransform.Quaternion.x, 4); break;
+		case FIELD_TF_ROTATION  : mTransform.bRotation   = true; ParseFloats(Text, &mTransform.RotationDegrees.x, 3); break;
+		case FIELD_TF_SCALE:
+			mTransform.bScale = true;
+			if (CountTokens(Text) == 3) ParseFloats(Text, &mTransform.Scale.x, 3);
+			else
+			{
+				const float s = ParseFloat(Text);
+				mTransform.Scale = XMFLOAT3(s, s, s);
+			}
+			break;
+
+		default: break;
+		}
+	}
+
+	void EndTransform(EElementField Field)
+	{
+		Transform tf;
+		if (mTransform.bPosition) tf._position = mTransform.Position;
+		if (mTransform.bScale)    tf._scale    = mTransform.Scale;
+		if (mTransform.bQuaternion)
+		{
+			const XMFLOAT4& q = mTransform.Quaternion;
+			tf._rotation = Quaternion(q.w, XMFLOAT3(q.x, q.y, q.z));
+		}
+		if (mTransform.bRotation)
+		{
+			tf.RotateAroundGlobalXAxisDegrees(mTransform.RotationDegrees.x);
+			tf.RotateAroundGlobalYAxisDegrees(mTransform.RotationDegrees.y);
+			tf.RotateAroundGlobalZAxisDegrees(mTransform.RotationDegrees.z);
+		}
+
+		if (Field == FIELD_OBJ_TRANSFORM)
+		{
+			mObject.tf = tf;
+		}
+		if (Field == FIELD_LIGHT_TRANSFORM)
+		{
+			mLight.l.Position = tf._position;
+			mLight.l.RenderScale = tf._scale;
+			mLight.l.RotationQuaternion = tf._rotation;
+		}
+	}
+
+	void EndCamera()
+	{
+		if (mOpenedFields & FieldBit(FIELD_CAM_FIRST_PERSON))
+		{
+			mCamera.bInitializeCameraController = true;
+			mCamera.ControllerType = ECameraControllerType::FIRST_PERSON;
+		}
+		if (mOpenedFields & FieldBit(FIELD_CAM_ORBIT))
+		{
+			mCamera.bInitializeCameraController = true;
+			mCamera.ControllerType = ECameraControllerType::ORBIT;
+		}
+		mSceneRep.Cameras.push_back(mCamera);
+	}
+
+	void EndLight()
+	{
+		Light& l = mLight.l;
+		if (mParsedFields & FieldBit(FIELD_LIGHT_OUTER_CONE_ANGLE)) l.SpotOuterConeAngleDegrees = mLight.OuterConeAngle;
+		if (mParsedFields & FieldBit(FIELD_LIGHT_INNER_CONE_ANGLE)) l.SpotInnerConeAngleDegrees = mLight.InnerConeAngle;
+		if (mParsedFields & FieldBit(FIELD_LIGHT_VIEWPORT_X))       l.ViewportX = mLight.ViewportX;
+		if (mParsedFields & FieldBit(FIELD_LIGHT_VIEWPORT_Y))       l.ViewportY = mLight.ViewportY;
+		if (mParsedFields & FieldBit(FIELD_LIGHT_DISTANCE))         l.DistanceFromOrigin = mLight.Distance;
+		if (mOpenedFields & FieldBit(FIELD_LIGHT_SHADOWS))          l.bCastingShadows = true;
+		if (mParsedFields & FieldBit(FIELD_LIGHT_ATTENUATION))
+		{
+			l.AttenuationConstant  = mLight.Attenuation.x;
+			l.AttenuationLinear    = mLight.Attenuation.y;
+			l.AttenuationQuadratic = mLight.Attenuation.z;
+		}
+		if (mOpenedFields & FieldBit(FIELD_LIGHT_SPOT))        l.Type = Light::EType::SPOT;
+		if (mOpenedFields & FieldBit(FIELD_LIGHT_DIRECTIONAL)) l.Type = Light::EType::DIRECTIONAL;
+		if (mOpenedFields & FieldBit(FIELD_LIGHT_POINT))       l.Type = Light::EType::POINT;
+		mSceneRep.Lights.push_back(l);
+	}
+
+private:
+	FSceneRepresentation&     mSceneRep;
+
+	// the record being parsed: scene children don't nest
+	FCameraParameters         mCamera = {};
+	FMaterialRepresentation   mMaterial;
+	FPendingLight             mLight;
+	FGameObjectRepresentation mObject = {};
+	FPendingTransform         mTransform;
+	uint64                    mOpenedFields = 0; // elements of the record
+	uint64                    mParsedFields = 0; // value elements of the record that had text
+};
+
+static bool StartsWith(const char* p, const char* pEnd, std::string_view Prefix)
+{
+	return static_cast<size_t>(pEnd - p) >= Prefix.size() && std::string_view(p, Prefix.size()) == Prefix;
+}
+static const char* Find(const char* p, const char* pEnd, std::string_view Str)
+{
+	const char* it = std::search(p, pEnd, Str.begin(), Str.end());
+	return it == pEnd ? nullptr : it;
+}
+static bool IsNameChar(char c)
+{
+	return !IsWhitespace(c) && c != '/' && c != '>' && c != '=' && c != '<';
+}
+static int GetLineNumber(const char* pText, const char* p)
+{
+	return 1 + static_cast<int>(std::count(pText, p, '\n'));
+}
+} // namespace
+
+bool SceneStreamingParser::ParseFile(const std::string& SceneFile, FSceneRepresentation& SceneRep)
+{
+	std::ifstream file(SceneFile, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::Error("SceneStreamingParser: couldn't open %s", SceneFile.c_str());
+		return false;
+	}
+
+	std::string Text;
+	file.seekg(0, std::ios::end);
+	Text.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(&Text[0], Text.size());
+	if (!file.good() && !Text.empty())
+	{
+		Log::Error("SceneStreamingParser: couldn't read %s", SceneFile.c_str());
+		return false;
+	}
+
+	SceneRep = {};
+	SceneRep.SceneName = DirectoryUtil::GetFileNameWithoutExtension(SceneFile);
+	if (!Parse(Text.data(), Text.size(), SceneRep))
+	{
+		Log::Error("SceneStreamingParser: couldn't parse %s", SceneFile.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool SceneStreamingParser::Parse(const char* pText, size_t Length, FSceneRepresentation& SceneRep)
+{
+	FSceneElementHandler Handler(SceneRep);
+
+	std::vector<FElement> Stack;
+	Stack.reserve(16);
+	Stack.emplace_back();
+	Stack.back().Context = DOCUMENT;
+
+	auto fnError = [pText](const char* p, const char* pMessage)
+	{
+		Log::Error("SceneStreamingParser: %s at line %d", pMessage, GetLineNumber(pText, p));
+		return false;
+	};
+
+	const char* p = pText;
+	const char* pEnd = pText + Length;
+	while (p < pEnd)
+	{
+		// text
+		if (*p != '<')
+		{
+			const char* pTextBegin = p;
+			bool bWhitespace = true;
+			for (; p < pEnd && *p != '<'; ++p)
+				bWhitespace = bWhitespace && IsWhitespace(*p);
+			if (p == pEnd)
+				break; // trailing text outside of the elements
+
+			FElement& Element = Stack.back();
+			if (!bWhitespace && !Element.bHasChildNode)
+				Element.Text = { pTextBegin, static_cast<size_t>(p - pTextBegin), false };
+			Element.bHasChildNode = Element.bHasChildNode || !bWhitespace;
+			continue;
+		}
+
+		// comment, CDATA, declaration, DOCTYPE
+		if (StartsWith(p, pEnd, "<!--"))
+		{
+			const char* pClose = Find(p + 4, pEnd, "-->");
+			if (!pClose) return fnError(p, "unterminated comment");
+			Stack.back().bHasChildNode = true;
+			p = pClose + 3;
+			continue;
+		}
+		if (StartsWith(p, pEnd, "<![CDATA["))
+		{
+			const char* pData = p + 9;
+			const char* pClose = Find(pData, pEnd, "]]>");
+			if (!pClose) return fnError(p, "unterminated CDATA");
+			FElement& Element = Stack.back();
+			if (!Element.bHasChildNode)
+				Element.Text = { pData, static_cast<size_t>(pClose - pData), true };
+			Element.bHasChildNode = true;
+			p = pClose + 3;
+			continue;
+		}
+		if (StartsWith(p, pEnd, "<?"))
+		{
+			const char* pClose = Find(p + 2, pEnd, "?>");
+			if (!pClose) return fnError(p, "unterminated declaration");
+			p = pClose + 2;
+			continue;
+		}
+		if (StartsWith(p, pEnd, "<!"))
+		{
+			const char* pClose = std::find(p + 2, pEnd, '>');
+			if (pClose == pEnd) return fnError(p, "unterminated DOCTYPE");
+			p = pClose + 1;
+			continue;
+		}
+
+		// end tag
+		if (StartsWith(p, pEnd, "</"))
+		{
+			const char* pName = p + 2;
+			const char* pNameEnd = pName;
+			while (pNameEnd < pEnd && IsNameChar(*pNameEnd)) ++pNameEnd;
+			p = pNameEnd;
+			while (p < pEnd && IsWhitespace(*p)) ++p;
+			if (p == pEnd || *p != '>')
+				return fnError(pName, "malformed end tag");
+			if (Stack.size() < 2 || Stack.back().Name != std::string_view(pName, pNameEnd - pName))
+				return fnError(pName, "mismatched end tag");
+
+			Handler.EndElement(Stack.back());
+			Stack.pop_back();
+			++p;
+			continue;
+		}
+
+		// start tag
+		const char* pName = p + 1;
+		const char* pNameEnd = pName;
+		while (pNameEnd < pEnd && IsNameChar(*pNameEnd)) ++pNameEnd;
+		if (pNameEnd == pName)
+			return fnError(p, "malformed start tag");
+
+		// skip the attributes
+		p = pNameEnd;
+		char Quote = 0;
+		while (p < pEnd && (Quote || *p != '>'))
+		{
+			if (Quote)                      Quote = *p == Quote ? 0 : Quote;
+			else if (*p == '"' || *p == '\'') Quote = *p;
+			++p;
+		}
+		if (p == pEnd)
+			return fnError(pName, "unterminated start tag");
+		const bool bSelfClosing = *(p - 1) == '/';
+		++p;
+
+		FElement Child;
+		Child.Name = std::string_view(pName, pNameEnd - pName);
+		Handler.BeginElement(Stack.back(), Child);
+		if (bSelfClosing)
+		{
+			Handler.EndElement(Child);
+			continue;
+		}
+		Stack.push_back(Child);
+	}
+
+	if (Stack.size() != 1)
+		return fnError(pEnd, "unterminated element");
+	return true;
+}
+
+
+//
+// BINARY SCENE FILE
+//
+std::string BinarySceneFile::GetFilePath(const std::string& SceneFile)
+{
+	return "Cache/Levels/" + DirectoryUtil::GetFileNameWithoutExtension(SceneFile) + ".vqscene";
+}
+
+bool BinarySceneFile::IsUpToDate(const std::string& FilePath, const std::string& SceneFile)
+{
+	std::error_code ec;
+	const std::filesystem::file_time_type BinaryWriteTime = std::filesystem::last_write_time(FilePath, ec);
+	if (ec)
+		return false;
+	const std::filesystem::file_time_type SceneWriteTime = std::filesystem::last_write_time(SceneFile, ec);
+	return !ec && SceneWriteTime <= BinaryWriteTime;
+}
+
+bool BinarySceneFile::Write(const std::string& FilePath, const FSceneRepresentation& SceneRep)
+{
+	// string table: offset 0 is the empty string
+	std::string StringTable(1, '\0');
+	std::unordered_map<std::string, uint32> StringOffsets;
+	auto fnString = [&](const std::string& Str) -> uint32
+	{
+		if (Str.empty())
+			return 0;
+		auto it = StringOffsets.find(Str);
+		if (it != StringOffsets.end())
+			return it->second;
+		const uint32 Offset = static_cast<uint32>(StringTable.size());
+		StringTable.append(Str.c_str(), Str.size() + 1);
+		StringOffsets.emplace(Str, Offset);
+		return Offset;
+	};
+	auto fnTransform = [](const Transform& tf) -> FTransformRecord
+	{
+		return { tf._position, tf._rotation.V, tf._rotation.S, tf._scale };
+	};
+
+	std::vector<FCameraRecord> Cameras(SceneRep.Cameras.size());
+	for (size_t i = 0; i < Cameras.size(); ++i)
+	{
+		const FCameraParameters& c = SceneRep.Cameras[i];
+		const FProjectionMatrixParameters& proj = c.ProjectionParams;
+		Cameras[i] = { c.x, c.y, c.z, c.Yaw, c.Pitch
+			, proj.ViewportWidth, proj.ViewportHeight, proj.NearZ, proj.FarZ, proj.FieldOfView, proj.bPerspectiveProjection ? 1u : 0u
+			, c.bInitializeCameraController ? 1u : 0u, static_cast<uint32>(c.ControllerType)
+			, c.TranslationSpeed, c.AngularSpeed, c.Drag
+		};
+	}
+
+	std::vector<FLightRecord> Lights(SceneRep.Lights.size());
+	for (size_t i = 0; i < Lights.size(); ++i)
+	{
+		const Light& l = SceneRep.Lights[i];
+		Lights[i] = { l.Position, l.Range, l.RotationQuaternion.V, l.RotationQuaternion.S, l.RenderScale
+			, l.bEnabled ? 1u : 0u, l.bCastingShadows ? 1u : 0u, static_cast<uint32>(l.Mobility), static_cast<uint32>(l.Type)
+			, l.Color, l.Brightness, l.ShadowData.DepthBias, l.ShadowData.NearPlane, l.ShadowData.FarPlane
+			, { l.ViewportX, l.ViewportY, l.DistanceFromOrigin }
+		};
+	}
+
+	std::vector<FMaterialRecord> Materials(SceneRep.Materials.size());
+	for (size_t i = 0; i < Materials.size(); ++i)
+	{
+		const FMaterialRepresentation& m = SceneRep.Materials[i];
+		Materials[i] = { fnString(m.Name)
+			, m.DiffuseColor, m.Alpha, m.EmissiveColor, m.EmissiveIntensity, m.Metalness, m.Roughness
+			, fnString(m.DiffuseMapFilePath), fnString(m.NormalMapFilePath), fnString(m.EmissiveMapFilePath), fnString(m.AlphaMaskMapFilePath)
+			, fnString(m.MetallicMapFilePath), fnString(m.RoughnessMapFilePath), fnString(m.AOMapFilePath)
+		};
+	}
+
+	std::vector<FObjectRecord> Objects(SceneRep.Objects.size());
+	for (size_t i = 0; i < Objects.size(); ++i)
+	{
+		const FGameObjectRepresentation& o = SceneRep.Objects[i];
+		Objects[i] = { fnTransform(o.tf)
+			, fnString(o.ModelName), fnString(o.ModelFilePath), fnString(o.BuiltinMeshName), fnString(o.MaterialName)
+			, o.bOccluder ? 1u : 0u
+		};
+	}
+
+	FHeader Header = {};
+	Header.Magic                = MAGIC;
+	Header.Version              = VERSION;
+	Header.NumCameras           = static_cast<uint32>(Cameras.size());
+	Header.NumLights            = static_cast<uint32>(Lights.size());
+	Header.NumMaterials         = static_cast<uint32>(Materials.size());
+	Header.NumObjects           = static_cast<uint32>(Objects.size());
+	Header.SceneName            = fnString(SceneRep.SceneName);
+	Header.EnvironmentMapPreset = fnString(SceneRep.EnvironmentMapPreset);
+	Header.StringTableOffset    = sizeof(FHeader)
+		+ sizeof(FCameraRecord)   * Cameras.size()
+		+ sizeof(FLightRecord)    * Lights.size()
+		+ sizeof(FMaterialRecord) * Materials.size()
+		+ sizeof(FObjectRecord)   * Objects.size();
+	Header.StringTableSize      = StringTable.size();
+
+	std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("BinarySceneFile: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(Cameras.data())  , sizeof(FCameraRecord)   * Cameras.size());
+	file.write(reinterpret_cast<const char*>(Lights.data())   , sizeof(FLightRecord)    * Lights.size());
+	file.write(reinterpret_cast<const char*>(Materials.data()), sizeof(FMaterialRecord) * Materials.size());
+	file.write(reinterpret_cast<const char*>(Objects.data())  , sizeof(FObjectRecord)   * Objects.size());
+	file.write(StringTable.data(), StringTable.size());
+	return file.good();
+}
+
+bool BinarySceneFile::Read(const std::string& FilePath, FSceneRepresentation& SceneRep)
+{
+	HANDLE hFile = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER FileSize = {};
+	HANDLE hMapping = NULL;
+	const void* pView = nullptr;
+	if (GetFileSizeEx(hFile, &FileSize) && FileSize.QuadPart > 0)
+	{
+		hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		pView = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	}
+
+	const bool bRead = pView && Read(pView, static_cast<size_t>(FileSize.QuadPart), SceneRep);
+	if (!pView)
+		Log::Error("BinarySceneFile: couldn't map %s", FilePath.c_str());
+	else if (!bRead)
+		Log::Warning("BinarySceneFile: %s is invalid or out of date, ignoring", FilePath.c_str());
+
+	if (pView)    UnmapViewOfFile(pView);
+	if (hMapping) CloseHandle(hMapping);
+	CloseHandle(hFile);
+	return bRead;
+}
+
+bool BinarySceneFile::Read(const void* pData, size_t Size, FSceneRepresentation& SceneRep)
+{
+	const char* pBytes = static_cast<const char*>(pData);
+	if (Size < sizeof(FHeader))
+		return false;
+
+	const FHeader* pHeader = reinterpret_cast<const FHeader*>(pBytes);
+	const uint64 RecordsSize = sizeof(FCameraRecord)   * static_cast<uint64>(pHeader->NumCameras)
+		                     + sizeof(FLightRecord)    * static_cast<uint64>(pHeader->NumLights)
+		                     + sizeof(FMaterialRecord) * static_cast<uint64>(pHeader->NumMaterials)
+		                     + sizeof(FObjectRecord)   * static_cast<uint64>(pHeader->NumObjects);
+	const bool bValidHeader = pHeader->Magic == MAGIC
+		&& pHeader->Version == VERSION
+		&& pHeader->StringTableOffset == sizeof(FHeader) + RecordsSize
+		&& pHeader->StringTableSize > 0
+		&& pHeader->StringTableOffset + pHeader->StringTableSize <= Size;
+	if (!bValidHeader)
+		return false;
+
+	const char* pStrings = pBytes + pHeader->StringTableOffset;
+	const uint64 StringTableSize = pHeader->StringTableSize;
+	if (pStrings[StringTableSize - 1] != '\0')
+		return false;
+
+	bool bValidStrings = true;
+	auto fnString = [&](uint32 Offset) -> std::string
+	{
+		if (Offset >= StringTableSize)
+		{
+			bValidStrings = false;
+			return std::string();
+		}
+		return std::string(pStrings + Offset);
+	};
+	auto fnTransform = [](const FTransformRecord& r) -> Transform
+	{
+		return Transform(r.Position, Quaternion(r.RotationS, r.RotationV), r.Scale);
+	};
+
+	FSceneRepresentation Rep = {};
+	Rep.SceneName            = fnString(pHeader->SceneName);
+	Rep.EnvironmentMapPreset = fnString(pHeader->EnvironmentMapPreset);
+
+	const FCameraRecord*   pCameras   = reinterpret_cast<const FCameraRecord*>(pBytes + sizeof(FHeader));
+	const FLightRecord*    pLights    = reinterpret_cast<const FLightRecord*>(pCameras + pHeader->NumCameras);
+	const FMaterialRecord* pMaterials = reinterpret_cast<const FMaterialRecord*>(pLights + pHeader->NumLights);
+	const FObjectRecord*   pObjects   = reinterpret_cast<const FObjectRecord*>(pMaterials + pHeader->NumMaterials);
+
+	Rep.Cameras.resize(pHeader->NumCameras);
+	for (uint32 i = 0; i < pHeader->NumCameras; ++i)
+	{
+		const FCameraRecord& r = pCameras[i];
+		FCameraParameters& c = Rep.Cameras[i];
+		c.x = r.x; c.y = r.y; c.z = r.z;
+		c.Yaw = r.Yaw; c.Pitch = r.Pitch;
+		c.ProjectionParams.ViewportWidth  = r.ViewportWidth;
+		c.ProjectionParams.ViewportHeight = r.ViewportHeight;
+		c.ProjectionParams.NearZ          = r.NearZ;
+		c.ProjectionParams.FarZ           = r.FarZ;
+		c.ProjectionParams.FieldOfView    = r.FieldOfView;
+		c.ProjectionParams.bPerspectiveProjection = r.bPerspectiveProjection != 0;
+		c.bInitializeCameraController = r.bInitializeCameraController != 0;
+		c.ControllerType   = static_cast<ECameraControllerType>(r.ControllerType);
+		c.TranslationSpeed = r.TranslationSpeed;
+		c.AngularSpeed     = r.AngularSpeed;
+		c.Drag             = r.Drag;
+	}
+
+	Rep.Lights.resize(pHeader->NumLights);
+	for (uint32 i = 0; i < pHeader->NumLights; ++i)
+	{
+		const FLightRecord& r = pLights[i];
+		Light& l = Rep.Lights[i];
+		l.Position           = r.Position;
+		l.Range              = r.Range;
+		l.RotationQuaternion = Quaternion(r.RotationS, r.RotationV);
+		l.RenderScale        = r.RenderScale;
+		l.bEnabled           = r.bEnabled != 0;
+		l.bCastingShadows    = r.bCastingShadows != 0;
+		l.Mobility           = static_cast<Light::EMobility>(r.Mobility);
+		l.Type               = static_cast<Light::EType>(r.Type);
+		l.Color              = r.Color;
+		l.Brightness         = r.Brightness;
+		l.ShadowData         = Light::FShadowData(r.DepthBias, r.NearPlane, r.FarPlane);
+		l.ViewportX          = r.TypeSpecificData[0];
+		l.ViewportY          = r.TypeSpecificData[1];
+		l.DistanceFromOrigin = r.TypeSpecificData[2];
+	}
+
+	Rep.Materials.resize(pHeader->NumMaterials);
+	for (uint32 i = 0; i < pHeader->NumMaterials; ++i)
+	{
+		const FMaterialRecord& r = pMaterials[i];
+		FMaterialRepresentation& m = Rep.Materials[i];
+		m.Name                 = fnString(r.Name);
+		m.DiffuseColor         = r.DiffuseColor;
+		m.Alpha                = r.Alpha;
+		m.EmissiveColor        = r.EmissiveColor;
+		m.EmissiveIntensity    = r.EmissiveIntensity;
+		m.Metalness            = r.Metalness;
+		m.Roughness            = r.Roughness;
+		m.DiffuseMapFilePath   = fnString(r.DiffuseMapFilePath);
+		m.NormalMapFilePath    = fnString(r.NormalMapFilePath);
+		m.EmissiveMapFilePath  = fnString(r.EmissiveMapFilePath);
+		m.AlphaMaskMapFilePath = fnString(r.AlphaMaskMapFilePath);
+		m.MetallicMapFilePath  = fnString(r.MetallicMapFilePath);
+		m.RoughnessMapFilePath = fnString(r.RoughnessMapFilePath);
+		m.AOMapFilePath        = fnString(r.AOMapFilePath);
+	}
+
+	Rep.Objects.resize(pHeader->NumObjects);
+	for (uint32 i = 0; i < pHeader->NumObjects; ++i)
+	{
+		const FObjectRecord& r = pObjects[i];
+		FGameObjectRepresentation& o = Rep.Objects[i];
+		o.tf              = fnTransform(r.tf);
+		o.ModelName       = fnString(r.ModelName);
+		o.ModelFilePath   = fnString(r.ModelFilePath);
+		o.BuiltinMeshName = fnString(r.BuiltinMeshName);
+		o.MaterialName    = fnString(r.MaterialName);
+		o.bOccluder       = r.bOccluder != 0;
+	}
+
+	if (!bValidStrings)
+		return false;
+
+	SceneRep = std::move(Rep);
+	return true;
+}
+
+namespace
+{
+template<class T> static bool IsBitwiseEqual(const T& l, const T& r) { return memcmp(&l, &r, sizeof(T)) == 0; }
+
+static bool IsEqual(const Quaternion& l, const Quaternion& r)
+{
+	return IsBitwiseEqual(l.V, r.V) && IsBitwiseEqual(l.S, r.S);
+}
+static bool IsEqual(const Transform& l, const Transform& r)
+{
+	return IsBitwiseEqual(l._position, r._position) && IsEqual(l._rotation, r._rotation) && IsBitwiseEqual(l._scale, r._scale);
+}
+static bool IsEqual(const FCameraParameters& l, const FCameraParameters& r)
+{
+	const FProjectionMatrixParameters& lp = l.ProjectionParams;
+	const FProjectionMatrixParameters& rp = r.ProjectionParams;
+	return IsBitwiseEqual(l.x, r.x) && IsBitwiseEqual(l.y, r.y) && IsBitwiseEqual(l.z, r.z)
+		&& IsBitwiseEqual(l.Yaw, r.Yaw) && IsBitwiseEqual(l.Pitch, r.Pitch)
+		&& IsBitwiseEqual(lp.ViewportWidth, rp.ViewportWidth) && IsBitwiseEqual(lp.ViewportHeight, rp.ViewportHeight)
+		&& IsBitwiseEqual(lp.NearZ, rp.NearZ) && IsBitwiseEqual(lp.FarZ, rp.FarZ) && IsBitwiseEqual(lp.FieldOfView, rp.FieldOfView)
+		&& lp.bPerspectiveProjection == rp.bPerspectiveProjection
+		&& l.bInitializeCameraController == r.bInitializeCameraController
+		&& l.ControllerType == r.ControllerType
+		&& IsBitwiseEqual(l.TranslationSpeed, r.TranslationSpeed) && IsBitwiseEqual(l.AngularSpeed, r.AngularSpeed) && IsBitwiseEqual(l.Drag, r.Drag);
+}
+static bool IsEqual(const Light& l, const Light& r)
+{
+	return IsBitwiseEqual(l.Position, r.Position) && IsBitwiseEqual(l.Range, r.Range)
+		&& IsEqual(l.RotationQuaternion, r.RotationQuaternion) && IsBitwiseEqual(l.RenderScale, r.RenderScale)
+		&& l.bEnabled == r.bEnabled && l.bCastingShadows == r.bCastingShadows && l.Mobility == r.Mobility && l.Type == r.Type
+		&& IsBitwiseEqual(l.Color, r.Color) && IsBitwiseEqual(l.Brightness, r.Brightness)
+		&& IsBitwiseEqual(l.ShadowData.DepthBias, r.ShadowData.DepthBias) && IsBitwiseEqual(l.ShadowData.NearPlane, r.ShadowData.NearPlane) && IsBitwiseEqual(l.ShadowData.FarPlane, r.ShadowData.FarPlane)
+		&& IsBitwiseEqual(l.ViewportX, r.ViewportX) && IsBitwiseEqual(l.ViewportY, r.ViewportY) && IsBitwiseEqual(l.DistanceFromOrigin, r.DistanceFromOrigin);
+}
+static bool IsEqual(const FMaterialRepresentation& l, const FMaterialRepresentation& r)
+{
+	return l.Name == r.Name
+		&& IsBitwiseEqual(l.DiffuseColor, r.DiffuseColor) && IsBitwiseEqual(l.Alpha, r.Alpha)
+		&& IsBitwiseEqual(l.EmissiveColor, r.EmissiveColor) && IsBitwiseEqual(l.EmissiveIntensity, r.EmissiveIntensity)
+		&& IsBitwiseEqual(l.Metalness, r.Metalness) && IsBitwiseEqual(l.Roughness, r.Roughness)
+		&& l.DiffuseMapFilePath   == r.DiffuseMapFilePath
+		&& l.NormalMapFilePath    == r.NormalMapFilePath
+		&& l.EmissiveMapFilePath  == r.EmissiveMapFilePath
+		&& l.AlphaMaskMapFilePath == r.AlphaMaskMapFilePath
+		&& l.MetallicMapFilePath  == r.MetallicMapFilePath
+		&& l.RoughnessMapFilePath == r.RoughnessMapFilePath
+		&& l.AOMapFilePath        == r.AOMapFilePath;
+}
+static bool IsEqual(const FGameObjectRepresentation& l, const FGameObjectRepresentation& r)
+{
+	return IsEqual(l.tf, r.tf)
+		&& l.ModelName == r.ModelName && l.ModelFilePath == r.ModelFilePath
+		&& l.BuiltinMeshName == r.BuiltinMeshName && l.MaterialName == r.MaterialName
+		&& l.bOccluder == r.bOccluder;
+}
+template<class T> static bool IsEqual(const std::vector<T>& l, const std::vector<T>& r)
+{
+	if (l.size() != r.size())
+		return false;
+	for (size_t i = 0; i < l.size(); ++i)
+		if (!IsEqual(l[i], r[i]))
+			return false;
+	return true;
+}
+} // namespace
+
+bool BinarySceneFile::IsEqual(const FSceneRepresentation& l, const FSceneRepresentation& r)
+{
+	return l.SceneName == r.SceneName
+		&& l.EnvironmentMapPreset == r.EnvironmentMapPreset
+		&& ::IsEqual(l.Cameras, r.Cameras)
+		&& ::IsEqual(l.Lights, r.Lights)
+		&& ::IsEqual(l.Materials, r.Materials)
+		&& ::IsEqual(l.Objects, r.Objects);
+}
@@ -0,0 +1,151 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Serialization.h"
+#include "../Core/Types.h"
+
+#include <string>
+
+//
+// STREAMING SCENE PARSER
+//
+// Single pass over the scene XML text that fills FSceneRepresentation as the elements close,
+// without building a DOM. Handles the XML subset the level files use: elements, text, comments,
+// CDATA, the declaration and the predefined entities. Attributes are skipped.
+// Produces the same representation as the tinyxml2 loader, VQEngine::ParseSceneFile():
+// when an element repeats in a record, the first one is used.
+//
+class SceneStreamingParser
+{
+public:
+	static bool ParseFile(const std::string& SceneFile, FSceneRepresentation& SceneRep);
+	static bool Parse(const char* pText, size_t Length, FSceneRepresentation& SceneRep);
+};
+
+
+//
+// BINARY SCENE FILE
+//
+// Scene representation in a single file, memory-mapped for reading:
+//
+//  [FHeader][FCameraRecord x NumCameras][FLightRecord x NumLights][FMaterialRecord x NumMaterials][FObjectRecord x NumObjects][string table]
+//
+// Records are fixed size and hold the parsed values, strings are offsets into a table of
+// deduplicated null-terminated strings. Reading a file gives back the exact representation
+// it was written from.
+//
+class BinarySceneFile
+{
+public:
+	static bool Write(const std::string& FilePath, const FSceneRepresentation& SceneRep);
+	static bool Read(const std::string& FilePath, FSceneRepresentation& SceneRep);
+	static bool Read(const void* pData, size_t Size, FSceneRepresentation& SceneRep);
+
+	// Data/Levels/Sponza.xml -> Cache/Levels/Sponza.vqscene
+	static std::string GetFilePath(const std::string& SceneFile);
+	static bool        IsUpToDate(const std::string& FilePath, const std::string& SceneFile);
+
+	// Field-wise comparison, floats are compared bitwise
+	static bool IsEqual(const FSceneRepresentation& l, const FSceneRepresentation& r);
+
+private:
+	static constexpr uint32 MAGIC   = 0x43535156; // "VQSC"
+	static constexpr uint32 VERSION = 1;
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumCameras;
+		uint32 NumLights;
+		uint32 NumMaterials;
+		uint32 NumObjects;
+		uint32 SceneName;            // string table offset
+		uint32 EnvironmentMapPreset; // string table offset
+		uint64 StringTableOffset;    // from the beginning of the file
+		uint64 StringTableSize;
+	};
+	struct FTransformRecord
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 RotationV;
+		float             RotationS;
+		DirectX::XMFLOAT3 Scale;
+	};
+	struct FCameraRecord
+	{
+		float  x, y, z;
+		float  Yaw, Pitch;
+		float  ViewportWidth;
+		float  ViewportHeight;
+		float  NearZ;
+		float  FarZ;
+		float  FieldOfView;
+		uint32 bPerspectiveProjection;
+		uint32 bInitializeCameraController;
+		uint32 ControllerType;
+		float  TranslationSpeed;
+		float  AngularSpeed;
+		float  Drag;
+	};
+	struct FLightRecord
+	{
+		DirectX::XMFLOAT3 Position;
+		float             Range;
+		DirectX::XMFLOAT3 RotationV;
+		float             RotationS;
+		DirectX::XMFLOAT3 RenderScale;
+		uint32            bEnabled;
+		uint32            bCastingShadows;
+		uint32            Mobility;
+		uint32            Type;
+		DirectX::XMFLOAT3 Color;
+		float             Brightness;
+		float             DepthBias;
+		float             NearPlane;
+		float             FarPlane;
+		float             TypeSpecificData[3]; // viewport & distance / attenuation / cone angles
+	};
+	struct FMaterialRecord
+	{
+		uint32            Name;
+		DirectX::XMFLOAT3 DiffuseColor;
+		float             Alpha;
+		DirectX::XMFLOAT3 EmissiveColor;
+		float             EmissiveIntensity;
+		float             Metalness;
+		float             Roughness;
+		uint32            DiffuseMapFilePath;
+		uint32            NormalMapFilePath;
+		uint32            EmissiveMapFilePath;
+		uint32            AlphaMaskMapFilePath;
+		uint32            MetallicMapFilePath;
+		uint32            RoughnessMapFilePath;
+		uint32            AOMapFilePath;
+	};
+	struct FObjectRecord
+	{
+		FTransformRecord tf;
+		uint32           ModelName;
+		uint32           ModelFilePath;
+		uint32           BuiltinMeshName;
+		uint32           MaterialName;
+		uint32           bOccluder;
+	};
+};
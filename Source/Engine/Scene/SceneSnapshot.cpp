@@ -0,0 +1,340 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "SceneSnapshot.h"
+#include "Transform.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/utils.h"
+
+#include "../Core/Memory.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include <Windows.h>
+
+namespace
+{
+	constexpr uint32 MakeChunkTag(char a, char b, char c, char d) { return uint32(a) | (uint32(b) << 8) | (uint32(c) << 16) | (uint32(d) << 24); }
+	constexpr uint32 CHUNK_TRANSFORMS        = MakeChunkTag('T', 'R', 'F', 'M');
+	constexpr uint32 CHUNK_OBJECTS           = MakeChunkTag('O', 'B', 'J', 'S');
+	constexpr uint32 CHUNK_MODELS            = MakeChunkTag('M', 'D', 'L', 'S');
+	constexpr uint32 CHUNK_MESH_MATERIALS    = MakeChunkTag('M', 'S', 'H', 'M');
+	constexpr uint32 CHUNK_MATERIALS         = MakeChunkTag('M', 'A', 'T', 'S');
+	constexpr uint32 CHUNK_LIGHTS            = MakeChunkTag('L', 'G', 'T', 'S');
+	constexpr uint32 CHUNK_DIRECTIONAL_LIGHT = MakeChunkTag('D', 'L', 'G', 'T');
+	constexpr uint32 CHUNK_CAMERAS           = MakeChunkTag('C', 'A', 'M', 'S');
+	constexpr uint32 CHUNK_SELECTED_CAMERA   = MakeChunkTag('S', 'C', 'A', 'M');
+	constexpr uint32 CHUNK_STRING_TABLE      = MakeChunkTag('S', 'T', 'R', 'S');
+	constexpr size_t CHUNK_ALIGNMENT         = 8;
+
+	static_assert(std::is_trivially_copyable_v<Light>          , "Lights are saved w/ memcpy");
+	static_assert(std::is_trivially_copyable_v<FCameraTrackKey>, "Cameras are saved w/ memcpy");
+
+	template<class T> inline bool IsBitwiseEqual(const T& l, const T& r) { return memcmp(&l, &r, sizeof(T)) == 0; }
+
+	bool IsEqual(const Light& l, const Light& r) // skips the padding bytes
+	{
+		return IsBitwiseEqual(l.Position, r.Position) && IsBitwiseEqual(l.Range, r.Range)
+			&& IsBitwiseEqual(l.RotationQuaternion.V, r.RotationQuaternion.V) && IsBitwiseEqual(l.RotationQuaternion.S, r.RotationQuaternion.S)
+			&& IsBitwiseEqual(l.RenderScale, r.RenderScale)
+			&& l.bEnabled == r.bEnabled && l.bCastingShadows == r.bCastingShadows && l.Mobility == r.Mobility && l.Type == r.Type
+			&& IsBitwiseEqual(l.Color, r.Color) && IsBitwiseEqual(l.Brightness, r.Brightness)
+			&& IsBitwiseEqual(l.ShadowData.DepthBias, r.ShadowData.DepthBias)
+			&& IsBitwiseEqual(l.ShadowData.NearPlane, r.ShadowData.NearPlane)
+			&& IsBitwiseEqual(l.ShadowData.FarPlane, r.ShadowData.FarPlane)
+			&& IsBitwiseEqual(l.ViewportX, r.ViewportX) && IsBitwiseEqual(l.ViewportY, r.ViewportY) && IsBitwiseEqual(l.DistanceFromOrigin, r.DistanceFromOrigin);
+	}
+
+	// the records and camera keys are 4-byte fields w/o padding, arrays of them are compared w/ a single memcmp
+	template<class T> bool IsEqual(const std::vector<T>& l, const std::vector<T>& r)
+	{
+		return l.size() == r.size() && (l.empty() || memcmp(l.data(), r.data(), sizeof(T) * l.size()) == 0);
+	}
+	template<> bool IsEqual(const std::vector<Light>& l, const std::vector<Light>& r)
+	{
+		if (l.size() != r.size())
+			return false;
+		for (size_t i = 0; i < l.size(); ++i)
+			if (!IsEqual(l[i], r[i]))
+				return false;
+		return true;
+	}
+
+	template<class T>
+	void WriteChunk(std::ofstream& file, uint32& NumChunks, uint32 Tag, const T* pElements, size_t NumElements)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "");
+		constexpr char PADDING[CHUNK_ALIGNMENT] = {};
+		const size_t Size = sizeof(T) * NumElements;
+		const SceneSnapshot::FChunkHeader Header = { Tag, static_cast<uint32>(sizeof(T)), static_cast<uint64>(NumElements) };
+		file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		file.write(reinterpret_cast<const char*>(pElements), Size);
+		file.write(PADDING, AlignTo(Size, CHUNK_ALIGNMENT) - Size);
+		++NumChunks;
+	}
+	template<class T>
+	bool ReadChunk(const char* pData, uint32 ElementSize, uint64 NumElements, std::vector<T>& Elements)
+	{
+		if (ElementSize != sizeof(T))
+			return false;
+		Elements.resize(static_cast<size_t>(NumElements));
+		if (NumElements > 0)
+			memcpy(Elements.data(), pData, sizeof(T) * static_cast<size_t>(NumElements));
+		return true;
+	}
+}
+
+
+//
+// FSceneSnapshot
+//
+uint32 FSceneSnapshot::AddString(const std::string& Str)
+{
+	if (Str.empty())
+		return 0;
+	const uint32 Offset = static_cast<uint32>(StringTable.size());
+	StringTable.append(Str.c_str(), Str.size() + 1);
+	return Offset;
+}
+
+void FSceneSnapshot::Clear()
+{
+	Transforms.clear();
+	Objects.clear();
+	Models.clear();
+	MeshMaterials.clear();
+	Materials.clear();
+	Lights.clear();
+	DirectionalLight = {};
+	Cameras.clear();
+	iSelectedCamera = 0;
+	StringTable.assign(1, '\0');
+}
+
+
+//
+// SceneSnapshot
+//
+bool SceneSnapshot::Save(const std::string& FilePath, const FSceneSnapshot& s)
+{
+	std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("SceneSnapshot: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+
+	FHeader Header = {};
+	Header.Magic   = MAGIC;
+	Header.Version = VERSION;
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header)); // NumChunks is patched below
+
+	uint32& n = Header.NumChunks;
+	WriteChunk(file, n, CHUNK_TRANSFORMS       , s.Transforms.data()   , s.Transforms.size());
+	WriteChunk(file, n, CHUNK_OBJECTS          , s.Objects.data()      , s.Objects.size());
+	WriteChunk(file, n, CHUNK_MODELS           , s.Models.data()       , s.Models.size());
+	WriteChunk(file, n, CHUNK_MESH_MATERIALS   , s.MeshMaterials.data(), s.MeshMaterials.size());
+	WriteChunk(file, n, CHUNK_MATERIALS        , s.Materials.data()    , s.Materials.size());
+	WriteChunk(file, n, CHUNK_LIGHTS           , s.Lights.data()       , s.Lights.size());
+	WriteChunk(file, n, CHUNK_DIRECTIONAL_LIGHT, &s.DirectionalLight   , 1);
+	WriteChunk(file, n, CHUNK_CAMERAS          , s.Cameras.data()      , s.Cameras.size());
+	WriteChunk(file, n, CHUNK_SELECTED_CAMERA  , &s.iSelectedCamera    , 1);
+	WriteChunk(file, n, CHUNK_STRING_TABLE     , s.StringTable.data()  , s.StringTable.size());
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	return file.good();
+}
+
+bool SceneSnapshot::Load(const std::string& FilePath, FSceneSnapshot& Snapshot)
+{
+	HANDLE hFile = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		Log::Error("SceneSnapshot: couldn't open %s", FilePath.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER FileSize = {};
+	HANDLE hMapping = NULL;
+	const void* pView = nullptr;
+	if (GetFileSizeEx(hFile, &FileSize) && FileSize.QuadPart > 0)
+	{
+		hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		pView = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	}
+
+	const bool bLoaded = pView && Load(pView, static_cast<size_t>(FileSize.QuadPart), Snapshot);
+	if (!pView)
+		Log::Error("SceneSnapshot: couldn't map %s", FilePath.c_str());
+	else if (!bLoaded)
+		Log::Error("SceneSnapshot: %s is invalid or written by a different version", FilePath.c_str());
+
+	if (pView)    UnmapViewOfFile(pView);
+	if (hMapping) CloseHandle(hMapping);
+	CloseHandle(hFile);
+	return bLoaded;
+}
+
+bool SceneSnapshot::Load(const void* pData, size_t Size, FSceneSnapshot& s)
+{
+	static_assert(sizeof(FChunkHeader) == 16 && sizeof(FHeader) % CHUNK_ALIGNMENT == 0, "");
+	const char* pBytes = static_cast<const char*>(pData);
+	if (Size < sizeof(FHeader))
+		return false;
+
+	const FHeader* pHeader = reinterpret_cast<const FHeader*>(pBytes);
+	if (pHeader->Magic != MAGIC || pHeader->Version != VERSION)
+		return false;
+
+	s.Clear();
+	size_t Offset = sizeof(FHeader);
+	for (uint32 iChunk = 0; iChunk < pHeader->NumChunks; ++iChunk)
+	{
+		if (Offset + sizeof(FChunkHeader) > Size)
+			return false;
+		FChunkHeader Chunk;
+		memcpy(&Chunk, pBytes + Offset, sizeof(Chunk));
+		Offset += sizeof(FChunkHeader);
+
+		const uint64 ChunkSize = static_cast<uint64>(Chunk.ElementSize) * Chunk.NumElements;
+		if (Chunk.ElementSize == 0 || Chunk.NumElements > Size || ChunkSize > Size - Offset)
+			return false;
+		const char* pElements = pBytes + Offset;
+
+		std::vector<Light> DirectionalLight;
+		std::vector<int>   SelectedCamera;
+		std::vector<char>  StringTable;
+		bool bValidChunk = true;
+		switch (Chunk.Tag)
+		{
+		case CHUNK_TRANSFORMS       : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.Transforms); break;
+		case CHUNK_OBJECTS          : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.Objects); break;
+		case CHUNK_MODELS           : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.Models); break;
+		case CHUNK_MESH_MATERIALS   : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.MeshMaterials); break;
+		case CHUNK_MATERIALS        : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.Materials); break;
+		case CHUNK_LIGHTS           : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.Lights); break;
+		case CHUNK_CAMERAS          : bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, s.Cameras); break;
+		case CHUNK_DIRECTIONAL_LIGHT:
+			bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, DirectionalLight) && DirectionalLight.size() == 1;
+			if (bValidChunk) s.DirectionalLight = DirectionalLight[0];
+			break;
+		case CHUNK_SELECTED_CAMERA:
+			bValidChunk = ReadChunk(pElements, Chunk.ElementSize, Chunk.NumElements, SelectedCamera) && SelectedCamera.size() == 1;
+			if (bValidChunk) s.iSelectedCamera = SelectedCamera[0];
+			break;
+		case CHUNK_STRING_TABLE:
+			bValidChunk = Chunk.ElementSize == 1 && Chunk.NumElements > 0 && pElements[Chunk.NumElements - 1] == '\0';
+			if (bValidChunk) s.StringTable.assign(pElements, static_cast<size_t>(Chunk.NumElements));
+			break;
+		default: // unknown chunk, skip
+			break;
+		}
+		if (!bValidChunk)
+			return false;
+
+		Offset += AlignTo(static_cast<size_t>(ChunkSize), CHUNK_ALIGNMENT);
+	}
+
+	// validate the references so a restore can't index out of bounds
+	const uint32 NumTransforms = static_cast<uint32>(s.Transforms.size());
+	const uint32 NumModels     = static_cast<uint32>(s.Models.size());
+	const uint32 NumMaterials  = static_cast<uint32>(s.Materials.size());
+	for (const FSceneSnapshot::FObjectRecord& o : s.Objects)
+		if (o.iTransform >= NumTransforms || (o.iModel != FSceneSnapshot::INVALID_INDEX && o.iModel >= NumModels))
+			return false;
+	for (const FSceneSnapshot::FModelRecord& m : s.Models)
+		if (static_cast<uint64>(m.iFirstMeshMaterial) + m.NumOpaqueMeshes + m.NumTransparentMeshes > s.MeshMaterials.size())
+			return false;
+	for (const FSceneSnapshot::FMeshMaterialRecord& mm : s.MeshMaterials)
+		if (mm.iMaterial != FSceneSnapshot::INVALID_INDEX && mm.iMaterial >= NumMaterials)
+			return false;
+	return true;
+}
+
+void SceneSnapshot::CaptureObjects(const std::vector<GameObject*>& pObjects, const std::vector<Transform*>& pTransforms, const std::unordered_map<ModelID, uint32>& ModelIndices, FSceneSnapshot& s)
+{
+	s.Transforms.resize(pTransforms.size());
+	for (size_t i = 0; i < pTransforms.size(); ++i)
+	{
+		const Transform& tf = *pTransforms[i];
+		s.Transforms[i] = { tf._position, tf._rotation.V, tf._rotation.S, tf._scale };
+	}
+
+	s.Objects.resize(pObjects.size());
+	for (size_t i = 0; i < pObjects.size(); ++i)
+	{
+		const GameObject& obj = *pObjects[i];
+		auto itModel = ModelIndices.find(obj.mModelID);
+		FSceneSnapshot::FObjectRecord& r = s.Objects[i];
+		r.iTransform          = static_cast<uint32>(obj.mTransformID);
+		r.iModel              = itModel == ModelIndices.end() ? FSceneSnapshot::INVALID_INDEX : itModel->second;
+		r.LocalSpaceBoundsMin = obj.mLocalSpaceBoundingBox.ExtentMin;
+		r.LocalSpaceBoundsMax = obj.mLocalSpaceBoundingBox.ExtentMax;
+		r.bOccluder           = obj.mbOccluder ? 1u : 0u;
+	}
+}
+
+void SceneSnapshot::RestoreObjects(const FSceneSnapshot& s, const std::vector<ModelID>& ModelIDs
+	, MemoryPool<GameObject>& GameObjectPool, MemoryPool<Transform>& TransformPool
+	, std::vector<GameObject*>& pObjects, std::vector<Transform*>& pTransforms
+)
+{
+	for (Transform* pTf : pTransforms) TransformPool.Free(pTf);
+	for (GameObject* pObj : pObjects) GameObjectPool.Free(pObj);
+
+	pTransforms.resize(s.Transforms.size());
+	for (size_t i = 0; i < s.Transforms.size(); ++i)
+	{
+		const FSceneSnapshot::FTransformRecord& r = s.Transforms[i];
+		Transform* pTf = TransformPool.Allocate(1);
+		*pTf = Transform(r.Position, Quaternion(r.RotationS, r.RotationV), r.Scale);
+		pTransforms[i] = pTf;
+	}
+
+	pObjects.resize(s.Objects.size());
+	for (size_t i = 0; i < s.Objects.size(); ++i)
+	{
+		const FSceneSnapshot::FObjectRecord& r = s.Objects[i];
+		GameObject* pObj = GameObjectPool.Allocate(1);
+		pObj->mTransformID                     = static_cast<TransformID>(r.iTransform);
+		pObj->mModelID                         = r.iModel == FSceneSnapshot::INVALID_INDEX ? INVALID_ID : ModelIDs[r.iModel];
+		pObj->mLocalSpaceBoundingBox.ExtentMin = r.LocalSpaceBoundsMin;
+		pObj->mLocalSpaceBoundingBox.ExtentMax = r.LocalSpaceBoundsMax;
+		pObj->mbOccluder                       = r.bOccluder != 0;
+		pObjects[i] = pObj;
+	}
+}
+
+bool SceneSnapshot::IsEqual(const FSceneSnapshot& l, const FSceneSnapshot& r)
+{
+	return ::IsEqual(l.Transforms, r.Transforms)
+		&& ::IsEqual(l.Objects, r.Objects)
+		&& ::IsEqual(l.Models, r.Models)
+		&& ::IsEqual(l.MeshMaterials, r.MeshMaterials)
+		&& ::IsEqual(l.Materials, r.Materials)
+		&& ::IsEqual(l.Lights, r.Lights)
+		&& ::IsEqual(l.DirectionalLight, r.DirectionalLight)
+		&& ::IsEqual(l.Cameras, r.Cameras)
+		&& l.iSelectedCamera == r.iSelectedCamera
+		&& l.StringTable == r.StringTable;
+}
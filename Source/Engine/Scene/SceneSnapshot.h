@@ -0,0 +1,148 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Light.h"
+#include "CameraTrack.h"
+#include "GameObject.h"
+#include "../Core/Types.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Transform;
+template<class TObject> class MemoryPool;
+
+//
+// SCENE SNAPSHOT
+//
+// Runtime state of a loaded scene: game objects, transforms, the mesh & material assignments
+// of the models, lights and cameras. Saved and restored at any point of the simulation, e.g. to
+// A/B compare performance from the exact same state or to reproduce a crash.
+//
+// The snapshot doesn't store IDs of the scene, references are indices into its own tables:
+// - ObjectRecord.iTransform indexes Transforms, ObjectRecord.iModel indexes Models
+// - materials are referenced by their index in Materials and matched by name on restore
+// - MeshIDs are stored as is: meshes are the assets of the loaded scene and aren't restored,
+//   assignments of meshes that don't exist in the scene are dropped on restore
+//
+struct FSceneSnapshot
+{
+	static constexpr uint32 INVALID_INDEX = 0xFFFFFFFF;
+
+	struct FTransformRecord
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 RotationV;
+		float             RotationS;
+		DirectX::XMFLOAT3 Scale;
+	};
+	struct FObjectRecord
+	{
+		uint32            iTransform;
+		uint32            iModel;
+		DirectX::XMFLOAT3 LocalSpaceBoundsMin;
+		DirectX::XMFLOAT3 LocalSpaceBoundsMax;
+		uint32            bOccluder;
+	};
+	struct FModelRecord
+	{
+		ModelID ID;                   // ID at capture time, the model is updated in place on restore if the scene still has it
+		uint32  Name;                 // string table offset
+		uint32  Path;                 // string table offset
+		uint32  iFirstMeshMaterial;   // opaque meshes followed by the transparent meshes
+		uint32  NumOpaqueMeshes;
+		uint32  NumTransparentMeshes;
+		uint32  bLoaded;
+	};
+	struct FMeshMaterialRecord
+	{
+		MeshID Mesh;
+		uint32 iMaterial; // INVALID_INDEX if the mesh has no material assigned
+	};
+	struct FMaterialRecord
+	{
+		MaterialID ID;   // ID at capture time, used if the name doesn't match on restore
+		uint32     Name; // string table offset
+	};
+
+	std::vector<FTransformRecord>    Transforms;
+	std::vector<FObjectRecord>       Objects;
+	std::vector<FModelRecord>        Models;
+	std::vector<FMeshMaterialRecord> MeshMaterials;
+	std::vector<FMaterialRecord>     Materials;
+	std::vector<Light>               Lights;
+	Light                            DirectionalLight;
+	std::vector<FCameraTrackKey>     Cameras;
+	int                              iSelectedCamera = 0;
+	std::string                      StringTable = std::string(1, '\0'); // null-terminated strings, offset 0 is ""
+
+	uint32             AddString(const std::string& Str);
+	inline const char* GetString(uint32 Offset) const { return Offset < StringTable.size() ? &StringTable[Offset] : ""; }
+	void               Clear();
+};
+
+
+//
+// SCENE SNAPSHOT FILE
+//
+// Versioned file of chunks, each holding one array of the snapshot as is:
+//
+//  [FHeader][FChunkHeader][elements...][padding to 8 bytes][FChunkHeader][elements...] ...
+//
+// Saving and loading are a memcpy per chunk. The chunk headers store the element size so a file
+// written w/ a different record layout is rejected instead of misread, and chunks w/ an unknown
+// tag are skipped.
+//
+class SceneSnapshot
+{
+public:
+	static bool Save(const std::string& FilePath, const FSceneSnapshot& Snapshot);
+	static bool Load(const std::string& FilePath, FSceneSnapshot& Snapshot);
+	static bool Load(const void* pData, size_t Size, FSceneSnapshot& Snapshot);
+
+	// Game objects & transforms <-> snapshot records. Restoring frees the current objects and allocates
+	// the new ones from the pools in snapshot order, so a TransformID is always the transform's index in
+	// the snapshot. ModelIDs[iModel] is the scene's ModelID for a snapshot model.
+	static void CaptureObjects(const std::vector<GameObject*>& pObjects, const std::vector<Transform*>& pTransforms, const std::unordered_map<ModelID, uint32>& ModelIndices, FSceneSnapshot& Snapshot);
+	static void RestoreObjects(const FSceneSnapshot& Snapshot, const std::vector<ModelID>& ModelIDs
+		, MemoryPool<GameObject>& GameObjectPool, MemoryPool<Transform>& TransformPool
+		, std::vector<GameObject*>& pObjects, std::vector<Transform*>& pTransforms
+	);
+
+	// Field-wise comparison, floats are compared bitwise
+	static bool IsEqual(const FSceneSnapshot& l, const FSceneSnapshot& r);
+
+	static constexpr uint32 MAGIC   = 0x53535156; // "VQSS"
+	static constexpr uint32 VERSION = 1;
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumChunks;
+		uint32 Reserved;
+	};
+	struct FChunkHeader
+	{
+		uint32 Tag;
+		uint32 ElementSize;
+		uint64 NumElements;
+	};
+};
@@ -53,6 +53,8 @@ struct FGameObjectRepresentation
 
 	std::string BuiltinMeshName;
 	std::string MaterialName;
+
+	bool bOccluder = false;
 };
 struct FSceneRepresentation
 {
@@ -48,6 +48,7 @@ struct FGraphicsSettings
 	float RenderScale = 1.0f;
 	int   MaxFrameRate = -1; // -1: Auto (RefreshRate x 1.15) | 0: Unlimited | <int>: specified value
 	int   EnvironmentMapResolution = 256;
+	int   TextureMemoryBudgetMB = 0; // 0: Unlimited | <int>: mips of the least recently used textures are evicted beyond this budget
 };
 
 struct FWindowSettings
@@ -75,4 +76,13 @@ struct FEngineSettings
 	int NumAutomatedTestFrames = -1;
 	
 	std::string StartupScene;
+
+	bool bBuildShaderArchive = false;
+
+	std::string CameraTrackRecordFile;    // records the main camera to this file while simulating
+	std::string BenchmarkCameraTrackFile; // plays back the camera track w/ a fixed timestep and quits when done
+	float BenchmarkTimestep = 1.0f / 60.0f;
+	std::string TextureTraceRecordFile;   // records the textures used in each frame to this file, see FTextureVisibilityTrace
+
+	bool bStreamAssets = false; // scene models load in the background w/ placeholders, nearest to the camera first
 };
\ No newline at end of file
@@ -0,0 +1,164 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "ShadowCache.h"
+
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+static uint64 HashBytes(const void* pData, size_t NumBytes, uint64 Hash = 14695981039346656037ull) // FNV-1a
+{
+	const uint8* pBytes = static_cast<const uint8*>(pData);
+	for (size_t i = 0; i < NumBytes; ++i)
+	{
+		Hash ^= pBytes[i];
+		Hash *= 1099511628211ull;
+	}
+	return Hash;
+}
+static uint64 Mix(uint64 h) // splitmix64 finalizer
+{
+	h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27; h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+	return h;
+}
+
+void ShadowCache::Initialize(uint32 NumViews)
+{
+	mViews.clear();
+	mViews.resize(NumViews);
+	mCasters.clear();
+	mFrame = 0;
+	mStats = {};
+}
+
+void ShadowCache::Invalidate(uint32 iView)
+{
+	assert(iView < mViews.size());
+	mViews[iView].bValid = false;
+}
+
+void ShadowCache::InvalidateAll()
+{
+	for (FCachedView& View : mViews)
+		View.bValid = false;
+	mCasters.clear();
+}
+
+void ShadowCache::BeginFrame()
+{
+	++mFrame;
+	mStats = {};
+	mStats.NumTrackedCasters = static_cast<uint32>(mCasters.size());
+}
+
+bool ShadowCache::UpdateCaster(uint32 CasterID, const XMMATRIX& matWorld)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, matWorld);
+
+	auto it = mCasters.find(CasterID);
+	if (it == mCasters.end())
+	{
+		// casters that are already there when first seen (scene load) start out static
+		FCasterTransform& Caster = mCasters[CasterID];
+		Caster.matWorld = m;
+		Caster.LastUpdatedFrame = mFrame;
+		++mStats.NumTrackedCasters;
+		return true;
+	}
+
+	FCasterTransform& Caster = it->second;
+	if (Caster.LastUpdatedFrame != mFrame)
+	{
+		Caster.LastUpdatedFrame = mFrame;
+		if (std::memcmp(&Caster.matWorld, &m, sizeof(m)) != 0)
+		{
+			Caster.matWorld = m;
+			Caster.LastChangedFrame = mFrame;
+			++Caster.Version;
+		}
+	}
+	return Caster.Version == 0 || mFrame - Caster.LastChangedFrame >= STATIC_CASTER_FRAME_THRESHOLD;
+}
+
+void ShadowCache::AddCaster(FViewSignature& Signature, uint32 CasterID, uint32 MeshID, bool bDeforming) const
+{
+	auto it = mCasters.find(CasterID);
+	assert(it != mCasters.end()); // UpdateCaster() must be called first
+	const FCasterTransform& Caster = it->second;
+	const bool bStatic = !bDeforming && (Caster.Version == 0 || mFrame - Caster.LastChangedFrame >= STATIC_CASTER_FRAME_THRESHOLD);
+
+	// combined w/ addition so the signature doesn't depend on the order of the casters.
+	// deforming casters hash the frame instead so the dynamic layer is redrawn every frame
+	const uint32 Key[3] = { CasterID, MeshID, bDeforming ? static_cast<uint32>(mFrame) : Caster.Version };
+	const uint64 Hash = Mix(HashBytes(Key, sizeof(Key)));
+	if (bStatic)
+	{
+		Signature.StaticCasterHash += Hash;
+		++Signature.NumStaticCasters;
+	}
+	else
+	{
+		Signature.DynamicCasterHash += Hash;
+		++Signature.NumDynamicCasters;
+	}
+}
+
+ShadowCache::EViewUpdate ShadowCache::UpdateView(uint32 iView, const FViewSignature& Signature)
+{
+	assert(iView < mViews.size());
+	FCachedView& View = mViews[iView];
+
+	EViewUpdate Update = REUSE_CACHED;
+	if (!View.bValid
+		|| View.Signature.LightHash        != Signature.LightHash
+		|| View.Signature.StaticCasterHash != Signature.StaticCasterHash
+		|| View.Signature.NumStaticCasters != Signature.NumStaticCasters)
+	{
+		Update = REDRAW_ALL;
+	}
+	else if (View.Signature.DynamicCasterHash != Signature.DynamicCasterHash
+		|| View.Signature.NumDynamicCasters != Signature.NumDynamicCasters)
+	{
+		Update = REDRAW_DYNAMIC;
+	}
+
+	View.Signature = Signature;
+	View.bValid = true;
+
+	++mStats.NumViews;
+	switch (Update)
+	{
+	case REUSE_CACHED:   ++mStats.NumReusedViews;    break;
+	case REDRAW_DYNAMIC: ++mStats.NumDynamicRedraws; break;
+	case REDRAW_ALL:     ++mStats.NumFullRedraws;    break;
+	default: break;
+	}
+	return Update;
+}
+
+uint64 ShadowCache::HashMatrix(const XMMATRIX& m)
+{
+	XMFLOAT4X4 f;
+	XMStoreFloat4x4(&f, m);
+	return HashBytes(&f, sizeof(f));
+}
@@ -0,0 +1,110 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <DirectXMath.h>
+
+#include <unordered_map>
+#include <vector>
+
+//
+// SHADOW CACHE
+//
+// Decides which shadow views have to be re-rendered. Each view is summarized by a signature:
+// a hash of the light's view-projection matrix and of the casters in the view (ID + transform version),
+// split into static and dynamic casters.
+//
+// - Transforms are versioned by comparing their world matrices frame to frame: a caster whose
+//   transform hasn't changed for STATIC_CASTER_FRAME_THRESHOLD frames is considered static.
+// - Light or static caster set changed: the view is fully re-rendered and its static layer is re-cached.
+// - Dynamic caster set changed: the cached static layer is restored and only the dynamic casters are drawn.
+// - Otherwise the cached depth is kept as is.
+//
+class ShadowCache
+{
+public:
+	static constexpr uint32 STATIC_CASTER_FRAME_THRESHOLD = 30;
+
+	enum EViewUpdate : uint8
+	{
+		REUSE_CACHED = 0, // keep the shadow map
+		REDRAW_DYNAMIC,   // restore the static layer, draw the dynamic casters on top
+		REDRAW_ALL,       // draw the static casters, cache the static layer, draw the dynamic casters
+
+		NUM_VIEW_UPDATE_TYPES
+	};
+
+	struct FViewSignature
+	{
+		uint64 LightHash         = 0;
+		uint64 StaticCasterHash  = 0;
+		uint64 DynamicCasterHash = 0;
+		uint32 NumStaticCasters  = 0;
+		uint32 NumDynamicCasters = 0;
+	};
+
+	struct FStatistics
+	{
+		uint32 NumViews            = 0; // updated this frame
+		uint32 NumReusedViews      = 0;
+		uint32 NumDynamicRedraws   = 0;
+		uint32 NumFullRedraws      = 0;
+		uint32 NumTrackedCasters   = 0;
+	};
+
+public:
+	void Initialize(uint32 NumViews);
+	void Invalidate(uint32 iView);
+	void InvalidateAll(); // also forgets the caster transforms, call on scene unload
+
+	// Per frame: BeginFrame() -> { UpdateCaster() & AddCaster() x NumCasters -> UpdateView() } x NumViews
+	void BeginFrame();
+
+	// Versions the caster's transform, only the first call in a frame can bump the version.
+	// Returns true if the caster is static.
+	bool UpdateCaster(uint32 CasterID, const DirectX::XMMATRIX& matWorld);
+	// Deforming (skinned) casters are always dynamic: their shape changes w/o the transform changing.
+	void AddCaster(FViewSignature& Signature, uint32 CasterID, uint32 MeshID, bool bDeforming = false) const;
+	EViewUpdate UpdateView(uint32 iView, const FViewSignature& Signature);
+
+	static uint64 HashMatrix(const DirectX::XMMATRIX& m);
+
+	inline const FStatistics& GetStatistics() const { return mStats; }
+	inline uint32             GetNumViews()   const { return static_cast<uint32>(mViews.size()); }
+
+private:
+	struct FCasterTransform
+	{
+		DirectX::XMFLOAT4X4 matWorld;
+		uint32 Version          = 0;
+		uint64 LastChangedFrame = 0;
+		uint64 LastUpdatedFrame = 0;
+	};
+	struct FCachedView
+	{
+		FViewSignature Signature;
+		bool bValid = false;
+	};
+
+	std::unordered_map<uint32, FCasterTransform> mCasters;
+	std::vector<FCachedView> mViews;
+	uint64 mFrame = 0;
+	FStatistics mStats;
+};
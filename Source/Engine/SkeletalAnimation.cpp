@@ -0,0 +1,436 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "SkeletalAnimation.h"
+#include "../Renderer/Buffer.h"
+
+#include "Libs/VQUtils/Source/Log.h"
+#include "Libs/VQUtils/Source/Multithreading.h"
+#include "Libs/VQUtils/Source/Timer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <future>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+template<class TFunc>
+static void ParallelForRanges(size_t NumItems, ThreadPool* pWorkerThreadPool, TFunc&& fnProcessRange)
+{
+	const size_t NumThreads = pWorkerThreadPool ? std::min(NumItems, pWorkerThreadPool->GetThreadPoolSize() + 1) : 1;
+	if (NumThreads <= 1)
+	{
+		fnProcessRange(size_t(0), NumItems);
+		return;
+	}
+
+	// contiguous ranges, the first one is processed on this thread
+	std::vector<std::future<void>> Tasks;
+	const size_t NumItemsPerThread = (NumItems + NumThreads - 1) / NumThreads;
+	for (size_t iBegin = NumItemsPerThread; iBegin < NumItems; iBegin += NumItemsPerThread)
+	{
+		const size_t iEnd = std::min(iBegin + NumItemsPerThread, NumItems);
+		Tasks.push_back(pWorkerThreadPool->AddTask([&fnProcessRange, iBegin, iEnd]() { fnProcessRange(iBegin, iEnd); }));
+	}
+	fnProcessRange(size_t(0), std::min(NumItemsPerThread, NumItems));
+	for (std::future<void>& Task : Tasks)
+		Task.wait();
+}
+
+static float WrapTime(float Time, float Duration, bool bLoop)
+{
+	if (Duration <= 0.0f)
+		return 0.0f;
+	if (!bLoop)
+		return std::min(std::max(Time, 0.0f), Duration);
+	const float t = std::fmod(Time, Duration);
+	return t < 0.0f ? t + Duration : t;
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// SKELETON & CLIP
+//
+//------------------------------------------------------------------------------------------------------------------------------
+int32 FSkeleton::FindBone(const std::string& BoneName) const
+{
+	for (size_t i = 0; i < BoneNames.size(); ++i)
+		if (BoneNames[i] == BoneName)
+			return static_cast<int32>(i);
+	return INVALID_BONE;
+}
+
+bool FSkeleton::IsValid() const
+{
+	const size_t NumBones = ParentIndices.size();
+	if (BoneNames.size() != NumBones || BindPose.size() != NumBones || InverseBindMatrices.size() != NumBones || NumBones > 0xFFFF)
+		return false;
+	for (size_t i = 0; i < NumBones; ++i)
+		if (ParentIndices[i] != INVALID_BONE && (ParentIndices[i] < 0 || ParentIndices[i] >= static_cast<int32>(i)))
+			return false;
+	return true;
+}
+
+size_t FAnimationClip::GetSizeInBytes() const
+{
+	return sizeof(FAnimationClip)
+		+ Name.size()
+		+ ConstantPose.size() * sizeof(FBonePose)
+		+ (RotationTracks.size() + TranslationTracks.size() + ScaleTracks.size()) * sizeof(uint16)
+		+ TrackRanges.size() * sizeof(FTrackRange)
+		+ Keys.size() * sizeof(XMUSHORTN4);
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// ANIMATION CLIP COMPRESSOR
+//
+//------------------------------------------------------------------------------------------------------------------------------
+FAnimationClip AnimationClipCompressor::Compress(const FSkeleton& Skeleton, const FRawAnimationClip& RawClip, const FSettings& Settings, FStatistics* pStats)
+{
+	Timer t; t.Start();
+	const uint32 NumBones = Skeleton.GetNumBones();
+
+	FAnimationClip Clip;
+	Clip.Name         = RawClip.Name;
+	Clip.Duration     = std::max(RawClip.Duration, 0.0f);
+	Clip.NumFrames    = Clip.Duration > 0.0f && Settings.SampleRate > 0.0f
+		? std::max(2u, static_cast<uint32>(std::ceil(Clip.Duration * Settings.SampleRate - 1e-3f)) + 1)
+		: 1;
+	Clip.SampleRate   = Clip.NumFrames > 1 ? (Clip.NumFrames - 1) / Clip.Duration : 0.0f;
+	Clip.ConstantPose = Skeleton.BindPose;
+
+	if (RawClip.Tracks.size() != NumBones)
+	{
+		Log::Error("AnimationClipCompressor: clip '%s' has %u tracks for %u bones, using the bind pose"
+			, RawClip.Name.c_str(), static_cast<uint32>(RawClip.Tracks.size()), NumBones);
+		return Clip;
+	}
+
+	// resample, frame major
+	std::vector<FBonePose> Samples(static_cast<size_t>(Clip.NumFrames) * NumBones);
+	FPose Pose;
+	for (uint32 iFrame = 0; iFrame < Clip.NumFrames; ++iFrame)
+	{
+		const float Time = iFrame == Clip.NumFrames - 1 ? Clip.Duration : iFrame / std::max(Clip.SampleRate, 1.0f);
+		SkeletalAnimation::SampleRawPose(Skeleton, RawClip, Time, false, Pose);
+		std::copy(Pose.begin(), Pose.end(), Samples.begin() + static_cast<size_t>(iFrame) * NumBones);
+	}
+	auto fnSample = [&](uint32 iFrame, uint32 iBone) -> FBonePose& { return Samples[static_cast<size_t>(iFrame) * NumBones + iBone]; };
+
+	// fold the constant channels into the constant pose
+	// |q0 - q1| ~= angle / 2 for small angles, cos(angle / 2) would round to 1
+	const XMVECTOR vRotationToleranceSq    = XMVectorReplicate(Settings.RotationTolerance * Settings.RotationTolerance * 0.25f);
+	const XMVECTOR vTranslationToleranceSq = XMVectorReplicate(Settings.TranslationTolerance * Settings.TranslationTolerance);
+	const XMVECTOR vScaleToleranceSq       = XMVectorReplicate(Settings.ScaleTolerance * Settings.ScaleTolerance);
+	uint32 NumConstantChannels = 0;
+	for (uint32 iBone = 0; iBone < NumBones; ++iBone)
+	{
+		const FBonePose& First = fnSample(0, iBone);
+		bool bConstantRotation = true;
+		bool bConstantTranslation = true;
+		bool bConstantScale = true;
+		for (uint32 iFrame = 1; iFrame < Clip.NumFrames; ++iFrame)
+		{
+			// keep the rotations in the hemisphere of their previous key
+			FBonePose& Sample = fnSample(iFrame, iBone);
+			if (XMVectorGetX(XMVector4Dot(Sample.Rotation, fnSample(iFrame - 1, iBone).Rotation)) < 0.0f)
+				Sample.Rotation = XMVectorNegate(Sample.Rotation);
+
+			const XMVECTOR vRotationDeltaSq = XMVectorMin(XMVector4LengthSq(XMVectorSubtract(Sample.Rotation, First.Rotation)), XMVector4LengthSq(XMVectorAdd(Sample.Rotation, First.Rotation)));
+			bConstantRotation    = bConstantRotation && XMVector4LessOrEqual(vRotationDeltaSq, vRotationToleranceSq);
+			bConstantTranslation = bConstantTranslation && XMVector3LessOrEqual(XMVector3LengthSq(XMVectorSubtract(Sample.Translation, First.Translation)), vTranslationToleranceSq);
+			bConstantScale       = bConstantScale && XMVector3LessOrEqual(XMVector3LengthSq(XMVectorSubtract(Sample.Scale, First.Scale)), vScaleToleranceSq);
+		}
+
+		FBonePose& Constant = Clip.ConstantPose[iBone];
+		if (bConstantRotation)    { Constant.Rotation    = XMQuaternionNormalize(First.Rotation); ++NumConstantChannels; }
+		else                      { Clip.RotationTracks.push_back(static_cast<uint16>(iBone)); }
+		if (bConstantTranslation) { Constant.Translation = First.Translation; ++NumConstantChannels; }
+		else                      { Clip.TranslationTracks.push_back(static_cast<uint16>(iBone)); }
+		if (bConstantScale)       { Constant.Scale       = First.Scale; ++NumConstantChannels; }
+		else                      { Clip.ScaleTracks.push_back(static_cast<uint16>(iBone)); }
+	}
+
+	// quantize the tracks over their range
+	const uint32 NumTracks = static_cast<uint32>(Clip.RotationTracks.size() + Clip.TranslationTracks.size() + Clip.ScaleTracks.size());
+	Clip.TrackRanges.resize(NumTracks);
+	Clip.Keys.resize(static_cast<size_t>(Clip.NumFrames) * NumTracks);
+
+	uint32 iTrack = 0;
+	auto fnQuantizeTracks = [&](const std::vector<uint16>& Tracks, XMVECTOR FBonePose::* pChannel)
+	{
+		for (uint16 iBone : Tracks)
+		{
+			XMVECTOR vMin = fnSample(0, iBone).*pChannel;
+			XMVECTOR vMax = vMin;
+			for (uint32 iFrame = 1; iFrame < Clip.NumFrames; ++iFrame)
+			{
+				vMin = XMVectorMin(vMin, fnSample(iFrame, iBone).*pChannel);
+				vMax = XMVectorMax(vMax, fnSample(iFrame, iBone).*pChannel);
+			}
+
+			// constant components dequantize to Min
+			const XMVECTOR vExtent = XMVectorSubtract(vMax, vMin);
+			const XMVECTOR vInvExtent = XMVectorSelect(XMVectorReciprocal(vExtent), XMVectorZero(), XMVectorEqual(vExtent, XMVectorZero()));
+			XMStoreFloat4(&Clip.TrackRanges[iTrack].Min, vMin);
+			XMStoreFloat4(&Clip.TrackRanges[iTrack].Extent, vExtent);
+
+			for (uint32 iFrame = 0; iFrame < Clip.NumFrames; ++iFrame)
+			{
+				const XMVECTOR vNormalized = XMVectorMultiply(XMVectorSubtract(fnSample(iFrame, iBone).*pChannel, vMin), vInvExtent);
+				XMStoreUShortN4(&Clip.Keys[static_cast<size_t>(iFrame) * NumTracks + iTrack], vNormalized);
+			}
+			++iTrack;
+		}
+	};
+	fnQuantizeTracks(Clip.RotationTracks   , &FBonePose::Rotation);
+	fnQuantizeTracks(Clip.TranslationTracks, &FBonePose::Translation);
+	fnQuantizeTracks(Clip.ScaleTracks      , &FBonePose::Scale);
+	assert(iTrack == NumTracks);
+
+	if (pStats)
+	{
+		FStatistics& s = *pStats;
+		s = {};
+		s.NumBones            = NumBones;
+		s.NumFrames           = Clip.NumFrames;
+		s.NumTracks           = NumTracks;
+		s.NumConstantChannels = NumConstantChannels;
+		for (const FRawAnimationClip::FBoneTrack& Track : RawClip.Tracks)
+		{
+			s.RawBytes += Track.Rotations.size()    * sizeof(FRawAnimationClip::FQuaternionKey);
+			s.RawBytes += Track.Translations.size() * sizeof(FRawAnimationClip::FVectorKey);
+			s.RawBytes += Track.Scales.size()       * sizeof(FRawAnimationClip::FVectorKey);
+		}
+		s.CompressedBytes   = Clip.GetSizeInBytes();
+		s.CompressionRatio  = s.CompressedBytes > 0 ? static_cast<float>(s.RawBytes) / s.CompressedBytes : 1.0f;
+		s.CompressionTimeMs = t.Tick() * 1000.0f;
+	}
+	return Clip;
+}
+
+
+//------------------------------------------------------------------------------------------------------------------------------
+//
+// SKELETAL ANIMATION
+//
+//------------------------------------------------------------------------------------------------------------------------------
+void SkeletalAnimation::SamplePose(const FAnimationClip& Clip, float Time, bool bLoop, FPose& OutPose)
+{
+	OutPose = Clip.ConstantPose;
+
+	const uint32 NumTracks = Clip.GetNumTracks();
+	if (NumTracks == 0 || Clip.NumFrames == 0)
+		return;
+
+	const float  Frame   = WrapTime(Time, Clip.Duration, bLoop) * Clip.SampleRate;
+	const uint32 iFrame0 = std::min(static_cast<uint32>(Frame), Clip.NumFrames - 1);
+	const uint32 iFrame1 = std::min(iFrame0 + 1, Clip.NumFrames - 1);
+	const XMVECTOR vAlpha = XMVectorReplicate(std::min(Frame - iFrame0, 1.0f));
+
+	const XMUSHORTN4* pKeys0 = &Clip.Keys[static_cast<size_t>(iFrame0) * NumTracks];
+	const XMUSHORTN4* pKeys1 = &Clip.Keys[static_cast<size_t>(iFrame1) * NumTracks];
+	const FAnimationClip::FTrackRange* pRanges = Clip.TrackRanges.data();
+
+	// the range is linear: interpolate the normalized keys, then dequantize once
+	auto fnSampleTrack = [&](uint32 iTrack)
+	{
+		const XMVECTOR vKey = XMVectorLerpV(XMLoadUShortN4(&pKeys0[iTrack]), XMLoadUShortN4(&pKeys1[iTrack]), vAlpha);
+		return XMVectorMultiplyAdd(vKey, XMLoadFloat4(&pRanges[iTrack].Extent), XMLoadFloat4(&pRanges[iTrack].Min));
+	};
+
+	uint32 iTrack = 0;
+	for (uint16 iBone : Clip.RotationTracks)    OutPose[iBone].Rotation    = XMQuaternionNormalize(fnSampleTrack(iTrack++));
+	for (uint16 iBone : Clip.TranslationTracks) OutPose[iBone].Translation = fnSampleTrack(iTrack++);
+	for (uint16 iBone : Clip.ScaleTracks)       OutPose[iBone].Scale       = fnSampleTrack(iTrack++);
+}
+
+static XMVECTOR LoadKeyValue(const FRawAnimationClip::FVectorKey& Key)     { return XMLoadFloat3(&Key.Value); }
+static XMVECTOR LoadKeyValue(const FRawAnimationClip::FQuaternionKey& Key) { return XMLoadFloat4(&Key.Value); }
+
+// keys are sorted by time
+template<class TKey, class TFunc>
+static XMVECTOR SampleRawKeys(const std::vector<TKey>& Keys, float Time, XMVECTOR vDefault, TFunc&& fnInterpolate)
+{
+	if (Keys.empty())
+		return vDefault;
+	if (Keys.size() == 1 || Time <= Keys.front().Time)
+		return LoadKeyValue(Keys.front());
+	if (Time >= Keys.back().Time)
+		return LoadKeyValue(Keys.back());
+
+	auto it = std::upper_bound(Keys.begin(), Keys.end(), Time, [](float t, const TKey& k) { return t < k.Time; });
+	const TKey& k0 = *(it - 1);
+	const TKey& k1 = *it;
+	const float dt = k1.Time - k0.Time;
+	return fnInterpolate(LoadKeyValue(k0), LoadKeyValue(k1), dt > 0.0f ? (Time - k0.Time) / dt : 0.0f);
+}
+
+void SkeletalAnimation::SampleRawPose(const FSkeleton& Skeleton, const FRawAnimationClip& RawClip, float Time, bool bLoop, FPose& OutPose)
+{
+	OutPose = Skeleton.BindPose;
+	if (RawClip.Tracks.size() != OutPose.size())
+		return;
+
+	const float t = WrapTime(Time, RawClip.Duration, bLoop);
+	auto fnSlerp = [](XMVECTOR q0, XMVECTOR q1, float a) { return XMQuaternionSlerp(q0, q1, a); };
+	auto fnLerp  = [](XMVECTOR v0, XMVECTOR v1, float a) { return XMVectorLerp(v0, v1, a); };
+	for (size_t iBone = 0; iBone < OutPose.size(); ++iBone)
+	{
+		const FRawAnimationClip::FBoneTrack& Track = RawClip.Tracks[iBone];
+		FBonePose& Bone = OutPose[iBone];
+		Bone.Rotation    = XMQuaternionNormalize(SampleRawKeys(Track.Rotations, t, Bone.Rotation, fnSlerp));
+		Bone.Translation = SampleRawKeys(Track.Translations, t, Bone.Translation, fnLerp);
+		Bone.Scale       = SampleRawKeys(Track.Scales, t, Bone.Scale, fnLerp);
+	}
+}
+
+void SkeletalAnimation::BlendPoses(const FPose& PoseA, const FPose& PoseB, float Weight, FPose& OutPose)
+{
+	assert(PoseA.size() == PoseB.size());
+	OutPose.resize(PoseA.size());
+
+	const XMVECTOR vWeight = XMVectorReplicate(Weight);
+	const XMVECTOR vZero = XMVectorZero();
+	for (size_t i = 0; i < PoseA.size(); ++i)
+	{
+		const FBonePose& a = PoseA[i];
+		const FBonePose& b = PoseB[i];
+
+		// shortest path: bring B's rotation into A's hemisphere
+		const XMVECTOR vFlip = XMVectorLess(XMVector4Dot(a.Rotation, b.Rotation), vZero);
+		const XMVECTOR qB = XMVectorSelect(b.Rotation, XMVectorNegate(b.Rotation), vFlip);
+
+		const XMVECTOR R = XMQuaternionNormalize(XMVectorLerpV(a.Rotation, qB, vWeight));
+		const XMVECTOR T = XMVectorLerpV(a.Translation, b.Translation, vWeight);
+		const XMVECTOR S = XMVectorLerpV(a.Scale, b.Scale, vWeight);
+		OutPose[i] = { R, T, S };
+	}
+}
+
+void SkeletalAnimation::CalculateModelSpaceMatrices(const FSkeleton& Skeleton, const FPose& LocalPose, std::vector<XMMATRIX>& OutModelSpaceMatrices)
+{
+	const uint32 NumBones = Skeleton.GetNumBones();
+	assert(LocalPose.size() == NumBones);
+	OutModelSpaceMatrices.resize(NumBones);
+
+	for (uint32 i = 0; i < NumBones; ++i)
+	{
+		// S * R * T, scaling the rotation rows instead of multiplying the matrices
+		const FBonePose& Bone = LocalPose[i];
+		XMMATRIX m = XMMatrixRotationQuaternion(Bone.Rotation);
+		m.r[0] = XMVectorMultiply(m.r[0], XMVectorSplatX(Bone.Scale));
+		m.r[1] = XMVectorMultiply(m.r[1], XMVectorSplatY(Bone.Scale));
+		m.r[2] = XMVectorMultiply(m.r[2], XMVectorSplatZ(Bone.Scale));
+		m.r[3] = XMVectorSetW(Bone.Translation, 1.0f);
+
+		const int32 iParent = Skeleton.ParentIndices[i];
+		OutModelSpaceMatrices[i] = iParent == INVALID_BONE ? m : XMMatrixMultiply(m, OutModelSpaceMatrices[iParent]);
+	}
+}
+
+void SkeletalAnimation::CalculateSkinningMatrices(const FSkeleton& Skeleton, const std::vector<XMMATRIX>& ModelSpaceMatrices, XMFLOAT4X4* pOutPalette)
+{
+	assert(ModelSpaceMatrices.size() == Skeleton.GetNumBones());
+	for (size_t i = 0; i < ModelSpaceMatrices.size(); ++i)
+		XMStoreFloat4x4(&pOutPalette[i], XMMatrixMultiply(XMLoadFloat4x4(&Skeleton.InverseBindMatrices[i]), ModelSpaceMatrices[i]));
+}
+
+void SkeletalAnimation::EvaluateInstances(const FSkeleton& Skeleton, const FAnimationInstance* pInstances, uint32 NumInstances, XMFLOAT4X4* pOutPalettes, ThreadPool* pWorkerThreadPool, FStatistics* pStats)
+{
+	Timer t; t.Start();
+	const uint32 NumBones = Skeleton.GetNumBones();
+
+	ParallelForRanges(NumInstances, pWorkerThreadPool, [&](size_t iBegin, size_t iEnd)
+	{
+		// scratch memory, reused by the instances of the range
+		FPose Pose;
+		FPose BlendPose;
+		std::vector<XMMATRIX> ModelSpaceMatrices;
+		for (size_t i = iBegin; i < iEnd; ++i)
+		{
+			const FAnimationInstance& Instance = pInstances[i];
+			assert(!Instance.pClip || Instance.pClip->GetNumBones() == NumBones);
+			assert(!Instance.pBlendClip || Instance.pBlendClip->GetNumBones() == NumBones);
+
+			if (Instance.pClip)
+				SamplePose(*Instance.pClip, Instance.Time, Instance.bLoop, Pose);
+			else
+				Pose = Skeleton.BindPose;
+
+			if (Instance.pBlendClip && Instance.BlendWeight > 0.0f)
+			{
+				SamplePose(*Instance.pBlendClip, Instance.BlendTime, Instance.bLoop, BlendPose);
+				BlendPoses(Pose, BlendPose, std::min(Instance.BlendWeight, 1.0f), Pose);
+			}
+
+			CalculateModelSpaceMatrices(Skeleton, Pose, ModelSpaceMatrices);
+			CalculateSkinningMatrices(Skeleton, ModelSpaceMatrices, pOutPalettes + i * NumBones);
+		}
+	});
+
+	if (pStats)
+	{
+		FStatistics& s = *pStats;
+		s = {};
+		s.NumInstances = NumInstances;
+		s.NumBones     = NumInstances * NumBones;
+		for (uint32 i = 0; i < NumInstances; ++i)
+			s.NumBlendedPoses += pInstances[i].pBlendClip && pInstances[i].BlendWeight > 0.0f ? 1 : 0;
+		s.EvaluationTimeMs = t.Tick() * 1000.0f;
+		s.BonesPerSecond   = s.EvaluationTimeMs > 0.0f ? s.NumBones / (s.EvaluationTimeMs * 0.001) : 0.0;
+	}
+}
+
+void SkeletalAnimation::SkinVertices(const FVertexWithNormalAndTangent* pVertices, const FVertexSkinWeights* pWeights, uint32 NumVertices, const XMFLOAT4X4* pPalette, FVertexWithNormalAndTangent* pOutVertices)
+{
+	for (uint32 v = 0; v < NumVertices; ++v)
+	{
+		// linear blend skinning: blend the palette matrices, then transform
+		const FVertexSkinWeights& w = pWeights[v];
+		XMMATRIX m = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		for (uint32 k = 0; k < MAX_BONE_INFLUENCES; ++k)
+		{
+			if (w.Weights[k] <= 0.0f)
+				continue;
+			const XMMATRIX b = XMLoadFloat4x4(&pPalette[w.BoneIndices[k]]);
+			const XMVECTOR vWeight = XMVectorReplicate(w.Weights[k]);
+			for (int r = 0; r < 4; ++r)
+				m.r[r] = XMVectorMultiplyAdd(b.r[r], vWeight, m.r[r]);
+		}
+
+		// the normals & tangents are transformed w/ the 3x3 part: assumes uniform scaling
+		const FVertexWithNormalAndTangent& In = pVertices[v];
+		const XMVECTOR P = XMVector3Transform(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(In.position)), m);
+		const XMVECTOR N = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(In.normal)), m));
+		const XMVECTOR T = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(In.tangent)), m));
+
+		FVertexWithNormalAndTangent& Out = pOutVertices[v];
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(Out.position), P);
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(Out.normal), N);
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(Out.tangent), T);
+		Out.uv[0] = In.uv[0];
+		Out.uv[1] = In.uv[1];
+	}
+}
+
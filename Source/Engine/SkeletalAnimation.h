@@ -0,0 +1,191 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Core/Types.h"
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <string>
+#include <vector>
+
+struct FVertexWithNormalAndTangent;
+class ThreadPool;
+
+constexpr uint32 MAX_BONE_INFLUENCES = 4;
+constexpr int32  INVALID_BONE = -1;
+
+// local transform of a bone, kept in SIMD registers for the pose evaluation
+struct FBonePose
+{
+	DirectX::XMVECTOR Rotation;    // quaternion
+	DirectX::XMVECTOR Translation;
+	DirectX::XMVECTOR Scale;
+};
+using FPose = std::vector<FBonePose>;
+
+struct FSkeleton
+{
+	std::vector<std::string>         BoneNames;
+	std::vector<int32>               ParentIndices;       // parents precede their children, INVALID_BONE for the roots
+	FPose                            BindPose;            // local transforms the skins were bound with
+	std::vector<DirectX::XMFLOAT4X4> InverseBindMatrices; // model space -> bone space in the bind pose, row vectors
+
+	inline uint32 GetNumBones() const { return static_cast<uint32>(ParentIndices.size()); }
+	int32 FindBone(const std::string& BoneName) const;
+	bool  IsValid() const;
+};
+
+struct FVertexSkinWeights
+{
+	uint16 BoneIndices[MAX_BONE_INFLUENCES];
+	float  Weights[MAX_BONE_INFLUENCES];      // sum up to 1, unused influences have a weight of 0
+};
+
+// keyframes as imported: per channel, w/ arbitrary key times
+struct FRawAnimationClip
+{
+	struct FVectorKey     { float Time; DirectX::XMFLOAT3 Value; };
+	struct FQuaternionKey { float Time; DirectX::XMFLOAT4 Value; };
+	struct FBoneTrack // empty channels keep the bind pose
+	{
+		std::vector<FQuaternionKey> Rotations;
+		std::vector<FVectorKey>     Translations;
+		std::vector<FVectorKey>     Scales;
+	};
+
+	std::string             Name;
+	float                   Duration = 0.0f; // seconds
+	std::vector<FBoneTrack> Tracks;          // per bone of the skeleton
+};
+
+// compressed & resampled keyframes, see AnimationClipCompressor
+struct FAnimationClip
+{
+	struct FTrackRange // dequantized key = key * Extent + Min
+	{
+		DirectX::XMFLOAT4 Min;
+		DirectX::XMFLOAT4 Extent;
+	};
+
+	std::string                                    Name;
+	float                                          Duration   = 0.0f; // seconds
+	float                                          SampleRate = 0.0f; // frames per second, the frames span [0, Duration] uniformly
+	uint32                                         NumFrames  = 0;
+	FPose                                          ConstantPose;      // per bone, the animated channels are overwritten when sampling
+	std::vector<uint16>                            RotationTracks;    // bones w/ an animated channel, ascending
+	std::vector<uint16>                            TranslationTracks;
+	std::vector<uint16>                            ScaleTracks;
+	std::vector<FTrackRange>                       TrackRanges;       // rotation, translation then scale tracks
+	std::vector<DirectX::PackedVector::XMUSHORTN4> Keys;              // frame major: the keys of all the tracks of a frame are contiguous
+
+	inline uint32 GetNumBones()  const { return static_cast<uint32>(ConstantPose.size()); }
+	inline uint32 GetNumTracks() const { return static_cast<uint32>(TrackRanges.size()); }
+	size_t GetSizeInBytes() const;
+};
+
+//
+// ANIMATION CLIP COMPRESSOR
+//
+// Converts the imported keyframes into the runtime track layout of FAnimationClip.
+//
+// - Channels are resampled at a uniform rate so sampling doesn't search for keys: a time maps to
+//   2 frames & an interpolation factor.
+// - Channels that don't change over the clip (within tolerance) are folded into the constant pose
+//   and cost nothing when sampling, the others become tracks.
+// - Track keys are quantized to 16 bits per component over the track's range (8 bytes per key) and
+//   stored frame major, so sampling a pose reads 2 contiguous blocks of keys. Rotations are kept in
+//   the hemisphere of their previous key so they can be interpolated w/o a sign check.
+//
+class AnimationClipCompressor
+{
+public:
+	struct FSettings
+	{
+		float SampleRate           = 30.0f;
+		float RotationTolerance    = 1e-4f; // radians
+		float TranslationTolerance = 1e-5f; // units
+		float ScaleTolerance       = 1e-5f;
+	};
+
+	struct FStatistics
+	{
+		uint32 NumBones            = 0;
+		uint32 NumFrames           = 0;
+		uint32 NumTracks           = 0;
+		uint32 NumConstantChannels = 0;
+		uint64 RawBytes            = 0; // time + value of the imported keys
+		uint64 CompressedBytes     = 0;
+		float  CompressionRatio    = 1.0f;
+		float  CompressionTimeMs   = 0.0f;
+	};
+
+public:
+	static FAnimationClip Compress(const FSkeleton& Skeleton, const FRawAnimationClip& RawClip, const FSettings& Settings, FStatistics* pStats = nullptr);
+};
+
+//
+// SKELETAL ANIMATION
+//
+// Evaluates animation poses & skinning matrix palettes on the CPU.
+//
+// - Poses are sampled from the compressed clips w/ DirectXMath SIMD: keys are dequantized w/ a single
+//   multiply-add, positions & scales are lerped and rotations nlerped. Poses can be blended by a weight.
+// - Local poses are concatenated parent first into model space, the skinning palette of a bone is its
+//   inverse bind matrix * its model space matrix (row vectors).
+// - Instances are independent: EvaluateInstances() splits them into contiguous ranges over the worker
+//   threads and the result doesn't depend on the thread count.
+// - SkinVertices() is the CPU reference of the linear blend skinning done on the GPU, see SkinningPass.
+//
+class SkeletalAnimation
+{
+public:
+	struct FAnimationInstance
+	{
+		const FAnimationClip* pClip       = nullptr; // nullptr: bind pose
+		float                 Time        = 0.0f;    // seconds
+		const FAnimationClip* pBlendClip  = nullptr; // blended over pClip by BlendWeight if specified
+		float                 BlendTime   = 0.0f;
+		float                 BlendWeight = 0.0f;
+		bool                  bLoop       = true;
+	};
+
+	struct FStatistics
+	{
+		uint32 NumInstances     = 0;
+		uint32 NumBones         = 0; // evaluated, all instances
+		uint32 NumBlendedPoses  = 0;
+		float  EvaluationTimeMs = 0.0f;
+		double BonesPerSecond   = 0.0;
+	};
+
+public:
+	static void SamplePose(const FAnimationClip& Clip, float Time, bool bLoop, FPose& OutPose);
+	static void SampleRawPose(const FSkeleton& Skeleton, const FRawAnimationClip& RawClip, float Time, bool bLoop, FPose& OutPose); // reference, interpolates the imported keys
+	static void BlendPoses(const FPose& PoseA, const FPose& PoseB, float Weight, FPose& OutPose); // OutPose can alias the inputs
+
+	static void CalculateModelSpaceMatrices(const FSkeleton& Skeleton, const FPose& LocalPose, std::vector<DirectX::XMMATRIX>& OutModelSpaceMatrices);
+	static void CalculateSkinningMatrices(const FSkeleton& Skeleton, const std::vector<DirectX::XMMATRIX>& ModelSpaceMatrices, DirectX::XMFLOAT4X4* pOutPalette);
+
+	// Writes Skeleton.GetNumBones() palette matrices per instance to pOutPalettes, processes the instances
+	// on this thread and pWorkerThreadPool if specified.
+	static void EvaluateInstances(const FSkeleton& Skeleton, const FAnimationInstance* pInstances, uint32 NumInstances, DirectX::XMFLOAT4X4* pOutPalettes, ThreadPool* pWorkerThreadPool = nullptr, FStatistics* pStats = nullptr);
+
+	static void SkinVertices(const FVertexWithNormalAndTangent* pVertices, const FVertexSkinWeights* pWeights, uint32 NumVertices, const DirectX::XMFLOAT4X4* pPalette, FVertexWithNormalAndTangent* pOutVertices);
+};
@@ -23,6 +23,8 @@
 #include "Core/Window.h"
 #include "Core/Events.h"
 #include "Core/Input.h"
+#include "Core/SettingsRegistry.h"
+#include "Core/MemoryTracking.h"
 
 #include "Scene/Scene.h"
 #include "Scene/Mesh.h"
@@ -31,6 +33,9 @@
 
 #include "Settings.h"
 #include "AssetLoader.h"
+#include "CameraBenchmark.h"
+#include "FrameStatistics.h"
+#include "CommandRecordingScheduler.h"
 #include "VQUI.h"
 
 #include "RenderPass/AmbientOcclusion.h"
@@ -38,6 +43,7 @@
 #include "RenderPass/DepthMSAAResolve.h"
 #include "RenderPass/ScreenSpaceReflections.h"
 #include "RenderPass/ApplyReflections.h"
+#include "RenderPass/Skinning.h"
 
 #include "Libs/VQUtils/Source/Multithreading.h"
 #include "Libs/VQUtils/Source/Timer.h"
@@ -136,6 +142,9 @@ struct FRenderingResources_MainWindow : public FRenderingResources
 	TextureID Tex_ShadowMaps_Spot                    = INVALID_ID;
 	TextureID Tex_ShadowMaps_Point                   = INVALID_ID;
 	TextureID Tex_ShadowMaps_Directional             = INVALID_ID;
+	TextureID Tex_ShadowMapCache_Spot                = INVALID_ID; // static caster layers of the shadow cache
+	TextureID Tex_ShadowMapCache_Point               = INVALID_ID;
+	TextureID Tex_ShadowMapCache_Directional         = INVALID_ID;
 
 	TextureID Tex_SceneColorMSAA                     = INVALID_ID;
 	TextureID Tex_SceneColor                         = INVALID_ID;
@@ -361,6 +370,8 @@ public:
 	void SimulationThread_Initialize();
 	void SimulationThread_Exit();
 	void SimulationThread_Tick(const float dt);
+	void InitializeFrameStatistics();
+	void RecordFrameStatistics(float UpdateMs, float UIMs, float RenderMs, float dt);
 
 //-----------------------------------------------------------------------
 	
@@ -375,6 +386,10 @@ public:
 	// Scene Interface
 	// ---------------------------------------------------------
 	void StartLoadingScene(int IndexScene);
+	void SaveSceneSnapshot();
+	void RestoreSceneSnapshot();
+	void DumpMemoryReport();
+	void SaveFrameStatistics();
 	
 	void StartLoadingEnvironmentMap(int IndexEnvMap);
 	void PreFilterEnvironmentMap(ID3D12GraphicsCommandList* pCmd, FEnvironmentMapRenderingResources& env);
@@ -386,6 +401,7 @@ public:
 
 	inline const FResourceNames& GetResourceNames() const { return mResourceNames; }
 	inline AssetLoader& GetAssetLoader() { return mAssetLoader; }
+	inline const FSceneInputActions& GetSceneInputActions() const { return mSceneInputActions; }
 
 
 private:
@@ -432,6 +448,31 @@ private:
 
 	// input
 	std::unordered_map<HWND, Input> mInputStates;
+	InputActionMap                  mInputActionMap;
+	struct FEngineInputActions
+	{
+		ActionID ReleaseMouseCapture;
+		ActionID ToggleWindow_SceneControls;
+		ActionID ToggleWindow_Profiler;
+		ActionID ToggleWindow_GraphicsSettings;
+		ActionID ToggleWindow_DebugPanel;
+		ActionID ToggleWindow_Console;
+		ActionID ToggleAllWindows;
+		ActionID ToggleCAS;
+		ActionID ToggleVSync;
+		ActionID ToggleMSAA;
+		ActionID ToggleGammaCorrection;
+		ActionID ToggleFSR;
+		ActionID LoadNextScene;
+		ActionID LoadPreviousScene;
+		ActionID ReloadScene;
+		ActionID SaveSceneSnapshot;
+		ActionID RestoreSceneSnapshot;
+		ActionID DumpMemoryReport;
+		ActionID SaveFrameStatistics;
+		std::array<ActionID, 4> LoadScene;
+	}                               mInputActions;
+	FSceneInputActions              mSceneInputActions;
 
 	// events 
 	EventQueue_t                    mEventQueue_VQEToWin_Main;
@@ -467,6 +508,7 @@ private:
 
 	// system & settings
 	FEngineSettings                 mSettings;
+	ConsoleVariables                mConsoleVariables; // live views of mSettings, see InitializeConsoleVariables()
 	VQSystemInfo::FSystemInfo       mSysInfo;
 
 	// scene
@@ -474,6 +516,24 @@ private:
 	std::queue<std::string>         mQueue_SceneLoad;
 	int                             mIndex_SelectedScene;
 	std::unique_ptr<Scene>          mpScene;
+	FMemorySnapshot                 mMemorySnapshot_LoadStart; // diffed against at the end of the load
+
+	// camera tracks
+	CameraBenchmark                 mCameraBenchmark;
+	CameraTrack                     mCameraTrackRecording;
+	float                           mCameraTrackRecordTime = 0.0f;
+
+	// frame statistics
+	FrameStatistics                 mFrameStatistics;
+	struct FFrameStatisticsChannels
+	{
+		FrameStatistics::ChannelID UpdateMs;
+		FrameStatistics::ChannelID UIMs;
+		FrameStatistics::ChannelID RenderMs;
+		FrameStatistics::ChannelID CPUFrameMs; // update + ui + render
+		FrameStatistics::ChannelID FrameMs;    // w/ the waits & frame pacing
+		FrameStatistics::ChannelID SceneStats; // first of the FSceneStats channels
+	}                               mFrameStatisticsChannels;
 	
 	// ui
 	ImGuiContext*                   mpImGuiContext;
@@ -495,6 +555,10 @@ private:
 	ScreenSpaceReflectionsPass      mRenderPass_SSR;
 	DepthMSAAResolvePass            mRenderPass_DepthResolve;
 	ApplyReflectionsPass            mRenderPass_ApplyReflections;
+	SkinningPass                    mRenderPass_Skinning;
+
+	// distributes the scene passes over the render workers' command lists, see FSceneCommandRecorder
+	CommandRecordingScheduler       mCommandRecordingScheduler;
 
 	// timer / profiler
 	Timer                           mTimer;
@@ -510,10 +574,12 @@ private:
 private:
 	void                            InitializeInput();
 	void                            InitializeEngineSettings(const FStartupParameters& Params);
+	void                            InitializeConsoleVariables();
 	void                            InitializeWindows(const FStartupParameters& Params);
 	void                            InitializeHDRProfiles();
 	void                            InitializeEnvironmentMaps();
 	void                            InitializeScenes();
+	void                            InitializeCameraTracks();
 	void                            InitializeUI(HWND hwnd);
 	void                            InitializeEngineThreads();
 
@@ -551,13 +617,14 @@ private:
 	//
 	// FRAME RENDERING PIPELINE
 	//
+	void                            RenderSkinnedMeshes(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView);
 	void                            TransitionForSceneRendering(ID3D12GraphicsCommandList* pCmd, FWindowRenderContext& ctx, const FPostProcessParameters& PPParams);
 	void                            RenderDirectionalShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& ShadowView);
 	void                            RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& ShadowView);
 	void                            RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& ShadowView, size_t iBegin, size_t NumPointLights);
-	void                            RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView);
+	void                            RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, size_t iDrawBegin = 0, size_t iDrawEnd = SIZE_MAX);
 	void                            RenderAmbientOcclusion(ID3D12GraphicsCommandList* pCmd, const FSceneView& SceneView);
-	void                            RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, const FPostProcessParameters& PPParams);
+	void                            RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, const FPostProcessParameters& PPParams, size_t iDrawBegin = 0, size_t iDrawEnd = SIZE_MAX);
 	void                            RenderBoundingBoxes(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, bool bMSAA);
 	void                            RenderLightBounds(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, bool bMSAA);
 	void                            ResolveMSAA(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FPostProcessParameters& PPParams);
@@ -581,12 +648,43 @@ private:
 	void                            DrawDebugPanelWindow(FSceneRenderParameters& SceneParams, FPostProcessParameters& PPParams);
 	void                            DrawKeyMappingsWindow();
 	void                            DrawGraphicsSettingsWindow(FSceneRenderParameters& SceneRenderParams, FPostProcessParameters& PPParams);
+	void                            DrawConsoleWindow();
 
 	//
 	// RENDER HELPERS
 	//
-	void                            DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh);
-	void                            DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView);
+	void                            DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh, int iFirstSkinnedVertex = INVALID_ID);
+	void                            DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView, size_t iBegin = 0, size_t iEnd = SIZE_MAX);
+	void                            DrawInstancedMeshRenderCommands(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, UINT PerObjRSBindSlot, size_t iBegin = 0, size_t iEnd = SIZE_MAX);
+	void                            RenderShadowView(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, TextureID TexShadowMap, TextureID TexStaticLayerCache, UINT Subresource, size_t iDrawBegin = 0, size_t iDrawEnd = SIZE_MAX);
+	void                            RenderShadowViewDrawRange(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& SceneShadowView, Light::EType eLightType, size_t iView, size_t iDrawBegin, size_t iDrawEnd);
+	static std::pair<size_t, size_t> GetShadowViewDrawRange(const FSceneShadowView::FShadowView& shadowView); // [begin, end) of the draws to record as decided by the shadow cache
+
+	//
+	// PARALLEL COMMAND RECORDING
+	//
+	struct FSceneCommandRecorder : public FCommandRecorder
+	{
+		enum EPass : uint32
+		{
+			SKINNING = 0,
+			DEPTH_PREPASS,
+			SHADOW_VIEW_POINT,
+			SHADOW_VIEW_SPOT,
+			SHADOW_VIEW_DIRECTIONAL,
+			SCENE_COLOR_SETUP, // AO & barriers
+			SCENE_COLOR,
+		};
+		VQEngine*                     pEngine          = nullptr;
+		FWindowRenderContext*         pCtx             = nullptr;
+		const FSceneView*             pSceneView       = nullptr;
+		const FSceneShadowView*       pSceneShadowView = nullptr;
+		const FPostProcessParameters* pPPParams        = nullptr;
+		bool                          bDownsampleDepth = false;
+
+		void RecordChunk(uint32 iCommandList, const FRecordingWorkItem& WorkItem, uint32 iDrawBegin, uint32 iDrawEnd) override;
+	};
+	void                            ScheduleSceneCommandRecording(const FSceneView& SceneView, const FSceneShadowView& SceneShadowView, uint32 MaxNumCommandLists);
 
 	std::unique_ptr<Window>&        GetWindow(HWND hwnd);
 	const std::unique_ptr<Window>&  GetWindow(HWND hwnd) const;
@@ -635,8 +733,9 @@ private:
 	static std::vector<std::pair<std::string, int>> ParseSceneIndexMappingFile();
 	static std::vector<FEnvironmentMapDescriptor>   ParseEnvironmentMapsFile();
 	static std::vector<FDisplayHDRProfile>          ParseHDRProfilesFile();
-	static FSceneRepresentation                     ParseSceneFile(const std::string& SceneFile);
 public:
+	static FSceneRepresentation                     ParseSceneFile(const std::string& SceneFile);
+	static FSceneRepresentation                     LoadSceneFile(const std::string& SceneFile); // binary scene cache or the streaming parser
 	static std::vector<FMaterialRepresentation>     ParseMaterialFile(const std::string& MaterialFilePath);
 
 public:
@@ -53,12 +53,11 @@ void VQEngine::HandleEngineInput()
 		HWND   hwnd = it->first;
 		Input& input = it->second;
 		auto& pWin = this->GetWindow(hwnd);
-		const bool bIsShiftDown = input.IsKeyDown("Shift");
 
 		//
 		// Process-level input handling
 		//
-		if (input.IsKeyTriggered("Esc"))
+		if (input.IsActionTriggered(mInputActions.ReleaseMouseCapture))
 		{
 			if (pWin->IsMouseCaptured())
 			{
@@ -78,16 +77,16 @@ void VQEngine::HandleUIInput()
 		HWND   hwnd = it->first;
 		Input& input = it->second;
 		auto& pWin = this->GetWindow(hwnd);
-		const bool bIsShiftDown = input.IsKeyDown("Shift");
 
 		if (pWin == mpWinMain)
 		{
-			if (input.IsKeyTriggered("F1")) Toggle(mUIState.bWindowVisible_SceneControls);
-			if (input.IsKeyTriggered("F2")) Toggle(mUIState.bWindowVisible_Profiler);
-			if (input.IsKeyTriggered("F3")) Toggle(mUIState.bWindowVisible_GraphicsSettingsPanel);
-			if (input.IsKeyTriggered("F4")) Toggle(mUIState.bWindowVisible_DebugPanel);
+			if (input.IsActionTriggered(mInputActions.ToggleWindow_SceneControls)) Toggle(mUIState.bWindowVisible_SceneControls);
+			if (input.IsActionTriggered(mInputActions.ToggleWindow_Profiler)) Toggle(mUIState.bWindowVisible_Profiler);
+			if (input.IsActionTriggered(mInputActions.ToggleWindow_GraphicsSettings)) Toggle(mUIState.bWindowVisible_GraphicsSettingsPanel);
+			if (input.IsActionTriggered(mInputActions.ToggleWindow_DebugPanel)) Toggle(mUIState.bWindowVisible_DebugPanel);
+			if (input.IsActionTriggered(mInputActions.ToggleWindow_Console)) Toggle(mUIState.bWindowVisible_Console);
 
-			if (input.IsKeyTriggered("B"))
+			if (input.IsActionTriggered(mInputActions.ToggleCAS))
 			{
 				WaitUntilRenderingFinishes();
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
@@ -109,7 +108,6 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
 	const int FRAME_DATA_INDEX = mNumUpdateLoopsExecuted % NUM_BACK_BUFFERS;
 #endif
-	const bool bIsShiftDown = input.IsKeyDown("Shift");
 	//const bool bIsAltDown = input.IsKeyDown("Alt"); // Alt+Z detection doesn't work, TODO: fix
 	const bool bIsAltDown = (GetKeyState(VK_MENU) & 0x8000) != 0; // Alt+Z detection doesn't work, TODO: fix
 	const bool bMouseLeftTriggered = input.IsMouseTriggered(Input::EMouseButtons::MOUSE_BUTTON_LEFT);
@@ -141,31 +139,39 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 
 	// UI
 	auto Toggle = [](bool& b) {b = !b; };
-	if ((bIsAltDown && input.IsKeyTriggered("Z")) // Alt+Z detection doesn't work, TODO: fix
-		|| (bIsShiftDown && input.IsKeyTriggered("Z"))) // workaround: use shift+z for now
+	if ((bIsAltDown && input.IsKeyTriggered('Z')) // Alt+Z detection doesn't work, TODO: fix
+		|| input.IsActionTriggered(mInputActions.ToggleAllWindows)) // workaround: use shift+z for now
 	{
 		Toggle(mUIState.bHideAllWindows);
 	}
+	if (input.IsActionTriggered(mInputActions.DumpMemoryReport))
+	{
+		this->DumpMemoryReport();
+	}
+	if (input.IsActionTriggered(mInputActions.SaveFrameStatistics))
+	{
+		this->SaveFrameStatistics();
+	}
 
 	// Graphics Settings Controls
-	if (input.IsKeyTriggered("V")) // Vsync
+	if (input.IsActionTriggered(mInputActions.ToggleVSync)) // Vsync
 	{
 		auto& SwapChain = mRenderer.GetWindowSwapChain(hwnd);
 		mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetVSyncEvent>(hwnd, !SwapChain.IsVSyncOn()));
 	}
-	if (input.IsKeyTriggered("M")) // MSAA
+	if (input.IsActionTriggered(mInputActions.ToggleMSAA)) // MSAA
 	{
 		mSettings.gfx.bAntiAliasing = !mSettings.gfx.bAntiAliasing;
 		Log::Info("Toggle MSAA: %d", mSettings.gfx.bAntiAliasing);
 	}
 
-	if (input.IsKeyTriggered("G")) // Gamma
+	if (input.IsActionTriggered(mInputActions.ToggleGammaCorrection)) // Gamma
 	{
 		FPostProcessParameters& PPParams = mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
 		PPParams.TonemapperParams.ToggleGammaCorrection = PPParams.TonemapperParams.ToggleGammaCorrection == 1 ? 0 : 1;
 		Log::Info("Tonemapper: ApplyGamma=%d (SDR-only)", PPParams.TonemapperParams.ToggleGammaCorrection);
 	}
-	if (input.IsKeyTriggered("J")) // FSR
+	if (input.IsActionTriggered(mInputActions.ToggleFSR)) // FSR
 	{
 		WaitUntilRenderingFinishes();
 		FPostProcessParameters& PPParams = mpScene->GetPostProcessParameters(FRAME_DATA_INDEX);
@@ -181,16 +187,15 @@ void VQEngine::HandleMainWindowInput(Input& input, HWND hwnd)
 	// Scene switching
 	if (!mbLoadingLevel)
 	{
-		if (bIsShiftDown)
+		const int NumScenes = static_cast<int>(mResourceNames.mSceneNames.size());
+		if (input.IsActionTriggered(mInputActions.LoadNextScene))     { mIndex_SelectedScene = CircularIncrement(mIndex_SelectedScene, NumScenes);     this->StartLoadingScene(mIndex_SelectedScene); }
+		if (input.IsActionTriggered(mInputActions.LoadPreviousScene)) { mIndex_SelectedScene = CircularDecrement(mIndex_SelectedScene, NumScenes - 1); this->StartLoadingScene(mIndex_SelectedScene); }
+		if (input.IsActionTriggered(mInputActions.ReloadScene))       { this->StartLoadingScene(mIndex_SelectedScene); } // reload scene
+		if (input.IsActionTriggered(mInputActions.SaveSceneSnapshot))    { this->SaveSceneSnapshot(); }
+		if (input.IsActionTriggered(mInputActions.RestoreSceneSnapshot)) { this->RestoreSceneSnapshot(); }
+		for (int i = 0; i < static_cast<int>(mInputActions.LoadScene.size()); ++i)
 		{
-			const int NumScenes = static_cast<int>(mResourceNames.mSceneNames.size());
-			if (input.IsKeyTriggered("PageUp")) { mIndex_SelectedScene = CircularIncrement(mIndex_SelectedScene, NumScenes);     this->StartLoadingScene(mIndex_SelectedScene); }
-			if (input.IsKeyTriggered("PageDown")) { mIndex_SelectedScene = CircularDecrement(mIndex_SelectedScene, NumScenes - 1); this->StartLoadingScene(mIndex_SelectedScene); }
-			if (input.IsKeyTriggered("R")) { this->StartLoadingScene(mIndex_SelectedScene); } // reload scene
+			if (input.IsActionTriggered(mInputActions.LoadScene[i])) { mIndex_SelectedScene = i; this->StartLoadingScene(mIndex_SelectedScene); }
 		}
-		if (input.IsKeyTriggered("1")) { mIndex_SelectedScene = 0; this->StartLoadingScene(mIndex_SelectedScene); }
-		if (input.IsKeyTriggered("2")) { mIndex_SelectedScene = 1; this->StartLoadingScene(mIndex_SelectedScene); }
-		if (input.IsKeyTriggered("3")) { mIndex_SelectedScene = 2; this->StartLoadingScene(mIndex_SelectedScene); }
-		if (input.IsKeyTriggered("4")) { mIndex_SelectedScene = 3; this->StartLoadingScene(mIndex_SelectedScene); }
 	}
 }
\ No newline at end of file
@@ -46,6 +46,7 @@ VQEngine::VQEngine()
 	, mRenderPass_SSR(mRenderer)
 	, mRenderPass_ApplyReflections(mRenderer)
 	, mRenderPass_DepthResolve(mRenderer)
+	, mRenderPass_Skinning(mRenderer)
 {}
 
 void VQEngine::MainThread_Tick()
@@ -61,6 +62,10 @@ void VQEngine::MainThread_Tick()
 			PostQuitMessage(0);
 		}
 	}
+	if (mCameraBenchmark.IsFinished())
+	{
+		PostQuitMessage(0);
+	}
 
 	// Sleep(10);
 
@@ -79,19 +84,28 @@ bool VQEngine::Initialize(const FStartupParameters& Params)
 #endif
 
 	InitializeEngineSettings(Params);
+	mAssetLoader.SetModelStreamingEnabled(mSettings.bStreamAssets);
 	InitializeEnvironmentMaps();
 	InitializeHDRProfiles();
 	float f1 = t.Tick();
 	InitializeWindows(Params);
 	float f3 = t.Tick();
 	InitializeInput();
+	InitializeConsoleVariables();
 	InitializeScenes();
+	InitializeCameraTracks();
+	InitializeFrameStatistics();
 	float f2 = t.Tick();
 	// --------------------------------------------------------
 	// Note: Device should be initialized from WinMain thread, 
 	// otherwise device may be lost if launched from RenderDoc
 	mRenderer.Initialize(mSettings.gfx); // Device, Queues, Heaps, WorkerThreads
 	// --------------------------------------------------------
+	if (!mSettings.TextureTraceRecordFile.empty())
+	{
+		Log::Info("Recording texture visibility trace to %s", mSettings.TextureTraceRecordFile.c_str());
+		mRenderer.StartTextureVisibilityTraceRecording();
+	}
 	InitializeEngineThreads();
 	SetEffectiveFrameRateLimit();
 	float f4 = t.Tick();
@@ -149,6 +163,46 @@ void VQEngine::InitializeInput()
 	Input::InitRawInputDevices(mpWinMain->GetHWND());
 #endif
 
+	// engine hotkeys
+	FEngineInputActions& a = mInputActions;
+	a.ReleaseMouseCapture           = mInputActionMap.RegisterAction("ReleaseMouseCapture"          , { "Esc" });
+	a.ToggleWindow_SceneControls    = mInputActionMap.RegisterAction("ToggleWindow_SceneControls"   , { "F1" });
+	a.ToggleWindow_Profiler         = mInputActionMap.RegisterAction("ToggleWindow_Profiler"        , { "F2" });
+	a.ToggleWindow_GraphicsSettings = mInputActionMap.RegisterAction("ToggleWindow_GraphicsSettings", { "F3" });
+	a.ToggleWindow_DebugPanel       = mInputActionMap.RegisterAction("ToggleWindow_DebugPanel"      , { "F4" });
+	a.ToggleWindow_Console          = mInputActionMap.RegisterAction("ToggleWindow_Console"         , { "F5" });
+	a.ToggleAllWindows              = mInputActionMap.RegisterAction("ToggleAllWindows"             , { "Shift+Z" });
+	a.ToggleCAS                     = mInputActionMap.RegisterAction("ToggleCAS"                    , { "B" });
+	a.ToggleVSync                   = mInputActionMap.RegisterAction("ToggleVSync"                  , { "V" });
+	a.ToggleMSAA                    = mInputActionMap.RegisterAction("ToggleMSAA"                   , { "M" });
+	a.ToggleGammaCorrection         = mInputActionMap.RegisterAction("ToggleGammaCorrection"        , { "G" });
+	a.ToggleFSR                     = mInputActionMap.RegisterAction("ToggleFSR"                    , { "J" });
+	a.LoadNextScene                 = mInputActionMap.RegisterAction("LoadNextScene"                , { "Shift+PageUp" });
+	a.LoadPreviousScene             = mInputActionMap.RegisterAction("LoadPreviousScene"            , { "Shift+PageDown" });
+	a.ReloadScene                   = mInputActionMap.RegisterAction("ReloadScene"                  , { "Shift+R" });
+	a.SaveSceneSnapshot             = mInputActionMap.RegisterAction("SaveSceneSnapshot"            , { "F6" });
+	a.RestoreSceneSnapshot          = mInputActionMap.RegisterAction("RestoreSceneSnapshot"         , { "F7" });
+	a.DumpMemoryReport              = mInputActionMap.RegisterAction("DumpMemoryReport"             , { "F8" });
+	a.SaveFrameStatistics           = mInputActionMap.RegisterAction("SaveFrameStatistics"          , { "F9" });
+	for (size_t i = 0; i < a.LoadScene.size(); ++i)
+	{
+		a.LoadScene[i] = mInputActionMap.RegisterAction("LoadScene" + std::to_string(i), { std::to_string(i + 1) });
+	}
+
+	// scene hotkeys
+	FSceneInputActions& s = mSceneInputActions;
+	s.NextCamera                    = mInputActionMap.RegisterAction("NextCamera"                   , { "C" });
+	s.PreviousCamera                = mInputActionMap.RegisterAction("PreviousCamera"               , { "Shift+C" });
+	s.DumpCameraInfo                = mInputActionMap.RegisterAction("DumpCameraInfo"               , { "Ctrl+C" });
+	s.ToggleLightBounds             = mInputActionMap.RegisterAction("ToggleLightBounds"            , { "L" });
+	s.ToggleMeshBoundingBoxes       = mInputActionMap.RegisterAction("ToggleMeshBoundingBoxes"      , { "N" });
+	s.ToggleGameObjectBoundingBoxes = mInputActionMap.RegisterAction("ToggleGameObjectBoundingBoxes", { "Shift+N" });
+	s.NextEnvironmentMap            = mInputActionMap.RegisterAction("NextEnvironmentMap"           , { "PageUp" });
+	s.PreviousEnvironmentMap        = mInputActionMap.RegisterAction("PreviousEnvironmentMap"       , { "PageDown" });
+	s.ToggleAnimation               = mInputActionMap.RegisterAction("ToggleAnimation"              , { "Space" });
+	s.ResetCamera                   = mInputActionMap.RegisterAction("ResetCamera"                  , { "R" });
+	s.LookAtOrigin                  = mInputActionMap.RegisterAction("LookAtOrigin"                 , { "L" });
+
 	// initialize input states
 	RegisterWindowForInput(mpWinMain);
 	if (mpWinDebug) RegisterWindowForInput(mpWinDebug);
@@ -194,6 +248,7 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	if (paramFile.bOverrideGFXSetting_bMaxFrameRate)               s.gfx.MaxFrameRate        = pf.gfx.MaxFrameRate;
 	if (paramFile.bOverrideGFXSetting_EnvironmentMapResolution)    s.gfx.EnvironmentMapResolution = pf.gfx.EnvironmentMapResolution;
 	if (paramFile.bOverrideGFXSettings_Reflections)                s.gfx.Reflections = pf.gfx.Reflections;
+	if (paramFile.bOverrideGFXSetting_TextureMemoryBudgetMB)       s.gfx.TextureMemoryBudgetMB = pf.gfx.TextureMemoryBudgetMB;
 
 	if (paramFile.bOverrideENGSetting_MainWindowWidth)             s.WndMain.Width            = pf.WndMain.Width;
 	if (paramFile.bOverrideENGSetting_MainWindowHeight)            s.WndMain.Height           = pf.WndMain.Height;
@@ -215,6 +270,7 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	}
 
 	if (paramFile.bOverrideENGSetting_StartupScene)              s.StartupScene = pf.StartupScene;
+	if (paramFile.bOverrideENGSetting_bStreamAssets)             s.bStreamAssets = pf.bStreamAssets;
 
 
 	// Override #1 : if there's command line params
@@ -224,6 +280,7 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	if (Params.bOverrideGFXSetting_RenderScale)                 s.gfx.RenderScale          = p.gfx.RenderScale;
 	if (Params.bOverrideGFXSetting_bMaxFrameRate)               s.gfx.MaxFrameRate         = p.gfx.MaxFrameRate;
 	if (Params.bOverrideGFXSettings_Reflections)                s.gfx.Reflections          = p.gfx.Reflections;
+	if (Params.bOverrideGFXSetting_TextureMemoryBudgetMB)       s.gfx.TextureMemoryBudgetMB = p.gfx.TextureMemoryBudgetMB;
 
 	if (Params.bOverrideENGSetting_MainWindowWidth)             s.WndMain.Width            = p.WndMain.Width;
 	if (Params.bOverrideENGSetting_MainWindowHeight)            s.WndMain.Height           = p.WndMain.Height;
@@ -245,6 +302,35 @@ void VQEngine::InitializeEngineSettings(const FStartupParameters& Params)
 	}
 
 	if (Params.bOverrideENGSetting_StartupScene)             s.StartupScene           = p.StartupScene;
+	if (Params.bOverrideENGSetting_bBuildShaderArchive)      s.bBuildShaderArchive    = p.bBuildShaderArchive;
+	if (Params.bOverrideENGSetting_CameraTrackRecordFile)    s.CameraTrackRecordFile  = p.CameraTrackRecordFile;
+	if (Params.bOverrideENGSetting_BenchmarkCameraTrackFile) s.BenchmarkCameraTrackFile = p.BenchmarkCameraTrackFile;
+	if (Params.bOverrideENGSetting_BenchmarkTimestep)        s.BenchmarkTimestep      = p.BenchmarkTimestep;
+	if (Params.bOverrideENGSetting_bStreamAssets)            s.bStreamAssets          = p.bStreamAssets;
+	if (Params.bOverrideENGSetting_TextureTraceRecordFile)   s.TextureTraceRecordFile = p.TextureTraceRecordFile;
+}
+
+void VQEngine::InitializeConsoleVariables()
+{
+	static constexpr FSettingNamedValue REFLECTIONS_NAMES[] =
+	{
+		  { "Off"     , EReflections::REFLECTIONS_OFF }
+		, { "FFX_SSSR", EReflections::SCREEN_SPACE_REFLECTIONS__FFX }
+		//, { "RayTraced", EReflections::RAY_TRACED_REFLECTIONS } // TODO: enable when ray tracing is added
+	};
+	static constexpr FSettingNamedValue MAX_FRAME_RATE_NAMES[] = // see Settings.h:FGraphicsSettings
+	{
+		  { "Auto"     , -1 }
+		, { "Unlimited",  0 }
+	};
+
+	// only the settings that can change w/o re-creating the device or the windows
+	ConsoleVariables& c = mConsoleVariables;
+	FGraphicsSettings& gfx = mSettings.gfx;
+	c.Register("r.VSync"       , &gfx.bVsync       , "Synchronizes presentation w/ the display refresh", [this]() { mEventQueue_WinToVQE_Renderer.AddItem(std::make_shared<SetVSyncEvent>(mpWinMain->GetHWND(), mSettings.gfx.bVsync)); });
+	c.Register("r.AntiAliasing", &gfx.bAntiAliasing, "MSAAx4");
+	c.Register("r.Reflections" , &gfx.Reflections , "Off | FFX_SSSR", nullptr, REFLECTIONS_NAMES);
+	c.Register("r.MaxFrameRate", &gfx.MaxFrameRate, "Auto | Unlimited | <FPS>", [this]() { SetEffectiveFrameRateLimit(); }, MAX_FRAME_RATE_NAMES);
 }
 
 void VQEngine::InitializeWindows(const FStartupParameters& Params)
@@ -338,6 +424,30 @@ void VQEngine::InitializeScenes()
 	this->StartLoadingScene(mIndex_SelectedScene);
 }
 
+void VQEngine::InitializeCameraTracks()
+{
+	if (!mSettings.BenchmarkCameraTrackFile.empty())
+	{
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+		Log::Warning("Camera track benchmark is not supported w/ pipelined update & render threads, ignoring -Benchmark=%s", mSettings.BenchmarkCameraTrackFile.c_str());
+#else
+		if (mSettings.BenchmarkTimestep <= 0.0f)
+		{
+			Log::Warning("Invalid benchmark timestep %.4f, using 1/60s", mSettings.BenchmarkTimestep);
+			mSettings.BenchmarkTimestep = 1.0f / 60.0f;
+		}
+		mCameraBenchmark.Initialize(mSettings.BenchmarkCameraTrackFile, mSettings.BenchmarkTimestep);
+#endif
+	}
+
+	if (!mSettings.CameraTrackRecordFile.empty())
+	{
+		Log::Info("Recording main camera to %s", mSettings.CameraTrackRecordFile.c_str());
+	}
+	mCameraTrackRecording.Clear();
+	mCameraTrackRecordTime = 0.0f;
+}
+
 void VQEngine::InitializeEngineThreads()
 {
 	const int NUM_SWAPCHAIN_BACKBUFFERS = mSettings.gfx.bUseTripleBuffering ? 3 : 2;
@@ -446,7 +556,9 @@ void VQEngine::RegisterWindowForInput(const std::unique_ptr<Window>& pWnd)
 		return;
 	}
 
-	mInputStates.emplace(pWnd->GetHWND(), std::move(Input()));
+	Input input;
+	input.SetActionMap(&mInputActionMap);
+	mInputStates.emplace(pWnd->GetHWND(), std::move(input));
 }
 
 void VQEngine::UnregisterWindowForInput(const std::unique_ptr<Window>& pWnd)
@@ -116,6 +116,7 @@ void VQEngine::RenderThread_SignalUpdateThread()
 void VQEngine::RenderThread_Tick()
 {
 	SCOPED_CPU_MARKER_C("RenderThread_Tick()", 0xFF007700);
+	SCOPED_MEMORY_TAG(EMemoryTag::Renderer);
 
 	RenderThread_HandleEvents();
 
@@ -165,7 +166,8 @@ void VQEngine::RenderThread_Inititalize()
 		&mRenderPass_SSR,
 		&mRenderPass_ApplyReflections,
 		&mRenderPass_ZPrePass,
-		&mRenderPass_DepthResolve
+		&mRenderPass_DepthResolve,
+		&mRenderPass_Skinning
 	};
 
 	const bool bExclusiveFullscreen_MainWnd = CheckInitialSwapchainResizeRequired(mInitialSwapchainResizeRequiredWindowLookup, mSettings.WndMain, mpWinMain->GetHWND());
@@ -220,10 +222,18 @@ void VQEngine::RenderThread_Inititalize()
 		);
 	}
 
-	// compile PSOs (single-threaded)
-	for (auto& pr : RenderPassPSOLoadDescs)
+	// compile PSOs: render pass PSOs are batched with the builtin PSOs started in mRenderer.Load()
+	for (FPSOCreationTaskParameters& pr : RenderPassPSOLoadDescs)
 	{
-		*pr.pID = mRenderer.CreatePSO_OnThisThread(pr.Desc);
+		mRenderer.EnqueueTask_CreatePSO(std::move(pr));
+	}
+	mRenderer.StartPSOCreationTasks();
+	mRenderer.WaitForPSOCreationTaskQueueCompletion();
+
+	// pack the shaders into the archive if requested, if it doesn't exist yet or if any of the loaded shaders weren't found in it
+	if (mSettings.bBuildShaderArchive || mRenderer.GetNumShaderArchiveMisses() > 0)
+	{
+		mRenderer.BuildShaderArchive();
 	}
 
 
@@ -770,10 +780,6 @@ void VQEngine::RenderThread_LoadResources()
 	{
 		TextureCreateDesc desc("ShadowMaps_Spot");
 		// initialize texture memory
-		constexpr UINT SHADOW_MAP_DIMENSION_SPOT = 1024;
-		constexpr UINT SHADOW_MAP_DIMENSION_POINT = 1024;
-		constexpr UINT SHADOW_MAP_DIMENSION_DIRECTIONAL = 2048;
-
 		desc.d3d12Desc = CD3DX12_RESOURCE_DESC::Tex2D(
 			DXGI_FORMAT_R32_TYPELESS
 			, SHADOW_MAP_DIMENSION_SPOT
@@ -797,19 +803,36 @@ void VQEngine::RenderThread_LoadResources()
 
 		desc.d3d12Desc.Width  = SHADOW_MAP_DIMENSION_DIRECTIONAL;
 		desc.d3d12Desc.Height = SHADOW_MAP_DIMENSION_DIRECTIONAL;
-		desc.d3d12Desc.DepthOrArraySize = 1;
+		desc.d3d12Desc.DepthOrArraySize = NUM_SHADOW_CASCADES__DIRECTIONAL;
 		desc.bCubemap = false;
-		desc.TexName = "ShadowMap_Directional";
+		desc.TexName = "ShadowMaps_Directional";
 		rsc.Tex_ShadowMaps_Directional = mRenderer.CreateTexture(desc);
+
+		// static caster layers of the shadow cache: same layout, only used as copy source/destination
+		desc.ResourceState = D3D12_RESOURCE_STATE_COPY_DEST;
+		desc.TexName = "ShadowMapCache_Directional";
+		rsc.Tex_ShadowMapCache_Directional = mRenderer.CreateTexture(desc);
+
+		desc.d3d12Desc.Width  = SHADOW_MAP_DIMENSION_SPOT;
+		desc.d3d12Desc.Height = SHADOW_MAP_DIMENSION_SPOT;
+		desc.d3d12Desc.DepthOrArraySize = NUM_SHADOWING_LIGHTS__SPOT;
+		desc.TexName = "ShadowMapCache_Spot";
+		rsc.Tex_ShadowMapCache_Spot = mRenderer.CreateTexture(desc);
+
+		desc.d3d12Desc.Width  = SHADOW_MAP_DIMENSION_POINT;
+		desc.d3d12Desc.Height = SHADOW_MAP_DIMENSION_POINT;
+		desc.d3d12Desc.DepthOrArraySize = NUM_SHADOWING_LIGHTS__POINT * 6;
+		desc.TexName = "ShadowMapCache_Point";
+		rsc.Tex_ShadowMapCache_Point = mRenderer.CreateTexture(desc);
 		
 		// initialize DSVs
 		rsc.DSV_ShadowMaps_Spot        = mRenderer.AllocateDSV(NUM_SHADOWING_LIGHTS__SPOT);
 		rsc.DSV_ShadowMaps_Point       = mRenderer.AllocateDSV(NUM_SHADOWING_LIGHTS__POINT * 6);
-		rsc.DSV_ShadowMaps_Directional = mRenderer.AllocateDSV();
+		rsc.DSV_ShadowMaps_Directional = mRenderer.AllocateDSV(NUM_SHADOW_CASCADES__DIRECTIONAL);
 
 		for (int i = 0; i < NUM_SHADOWING_LIGHTS__SPOT; ++i)      mRenderer.InitializeDSV(rsc.DSV_ShadowMaps_Spot , i, rsc.Tex_ShadowMaps_Spot , i);
 		for (int i = 0; i < NUM_SHADOWING_LIGHTS__POINT * 6; ++i) mRenderer.InitializeDSV(rsc.DSV_ShadowMaps_Point, i, rsc.Tex_ShadowMaps_Point, i);
-		mRenderer.InitializeDSV(rsc.DSV_ShadowMaps_Directional, 0, rsc.Tex_ShadowMaps_Directional);
+		for (int i = 0; i < NUM_SHADOW_CASCADES__DIRECTIONAL; ++i)     mRenderer.InitializeDSV(rsc.DSV_ShadowMaps_Directional, i, rsc.Tex_ShadowMaps_Directional, i);
 
 
 		// initialize SRVs
@@ -818,7 +841,7 @@ void VQEngine::RenderThread_LoadResources()
 		rsc.SRV_ShadowMaps_Directional = mRenderer.AllocateSRV();
 		mRenderer.InitializeSRV(rsc.SRV_ShadowMaps_Spot , 0, rsc.Tex_ShadowMaps_Spot, true);
 		mRenderer.InitializeSRV(rsc.SRV_ShadowMaps_Point, 0, rsc.Tex_ShadowMaps_Point, true, true);
-		mRenderer.InitializeSRV(rsc.SRV_ShadowMaps_Directional, 0, rsc.Tex_ShadowMaps_Directional);
+		mRenderer.InitializeSRV(rsc.SRV_ShadowMaps_Directional, 0, rsc.Tex_ShadowMaps_Directional, true);
 	}
 }
 
@@ -869,16 +892,72 @@ void VQEngine::RenderThread_UnloadWindowSizeDependentResources(HWND hwnd)
 //
 // ------------------------------------------------------------------------------------------------------------------------------------------------------------
 
-static uint32_t GetNumShadowViewCmdRecordingThreads(const FSceneShadowView& ShadowView)
+// Work items in GPU submission order: skinning, depth pre-pass, shadow views, AO & scene color.
+// The draw lists are split into balanced chunks and recorded on the render workers, see CommandRecordingScheduler.
+void VQEngine::ScheduleSceneCommandRecording(const FSceneView& SceneView, const FSceneShadowView& SceneShadowView, uint32 MaxNumCommandLists)
 {
-#if RENDER_THREAD__MULTI_THREADED_COMMAND_RECORDING
-	return (ShadowView.ShadowView_Directional.meshRenderCommands.size() > 0 ? 1 : 0) // 1 thread for directional light (assumes long list of mesh render cmds)
-		+ ShadowView.NumPointShadowViews  // each point light view (6x frustums per point light
-		+ (ShadowView.NumSpotShadowViews > 0 ? 1 : 0); // process spot light render lists in own thread
-#else
-	return 0;
-#endif
+	SCOPED_CPU_MARKER("ScheduleSceneCommandRecording");
+	using EPass = FSceneCommandRecorder::EPass;
+	const uint32 NumMainViewDraws = static_cast<uint32>(SceneView.sceneParameters.bInstancedDraws
+		? SceneView.instancedMeshRenderCommands.size()
+		: SceneView.meshRenderCommands.size()
+	);
+
+	std::vector<FRecordingWorkItem> WorkItems;
+	auto fnAddShadowViews = [&WorkItems](EPass ePass, const FSceneShadowView::FShadowView* pShadowViews, uint NumShadowViews)
+	{
+		for (uint i = 0; i < NumShadowViews; ++i)
+		{
+			if (pShadowViews[i].CacheUpdate == ShadowCache::EViewUpdate::REUSE_CACHED)
+				continue;
+			const std::pair<size_t, size_t> DrawRange = GetShadowViewDrawRange(pShadowViews[i]);
+			WorkItems.push_back({ ePass, i, static_cast<uint32>(DrawRange.first), static_cast<uint32>(DrawRange.second), true });
+		}
+	};
+
+	WorkItems.push_back({ EPass::SKINNING, 0, 0, 0, false });
+	WorkItems.push_back({ EPass::DEPTH_PREPASS, 0, 0, NumMainViewDraws, true });
+	fnAddShadowViews(EPass::SHADOW_VIEW_SPOT       , SceneShadowView.ShadowViews_Spot.data()       , SceneShadowView.NumSpotShadowViews);
+	fnAddShadowViews(EPass::SHADOW_VIEW_POINT      , SceneShadowView.ShadowViews_Point.data()      , SceneShadowView.NumPointShadowViews * 6);
+	fnAddShadowViews(EPass::SHADOW_VIEW_DIRECTIONAL, SceneShadowView.ShadowViews_Directional.data(), SceneShadowView.NumDirectionalCascades);
+	WorkItems.push_back({ EPass::SCENE_COLOR_SETUP, 0, 0, 0, false });
+	WorkItems.push_back({ EPass::SCENE_COLOR, 0, 0, NumMainViewDraws, true });
+
+	mCommandRecordingScheduler.Schedule(WorkItems, MaxNumCommandLists);
+}
+
+void VQEngine::FSceneCommandRecorder::RecordChunk(uint32 iCommandList, const FRecordingWorkItem& WorkItem, uint32 iDrawBegin, uint32 iDrawEnd)
+{
+	ID3D12GraphicsCommandList* pCmd = (ID3D12GraphicsCommandList*)pCtx->GetCommandListPtr(CommandQueue::EType::GFX, iCommandList);
+	DynamicBufferHeap* pCBufferHeap = &pCtx->GetConstantBufferHeap(iCommandList);
+	const FRenderingResources_MainWindow& rsc = pEngine->mResources_MainWnd;
+
+	switch (WorkItem.PassID)
+	{
+	case EPass::SKINNING:
+		pEngine->RenderSkinnedMeshes(pCmd, pCBufferHeap, *pSceneView);
+		break;
+	case EPass::DEPTH_PREPASS:
+		pEngine->RenderDepthPrePass(pCmd, pCBufferHeap, *pSceneView, iDrawBegin, iDrawEnd);
+		if (bDownsampleDepth && iDrawEnd == WorkItem.iDrawEnd)
+		{
+			pEngine->DownsampleDepth(pCmd, pCBufferHeap, rsc.Tex_SceneDepth, rsc.SRV_SceneDepth);
+		}
+		break;
+	case EPass::SHADOW_VIEW_POINT:       pEngine->RenderShadowViewDrawRange(pCmd, pCBufferHeap, *pSceneShadowView, Light::EType::POINT      , WorkItem.ViewIndex, iDrawBegin, iDrawEnd); break;
+	case EPass::SHADOW_VIEW_SPOT:        pEngine->RenderShadowViewDrawRange(pCmd, pCBufferHeap, *pSceneShadowView, Light::EType::SPOT       , WorkItem.ViewIndex, iDrawBegin, iDrawEnd); break;
+	case EPass::SHADOW_VIEW_DIRECTIONAL: pEngine->RenderShadowViewDrawRange(pCmd, pCBufferHeap, *pSceneShadowView, Light::EType::DIRECTIONAL, WorkItem.ViewIndex, iDrawBegin, iDrawEnd); break;
+	case EPass::SCENE_COLOR_SETUP:
+		pEngine->RenderAmbientOcclusion(pCmd, *pSceneView);
+		pEngine->TransitionForSceneRendering(pCmd, *pCtx, *pPPParams);
+		break;
+	case EPass::SCENE_COLOR:
+		pEngine->RenderSceneColor(pCmd, pCBufferHeap, *pSceneView, *pPPParams, iDrawBegin, iDrawEnd);
+		break;
+	default: assert(false); break;
+	}
 }
+
 void VQEngine::RenderThread_PreRender()
 {
 	SCOPED_CPU_MARKER("RenderThread_PreRender()");
@@ -896,10 +975,16 @@ void VQEngine::RenderThread_PreRender()
 	const FSceneShadowView& SceneShadowView = mpScene->GetShadowView(FRAME_DATA_INDEX);
 
 #if RENDER_THREAD__MULTI_THREADED_COMMAND_RECORDING
+#if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
+	ThreadPool& WorkerThreads = mWorkers_Render;
+#else
+	ThreadPool& WorkerThreads = mWorkers_Simulation;
+#endif
+	ScheduleSceneCommandRecording(SceneView, SceneShadowView, std::max(1u, static_cast<uint32>(WorkerThreads.GetThreadPoolSize())));
+
 	const uint32_t NumCmdRecordingThreads_GFX
-		= 1 // worker thrd: DepthPrePass
-		+ 1 // this thread: AO+SceneColor+PostProcess+Submit+Present
-		+ GetNumShadowViewCmdRecordingThreads(SceneShadowView);
+		= mCommandRecordingScheduler.GetNumCommandLists() // worker thrds: Skinning+DepthPrePass+ShadowViews+AO+SceneColor
+		+ 1; // this thread: PostProcess+Submit+Present
 	const uint32_t NumCmdRecordingThreads_CMP = 0;
 	const uint32_t NumCmdRecordingThreads_CPY = 0;
 	const uint32_t NumCmdRecordingThreads = NumCmdRecordingThreads_GFX + NumCmdRecordingThreads_CPY + NumCmdRecordingThreads_CMP;
@@ -966,6 +1051,7 @@ void VQEngine::RenderThread_RenderMainWindow()
 		SCOPED_CPU_MARKER("SwapchainMoveToNextFrame");
 		ctx.SwapChain.MoveToNextFrame();
 	}
+	mRenderer.ReleaseDeferredFrees(ctx.SwapChain.GetNumPresentedFrames(), ctx.GetNumSwapchainBuffers());
 }
 
 
@@ -1251,6 +1337,8 @@ HRESULT VQEngine::RenderThread_RenderMainWindow_Scene(FWindowRenderContext& ctx)
 		ID3D12GraphicsCommandList* pCmd = (ID3D12GraphicsCommandList*)ctx.GetCommandListPtr(CommandQueue::EType::GFX, THREAD_INDEX);
 		DynamicBufferHeap& CBHeap = ctx.GetConstantBufferHeap(THREAD_INDEX);
 
+		RenderSkinnedMeshes(pCmd, &CBHeap, SceneView);
+
 		RenderSpotShadowMaps(pCmd, &CBHeap, SceneShadowView);
 		RenderDirectionalShadowMaps(pCmd, &CBHeap, SceneShadowView);
 		RenderPointShadowMaps(pCmd, &CBHeap, SceneShadowView, 0, SceneShadowView.NumPointShadowViews);
@@ -1294,76 +1382,31 @@ HRESULT VQEngine::RenderThread_RenderMainWindow_Scene(FWindowRenderContext& ctx)
 
 	else // RENDER_THREAD__MULTI_THREADED_COMMAND_RECORDING
 	{
-		constexpr size_t iCmdZPrePassThread = 0;
-		constexpr size_t iCmdPointLightsThread = 1;
-		const     size_t iCmdSpots        = iCmdPointLightsThread + SceneShadowView.NumPointShadowViews;
-		const     size_t iCmdDirectional  = iCmdSpots + (SceneShadowView.NumSpotShadowViews > 0 ? 1 : 0);
-		const     size_t iCmdRenderThread = iCmdDirectional + (SceneShadowView.ShadowView_Directional.meshRenderCommands.empty() ? 0 : 1);
+		const uint32 NumWorkerCmdLists = mCommandRecordingScheduler.GetNumCommandLists();
+		const size_t iCmdRenderThread = NumWorkerCmdLists; // submitted last
 
 		ID3D12GraphicsCommandList* pCmd_ThisThread = (ID3D12GraphicsCommandList*)ctx.GetCommandListPtr(CommandQueue::EType::GFX, iCmdRenderThread);
 		DynamicBufferHeap& CBHeap_This = ctx.GetConstantBufferHeap(iCmdRenderThread);
 		
+		FSceneCommandRecorder Recorder;
+		Recorder.pEngine          = this;
+		Recorder.pCtx             = &ctx;
+		Recorder.pSceneView       = &SceneView;
+		Recorder.pSceneShadowView = &SceneShadowView;
+		Recorder.pPPParams        = &PPParams;
+		Recorder.bDownsampleDepth = bDownsampleDepth;
 		{
 			SCOPED_CPU_MARKER("DispatchWorkers");
-
-			// ZPrePass
-			{
-				ID3D12GraphicsCommandList* pCmd_ZPrePass = (ID3D12GraphicsCommandList*)ctx.GetCommandListPtr(CommandQueue::EType::GFX, iCmdZPrePassThread);
-				DynamicBufferHeap& CBHeap_WorkerZPrePass = ctx.GetConstantBufferHeap(iCmdZPrePassThread);
-				WorkerThreads.AddTask([=, &CBHeap_WorkerZPrePass, &SceneView]()
-				{
-					RENDER_WORKER_CPU_MARKER;
-					RenderDepthPrePass(pCmd_ZPrePass, &CBHeap_WorkerZPrePass, SceneView);
-
-					if (bDownsampleDepth)
-					{
-						DownsampleDepth(pCmd_ZPrePass, &CBHeap_WorkerZPrePass, rsc.Tex_SceneDepth, rsc.SRV_SceneDepth);
-					}
-				});
-			}
-			if (SceneShadowView.NumSpotShadowViews > 0)
-			{
-				ID3D12GraphicsCommandList* pCmd_Spots = (ID3D12GraphicsCommandList*)ctx.GetCommandListPtr(CommandQueue::EType::GFX, iCmdSpots);
-				DynamicBufferHeap& CBHeap_Spots = ctx.GetConstantBufferHeap(iCmdSpots);
-				WorkerThreads.AddTask([=, &CBHeap_Spots, &SceneShadowView]()
-				{
-					RENDER_WORKER_CPU_MARKER;
-					RenderSpotShadowMaps(pCmd_Spots, &CBHeap_Spots, SceneShadowView);
-				});
-			}
-			if (SceneShadowView.NumPointShadowViews > 0)
+			for (uint32 iCmdList = 0; iCmdList < NumWorkerCmdLists; ++iCmdList)
 			{
-				for (uint iPoint = 0; iPoint < SceneShadowView.NumPointShadowViews; ++iPoint)
-				{
-					const size_t iPointWorker = iCmdPointLightsThread + iPoint;
-					ID3D12GraphicsCommandList* pCmd_Point = (ID3D12GraphicsCommandList*)ctx.GetCommandListPtr(CommandQueue::EType::GFX, iPointWorker);
-					DynamicBufferHeap& CBHeap_Point = ctx.GetConstantBufferHeap(iPointWorker);
-					WorkerThreads.AddTask([=, &CBHeap_Point, &SceneShadowView]()
-					{
-						RENDER_WORKER_CPU_MARKER;
-						RenderPointShadowMaps(pCmd_Point, &CBHeap_Point, SceneShadowView, iPoint, 1);
-					});
-				}
-			}
-
-			if (!SceneShadowView.ShadowView_Directional.meshRenderCommands.empty())
-			{
-				ID3D12GraphicsCommandList* pCmd_Directional = (ID3D12GraphicsCommandList*)ctx.GetCommandListPtr(CommandQueue::EType::GFX, iCmdDirectional);
-				DynamicBufferHeap& CBHeap_Directional = ctx.GetConstantBufferHeap(iCmdDirectional);
-				WorkerThreads.AddTask([=, &CBHeap_Directional, &SceneShadowView]()
+				WorkerThreads.AddTask([this, &Recorder, iCmdList]()
 				{
 					RENDER_WORKER_CPU_MARKER;
-					RenderDirectionalShadowMaps(pCmd_Directional, &CBHeap_Directional, SceneShadowView);
+					mCommandRecordingScheduler.RecordCommandList(Recorder, iCmdList);
 				});
 			}
 		}
 
-		RenderAmbientOcclusion(pCmd_ThisThread, SceneView);
-
-		TransitionForSceneRendering(pCmd_ThisThread, ctx, PPParams);
-
-		RenderSceneColor(pCmd_ThisThread, &CBHeap_This, SceneView, PPParams);
-
 		ResolveMSAA(pCmd_ThisThread, &CBHeap_This, PPParams);
 
 		TransitionForPostProcessing(pCmd_ThisThread, PPParams);
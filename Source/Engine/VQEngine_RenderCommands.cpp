@@ -16,6 +16,8 @@
 //
 //	Contact: volkanilbeyli@gmail.com
 
+#define NOMINMAX
+
 #include "VQEngine.h"
 #include "Geometry.h"
 #include "GPUMarker.h"
@@ -23,6 +25,7 @@
 #include <d3d12.h>
 #include <dxgi.h>
 #include <DirectXMath.h>
+#include <algorithm>
 
 #include "RenderPass/AmbientOcclusion.h"
 #include "RenderPass/DepthPrePass.h"
@@ -30,10 +33,26 @@
 #include "VQEngine_RenderCommon.h"
 
 #include "imgui.h"
+
+// draws the index ranges of the visible meshlets if the command was meshlet culled, the whole mesh otherwise
+static void DrawMeshRenderCommandIndices(ID3D12GraphicsCommandList* pCmd, const FSceneView& SceneView, const FMeshRenderCommand& meshRenderCmd, uint32 NumIndices, uint32 NumInstances)
+{
+	if (meshRenderCmd.NumIndexRanges == 0)
+	{
+		pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+		return;
+	}
+	for (uint32 i = 0; i < meshRenderCmd.NumIndexRanges; ++i)
+	{
+		const FIndexRange& range = SceneView.meshIndexRanges[meshRenderCmd.iFirstIndexRange + i];
+		pCmd->DrawIndexedInstanced(range.NumIndices, NumInstances, range.FirstIndex, 0, 0);
+	}
+}
+
 //
 // DRAW COMMANDS
 //
-void VQEngine::DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh)
+void VQEngine::DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh, int iFirstSkinnedVertex)
 {
 	SCOPED_CPU_MARKER("DrawMesh");
 	using namespace DirectX;
@@ -45,7 +64,7 @@ void VQEngine::DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh)
 	const uint32 NumInstances = 1;
 	const BufferID& VB_ID = VBIBIDs.first;
 	const BufferID& IB_ID = VBIBIDs.second;
-	const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
+	const VBV vb = mRenderPass_Skinning.GetVertexBufferView(mRenderer.GetVertexBufferView(VB_ID), iFirstSkinnedVertex);
 	const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
 
 	pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -55,7 +74,7 @@ void VQEngine::DrawMesh(ID3D12GraphicsCommandList* pCmd, const Mesh& mesh)
 	pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
 }
 
-void VQEngine::DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView)
+void VQEngine::DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView, size_t iBegin, size_t iEnd)
 {
 	using namespace DirectX;
 	struct FCBufferLightVS
@@ -64,9 +83,11 @@ void VQEngine::DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBu
 		XMMATRIX matWorld;
 	};
 
-	for (const FShadowMeshRenderCommand& renderCmd : shadowView.meshRenderCommands)
+	iEnd = std::min(iEnd, shadowView.meshRenderCommands.size());
+	for (size_t iCmd = iBegin; iCmd < iEnd; ++iCmd)
 	{
 		SCOPED_CPU_MARKER("Process_ShadowMeshRenderCommand");
+		const FShadowMeshRenderCommand& renderCmd = shadowView.meshRenderCommands[iCmd];
 		// set constant buffer data
 		FCBufferLightVS* pCBuffer = {};
 		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
@@ -76,7 +97,218 @@ void VQEngine::DrawShadowViewMeshList(ID3D12GraphicsCommandList* pCmd, DynamicBu
 		pCmd->SetGraphicsRootConstantBufferView(0, cbAddr);
 
 		const Mesh& mesh = mpScene->mMeshes.at(renderCmd.meshID);
-		DrawMesh(pCmd, mesh);
+		DrawMesh(pCmd, mesh, renderCmd.iFirstSkinnedVertex);
+	}
+}
+
+// Draws the instanced batches of the scene view, each batch uploads its per-instance transforms
+// as an array of PerObjectData and shares the material of its first instance.
+void VQEngine::DrawInstancedMeshRenderCommands(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, UINT PerObjRSBindSlot, size_t iBegin, size_t iEnd)
+{
+	using namespace VQ_SHADER_DATA;
+	iEnd = std::min(iEnd, SceneView.instancedMeshRenderCommands.size());
+	for (size_t iBatch = iBegin; iBatch < iEnd; ++iBatch)
+	{
+		const FInstancedMeshRenderCommand& batch = SceneView.instancedMeshRenderCommands[iBatch];
+		SCOPED_CPU_MARKER("Process_InstancedMeshRenderCommand");
+		if (mpScene->mMeshes.find(batch.meshID) == mpScene->mMeshes.end())
+		{
+			Log::Warning("MeshID=%d couldn't be found", batch.meshID);
+			continue; // skip drawing this batch
+		}
+		assert(batch.NumInstances > 0 && batch.NumInstances <= MAX_INSTANCE_COUNT__SCENE_MESHES);
+
+		const Material& mat = mpScene->GetMaterial(batch.matID);
+		const Mesh& mesh = mpScene->mMeshes.at(batch.meshID);
+
+		// set constant buffer data
+		PerObjectData* pPerObj = {};
+		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
+		pCBufferHeap->AllocConstantBuffer(sizeof(PerObjectData) * batch.NumInstances, (void**)(&pPerObj), &cbAddr);
+		for (uint32 i = 0; i < batch.NumInstances; ++i)
+		{
+			const FMeshInstanceData& inst = SceneView.meshInstanceData[batch.iFirstInstance + i];
+			pPerObj[i].matWorldViewProj     = inst.matWorldTransformation * SceneView.viewProj;
+			pPerObj[i].matWorldViewProjPrev = inst.matWorldTransformationPrev * SceneView.viewProjPrev;
+			pPerObj[i].matWorld             = inst.matWorldTransformation;
+			pPerObj[i].matNormal            = inst.matNormalTransformation;
+		}
+		pPerObj[0].materialData = mat.GetCBufferData();
+
+		pCmd->SetGraphicsRootConstantBufferView(PerObjRSBindSlot, cbAddr);
+
+		// set textures
+		if (mat.SRVMaterialMaps != INVALID_ID)
+		{
+			pCmd->SetGraphicsRootDescriptorTable(0, mRenderer.GetSRV(mat.SRVMaterialMaps).GetGPUDescHandle(0));
+		}
+
+		const auto VBIBIDs = mesh.GetIABufferIDs();
+		const uint32 NumIndices = mesh.GetNumIndices();
+		const VBV vb = mRenderPass_Skinning.GetVertexBufferView(mRenderer.GetVertexBufferView(VBIBIDs.first), batch.iFirstSkinnedVertex);
+		const IBV& ib = mRenderer.GetIndexBufferView(VBIBIDs.second);
+
+		pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		pCmd->IASetVertexBuffers(0, 1, &vb);
+		pCmd->IASetIndexBuffer(&ib);
+
+		pCmd->DrawIndexedInstanced(NumIndices, batch.NumInstances, 0, 0, 0);
+	}
+}
+
+// Binds & renders a shadow view as decided by the shadow cache. The static casters are drawn first
+// and their depth is copied into the static layer cache, which is copied back when only the dynamic
+// casters need to be redrawn.
+// The draws can be recorded in [iDrawBegin, iDrawEnd) ranges across command lists, see GetShadowViewDrawRange():
+// the range starting at the first draw clears/restores the depth and the one crossing the static
+// casters' end caches the static layer.
+void VQEngine::RenderShadowView(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView::FShadowView& shadowView, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, TextureID TexShadowMap, TextureID TexStaticLayerCache, UINT Subresource, size_t iDrawBegin, size_t iDrawEnd)
+{
+	const size_t NumStaticCasters = shadowView.NumStaticMeshRenderCommands;
+	const D3D12_CLEAR_FLAGS DSVClearFlags = D3D12_CLEAR_FLAGS::D3D12_CLEAR_FLAG_DEPTH;
+
+	const std::pair<size_t, size_t> DrawRange = GetShadowViewDrawRange(shadowView);
+	iDrawBegin = std::max(iDrawBegin, DrawRange.first);
+	iDrawEnd   = std::min(iDrawEnd  , DrawRange.second);
+	const bool bFirstDrawRange = iDrawBegin == DrawRange.first;
+	const bool bCacheStaticLayer = NumStaticCasters > 0
+		&& iDrawBegin <= NumStaticCasters
+		&& (NumStaticCasters < iDrawEnd || iDrawEnd == DrawRange.second);
+
+	ID3D12Resource* pRscShadowMap   = mRenderer.GetTextureResource(TexShadowMap);
+	ID3D12Resource* pRscStaticLayer = mRenderer.GetTextureResource(TexStaticLayerCache);
+	const CD3DX12_TEXTURE_COPY_LOCATION ShadowMapLocation(pRscShadowMap, Subresource);
+	const CD3DX12_TEXTURE_COPY_LOCATION StaticLayerLocation(pRscStaticLayer, Subresource);
+
+	switch (shadowView.CacheUpdate)
+	{
+	case ShadowCache::EViewUpdate::REUSE_CACHED:
+		return;
+
+	case ShadowCache::EViewUpdate::REDRAW_DYNAMIC:
+		if (!bFirstDrawRange)
+		{
+			pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
+		}
+		else if (NumStaticCasters == 0)
+		{
+			pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
+			pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
+		}
+		else
+		{
+			SCOPED_GPU_MARKER(pCmd, "RestoreStaticLayer");
+			const CD3DX12_RESOURCE_BARRIER BarriersCopy[] =
+			{
+				  CD3DX12_RESOURCE_BARRIER::Transition(pRscShadowMap  , D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_DEST  , Subresource)
+				, CD3DX12_RESOURCE_BARRIER::Transition(pRscStaticLayer, D3D12_RESOURCE_STATE_COPY_DEST  , D3D12_RESOURCE_STATE_COPY_SOURCE, Subresource)
+			};
+			const CD3DX12_RESOURCE_BARRIER BarriersRender[] =
+			{
+				  CD3DX12_RESOURCE_BARRIER::Transition(pRscShadowMap  , D3D12_RESOURCE_STATE_COPY_DEST  , D3D12_RESOURCE_STATE_DEPTH_WRITE, Subresource)
+				, CD3DX12_RESOURCE_BARRIER::Transition(pRscStaticLayer, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST  , Subresource)
+			};
+			pCmd->ResourceBarrier(_countof(BarriersCopy), BarriersCopy);
+			pCmd->CopyTextureRegion(&ShadowMapLocation, 0, 0, 0, &StaticLayerLocation, NULL);
+			pCmd->ResourceBarrier(_countof(BarriersRender), BarriersRender);
+			pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
+		}
+		break;
+
+	case ShadowCache::EViewUpdate::REDRAW_ALL:
+	default:
+		pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
+		if (bFirstDrawRange)
+		{
+			pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
+		}
+		if (bCacheStaticLayer)
+		{
+			DrawShadowViewMeshList(pCmd, pCBufferHeap, shadowView, iDrawBegin, NumStaticCasters);
+			iDrawBegin = NumStaticCasters;
+
+			SCOPED_GPU_MARKER(pCmd, "CacheStaticLayer");
+			const CD3DX12_RESOURCE_BARRIER BarrierCopy   = CD3DX12_RESOURCE_BARRIER::Transition(pRscShadowMap, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE, Subresource);
+			const CD3DX12_RESOURCE_BARRIER BarrierRender = CD3DX12_RESOURCE_BARRIER::Transition(pRscShadowMap, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE, Subresource);
+			pCmd->ResourceBarrier(1, &BarrierCopy);
+			pCmd->CopyTextureRegion(&StaticLayerLocation, 0, 0, 0, &ShadowMapLocation, NULL);
+			pCmd->ResourceBarrier(1, &BarrierRender);
+		}
+		break;
+	}
+
+	DrawShadowViewMeshList(pCmd, pCBufferHeap, shadowView, iDrawBegin, iDrawEnd);
+}
+
+std::pair<size_t, size_t> VQEngine::GetShadowViewDrawRange(const FSceneShadowView::FShadowView& shadowView)
+{
+	switch (shadowView.CacheUpdate)
+	{
+	case ShadowCache::EViewUpdate::REUSE_CACHED  : return { 0, 0 };
+	case ShadowCache::EViewUpdate::REDRAW_DYNAMIC: return { shadowView.NumStaticMeshRenderCommands, shadowView.meshRenderCommands.size() };
+	case ShadowCache::EViewUpdate::REDRAW_ALL    :
+	default                                      : return { 0, shadowView.meshRenderCommands.size() };
+	}
+}
+
+// Records a draw range of a single shadow view, used by the parallel command recording
+void VQEngine::RenderShadowViewDrawRange(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& SceneShadowView, Light::EType eLightType, size_t iView, size_t iDrawBegin, size_t iDrawEnd)
+{
+	using namespace DirectX;
+	struct FCBufferLightPS
+	{
+		XMFLOAT3 vLightPos;
+		float fFarPlane;
+	};
+
+	const float RenderResolution = static_cast<float>(eLightType == Light::EType::DIRECTIONAL ? SHADOW_MAP_DIMENSION_DIRECTIONAL
+		: (eLightType == Light::EType::POINT ? SHADOW_MAP_DIMENSION_POINT : SHADOW_MAP_DIMENSION_SPOT));
+	D3D12_VIEWPORT viewport{ 0.0f, 0.0f, RenderResolution, RenderResolution, 0.0f, 1.0f };
+	D3D12_RECT scissorsRect{ 0, 0, (LONG)RenderResolution, (LONG)RenderResolution };
+	pCmd->RSSetViewports(1, &viewport);
+	pCmd->RSSetScissorRects(1, &scissorsRect);
+
+	switch (eLightType)
+	{
+	case Light::EType::DIRECTIONAL:
+	{
+		SCOPED_GPU_MARKER(pCmd, "RenderDirectionalShadowMaps");
+		pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_PSO));
+		pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ShadowPassDepthOnlyVS));
+		const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Directional);
+		RenderShadowView(pCmd, pCBufferHeap, SceneShadowView.ShadowViews_Directional[iView], dsv.GetCPUDescHandle((uint32)iView)
+			, mResources_MainWnd.Tex_ShadowMaps_Directional, mResources_MainWnd.Tex_ShadowMapCache_Directional, (UINT)iView, iDrawBegin, iDrawEnd);
+	} break;
+
+	case Light::EType::SPOT:
+	{
+		SCOPED_GPU_MARKER(pCmd, "RenderSpotShadowMaps");
+		pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_PSO));
+		pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ShadowPassDepthOnlyVS));
+		const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Spot);
+		RenderShadowView(pCmd, pCBufferHeap, SceneShadowView.ShadowViews_Spot[iView], dsv.GetCPUDescHandle((uint32)iView)
+			, mResources_MainWnd.Tex_ShadowMaps_Spot, mResources_MainWnd.Tex_ShadowMapCache_Spot, (UINT)iView, iDrawBegin, iDrawEnd);
+	} break;
+
+	case Light::EType::POINT: // iView : point light * 6 + cubemap face
+	{
+		SCOPED_GPU_MARKER(pCmd, "RenderPointShadowMaps");
+		pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_LINEAR_PSO));
+		pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ShadowPassLinearDepthVSPS));
+
+		FCBufferLightPS* pCBuffer = {};
+		D3D12_GPU_VIRTUAL_ADDRESS cbAddr = {};
+		pCBufferHeap->AllocConstantBuffer(sizeof(decltype(*pCBuffer)), (void**)(&pCBuffer), &cbAddr);
+		pCBuffer->vLightPos = SceneShadowView.PointLightLinearDepthParams[iView / 6].vWorldPos;
+		pCBuffer->fFarPlane = SceneShadowView.PointLightLinearDepthParams[iView / 6].fFarPlane;
+		pCmd->SetGraphicsRootConstantBufferView(1, cbAddr);
+
+		const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Point);
+		RenderShadowView(pCmd, pCBufferHeap, SceneShadowView.ShadowViews_Point[iView], dsv.GetCPUDescHandle((uint32)iView)
+			, mResources_MainWnd.Tex_ShadowMaps_Point, mResources_MainWnd.Tex_ShadowMapCache_Point, (UINT)iView, iDrawBegin, iDrawEnd);
+	} break;
+
+	default: assert(false); break;
 	}
 }
 
@@ -88,33 +320,34 @@ void VQEngine::RenderDirectionalShadowMaps(ID3D12GraphicsCommandList* pCmd, Dyna
 {
 	SCOPED_GPU_MARKER(pCmd, "RenderDirectionalShadowMaps");
 
-	if (!SceneShadowView.ShadowView_Directional.meshRenderCommands.empty())
-	{
-		const std::string marker = "Directional";
-		SCOPED_GPU_MARKER(pCmd, marker.c_str());
+	if (SceneShadowView.NumDirectionalCascades == 0)
+		return;
 
-		pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_PSO));
-		pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ShadowPassDepthOnlyVS));
+	const float RenderResolutionX = static_cast<float>(SHADOW_MAP_DIMENSION_DIRECTIONAL);
+	const float RenderResolutionY = static_cast<float>(SHADOW_MAP_DIMENSION_DIRECTIONAL);
+	D3D12_VIEWPORT viewport{ 0.0f, 0.0f, RenderResolutionX, RenderResolutionY, 0.0f, 1.0f };
+	D3D12_RECT scissorsRect{ 0, 0, (LONG)RenderResolutionX, (LONG)RenderResolutionY };
+	pCmd->RSSetViewports(1, &viewport);
+	pCmd->RSSetScissorRects(1, &scissorsRect);
 
-		const float RenderResolutionX = 2048.0f; // TODO
-		const float RenderResolutionY = 2048.0f; // TODO
-		D3D12_VIEWPORT viewport{ 0.0f, 0.0f, RenderResolutionX, RenderResolutionY, 0.0f, 1.0f };
-		D3D12_RECT scissorsRect{ 0, 0, (LONG)RenderResolutionX, (LONG)RenderResolutionY };
-		pCmd->RSSetViewports(1, &viewport);
-		pCmd->RSSetScissorRects(1, &scissorsRect);
+	pCmd->SetPipelineState(mRenderer.GetPSO(EBuiltinPSOs::DEPTH_PASS_PSO));
+	pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ShadowPassDepthOnlyVS));
 
-		// Bind Depth / clear
-		const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Directional);
-		D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = dsv.GetCPUDescHandle();
-		pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
+	// cascades without casters are still cleared as they move with the main view
+	for (uint i = 0; i < SceneShadowView.NumDirectionalCascades; ++i)
+	{
+		const FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Directional[i];
 
-		//if constexpr (!B_CLEAR_DEPTH_BUFFERS_BEFORE_DRAW)
-		{
-			D3D12_CLEAR_FLAGS DSVClearFlags = D3D12_CLEAR_FLAGS::D3D12_CLEAR_FLAG_DEPTH;
-			pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
-		}
+		if (ShadowView.CacheUpdate == ShadowCache::EViewUpdate::REUSE_CACHED)
+			continue;
+
+		const std::string marker = "Directional[" + std::to_string(i) + "]";
+		SCOPED_GPU_MARKER(pCmd, marker.c_str());
 
-		DrawShadowViewMeshList(pCmd, pCBufferHeap, SceneShadowView.ShadowView_Directional);
+		// Bind Depth / clear / draw
+		const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Directional);
+		D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = dsv.GetCPUDescHandle(i);
+		RenderShadowView(pCmd, pCBufferHeap, ShadowView, dsvHandle, mResources_MainWnd.Tex_ShadowMaps_Directional, mResources_MainWnd.Tex_ShadowMapCache_Directional, i);
 	}
 }
 void VQEngine::RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& SceneShadowView)
@@ -123,8 +356,8 @@ void VQEngine::RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuff
 	const bool bRenderAtLeastOneSpotShadowMap = SceneShadowView.NumSpotShadowViews > 0;
 
 	// Set Viewport & Scissors
-	const float RenderResolutionX = 1024.0f; // TODO
-	const float RenderResolutionY = 1024.0f; // TODO
+	const float RenderResolutionX = static_cast<float>(SHADOW_MAP_DIMENSION_SPOT);
+	const float RenderResolutionY = static_cast<float>(SHADOW_MAP_DIMENSION_SPOT);
 	D3D12_VIEWPORT viewport{ 0.0f, 0.0f, RenderResolutionX, RenderResolutionY, 0.0f, 1.0f };
 	D3D12_RECT scissorsRect{ 0, 0, (LONG)RenderResolutionX, (LONG)RenderResolutionY };
 	pCmd->RSSetViewports(1, &viewport);
@@ -144,21 +377,16 @@ void VQEngine::RenderSpotShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuff
 	{
 		const FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Spot[i];
 
-		if (ShadowView.meshRenderCommands.empty())
+		if (ShadowView.CacheUpdate == ShadowCache::EViewUpdate::REUSE_CACHED)
 			continue;
 
 		const std::string marker = "Spot[" + std::to_string(i) + "]";
 		SCOPED_GPU_MARKER(pCmd, marker.c_str());
 
-		// Bind Depth / clear
+		// Bind Depth / clear / draw
 		const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Spot);
 		D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = dsv.GetCPUDescHandle(i);
-		pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
-
-		D3D12_CLEAR_FLAGS DSVClearFlags = D3D12_CLEAR_FLAGS::D3D12_CLEAR_FLAG_DEPTH;
-		pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
-
-		DrawShadowViewMeshList(pCmd, pCBufferHeap, ShadowView);
+		RenderShadowView(pCmd, pCBufferHeap, ShadowView, dsvHandle, mResources_MainWnd.Tex_ShadowMaps_Spot, mResources_MainWnd.Tex_ShadowMapCache_Spot, i);
 	}
 }
 void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneShadowView& SceneShadowView, size_t iBegin, size_t NumPointLights)
@@ -176,8 +404,8 @@ void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuf
 	
 #if RENDER_THREAD__MULTI_THREADED_COMMAND_RECORDING
 	// Set Viewport & Scissors
-	const float RenderResolutionX = 1024.0f; // TODO
-	const float RenderResolutionY = 1024.0f; // TODO
+	const float RenderResolutionX = static_cast<float>(SHADOW_MAP_DIMENSION_POINT);
+	const float RenderResolutionY = static_cast<float>(SHADOW_MAP_DIMENSION_POINT);
 	D3D12_VIEWPORT viewport{ 0.0f, 0.0f, RenderResolutionX, RenderResolutionY, 0.0f, 1.0f };
 	D3D12_RECT scissorsRect{ 0, 0, (LONG)RenderResolutionX, (LONG)RenderResolutionY };
 	pCmd->RSSetViewports(1, &viewport);
@@ -204,29 +432,43 @@ void VQEngine::RenderPointShadowMaps(ID3D12GraphicsCommandList* pCmd, DynamicBuf
 			const size_t iShadowView = i * 6 + face;
 			const FSceneShadowView::FShadowView& ShadowView = SceneShadowView.ShadowViews_Point[iShadowView];
 
-			if (ShadowView.meshRenderCommands.empty())
+			if (ShadowView.CacheUpdate == ShadowCache::EViewUpdate::REUSE_CACHED)
 				continue;
 
 			const std::string marker_face = "[Cubemap Face=" + std::to_string(face) + "]";
 			SCOPED_GPU_MARKER(pCmd, marker_face.c_str());
 
-			// Bind Depth / clear
+			// Bind Depth / clear / draw
 			const DSV& dsv = mRenderer.GetDSV(mResources_MainWnd.DSV_ShadowMaps_Point);
 			D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = dsv.GetCPUDescHandle((uint32_t)iShadowView);
-			D3D12_CLEAR_FLAGS DSVClearFlags = D3D12_CLEAR_FLAGS::D3D12_CLEAR_FLAG_DEPTH;
-			pCmd->OMSetRenderTargets(0, NULL, FALSE, &dsvHandle);
-			pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, NULL);
-
-			// draw render list
-			DrawShadowViewMeshList(pCmd, pCBufferHeap, ShadowView);
+			RenderShadowView(pCmd, pCBufferHeap, ShadowView, dsvHandle, mResources_MainWnd.Tex_ShadowMaps_Point, mResources_MainWnd.Tex_ShadowMapCache_Point, (UINT)iShadowView);
 		}
 	}
 }
 
-void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView)
+// Skins the animated meshes into the skinned vertex buffer before any of the passes draw them.
+void VQEngine::RenderSkinnedMeshes(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView)
+{
+	SCOPED_CPU_MARKER("RenderSkinnedMeshes");
+	SkinningPass::FDrawParameters params;
+	params.pCmd = pCmd;
+	params.pCBufferHeap = pCBufferHeap;
+	params.pSkinningCommands = &SceneView.skinningCommands;
+	params.pSkinningPalettes = &SceneView.skinningPalettes;
+	mRenderPass_Skinning.RecordCommands(&params);
+}
+
+// The draws can be recorded across multiple command lists w/ [iDrawBegin, iDrawEnd) ranges: the first range
+// clears the targets and the last one resolves them.
+void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, size_t iDrawBegin, size_t iDrawEnd)
 {
 	using namespace VQ_SHADER_DATA;
 	const bool& bMSAA = mSettings.gfx.bAntiAliasing;
+	const bool& bInstancedDraws = SceneView.sceneParameters.bInstancedDraws;
+	const size_t NumDraws = bInstancedDraws ? SceneView.instancedMeshRenderCommands.size() : SceneView.meshRenderCommands.size();
+	iDrawEnd = std::min(iDrawEnd, NumDraws);
+	const bool bFirstDrawRange = iDrawBegin == 0;
+	const bool bLastDrawRange  = iDrawEnd == NumDraws;
 	const auto& rsc = mResources_MainWnd;
 	auto pRscNormals     = mRenderer.GetTextureResource(rsc.Tex_SceneNormals);
 	auto pRscNormalsMSAA = mRenderer.GetTextureResource(rsc.Tex_SceneNormalsMSAA);
@@ -234,7 +476,7 @@ void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBuffer
 	auto pRscDepthMSAA   = mRenderer.GetTextureResource(rsc.Tex_SceneDepthMSAA);
 	auto pRscDepth       = mRenderer.GetTextureResource(rsc.Tex_SceneDepth);
 
-	if (!bMSAA)
+	if (!bMSAA && bFirstDrawRange)
 	{
 		std::vector<CD3DX12_RESOURCE_BARRIER> Barriers;
 		Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pRscNormals, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET));
@@ -258,19 +500,30 @@ void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBuffer
 
 	SCOPED_GPU_MARKER(pCmd, "RenderDepthPrePass");
 
-	pCmd->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-	pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, nullptr);
+	if (bFirstDrawRange)
+	{
+		pCmd->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+		pCmd->ClearDepthStencilView(dsvHandle, DSVClearFlags, 1.0f, 0, 0, nullptr);
+	}
 
 	pCmd->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
 	pCmd->RSSetViewports(1, &viewport);
 	pCmd->RSSetScissorRects(1, &scissorsRect);
 
-	pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA ? EBuiltinPSOs::DEPTH_PREPASS_PSO_MSAA_4 : EBuiltinPSOs::DEPTH_PREPASS_PSO));
+	pCmd->SetPipelineState(mRenderer.GetPSO(bInstancedDraws
+		? (bMSAA ? EBuiltinPSOs::DEPTH_PREPASS_INSTANCED_PSO_MSAA_4 : EBuiltinPSOs::DEPTH_PREPASS_INSTANCED_PSO)
+		: (bMSAA ? EBuiltinPSOs::DEPTH_PREPASS_PSO_MSAA_4 : EBuiltinPSOs::DEPTH_PREPASS_PSO)
+	));
 	pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ZPrePass));
 
 	// draw meshes
-	for (const FMeshRenderCommand& meshRenderCmd : SceneView.meshRenderCommands)
+	if (bInstancedDraws)
+	{
+		DrawInstancedMeshRenderCommands(pCmd, pCBufferHeap, SceneView, 1, iDrawBegin, iDrawEnd);
+	}
+	else for (size_t iDraw = iDrawBegin; iDraw < iDrawEnd; ++iDraw)
 	{
+		const FMeshRenderCommand& meshRenderCmd = SceneView.meshRenderCommands[iDraw];
 		if (mpScene->mMeshes.find(meshRenderCmd.meshID) == mpScene->mMeshes.end())
 		{
 			Log::Warning("MeshID=%d couldn't be found", meshRenderCmd.meshID);
@@ -284,7 +537,7 @@ void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBuffer
 		const uint32 NumInstances = 1;
 		const BufferID& VB_ID = VBIBIDs.first;
 		const BufferID& IB_ID = VBIBIDs.second;
-		const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
+		const VBV vb = mRenderPass_Skinning.GetVertexBufferView(mRenderer.GetVertexBufferView(VB_ID), meshRenderCmd.iFirstSkinnedVertex);
 		const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
 
 
@@ -312,9 +565,12 @@ void VQEngine::RenderDepthPrePass(ID3D12GraphicsCommandList* pCmd, DynamicBuffer
 		pCmd->IASetVertexBuffers(0, 1, &vb);
 		pCmd->IASetIndexBuffer(&ib);
 
-		pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+		DrawMeshRenderCommandIndices(pCmd, SceneView, meshRenderCmd, NumIndices, NumInstances);
 	}
 
+	if (!bLastDrawRange)
+		return;
+
 	// resolve if MSAA
 	if (bMSAA)
 	{
@@ -482,7 +738,9 @@ void VQEngine::TransitionForSceneRendering(ID3D12GraphicsCommandList* pCmd, FWin
 	pCmd->ResourceBarrier((UINT)vBarriers.size(), vBarriers.data());
 }
 
-void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, const FPostProcessParameters& PPParams)
+// Like the depth pre-pass, the draws can be recorded in ranges: the first range clears the targets and the
+// last one draws the lights, debug volumes & the environment map.
+void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHeap* pCBufferHeap, const FSceneView& SceneView, const FPostProcessParameters& PPParams, size_t iDrawBegin, size_t iDrawEnd)
 {
 	using namespace VQ_SHADER_DATA;
 
@@ -496,6 +754,11 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	using namespace DirectX;
 
 	const bool& bMSAA = mSettings.gfx.bAntiAliasing;
+	const bool& bInstancedDraws = SceneView.sceneParameters.bInstancedDraws;
+	const size_t NumDraws = bInstancedDraws ? SceneView.instancedMeshRenderCommands.size() : SceneView.meshRenderCommands.size();
+	iDrawEnd = std::min(iDrawEnd, NumDraws);
+	const bool bFirstDrawRange = iDrawBegin == 0;
+	const bool bLastDrawRange  = iDrawEnd == NumDraws;
 
 	const RTV& rtvColor = mRenderer.GetRTV(bMSAA ? mResources_MainWnd.RTV_SceneColorMSAA : mResources_MainWnd.RTV_SceneColor);
 	const RTV& rtvColorViz = mRenderer.GetRTV(bMSAA ? mResources_MainWnd.RTV_SceneVisualizationMSAA : mResources_MainWnd.RTV_SceneVisualization);
@@ -514,8 +777,11 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	if (bUseVisualizationRenderTarget) rtvHandles.push_back(rtvColorViz.GetCPUDescHandle());
 	if (bRenderMotionVectors)          rtvHandles.push_back(rtvMoVec.GetCPUDescHandle());
 
-	for (D3D12_CPU_DESCRIPTOR_HANDLE& rtv : rtvHandles)
-		pCmd->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+	if (bFirstDrawRange)
+	{
+		for (D3D12_CPU_DESCRIPTOR_HANDLE& rtv : rtvHandles)
+			pCmd->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+	}
 	
 	pCmd->OMSetRenderTargets((UINT)rtvHandles.size(), rtvHandles.data(), FALSE, &dsvHandle);
 
@@ -527,14 +793,28 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 	pCmd->RSSetViewports(1, &viewport);
 	pCmd->RSSetScissorRects(1, &scissorsRect);
 
-	pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA 
-		? (bUseVisualizationRenderTarget 
-			? (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_PSO_MSAA_4)
-			: (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_PSO_MSAA_4) )
-		: (bUseVisualizationRenderTarget 
-			? (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO : EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_PSO)
-			: (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_PSO : EBuiltinPSOs::FORWARD_LIGHTING_PSO))
-	));
+	if (bInstancedDraws)
+	{
+		pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA
+			? (bUseVisualizationRenderTarget
+				? (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_INSTANCED_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_INSTANCED_PSO_MSAA_4)
+				: (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_INSTANCED_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_INSTANCED_PSO_MSAA_4))
+			: (bUseVisualizationRenderTarget
+				? (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_INSTANCED_PSO : EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_INSTANCED_PSO)
+				: (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_INSTANCED_PSO : EBuiltinPSOs::FORWARD_LIGHTING_INSTANCED_PSO))
+		));
+	}
+	else
+	{
+		pCmd->SetPipelineState(mRenderer.GetPSO(bMSAA 
+			? (bUseVisualizationRenderTarget 
+				? (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_PSO_MSAA_4)
+				: (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_PSO_MSAA_4 : EBuiltinPSOs::FORWARD_LIGHTING_PSO_MSAA_4) )
+			: (bUseVisualizationRenderTarget 
+				? (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO : EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_PSO)
+				: (bRenderMotionVectors ? EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_PSO : EBuiltinPSOs::FORWARD_LIGHTING_PSO))
+		));
+	}
 	pCmd->SetGraphicsRootSignature(mRenderer.GetBuiltinRootSignature(EBuiltinRootSignatures::LEGACY__ForwardLighting));
 
 	// set PerFrame constants
@@ -550,9 +830,9 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 		assert(pPerFrame);
 		pPerFrame->Lights = SceneView.GPULightingData;
 		pPerFrame->fAmbientLightingFactor = SceneView.sceneParameters.fAmbientLightingFactor;
-		pPerFrame->f2PointLightShadowMapDimensions = { 1024.0f, 1024.f }; // TODO
-		pPerFrame->f2SpotLightShadowMapDimensions  = { 1024.0f, 1024.f }; // TODO
-		pPerFrame->f2DirectionalLightShadowMapDimensions  = { 2048.0f, 2048.0f }; // TODO
+		pPerFrame->f2PointLightShadowMapDimensions = { (float)SHADOW_MAP_DIMENSION_POINT, (float)SHADOW_MAP_DIMENSION_POINT };
+		pPerFrame->f2SpotLightShadowMapDimensions  = { (float)SHADOW_MAP_DIMENSION_SPOT , (float)SHADOW_MAP_DIMENSION_SPOT  };
+		pPerFrame->f2DirectionalLightShadowMapDimensions  = { (float)SHADOW_MAP_DIMENSION_DIRECTIONAL, (float)SHADOW_MAP_DIMENSION_DIRECTIONAL };
 		pPerFrame->fHDRIOffsetInRadians = SceneView.HDRIYawOffset;
 		
 		if (bUseHDRRenderPath)
@@ -582,6 +862,25 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 		pCmd->SetGraphicsRootDescriptorTable(10, mRenderer.GetSRV(mResources_MainWnd.SRV_FFXCACAO_Out).GetGPUDescHandle());
 	}
 
+	// set clustered lighting buffers
+	{
+		auto fnBindStructuredBuffer = [&](UINT RSBindSlot, const void* pSrc, size_t NumElements, uint32 Stride)
+		{
+			void* pDst = nullptr;
+			D3D12_GPU_VIRTUAL_ADDRESS BufferAddr = {};
+			pCBufferHeap->AllocStructuredBuffer(static_cast<uint32>(NumElements), Stride, &pDst, &BufferAddr);
+			assert(pDst);
+			if (NumElements > 0)
+				memcpy(pDst, pSrc, NumElements * Stride);
+			pCmd->SetGraphicsRootShaderResourceView(RSBindSlot, BufferAddr);
+		};
+		const FLightClusterGrid& Grid = SceneView.LightClusterGrid;
+		fnBindStructuredBuffer(11, SceneView.GPUPointLights.data(), SceneView.GPUPointLights.size(), sizeof(PointLight));
+		fnBindStructuredBuffer(12, SceneView.GPUSpotLights.data() , SceneView.GPUSpotLights.size() , sizeof(SpotLight));
+		fnBindStructuredBuffer(13, Grid.Clusters.data()           , Grid.Clusters.size()           , sizeof(FLightCluster));
+		fnBindStructuredBuffer(14, Grid.LightIndices.data()       , Grid.LightIndices.size()       , sizeof(uint32));
+	}
+
 	// set PerView constants
 	{
 		constexpr UINT PerViewRSBindSlot = 2;
@@ -595,6 +894,11 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 		pPerView->ScreenDimensions.y = RenderResolutionY;
 		pPerView->MaxEnvMapLODLevels = static_cast<float>(mResources_MainWnd.EnvironmentMap.GetNumSpecularIrradianceCubemapLODLevels(mRenderer));
 		pPerView->EnvironmentMapDiffuseOnlyIllumination = IsFFX_SSSREnabled(mSettings);
+		pPerView->NumLightClustersX = static_cast<int>(SceneView.LightClusterGrid.NumClustersX);
+		pPerView->NumLightClustersY = static_cast<int>(SceneView.LightClusterGrid.NumClustersY);
+		pPerView->NumLightClustersZ = static_cast<int>(SceneView.LightClusterGrid.NumClustersZ);
+		pPerView->LightClusterSliceScale = SceneView.LightClusterGrid.SliceScale;
+		pPerView->LightClusterSliceBias  = SceneView.LightClusterGrid.SliceBias;
 
 		// TODO: PreView data
 
@@ -609,8 +913,13 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 		constexpr UINT PerObjRSBindSlot = 1;
 		SCOPED_GPU_MARKER(pCmd, "Geometry");
 
-		for (const FMeshRenderCommand& meshRenderCmd : SceneView.meshRenderCommands)
+		if (bInstancedDraws)
 		{
+			DrawInstancedMeshRenderCommands(pCmd, pCBufferHeap, SceneView, PerObjRSBindSlot, iDrawBegin, iDrawEnd);
+		}
+		else for (size_t iDraw = iDrawBegin; iDraw < iDrawEnd; ++iDraw)
+		{
+			const FMeshRenderCommand& meshRenderCmd = SceneView.meshRenderCommands[iDraw];
 			const Material& mat = mpScene->GetMaterial(meshRenderCmd.matID);
 
 			// set constant buffer data
@@ -649,17 +958,20 @@ void VQEngine::RenderSceneColor(ID3D12GraphicsCommandList* pCmd, DynamicBufferHe
 			const uint32 NumInstances = 1;
 			const BufferID& VB_ID = VBIBIDs.first;
 			const BufferID& IB_ID = VBIBIDs.second;
-			const VBV& vb = mRenderer.GetVertexBufferView(VB_ID);
+			const VBV vb = mRenderPass_Skinning.GetVertexBufferView(mRenderer.GetVertexBufferView(VB_ID), meshRenderCmd.iFirstSkinnedVertex);
 			const IBV& ib = mRenderer.GetIndexBufferView(IB_ID);
 
 			pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 			pCmd->IASetVertexBuffers(0, 1, &vb);
 			pCmd->IASetIndexBuffer(&ib);
 
-			pCmd->DrawIndexedInstanced(NumIndices, NumInstances, 0, 0, 0);
+			DrawMeshRenderCommandIndices(pCmd, SceneView, meshRenderCmd, NumIndices, NumInstances);
 		}
 	}
 
+	if (!bLastDrawRange)
+		return;
+
 	// Draw Light Meshes ------------------------------------------
 	if(!SceneView.lightRenderCommands.empty())
 	{
@@ -30,3 +30,10 @@
 
 constexpr bool MSAA_ENABLE = true;
 constexpr uint MSAA_SAMPLE_COUNT = 4;
+
+//
+// SHADOW MAPS
+//
+constexpr uint SHADOW_MAP_DIMENSION_SPOT = 1024;
+constexpr uint SHADOW_MAP_DIMENSION_POINT = 1024;
+constexpr uint SHADOW_MAP_DIMENSION_DIRECTIONAL = 2048;
@@ -28,6 +28,9 @@
 
 #include "VQEngine_RenderCommon.h"
 
+#include <cstddef>
+#include <cstring>
+
 // ------------------------------------------------------------------------------------------------------------------------------------------------------------
 //
 // MAIN
@@ -87,17 +90,44 @@ void VQEngine::SimulationThread_Tick(const float dt)
 {
 	SCOPED_CPU_MARKER_C("SimulationThread_Tick()", 0xFF007777);
 
+	// benchmark runs simulate w/ a fixed timestep so the camera sequence doesn't depend on the frame times
+	const bool bLoading = mbLoadingLevel || mbLoadingEnvironmentMap;
+	const bool bBenchmarkFrame = mCameraBenchmark.IsRunning() && mAppState == EAppState::SIMULATING && !bLoading;
+	const float dtSim = bBenchmarkFrame ? mCameraBenchmark.GetFixedTimestep() : dt;
+	Timer t; t.Start();
+
 	// world update
-	UpdateThread_Tick(dt);
+	UpdateThread_Tick(dtSim);
+	const float UpdateMs = t.Tick() * 1000.0f;
 
 	// ui
 	if (!(mbLoadingLevel || mbLoadingEnvironmentMap))
 	{
-		UpdateUIState(mpWinMain->GetHWND(), dt);
+		UpdateUIState(mpWinMain->GetHWND(), dtSim);
 	}
+	const float UIMs = t.Tick() * 1000.0f;
 
 	// render
 	RenderThread_Tick();
+	const float RenderMs = t.Tick() * 1000.0f;
+
+	if (mAppState == EAppState::SIMULATING && !bLoading)
+	{
+		RecordFrameStatistics(UpdateMs, UIMs, RenderMs, dt);
+	}
+
+	if (bBenchmarkFrame)
+	{
+		mCameraBenchmark.EndFrame(UpdateMs, UIMs, RenderMs);
+		if (mCameraBenchmark.IsFinished())
+		{
+			const std::string& TrackFile = mCameraBenchmark.GetTrackFilePath();
+			const std::string ResultsFilePrefix = TrackFile.substr(0, TrackFile.find_last_of('.'));
+			mCameraBenchmark.WriteResults(ResultsFilePrefix + "_benchmark.csv");
+			if (!mFrameStatistics.WriteJSON(ResultsFilePrefix + "_framestats.json")) // percentiles & outlier frames
+				Log::Error("Couldn't write %s_framestats.json", ResultsFilePrefix.c_str());
+		}
+	}
 
 	++mNumSimulationTicks;
 }
@@ -105,4 +135,73 @@ void VQEngine::SimulationThread_Tick(const float dt)
 void VQEngine::SimulationThread_Initialize(){}
 void VQEngine::SimulationThread_Exit(){}
 void VQEngine::SimulationThread_Tick(float dt){}
-#endif
\ No newline at end of file
+#endif
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+//
+// FRAME STATISTICS
+//
+// ------------------------------------------------------------------------------------------------------------------------------------------------------------
+// recorded on the simulation thread, i.e. w/o VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS.
+// every FSceneStats field is a 4B uint or float, recorded as a channel of the same name
+struct FSceneStatsField { const char* pName; size_t Offset; bool bFloat; };
+#define SCENE_STATS_UINT(Field)  { #Field, offsetof(FSceneStats, Field), false }
+#define SCENE_STATS_FLOAT(Field) { #Field, offsetof(FSceneStats, Field), true  }
+static const FSceneStatsField SCENE_STATS_FIELDS[] =
+{
+	SCENE_STATS_UINT(NumDirectionalLights), SCENE_STATS_UINT(NumStaticLights), SCENE_STATS_UINT(NumDynamicLights), SCENE_STATS_UINT(NumStationaryLights)
+	, SCENE_STATS_UINT(NumSpotLights), SCENE_STATS_UINT(NumPointLights), SCENE_STATS_UINT(NumDisabledSpotLights), SCENE_STATS_UINT(NumDisabledPointLights)
+	, SCENE_STATS_UINT(NumDisabledDirectionalLights), SCENE_STATS_UINT(NumShadowingPointLights), SCENE_STATS_UINT(NumShadowingSpotLights)
+	, SCENE_STATS_UINT(NumMeshRenderCommands), SCENE_STATS_UINT(NumShadowMeshRenderCommands), SCENE_STATS_UINT(NumBoundingBoxRenderCommands)
+	, SCENE_STATS_UINT(NumOccluders), SCENE_STATS_UINT(NumOccluderTriangles), SCENE_STATS_UINT(NumOcclusionTestedMeshes), SCENE_STATS_UINT(NumOccludedMeshes), SCENE_STATS_FLOAT(OcclusionRasterizationTimeMs)
+	, SCENE_STATS_UINT(NumLightClusters), SCENE_STATS_UINT(NumOccupiedLightClusters), SCENE_STATS_UINT(NumLightClusterIndices), SCENE_STATS_UINT(MaxLightsPerCluster), SCENE_STATS_FLOAT(LightBinningTimeMs)
+	, SCENE_STATS_UINT(NumInstancedDrawBatches), SCENE_STATS_UINT(NumDrawBatches), SCENE_STATS_FLOAT(InstanceBatchingTimeMs)
+	, SCENE_STATS_UINT(NumTestedMeshlets), SCENE_STATS_UINT(NumFrustumCulledMeshlets), SCENE_STATS_UINT(NumBackfaceCulledMeshlets), SCENE_STATS_UINT(NumMeshletCulledMeshes)
+	, SCENE_STATS_UINT(NumMeshletIndexRanges), SCENE_STATS_UINT(NumMeshletTestedTriangles), SCENE_STATS_UINT(NumMeshletVisibleTriangles), SCENE_STATS_FLOAT(MeshletCullingTimeMs)
+	, SCENE_STATS_UINT(NumAnimatedInstances), SCENE_STATS_UINT(NumAnimatedBones), SCENE_STATS_FLOAT(AnimationEvaluationTimeMs)
+	, SCENE_STATS_UINT(NumRayQueryMeshes), SCENE_STATS_UINT(NumRayQueryTriangles), SCENE_STATS_UINT(NumRayQueryInstances), SCENE_STATS_UINT(NumRayQueries), SCENE_STATS_FLOAT(RayQueryBuildTimeMs)
+	, SCENE_STATS_UINT(NumCachedShadowViews), SCENE_STATS_UINT(NumDynamicRedrawnShadowViews), SCENE_STATS_UINT(NumFullyRedrawnShadowViews)
+	, SCENE_STATS_UINT(NumMeshes), SCENE_STATS_UINT(NumModels), SCENE_STATS_UINT(NumMaterials), SCENE_STATS_UINT(NumObjects), SCENE_STATS_UINT(NumCameras)
+};
+#undef SCENE_STATS_UINT
+#undef SCENE_STATS_FLOAT
+static_assert(sizeof(SCENE_STATS_FIELDS) / sizeof(SCENE_STATS_FIELDS[0]) * 4 == sizeof(FSceneStats), "FSceneStats changed, update SCENE_STATS_FIELDS");
+
+void VQEngine::InitializeFrameStatistics()
+{
+	constexpr size_t FRAME_STATISTICS_HISTORY_SIZE = 2048;
+	FFrameStatisticsChannels& c = mFrameStatisticsChannels;
+	mFrameStatistics.Initialize(FRAME_STATISTICS_HISTORY_SIZE);
+	c.UpdateMs   = mFrameStatistics.RegisterChannel("UpdateMs", true);
+	c.UIMs       = mFrameStatistics.RegisterChannel("UIMs", true);
+	c.RenderMs   = mFrameStatistics.RegisterChannel("RenderMs", true);
+	c.CPUFrameMs = mFrameStatistics.RegisterChannel("CPUFrameMs", true);
+	c.FrameMs    = mFrameStatistics.RegisterChannel("FrameMs", true);
+	c.SceneStats = mFrameStatistics.GetNumChannels();
+	for (const FSceneStatsField& f : SCENE_STATS_FIELDS)
+		mFrameStatistics.RegisterChannel(f.pName, f.bFloat); // outliers for the timings only
+}
+
+void VQEngine::RecordFrameStatistics(float UpdateMs, float UIMs, float RenderMs, float dt)
+{
+	SCOPED_CPU_MARKER("RecordFrameStatistics()");
+	const FFrameStatisticsChannels& c = mFrameStatisticsChannels;
+	mFrameStatistics.Record(c.UpdateMs, UpdateMs);
+	mFrameStatistics.Record(c.UIMs, UIMs);
+	mFrameStatistics.Record(c.RenderMs, RenderMs);
+	mFrameStatistics.Record(c.CPUFrameMs, UpdateMs + UIMs + RenderMs);
+	mFrameStatistics.Record(c.FrameMs, dt * 1000.0f);
+
+	const FSceneStats SceneStats = mpScene->GetSceneRenderStats(0);
+	const unsigned char* pSceneStats = reinterpret_cast<const unsigned char*>(&SceneStats);
+	for (uint32 i = 0; i < static_cast<uint32>(sizeof(SCENE_STATS_FIELDS) / sizeof(SCENE_STATS_FIELDS[0])); ++i)
+	{
+		const FSceneStatsField& f = SCENE_STATS_FIELDS[i];
+		float Value;
+		if (f.bFloat) memcpy(&Value, pSceneStats + f.Offset, sizeof(float));
+		else          { uint Count; memcpy(&Count, pSceneStats + f.Offset, sizeof(uint)); Value = static_cast<float>(Count); }
+		mFrameStatistics.Record(c.SceneStats + i, Value);
+	}
+	mFrameStatistics.EndFrame();
+}
@@ -28,6 +28,7 @@
 #include "Libs/VQUtils/Source/utils.h"
 
 #include <algorithm>
+#include <filesystem>
 
 #include <dwmapi.h>
 #pragma comment(lib, "Dwmapi.lib")
@@ -106,6 +107,8 @@ void VQEngine::UpdateThread_Tick(const float dt)
 
 	UpdateThread_PostUpdate();
 
+	MemoryTracking::EndFrame();
+
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
 	++mNumUpdateLoopsExecuted;
 
@@ -115,6 +118,16 @@ void VQEngine::UpdateThread_Tick(const float dt)
 
 void VQEngine::UpdateThread_Exit()
 {
+	if (!mSettings.CameraTrackRecordFile.empty() && !mCameraTrackRecording.IsEmpty())
+	{
+		if (mCameraTrackRecording.Save(mSettings.CameraTrackRecordFile))
+			Log::Info("Saved camera track (%u keys, %.2fs) to %s", static_cast<unsigned>(mCameraTrackRecording.GetNumKeys()), mCameraTrackRecording.GetDuration(), mSettings.CameraTrackRecordFile.c_str());
+	}
+	if (!mSettings.TextureTraceRecordFile.empty())
+	{
+		if (mRenderer.SaveTextureVisibilityTrace(mSettings.TextureTraceRecordFile))
+			Log::Info("Saved texture visibility trace to %s", mSettings.TextureTraceRecordFile.c_str());
+	}
 	mpScene->Unload();
 	ExitUI();
 }
@@ -123,6 +136,11 @@ void VQEngine::UpdateThread_PreUpdate()
 {
 	SCOPED_CPU_MARKER("UpdateThread_PreUpdate()");
 
+	for (auto it = mInputStates.begin(); it != mInputStates.end(); ++it)
+	{
+		it->second.PreUpdate(); // evaluate input actions
+	}
+
 	const int NUM_BACK_BUFFERS = mRenderer.GetSwapChainBackBufferCount(mpWinMain->GetHWND());
 
 	if (mpScene)
@@ -179,6 +197,8 @@ void VQEngine::UpdateThread_UpdateAppState(const float dt)
 
 				float dt_loading = mTimer.StopGetDeltaTimeAndReset();
 				Log::Info("Loading completed in %.2fs, starting scene simulation", dt_loading);
+				MemoryTracking::LogSnapshotDiff("(load)", mMemorySnapshot_LoadStart, MemoryTracking::CaptureSnapshot());
+				mFrameStatistics.Reset(); // per scene, w/o the loading frames
 				mTimer.Start();
 			}
 		}
@@ -371,13 +391,23 @@ void VQEngine::UpdateThread_UpdateScene_MainWnd(const float dt)
 
 	mpScene->Update(dt, FRAME_DATA_INDEX);
 
+	// camera tracks: playback overrides the camera controllers, recording samples the result of this update
+	if (mCameraBenchmark.IsRunning() && !(mbLoadingLevel || mbLoadingEnvironmentMap))
+	{
+		mpScene->GetActiveCamera().ApplyTrackKey(mCameraBenchmark.GetCurrentCameraKey());
+	}
+	else if (!mSettings.CameraTrackRecordFile.empty() && !mbLoadingLevel)
+	{
+		mCameraTrackRecording.AddKey(mpScene->GetActiveCamera().GetTrackKey(mCameraTrackRecordTime));
+		mCameraTrackRecordTime += dt;
+	}
+
 	HandleEngineInput(); // system-wide input (esc/mouse click on wnd)
 	for (decltype(mInputStates)::iterator it = mInputStates.begin(); it != mInputStates.end(); ++it)
 	{
 		HWND   hwnd = it->first;
 		Input& input = it->second;
 		auto& pWin = this->GetWindow(hwnd);
-		const bool bIsShiftDown = input.IsKeyDown("Shift");
 
 		if (pWin == mpWinMain)
 			HandleMainWindowInput(input, hwnd);
@@ -403,6 +433,8 @@ void VQEngine::Load_SceneData_Dispatch()
 	const std::string SceneFileName = mQueue_SceneLoad.front();
 	mQueue_SceneLoad.pop();
 
+	SCOPED_MEMORY_TAG(EMemoryTag::SceneLoading);
+	mMemorySnapshot_LoadStart = MemoryTracking::CaptureSnapshot();
 
 	const int NUM_SWAPCHAIN_BACKBUFFERS = mSettings.gfx.bUseTripleBuffering ? 3 : 2;
 	const Input& input = mInputStates.at(mpWinMain->GetHWND());
@@ -424,7 +456,7 @@ void VQEngine::Load_SceneData_Dispatch()
 
 	// load scene representation from disk
 	const std::string SceneFilePath = "Data/Levels/" + SceneFileName + ".xml";
-	FSceneRepresentation SceneRep = VQEngine::ParseSceneFile(SceneFilePath);
+	FSceneRepresentation SceneRep = VQEngine::LoadSceneFile(SceneFilePath);
 	fnCreateSceneInstance(SceneRep.SceneName, mpScene);
 
 	//----------------------------------------------------------------------
@@ -591,3 +623,77 @@ void VQEngine::StartLoadingScene(int IndexScene)
 	Log::Info("StartLoadingScene: %d", IndexScene);
 }
 
+static std::string GetSceneSnapshotFilePath(const std::string& SceneName)
+{
+	return "Cache/Snapshots/" + SceneName + ".vqsnap";
+}
+
+void VQEngine::SaveSceneSnapshot()
+{
+	const std::string FilePath = GetSceneSnapshotFilePath(mResourceNames.mSceneNames[mIndex_SelectedScene]);
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(FilePath).parent_path(), ec);
+
+	this->WaitUntilRenderingFinishes(); // scene data is read by the render thread w/ pipelined update & render
+
+	Timer t; t.Start();
+	FSceneSnapshot Snapshot;
+	mpScene->CaptureSnapshot(Snapshot);
+	const float CaptureMs = t.Tick() * 1000.0f;
+	if (SceneSnapshot::Save(FilePath, Snapshot))
+		Log::Info("Saved scene snapshot: %s (%u game objects, capture=%.2fms save=%.2fms)", FilePath.c_str(), static_cast<uint32>(Snapshot.Objects.size()), CaptureMs, t.Tick() * 1000.0f);
+	else
+		Log::Error("Couldn't save scene snapshot: %s", FilePath.c_str());
+}
+
+void VQEngine::DumpMemoryReport()
+{
+	if (!MemoryTracking::IsEnabled())
+	{
+		Log::Warning("DumpMemoryReport: memory tracking is compiled out (MEMORY_TRACKING__ENABLE=0)");
+		return;
+	}
+	const FMemorySnapshot Snapshot = MemoryTracking::CaptureSnapshot();
+	const std::string FilePath = "Cache/MemoryReports/" + mResourceNames.mSceneNames[mIndex_SelectedScene] + "_frame" + std::to_string(Snapshot.FrameIndex) + ".json";
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(FilePath).parent_path(), ec);
+	if (MemoryTracking::WriteSnapshotJSON(Snapshot, FilePath))
+		Log::Info("Saved memory report: %s (%lld bytes in %lld live allocations)", FilePath.c_str(), Snapshot.Total.CurrentBytes, Snapshot.Total.NumLiveAllocations);
+}
+
+void VQEngine::SaveFrameStatistics()
+{
+	if (mFrameStatistics.GetNumFrames() == 0)
+	{
+		Log::Warning("SaveFrameStatistics: no frames recorded");
+		return;
+	}
+	const std::string FilePathPrefix = "Cache/FrameStats/" + mResourceNames.mSceneNames[mIndex_SelectedScene] + "_frame" + std::to_string(mNumSimulationTicks);
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(FilePathPrefix).parent_path(), ec);
+	if (mFrameStatistics.WriteCSV(FilePathPrefix + ".csv") && mFrameStatistics.WriteJSON(FilePathPrefix + ".json"))
+		Log::Info("Saved frame statistics: %s.csv/.json (%d frames of history, %llu frames total)", FilePathPrefix.c_str(), static_cast<int>(mFrameStatistics.GetHistoryCount()), mFrameStatistics.GetNumFrames());
+	else
+		Log::Error("SaveFrameStatistics: couldn't write %s.csv/.json", FilePathPrefix.c_str());
+}
+
+void VQEngine::RestoreSceneSnapshot()
+{
+	const std::string FilePath = GetSceneSnapshotFilePath(mResourceNames.mSceneNames[mIndex_SelectedScene]);
+	if (!std::filesystem::exists(FilePath))
+	{
+		Log::Warning("No scene snapshot to restore: %s", FilePath.c_str());
+		return;
+	}
+
+	Timer t; t.Start();
+	FSceneSnapshot Snapshot;
+	if (!SceneSnapshot::Load(FilePath, Snapshot))
+		return;
+	const float LoadMs = t.Tick() * 1000.0f;
+
+	this->WaitUntilRenderingFinishes();
+	mpScene->RestoreSnapshot(Snapshot);
+	Log::Info("Restored scene snapshot: %s (load=%.2fms restore=%.2fms)", FilePath.c_str(), LoadMs, t.Tick() * 1000.0f);
+}
+
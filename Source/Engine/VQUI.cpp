@@ -104,6 +104,7 @@ static void InitializeEngineUIState(FUIState& s)
 	s.bWindowVisible_GraphicsSettingsPanel = false;
 	s.bWindowVisible_Profiler = false;
 	s.bWindowVisible_DebugPanel = false;
+	s.bWindowVisible_Console = false;
 	s.bProfiler_ShowEngineStats = true;
 }
 
@@ -188,6 +189,7 @@ void VQEngine::ExitUI()
 void VQEngine::UpdateUIState(HWND hwnd, float dt)
 {
 	SCOPED_CPU_MARKER_C("UpdateUIState()", 0xFF007777);
+	SCOPED_MEMORY_TAG(EMemoryTag::UI);
 
 	// Data for the UI controller to update
 #if VQENGINE_MT_PIPELINED_UPDATE_AND_RENDER_THREADS
@@ -212,6 +214,7 @@ void VQEngine::UpdateUIState(HWND hwnd, float dt)
 		if (mUIState.bWindowVisible_Profiler)              DrawProfilerWindow(mpScene->GetSceneRenderStats(FRAME_DATA_INDEX), dt);
 		if (mUIState.bWindowVisible_DebugPanel)            DrawDebugPanelWindow(SceneParams, PPParams);
 		if (mUIState.bWindowVisible_GraphicsSettingsPanel) DrawGraphicsSettingsWindow(SceneParams, PPParams);
+		if (mUIState.bWindowVisible_Console)               DrawConsoleWindow();
 	}
 
 	// If we fired an event that would trigger loading,
@@ -252,6 +255,10 @@ const uint32_t DBG_WINDOW_PADDING_Y      = 10;
 const uint32_t DBG_WINDOW_SIZE_X         = 330;
 const uint32_t DBG_WINDOW_SIZE_Y         = 180;
 //---------------------------------------------
+const uint32_t CONSOLE_WINDOW_PADDING_Y  = 10;
+const uint32_t CONSOLE_WINDOW_SIZE_X     = 520;
+const uint32_t CONSOLE_WINDOW_SIZE_Y     = 240;
+//---------------------------------------------
 
 
 // Dropdown data ----------------------------------------------------------------------------------------------
@@ -431,9 +438,19 @@ static void DrawFPSChart(int fps)
 	const ImVec2 GRAPH_SIZE = ImVec2(0, 60);
 	ImGui::PlotLines(FPS_GRAPH_MAX_FPS_THRESHOLDS_STR[iFPSGraphMaxValue], FPS_HISTORY, FPS_HISTORY_SIZE, 0, "FPS", 0.0f, (float)FPS_GRAPH_MAX_FPS_THRESHOLDS[iFPSGraphMaxValue], GRAPH_SIZE);
 }
-static void DrawFrameTimeChart()
+static void DrawFrameTimeChart(const FrameStatistics& Stats, FrameStatistics::ChannelID Channel)
 {
-	// TODO
+	if (Stats.GetHistoryCount() == 0)
+		return;
+
+	// scale to the recent P99 so that the outlier frames don't flatten the chart
+	const FrameStatistics::FChannelSummary s = Stats.GetSummary(Channel);
+	const float ChartMaxMs = std::max(1.0f, s.P99 * 1.25f);
+	char Overlay[64];
+	snprintf(Overlay, sizeof(Overlay), "P50 %.2f | P99 %.2f ms", s.P50, s.P99);
+
+	const ImVec2 GRAPH_SIZE = ImVec2(0, 60);
+	ImGui::PlotLines("ms", Stats.GetHistoryData(Channel), static_cast<int>(Stats.GetHistoryCount()), static_cast<int>(Stats.GetHistoryOffset()), Overlay, 0.0f, ChartMaxMs, GRAPH_SIZE);
 }
 
 
@@ -475,6 +492,7 @@ void VQEngine::DrawSceneControlsWindow(int& iSelectedCamera, int& iSelectedEnvMa
 	ImGui::Checkbox("Show Graphics Settings (F3)", &mUIState.bWindowVisible_GraphicsSettingsPanel);
 	ImGui::Checkbox("Show Profiler (F2)", &mUIState.bWindowVisible_Profiler);
 	ImGui::Checkbox("Show Debug (F4)", &mUIState.bWindowVisible_DebugPanel);
+	ImGui::Checkbox("Show Console (F5)", &mUIState.bWindowVisible_Console);
 
 	ImGuiSpacing3();
 
@@ -539,6 +557,7 @@ void VQEngine::DrawKeyMappingsWindow()
 		ImGui::Text("          F2 : Toggle Profiler Window");
 		ImGui::Text("          F3 : Toggle Graphics Settings Window");
 		ImGui::Text("          F4 : Toggle Debug Window");
+		ImGui::Text("          F5 : Toggle Console Window");
 		ImGui::Text("     Shift+Z : Show/Hide ALL UI windows");
 
 		ImGui::PushStyleColor(ImGuiCol_Text, ColHeader);
@@ -563,6 +582,10 @@ void VQEngine::DrawKeyMappingsWindow()
 		ImGui::Text("------------------ SCENE -----------------------");
 		ImGui::PopStyleColor(1);
 		ImGui::Text("     Shift+R : Reload level");
+		ImGui::Text("          F6 : Save scene snapshot");
+		ImGui::Text("          F7 : Restore scene snapshot");
+		ImGui::Text("          F8 : Save memory report");
+		ImGui::Text("          F9 : Save frame statistics");
 		ImGui::Text("Page Up/Down : Change the HDRI Environment Map");
 		ImGui::Text("         1-4 : Change between available scenes");
 		ImGui::Text("           R : Reset camera");
@@ -598,6 +621,9 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 	const float WHITE_AMOUNT = 0.70f;
 	const ImVec4 DataTextColor = ImVec4(WHITE_AMOUNT, WHITE_AMOUNT, WHITE_AMOUNT, 1.0f);
 	const ImVec4 DataHighlightedColor = ImVec4(1, 1, 1, 1);
+#if MEMORY_TRACKING__ENABLE
+	const FMemorySnapshot MemorySnapshot = MemoryTracking::GetFrameSnapshot();
+#endif
 
 	ImGui::SetNextWindowPos(ImVec2((float)PROFILER_WINDOW_POS_X, (float)PROFILER_WINDOW_POS_Y), ImGuiCond_FirstUseEver);
 	ImGui::SetNextWindowSize(ImVec2(PROFILER_WINDOW_SIZE_X, PROFILER_WINDOW_SIZE_Y), ImGuiCond_FirstUseEver);
@@ -616,7 +642,7 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 		ImGui::TextColored(SelectFPSColor(fps), "FPS        : %d (%.2f ms)", fps, frameTime_ms);
 		
 		DrawFPSChart(fps);
-		DrawFrameTimeChart();
+		DrawFrameTimeChart(mFrameStatistics, mFrameStatisticsChannels.FrameMs);
 	}
 
 	ImGuiSpacing3();
@@ -627,8 +653,8 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 		ImGui::TextColored(DataTextColor, "GPU        : %s", mSysInfo.GPUs.back().DeviceName.c_str());
 		ImGui::TextColored(DataTextColor, "CPU        : %s", mSysInfo.CPU.DeviceName.c_str());
 		ImGui::TextColored(DataTextColor, "Video  RAM : %s", StrUtil::FormatByte(mSysInfo.GPUs.back().DedicatedGPUMemory).c_str());
-#if 0   // TODO: after memory tracking, display system and GPU memory that are in use
-		ImGui::TextColored(DataTextColor, "System RAM : 0B used of %s", StrUtil::FormatByte(mSysInfo.RAM.TotalPhysicalMemory).c_str());
+#if MEMORY_TRACKING__ENABLE // TODO: display GPU memory in use
+		ImGui::TextColored(DataTextColor, "System RAM : %s tracked of %s", StrUtil::FormatByte(static_cast<size_t>(std::max(0ll, MemorySnapshot.Total.CurrentBytes))).c_str(), StrUtil::FormatByte(mSysInfo.RAM.TotalPhysicalMemory).c_str());
 #else
 		ImGui::TextColored(DataTextColor, "System RAM : %s", StrUtil::FormatByte(mSysInfo.RAM.TotalPhysicalMemory).c_str());
 #endif
@@ -673,6 +699,65 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 			ImGui::TextColored(DataTextColor, "Directional Lights : %d/%d", s.NumDirectionalLights - s.NumDisabledDirectionalLights, s.NumDirectionalLights);
 		}
 		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("OCCLUSION CULLING", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Occluders     : %d (%d triangles)", s.NumOccluders, s.NumOccluderTriangles);
+			ImGui::TextColored(DataTextColor, "Occluded      : %d/%d meshes", s.NumOccludedMeshes, s.NumOcclusionTestedMeshes);
+			ImGui::TextColored(DataTextColor, "Rasterization : %.2f ms", s.OcclusionRasterizationTimeMs);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("CLUSTERED LIGHTING", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Occupied Clusters : %d/%d", s.NumOccupiedLightClusters, s.NumLightClusters);
+			ImGui::TextColored(DataTextColor, "Light Indices     : %d (max %d/cluster)", s.NumLightClusterIndices, s.MaxLightsPerCluster);
+			ImGui::TextColored(DataTextColor, "Binning           : %.2f ms", s.LightBinningTimeMs);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("INSTANCING", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Draws     : %d (from %d mesh commands)", s.NumDrawBatches, s.NumMeshRenderCommands);
+			ImGui::TextColored(DataTextColor, "Instanced : %d batches", s.NumInstancedDrawBatches);
+			ImGui::TextColored(DataTextColor, "Batching  : %.2f ms", s.InstanceBatchingTimeMs);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("MESHLET CULLING", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Culled    : %d frustum, %d backface / %d meshlets", s.NumFrustumCulledMeshlets, s.NumBackfaceCulledMeshlets, s.NumTestedMeshlets);
+			ImGui::TextColored(DataTextColor, "Meshes    : %d fully culled", s.NumMeshletCulledMeshes);
+			ImGui::TextColored(DataTextColor, "Triangles : %d/%d in %d index ranges", s.NumMeshletVisibleTriangles, s.NumMeshletTestedTriangles, s.NumMeshletIndexRanges);
+			ImGui::TextColored(DataTextColor, "Culling   : %.2f ms", s.MeshletCullingTimeMs);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("ANIMATION", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Instances : %d", s.NumAnimatedInstances);
+			ImGui::TextColored(DataTextColor, "Bones     : %d", s.NumAnimatedBones);
+			ImGui::TextColored(DataTextColor, "Evaluation: %.2f ms", s.AnimationEvaluationTimeMs);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("RAY QUERIES", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Meshes    : %d", s.NumRayQueryMeshes);
+			ImGui::TextColored(DataTextColor, "Instances : %d", s.NumRayQueryInstances);
+			ImGui::TextColored(DataTextColor, "Triangles : %d", s.NumRayQueryTriangles);
+			ImGui::TextColored(DataTextColor, "Queries   : %d", s.NumRayQueries);
+			ImGui::TextColored(DataTextColor, "Build     : %.2f ms", s.RayQueryBuildTimeMs);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("SHADOW CACHE", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::TextColored(DataTextColor, "Cached Views        : %d", s.NumCachedShadowViews);
+			ImGui::TextColored(DataTextColor, "Dynamic Redraw Views: %d", s.NumDynamicRedrawnShadowViews);
+			ImGui::TextColored(DataTextColor, "Full Redraw Views   : %d", s.NumFullyRedrawnShadowViews);
+		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("COMMAND RECORDING", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			const CommandRecordingScheduler::FStatistics& r = mCommandRecordingScheduler.GetStatistics();
+			ImGui::TextColored(DataTextColor, "Command Lists : %d (%d chunks)", r.NumCommandLists, r.NumChunks);
+			ImGui::TextColored(DataTextColor, "Imbalance     : %.2f", r.Imbalance);
+		}
+		ImGuiSpacing3();
 		if (ImGui::CollapsingHeader("RENDER COMMANDS", ImGuiTreeNodeFlags_DefaultOpen))
 		{
 			ImGui::TextColored(DataTextColor, "Mesh         : %d", s.NumMeshRenderCommands);
@@ -683,6 +768,44 @@ void VQEngine::DrawProfilerWindow(const FSceneStats& FrameStats, float dt)
 			ImGui::TextColored(DataTextColor, "Dispatch Calls : %d", mRenderStats.NumDispatches);
 #endif
 		}
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("FRAME STATISTICS", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			const FFrameStatisticsChannels& c = mFrameStatisticsChannels;
+			ImGui::TextColored(DataTextColor, "Frames     : %llu", mFrameStatistics.GetNumFrames());
+			ImGui::TextColored(DataTextColor, "Stage      :   P50 |   P90 |   P99 | Outliers");
+			for (FrameStatistics::ChannelID Channel : { c.UpdateMs, c.UIMs, c.RenderMs, c.CPUFrameMs, c.FrameMs })
+			{
+				const FrameStatistics::FChannelSummary fs = mFrameStatistics.GetSummary(Channel);
+				ImGui::TextColored(DataTextColor, "%-10s : %5.2f | %5.2f | %5.2f | %u", mFrameStatistics.GetChannelName(Channel).c_str(), fs.P50, fs.P90, fs.P99, fs.NumOutliers);
+			}
+			const std::deque<FrameStatistics::FOutlierFrame>& Outliers = mFrameStatistics.GetOutlierFrames();
+			if (!Outliers.empty())
+			{
+				const FrameStatistics::FOutlierFrame& o = Outliers.back();
+				ImGui::TextColored(DataTextColor, "Last outlier: frame %llu, %s %.2f (> %.2f)", o.FrameIndex, mFrameStatistics.GetChannelName(o.Channel).c_str(), o.Value, o.Fence);
+			}
+		}
+#if MEMORY_TRACKING__ENABLE
+		ImGuiSpacing3();
+		if (ImGui::CollapsingHeader("MEMORY", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			// current (peak) & allocations in the last frame, tags w/o live memory or frame allocations are skipped
+			for (size_t i = 0; i < static_cast<size_t>(EMemoryTag::NUM_MEMORY_TAGS); ++i)
+			{
+				const FMemoryTagStats& t = MemorySnapshot.Tags[i];
+				if (t.CurrentBytes == 0 && t.NumFrameAllocations == 0)
+					continue;
+				ImGui::TextColored(DataTextColor, "%-14s : %s (%s), %llu/frame"
+					, MemoryTracking::GetTagName(static_cast<EMemoryTag>(i))
+					, StrUtil::FormatByte(static_cast<size_t>(std::max(0ll, t.CurrentBytes))).c_str()
+					, StrUtil::FormatByte(static_cast<size_t>(std::max(0ll, t.PeakBytes))).c_str()
+					, t.NumFrameAllocations
+				);
+			}
+			ImGui::TextColored(DataTextColor, "Total allocations: %llu/frame", MemorySnapshot.Total.NumFrameAllocations);
+		}
+#endif
 	}
 	ImGui::End();
 }
@@ -721,6 +844,19 @@ void VQEngine::DrawDebugPanelWindow(FSceneRenderParameters& SceneParams, FPostPr
 	ImGui::Checkbox("Show Mesh Bounding Boxes (N)", &SceneParams.bDrawMeshBoundingBoxes);
 	ImGui::Checkbox("Show Light Bounding Volumes (L)", &SceneParams.bDrawLightBounds);
 	ImGui::Checkbox("Draw Lights", &SceneParams.bDrawLightMeshes);
+	ImGui::Checkbox("Software Occlusion Culling", &SceneParams.bOcclusionCulling);
+	ImGui::Checkbox("Cache Shadow Maps", &SceneParams.bCacheShadowMaps);
+	ImGui::SliderFloat("Directional Shadow Distance", &SceneParams.fDirectionalShadowDistance, 10.0f, 2000.0f, "%.0f");
+	ImGui::SliderFloat("Cascade Split Lambda", &SceneParams.fCascadeSplitLambda, 0.0f, 1.0f, "%.2f");
+	ImGui::Checkbox("Instanced Draws", &SceneParams.bInstancedDraws);
+	if (SceneParams.bInstancedDraws)
+	{
+		ImGui::SliderInt("Max Instances Per Batch", &SceneParams.iMaxInstancesPerBatch, 1, MAX_INSTANCE_COUNT__SCENE_MESHES);
+	}
+	else
+	{
+		ImGui::Checkbox("Meshlet Culling", &SceneParams.bMeshletCulling);
+	}
 
 	ImGui::End();
 }
@@ -983,4 +1119,39 @@ void VQEngine::DrawGraphicsSettingsWindow(FSceneRenderParameters& SceneRenderPar
 	ImGui::End();
 }
 
+void VQEngine::DrawConsoleWindow()
+{
+	const uint32 W = mpWinMain->GetWidth();
+
+	const uint32_t CONSOLE_WINDOW_POS_X = (W - CONSOLE_WINDOW_SIZE_X) >> 1;
+	const uint32_t CONSOLE_WINDOW_POS_Y = CONSOLE_WINDOW_PADDING_Y;
+	ImGui::SetNextWindowPos(ImVec2((float)CONSOLE_WINDOW_POS_X, (float)CONSOLE_WINDOW_POS_Y), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowSize(ImVec2(CONSOLE_WINDOW_SIZE_X, CONSOLE_WINDOW_SIZE_Y), ImGuiCond_FirstUseEver);
+
+	ImGui::Begin("CONSOLE", &mUIState.bWindowVisible_Console);
+
+	// "<variable> <value>" sets the variable, "<variable>" logs its value
+	static char szCommand[256] = "";
+	if (ImGui::InputText("##Command", szCommand, sizeof(szCommand), ImGuiInputTextFlags_EnterReturnsTrue))
+	{
+		mConsoleVariables.Execute(szCommand);
+		szCommand[0] = '\0';
+		ImGui::SetKeyboardFocusHere(-1);
+	}
+	ImGui::Separator();
+
+	for (const ConsoleVariables::FVariable& v : mConsoleVariables.GetVariables())
+	{
+		ImGui::Text("%-20s %-12s", v.Name.c_str(), mConsoleVariables.GetValueString(v).c_str());
+		if (ImGui::IsItemClicked()) // prefill the command to edit the variable
+		{
+			snprintf(szCommand, sizeof(szCommand), "%s ", v.Name.c_str());
+		}
+		if (ImGui::IsItemHovered() && !v.Description.empty())
+		{
+			ImGui::SetTooltip("%s", v.Description.c_str());
+		}
+	}
 
+	ImGui::End();
+}
@@ -23,6 +23,7 @@ struct FUIState
 	bool bWindowVisible_SceneControls;
 	bool bWindowVisible_DebugPanel;
 	bool bWindowVisible_GraphicsSettingsPanel;
+	bool bWindowVisible_Console;
 	bool bHideAllWindows; // masks all the windows above
 
 	bool bUIOnSeparateWindow;
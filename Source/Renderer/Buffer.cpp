@@ -21,8 +21,10 @@
 
 #include "Libs/D3DX12/d3dx12.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stdlib.h>
+#include <atomic>
 
 
 size_t StaticBufferHeap::MEMORY_ALIGNMENT = 256;
@@ -34,7 +36,7 @@ static D3D12_RESOURCE_STATES GetResourceTransitionState(EBufferType eType)
     switch (eType)
     {
         case CONSTANT_BUFFER : s = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER; break;
-        case VERTEX_BUFFER   : s = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER; break;
+        case VERTEX_BUFFER   : s = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE; break; // + read by the skinning CS
         case INDEX_BUFFER    : s = D3D12_RESOURCE_STATE_INDEX_BUFFER; break;
         default:
             Log::Warning("StaticBufferPool::Create(): unkown resource type, couldn't determine resource transition state for upload.");
@@ -46,170 +48,313 @@ static D3D12_RESOURCE_STATES GetResourceTransitionState(EBufferType eType)
 //
 // STATIC BUFFER HEAP
 //
-void StaticBufferHeap::Create(ID3D12Device* pDevice, EBufferType type, uint32 totalMemSize, bool bUseVidMem, const char* name)
+static std::atomic<uint64> sNextStaticBufferHeapID = 1;
+
+void StaticBufferHeap::Create(ID3D12Device* pDevice, EBufferType type, uint32 pageSize, bool bUseVidMem, const char* name)
 {
     mpDevice = pDevice;
-    mTotalMemSize = totalMemSize;
-    mMemOffset = 0;
-    mMemInit = 0;
-    mpData = nullptr;
+    mPageSize = AlignOffset(pageSize, (uint32)StaticBufferHeap::MEMORY_ALIGNMENT);
     mbUseVidMem = bUseVidMem;
     mType = type;
+    mName = name;
+    mID = sNextStaticBufferHeapID.fetch_add(1);
+
+    // create the first page upfront, the rest are created on demand
+    FSubPool& pool = GetThreadSubPool();
+    std::lock_guard<std::mutex> lock(pool.Mtx);
+    CreatePage(pool, mPageSize, false);
+}
+
+void StaticBufferHeap::Destroy()
+{
+    std::lock_guard<std::mutex> lockSubPools(mMtxSubPools);
+    for (std::unique_ptr<FSubPool>& pPool : mSubPools)
+    {
+        std::lock_guard<std::mutex> lock(pPool->Mtx);
+        for (std::unique_ptr<FPage>& pPage : pPool->Pages)
+            DestroyPage(*pPage);
+    }
+    mSubPools.clear();
+    mID = 0; // invalidates the thread-local sub-pool lookups
+}
+
+StaticBufferHeap::FPage* StaticBufferHeap::CreatePage(FSubPool& pool, uint32 size, bool bDedicated)
+{
+    std::unique_ptr<FPage> pPage = std::make_unique<FPage>();
+    pPage->Size = size;
+    pPage->bDedicated = bDedicated;
+
+    const std::string name = mName + "[" + std::to_string(pool.Index) + "][" + std::to_string(pool.Pages.size()) + "]" + (bDedicated ? "[Dedicated]" : "");
 
     HRESULT hr = {};
-    if (bUseVidMem)
+    if (mbUseVidMem)
     {
         hr = mpDevice->CreateCommittedResource(
             &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(totalMemSize),
+            &CD3DX12_RESOURCE_DESC::Buffer(size),
             GetResourceTransitionState(mType),
             nullptr,
-            IID_PPV_ARGS(&mpVidMemBuffer));
-        SetName(mpVidMemBuffer, name);
-
+            IID_PPV_ARGS(&pPage->pVidMemBuffer));
         if (FAILED(hr))
         {
-            assert(false);
-            // TODO
+            Log::Error("StaticBufferHeap: couldn't create %u byte video memory page for %s", size, mName.c_str());
+            return nullptr;
         }
+        SetName(pPage->pVidMemBuffer, name.c_str());
     }
 
     hr = mpDevice->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
         D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(totalMemSize),
+        &CD3DX12_RESOURCE_DESC::Buffer(size),
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr,
-        IID_PPV_ARGS(&mpSysMemBuffer));
-
+        IID_PPV_ARGS(&pPage->pSysMemBuffer));
     if (FAILED(hr))
     {
-        assert(false);
-        // TODO
+        Log::Error("StaticBufferHeap: couldn't create %u byte upload page for %s", size, mName.c_str());
+        if (pPage->pVidMemBuffer) pPage->pVidMemBuffer->Release();
+        return nullptr;
     }
+    SetName(pPage->pSysMemBuffer, name.c_str());
 
-    SetName(mpSysMemBuffer, name);
+    pPage->pSysMemBuffer->Map(0, NULL, reinterpret_cast<void**>(&pPage->pData));
+    pPage->GPUAddress = (mbUseVidMem ? pPage->pVidMemBuffer : pPage->pSysMemBuffer)->GetGPUVirtualAddress();
+    pPage->Allocator.Initialize(size, (uint32)StaticBufferHeap::MEMORY_ALIGNMENT);
 
-    mpSysMemBuffer->Map(0, NULL, reinterpret_cast<void**>(&mpData));
+    FPage* pResult = pPage.get();
+    pool.Pages.push_back(std::move(pPage));
+    return pResult;
 }
 
-void StaticBufferHeap::Destroy()
+void StaticBufferHeap::DestroyPage(FPage& page)
 {
-    if (mbUseVidMem)
-    {
-        if (mpVidMemBuffer)
-        {
-            mpVidMemBuffer->Release();
-            mpVidMemBuffer = nullptr;
-        }
-    }
-
-    if (mpSysMemBuffer)
-    {
-        mpSysMemBuffer->Release();
-        mpSysMemBuffer = nullptr;
-    }
+    if (page.pVidMemBuffer) page.pVidMemBuffer->Release();
+    if (page.pSysMemBuffer) page.pSysMemBuffer->Release();
+    page.pVidMemBuffer = nullptr;
+    page.pSysMemBuffer = nullptr;
+    page.pData = nullptr;
 }
 
-
-bool StaticBufferHeap::AllocBuffer(uint32 numElements, uint32 strideInBytes, const void* pInitData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocation, uint32* pSizeOut)
+StaticBufferHeap::FSubPool& StaticBufferHeap::GetThreadSubPool()
 {
-    void* pData;
-    if (AllocBuffer(numElements, strideInBytes, &pData, pBufferLocation, pSizeOut))
+    // <heap ID, sub-pool> : entries of destroyed heaps never match again as heap IDs aren't reused
+    thread_local std::vector<std::pair<uint64, FSubPool*>> tlsSubPools;
+    for (const std::pair<uint64, FSubPool*>& entry : tlsSubPools)
     {
-        memcpy(pData, pInitData, static_cast<size_t>(numElements) * strideInBytes);
-        return true;
+        if (entry.first == mID)
+            return *entry.second;
     }
-    return false;
+
+    std::lock_guard<std::mutex> lock(mMtxSubPools);
+    mSubPools.push_back(std::make_unique<FSubPool>());
+    FSubPool* pPool = mSubPools.back().get();
+    pPool->Index = static_cast<uint32>(mSubPools.size() - 1);
+    tlsSubPools.push_back({ mID, pPool });
+    return *pPool;
 }
-bool StaticBufferHeap::AllocVertexBuffer(uint32 numVertices, uint32 strideInBytes, const void* pInitData, D3D12_VERTEX_BUFFER_VIEW* pViewOut)
-{
-    assert(mType == EBufferType::VERTEX_BUFFER);
-    void* pData = nullptr;
-    if (AllocVertexBuffer(numVertices, strideInBytes, &pData, pViewOut))
-    {
-        memcpy(pData, pInitData, static_cast<size_t>(numVertices) * strideInBytes);
-        return true;
-    }
 
-    return false;
+std::vector<StaticBufferHeap::FSubPool*> StaticBufferHeap::GetSubPools() const
+{
+    std::lock_guard<std::mutex> lock(mMtxSubPools);
+    std::vector<FSubPool*> pools(mSubPools.size());
+    std::transform(mSubPools.begin(), mSubPools.end(), pools.begin(), [](const std::unique_ptr<FSubPool>& p) { return p.get(); });
+    return pools;
 }
-bool StaticBufferHeap::AllocIndexBuffer(uint32 numIndices, uint32 strideInBytes, const void* pInitData, D3D12_INDEX_BUFFER_VIEW* pOut)
+
+
+bool StaticBufferHeap::AllocFromPages(FSubPool& pool, uint32 size, uint32 dataSize, const void* pInitData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocationOut)
 {
-    assert(mType == EBufferType::INDEX_BUFFER);
-    void* pData = nullptr;
-    if (AllocIndexBuffer(numIndices, strideInBytes, &pData, pOut))
+    for (std::unique_ptr<FPage>& pPage : pool.Pages)
     {
-        memcpy(pData, pInitData, static_cast<size_t>(strideInBytes) * numIndices);
+        if (pPage->bDedicated)
+            continue;
+
+        const uint32 offset = pPage->Allocator.Allocate(size);
+        if (offset == TLSFAllocator::INVALID_OFFSET)
+            continue;
+
+        memcpy(pPage->pData + offset, pInitData, dataSize);
+        pPage->PendingUploads.push_back({ offset, size });
+        *pBufferLocationOut = pPage->GPUAddress + offset;
         return true;
     }
     return false;
 }
 
-
-bool StaticBufferHeap::AllocBuffer(uint32 numElements, uint32 strideInBytes, void** ppDataOut, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocationOut, uint32* pSizeOut)
+bool StaticBufferHeap::AllocBuffer(uint32 numElements, uint32 strideInBytes, const void* pInitData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocationOut, uint32* pSizeOut)
 {
-    std::lock_guard<std::mutex> lock(mMtx);
+    const uint32 dataSize = numElements * strideInBytes;
+    const uint32 size = AlignOffset(dataSize, (uint32)StaticBufferHeap::MEMORY_ALIGNMENT);
+    const bool bDedicated = size > mPageSize;
+    *pSizeOut = size;
 
-    uint32 size = AlignOffset(numElements * strideInBytes, (uint32)StaticBufferHeap::MEMORY_ALIGNMENT);
-    const bool bHeapOutOfMemory = ((mMemOffset + size) > mTotalMemSize);
-    //assert( !bHeapOutOfMemory); // if this is hit, initialize heap with a larger size.
-    if (bHeapOutOfMemory)
+    FSubPool& pool = GetThreadSubPool();
+    if (!bDedicated)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pool.Mtx);
+            if (AllocFromPages(pool, size, dataSize, pInitData, pBufferLocationOut))
+                return true;
+        }
+
+        // before growing, use the free space in the other threads' pages if their locks are available
+        for (FSubPool* pOtherPool : GetSubPools())
+        {
+            if (pOtherPool == &pool)
+                continue;
+            std::unique_lock<std::mutex> lock(pOtherPool->Mtx, std::try_to_lock);
+            if (lock.owns_lock() && AllocFromPages(*pOtherPool, size, dataSize, pInitData, pBufferLocationOut))
+                return true;
+        }
+    }
+
+    // grow: allocations larger than the page size get a dedicated page
+    std::lock_guard<std::mutex> lock(pool.Mtx);
+    FPage* pPage = CreatePage(pool, bDedicated ? size : mPageSize, bDedicated);
+    if (!pPage)
     {
-        Log::Error("Static Heap out of memory.");
         MessageBox(NULL, "Out of StaticBufferHeap memory", "Error", MB_ICONERROR | MB_OK);
         PostMessage(NULL, WM_QUIT, NULL, NULL);
         return false;
     }
+    const uint32 offset = pPage->Allocator.Allocate(size);
+    assert(offset != TLSFAllocator::INVALID_OFFSET);
 
-    *ppDataOut = (void*)(mpData + mMemOffset);
-
-    ID3D12Resource*& pRsc = mbUseVidMem ? mpVidMemBuffer : mpSysMemBuffer;
-
-    *pBufferLocationOut = mMemOffset + pRsc->GetGPUVirtualAddress();
-    *pSizeOut = size;
-
-    mMemOffset += size;
-
+    memcpy(pPage->pData + offset, pInitData, dataSize);
+    pPage->PendingUploads.push_back({ offset, size });
+    *pBufferLocationOut = pPage->GPUAddress + offset;
     return true;
 }
-bool StaticBufferHeap::AllocVertexBuffer(uint32 numVertices, uint32 strideInBytes, void** ppDataOut, D3D12_VERTEX_BUFFER_VIEW* pViewOut)
+bool StaticBufferHeap::AllocVertexBuffer(uint32 numVertices, uint32 strideInBytes, const void* pInitData, D3D12_VERTEX_BUFFER_VIEW* pViewOut)
 {
-    bool bSuccess = AllocBuffer(numVertices, strideInBytes, ppDataOut, &pViewOut->BufferLocation, &pViewOut->SizeInBytes);
+    assert(mType == EBufferType::VERTEX_BUFFER);
+    bool bSuccess = AllocBuffer(numVertices, strideInBytes, pInitData, &pViewOut->BufferLocation, &pViewOut->SizeInBytes);
     pViewOut->StrideInBytes = bSuccess ? strideInBytes : 0;
     return bSuccess;
 }
-bool StaticBufferHeap::AllocIndexBuffer(uint32 numIndices, uint32 strideInBytes, void** ppDataOut, D3D12_INDEX_BUFFER_VIEW* pViewOut)
+bool StaticBufferHeap::AllocIndexBuffer(uint32 numIndices, uint32 strideInBytes, const void* pInitData, D3D12_INDEX_BUFFER_VIEW* pViewOut)
 {
-    bool bSuccess = AllocBuffer(numIndices, strideInBytes, ppDataOut, &pViewOut->BufferLocation, &pViewOut->SizeInBytes);
+    assert(mType == EBufferType::INDEX_BUFFER);
+    bool bSuccess = AllocBuffer(numIndices, strideInBytes, pInitData, &pViewOut->BufferLocation, &pViewOut->SizeInBytes);
     pViewOut->Format = bSuccess 
         ? ((strideInBytes == 4) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT)
         : DXGI_FORMAT_UNKNOWN;
     return bSuccess;
 }
 
+void StaticBufferHeap::FreeBuffer(D3D12_GPU_VIRTUAL_ADDRESS BufferLocation, uint64 FenceValue)
+{
+    // the buffer can be in any sub-pool as it could've been allocated from another thread
+    for (FSubPool* pPool : GetSubPools())
+    {
+        std::lock_guard<std::mutex> lock(pPool->Mtx);
+        for (std::unique_ptr<FPage>& pPage : pPool->Pages)
+        {
+            if (BufferLocation >= pPage->GPUAddress && BufferLocation < pPage->GPUAddress + pPage->Size)
+            {
+                pPool->DeferredFrees.push_back({ pPage.get(), static_cast<uint32>(BufferLocation - pPage->GPUAddress), FenceValue });
+                return;
+            }
+        }
+    }
+    Log::Warning("StaticBufferHeap::FreeBuffer(): %s doesn't contain the buffer location", mName.c_str());
+}
 
-void StaticBufferHeap::UploadData(ID3D12GraphicsCommandList* pCmd)
+void StaticBufferHeap::ReleaseDeferredFrees(uint64 CompletedFenceValue)
 {
-    if (mbUseVidMem)
+    for (FSubPool* pPool : GetSubPools())
     {
-        D3D12_RESOURCE_STATES state = GetResourceTransitionState(mType);
+        std::lock_guard<std::mutex> lock(pPool->Mtx);
+        auto itEnd = std::remove_if(pPool->DeferredFrees.begin(), pPool->DeferredFrees.end(), [&](const FDeferredFree& f)
+        {
+            if (f.FenceValue > CompletedFenceValue)
+                return false;
+            f.pPage->Allocator.Free(f.Offset);
+            return true;
+        });
+        pPool->DeferredFrees.erase(itEnd, pPool->DeferredFrees.end());
+
+        // dedicated pages hold a single buffer: release the memory once the GPU is done with it
+        auto itPagesEnd = std::remove_if(pPool->Pages.begin(), pPool->Pages.end(), [](std::unique_ptr<FPage>& pPage)
+        {
+            if (!pPage->bDedicated || !pPage->Allocator.IsEmpty())
+                return false;
+            DestroyPage(*pPage);
+            return true;
+        });
+        pPool->Pages.erase(itPagesEnd, pPool->Pages.end());
+    }
+}
 
-        pCmd->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mpVidMemBuffer
-            , state
-            , D3D12_RESOURCE_STATE_COPY_DEST)
-        );
 
-        pCmd->CopyBufferRegion(mpVidMemBuffer, mMemInit, mpSysMemBuffer, mMemInit, mMemOffset - mMemInit);
+void StaticBufferHeap::UploadData(ID3D12GraphicsCommandList* pCmd)
+{
+    const D3D12_RESOURCE_STATES state = GetResourceTransitionState(mType);
 
-        pCmd->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mpVidMemBuffer
-            , D3D12_RESOURCE_STATE_COPY_DEST
-            , state)
-        );
+    for (FSubPool* pPool : GetSubPools())
+    {
+        std::lock_guard<std::mutex> lock(pPool->Mtx);
+        for (std::unique_ptr<FPage>& pPage : pPool->Pages)
+        {
+            std::vector<std::pair<uint32, uint32>>& uploads = pPage->PendingUploads;
+            if (uploads.empty())
+                continue;
+
+            if (mbUseVidMem)
+            {
+                // merge the contiguous ranges to issue fewer copies
+                std::sort(uploads.begin(), uploads.end());
+
+                pCmd->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pPage->pVidMemBuffer
+                    , state
+                    , D3D12_RESOURCE_STATE_COPY_DEST)
+                );
+
+                for (size_t i = 0; i < uploads.size();)
+                {
+                    const uint32 offset = uploads[i].first;
+                    uint32 end = offset + uploads[i].second;
+                    for (++i; i < uploads.size() && uploads[i].first == end; ++i)
+                        end += uploads[i].second;
+                    pCmd->CopyBufferRegion(pPage->pVidMemBuffer, offset, pPage->pSysMemBuffer, offset, end - offset);
+                }
+
+                pCmd->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pPage->pVidMemBuffer
+                    , D3D12_RESOURCE_STATE_COPY_DEST
+                    , state)
+                );
+            }
+
+            uploads.clear();
+        }
+    }
+}
 
-        mMemInit = mMemOffset;
+StaticBufferHeap::FStatistics StaticBufferHeap::GetStatistics() const
+{
+    FStatistics s;
+    uint64 freeMemSize = 0;
+    const std::vector<FSubPool*> pools = GetSubPools();
+    s.NumSubPools = static_cast<uint32>(pools.size());
+    for (const FSubPool* pPool : pools)
+    {
+        std::lock_guard<std::mutex> lock(pPool->Mtx);
+        for (const std::unique_ptr<FPage>& pPage : pPool->Pages)
+        {
+            const TLSFAllocator::FStatistics ps = pPage->Allocator.GetStatistics();
+            ++s.NumPages;
+            s.NumDedicatedPages += pPage->bDedicated ? 1 : 0;
+            s.TotalMemSize      += ps.TotalSize;
+            s.UsedMemSize       += ps.UsedSize;
+            s.NumAllocations    += ps.NumAllocations;
+            s.LargestFreeBlock   = std::max(s.LargestFreeBlock, ps.LargestFreeBlock);
+            freeMemSize         += ps.FreeSize;
+        }
     }
+    s.Fragmentation = freeMemSize > 0 ? 1.0f - static_cast<float>(s.LargestFreeBlock) / freeMemSize : 0.0f;
+    return s;
 }
 
 
@@ -263,6 +408,24 @@ bool DynamicBufferHeap::AllocConstantBuffer(uint32_t size, void** pData, D3D12_G
     return true;
 }
 
+bool DynamicBufferHeap::AllocStructuredBuffer(uint32_t NumElements, uint32_t strideInBytes, void** ppData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocation)
+{
+    // root SRVs can't be null, keep at least 1 element around for empty buffers
+    uint32_t size = AlignOffset(std::max(NumElements, 1u) * strideInBytes, 256u);
+
+    uint32_t memOffset;
+    if (m_mem.Alloc(size, &memOffset) == false)
+    {
+        Log::Error("Ran out of mem for 'dynamic' buffers, increase the allocated size\n");
+        return false;
+    }
+
+    *ppData = (void*)(m_pData + memOffset);
+    *pBufferLocation = m_pBuffer->GetGPUVirtualAddress() + memOffset;
+
+    return true;
+}
+
 bool DynamicBufferHeap::AllocVertexBuffer(uint32_t NumVertices, uint32_t strideInBytes, void** ppData, D3D12_VERTEX_BUFFER_VIEW* pView)
 {
     uint32_t size = AlignOffset(NumVertices * strideInBytes, 256u);
@@ -47,9 +47,12 @@
 //-----------------------------------------------------------------------------------------------------------
 
 #include "ResourceHeaps.h"
+#include "TLSFAllocator.h"
 #include "Common.h"
 
+#include <memory>
 #include <mutex>
+#include <vector>
 
 struct ID3D12Device;
 struct ID3D12Resource;
@@ -125,12 +128,30 @@ struct FVertexWithNormalAndTangent
 //
 // STATIC BUFFER HEAP
 //
+// Paged static geometry heap: pages are created on demand and sub-allocated with a TLSF allocator,
+// so the ranges of the destroyed buffers can be reused. Each thread allocates from its own sub-pool,
+// created on the thread's first allocation, so loader threads don't contend on a single mutex.
+// Allocations larger than the page size get a dedicated page, released once its buffer is freed.
+//
 class StaticBufferHeap
 {
     static size_t MEMORY_ALIGNMENT; // TODO: potentially move to renderer settings ini or make a member
 
 public:
-    void Create(ID3D12Device* pDevice, EBufferType type, uint32 totalMemSize, bool bUseVidMem, const char* name);
+    struct FStatistics
+    {
+        uint32 NumPages          = 0;
+        uint32 NumDedicatedPages = 0;
+        uint32 NumSubPools       = 0;
+        uint64 TotalMemSize      = 0;
+        uint64 UsedMemSize       = 0;
+        uint32 NumAllocations    = 0;
+        uint32 LargestFreeBlock  = 0;
+        float  Fragmentation     = 0.0f; // [0, 1] : 1 - largest free block / total free, over all pages
+    };
+
+public:
+    void Create(ID3D12Device* pDevice, EBufferType type, uint32 pageSize, bool bUseVidMem, const char* name);
     void Destroy();
 
     bool AllocBuffer      (uint32 numElements, uint32 strideInBytes, const void* pInitData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocationOut, uint32* pSizeOut);
@@ -138,28 +159,58 @@ public:
     bool AllocIndexBuffer (uint32 numIndices , uint32 strideInBytes, const void* pInitData, D3D12_INDEX_BUFFER_VIEW* pOut);
     //bool AllocConstantBuffer(uint32 size, void* pData, D3D12_CONSTANT_BUFFER_VIEW_DESC* pViewDesc);
 
+    // The range is returned to its page once ReleaseDeferredFrees() is called with CompletedFenceValue >= FenceValue
+    void FreeBuffer(D3D12_GPU_VIRTUAL_ADDRESS BufferLocation, uint64 FenceValue);
+    void ReleaseDeferredFrees(uint64 CompletedFenceValue);
+
     void UploadData(ID3D12GraphicsCommandList* pCmdList);
     //void FreeUploadHeap();
 
+    FStatistics GetStatistics() const;
+
 private:
-    bool AllocBuffer      (uint32 numElements, uint32 strideInBytes, void** ppDataOut, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocationOut, uint32* pSizeOut);
-    bool AllocVertexBuffer(uint32 numVertices, uint32 strideInBytes, void** ppDataOut, D3D12_VERTEX_BUFFER_VIEW* pViewOut);
-    bool AllocIndexBuffer (uint32 numIndices , uint32 strideInBytes, void** ppDataOut, D3D12_INDEX_BUFFER_VIEW* pIndexView);
-    //bool AllocConstantBuffer(uint32 size, void** pData, D3D12_CONSTANT_BUFFER_VIEW_DESC* pViewDesc);
+    struct FPage
+    {
+        TLSFAllocator             Allocator;
+        ID3D12Resource*           pSysMemBuffer = nullptr;
+        ID3D12Resource*           pVidMemBuffer = nullptr;
+        char*                     pData         = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS GPUAddress    = 0;
+        uint32                    Size          = 0;
+        bool                      bDedicated    = false;
+        std::vector<std::pair<uint32, uint32>> PendingUploads; // <offset, size>
+    };
+    struct FDeferredFree
+    {
+        FPage* pPage;
+        uint32 Offset;
+        uint64 FenceValue;
+    };
+    struct FSubPool
+    {
+        mutable std::mutex                  Mtx;
+        uint32                              Index = 0;
+        std::vector<std::unique_ptr<FPage>> Pages;
+        std::vector<FDeferredFree>          DeferredFrees;
+    };
+
+    FPage* CreatePage(FSubPool& pool, uint32 size, bool bDedicated); // pool must be locked
+    static void DestroyPage(FPage& page);
+    bool AllocFromPages(FSubPool& pool, uint32 size, uint32 dataSize, const void* pInitData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocationOut); // pool must be locked
+    FSubPool& GetThreadSubPool();
+    std::vector<FSubPool*> GetSubPools() const; // sub-pools live until Destroy()
 
 private:
     ID3D12Device*  mpDevice = nullptr;
     EBufferType    mType    = EBufferType::NUM_BUFFER_TYPES;
-    std::mutex     mMtx;
+    std::string    mName;
+    uint64         mID      = 0; // identifies the heap in the thread-local sub-pool lookup
 
-    bool           mbUseVidMem     = true;
-    char*          mpData          = nullptr;
-    uint32         mMemInit        = 0;
-    uint32         mMemOffset      = 0;
-    uint32         mTotalMemSize   = 0;
+    bool           mbUseVidMem = true;
+    uint32         mPageSize   = 0;
 
-    ID3D12Resource* mpSysMemBuffer = nullptr;
-    ID3D12Resource* mpVidMemBuffer = nullptr;
+    mutable std::mutex                     mMtxSubPools;
+    std::vector<std::unique_ptr<FSubPool>> mSubPools;
 };
 
 
@@ -231,6 +282,7 @@ public:
     bool AllocIndexBuffer   (uint32_t numbeOfIndices , uint32_t strideInBytes, void** pData, D3D12_INDEX_BUFFER_VIEW* pView);
     bool AllocVertexBuffer  (uint32_t numbeOfVertices, uint32_t strideInBytes, void** pData, D3D12_VERTEX_BUFFER_VIEW* pView);
     bool AllocConstantBuffer(uint32_t size, void** pData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferViewDesc);
+    bool AllocStructuredBuffer(uint32_t numElements, uint32_t strideInBytes, void** ppData, D3D12_GPU_VIRTUAL_ADDRESS* pBufferLocation); // for root SRVs
     void OnBeginFrame();
 
 private:
@@ -0,0 +1,196 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+void DescriptorAllocator::Initialize(uint32 NumDescriptors)
+{
+	mNumDescriptors = NumDescriptors;
+	Reset();
+}
+
+void DescriptorAllocator::Reset()
+{
+	mFreeRanges.clear();
+	for (std::set<uint32>& FreeList : mFreeLists)
+		FreeList.clear();
+	mDeferredFrees.clear();
+
+	mNumAllocatedDescriptors = 0;
+	mNumAllocations = 0;
+
+	if (mNumDescriptors > 0)
+		InsertFreeRange(0, mNumDescriptors);
+}
+
+uint32 DescriptorAllocator::Allocate(uint32 NumDescriptors)
+{
+	if (NumDescriptors == 0)
+		return INVALID_OFFSET;
+
+	const uint32 SizeClass = GetSizeClass(NumDescriptors);
+
+	uint32 Offset = INVALID_OFFSET;
+	uint32 RangeSize = 0;
+
+	// ranges in the requested size class are in [2^SizeClass, 2^(SizeClass+1)) so they may not fit: first-fit search
+	for (uint32 RangeOffset : mFreeLists[SizeClass])
+	{
+		const uint32 Size = mFreeRanges.at(RangeOffset);
+		if (Size >= NumDescriptors)
+		{
+			Offset = RangeOffset;
+			RangeSize = Size;
+			break;
+		}
+	}
+
+	// any range in a larger size class fits, take the lowest offset one
+	for (uint32 iClass = SizeClass + 1; Offset == INVALID_OFFSET && iClass < NUM_SIZE_CLASSES; ++iClass)
+	{
+		if (mFreeLists[iClass].empty())
+			continue;
+		Offset = *mFreeLists[iClass].begin();
+		RangeSize = mFreeRanges.at(Offset);
+	}
+
+	if (Offset == INVALID_OFFSET)
+		return INVALID_OFFSET;
+
+	// split the range, return the tail to the free lists
+	RemoveFreeRange(Offset, RangeSize);
+	if (RangeSize > NumDescriptors)
+		InsertFreeRange(Offset + NumDescriptors, RangeSize - NumDescriptors);
+
+	mNumAllocatedDescriptors += NumDescriptors;
+	++mNumAllocations;
+	return Offset;
+}
+
+void DescriptorAllocator::Free(uint32 Offset, uint32 NumDescriptors)
+{
+	if (Offset == INVALID_OFFSET || NumDescriptors == 0)
+		return;
+	assert(Offset + NumDescriptors <= mNumDescriptors);
+	assert(mNumAllocatedDescriptors >= NumDescriptors);
+
+	uint32 MergedOffset = Offset;
+	uint32 MergedSize = NumDescriptors;
+
+	// coalesce with the free range that ends at Offset
+	auto itNext = mFreeRanges.lower_bound(Offset);
+	if (itNext != mFreeRanges.begin())
+	{
+		auto itPrev = std::prev(itNext);
+		assert(itPrev->first + itPrev->second <= Offset); // if you hit this, the range is already free (double free)
+		if (itPrev->first + itPrev->second == Offset)
+		{
+			MergedOffset = itPrev->first;
+			MergedSize += itPrev->second;
+			RemoveFreeRange(itPrev->first, itPrev->second);
+		}
+	}
+
+	// coalesce with the free range that starts at Offset + NumDescriptors
+	itNext = mFreeRanges.lower_bound(Offset);
+	if (itNext != mFreeRanges.end())
+	{
+		assert(itNext->first >= Offset + NumDescriptors); // if you hit this, the range is already free (double free)
+		if (itNext->first == Offset + NumDescriptors)
+		{
+			MergedSize += itNext->second;
+			RemoveFreeRange(itNext->first, itNext->second);
+		}
+	}
+
+	InsertFreeRange(MergedOffset, MergedSize);
+
+	mNumAllocatedDescriptors -= NumDescriptors;
+	--mNumAllocations;
+}
+
+void DescriptorAllocator::FreeDeferred(uint32 Offset, uint32 NumDescriptors, uint64 FenceValue)
+{
+	if (Offset == INVALID_OFFSET || NumDescriptors == 0)
+		return;
+	mDeferredFrees.push_back({ Offset, NumDescriptors, FenceValue });
+}
+
+uint32 DescriptorAllocator::ReleaseCompletedFrees(uint64 CompletedFenceValue)
+{
+	uint32 NumReleasedDescriptors = 0;
+
+	// frees are released in the order they were queued so the resulting layout is deterministic
+	auto itEnd = std::remove_if(mDeferredFrees.begin(), mDeferredFrees.end(), [&](const FDeferredFree& f)
+	{
+		if (f.FenceValue > CompletedFenceValue)
+			return false;
+		this->Free(f.Offset, f.NumDescriptors);
+		NumReleasedDescriptors += f.NumDescriptors;
+		return true;
+	});
+	mDeferredFrees.erase(itEnd, mDeferredFrees.end());
+
+	return NumReleasedDescriptors;
+}
+
+DescriptorAllocator::FStatistics DescriptorAllocator::GetStatistics() const
+{
+	FStatistics s;
+	s.NumDescriptors          = mNumDescriptors;
+	s.NumAllocatedDescriptors = mNumAllocatedDescriptors;
+	s.NumAllocations          = mNumAllocations;
+	s.NumFreeRanges           = static_cast<uint32>(mFreeRanges.size());
+
+	for (const FDeferredFree& f : mDeferredFrees)
+		s.NumPendingFreeDescriptors += f.NumDescriptors;
+
+	for (const std::pair<const uint32, uint32>& Range : mFreeRanges)
+	{
+		s.NumFreeDescriptors += Range.second;
+		s.LargestFreeRange = std::max(s.LargestFreeRange, Range.second);
+	}
+
+	s.Occupancy     = mNumDescriptors     > 0 ? static_cast<float>(mNumAllocatedDescriptors) / mNumDescriptors : 0.0f;
+	s.Fragmentation = s.NumFreeDescriptors > 0 ? 1.0f - static_cast<float>(s.LargestFreeRange) / s.NumFreeDescriptors : 0.0f;
+	return s;
+}
+
+uint32 DescriptorAllocator::GetSizeClass(uint32 NumDescriptors)
+{
+	assert(NumDescriptors > 0);
+	uint32 SizeClass = 0;
+	while (NumDescriptors >>= 1)
+		++SizeClass;
+	return SizeClass;
+}
+
+void DescriptorAllocator::InsertFreeRange(uint32 Offset, uint32 NumDescriptors)
+{
+	mFreeRanges[Offset] = NumDescriptors;
+	mFreeLists[GetSizeClass(NumDescriptors)].insert(Offset);
+}
+
+void DescriptorAllocator::RemoveFreeRange(uint32 Offset, uint32 NumDescriptors)
+{
+	mFreeRanges.erase(Offset);
+	mFreeLists[GetSizeClass(NumDescriptors)].erase(Offset);
+}
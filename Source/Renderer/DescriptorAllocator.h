@@ -0,0 +1,95 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <array>
+#include <map>
+#include <set>
+#include <vector>
+
+//
+// DESCRIPTOR ALLOCATOR
+//
+// Range allocator for descriptor heap slots. Only deals with offsets & counts so it
+// doesn't depend on any D3D12 type and can be exercised without a device.
+//
+// - Free ranges are kept in segregated free lists by size class (floor(log2(size))),
+//   allocation picks the lowest-offset range from the smallest class that fits.
+// - Freed ranges are coalesced with their contiguous free neighbors.
+// - Frees can be deferred with a fence value: the range stays allocated until
+//   ReleaseCompletedFrees() is called with a completed value >= the fence value.
+//
+class DescriptorAllocator
+{
+public:
+	static constexpr uint32 INVALID_OFFSET = 0xFFFFFFFF;
+
+	struct FStatistics
+	{
+		uint32 NumDescriptors            = 0;
+		uint32 NumAllocatedDescriptors   = 0; // includes the pending frees
+		uint32 NumPendingFreeDescriptors = 0;
+		uint32 NumFreeDescriptors        = 0;
+		uint32 NumAllocations            = 0;
+		uint32 NumFreeRanges             = 0;
+		uint32 LargestFreeRange          = 0;
+		float  Occupancy                 = 0.0f; // [0, 1] : allocated / total
+		float  Fragmentation             = 0.0f; // [0, 1] : 1 - largest free range / total free
+	};
+
+public:
+	void   Initialize(uint32 NumDescriptors);
+	void   Reset();
+
+	// Returns the offset of the first descriptor in the range, or INVALID_OFFSET if the request can't be satisfied.
+	uint32 Allocate(uint32 NumDescriptors);
+	void   Free(uint32 Offset, uint32 NumDescriptors);
+	void   FreeDeferred(uint32 Offset, uint32 NumDescriptors, uint64 FenceValue);
+
+	// Returns the free ranges whose fence value <= CompletedFenceValue to the free lists.
+	// Returns the number of descriptors released.
+	uint32 ReleaseCompletedFrees(uint64 CompletedFenceValue);
+
+	FStatistics GetStatistics() const;
+	inline uint32 GetNumDescriptors() const { return mNumDescriptors; }
+
+private:
+	static constexpr uint32 NUM_SIZE_CLASSES = 32;
+	static uint32 GetSizeClass(uint32 NumDescriptors);
+
+	void InsertFreeRange(uint32 Offset, uint32 NumDescriptors);
+	void RemoveFreeRange(uint32 Offset, uint32 NumDescriptors);
+
+private:
+	struct FDeferredFree
+	{
+		uint32 Offset;
+		uint32 NumDescriptors;
+		uint64 FenceValue;
+	};
+
+	uint32 mNumDescriptors          = 0;
+	uint32 mNumAllocatedDescriptors = 0;
+	uint32 mNumAllocations          = 0;
+
+	std::map<uint32, uint32>                         mFreeRanges; // offset -> NumDescriptors, used for coalescing
+	std::array<std::set<uint32>, NUM_SIZE_CLASSES>   mFreeLists;  // offsets, segregated by size class
+	std::vector<FDeferredFree>                       mDeferredFrees;
+};
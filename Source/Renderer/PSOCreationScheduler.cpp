@@ -0,0 +1,124 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "PSOCreationScheduler.h"
+
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <cassert>
+
+//
+// PSO CREATION SCHEDULER
+//
+PSOCreationScheduler::PSOCreationScheduler(ThreadPool& ShaderWorkers, ThreadPool& PSOWorkers, CompileShaderStageFn_t fnCompileShaderStage, CreatePSOFn_t fnCreatePSO)
+	: mShaderWorkers(ShaderWorkers)
+	, mPSOWorkers(PSOWorkers)
+	, mfnCompileShaderStage(std::move(fnCompileShaderStage))
+	, mfnCreatePSO(std::move(fnCreatePSO))
+{}
+
+void PSOCreationScheduler::Enqueue(PSO_ID ID, PSO_ID* pID, FPSODesc&& Desc)
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	mTaskQueue.push_back({ ID, pID, std::move(Desc) });
+}
+
+void PSOCreationScheduler::Start()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+
+	// kickoff shader compiler workers first so the PSO workers don't wait on shaders that aren't started yet.
+	// a shader stage shared by multiple PSOs is compiled only once.
+	std::vector<std::vector<std::shared_future<FShaderStageCompileResult>>> PSOShaderStages(mTaskQueue.size());
+	for (size_t iTask = 0; iTask < mTaskQueue.size(); ++iTask)
+	{
+		for (const FShaderStageCompileDesc& ShaderStageDesc : mTaskQueue[iTask].Desc.ShaderStageCompileDescs)
+		{
+			if (ShaderStageDesc.FilePath.empty())
+				continue;
+
+			const std::string key = ShaderUtils::GetShaderStageKey(ShaderStageDesc);
+			auto it = mLookup_ShaderStageCompileResults.find(key);
+			if (it == mLookup_ShaderStageCompileResults.end())
+			{
+				std::shared_future<FShaderStageCompileResult> ShaderCompileResult = mShaderWorkers.AddTask([this, ShaderStageDesc]()
+				{
+					return mfnCompileShaderStage(ShaderStageDesc);
+				});
+				it = mLookup_ShaderStageCompileResults.emplace(key, std::move(ShaderCompileResult)).first;
+				++mStats.NumShaderStageCompiles;
+			}
+			PSOShaderStages[iTask].push_back(it->second);
+			++mStats.NumShaderStages;
+		}
+	}
+
+	// kickoff PSO workers, each waits for its shader stages
+	for (size_t iTask = 0; iTask < mTaskQueue.size(); ++iTask)
+	{
+		mTasks.push_back(std::move(mTaskQueue[iTask]));
+		const FPSODesc* pDesc = &mTasks.back().Desc;
+		std::vector<std::shared_future<FShaderStageCompileResult>> ShaderStageResults = std::move(PSOShaderStages[iTask]);
+
+		std::shared_future<ID3D12PipelineState*> PSOResult = mPSOWorkers.AddTask([this, pDesc, ShaderStageResults]() -> ID3D12PipelineState*
+		{
+			std::vector<FShaderStageCompileResult> ShaderStages;
+			for (const std::shared_future<FShaderStageCompileResult>& TaskResult : ShaderStageResults)
+			{
+				assert(TaskResult.valid());
+				ShaderStages.push_back(TaskResult.get()); // SYNC POINT - wait for shaders to load / compile
+				if (ShaderStages.back().ShaderBlob.IsNull())
+				{
+					Log::Error("PSO Compile failed: %s", pDesc->PSOName.c_str());
+					return nullptr;
+				}
+			}
+			return mfnCreatePSO(*pDesc, ShaderStages);
+		});
+		mResults.push_back(std::move(PSOResult));
+		++mStats.NumPSOs;
+	}
+	mTaskQueue.clear();
+}
+
+std::vector<PSOCreationScheduler::FResult> PSOCreationScheduler::Wait()
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	assert(mTaskQueue.empty()); // if you hit this, there are enqueued tasks that weren't started
+
+	std::vector<FResult> Results;
+	Results.reserve(mResults.size());
+
+	auto itTask = mTasks.begin();
+	for (std::shared_future<ID3D12PipelineState*>& PSOResult : mResults)
+	{
+		const FTask& task = *itTask++;
+		Results.push_back({ task.ID, task.pID, PSOResult.get() });
+	}
+
+	mTasks.clear();
+	mResults.clear();
+	mLookup_ShaderStageCompileResults.clear();
+	return Results;
+}
+
+PSOCreationScheduler::FStatistics PSOCreationScheduler::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lk(mMtx);
+	return mStats;
+}
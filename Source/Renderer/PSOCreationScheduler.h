@@ -0,0 +1,94 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include "Shader.h"
+
+#include "../Engine/Core/Types.h"
+#include "../../Libs/VQUtils/Source/Multithreading.h"
+
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+
+struct FPSODesc
+{
+	std::string PSOName;
+	D3D12_COMPUTE_PIPELINE_STATE_DESC  D3D12ComputeDesc;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC D3D12GraphicsDesc;
+	std::vector<FShaderStageCompileDesc> ShaderStageCompileDescs;
+};
+
+struct FPSOCreationTaskParameters
+{
+	PSO_ID* pID = nullptr; // ID to be set by the task once the PSO loads
+	FPSODesc Desc = {};
+};
+
+//
+// PSO CREATION SCHEDULER
+//
+// Creates PSOs in batches: each unique shader stage across the started tasks (see ShaderUtils::GetShaderStageKey())
+// is compiled once on the shader workers, and each PSO is created on the PSO workers once its stages are compiled.
+// Compiling a stage and creating a PSO are callbacks so that the scheduling can run without a device.
+//
+class PSOCreationScheduler
+{
+public:
+	using CompileShaderStageFn_t = std::function<FShaderStageCompileResult(const FShaderStageCompileDesc&)>;
+	using CreatePSOFn_t          = std::function<ID3D12PipelineState*(const FPSODesc&, const std::vector<FShaderStageCompileResult>&)>;
+
+	struct FResult
+	{
+		PSO_ID               ID;
+		PSO_ID*              pID;
+		ID3D12PipelineState* pPSO; // nullptr if a shader stage or the PSO failed to compile
+	};
+	struct FStatistics
+	{
+		uint32 NumPSOs = 0;
+		uint32 NumShaderStages = 0;         // shader stages referenced by the PSOs
+		uint32 NumShaderStageCompiles = 0;  // unique shader stages compiled
+	};
+
+	PSOCreationScheduler(ThreadPool& ShaderWorkers, ThreadPool& PSOWorkers, CompileShaderStageFn_t fnCompileShaderStage, CreatePSOFn_t fnCreatePSO);
+
+	// Thread safe. Started tasks accumulate until Wait() so that the stages shared between batches are compiled once.
+	void Enqueue(PSO_ID ID, PSO_ID* pID, FPSODesc&& Desc);
+	void Start();
+	std::vector<FResult> Wait(); // blocks until the started tasks complete, results are in the order of Enqueue()
+
+	FStatistics GetStatistics() const; // accumulated over all the started tasks
+
+private:
+	struct FTask { PSO_ID ID; PSO_ID* pID; FPSODesc Desc; };
+
+	ThreadPool&                                                mShaderWorkers;
+	ThreadPool&                                                mPSOWorkers;
+	CompileShaderStageFn_t                                     mfnCompileShaderStage;
+	CreatePSOFn_t                                              mfnCreatePSO;
+
+	mutable std::mutex                                         mMtx;
+	std::vector<FTask>                                         mTaskQueue;    // enqueued, not started
+	std::list<FTask>                                           mTasks;        // started, list for stable Desc addresses
+	std::vector<std::shared_future<ID3D12PipelineState*>>      mResults;      // 1:1 with mTasks
+	std::unordered_map<std::string, std::shared_future<FShaderStageCompileResult>> mLookup_ShaderStageCompileResults; // dedupes stages across the started tasks
+	FStatistics                                                mStats;
+};
@@ -37,6 +37,7 @@
 #include "../../Libs/D3D12MA/src/Common.h"
 #include "../../Libs/D3D12MA/src/D3D12MemAlloc.h"
 
+#include <algorithm>
 #include <cassert>
 #include <atomic>
 
@@ -60,6 +61,8 @@ std::string VQRenderer::ShaderCacheDirectory = "Cache/Shaders/Debug";
 #else
 std::string VQRenderer::ShaderCacheDirectory = "Cache/Shaders";
 #endif
+std::string VQRenderer::ShaderArchiveFilePath = VQRenderer::ShaderCacheDirectory + "/Shaders.vqsa";
+std::string VQRenderer::ShaderDependencyGraphFilePath = VQRenderer::ShaderCacheDirectory + "/ShaderDependencies.txt";
 
 const std::string_view& VQRenderer::DXGIFormatAsString(DXGI_FORMAT format)
 {
@@ -158,13 +161,35 @@ void VQRenderer::Initialize(const FGraphicsSettings& Settings)
 
 	// initialize thread
 	mbExitUploadThread.store(false);
+	mNumPresentedFrames.store(0);
 	mbDefaultResourcesLoaded.store(false);
 	mTextureUploadThread = std::thread(&VQRenderer::TextureUploadThread_Main, this);
 
+	// texture residency
+	TextureResidencyManager::FBudget TextureResidencyBudget;
+	if (Settings.TextureMemoryBudgetMB > 0)
+		TextureResidencyBudget.MaxResidentBytes = static_cast<uint64>(Settings.TextureMemoryBudgetMB) << 20;
+	mTextureResidency.Initialize(TextureResidencyBudget);
+	mbRecordTextureVisibilityTrace = false;
+	mTextureResidencyFrame = 0;
+	mTextureResidencyAllocatedBytes = 0;
+
 	const size_t HWThreads = ThreadPool::sHardwareThreadCount;
 	const size_t HWCores   = HWThreads >> 1;
 	mWorkers_ShaderLoad.Initialize(HWThreads, "ShaderLoadWorkers");
 	mWorkers_PSOLoad.Initialize(HWThreads, "PSOLoadWorkers");
+	mpPSOCreationScheduler = std::make_unique<PSOCreationScheduler>(mWorkers_ShaderLoad, mWorkers_PSOLoad
+		, [this](const FShaderStageCompileDesc& ShaderStageDesc) { return this->LoadShader(ShaderStageDesc); }
+		, [this](const FPSODesc& PSODesc, const std::vector<FShaderStageCompileResult>& ShaderStages) { return this->CompilePSO(PSODesc, ShaderStages); }
+	);
+
+	// shader archive : LoadShader() falls back to the per-file shader cache if the archive doesn't exist
+	mNumShaderArchiveMisses.store(0);
+	mShaderIncludeCache.LoadDependencyGraph(ShaderDependencyGraphFilePath);
+	if (DirectoryUtil::FileExists(ShaderArchiveFilePath))
+	{
+		mShaderArchive.Open(ShaderArchiveFilePath);
+	}
 
 	Log::Info("[Renderer] Initialized.");
 }
@@ -180,7 +205,7 @@ void VQRenderer::Load()
 
 	LoadBuiltinPSOs();
 	float tPSOs = timer.Tick();
-	Log::Info("[Renderer]    PSOs=%.2fs", tPSOs);
+	Log::Info("[Renderer]    PSOs(dispatch)=%.2fs", tPSOs);
 
 	LoadDefaultResources();
 	float tDefaultRscs = timer.Tick();
@@ -202,6 +227,9 @@ void VQRenderer::Destroy()
 	Log::Info("VQRenderer::Exit()");
 	mWorkers_PSOLoad.Destroy();
 	mWorkers_ShaderLoad.Destroy();
+	mpPSOCreationScheduler.reset();
+	mShaderArchive.Close();
+	mShaderIncludeCache.SaveDependencyGraph(ShaderDependencyGraphFilePath);
 
 	mbExitUploadThread.store(true);
 	mSignal_UploadThreadWorkReady.NotifyAll();
@@ -220,6 +248,19 @@ void VQRenderer::Destroy()
 		it->second.Destroy();
 	}
 	mTextures.clear();
+	for (FTextureMipChainUpdate& Update : mCompletedTextureMipChainUpdates)
+	{
+		Update.pResource->Release();
+		Update.pAlloc->Release();
+	}
+	for (const FDeferredTextureRelease& Release : mDeferredTextureReleases)
+	{
+		Release.pResource->Release();
+		Release.pAlloc->Release();
+	}
+	mCompletedTextureMipChainUpdates.clear();
+	mDeferredTextureReleases.clear();
+	mDeferredSRVReleases.clear();
 	mpAllocator->Release();
 	
 	// clean up root signatures and PSOs
@@ -374,10 +415,10 @@ void VQRenderer::InitializeHeaps()
 	constexpr uint32 NumDescsRTV = 1000;
 	mHeapRTV.Create(pDevice, "HeapRTV", D3D12_DESCRIPTOR_HEAP_TYPE_RTV, NumDescsRTV);
 
-	constexpr uint32 STATIC_GEOMETRY_MEMORY_SIZE = 256 * MEGABYTE;
+	constexpr uint32 STATIC_GEOMETRY_PAGE_SIZE = 64 * MEGABYTE; // heaps grow by pages on demand
 	constexpr bool USE_GPU_MEMORY = true;
-	mStaticHeap_VertexBuffer.Create(pDevice, EBufferType::VERTEX_BUFFER, STATIC_GEOMETRY_MEMORY_SIZE, USE_GPU_MEMORY, "VQRenderer::mStaticVertexBufferPool");
-	mStaticHeap_IndexBuffer .Create(pDevice, EBufferType::INDEX_BUFFER , STATIC_GEOMETRY_MEMORY_SIZE, USE_GPU_MEMORY, "VQRenderer::mStaticIndexBufferPool");
+	mStaticHeap_VertexBuffer.Create(pDevice, EBufferType::VERTEX_BUFFER, STATIC_GEOMETRY_PAGE_SIZE, USE_GPU_MEMORY, "VQRenderer::mStaticVertexBufferPool");
+	mStaticHeap_IndexBuffer .Create(pDevice, EBufferType::INDEX_BUFFER , STATIC_GEOMETRY_PAGE_SIZE, USE_GPU_MEMORY, "VQRenderer::mStaticIndexBufferPool");
 }
 
 void VQRenderer::InitializeShaderAndPSOCacheDirectory()
@@ -649,7 +690,7 @@ void VQRenderer::LoadBuiltinRootSignatures()
 		//ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC); // perView  cb's are DescRanges
 		//ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC); // perFrame cb's are DescRanges
 
-		CD3DX12_ROOT_PARAMETER1 rootParameters[11]; 
+		CD3DX12_ROOT_PARAMETER1 rootParameters[15]; 
 		rootParameters[0].InitAsDescriptorTable(1, &ranges[0], D3D12_SHADER_VISIBILITY_PIXEL);
 		rootParameters[1].InitAsConstantBufferView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_ALL);
 #if 0
@@ -674,6 +715,13 @@ void VQRenderer::LoadBuiltinRootSignatures()
 		// SSAO map binding
 		rootParameters[10].InitAsDescriptorTable(1, &ranges[7], D3D12_SHADER_VISIBILITY_PIXEL);
 
+		// Clustered lighting bindings: point lights, spot lights, light clusters, light indices
+		// use RootShaderResourceViews for the dynamic buffer heap allocations (2 DWORDS each)
+		rootParameters[11].InitAsShaderResourceView(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[12].InitAsShaderResourceView(1, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[13].InitAsShaderResourceView(2, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[14].InitAsShaderResourceView(3, 1, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
+
 		D3D12_STATIC_SAMPLER_DESC samplers[4] = 
 		{
 			GetDefaultSamplerDesc(EDefaultSampler::TRILINEAR_WRAP , D3D12_SHADER_VISIBILITY_PIXEL, 0),
@@ -953,12 +1001,65 @@ void VQRenderer::LoadBuiltinRootSignatures()
 //		this->D3D12GraphicsDesc = o.D3D12GraphicsDesc;
 //}
 
+void VQRenderer::AddBuiltinShaderPermutations()
+{
+	std::lock_guard<std::mutex> lk(mMtxShaderPermutationManifest);
+
+	auto fnAddPermutationSet = [&](const std::wstring& ShaderFilePath, const char* pEntryPoint, const char* pShaderModel
+		, std::vector<FShaderPermutationAxis> Axes, std::vector<FShaderPermutationSet::Rule_t> Rules = {})
+	{
+		FShaderPermutationSet Set;
+		Set.BaseDesc = FShaderStageCompileDesc{ ShaderFilePath, pEntryPoint, pShaderModel };
+		Set.Axes = std::move(Axes);
+		Set.Rules = std::move(Rules);
+		mShaderPermutationManifest.AddPermutationSet(std::move(Set));
+	};
+	auto fnIsMacroSet = [](const std::vector<FShaderMacro>& Macros, const char* pName)
+	{
+		return std::any_of(Macros.begin(), Macros.end(), [&](const FShaderMacro& m) { return m.Name == pName && m.Value != "0"; });
+	};
+
+	// FORWARD LIGHTING
+	{
+		const std::wstring ShaderFilePath = GetFullPathOfShader(L"ForwardLighting.hlsl");
+		fnAddPermutationSet(ShaderFilePath, "VSMain", "vs_5_1", { { "OUTPUT_MOTION_VECTORS", { "", "1" } }, { "INSTANCED", { "", "1" } } });
+		fnAddPermutationSet(ShaderFilePath, "PSMain", "ps_5_1", { { "OUTPUT_MOTION_VECTORS", { "", "1" } }, { "OUTPUT_ALBEDO", { "", "1" } }, { "INSTANCED", { "", "1" } } });
+	}
+
+	// DEPTH PREPASS
+	{
+		const std::wstring ShaderFilePath = GetFullPathOfShader(L"DepthPrePass.hlsl");
+		fnAddPermutationSet(ShaderFilePath, "VSMain", "vs_5_1", { { "INSTANCED", { "", "1" } } });
+		fnAddPermutationSet(ShaderFilePath, "PSMain", "ps_5_1", { { "INSTANCED", { "", "1" } } });
+	}
+
+	// SHADOW DEPTH PASS
+	{
+		const std::wstring ShaderFilePath = GetFullPathOfShader(L"ShadowDepthPass.hlsl");
+		fnAddPermutationSet(ShaderFilePath, "VSMain", "vs_5_1", { { "ALPHA_MASK", { "", "1" } } });
+		fnAddPermutationSet(ShaderFilePath, "PSMain", "ps_5_1", { { "ALPHA_MASK", { "", "1" } } });
+	}
+
+	// APPLY REFLECTIONS
+	fnAddPermutationSet(GetFullPathOfShader(L"ApplyReflections.hlsl"), "CSMain", "cs_5_0", { { "COMPOSITE_BOUNDING_VOLUMES", { "", "1" } } });
+
+	// DEPTH MSAA RESOLVE: at least one output is written, see DepthMSAAResolvePass
+	fnAddPermutationSet(GetFullPathOfShader(L"DepthResolve.hlsl"), "CSMain", "cs_5_0"
+		, { { "OUTPUT_DEPTH", { "0", "1" } }, { "OUTPUT_NORMALS", { "0", "1" } }, { "OUTPUT_ROUGHNESS", { "0", "1" } } }
+		, { [=](const std::vector<FShaderMacro>& Macros)
+			{
+				return fnIsMacroSet(Macros, "OUTPUT_DEPTH") || fnIsMacroSet(Macros, "OUTPUT_NORMALS") || fnIsMacroSet(Macros, "OUTPUT_ROUGHNESS");
+			}
+		}
+	);
+}
+
 void VQRenderer::LoadBuiltinPSOs()
 {
-	// temp: singl thread pso load from vector
-	// todo: enqueue load descs into the MT queue
 	std::vector< std::pair<PSO_ID, FPSODesc >> PSOLoadDescs;
 
+	AddBuiltinShaderPermutations();
+
 	// FULLSCREEN TRIANGLE PSO
 	{
 		const std::wstring ShaderFilePath = GetFullPathOfShader(L"FullscreenTriangle.hlsl");
@@ -1295,6 +1396,34 @@ void VQRenderer::LoadBuiltinPSOs()
 		// ^ lol this is not maintainable, gotta refactor all this into render passes and proper shader perms
 	}
 
+	// INSTANCED PSOs: copies of the depth prepass & forward lighting PSOs with the INSTANCED shader permutation
+	{
+		const std::pair<EBuiltinPSOs, EBuiltinPSOs> InstancedPSOs[] =
+		{
+			  { EBuiltinPSOs::DEPTH_PREPASS_PSO                         , EBuiltinPSOs::DEPTH_PREPASS_INSTANCED_PSO }
+			, { EBuiltinPSOs::DEPTH_PREPASS_PSO_MSAA_4                  , EBuiltinPSOs::DEPTH_PREPASS_INSTANCED_PSO_MSAA_4 }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_PSO                      , EBuiltinPSOs::FORWARD_LIGHTING_INSTANCED_PSO }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_PSO               , EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_INSTANCED_PSO }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_PSO              , EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_INSTANCED_PSO }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO       , EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_INSTANCED_PSO }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_PSO_MSAA_4               , EBuiltinPSOs::FORWARD_LIGHTING_INSTANCED_PSO_MSAA_4 }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_PSO_MSAA_4        , EBuiltinPSOs::FORWARD_LIGHTING_AND_MV_INSTANCED_PSO_MSAA_4 }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_PSO_MSAA_4       , EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_INSTANCED_PSO_MSAA_4 }
+			, { EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO_MSAA_4, EBuiltinPSOs::FORWARD_LIGHTING_AND_VIZ_AND_MV_INSTANCED_PSO_MSAA_4 }
+		};
+		for (const std::pair<EBuiltinPSOs, EBuiltinPSOs>& PSOPair : InstancedPSOs)
+		{
+			auto it = std::find_if(PSOLoadDescs.begin(), PSOLoadDescs.end(), [&](const std::pair<PSO_ID, FPSODesc>& Desc) { return Desc.first == PSOPair.first; });
+			assert(it != PSOLoadDescs.end());
+
+			FPSODesc psoLoadDesc = it->second;
+			psoLoadDesc.PSOName += "_Instanced";
+			for (FShaderStageCompileDesc& StageDesc : psoLoadDesc.ShaderStageCompileDescs)
+				StageDesc.Macros.push_back({ "INSTANCED", "1" });
+			PSOLoadDescs.push_back({ PSOPair.second, std::move(psoLoadDesc) });
+		}
+	}
+
 	// WIREFRAME/UNLIT PSOs
 	{
 		const std::wstring ShaderFilePath = GetFullPathOfShader(L"Unlit.hlsl");
@@ -1531,14 +1660,13 @@ void VQRenderer::LoadBuiltinPSOs()
 
 	// ---------------------------------------------------------------------------------------------------------------1
 
-	// TODO: threaded PSO loading
-	// single threaded PSO loading for now (shader compilation is still MTd)
-	for (const std::pair<PSO_ID, FPSODesc>& psoLoadDescIDPair : PSOLoadDescs)
+	// kickoff the PSO workers, the builtin PSOs are batched with the PSOs enqueued until 
+	// WaitForPSOCreationTaskQueueCompletion() so that the shared shader stages are compiled once.
+	for (std::pair<PSO_ID, FPSODesc>& psoLoadDescIDPair : PSOLoadDescs)
 	{
-		mPSOs[psoLoadDescIDPair.first] = this->LoadPSO(psoLoadDescIDPair.second);
+		mpPSOCreationScheduler->Enqueue(psoLoadDescIDPair.first, nullptr, std::move(psoLoadDescIDPair.second));
 	}
-
-	int a = 5;
+	StartPSOCreationTasks();
 }
 
 void VQRenderer::LoadDefaultResources()
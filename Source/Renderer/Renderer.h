@@ -26,7 +26,11 @@
 #include "Buffer.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
+#include "ShaderIncludeCache.h"
+#include "PSOCreationScheduler.h"
 #include "WindowRenderContext.h"
+#include "TextureResidency.h"
 
 #include "../Engine/Core/Types.h"
 #include "../Engine/Core/Platform.h"
@@ -41,9 +45,12 @@
 #include <unordered_map>
 #include <array>
 #include <queue>
+#include <list>
+#include <map>
 #include <set>
+#include <memory>
 
-namespace D3D12MA { class Allocator; }
+namespace D3D12MA { class Allocation; class Allocator; }
 class Window;
 struct ID3D12RootSignature;
 struct ID3D12PipelineState;
@@ -54,20 +61,6 @@ struct ID3D12PipelineState;
 //
 //-----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
-struct FPSODesc
-{
-	std::string PSOName;
-	D3D12_COMPUTE_PIPELINE_STATE_DESC  D3D12ComputeDesc;
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC D3D12GraphicsDesc;
-	std::vector<FShaderStageCompileDesc> ShaderStageCompileDescs;
-};
-
-struct FPSOCreationTaskParameters
-{
-	PSO_ID* pID = nullptr; // ID to be set by the task once the PSO loads
-	FPSODesc Desc = {};
-};
-
 
 enum EBuiltinPSOs // TODO: remove the hardcoded PSOs when a generic Shader solution is integrated
 {
@@ -91,6 +84,16 @@ enum EBuiltinPSOs // TODO: remove the hardcoded PSOs when a generic Shader solut
 	FORWARD_LIGHTING_AND_MV_PSO_MSAA_4,
 	FORWARD_LIGHTING_AND_VIZ_PSO_MSAA_4,
 	FORWARD_LIGHTING_AND_VIZ_AND_MV_PSO_MSAA_4,
+	DEPTH_PREPASS_INSTANCED_PSO,
+	DEPTH_PREPASS_INSTANCED_PSO_MSAA_4,
+	FORWARD_LIGHTING_INSTANCED_PSO,
+	FORWARD_LIGHTING_AND_MV_INSTANCED_PSO,
+	FORWARD_LIGHTING_AND_VIZ_INSTANCED_PSO,
+	FORWARD_LIGHTING_AND_VIZ_AND_MV_INSTANCED_PSO,
+	FORWARD_LIGHTING_INSTANCED_PSO_MSAA_4,
+	FORWARD_LIGHTING_AND_MV_INSTANCED_PSO_MSAA_4,
+	FORWARD_LIGHTING_AND_VIZ_INSTANCED_PSO_MSAA_4,
+	FORWARD_LIGHTING_AND_VIZ_AND_MV_INSTANCED_PSO_MSAA_4,
 	WIREFRAME_PSO,
 	WIREFRAME_PSO_MSAA_4,
 	UNLIT_PSO,
@@ -172,7 +175,7 @@ public:
 
 	// Resource management
 	BufferID                     CreateBuffer(const FBufferDesc& desc);
-	TextureID                    CreateTextureFromFile(const char* pFilePath, bool bGenerateMips = false);
+	TextureID                    CreateTextureFromFile(const char* pFilePath, bool bGenerateMips = false, bool bTrackResidency = false);
 	TextureID                    CreateTexture(const TextureCreateDesc& desc);
 	void                         UploadVertexAndIndexBufferHeaps();
 
@@ -197,12 +200,40 @@ public:
 	void                         DestroyTexture(TextureID& texID);
 	void                         DestroySRV(SRV_ID& srvID);
 	void                         DestroyDSV(DSV_ID& dsvID);
+	void                         DestroyRTV(RTV_ID& rtvID);
+	void                         DestroyUAV(UAV_ID& uavID);
+	void                         DestroyVertexBuffer(BufferID& vbID);
+	void                         DestroyIndexBuffer(BufferID& ibID);
+
+	// Descriptors & buffer ranges of the destroyed resources are recycled once the frames in flight that could
+	// reference them complete on the GPU. Call once per frame after the swapchain moves to the next frame.
+	void                         ReleaseDeferredFrees(uint64 NumPresentedFrames, uint NumFramesInFlight);
+	DescriptorAllocator::FStatistics GetDescriptorHeapStatistics(EResourceHeapType HeapType) const;
+	StaticBufferHeap::FStatistics    GetStaticBufferHeapStatistics(EBufferType BufferType) const;
+
+	// Textures loaded from file w/ bTrackResidency are tracked for residency: beyond the texture memory budget, the least
+	// recently used ones are reallocated w/o their top mips and the evicted mips are reloaded from the file when they're used again.
+	// Call once per frame w/ the textures referenced by the frame. The views of the reallocated textures are written
+	// to new descriptor tables as the command lists in flight may still reference the current ones: the owners of the
+	// RelocatedSRVs (old, new) repoint their SRV_IDs, the old IDs stay valid until the frames in flight complete.
+	void                         UpdateTextureResidency(const std::vector<TextureID>& UsedTextures, std::vector<std::pair<SRV_ID, SRV_ID>>& RelocatedSRVs);
+	TextureResidencyManager::FStatistics GetTextureResidencyStatistics() const; // ResidentBytes: the sizes of the texture allocations
+	// Records the used textures of each UpdateTextureResidency() call, start before loading the textures.
+	void                         StartTextureVisibilityTraceRecording();
+	bool                         SaveTextureVisibilityTrace(const std::string& FilePath) const;
 
 	// Pipeline State Object creation functions
+	// Enqueued PSOs are created in batches: each unique shader stage across the batch is compiled once on the
+	// shader workers and the PSOs are created on the PSO workers. *pID is set on WaitForPSOCreationTaskQueueCompletion().
 	PSO_ID                       CreatePSO_OnThisThread(const FPSODesc& psoLoadDesc);
 	void                         EnqueueTask_CreatePSO(FPSOCreationTaskParameters&& params);
 	void                         StartPSOCreationTasks();
 	void                         WaitForPSOCreationTaskQueueCompletion();
+
+	// Packs the binaries of every permutation in the shader manifest into the shader archive so that
+	// the next launch resolves them from a single memory-mapped file. Call when no shader tasks are in flight.
+	void                         BuildShaderArchive();
+	inline uint32                GetNumShaderArchiveMisses() const { return mNumShaderArchiveMisses.load(); }
 	//void AbortTasks(); // ?
 
 
@@ -293,6 +324,37 @@ private:
 	mutable std::mutex                             mMtxDSVs;
 	mutable std::mutex                             mMtxVBVs;
 	mutable std::mutex                             mMtxIBVs;
+	std::atomic<uint64>                            mNumPresentedFrames; // fence value for the deferred descriptor & buffer frees
+
+	// texture residency
+	struct FSRVBinding { TextureID TexID; bool bInitAsArrayView; bool bInitAsCubeView; UINT ShaderComponentMapping; bool bUseDesc; D3D12_SHADER_RESOURCE_VIEW_DESC Desc; };
+	struct FDeferredSRVRelease { SRV_ID ID; uint64 FenceValue; };
+	TextureResidencyManager                                 mTextureResidency;
+	std::map<std::pair<SRV_ID, uint>, FSRVBinding>          mSRVBindings; // the views written by InitializeSRV(), re-created in a new table on residency changes
+	std::vector<FDeferredSRVRelease>                        mDeferredSRVReleases; // the relocated tables, until the frames in flight complete
+	FTextureVisibilityTrace                                 mTextureVisibilityTrace;
+	bool                                                    mbRecordTextureVisibilityTrace;
+	uint64                                                  mTextureResidencyFrame;
+	uint64                                                  mTextureResidencyAllocatedBytes;
+	mutable std::mutex                                      mMtxTextureResidency;
+
+	// texture reallocations w/ the resident mips: filled on the upload thread, swapped in on UpdateTextureResidency()
+	struct FTextureMipChainUpdate
+	{
+		TextureID            ID;
+		uint32               MostDetailedMip;    // of the new resource
+		uint32               OldMostDetailedMip; // of the current resource: the mips both hold are copied on the GPU
+		std::string          FilePath;           // the mips the current resource doesn't hold are reloaded from the file
+		ID3D12Resource*      pOldResource;
+		D3D12MA::Allocation* pAlloc;
+		ID3D12Resource*      pResource;
+		bool                 bSucceeded;
+	};
+	struct FDeferredTextureRelease { D3D12MA::Allocation* pAlloc; ID3D12Resource* pResource; uint64 FenceValue; };
+	std::vector<FTextureMipChainUpdate>                     mTextureMipChainUpdateQueue; // mMtxTextureUploadQueue
+	std::vector<FTextureMipChainUpdate>                     mCompletedTextureMipChainUpdates;
+	std::set<TextureID>                                     mPendingTextureMipChainUpdates; // queued or completed, one per texture
+	std::vector<FDeferredTextureRelease>                    mDeferredTextureReleases; // the old allocations, until the frames in flight complete
 
 
 	// root signatures & PSOs
@@ -303,7 +365,7 @@ private:
 	std::unordered_map<HWND, FWindowRenderContext> mRenderContextLookup;
 
 	// bookkeeping
-	std::unordered_map<TextureID, std::string>         mLookup_TextureDiskLocations;
+	std::unordered_map<TextureID, std::string>         mLookup_TextureDiskLocations; // textures tracked for residency, mMtxTextureResidency
 	std::unordered_map<EProceduralTextures, SRV_ID>    mLookup_ProceduralTextureSRVs;
 	std::unordered_map<EProceduralTextures, TextureID> mLookup_ProceduralTextureIDs;
 
@@ -318,14 +380,20 @@ private:
 	
 	// Multithreaded PSO Loading
 	ThreadPool mWorkers_PSOLoad; // Loading a PSO will use one worker from shaderLoad pool for each shader stage to be compiled
-	struct FPSOCreationTaskExecutionContext{ std::queue<FPSOCreationTaskParameters> TaskQueue; };
-	std::unordered_map <TaskID, FPSOCreationTaskExecutionContext> mLookup_PSOCreationContext;
+	std::unique_ptr<PSOCreationScheduler> mpPSOCreationScheduler; // created w/ the workers on Initialize()
 
 	// Multithreaded Shader Loading
 	ThreadPool mWorkers_ShaderLoad;
 	struct FShaderLoadTaskContext { std::queue<FShaderStageCompileDesc> TaskQueue; };
 	std::unordered_map < TaskID, FShaderLoadTaskContext> mLookup_ShaderLoadContext;
 	
+	// Shader permutations & archive
+	ShaderArchive                 mShaderArchive;
+	ShaderPermutationManifest     mShaderPermutationManifest; // builtin permutations + every shader stage loaded
+	std::mutex                    mMtxShaderPermutationManifest;
+	std::atomic<uint32>           mNumShaderArchiveMisses;
+	ShaderIncludeCache            mShaderIncludeCache; // shader sources + dependency graph of the cached shader binaries
+
 	void EnqueueTask_ShaderLoad(TaskID PSOLoadTaskID, const FShaderStageCompileDesc&);
 	std::vector<std::shared_future<FShaderStageCompileResult>> StartShaderLoadTasks(TaskID PSOLoadTaskID);
 
@@ -336,10 +404,12 @@ private:
 
 	void LoadBuiltinRootSignatures();
 	void LoadBuiltinPSOs();
+	void AddBuiltinShaderPermutations();
 	void LoadDefaultResources();
 	
 
 	ID3D12PipelineState* LoadPSO(const FPSODesc& psoLoadDesc);
+	ID3D12PipelineState* CompilePSO(const FPSODesc& psoLoadDesc, const std::vector<FShaderStageCompileResult>& ShaderStages);
 	FShaderStageCompileResult LoadShader(const FShaderStageCompileDesc& shaderStageDesc);
 
 	BufferID CreateVertexBuffer(const FBufferDesc& desc);
@@ -354,6 +424,8 @@ private:
 	void QueueTextureUpload(const FTextureUploadDesc& desc);
 	void ProcessTextureUpload(const FTextureUploadDesc& desc);
 	void ProcessTextureUploadQueue();
+	void ProcessTextureMipChainUpdate(FTextureMipChainUpdate& Update);
+	void ProcessTextureMipChainUpdateQueue();
 	void TextureUploadThread_Main();
 	inline void StartTextureUploads() { mSignal_UploadThreadWorkReady.NotifyOne(); };
 
@@ -370,5 +442,7 @@ public:
 	static std::wstring GetFullPathOfShader(const std::string& shaderFileName);
 	static std::string PSOCacheDirectory;
 	static std::string ShaderCacheDirectory;
+	static std::string ShaderArchiveFilePath;
+	static std::string ShaderDependencyGraphFilePath;
 	static void InitializeShaderAndPSOCacheDirectory();
 };
\ No newline at end of file
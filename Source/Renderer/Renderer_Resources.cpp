@@ -27,7 +27,9 @@
 #include "../../Libs/VQUtils/Source/Timer.h"
 #include "../../Libs/VQUtils/Source/Image.h"
 #include "../../Libs/D3D12MA/src/Common.h"
+#include "../../Libs/D3D12MA/src/D3D12MemAlloc.h"
 
+#include <algorithm>
 #include <cassert>
 #include <atomic>
 
@@ -505,7 +507,7 @@ BufferID VQRenderer::CreateBuffer(const FBufferDesc& desc)
 	return Id;
 }
 
-TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerateMips /*= false*/)
+TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerateMips /*= false*/, bool bTrackResidency /*= false*/)
 {
 	// check if we've already loaded the texture
 	auto it = mLoadedTexturePaths.find(pFilePath);
@@ -573,7 +575,18 @@ TextureID VQRenderer::CreateTextureFromFile(const char* pFilePath, bool bGenerat
 		tDesc.bGenerateMips = bGenerateMips;
 
 		tex.Create(mDevice.GetDevicePtr(), mpAllocator, tDesc);
+		const uint64 AllocatedBytes = tex.mpAlloc ? tex.mpAlloc->GetSize() : 0;
 		ID = AddTexture_ThreadSafe(std::move(tex));
+		if (bTrackResidency)
+		{
+			const uint32 BytesPerPixel = image.IsHDR() ? 16 : 4; // see the format above
+			std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+			mTextureResidency.Register(ID, image.Width, image.Height, MipLevels, BytesPerPixel);
+			mTextureResidencyAllocatedBytes += AllocatedBytes;
+			mLookup_TextureDiskLocations[ID] = pFilePath;
+			if (mbRecordTextureVisibilityTrace)
+				mTextureVisibilityTrace.Textures.push_back({ ID, static_cast<uint32>(image.Width), static_cast<uint32>(image.Height), static_cast<uint32>(MipLevels), BytesPerPixel });
+		}
 		this->QueueTextureUpload(FTextureUploadDesc(std::move(image), ID, tDesc));
 
 		this->StartTextureUploads();
@@ -629,11 +642,11 @@ BufferID VQRenderer::CreateVertexBuffer(const FBufferDesc& desc)
 	BufferID Id = INVALID_ID;
 	VBV vbv = {};
 
-	std::lock_guard <std::mutex> lk(mMtxStaticVBHeap);
-
+	// the heap is thread-safe, only lock for the view lookup
 	bool bSuccess = mStaticHeap_VertexBuffer.AllocVertexBuffer(desc.NumElements, desc.Stride, desc.pData, &vbv);
 	if (bSuccess)
 	{
+		std::lock_guard <std::mutex> lk(mMtxStaticVBHeap);
 		Id = LAST_USED_VBV_ID++;
 		mVBVs[Id] = vbv;
 	}
@@ -646,11 +659,10 @@ BufferID VQRenderer::CreateIndexBuffer(const FBufferDesc& desc)
 	BufferID Id = INVALID_ID;
 	IBV ibv;
 
-	std::lock_guard<std::mutex> lk(mMtxStaticIBHeap);
-
 	bool bSuccess = mStaticHeap_IndexBuffer.AllocIndexBuffer(desc.NumElements, desc.Stride, desc.pData, &ibv);
 	if (bSuccess)
 	{
+		std::lock_guard<std::mutex> lk(mMtxStaticIBHeap);
 		Id = LAST_USED_IBV_ID++;
 		mIBVs[Id] = ibv;
 	}
@@ -668,6 +680,37 @@ BufferID VQRenderer::CreateConstantBuffer(const FBufferDesc& desc)
 
 void VQRenderer::DestroyTexture(TextureID& texID)
 {
+	{
+		std::unique_lock<std::mutex> lk(mMtxTextureResidency);
+		if (mTextureResidency.IsRegistered(texID))
+		{
+			// wait for the upload thread if it's copying the mips of the texture, then drop the new allocation
+			auto fnFindCompletedUpdate = [&]() { return std::find_if(mCompletedTextureMipChainUpdates.begin(), mCompletedTextureMipChainUpdates.end(), [&](const FTextureMipChainUpdate& u) { return u.ID == texID; }); };
+			while (mPendingTextureMipChainUpdates.count(texID) && fnFindCompletedUpdate() == mCompletedTextureMipChainUpdates.end())
+			{
+				lk.unlock();
+				std::this_thread::yield();
+				lk.lock();
+			}
+			auto itUpdate = fnFindCompletedUpdate();
+			if (itUpdate != mCompletedTextureMipChainUpdates.end())
+			{
+				itUpdate->pResource->Release();
+				itUpdate->pAlloc->Release();
+				mCompletedTextureMipChainUpdates.erase(itUpdate);
+			}
+			mPendingTextureMipChainUpdates.erase(texID);
+
+			std::lock_guard<std::mutex> lkTex(mMtxTextures);
+			const Texture& tex = mTextures.at(texID);
+			mTextureResidencyAllocatedBytes -= tex.mpAlloc ? tex.mpAlloc->GetSize() : 0;
+		}
+		mTextureResidency.Unregister(texID);
+		mLookup_TextureDiskLocations.erase(texID);
+		for (auto it = mSRVBindings.begin(); it != mSRVBindings.end();)
+			it = it->second.TexID == texID ? mSRVBindings.erase(it) : std::next(it);
+	}
+
 	// Remove texID
 	std::lock_guard<std::mutex> lk(mMtxTextures);
 	mTextures.at(texID).Destroy();
@@ -814,6 +857,7 @@ void VQRenderer::InitializeDSV(DSV_ID dsvID, uint32 heapIndex, TextureID texID,
 void VQRenderer::InitializeSRV(SRV_ID srvID, uint heapIndex, TextureID texID, bool bInitAsArrayView /*= false*/, bool bInitAsCubeView /*= false*/, D3D12_SHADER_RESOURCE_VIEW_DESC* pSRVDesc /*=nullptr*/, UINT ShaderComponentMapping)
 {
 	CHECK_RESOURCE_VIEW(SRV, srvID);
+	D3D12_SHADER_RESOURCE_VIEW_DESC nullSrvDesc = {};
 	if (texID != INVALID_ID)
 	{
 		CHECK_TEXTURE(mTextures, texID);
@@ -823,7 +867,6 @@ void VQRenderer::InitializeSRV(SRV_ID srvID, uint heapIndex, TextureID texID, bo
 	{
 		// Describe and create null SRV. Null descriptors are needed in order 
 		// to achieve the effect of an "unbound" resource.
-		D3D12_SHADER_RESOURCE_VIEW_DESC nullSrvDesc = {};
 		nullSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 		nullSrvDesc.Shader4ComponentMapping = ShaderComponentMapping;
 		nullSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -832,10 +875,18 @@ void VQRenderer::InitializeSRV(SRV_ID srvID, uint heapIndex, TextureID texID, bo
 		nullSrvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 		mDevice.GetDevicePtr()->CreateShaderResourceView(nullptr, &nullSrvDesc, mSRVs.at(srvID).GetCPUDescHandle(heapIndex));
 	}
+
+	// remember the views so that a table holding a residency tracked texture can be re-created w/ the resident mips
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	const bool bUseDesc = texID == INVALID_ID || pSRVDesc;
+	mSRVBindings[{ srvID, heapIndex }] = { texID, bInitAsArrayView, bInitAsCubeView, ShaderComponentMapping, bUseDesc, texID != INVALID_ID && pSRVDesc ? *pSRVDesc : nullSrvDesc };
 }
 void VQRenderer::InitializeSRV(SRV_ID srvID, uint heapIndex, D3D12_SHADER_RESOURCE_VIEW_DESC& srvDesc)
 {
 	mDevice.GetDevicePtr()->CreateShaderResourceView(nullptr, &srvDesc, mSRVs.at(srvID).GetCPUDescHandle(heapIndex));
+
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	mSRVBindings[{ srvID, heapIndex }] = { INVALID_ID, false, false, srvDesc.Shader4ComponentMapping, true, srvDesc };
 }
 void VQRenderer::InitializeRTV(RTV_ID rtvID, uint heapIndex, TextureID texID)
 {
@@ -1020,19 +1071,296 @@ void VQRenderer::InitializeUAV(UAV_ID uavID, uint heapIndex, TextureID texID, ui
 
 void VQRenderer::DestroySRV(SRV_ID& srvID)
 {
+	{
+		std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+		for (auto it = mSRVBindings.lower_bound({ srvID, 0u }); it != mSRVBindings.end() && it->first.first == srvID;)
+			it = mSRVBindings.erase(it);
+	}
+
 	std::lock_guard<std::mutex> lk(mMtxSRVs_CBVs_UAVs);
-	//mSRVs.at(srvID).Destroy(); // TODO
-	mSRVs.erase(srvID);
+	auto it = mSRVs.find(srvID);
+	if (it != mSRVs.end())
+	{
+		mHeapCBV_SRV_UAV.FreeDescriptor(it->second, mNumPresentedFrames.load());
+		mSRVs.erase(it);
+	}
 	//Log::Info("Erase SRV_ID=%d", srvID); // todo: verbose logging preprocessor ifdef
 	srvID = INVALID_ID;
 }
 void VQRenderer::DestroyDSV(DSV_ID& dsvID)
 {
 	std::lock_guard<std::mutex> lk(mMtxDSVs);
-	//mDSVs.at(dsvID).Destroy(); // TODO
-	mDSVs.erase(dsvID);
+	auto it = mDSVs.find(dsvID);
+	if (it != mDSVs.end())
+	{
+		mHeapDSV.FreeDescriptor(it->second, mNumPresentedFrames.load());
+		mDSVs.erase(it);
+	}
 	dsvID = INVALID_ID;
 }
+void VQRenderer::DestroyRTV(RTV_ID& rtvID)
+{
+	std::lock_guard<std::mutex> lk(mMtxRTVs);
+	auto it = mRTVs.find(rtvID);
+	if (it != mRTVs.end())
+	{
+		mHeapRTV.FreeDescriptor(it->second, mNumPresentedFrames.load());
+		mRTVs.erase(it);
+	}
+	rtvID = INVALID_ID;
+}
+void VQRenderer::DestroyUAV(UAV_ID& uavID)
+{
+	std::lock_guard<std::mutex> lk(mMtxSRVs_CBVs_UAVs);
+	auto it = mUAVs.find(uavID);
+	if (it != mUAVs.end())
+	{
+		mHeapCBV_SRV_UAV.FreeDescriptor(it->second, mNumPresentedFrames.load());
+		mUAVs.erase(it);
+	}
+	uavID = INVALID_ID;
+}
+
+void VQRenderer::DestroyVertexBuffer(BufferID& vbID)
+{
+	std::lock_guard<std::mutex> lk(mMtxStaticVBHeap);
+	auto it = mVBVs.find(vbID);
+	if (it != mVBVs.end())
+	{
+		mStaticHeap_VertexBuffer.FreeBuffer(it->second.BufferLocation, mNumPresentedFrames.load());
+		mVBVs.erase(it);
+	}
+	vbID = INVALID_ID;
+}
+void VQRenderer::DestroyIndexBuffer(BufferID& ibID)
+{
+	std::lock_guard<std::mutex> lk(mMtxStaticIBHeap);
+	auto it = mIBVs.find(ibID);
+	if (it != mIBVs.end())
+	{
+		mStaticHeap_IndexBuffer.FreeBuffer(it->second.BufferLocation, mNumPresentedFrames.load());
+		mIBVs.erase(it);
+	}
+	ibID = INVALID_ID;
+}
+
+void VQRenderer::ReleaseDeferredFrees(uint64 NumPresentedFrames, uint NumFramesInFlight)
+{
+	mNumPresentedFrames.store(NumPresentedFrames);
+
+	// frames [0, NumPresentedFrames - NumFramesInFlight] are known to be completed on the GPU
+	if (NumPresentedFrames < NumFramesInFlight)
+		return;
+	const uint64 CompletedFrame = NumPresentedFrames - NumFramesInFlight;
+
+	{
+		std::lock_guard<std::mutex> lk(mMtxSRVs_CBVs_UAVs);
+		mHeapCBV_SRV_UAV.ReleaseDeferredFrees(CompletedFrame);
+	}
+	{
+		std::lock_guard<std::mutex> lk(mMtxDSVs);
+		mHeapDSV.ReleaseDeferredFrees(CompletedFrame);
+	}
+	{
+		std::lock_guard<std::mutex> lk(mMtxRTVs);
+		mHeapRTV.ReleaseDeferredFrees(CompletedFrame);
+	}
+	mStaticHeap_VertexBuffer.ReleaseDeferredFrees(CompletedFrame);
+	mStaticHeap_IndexBuffer.ReleaseDeferredFrees(CompletedFrame);
+	{
+		std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+		auto itEnd = std::remove_if(mDeferredTextureReleases.begin(), mDeferredTextureReleases.end(), [&](const FDeferredTextureRelease& r)
+		{
+			if (r.FenceValue > CompletedFrame)
+				return false;
+			r.pResource->Release();
+			r.pAlloc->Release();
+			return true;
+		});
+		mDeferredTextureReleases.erase(itEnd, mDeferredTextureReleases.end());
+
+		// the descriptors of the relocated tables were freed w/ the same fence value, the IDs go w/ them
+		std::lock_guard<std::mutex> lkSRV(mMtxSRVs_CBVs_UAVs);
+		auto itSRVEnd = std::remove_if(mDeferredSRVReleases.begin(), mDeferredSRVReleases.end(), [&](const FDeferredSRVRelease& r)
+		{
+			if (r.FenceValue > CompletedFrame)
+				return false;
+			mSRVs.erase(r.ID);
+			return true;
+		});
+		mDeferredSRVReleases.erase(itSRVEnd, mDeferredSRVReleases.end());
+	}
+}
+
+DescriptorAllocator::FStatistics VQRenderer::GetDescriptorHeapStatistics(EResourceHeapType HeapType) const
+{
+	switch (HeapType)
+	{
+	case RTV_HEAP:         { std::lock_guard<std::mutex> lk(mMtxRTVs);           return mHeapRTV.GetStatistics(); }
+	case DSV_HEAP:         { std::lock_guard<std::mutex> lk(mMtxDSVs);           return mHeapDSV.GetStatistics(); }
+	case CBV_SRV_UAV_HEAP: { std::lock_guard<std::mutex> lk(mMtxSRVs_CBVs_UAVs); return mHeapCBV_SRV_UAV.GetStatistics(); }
+	}
+	return {}; // samplers are static in the root signatures, the sampler heap isn't created
+}
+
+void VQRenderer::UpdateTextureResidency(const std::vector<TextureID>& UsedTextures, std::vector<std::pair<SRV_ID, SRV_ID>>& RelocatedSRVs)
+{
+	RelocatedSRVs.clear();
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	const uint64 Frame = ++mTextureResidencyFrame;
+	for (TextureID ID : UsedTextures)
+		mTextureResidency.MarkUsed(ID, Frame);
+	if (mbRecordTextureVisibilityTrace)
+		mTextureVisibilityTrace.AddFrame(UsedTextures);
+
+	const std::vector<TextureResidencyManager::FResidencyChange>& Changes = mTextureResidency.Update(Frame);
+	if (Changes.empty() && mCompletedTextureMipChainUpdates.empty())
+		return;
+
+	std::vector<TextureID> ChangedTextures;
+	for (const TextureResidencyManager::FResidencyChange& Change : Changes)
+		ChangedTextures.push_back(Change.ID);
+
+	// swap in the reallocated textures: the old allocations are released once the frames in flight complete
+	std::unique_lock<std::mutex> lkTex(mMtxTextures);
+	std::vector<TextureID> SwappedTextures;
+	for (const FTextureMipChainUpdate& Update : mCompletedTextureMipChainUpdates)
+	{
+		mPendingTextureMipChainUpdates.erase(Update.ID);
+		if (!Update.bSucceeded) // keeps the current allocation until the next residency change of the texture
+		{
+			Update.pResource->Release();
+			Update.pAlloc->Release();
+			continue;
+		}
+		ChangedTextures.push_back(Update.ID); // the resident mips may have changed again in the meantime
+
+		Texture& tex = mTextures.at(Update.ID);
+		mDeferredTextureReleases.push_back({ tex.mpAlloc, tex.mpResource, mNumPresentedFrames.load() });
+		mTextureResidencyAllocatedBytes += Update.pAlloc->GetSize();
+		mTextureResidencyAllocatedBytes -= tex.mpAlloc->GetSize();
+		tex.mpAlloc = Update.pAlloc;
+		tex.mpResource = Update.pResource;
+		tex.mMostDetailedResidentMip = static_cast<int>(Update.MostDetailedMip);
+		SwappedTextures.push_back(Update.ID);
+	}
+	mCompletedTextureMipChainUpdates.clear();
+
+	// the tables viewing the swapped textures can't be written while the command lists in flight may reference them:
+	// the views are written to new tables and the old ones are retired w/ the deferred frees.
+	std::sort(SwappedTextures.begin(), SwappedTextures.end());
+	std::set<SRV_ID> SRVsToRelocate;
+	for (const auto& it : mSRVBindings)
+	{
+		if (std::binary_search(SwappedTextures.begin(), SwappedTextures.end(), it.second.TexID))
+			SRVsToRelocate.insert(it.first.first);
+	}
+	for (SRV_ID OldID : SRVsToRelocate)
+	{
+		const uint32 NumDescriptors = GetSRV(OldID).GetSize();
+		const SRV_ID NewID = this->AllocateSRV(NumDescriptors);
+		CBV_SRV_UAV& NewSRV = mSRVs.at(NewID);
+		for (uint32 i = 0; i < NumDescriptors; ++i)
+		{
+			auto it = mSRVBindings.find({ OldID, i });
+			if (it == mSRVBindings.end()) // not written through InitializeSRV(), leave it unbound
+			{
+				D3D12_SHADER_RESOURCE_VIEW_DESC nullSrvDesc = {};
+				nullSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+				nullSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+				nullSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+				nullSrvDesc.Texture2D.MipLevels = 1;
+				mDevice.GetDevicePtr()->CreateShaderResourceView(nullptr, &nullSrvDesc, NewSRV.GetCPUDescHandle(i));
+				continue;
+			}
+			FSRVBinding b = it->second;
+			if (b.TexID != INVALID_ID)
+				mTextures.at(b.TexID).InitializeSRV(i, &NewSRV, b.bInitAsArrayView, b.bInitAsCubeView, b.ShaderComponentMapping, b.bUseDesc ? &b.Desc : nullptr);
+			else
+				mDevice.GetDevicePtr()->CreateShaderResourceView(nullptr, &b.Desc, NewSRV.GetCPUDescHandle(i));
+			mSRVBindings.erase(it);
+			mSRVBindings[{ NewID, i }] = b;
+		}
+
+		const uint64 FenceValue = mNumPresentedFrames.load();
+		{
+			std::lock_guard<std::mutex> lkSRV(mMtxSRVs_CBVs_UAVs);
+			mHeapCBV_SRV_UAV.FreeDescriptor(mSRVs.at(OldID), FenceValue);
+		}
+		mDeferredSRVReleases.push_back({ OldID, FenceValue });
+		RelocatedSRVs.push_back({ OldID, NewID });
+	}
+
+	// reallocate the textures whose resident mips changed, one reallocation in flight per texture
+	std::vector<FTextureMipChainUpdate> Updates;
+	for (TextureID ID : ChangedTextures)
+	{
+		if (mPendingTextureMipChainUpdates.count(ID) || !mTextureResidency.IsRegistered(ID))
+			continue;
+		const Texture& tex = mTextures.at(ID);
+		const uint32 MostDetailedMip = mTextureResidency.GetMostDetailedResidentMip(ID);
+		if (MostDetailedMip == static_cast<uint32>(tex.mMostDetailedResidentMip))
+			continue;
+
+		D3D12_RESOURCE_DESC d3dDesc = tex.mpResource->GetDesc();
+		d3dDesc.Width     = std::max(tex.mWidth  >> MostDetailedMip, 1);
+		d3dDesc.Height    = std::max(tex.mHeight >> MostDetailedMip, 1);
+		d3dDesc.MipLevels = static_cast<UINT16>(tex.mMipMapCount - MostDetailedMip);
+
+		FTextureMipChainUpdate Update = { ID, MostDetailedMip, static_cast<uint32>(tex.mMostDetailedResidentMip), mLookup_TextureDiskLocations.at(ID), tex.mpResource, nullptr, nullptr, false };
+		D3D12MA::ALLOCATION_DESC AllocDesc = {};
+		AllocDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
+		HRESULT hr = mpAllocator->CreateResource(&AllocDesc, &d3dDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, &Update.pAlloc, IID_PPV_ARGS(&Update.pResource));
+		if (FAILED(hr))
+		{
+			Log::Error("VQRenderer::UpdateTextureResidency(): couldn't reallocate %s w/ mips [%u, %d)", Update.FilePath.c_str(), MostDetailedMip, tex.mMipMapCount);
+			continue;
+		}
+		SetName(Update.pResource, Update.FilePath.c_str());
+
+		mPendingTextureMipChainUpdates.insert(ID);
+		Updates.push_back(std::move(Update));
+	}
+	lkTex.unlock(); // the upload thread locks the textures w/ the upload queue locked
+	if (Updates.empty())
+		return;
+	{
+		std::unique_lock<std::mutex> lkQueue(mMtxTextureUploadQueue);
+		mTextureMipChainUpdateQueue.insert(mTextureMipChainUpdateQueue.end(), Updates.begin(), Updates.end());
+	}
+	this->StartTextureUploads();
+}
+
+TextureResidencyManager::FStatistics VQRenderer::GetTextureResidencyStatistics() const
+{
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	TextureResidencyManager::FStatistics Stats = mTextureResidency.GetStatistics();
+	Stats.ResidentBytes = mTextureResidencyAllocatedBytes; // the manager's are estimated from the mip sizes
+	return Stats;
+}
+
+void VQRenderer::StartTextureVisibilityTraceRecording()
+{
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	mTextureVisibilityTrace.Clear();
+	mbRecordTextureVisibilityTrace = true;
+}
+
+bool VQRenderer::SaveTextureVisibilityTrace(const std::string& FilePath) const
+{
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	return mTextureVisibilityTrace.Save(FilePath);
+}
+
+StaticBufferHeap::FStatistics VQRenderer::GetStaticBufferHeapStatistics(EBufferType BufferType) const
+{
+	switch (BufferType)
+	{
+	case VERTEX_BUFFER: return mStaticHeap_VertexBuffer.GetStatistics();
+	case INDEX_BUFFER : return mStaticHeap_IndexBuffer.GetStatistics();
+	}
+	return {};
+}
 
 
 // -----------------------------------------------------------------------------------------------------------------
@@ -1073,28 +1401,92 @@ std::vector<std::shared_future<FShaderStageCompileResult>> VQRenderer::StartShad
 
 	return taskResults;
 }
+static PSO_ID GetNextAvailablePSOIdAndIncrement()
+{
+	return EBuiltinPSOs::NUM_BUILTIN_PSOs + LAST_USED_PSO_ID_OFFSET++;
+}
+
 void VQRenderer::EnqueueTask_CreatePSO(FPSOCreationTaskParameters&& params)
 {
-	const TaskID PSOTaskID = LAST_USED_TASK_ID.fetch_add(1);
-	FPSOCreationTaskExecutionContext& ctx = mLookup_PSOCreationContext[PSOTaskID];
-	assert(false); // TODO: continue
-	//ctx.TaskQueue.push(params.Desc);
-	//*params.pID = INVALID_ID;
+	assert(params.pID);
+	mpPSOCreationScheduler->Enqueue(GetNextAvailablePSOIdAndIncrement(), params.pID, std::move(params.Desc));
 }
 void VQRenderer::StartPSOCreationTasks()
 {
-	assert(false); // TODO: continue
+	mpPSOCreationScheduler->Start();
 }
 
 void VQRenderer::WaitForPSOCreationTaskQueueCompletion()
 {
-	assert(false); // TODO: continue
+	for (const PSOCreationScheduler::FResult& Result : mpPSOCreationScheduler->Wait())
+	{
+		if (Result.pPSO || !Result.pID) // builtin PSOs keep their slot even if they fail
+			mPSOs[Result.ID] = Result.pPSO;
+		if (Result.pID)
+			*Result.pID = Result.pPSO ? Result.ID : INVALID_ID;
+	}
 }
 
-static PSO_ID GetNextAvailablePSOIdAndIncrement()
+static std::string GetShaderArchiveDependencyKey(const FShaderStageCompileDesc& ShaderStageCompileDesc)
 {
-	return EBuiltinPSOs::NUM_BUILTIN_PSOs + LAST_USED_PSO_ID_OFFSET++;
+	return VQRenderer::ShaderArchiveFilePath + "|" + ShaderUtils::GetShaderStageKey(ShaderStageCompileDesc);
+}
+
+void VQRenderer::BuildShaderArchive()
+{
+	Timer t; t.Start();
+
+	std::vector<FShaderStageCompileDesc> Permutations;
+	{
+		std::lock_guard<std::mutex> lk(mMtxShaderPermutationManifest);
+		Permutations = mShaderPermutationManifest.EnumeratePermutations();
+	}
+
+	// the archive file is rewritten: unmap it and resolve all permutations from the per-file cache / source
+	mShaderArchive.Close();
+
+	std::vector<std::shared_future<FShaderStageCompileResult>> ShaderCompileResults;
+	for (const FShaderStageCompileDesc& ShaderStageDesc : Permutations)
+	{
+		ShaderCompileResults.push_back(mWorkers_ShaderLoad.AddTask([=]()
+		{
+			return this->LoadShader(ShaderStageDesc);
+		}));
+	}
+
+	// the entries are rewritten: their dependencies are recorded again on the first lookup into the new archive
+	for (const FShaderStageCompileDesc& ShaderStageDesc : Permutations)
+	{
+		mShaderIncludeCache.RemoveDependencies(GetShaderArchiveDependencyKey(ShaderStageDesc));
+	}
+
+	std::vector<FShaderStageCompileResult> ShaderStages; // keeps the blobs alive until the archive is written
+	std::vector<ShaderArchive::FEntry> Entries;
+	ShaderStages.reserve(Permutations.size());
+	for (size_t i = 0; i < Permutations.size(); ++i)
+	{
+		ShaderStages.push_back(ShaderCompileResults[i].get()); // SYNC POINT - wait for shaders to load / compile
+		const Shader::FBlob& Blob = ShaderStages.back().ShaderBlob;
+		if (Blob.IsNull())
+		{
+			Log::Warning("Shader archive: skipping permutation %s", ShaderUtils::GetShaderStageKey(Permutations[i]).c_str());
+			continue;
+		}
+		Entries.push_back({ ShaderArchive::GetPermutationKey(Permutations[i]), Blob.GetByteCode(), Blob.GetByteCodeSize() });
+	}
+
+	if (!ShaderArchive::Write(ShaderArchiveFilePath, Entries))
+	{
+		Log::Error("Couldn't write shader archive: %s", ShaderArchiveFilePath.c_str());
+		return;
+	}
+
+	mShaderArchive.Open(ShaderArchiveFilePath);
+	mNumShaderArchiveMisses.store(0);
+	mShaderIncludeCache.SaveDependencyGraph(ShaderDependencyGraphFilePath);
+	Log::Info("[Renderer] Shader archive built: %d shaders in %.2fs", static_cast<int>(Entries.size()), t.Tick());
 }
+
 PSO_ID VQRenderer::CreatePSO_OnThisThread(const FPSODesc& psoLoadDesc)
 {
 	ID3D12PipelineState* pPSO = this->LoadPSO(psoLoadDesc);
@@ -1111,21 +1503,12 @@ ID3D12PipelineState* VQRenderer::LoadPSO(const FPSODesc& psoLoadDesc)
 	TaskID               PSOTaskID = LAST_USED_TASK_ID.fetch_add(1);
 	ID3D12PipelineState* pPSO = nullptr;
 
-	HRESULT hr = {};
-	ID3D12Device* pDevice = mDevice.GetDevicePtr();
-
 	// calc PSO hash
 	//std::hash<FPSOLoadDesc> PSO_HASH = 
 
 	// check if PSO is cached
 	const bool bCachedPSOExists = false;
 	const bool bCacheDirty = false;
-	const bool bComputePSO = std::find_if(RANGE(psoLoadDesc.ShaderStageCompileDescs) // check if ShaderModel has cs_*_*
-			, [](const FShaderStageCompileDesc& desc) { return ShaderUtils::GetShaderStageEnumFromShaderModel(desc.ShaderModel) == EShaderStage::CS; }
-		) != psoLoadDesc.ShaderStageCompileDescs.end();
-
-	std::vector<std::shared_future<FShaderStageCompileResult>> shaderCompileResults;
-	std::unordered_map<EShaderStage, ID3D12ShaderReflection*> ShaderReflections;
 
 	// compile PSO if no cache or cache dirty, otherwise load cached binary
 	if (!bCachedPSOExists || bCacheDirty) 
@@ -1139,19 +1522,19 @@ ID3D12PipelineState* VQRenderer::LoadPSO(const FPSODesc& psoLoadDesc)
 		}
 
 		// kickoff shader compiler workers
-		shaderCompileResults = std::move( StartShaderLoadTasks(PSOTaskID) );
+		std::vector<std::shared_future<FShaderStageCompileResult>> shaderCompileResults = StartShaderLoadTasks(PSOTaskID);
 
 		// SYNC POINT - wait for shaders to load / compile
-		for (std::shared_future<FShaderStageCompileResult>& result : shaderCompileResults)
+		std::vector<FShaderStageCompileResult> ShaderStages;
+		for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
 		{
-			assert(result.valid());
-			result.wait();
+			assert(TaskResult.valid());
+			ShaderStages.push_back(TaskResult.get());
 		}
 
 		// Check for compile errors
-		for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
+		for (const FShaderStageCompileResult& ShaderCompileResult : ShaderStages)
 		{
-			FShaderStageCompileResult ShaderCompileResult = TaskResult.get();
 			if (ShaderCompileResult.ShaderBlob.IsNull())
 			{
 				Log::Error("PSO Compile failed: PSOTaskID=%d", PSOTaskID);
@@ -1159,87 +1542,101 @@ ID3D12PipelineState* VQRenderer::LoadPSO(const FPSODesc& psoLoadDesc)
 			}
 		}
 
-		// Compile the PSO using the shaders
-		if (bComputePSO) // COMPUTE PSO ------------------------------------------------------------
-		{
-			D3D12_COMPUTE_PIPELINE_STATE_DESC  d3d12ComputePSODesc = psoLoadDesc.D3D12ComputeDesc;
+		pPSO = CompilePSO(psoLoadDesc, ShaderStages);
+	}
+	else // load cached PSO
+	{
+		assert(false); // TODO
+	}
 
-			// Assign CS shader blob to PSODesc
-			for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
-			{
-				FShaderStageCompileResult ShaderCompileResult = TaskResult.get();
+	return pPSO;
+}
 
-				CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
-				d3d12ComputePSODesc.CS = ShaderByteCode;
-			}
+ID3D12PipelineState* VQRenderer::CompilePSO(const FPSODesc& psoLoadDesc, const std::vector<FShaderStageCompileResult>& ShaderStages)
+{
+	ID3D12PipelineState* pPSO = nullptr;
 
-			// TODO: assign root signature
+	HRESULT hr = {};
+	ID3D12Device* pDevice = mDevice.GetDevicePtr();
 
-			// Compile PSO
-			hr = pDevice->CreateComputePipelineState(&d3d12ComputePSODesc, IID_PPV_ARGS(&pPSO));
-		}
-		else // GRAPHICS PSO ------------------------------------------------------------------------
+	const bool bComputePSO = std::find_if(RANGE(psoLoadDesc.ShaderStageCompileDescs) // check if ShaderModel has cs_*_*
+			, [](const FShaderStageCompileDesc& desc) { return ShaderUtils::GetShaderStageEnumFromShaderModel(desc.ShaderModel) == EShaderStage::CS; }
+		) != psoLoadDesc.ShaderStageCompileDescs.end();
+
+	std::unordered_map<EShaderStage, ID3D12ShaderReflection*> ShaderReflections;
+
+	// Compile the PSO using the shaders
+	if (bComputePSO) // COMPUTE PSO ------------------------------------------------------------
+	{
+		D3D12_COMPUTE_PIPELINE_STATE_DESC  d3d12ComputePSODesc = psoLoadDesc.D3D12ComputeDesc;
+
+		// Assign CS shader blob to PSODesc
+		for (const FShaderStageCompileResult& ShaderCompileResult : ShaderStages)
 		{
-			D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12GraphicsPSODesc = psoLoadDesc.D3D12GraphicsDesc;
+			CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
+			d3d12ComputePSODesc.CS = ShaderByteCode;
+		}
 
-			// Assign shader blobs to PSODesc
-			for (std::shared_future<FShaderStageCompileResult>& TaskResult : shaderCompileResults)
-			{
-				FShaderStageCompileResult ShaderCompileResult = TaskResult.get();
+		// TODO: assign root signature
 
-				CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
-				switch (ShaderCompileResult.ShaderStageEnum)
-				{
-				case EShaderStage::VS: d3d12GraphicsPSODesc.VS = ShaderByteCode; break;
-				case EShaderStage::GS: d3d12GraphicsPSODesc.GS = ShaderByteCode; break;
-				case EShaderStage::DS: d3d12GraphicsPSODesc.DS = ShaderByteCode; break;
-				case EShaderStage::HS: d3d12GraphicsPSODesc.HS = ShaderByteCode; break;
-				case EShaderStage::PS: d3d12GraphicsPSODesc.PS = ShaderByteCode; break;
-				}
+		// Compile PSO
+		hr = pDevice->CreateComputePipelineState(&d3d12ComputePSODesc, IID_PPV_ARGS(&pPSO));
+	}
+	else // GRAPHICS PSO ------------------------------------------------------------------------
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12GraphicsPSODesc = psoLoadDesc.D3D12GraphicsDesc;
 
-				// reflect shader
-				ID3D12ShaderReflection*& pReflection = ShaderReflections[ShaderCompileResult.ShaderStageEnum];
-				D3DReflect(ShaderByteCode.pShaderBytecode, ShaderByteCode.BytecodeLength, IID_PPV_ARGS(&pReflection));
-			}
-			
-			// assign input layout
-			std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
-			const bool bHasVS = ShaderReflections.find(EShaderStage::VS) != ShaderReflections.end();
-			if (bHasVS)
+		// Assign shader blobs to PSODesc
+		for (const FShaderStageCompileResult& ShaderCompileResult : ShaderStages)
+		{
+			CD3DX12_SHADER_BYTECODE ShaderByteCode(ShaderCompileResult.ShaderBlob.GetByteCode(), ShaderCompileResult.ShaderBlob.GetByteCodeSize());
+			switch (ShaderCompileResult.ShaderStageEnum)
 			{
-				inputLayout = ShaderUtils::ReflectInputLayoutFromVS(ShaderReflections.at(EShaderStage::VS));
-				d3d12GraphicsPSODesc.InputLayout = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
+			case EShaderStage::VS: d3d12GraphicsPSODesc.VS = ShaderByteCode; break;
+			case EShaderStage::GS: d3d12GraphicsPSODesc.GS = ShaderByteCode; break;
+			case EShaderStage::DS: d3d12GraphicsPSODesc.DS = ShaderByteCode; break;
+			case EShaderStage::HS: d3d12GraphicsPSODesc.HS = ShaderByteCode; break;
+			case EShaderStage::PS: d3d12GraphicsPSODesc.PS = ShaderByteCode; break;
 			}
 
-			// TODO: assign root signature
+			// reflect shader
+			ID3D12ShaderReflection*& pReflection = ShaderReflections[ShaderCompileResult.ShaderStageEnum];
+			D3DReflect(ShaderByteCode.pShaderBytecode, ShaderByteCode.BytecodeLength, IID_PPV_ARGS(&pReflection));
+		}
+		
+		// assign input layout
+		std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+		const bool bHasVS = ShaderReflections.find(EShaderStage::VS) != ShaderReflections.end();
+		if (bHasVS)
+		{
+			inputLayout = ShaderUtils::ReflectInputLayoutFromVS(ShaderReflections.at(EShaderStage::VS));
+			d3d12GraphicsPSODesc.InputLayout = { inputLayout.data(), static_cast<UINT>(inputLayout.size()) };
+		}
+
+		// TODO: assign root signature
 #if 0
+		{
+			for (auto& it : ShaderReflections)
 			{
-				for (auto& it : ShaderReflections)
+				EShaderStage eShaderStage = it.first;
+				ID3D12ShaderReflection*& pRefl = it.second;
+
+				D3D12_SHADER_DESC shaderDesc = {};
+				pRefl->GetDesc(&shaderDesc);
+				
+				std::vector< D3D12_SHADER_INPUT_BIND_DESC> boundRscDescs(shaderDesc.BoundResources);
+				for (UINT i = 0; i < shaderDesc.BoundResources; ++i)
 				{
-					EShaderStage eShaderStage = it.first;
-					ID3D12ShaderReflection*& pRefl = it.second;
-
-					D3D12_SHADER_DESC shaderDesc = {};
-					pRefl->GetDesc(&shaderDesc);
-					
-					std::vector< D3D12_SHADER_INPUT_BIND_DESC> boundRscDescs(shaderDesc.BoundResources);
-					for (UINT i = 0; i < shaderDesc.BoundResources; ++i)
-					{
-						pRefl->GetResourceBindingDesc(i, &boundRscDescs[i]);
-					}
-
-					int a = 5;
+					pRefl->GetResourceBindingDesc(i, &boundRscDescs[i]);
 				}
+
+				int a = 5;
 			}
+		}
 #endif
 
-			// Compile PSO
-			hr = pDevice->CreateGraphicsPipelineState(&d3d12GraphicsPSODesc, IID_PPV_ARGS(&pPSO));
-		}
-	}
-	else // load cached PSO
-	{
-		assert(false); // TODO
+		// Compile PSO
+		hr = pDevice->CreateGraphicsPipelineState(&d3d12GraphicsPSODesc, IID_PPV_ARGS(&pPSO));
 	}
 
 	// Check PSO compile result
@@ -1264,6 +1661,29 @@ FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc&
 
 	const std::string ShaderSourcePath = StrUtil::UnicodeToASCII<256>( ShaderStageCompileDesc.FilePath.c_str() ); 
 
+	// record the permutation so that the next shader archive build includes it
+	{
+		std::lock_guard<std::mutex> lk(mMtxShaderPermutationManifest);
+		mShaderPermutationManifest.AddPermutation(ShaderStageCompileDesc);
+	}
+
+	FShaderStageCompileResult Result = {};
+	Result.ShaderStageEnum = ShaderUtils::GetShaderStageEnumFromShaderModel(ShaderStageCompileDesc.ShaderModel);
+
+	// try the shader archive first, the archive entry is stale if its source or includes changed
+	if (mShaderArchive.IsOpen())
+	{
+		const void* pData = nullptr;
+		size_t Size = 0;
+		if (mShaderArchive.Find(ShaderArchive::GetPermutationKey(ShaderStageCompileDesc), &pData, &Size)
+			&& !mShaderIncludeCache.IsCacheDirty(GetShaderArchiveDependencyKey(ShaderStageCompileDesc), ShaderSourcePath, mShaderArchive.GetFilePath()))
+		{
+			Result.ShaderBlob = CreateBlobFromMemory(pData, Size);
+			return Result;
+		}
+	}
+	mNumShaderArchiveMisses.fetch_add(1); // a missing archive counts too so that the first run builds it
+
 	// calculate shader hash
 	const size_t ShaderHash = GeneratePreprocessorDefinitionsHash(ShaderStageCompileDesc.Macros);
 
@@ -1277,12 +1697,10 @@ FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc&
 
 	// decide whether to use shader cache or compile from source
 	const bool bUseCachedShaders = DirectoryUtil::FileExists(CachedShaderBinaryPath)
-		&& !ShaderUtils::IsCacheDirty(ShaderSourcePath, CachedShaderBinaryPath);
+		&& !mShaderIncludeCache.IsCacheDirty(CachedShaderBinaryPath, ShaderSourcePath, CachedShaderBinaryPath);
 
 	// load the shader d3dblob
-	FShaderStageCompileResult Result = {};
 	Shader::FBlob& ShaderBlob = Result.ShaderBlob;
-	Result.ShaderStageEnum = ShaderUtils::GetShaderStageEnumFromShaderModel(ShaderStageCompileDesc.ShaderModel);
 
 	if (bUseCachedShaders)
 	{
@@ -1304,11 +1722,13 @@ FShaderStageCompileResult VQRenderer::LoadShader(const FShaderStageCompileDesc&
 			return Result; // no crash until runtime
 		}
 
-		ShaderBlob = CompileFromSource(ShaderStageCompileDesc, errMsg);
+		std::vector<std::string> Dependencies;
+		ShaderBlob = CompileFromSource(ShaderStageCompileDesc, mShaderIncludeCache, Dependencies, errMsg);
 		const bool bCompileSuccessful = !ShaderBlob.IsNull();
 		if (bCompileSuccessful)
 		{
 			CacheShaderBinary(CachedShaderBinaryPath, ShaderBlob.GetByteCodeSize(), ShaderBlob.GetByteCode());
+			mShaderIncludeCache.RecordDependencies(CachedShaderBinaryPath, Dependencies);
 		}
 		else
 		{
@@ -1454,16 +1874,107 @@ void VQRenderer::ProcessTextureUploadQueue()
 		img.Destroy(); // free the image memory
 }
 
+void VQRenderer::ProcessTextureMipChainUpdate(FTextureMipChainUpdate& Update)
+{
+	ID3D12GraphicsCommandList* pCmd = mHeapUpload.GetCommandList();
+	ID3D12Device* pDevice = mDevice.GetDevicePtr();
+	const D3D12_RESOURCE_DESC d3dDesc = Update.pResource->GetDesc();
+	const uint32 NumMips = d3dDesc.MipLevels;
+	const uint32 FirstCopiedMip = std::max(Update.MostDetailedMip, Update.OldMostDetailedMip);
+	const uint32 NumReloadedMips = FirstCopiedMip - Update.MostDetailedMip;
+
+	// restored mips: reload the image and mip it down the same way as the initial upload
+	if (NumReloadedMips > 0)
+	{
+		Image img = Image::LoadFromFile(Update.FilePath.c_str());
+		if (!img.pData)
+		{
+			Log::Error("VQRenderer: couldn't reload %s to restore its mips", Update.FilePath.c_str());
+			return;
+		}
+		const UINT bytePP = static_cast<UINT>(VQ_DXGI_UTILS::GetPixelByteSize(d3dDesc.Format));
+		for (uint32 mip = 0; mip < Update.MostDetailedMip; ++mip)
+			VQ_DXGI_UTILS::MipImage(img.pData, std::max(img.Width >> mip, 1), std::max(img.Height >> mip, 1), bytePP);
+
+		UINT64 UplHeapSize;
+		uint32_t num_rows[D3D12_REQ_MIP_LEVELS] = { 0 };
+		UINT64 row_size_in_bytes[D3D12_REQ_MIP_LEVELS] = { 0 };
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedSubresource[D3D12_REQ_MIP_LEVELS];
+		pDevice->GetCopyableFootprints(&d3dDesc, 0, NumReloadedMips, 0, placedSubresource, num_rows, row_size_in_bytes, &UplHeapSize);
+
+		UINT8* pUploadBufferMem = mHeapUpload.Suballocate(SIZE_T(UplHeapSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		if (pUploadBufferMem == NULL)
+		{
+			mHeapUpload.UploadToGPUAndWait(); // We ran out of mem in the upload heap, upload contents and try allocating again
+			pUploadBufferMem = mHeapUpload.Suballocate(SIZE_T(UplHeapSize), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+			assert(pUploadBufferMem);
+		}
+
+		for (uint32 mip = 0; mip < NumReloadedMips; ++mip)
+		{
+			VQ_DXGI_UTILS::CopyPixels(img.pData
+				, pUploadBufferMem + placedSubresource[mip].Offset
+				, placedSubresource[mip].Footprint.RowPitch
+				, placedSubresource[mip].Footprint.Width * bytePP
+				, num_rows[mip]
+			);
+			VQ_DXGI_UTILS::MipImage(img.pData, placedSubresource[mip].Footprint.Width, num_rows[mip], bytePP);
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT slice = placedSubresource[mip];
+			slice.Offset += (pUploadBufferMem - mHeapUpload.BasePtr());
+
+			CD3DX12_TEXTURE_COPY_LOCATION Dst(Update.pResource, mip);
+			CD3DX12_TEXTURE_COPY_LOCATION Src(mHeapUpload.GetResource(), slice);
+			pCmd->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
+		}
+		img.Destroy();
+	}
+
+	// mips held by both resources: copy on the GPU. The textures loaded from file rest in the common state.
+	D3D12_RESOURCE_BARRIER barriers[2] = {};
+	barriers[0] = CD3DX12_RESOURCE_BARRIER::Transition(Update.pOldResource, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	pCmd->ResourceBarrier(1, barriers);
+	for (uint32 mip = FirstCopiedMip; mip < Update.MostDetailedMip + NumMips; ++mip)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION Dst(Update.pResource, mip - Update.MostDetailedMip);
+		CD3DX12_TEXTURE_COPY_LOCATION Src(Update.pOldResource, mip - Update.OldMostDetailedMip);
+		pCmd->CopyTextureRegion(&Dst, 0, 0, 0, &Src, NULL);
+	}
+	barriers[0] = CD3DX12_RESOURCE_BARRIER::Transition(Update.pOldResource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON);
+	barriers[1] = CD3DX12_RESOURCE_BARRIER::Transition(Update.pResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
+	pCmd->ResourceBarrier(2, barriers);
+	Update.bSucceeded = true;
+}
+
+void VQRenderer::ProcessTextureMipChainUpdateQueue()
+{
+	std::vector<FTextureMipChainUpdate> Updates;
+	{
+		std::unique_lock<std::mutex> lk(mMtxTextureUploadQueue);
+		std::swap(Updates, mTextureMipChainUpdateQueue);
+	}
+	if (Updates.empty())
+		return;
+
+	for (FTextureMipChainUpdate& Update : Updates)
+		ProcessTextureMipChainUpdate(Update);
+	mHeapUpload.UploadToGPUAndWait();
+
+	std::lock_guard<std::mutex> lk(mMtxTextureResidency);
+	mCompletedTextureMipChainUpdates.insert(mCompletedTextureMipChainUpdates.end(), Updates.begin(), Updates.end());
+}
+
 void VQRenderer::TextureUploadThread_Main()
 {
 	while (!mbExitUploadThread)
 	{
-		mSignal_UploadThreadWorkReady.Wait([&]() { return mbExitUploadThread.load() || !mTextureUploadQueue.empty(); });
+		mSignal_UploadThreadWorkReady.Wait([&]() { return mbExitUploadThread.load() || !mTextureUploadQueue.empty() || !mTextureMipChainUpdateQueue.empty(); });
 
 		if (mbExitUploadThread)
 			break;
 
 		this->ProcessTextureUploadQueue();
+		this->ProcessTextureMipChainUpdateQueue();
 	}
 }
 
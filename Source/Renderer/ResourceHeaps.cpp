@@ -55,7 +55,7 @@
 void StaticResourceViewHeap::Create(ID3D12Device* pDevice, const std::string& ResourceName, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32 descriptorCount, bool forceCPUVisible)
 {
     this->mDescriptorCount = descriptorCount;
-    this->mIndex = 0;
+    this->mAllocator.Initialize(descriptorCount);
         
     this->mDescriptorElementSize = pDevice->GetDescriptorHandleIncrementSize(heapType);
 
@@ -84,26 +84,48 @@ void StaticResourceViewHeap::Destroy()
 
 bool StaticResourceViewHeap::AllocDescriptor(uint32 size, ResourceView* pRV)
 {
-    if ((mIndex + size) > mDescriptorCount)
+    const uint32 Index = mAllocator.Allocate(size);
+    if (Index == DescriptorAllocator::INVALID_OFFSET)
     {
+        const DescriptorAllocator::FStatistics s = mAllocator.GetStatistics();
+        Log::Error("StaticResourceViewHeap: couldn't allocate %u descriptors (Free=%u, PendingFree=%u, LargestFreeRange=%u)"
+            , size, s.NumFreeDescriptors, s.NumPendingFreeDescriptors, s.LargestFreeRange);
         assert(!"StaticResourceViewHeapDX12 heap ran of memory, increase its size");
         return false;
     }
 
     D3D12_CPU_DESCRIPTOR_HANDLE CPUView = mpHeap->GetCPUDescriptorHandleForHeapStart();
-    CPUView.ptr += mIndex * mDescriptorElementSize;
+    CPUView.ptr += Index * mDescriptorElementSize;
 
     
     D3D12_GPU_DESCRIPTOR_HANDLE GPUView = mbGPUVisible ? mpHeap->GetGPUDescriptorHandleForHeapStart() : D3D12_GPU_DESCRIPTOR_HANDLE{};
-    GPUView.ptr += mbGPUVisible ? mIndex * mDescriptorElementSize : GPUView.ptr;
-
-    mIndex += size;
+    GPUView.ptr += mbGPUVisible ? Index * mDescriptorElementSize : GPUView.ptr;
 
     pRV->SetResourceView(size, mDescriptorElementSize, CPUView, GPUView);
 
     return true;
 }
 
+void StaticResourceViewHeap::FreeDescriptor(const ResourceView& rv, uint64 FenceValue)
+{
+    if (rv.GetSize() == 0)
+        return;
+
+    const SIZE_T HeapStart = mpHeap->GetCPUDescriptorHandleForHeapStart().ptr;
+    const SIZE_T ViewStart = rv.GetCPUDescHandle().ptr;
+    assert(ViewStart >= HeapStart);
+
+    const uint32 Index = static_cast<uint32>((ViewStart - HeapStart) / mDescriptorElementSize);
+    assert(Index + rv.GetSize() <= mDescriptorCount);
+
+    mAllocator.FreeDeferred(Index, rv.GetSize(), FenceValue);
+}
+
+void StaticResourceViewHeap::ReleaseDeferredFrees(uint64 CompletedFenceValue)
+{
+    mAllocator.ReleaseCompletedFrees(CompletedFenceValue);
+}
+
 
 // ===========================================================================================================================================
 
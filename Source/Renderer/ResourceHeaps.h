@@ -40,6 +40,7 @@
 #pragma once
 
 #include "Common.h"
+#include "DescriptorAllocator.h"
 
 #include <d3d12.h>
 #include <string>
@@ -62,12 +63,16 @@ public:
     void Create(ID3D12Device* pDevice, const std::string& ResourceName, D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32 descriptorCount, bool forceCPUVisible = false);
     void Destroy();
     bool AllocDescriptor(uint32 size, ResourceView* pRV);
-    
+
+    // Descriptors are returned to the heap once ReleaseDeferredFrees() is called with a CompletedFenceValue >= FenceValue
+    void FreeDescriptor(const ResourceView& rv, uint64 FenceValue);
+    void ReleaseDeferredFrees(uint64 CompletedFenceValue);
 
     inline ID3D12DescriptorHeap* GetHeap() const { return mpHeap; }
+    inline DescriptorAllocator::FStatistics GetStatistics() const { return mAllocator.GetStatistics(); }
 
 private:
-    uint32 mIndex;
+    DescriptorAllocator mAllocator;
     uint32 mDescriptorCount;
     uint32 mDescriptorElementSize;
 
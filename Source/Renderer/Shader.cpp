@@ -17,10 +17,12 @@
 //	Contact: volkanilbeyli@gmail.com
 
 #include "Shader.h"
+#include "ShaderIncludeCache.h"
 #include "Renderer.h"
 
 #include "../../Libs/VQUtils/Source/utils.h"
 #include <fstream>
+#include <algorithm>
 
 #include <wrl.h>
 #include <D3Dcompiler.h>
@@ -40,7 +42,6 @@ static const std::unordered_map<EShaderStage, const char*> DEFAULT_SHADER_ENTRY_
 	{ EShaderStage::CS, "CSMain" },
 };
 
-ID3DInclude* const SHADER_INCLUDE_HANDLER = D3D_COMPILE_STANDARD_FILE_INCLUDE; // use default include handler for using #include in shader files
 
 #if defined( _DEBUG ) || defined ( FORCE_DEBUG )
 const UINT SHADER_COMPILE_FLAGS = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_DEBUG | D3DCOMPILE_DEBUG_NAME_FOR_BINARY;
@@ -86,6 +87,110 @@ static const std::unordered_map<UINT, LPCWSTR> D3DCompilerFlagCompatiblityLookup
 };
 
 
+//-------------------------------------------------------------------------------------------------------------
+// INCLUDE HANDLERS
+//-------------------------------------------------------------------------------------------------------------
+// Serve the source & include files from the ShaderIncludeCache and collect the files opened during compilation
+//
+class FXCIncludeHandler : public ID3DInclude
+{
+public:
+	FXCIncludeHandler(ShaderIncludeCache& IncludeCache, const std::shared_ptr<const ShaderIncludeCache::FFile>& pSourceFile)
+		: mIncludeCache(IncludeCache)
+	{
+		AddFile(pSourceFile);
+	}
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) override
+	{
+		// includes are relative to the including file, or the main source file for the top level includes
+		auto itParent = mFileDirectories.find(pParentData);
+		const std::string& Directory = itParent != mFileDirectories.end() ? itParent->second : mFileDirectories.at(mFiles.front()->Contents.data());
+
+		std::shared_ptr<const ShaderIncludeCache::FFile> pFile = mIncludeCache.GetFile(Directory + "/" + pFileName);
+		if (!pFile)
+			return E_FAIL;
+
+		AddFile(pFile);
+		*ppData = pFile->Contents.data();
+		*pBytes = static_cast<UINT>(pFile->Contents.size());
+		return S_OK;
+	}
+	HRESULT __stdcall Close(LPCVOID pData) override { return S_OK; } // files are kept alive until the handler is destroyed
+
+	std::vector<std::string> GetOpenedFiles() const
+	{
+		std::vector<std::string> Files;
+		for (const std::shared_ptr<const ShaderIncludeCache::FFile>& pFile : mFiles)
+			Files.push_back(pFile->Path);
+		return Files;
+	}
+
+private:
+	void AddFile(const std::shared_ptr<const ShaderIncludeCache::FFile>& pFile)
+	{
+		mFileDirectories[pFile->Contents.data()] = std::filesystem::path(pFile->Path).parent_path().generic_string();
+		mFiles.push_back(pFile);
+	}
+
+	ShaderIncludeCache& mIncludeCache;
+	std::vector<std::shared_ptr<const ShaderIncludeCache::FFile>> mFiles;
+	std::unordered_map<LPCVOID, std::string> mFileDirectories; // file data -> directory, to resolve the nested includes
+};
+
+class DXCIncludeHandler : public IDxcIncludeHandler
+{
+public:
+	DXCIncludeHandler(ShaderIncludeCache& IncludeCache, IDxcUtils* pUtils, const std::string& SourceDirectory)
+		: mIncludeCache(IncludeCache)
+		, mpUtils(pUtils)
+		, mSourceDirectory(SourceDirectory)
+	{}
+
+	HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override
+	{
+		// DXC resolves the include paths relative to the including file / the -I directories
+		const std::string FilePath = StrUtil::UnicodeToASCII<512>(pFilename);
+		std::shared_ptr<const ShaderIncludeCache::FFile> pFile = mIncludeCache.GetFile(FilePath);
+		if (!pFile)
+			pFile = mIncludeCache.GetFile(mSourceDirectory + "/" + FilePath);
+		if (!pFile)
+			return E_FAIL;
+
+		mFiles.push_back(pFile->Path);
+
+		CComPtr<IDxcBlobEncoding> pBlob;
+		HRESULT hr = mpUtils->CreateBlob(pFile->Contents.data(), static_cast<UINT32>(pFile->Contents.size()), CP_UTF8, &pBlob);
+		if (FAILED(hr))
+			return hr;
+		*ppIncludeSource = pBlob.Detach();
+		return S_OK;
+	}
+
+	// the handler lives on the stack of CompileFromSource()
+	ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+	ULONG STDMETHODCALLTYPE Release() override { return 1; }
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+		{
+			*ppvObject = static_cast<IDxcIncludeHandler*>(this);
+			return S_OK;
+		}
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	inline const std::vector<std::string>& GetOpenedFiles() const { return mFiles; }
+
+private:
+	ShaderIncludeCache& mIncludeCache;
+	IDxcUtils*          mpUtils;
+	std::string         mSourceDirectory;
+	std::vector<std::string> mFiles;
+};
+
+
 //-------------------------------------------------------------------------------------------------------------
 // SHADER UTILS
 //-------------------------------------------------------------------------------------------------------------
@@ -124,54 +229,6 @@ std::string GetIncludeFileName(const std::string& line)
 	return std::string();
 }
 
-bool AreIncludesDirty(const std::string& srcPath, const std::string& cachePath)
-{
-	const std::string ShaderSourceDir = DirectoryUtil::GetFolderPath(srcPath);
-	const std::string ShaderCacheDir = DirectoryUtil::GetFolderPath(cachePath);
-
-	std::stack<std::string> includeStack;
-	includeStack.push(srcPath);
-	while (!includeStack.empty())
-	{
-		const std::string topIncludeFilePath = includeStack.top();
-		includeStack.pop();
-		std::ifstream src = std::ifstream(topIncludeFilePath.c_str());
-		if (!src.good())
-		{
-			Log::Error("[ShaderCompile] %s : Cannot open include file '%s'", srcPath.c_str(),  topIncludeFilePath.c_str());
-			return false;
-		}
-
-		std::string line;
-		while (getline(src, line))
-		{
-			if (line.size() >= 2 && line[0] == line[1] && line[1] == '/') // skip comment lines
-				continue;
-
-			const std::string includeFileName = GetIncludeFileName(line);
-			if (includeFileName.empty()) continue;
-
-			const std::string currIncludeDir = DirectoryUtil::GetFolderPath(topIncludeFilePath);
-			const std::string includeSourcePath = currIncludeDir + includeFileName;
-			const std::string includeCachePath = currIncludeDir + includeFileName;
-
-			if (DirectoryUtil::IsFileNewer(includeSourcePath, cachePath))
-				return true;
-			includeStack.push(includeSourcePath);
-		}
-		src.close();
-	}
-	return false;
-}
-
-bool IsCacheDirty(const std::string& sourcePath, const std::string& cachePath)
-{
-	if (!DirectoryUtil::FileExists(cachePath)) 
-		return true;
-
-	return DirectoryUtil::IsFileNewer(sourcePath, cachePath) || AreIncludesDirty(sourcePath, cachePath);
-}
-
 std::vector<D3D12_INPUT_ELEMENT_DESC> ReflectInputLayoutFromVS(ID3D12ShaderReflection* pReflection)
 {
 	D3D12_SHADER_DESC shaderDesc = {};
@@ -227,7 +284,7 @@ std::vector<D3D12_INPUT_ELEMENT_DESC> ReflectInputLayoutFromVS(ID3D12ShaderRefle
 }
 
 
-Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompileDesc, std::string& OutErrorString)
+Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompileDesc, ShaderIncludeCache& IncludeCache, std::vector<std::string>& OutDependencies, std::string& OutErrorString)
 {
 	const WCHAR* strPath = ShaderStageCompileDesc.FilePath.data();
 	std::vector<std::string> SMTokens = StrUtil::split(ShaderStageCompileDesc.ShaderModel, '_');
@@ -259,6 +316,14 @@ Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompil
 	//-------------------------------------------------------------------------
 	Shader::FBlob blob;
 
+	const std::string SourcePath = StrUtil::UnicodeToASCII<512>(strPath);
+	std::shared_ptr<const ShaderIncludeCache::FFile> pSourceFile = IncludeCache.GetFile(SourcePath);
+	if (!pSourceFile)
+	{
+		OutErrorString = "Cannot read shader source: " + SourcePath;
+		return blob;
+	}
+
 	// SM5 - Use FXC compiler - generates DXBC shader code
 	if (bIsShaderModel5)
 	{
@@ -272,10 +337,13 @@ Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompil
 		});
 		d3dMacros[i] = { NULL, NULL };
 
-		if (FAILED(D3DCompileFromFile(
-			strPath,
+		FXCIncludeHandler IncludeHandler(IncludeCache, pSourceFile);
+		if (FAILED(D3DCompile(
+			pSourceFile->Contents.data(),
+			pSourceFile->Contents.size(),
+			SourcePath.c_str(),
 			d3dMacros.data(),
-			SHADER_INCLUDE_HANDLER,
+			&IncludeHandler,
 			ShaderStageCompileDesc.EntryPoint.c_str(),
 			ShaderStageCompileDesc.ShaderModel.c_str(),
 			SHADER_COMPILE_FLAGS,
@@ -283,8 +351,9 @@ Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompil
 			&blob.pD3DBlob,
 			&pBlob_ErrMsg)))
 		{
-			OutErrorString = GetCompileError(pBlob_ErrMsg, StrUtil::UnicodeToASCII<512>(strPath));
+			OutErrorString = GetCompileError(pBlob_ErrMsg, SourcePath);
 		}
+		OutDependencies = IncludeHandler.GetOpenedFiles();
 
 	}
 
@@ -294,7 +363,8 @@ Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompil
 		// collection of wstrings to feed into dxc compiler
 		const std::wstring strEntryPoint  = StrUtil::ASCIIToUnicode(ShaderStageCompileDesc.EntryPoint);
 		const std::wstring strShaderModel = StrUtil::ASCIIToUnicode(StrUtil::GetLowercased(ShaderStageCompileDesc.ShaderModel));
-		const std::wstring strParentFolder = StrUtil::ASCIIToUnicode(DirectoryUtil::GetFolderPath(StrUtil::UnicodeToASCII<260>(strPath)));
+		const std::string  SourceDirectory = std::filesystem::path(pSourceFile->Path).parent_path().generic_string();
+		const std::wstring strParentFolder = StrUtil::ASCIIToUnicode(DirectoryUtil::GetFolderPath(SourcePath));
 		std::vector<std::wstring> unicodeDefineArgs;
 		for (const FShaderMacro& macro : ShaderStageCompileDesc.Macros)
 		{
@@ -327,16 +397,10 @@ Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompil
 
 		CComPtr<IDxcVersionInfo> DXC_versionInfo; // ?
 
-		// load shader source blob from file
-		uint32_t codePage = CP_UTF8;
-		CComPtr<IDxcBlobEncoding> sourceBlob;
-		if (FAILED(DXC_library->CreateBlobFromFile(strPath, &codePage, &sourceBlob)))
-		{
-			assert(false); // Handle file loading error...
-		}
+		// shader source from the include cache
 		DxcBuffer Source;
-		Source.Ptr = sourceBlob->GetBufferPointer();
-		Source.Size = sourceBlob->GetBufferSize();
+		Source.Ptr = pSourceFile->Contents.data();
+		Source.Size = pSourceFile->Contents.size();
 		Source.Encoding = DXC_CP_ACP;  // Assume BOM says UTF8 or UTF16 or this is ANSI text.
 		
 		// build args: support compile flags from D3DCompile
@@ -385,19 +449,21 @@ Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompil
 		ppArgs.push_back(strParentFolder.c_str());
 
 		// include handler
-		CComPtr<IDxcIncludeHandler> pIncludeHandler;
-		DXC_utils->CreateDefaultIncludeHandler(&pIncludeHandler);
+		DXCIncludeHandler IncludeHandler(IncludeCache, DXC_utils, SourceDirectory);
 
 		// compile
 		CComPtr<IDxcResult> pResults;
 		hr = DXC_compiler3->Compile(
 			&Source,
 			ppArgs.data(), (UINT32)ppArgs.size(),
-			pIncludeHandler,
+			&IncludeHandler,
 			IID_PPV_ARGS(&pResults)
 		);
 		pResults->GetStatus(&hr);
 
+		OutDependencies = IncludeHandler.GetOpenedFiles();
+		OutDependencies.insert(OutDependencies.begin(), pSourceFile->Path);
+
 		// Print errors/warnings if present
 		CComPtr<IDxcBlobUtf8> pErrors = nullptr;
 		pResults->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&pErrors), nullptr);
@@ -435,16 +501,23 @@ Shader::FBlob CompileFromCachedBinary(const std::string& ShaderBinaryFilePath)
 
 	Log::Info("Loading Shader Binary: %s ", DirectoryUtil::GetFileNameFromPath(ShaderBinaryFilePath).c_str());
 
+	Shader::FBlob ShaderBlob = CreateBlobFromMemory(pBuffer, shaderBinarySize);
+	free(pBuffer);
+
+	return ShaderBlob;
+}
+
+Shader::FBlob CreateBlobFromMemory(const void* pShaderBinary, size_t ShaderBinarySize)
+{
 	Shader::FBlob ShaderBlob;
-	if (FAILED(D3DCreateBlob(shaderBinarySize, &ShaderBlob.pD3DBlob)))
+	if (FAILED(D3DCreateBlob(ShaderBinarySize, &ShaderBlob.pD3DBlob)))
 	{
 		assert(false);
 	}
-	
-	assert(pBuffer);
-	assert(shaderBinarySize > 0);
-	memcpy(ShaderBlob.pD3DBlob->GetBufferPointer(), pBuffer, shaderBinarySize);
-	free(pBuffer);
+
+	assert(pShaderBinary);
+	assert(ShaderBinarySize > 0);
+	memcpy(ShaderBlob.pD3DBlob->GetBufferPointer(), pShaderBinary, ShaderBinarySize);
 
 	return ShaderBlob;
 }
@@ -467,6 +540,21 @@ size_t GeneratePreprocessorDefinitionsHash(const std::vector<FShaderMacro>& macr
 	return std::hash<std::string>()(concatenatedMacros);
 }
 
+std::string GetShaderStageKey(const FShaderStageCompileDesc& desc)
+{
+	std::vector<FShaderMacro> macros = desc.Macros;
+	std::sort(macros.begin(), macros.end(), [](const FShaderMacro& l, const FShaderMacro& r) { return l.Name < r.Name; });
+
+	std::string key = StrUtil::UnicodeToASCII<512>(desc.FilePath.c_str()) + "|" + desc.EntryPoint + "|" + desc.ShaderModel;
+	for (const FShaderMacro& macro : macros)
+		key += "|" + macro.Name + "=" + macro.Value;
+	if (desc.bUseNative16bit)
+		key += "|16bit";
+	for (const std::wstring& flag : desc.DXCompilerFlags)
+		key += "|" + StrUtil::UnicodeToASCII<256>(flag.c_str());
+	return key;
+}
+
 EShaderStage GetShaderStageEnumFromShaderModel(const std::string& ShaderModel)
 {
 	// ShaderModel e.g. = "cs_5_1"
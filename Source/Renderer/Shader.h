@@ -76,6 +76,7 @@ struct FShaderMacro
 };
 
 struct FShaderStageCompileDesc;
+class ShaderIncludeCache;
 
 
 //
@@ -125,13 +126,18 @@ public:
 
 namespace ShaderUtils
 {
-	// Compiles shader from source file with the given file path, entry point, shader model & macro definitions
+	// Compiles shader from source file with the given file path, entry point, shader model & macro definitions.
+	// Source & include files are read through @IncludeCache, @OutDependencies receives the files the shader is compiled from.
 	//
-	Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompileDesc, std::string& OutErrorString);
+	Shader::FBlob CompileFromSource(const FShaderStageCompileDesc& ShaderStageCompileDesc, ShaderIncludeCache& IncludeCache, std::vector<std::string>& OutDependencies, std::string& OutErrorString);
 	
 	// Reads in cached shader binary from given @ShaderBinaryFilePath 
 	//
 	Shader::FBlob CompileFromCachedBinary(const std::string& ShaderBinaryFilePath);
+
+	// Copies the shader binary in memory into a blob, e.g. from a memory-mapped shader archive
+	//
+	Shader::FBlob CreateBlobFromMemory(const void* pShaderBinary, size_t ShaderBinarySize);
 	
 	// Writes out compiled ID3DBlob into @ShaderBinaryFilePath
 	//
@@ -141,10 +147,12 @@ namespace ShaderUtils
 	//
 	size_t GeneratePreprocessorDefinitionsHash(const std::vector<FShaderMacro>& Macros);
 
+	// Returns a string that identifies the shader stages producing the same binary, independent of the macro order
+	//
+	std::string GetShaderStageKey(const FShaderStageCompileDesc& ShaderStageCompileDesc);
+
 	std::string  GetCompileError(ID3DBlob*& errorMessage, const std::string& shdPath);
 	std::string  GetIncludeFileName(const std::string& line);
-	bool         AreIncludesDirty(const std::string& srcPath, const std::string& cachePath);
-	bool         IsCacheDirty(const std::string& sourcePath, const std::string& cachePath);
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> ReflectInputLayoutFromVS(ID3D12ShaderReflection* pReflection);
 
@@ -0,0 +1,277 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "ShaderIncludeCache.h"
+#include "Shader.h"
+
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <fstream>
+#include <sstream>
+#include <stack>
+
+std::string ShaderIncludeCache::NormalizePath(const std::string& Path)
+{
+	return std::filesystem::path(Path).lexically_normal().generic_string();
+}
+
+uint64 ShaderIncludeCache::HashContents(const void* pData, size_t Size)
+{
+	// FNV-1a
+	const unsigned char* p = static_cast<const unsigned char*>(pData);
+	uint64 hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < Size; ++i)
+	{
+		hash ^= p[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::shared_ptr<const ShaderIncludeCache::FFile> ShaderIncludeCache::GetFile(const std::string& Path)
+{
+	const std::string NormalizedPath = NormalizePath(Path);
+
+	std::error_code ec;
+	const std::filesystem::file_time_type LastWriteTime = std::filesystem::last_write_time(NormalizedPath, ec);
+	if (ec)
+		return nullptr;
+
+	// the lock is held while reading so that concurrent compiles including the same file read it only once
+	std::lock_guard<std::mutex> lk(mMtxFiles);
+	auto it = mFiles.find(NormalizedPath);
+	if (it != mFiles.end() && it->second->LastWriteTime == LastWriteTime)
+		return it->second;
+
+	std::ifstream file(NormalizedPath, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return nullptr;
+
+	std::shared_ptr<FFile> pFile = std::make_shared<FFile>();
+	pFile->Path = NormalizedPath;
+	pFile->Contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	pFile->ContentHash = HashContents(pFile->Contents.data(), pFile->Contents.size());
+	pFile->LastWriteTime = LastWriteTime;
+
+	mFiles[NormalizedPath] = pFile;
+	return pFile;
+}
+
+std::vector<std::string> ShaderIncludeCache::InvalidateFile(const std::string& Path)
+{
+	{
+		std::lock_guard<std::mutex> lk(mMtxFiles);
+		mFiles.erase(NormalizePath(Path));
+	}
+	return GetDependentShaders(Path);
+}
+
+std::vector<std::string> ShaderIncludeCache::ScanIncludes(const std::string& SourcePath)
+{
+	std::vector<std::string> Files;
+	std::unordered_set<std::string> Visited;
+
+	std::stack<std::string> IncludeStack;
+	IncludeStack.push(NormalizePath(SourcePath));
+	while (!IncludeStack.empty())
+	{
+		const std::string FilePath = IncludeStack.top();
+		IncludeStack.pop();
+		if (!Visited.insert(FilePath).second)
+			continue;
+
+		std::shared_ptr<const FFile> pFile = GetFile(FilePath);
+		if (!pFile)
+		{
+			Log::Error("[ShaderCompile] %s : Cannot open include file '%s'", SourcePath.c_str(), FilePath.c_str());
+			continue;
+		}
+		Files.push_back(FilePath);
+
+		const std::string FileDirectory = std::filesystem::path(FilePath).parent_path().generic_string();
+		std::istringstream src(pFile->Contents);
+		std::string line;
+		while (std::getline(src, line))
+		{
+			if (line.size() >= 2 && line[0] == line[1] && line[1] == '/') // skip comment lines
+				continue;
+
+			const std::string IncludeFileName = ShaderUtils::GetIncludeFileName(line);
+			if (IncludeFileName.empty())
+				continue;
+
+			IncludeStack.push(NormalizePath(FileDirectory.empty() ? IncludeFileName : FileDirectory + "/" + IncludeFileName));
+		}
+	}
+	return Files;
+}
+
+void ShaderIncludeCache::RecordDependencies(const std::string& ShaderKey, const std::vector<std::string>& Files)
+{
+	std::vector<FDependency> Dependencies;
+	for (const std::string& FilePath : Files)
+	{
+		std::shared_ptr<const FFile> pFile = GetFile(FilePath);
+		if (pFile)
+			Dependencies.push_back({ pFile->Path, pFile->ContentHash });
+	}
+
+	std::lock_guard<std::mutex> lk(mMtxDependencyGraph);
+	RecordDependencies_NoLock(ShaderKey, std::move(Dependencies));
+}
+
+void ShaderIncludeCache::RemoveDependencies(const std::string& ShaderKey)
+{
+	std::lock_guard<std::mutex> lk(mMtxDependencyGraph);
+	RecordDependencies_NoLock(ShaderKey, {});
+	mShaderDependencies.erase(ShaderKey);
+}
+
+void ShaderIncludeCache::RecordDependencies_NoLock(const std::string& ShaderKey, std::vector<FDependency>&& Dependencies)
+{
+	auto it = mShaderDependencies.find(ShaderKey);
+	if (it != mShaderDependencies.end())
+	{
+		for (const FDependency& Dependency : it->second)
+			mFileDependents[Dependency.Path].erase(ShaderKey);
+	}
+
+	for (const FDependency& Dependency : Dependencies)
+		mFileDependents[Dependency.Path].insert(ShaderKey);
+	mShaderDependencies[ShaderKey] = std::move(Dependencies);
+	mbDependencyGraphDirty = true;
+}
+
+bool ShaderIncludeCache::IsCacheDirty(const std::string& ShaderKey, const std::string& SourcePath, const std::string& CachePath)
+{
+	std::error_code ec;
+	const std::filesystem::file_time_type CacheWriteTime = std::filesystem::last_write_time(CachePath, ec);
+	if (ec)
+		return true;
+
+	std::vector<FDependency> Dependencies;
+	bool bHasDependencyRecord = false;
+	{
+		std::lock_guard<std::mutex> lk(mMtxDependencyGraph);
+		auto it = mShaderDependencies.find(ShaderKey);
+		if (it != mShaderDependencies.end())
+		{
+			Dependencies = it->second;
+			bHasDependencyRecord = true;
+		}
+	}
+
+	if (bHasDependencyRecord)
+	{
+		for (const FDependency& Dependency : Dependencies)
+		{
+			std::shared_ptr<const FFile> pFile = GetFile(Dependency.Path);
+			if (!pFile || pFile->ContentHash != Dependency.ContentHash)
+				return true;
+		}
+		return false;
+	}
+
+	// no record: compare timestamps, and record the scanned includes if the cache is up to date
+	const std::vector<std::string> Files = ScanIncludes(SourcePath);
+	for (const std::string& FilePath : Files)
+	{
+		std::shared_ptr<const FFile> pFile = GetFile(FilePath);
+		if (!pFile || pFile->LastWriteTime > CacheWriteTime)
+			return true;
+	}
+	RecordDependencies(ShaderKey, Files);
+	return false;
+}
+
+std::vector<std::string> ShaderIncludeCache::GetDependentShaders(const std::string& Path) const
+{
+	std::lock_guard<std::mutex> lk(mMtxDependencyGraph);
+	auto it = mFileDependents.find(NormalizePath(Path));
+	if (it == mFileDependents.end())
+		return {};
+	return std::vector<std::string>(it->second.begin(), it->second.end());
+}
+
+//
+// Dependency graph file: a line per shader key followed by a line per dependency: <TAB><content hash> <path>
+//
+bool ShaderIncludeCache::LoadDependencyGraph(const std::string& FilePath)
+{
+	std::ifstream file(FilePath);
+	if (!file.is_open())
+		return false;
+
+	std::lock_guard<std::mutex> lk(mMtxDependencyGraph);
+	std::string ShaderKey;
+	std::vector<FDependency> Dependencies;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty())
+			continue;
+
+		if (line[0] != '\t')
+		{
+			if (!ShaderKey.empty())
+				RecordDependencies_NoLock(ShaderKey, std::move(Dependencies));
+			ShaderKey = line;
+			Dependencies.clear();
+			continue;
+		}
+
+		const size_t iSeparator = line.find(' ');
+		if (ShaderKey.empty() || iSeparator == std::string::npos)
+		{
+			Log::Warning("ShaderIncludeCache: invalid dependency graph file %s, ignoring", FilePath.c_str());
+			mShaderDependencies.clear();
+			mFileDependents.clear();
+			return false;
+		}
+		Dependencies.push_back({ line.substr(iSeparator + 1), std::stoull(line.substr(1, iSeparator - 1), nullptr, 16) });
+	}
+	if (!ShaderKey.empty())
+		RecordDependencies_NoLock(ShaderKey, std::move(Dependencies));
+
+	mbDependencyGraphDirty = false;
+	return true;
+}
+
+bool ShaderIncludeCache::SaveDependencyGraph(const std::string& FilePath)
+{
+	std::lock_guard<std::mutex> lk(mMtxDependencyGraph);
+	if (!mbDependencyGraphDirty)
+		return true;
+
+	std::ofstream file(FilePath, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("ShaderIncludeCache: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+
+	for (const std::pair<const std::string, std::vector<FDependency>>& Shader : mShaderDependencies)
+	{
+		file << Shader.first << '\n';
+		for (const FDependency& Dependency : Shader.second)
+			file << '\t' << std::hex << Dependency.ContentHash << std::dec << ' ' << Dependency.Path << '\n';
+	}
+
+	mbDependencyGraphDirty = false;
+	return true;
+}
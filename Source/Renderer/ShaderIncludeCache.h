@@ -0,0 +1,97 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+
+//
+// SHADER INCLUDE CACHE
+//
+// Shared in-memory cache of shader source files (main sources & includes) for the shader load workers:
+// each file is read once and handed to the compilers through their include handlers.
+//
+// Also keeps the dependency graph of the cached shader binaries: shader key -> files (+ content hashes) the
+// binary was compiled from, and the reverse edges file -> shader keys. A shader key identifies a cached binary,
+// e.g. its cache file path. The graph is persisted next to
+// the shader cache so that a changed header invalidates exactly the shaders that include it.
+//
+class ShaderIncludeCache
+{
+public:
+	struct FFile
+	{
+		std::string                     Path; // normalized
+		std::string                     Contents;
+		uint64                          ContentHash = 0;
+		std::filesystem::file_time_type LastWriteTime;
+	};
+
+	static std::string NormalizePath(const std::string& Path);
+	static uint64      HashContents(const void* pData, size_t Size);
+
+	// Returns the cached file, (re-)reading it if it's not cached yet or changed on disk. nullptr if the file can't be read.
+	std::shared_ptr<const FFile> GetFile(const std::string& Path);
+	
+	// Drops the cached file contents and returns the keys of the shaders that depend on the file.
+	std::vector<std::string> InvalidateFile(const std::string& Path);
+
+	// Returns the source file & the transitive #include "..." files, found by scanning the cached sources.
+	std::vector<std::string> ScanIncludes(const std::string& SourcePath);
+
+	//
+	// Dependency graph
+	//
+	// Records the files a shader binary is compiled from with their current content hashes.
+	void RecordDependencies(const std::string& ShaderKey, const std::vector<std::string>& Files);
+	void RemoveDependencies(const std::string& ShaderKey);
+
+	// Returns true if @CachePath doesn't exist or any file @ShaderKey depends on changed since the shader was compiled.
+	// Shaders without a dependency record fall back to comparing the file timestamps against @CachePath.
+	bool IsCacheDirty(const std::string& ShaderKey, const std::string& SourcePath, const std::string& CachePath);
+
+	// O(1) lookup of the shader keys that depend on @Path
+	std::vector<std::string> GetDependentShaders(const std::string& Path) const;
+
+	bool LoadDependencyGraph(const std::string& FilePath);
+	bool SaveDependencyGraph(const std::string& FilePath);
+
+private:
+	struct FDependency
+	{
+		std::string Path;
+		uint64      ContentHash;
+	};
+	void RecordDependencies_NoLock(const std::string& ShaderKey, std::vector<FDependency>&& Dependencies);
+
+private:
+	mutable std::mutex                                            mMtxFiles;
+	std::unordered_map<std::string, std::shared_ptr<const FFile>> mFiles;
+
+	mutable std::mutex                                                   mMtxDependencyGraph;
+	std::unordered_map<std::string, std::vector<FDependency>>            mShaderDependencies; // shader key -> files
+	std::unordered_map<std::string, std::unordered_set<std::string>>     mFileDependents;     // file -> shader keys
+	bool                                                                 mbDependencyGraphDirty = false;
+};
@@ -0,0 +1,207 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "ShaderPermutations.h"
+
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <fstream>
+
+//
+// SHADER PERMUTATION MANIFEST
+//
+void ShaderPermutationManifest::AddPermutationSet(FShaderPermutationSet&& Set)
+{
+	mPermutationSets.push_back(std::move(Set));
+}
+
+void ShaderPermutationManifest::AddPermutation(const FShaderStageCompileDesc& Desc)
+{
+	if (!mSinglePermutationKeys.insert(ShaderArchive::GetPermutationKey(Desc)).second)
+		return;
+
+	FShaderPermutationSet Set;
+	Set.BaseDesc = Desc;
+	mPermutationSets.push_back(std::move(Set));
+}
+
+std::vector<FShaderStageCompileDesc> ShaderPermutationManifest::EnumeratePermutations() const
+{
+	std::vector<FShaderStageCompileDesc> Permutations;
+	std::unordered_set<uint64> Keys;
+
+	for (const FShaderPermutationSet& Set : mPermutationSets)
+	{
+		// mixed-radix counter over the axis values
+		std::vector<size_t> iValues(Set.Axes.size(), 0);
+		bool bDone = false;
+		while (!bDone)
+		{
+			FShaderStageCompileDesc Desc = Set.BaseDesc;
+			for (size_t iAxis = 0; iAxis < Set.Axes.size(); ++iAxis)
+			{
+				const FShaderPermutationAxis& Axis = Set.Axes[iAxis];
+				if (Axis.Values.empty())
+					continue;
+				const std::string& Value = Axis.Values[iValues[iAxis]];
+				if (!Value.empty())
+					Desc.Macros.push_back({ Axis.MacroName, Value });
+			}
+
+			const bool bValid = std::all_of(Set.Rules.begin(), Set.Rules.end(), [&](const FShaderPermutationSet::Rule_t& fnRule) { return fnRule(Desc.Macros); });
+			if (bValid && Keys.insert(ShaderArchive::GetPermutationKey(Desc)).second)
+				Permutations.push_back(std::move(Desc));
+
+			// increment
+			bDone = true;
+			for (size_t iAxis = 0; iAxis < Set.Axes.size(); ++iAxis)
+			{
+				if (++iValues[iAxis] < Set.Axes[iAxis].Values.size())
+				{
+					bDone = false;
+					break;
+				}
+				iValues[iAxis] = 0;
+			}
+		}
+	}
+	return Permutations;
+}
+
+
+//
+// SHADER ARCHIVE
+//
+uint64 ShaderArchive::GetPermutationKey(const FShaderStageCompileDesc& Desc)
+{
+	// FNV-1a: unlike std::hash, stable across runs & builds which the archive relies on
+	const std::string key = ShaderUtils::GetShaderStageKey(Desc);
+	uint64 hash = 0xcbf29ce484222325ull;
+	for (const char c : key)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+bool ShaderArchive::Write(const std::string& FilePath, std::vector<FEntry>& Entries)
+{
+	std::sort(Entries.begin(), Entries.end(), [](const FEntry& l, const FEntry& r) { return l.Key < r.Key; });
+	Entries.erase(std::unique(Entries.begin(), Entries.end(), [](const FEntry& l, const FEntry& r) { return l.Key == r.Key; }), Entries.end());
+
+	FHeader Header = {};
+	Header.Magic = MAGIC;
+	Header.Version = VERSION;
+	Header.NumEntries = static_cast<uint32>(Entries.size());
+
+	std::vector<FIndexEntry> Index(Entries.size());
+	uint64 Offset = sizeof(FHeader) + sizeof(FIndexEntry) * Entries.size();
+	for (size_t i = 0; i < Entries.size(); ++i)
+	{
+		Index[i] = { Entries[i].Key, Offset, Entries[i].Size };
+		Offset += Entries[i].Size;
+	}
+
+	std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("ShaderArchive: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(Index.data()), sizeof(FIndexEntry) * Index.size());
+	for (const FEntry& Entry : Entries)
+		file.write(reinterpret_cast<const char*>(Entry.pData), Entry.Size);
+	file.close();
+
+	Log::Info("ShaderArchive: written %u shaders (%.2f MB) to %s", Header.NumEntries, Offset / (1024.0f * 1024.0f), FilePath.c_str());
+	return true;
+}
+
+bool ShaderArchive::Open(const std::string& FilePath)
+{
+	Close();
+
+	mhFile = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mhFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER FileSize = {};
+	if (!GetFileSizeEx(mhFile, &FileSize) || static_cast<uint64>(FileSize.QuadPart) < sizeof(FHeader))
+	{
+		Close();
+		return false;
+	}
+
+	mhMapping = CreateFileMappingA(mhFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	mpView = mhMapping ? static_cast<const char*>(MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+	if (!mpView)
+	{
+		Log::Error("ShaderArchive: couldn't map %s", FilePath.c_str());
+		Close();
+		return false;
+	}
+	mViewSize = static_cast<uint64>(FileSize.QuadPart);
+
+	const FHeader* pHeader = reinterpret_cast<const FHeader*>(mpView);
+	const bool bValidHeader = pHeader->Magic == MAGIC
+		&& pHeader->Version == VERSION
+		&& sizeof(FHeader) + sizeof(FIndexEntry) * static_cast<uint64>(pHeader->NumEntries) <= mViewSize;
+	if (!bValidHeader)
+	{
+		Log::Warning("ShaderArchive: %s is invalid or out of date, ignoring", FilePath.c_str());
+		Close();
+		return false;
+	}
+
+	mpIndex = reinterpret_cast<const FIndexEntry*>(mpView + sizeof(FHeader));
+	mNumEntries = pHeader->NumEntries;
+	mFilePath = FilePath;
+	return true;
+}
+
+void ShaderArchive::Close()
+{
+	if (mpView)                         UnmapViewOfFile(mpView);
+	if (mhMapping)                      CloseHandle(mhMapping);
+	if (mhFile != INVALID_HANDLE_VALUE) CloseHandle(mhFile);
+	mpView = nullptr;
+	mhMapping = NULL;
+	mhFile = INVALID_HANDLE_VALUE;
+	mViewSize = 0;
+	mpIndex = nullptr;
+	mNumEntries = 0;
+	mFilePath.clear();
+}
+
+bool ShaderArchive::Find(uint64 Key, const void** ppData, size_t* pSize) const
+{
+	if (!mpIndex)
+		return false;
+
+	const FIndexEntry* pEnd = mpIndex + mNumEntries;
+	const FIndexEntry* it = std::lower_bound(mpIndex, pEnd, Key, [](const FIndexEntry& e, uint64 k) { return e.Key < k; });
+	if (it == pEnd || it->Key != Key || it->Offset + it->Size > mViewSize)
+		return false;
+
+	*ppData = mpView + it->Offset;
+	*pSize = static_cast<size_t>(it->Size);
+	return true;
+}
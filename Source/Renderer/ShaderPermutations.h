@@ -0,0 +1,122 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "Shader.h"
+
+#include <functional>
+#include <unordered_set>
+
+//
+// SHADER PERMUTATION MANIFEST
+//
+// Records which variants of a shader stage exist: a permutation set is a base shader stage
+// description plus macro axes, every combination of the axis values that passes the rules
+// is a permutation.
+//
+struct FShaderPermutationAxis
+{
+	std::string MacroName;
+	std::vector<std::string> Values; // an empty value leaves the macro undefined
+};
+struct FShaderPermutationSet
+{
+	using Rule_t = std::function<bool(const std::vector<FShaderMacro>&)>;
+
+	FShaderStageCompileDesc             BaseDesc; // macros of the base desc are shared by all permutations
+	std::vector<FShaderPermutationAxis> Axes;
+	std::vector<Rule_t>                 Rules;    // a combination is valid if all the rules return true
+};
+
+class ShaderPermutationManifest
+{
+public:
+	void AddPermutationSet(FShaderPermutationSet&& Set);
+	void AddPermutation(const FShaderStageCompileDesc& Desc); // single permutation, no axes
+
+	// Returns the unique valid permutations of all the permutation sets
+	std::vector<FShaderStageCompileDesc> EnumeratePermutations() const;
+	
+	inline bool IsEmpty() const { return mPermutationSets.empty(); }
+
+private:
+	std::vector<FShaderPermutationSet> mPermutationSets;
+	std::unordered_set<uint64>         mSinglePermutationKeys;
+};
+
+
+//
+// SHADER ARCHIVE
+//
+// Packed shader binaries in a single file, memory-mapped for reading:
+//
+//  [FHeader][FIndexEntry x NumEntries, sorted by Key][shader binaries]
+//
+// Keys are ShaderArchive::GetPermutationKey() of the shader stage descriptions.
+//
+class ShaderArchive
+{
+public:
+	struct FEntry
+	{
+		uint64      Key;
+		const void* pData;
+		size_t      Size;
+	};
+
+	static uint64 GetPermutationKey(const FShaderStageCompileDesc& Desc);
+	static bool   Write(const std::string& FilePath, std::vector<FEntry>& Entries);
+
+	~ShaderArchive() { Close(); }
+
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	// Returns false if the archive doesn't contain the key. *ppData points into the mapped file.
+	bool Find(uint64 Key, const void** ppData, size_t* pSize) const;
+
+	inline bool               IsOpen()         const { return mpView != nullptr; }
+	inline uint32             GetNumEntries()  const { return mNumEntries; }
+	inline const std::string& GetFilePath()    const { return mFilePath; }
+
+private:
+	static constexpr uint32 MAGIC   = 0x41535156; // "VQSA"
+	static constexpr uint32 VERSION = 1;
+
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumEntries;
+		uint32 Reserved;
+	};
+	struct FIndexEntry
+	{
+		uint64 Key;
+		uint64 Offset; // from the beginning of the file
+		uint64 Size;
+	};
+
+	HANDLE             mhFile      = INVALID_HANDLE_VALUE;
+	HANDLE             mhMapping   = NULL;
+	const char*        mpView      = nullptr;
+	uint64             mViewSize   = 0;
+	const FIndexEntry* mpIndex     = nullptr;
+	uint32             mNumEntries = 0;
+	std::string        mFilePath;
+};
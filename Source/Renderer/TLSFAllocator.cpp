@@ -0,0 +1,288 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "TLSFAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// index of the lowest/highest set bit, Mask != 0
+static inline uint32 FindFirstSet(uint32 Mask)
+{
+	assert(Mask != 0);
+#ifdef _MSC_VER
+	unsigned long i; _BitScanForward(&i, Mask); return static_cast<uint32>(i);
+#else
+	return static_cast<uint32>(__builtin_ctz(Mask));
+#endif
+}
+static inline uint32 FindLastSet(uint32 Mask)
+{
+	assert(Mask != 0);
+#ifdef _MSC_VER
+	unsigned long i; _BitScanReverse(&i, Mask); return static_cast<uint32>(i);
+#else
+	return static_cast<uint32>(31 - __builtin_clz(Mask));
+#endif
+}
+
+void TLSFAllocator::Initialize(uint32 TotalSize, uint32 Granularity)
+{
+	assert(Granularity > 0 && (Granularity & (Granularity - 1)) == 0); // power of 2
+	mGranularity = Granularity;
+	mTotalSize = TotalSize - TotalSize % Granularity;
+	Reset();
+}
+
+void TLSFAllocator::Reset()
+{
+	mBlocks.clear();
+	mUnusedBlocks.clear();
+	mAllocatedBlocks.clear();
+	mUsedSize = 0;
+	mFLBitmap = 0;
+	for (uint32 fl = 0; fl < FL_COUNT; ++fl)
+	{
+		mSLBitmap[fl] = 0;
+		for (uint32 sl = 0; sl < SL_COUNT; ++sl)
+			mFreeHeads[fl][sl] = NULL_BLOCK;
+	}
+
+	const uint32 NumUnits = mTotalSize / mGranularity;
+	if (NumUnits > 0)
+	{
+		const uint32 iBlock = CreateBlock();
+		mBlocks[iBlock].Offset = 0;
+		mBlocks[iBlock].Size = NumUnits;
+		InsertFreeBlock(iBlock);
+	}
+}
+
+uint32 TLSFAllocator::Allocate(uint32 Size)
+{
+	if (Size == 0 || Size > mTotalSize)
+		return INVALID_OFFSET;
+
+	const uint32 NumUnits = (Size + mGranularity - 1) / mGranularity;
+
+	uint32 FL, SL;
+	MappingSearch(NumUnits, FL, SL);
+	if (FL >= FL_COUNT || !FindFreeBlock(FL, SL))
+		return INVALID_OFFSET;
+
+	const uint32 iBlock = mFreeHeads[FL][SL];
+	RemoveFreeBlock(iBlock);
+	assert(mBlocks[iBlock].Size >= NumUnits);
+
+	// split the remainder off into a new free block
+	if (mBlocks[iBlock].Size > NumUnits)
+	{
+		const uint32 iRemainder = CreateBlock(); // may reallocate mBlocks, don't hold references across
+		FBlock& Block = mBlocks[iBlock];
+		FBlock& Remainder = mBlocks[iRemainder];
+		Remainder.Offset   = Block.Offset + NumUnits;
+		Remainder.Size     = Block.Size - NumUnits;
+		Remainder.PrevPhys = iBlock;
+		Remainder.NextPhys = Block.NextPhys;
+		if (Block.NextPhys != NULL_BLOCK)
+			mBlocks[Block.NextPhys].PrevPhys = iRemainder;
+		Block.NextPhys = iRemainder;
+		Block.Size = NumUnits;
+		InsertFreeBlock(iRemainder);
+	}
+
+	FBlock& Block = mBlocks[iBlock];
+	Block.bFree = false;
+	mUsedSize += Block.Size;
+	mAllocatedBlocks[Block.Offset] = iBlock;
+	return Block.Offset * mGranularity;
+}
+
+void TLSFAllocator::Free(uint32 Offset)
+{
+	if (Offset == INVALID_OFFSET)
+		return;
+
+	auto it = mAllocatedBlocks.find(Offset / mGranularity);
+	assert(it != mAllocatedBlocks.end()); // if you hit this, the offset wasn't allocated or is already freed
+	if (it == mAllocatedBlocks.end())
+		return;
+
+	uint32 iBlock = it->second;
+	mAllocatedBlocks.erase(it);
+	mUsedSize -= mBlocks[iBlock].Size;
+
+	// merge with the previous physical block
+	const uint32 iPrev = mBlocks[iBlock].PrevPhys;
+	if (iPrev != NULL_BLOCK && mBlocks[iPrev].bFree)
+	{
+		RemoveFreeBlock(iPrev);
+		FBlock& Prev = mBlocks[iPrev];
+		Prev.Size += mBlocks[iBlock].Size;
+		Prev.NextPhys = mBlocks[iBlock].NextPhys;
+		if (Prev.NextPhys != NULL_BLOCK)
+			mBlocks[Prev.NextPhys].PrevPhys = iPrev;
+		ReleaseBlock(iBlock);
+		iBlock = iPrev;
+	}
+
+	// merge with the next physical block
+	const uint32 iNext = mBlocks[iBlock].NextPhys;
+	if (iNext != NULL_BLOCK && mBlocks[iNext].bFree)
+	{
+		RemoveFreeBlock(iNext);
+		FBlock& Block = mBlocks[iBlock];
+		Block.Size += mBlocks[iNext].Size;
+		Block.NextPhys = mBlocks[iNext].NextPhys;
+		if (Block.NextPhys != NULL_BLOCK)
+			mBlocks[Block.NextPhys].PrevPhys = iBlock;
+		ReleaseBlock(iNext);
+	}
+
+	InsertFreeBlock(iBlock);
+}
+
+TLSFAllocator::FStatistics TLSFAllocator::GetStatistics() const
+{
+	FStatistics s;
+	s.TotalSize      = mTotalSize;
+	s.UsedSize       = mUsedSize * mGranularity;
+	s.FreeSize       = mTotalSize - s.UsedSize;
+	s.NumAllocations = static_cast<uint32>(mAllocatedBlocks.size());
+	s.NumFreeBlocks  = static_cast<uint32>(mBlocks.size() - mUnusedBlocks.size() - mAllocatedBlocks.size());
+
+	// the largest free block is in the highest non-empty bin
+	if (mFLBitmap != 0)
+	{
+		const uint32 FL = FindLastSet(mFLBitmap);
+		const uint32 SL = FindLastSet(mSLBitmap[FL]);
+		for (uint32 iBlock = mFreeHeads[FL][SL]; iBlock != NULL_BLOCK; iBlock = mBlocks[iBlock].NextFree)
+			s.LargestFreeBlock = std::max(s.LargestFreeBlock, mBlocks[iBlock].Size * mGranularity);
+	}
+
+	s.Fragmentation = s.FreeSize > 0 ? 1.0f - static_cast<float>(s.LargestFreeBlock) / s.FreeSize : 0.0f;
+	return s;
+}
+
+void TLSFAllocator::MappingInsert(uint32 Size, uint32& FL, uint32& SL)
+{
+	if (Size < SL_COUNT)
+	{
+		FL = 0;
+		SL = Size;
+	}
+	else
+	{
+		const uint32 Log2 = FindLastSet(Size);
+		SL = (Size >> (Log2 - SL_LOG2)) ^ SL_COUNT;
+		FL = Log2 - SL_LOG2 + 1;
+	}
+}
+
+void TLSFAllocator::MappingSearch(uint32 Size, uint32& FL, uint32& SL)
+{
+	// round up to the next bin so that any block in the resulting bin fits
+	if (Size >= SL_COUNT)
+	{
+		const uint32 Round = (1u << (FindLastSet(Size) - SL_LOG2)) - 1;
+		if (Size > 0xFFFFFFFF - Round)
+		{
+			FL = FL_COUNT;
+			return;
+		}
+		Size += Round;
+	}
+	MappingInsert(Size, FL, SL);
+}
+
+bool TLSFAllocator::FindFreeBlock(uint32& FL, uint32& SL) const
+{
+	uint32 SLMap = mSLBitmap[FL] & (~0u << SL);
+	if (SLMap == 0)
+	{
+		const uint32 FLMap = FL + 1 < 32 ? (mFLBitmap & (~0u << (FL + 1))) : 0;
+		if (FLMap == 0)
+			return false;
+		FL = FindFirstSet(FLMap);
+		SLMap = mSLBitmap[FL];
+	}
+	SL = FindFirstSet(SLMap);
+	return true;
+}
+
+void TLSFAllocator::InsertFreeBlock(uint32 iBlock)
+{
+	uint32 FL, SL;
+	MappingInsert(mBlocks[iBlock].Size, FL, SL);
+
+	FBlock& Block = mBlocks[iBlock];
+	Block.bFree = true;
+	Block.PrevFree = NULL_BLOCK;
+	Block.NextFree = mFreeHeads[FL][SL];
+	if (Block.NextFree != NULL_BLOCK)
+		mBlocks[Block.NextFree].PrevFree = iBlock;
+	mFreeHeads[FL][SL] = iBlock;
+
+	mFLBitmap     |= 1u << FL;
+	mSLBitmap[FL] |= 1u << SL;
+}
+
+void TLSFAllocator::RemoveFreeBlock(uint32 iBlock)
+{
+	uint32 FL, SL;
+	MappingInsert(mBlocks[iBlock].Size, FL, SL);
+
+	FBlock& Block = mBlocks[iBlock];
+	if (Block.PrevFree != NULL_BLOCK) mBlocks[Block.PrevFree].NextFree = Block.NextFree;
+	if (Block.NextFree != NULL_BLOCK) mBlocks[Block.NextFree].PrevFree = Block.PrevFree;
+	if (mFreeHeads[FL][SL] == iBlock)
+	{
+		mFreeHeads[FL][SL] = Block.NextFree;
+		if (mFreeHeads[FL][SL] == NULL_BLOCK)
+		{
+			mSLBitmap[FL] &= ~(1u << SL);
+			if (mSLBitmap[FL] == 0)
+				mFLBitmap &= ~(1u << FL);
+		}
+	}
+	Block.bFree = false;
+	Block.PrevFree = Block.NextFree = NULL_BLOCK;
+}
+
+uint32 TLSFAllocator::CreateBlock()
+{
+	if (!mUnusedBlocks.empty())
+	{
+		const uint32 iBlock = mUnusedBlocks.back();
+		mUnusedBlocks.pop_back();
+		mBlocks[iBlock] = FBlock{};
+		return iBlock;
+	}
+	mBlocks.push_back(FBlock{});
+	return static_cast<uint32>(mBlocks.size() - 1);
+}
+
+void TLSFAllocator::ReleaseBlock(uint32 iBlock)
+{
+	mBlocks[iBlock] = FBlock{};
+	mUnusedBlocks.push_back(iBlock);
+}
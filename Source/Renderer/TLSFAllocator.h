@@ -0,0 +1,102 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <unordered_map>
+#include <vector>
+
+//
+// TLSF ALLOCATOR
+//
+// Two-Level Segregated Fit range allocator (Masmano et al.) for sub-allocating GPU buffer pages.
+// Only deals with offsets & sizes so it doesn't depend on any D3D12 type.
+//
+// - Free blocks are binned by a first level (floor(log2(size))) and a linearly subdivided second
+//   level; two bitmaps make finding a fitting bin O(1).
+// - Freed blocks are merged with their free physical neighbors.
+// - All sizes & offsets are rounded up to the granularity given at initialization.
+//
+class TLSFAllocator
+{
+public:
+	static constexpr uint32 INVALID_OFFSET = 0xFFFFFFFF;
+
+	struct FStatistics
+	{
+		uint32 TotalSize        = 0;
+		uint32 UsedSize         = 0;
+		uint32 FreeSize         = 0;
+		uint32 LargestFreeBlock = 0;
+		uint32 NumAllocations   = 0;
+		uint32 NumFreeBlocks    = 0;
+		float  Fragmentation    = 0.0f; // [0, 1] : 1 - largest free block / total free
+	};
+
+public:
+	void   Initialize(uint32 TotalSize, uint32 Granularity);
+	void   Reset();
+
+	// Returns the offset of the allocation, or INVALID_OFFSET if there's no free block large enough.
+	uint32 Allocate(uint32 Size);
+	void   Free(uint32 Offset);
+
+	FStatistics   GetStatistics() const;
+	inline uint32 GetTotalSize() const { return mTotalSize; }
+	inline bool   IsEmpty()      const { return mAllocatedBlocks.empty(); }
+
+private:
+	static constexpr uint32 SL_LOG2   = 4;
+	static constexpr uint32 SL_COUNT  = 1u << SL_LOG2;
+	static constexpr uint32 FL_COUNT  = 32 - SL_LOG2 + 1;
+	static constexpr uint32 NULL_BLOCK = 0xFFFFFFFF;
+
+	struct FBlock
+	{
+		uint32 Offset   = 0; // in granularity units
+		uint32 Size     = 0; // in granularity units
+		uint32 PrevPhys = NULL_BLOCK;
+		uint32 NextPhys = NULL_BLOCK;
+		uint32 PrevFree = NULL_BLOCK;
+		uint32 NextFree = NULL_BLOCK;
+		bool   bFree    = false;
+	};
+
+	static void MappingInsert(uint32 Size, uint32& FL, uint32& SL);
+	static void MappingSearch(uint32 Size, uint32& FL, uint32& SL);
+
+	bool   FindFreeBlock(uint32& FL, uint32& SL) const;
+	void   InsertFreeBlock(uint32 iBlock);
+	void   RemoveFreeBlock(uint32 iBlock);
+	uint32 CreateBlock();
+	void   ReleaseBlock(uint32 iBlock);
+
+private:
+	uint32 mTotalSize   = 0; // in bytes
+	uint32 mGranularity = 1;
+	uint32 mUsedSize    = 0; // in granularity units
+
+	uint32 mFLBitmap = 0;
+	uint32 mSLBitmap[FL_COUNT] = {};
+	uint32 mFreeHeads[FL_COUNT][SL_COUNT];
+
+	std::vector<FBlock>                mBlocks;
+	std::vector<uint32>                mUnusedBlocks;
+	std::unordered_map<uint32, uint32> mAllocatedBlocks; // offset in units -> block index
+};
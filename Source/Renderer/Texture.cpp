@@ -48,6 +48,7 @@ Texture::Texture(const Texture& other)
     , mWidth                 (other.mWidth         )
     , mHeight                (other.mHeight        )
     , mNumArraySlices        (other.mNumArraySlices)
+    , mMostDetailedResidentMip(other.mMostDetailedResidentMip)
 {}
 
 Texture& Texture::operator=(const Texture& other)
@@ -63,6 +64,7 @@ Texture& Texture::operator=(const Texture& other)
     mWidth                  = other.mWidth;
     mHeight                 = other.mHeight;
     mNumArraySlices         = other.mNumArraySlices;
+    mMostDetailedResidentMip = other.mMostDetailedResidentMip;
     
     return *this;
 }
@@ -114,6 +114,7 @@ private:
 	int  mWidth = 0;
 	int  mHeight = 0;
 	int  mNumArraySlices = 1;
+	int  mMostDetailedResidentMip = 0; // the resource only holds the mips [mMostDetailedResidentMip, mMipMapCount), see TextureResidencyManager
 
 	DXGI_FORMAT mFormat = DXGI_FORMAT_UNKNOWN;
 };
@@ -0,0 +1,304 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "TextureResidency.h"
+
+#include "../../Libs/VQUtils/Source/Log.h"
+
+#include <algorithm>
+#include <fstream>
+
+//
+// VISIBILITY TRACE
+//
+void FTextureVisibilityTrace::AddFrame(const std::vector<TextureID>& FrameUsedTextures)
+{
+	if (FrameOffsets.empty())
+		FrameOffsets.push_back(0);
+	UsedTextures.insert(UsedTextures.end(), FrameUsedTextures.begin(), FrameUsedTextures.end());
+	FrameOffsets.push_back(static_cast<uint32>(UsedTextures.size()));
+}
+
+void FTextureVisibilityTrace::Clear()
+{
+	Textures.clear();
+	FrameOffsets.clear();
+	UsedTextures.clear();
+}
+
+bool FTextureVisibilityTrace::Save(const std::string& FilePath) const
+{
+	std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		Log::Error("TextureVisibilityTrace: couldn't open %s for writing", FilePath.c_str());
+		return false;
+	}
+
+	const FHeader Header = { MAGIC, VERSION, static_cast<unsigned>(Textures.size()), static_cast<unsigned>(FrameOffsets.size()), static_cast<unsigned>(UsedTextures.size()) };
+	file.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(Textures.data()), sizeof(FTexture) * Textures.size());
+	file.write(reinterpret_cast<const char*>(FrameOffsets.data()), sizeof(uint32) * FrameOffsets.size());
+	file.write(reinterpret_cast<const char*>(UsedTextures.data()), sizeof(TextureID) * UsedTextures.size());
+	return file.good();
+}
+
+bool FTextureVisibilityTrace::Load(const std::string& FilePath)
+{
+	std::ifstream file(FilePath, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		Log::Error("TextureVisibilityTrace: couldn't open %s", FilePath.c_str());
+		return false;
+	}
+
+	FHeader Header = {};
+	file.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+	if (!file.good() || Header.Magic != MAGIC || Header.Version != VERSION)
+	{
+		Log::Error("TextureVisibilityTrace: %s is not a valid texture visibility trace file", FilePath.c_str());
+		return false;
+	}
+
+	FTextureVisibilityTrace Trace;
+	Trace.Textures.resize(Header.NumTextures);
+	Trace.FrameOffsets.resize(Header.NumFrameOffsets);
+	Trace.UsedTextures.resize(Header.NumUsedTextures);
+	file.read(reinterpret_cast<char*>(Trace.Textures.data()), sizeof(FTexture) * Trace.Textures.size());
+	file.read(reinterpret_cast<char*>(Trace.FrameOffsets.data()), sizeof(uint32) * Trace.FrameOffsets.size());
+	file.read(reinterpret_cast<char*>(Trace.UsedTextures.data()), sizeof(TextureID) * Trace.UsedTextures.size());
+	if (!file.good())
+	{
+		Log::Error("TextureVisibilityTrace: %s is truncated", FilePath.c_str());
+		return false;
+	}
+
+	// offsets have to be increasing & within the used textures
+	uint32 PrevOffset = 0;
+	for (uint32 Offset : Trace.FrameOffsets)
+	{
+		if (Offset < PrevOffset || Offset > Header.NumUsedTextures)
+		{
+			Log::Error("TextureVisibilityTrace: %s has invalid frame offsets", FilePath.c_str());
+			return false;
+		}
+		PrevOffset = Offset;
+	}
+
+	*this = std::move(Trace);
+	return true;
+}
+
+
+//
+// TEXTURE RESIDENCY MANAGER
+//
+void TextureResidencyManager::Initialize(const FBudget& Budget)
+{
+	mBudget = Budget;
+	Reset();
+}
+
+void TextureResidencyManager::Reset()
+{
+	mTextures.clear();
+	mChanges.clear();
+	mStats = {};
+}
+
+void TextureResidencyManager::Register(TextureID ID, uint32 Width, uint32 Height, uint32 NumMips, uint32 BytesPerPixel)
+{
+	if (IsRegistered(ID))
+	{
+		Log::Warning("TextureResidencyManager: texture %d is already registered, re-registering", ID);
+		Unregister(ID);
+	}
+
+	FTexture t;
+	t.Width         = std::max(Width, 1u);
+	t.Height        = std::max(Height, 1u);
+	t.NumMips       = std::max(NumMips, 1u);
+	t.BytesPerPixel = BytesPerPixel;
+	t.ResidentBytes = GetResidentBytes(t, 0);
+	mTextures[ID] = t;
+
+	++mStats.NumTextures;
+	mStats.ResidentBytes      += t.ResidentBytes;
+	mStats.FullyResidentBytes += t.ResidentBytes;
+}
+
+void TextureResidencyManager::Unregister(TextureID ID)
+{
+	auto it = mTextures.find(ID);
+	if (it == mTextures.end())
+		return;
+
+	--mStats.NumTextures;
+	mStats.ResidentBytes      -= it->second.ResidentBytes;
+	mStats.FullyResidentBytes -= GetResidentBytes(it->second, 0);
+	mTextures.erase(it);
+}
+
+void TextureResidencyManager::MarkUsed(TextureID ID, uint64 Frame)
+{
+	auto it = mTextures.find(ID);
+	if (it != mTextures.end())
+		it->second.LastUsedFrame = std::max(it->second.LastUsedFrame, Frame);
+}
+
+uint32 TextureResidencyManager::GetMostDetailedResidentMip(TextureID ID) const
+{
+	auto it = mTextures.find(ID);
+	return it == mTextures.end() ? 0 : it->second.MostDetailedMip;
+}
+
+TextureResidencyManager::FStatistics TextureResidencyManager::GetStatistics() const
+{
+	FStatistics s = mStats;
+	s.ThrashRate = s.NumTotalRestoredMips > 0 ? static_cast<float>(s.NumTotalThrashedMips) / s.NumTotalRestoredMips : 0.0f;
+	return s;
+}
+
+uint64 TextureResidencyManager::CalculateMipSize(uint32 Width, uint32 Height, uint32 BytesPerPixel, uint32 Mip)
+{
+	const uint64 MipWidth  = std::max(Width  >> Mip, 1u);
+	const uint64 MipHeight = std::max(Height >> Mip, 1u);
+	return MipWidth * MipHeight * BytesPerPixel;
+}
+
+uint32 TextureResidencyManager::GetMaxEvictableMip(const FTexture& t) const
+{
+	return t.NumMips - std::min(t.NumMips, std::max(mBudget.MinResidentMips, 1u));
+}
+
+uint64 TextureResidencyManager::GetResidentBytes(const FTexture& t, uint32 MostDetailedMip) const
+{
+	uint64 Bytes = 0;
+	for (uint32 Mip = MostDetailedMip; Mip < t.NumMips; ++Mip)
+		Bytes += GetMipSize(t, Mip);
+	return Bytes;
+}
+
+const std::vector<TextureResidencyManager::FResidencyChange>& TextureResidencyManager::Update(uint64 Frame)
+{
+	// per-frame stats
+	mStats.NumEvictedMips  = 0;
+	mStats.NumRestoredMips = 0;
+	mStats.EvictedBytes    = 0;
+	mStats.RestoredBytes   = 0;
+	mChanges.clear();
+
+	RestoreUsedTextures(Frame);
+	EvictLeastRecentlyUsedTextures(Frame);
+
+	for (auto& it : mTextures)
+	{
+		if (!it.second.bChanged)
+			continue;
+		mChanges.push_back({ it.first, it.second.MostDetailedMip });
+		it.second.bChanged = false;
+	}
+	return mChanges;
+}
+
+void TextureResidencyManager::RestoreUsedTextures(uint64 Frame)
+{
+	// the restored mips have to fit in the budget once the textures not used in this frame are evicted
+	uint64 EvictableBytes = 0;
+	mScratch.clear();
+	for (TextureIterator_t it = mTextures.begin(); it != mTextures.end(); ++it)
+	{
+		const FTexture& t = it->second;
+		if (t.LastUsedFrame == Frame)
+		{
+			if (t.MostDetailedMip > 0)
+				mScratch.push_back(it);
+		}
+		else if (t.MostDetailedMip < GetMaxEvictableMip(t))
+		{
+			EvictableBytes += t.ResidentBytes - GetResidentBytes(t, GetMaxEvictableMip(t));
+		}
+	}
+	const uint64 MaxResidentBytes = mBudget.MaxResidentBytes > ~0ull - EvictableBytes ? ~0ull : mBudget.MaxResidentBytes + EvictableBytes;
+
+	// one mip level at a time so the used textures sharpen evenly
+	bool bRestored = true;
+	while (bRestored)
+	{
+		bRestored = false;
+		for (TextureIterator_t it : mScratch)
+		{
+			FTexture& t = it->second;
+			if (t.MostDetailedMip == 0)
+				continue;
+
+			const uint64 MipSize = GetMipSize(t, t.MostDetailedMip - 1);
+			if (mStats.NumRestoredMips > 0 && mStats.RestoredBytes + MipSize > mBudget.MaxRestoreBytesPerFrame)
+				continue;
+			if (mStats.ResidentBytes + MipSize > MaxResidentBytes)
+				continue;
+
+			if (t.bEvicted && Frame - t.LastEvictedFrame <= mBudget.ThrashWindowFrames)
+				++mStats.NumTotalThrashedMips;
+
+			--t.MostDetailedMip;
+			t.ResidentBytes += MipSize;
+			t.bChanged = true;
+			mStats.ResidentBytes += MipSize;
+			mStats.RestoredBytes += MipSize;
+			++mStats.NumRestoredMips;
+			++mStats.NumTotalRestoredMips;
+			bRestored = true;
+		}
+	}
+}
+
+void TextureResidencyManager::EvictLeastRecentlyUsedTextures(uint64 Frame)
+{
+	if (mStats.ResidentBytes <= mBudget.MaxResidentBytes)
+		return;
+
+	mScratch.clear();
+	for (TextureIterator_t it = mTextures.begin(); it != mTextures.end(); ++it)
+		if (it->second.MostDetailedMip < GetMaxEvictableMip(it->second))
+			mScratch.push_back(it);
+
+	// stable: ties stay in ID order
+	std::stable_sort(mScratch.begin(), mScratch.end(), [](const TextureIterator_t& l, const TextureIterator_t& r) { return l->second.LastUsedFrame < r->second.LastUsedFrame; });
+
+	for (TextureIterator_t it : mScratch)
+	{
+		FTexture& t = it->second;
+		const uint32 MaxEvictableMip = GetMaxEvictableMip(t);
+		while (t.MostDetailedMip < MaxEvictableMip && mStats.ResidentBytes > mBudget.MaxResidentBytes)
+		{
+			const uint64 MipSize = GetMipSize(t, t.MostDetailedMip);
+			++t.MostDetailedMip;
+			t.ResidentBytes -= MipSize;
+			t.LastEvictedFrame = Frame;
+			t.bEvicted = true;
+			t.bChanged = true;
+			mStats.ResidentBytes -= MipSize;
+			mStats.EvictedBytes  += MipSize;
+			++mStats.NumEvictedMips;
+			++mStats.NumTotalEvictedMips;
+		}
+		if (mStats.ResidentBytes <= mBudget.MaxResidentBytes)
+			break;
+	}
+}
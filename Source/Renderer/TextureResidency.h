@@ -0,0 +1,162 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+#pragma once
+
+#include "../Engine/Core/Types.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Textures used by the visible materials each frame. Recorded by the renderer and
+// replayed through a TextureResidencyManager to tune the budget offline, see Tests/TextureResidencyTests.cpp.
+struct FTextureVisibilityTrace
+{
+	struct FTexture
+	{
+		TextureID ID            = INVALID_ID;
+		uint32    Width         = 0;
+		uint32    Height        = 0;
+		uint32    NumMips       = 1;
+		uint32    BytesPerPixel = 4;
+	};
+	std::vector<FTexture>  Textures;
+	std::vector<uint32>    FrameOffsets; // [iFrame, iFrame+1) range of each frame in UsedTextures
+	std::vector<TextureID> UsedTextures;
+
+	inline uint32 GetNumFrames() const { return FrameOffsets.empty() ? 0 : static_cast<uint32>(FrameOffsets.size() - 1); }
+	void AddFrame(const std::vector<TextureID>& FrameUsedTextures);
+	void Clear();
+
+	// Binary file: [FHeader][FTexture x NumTextures][uint32 x NumFrames+1][TextureID x NumUsedTextures]
+	bool Save(const std::string& FilePath) const;
+	bool Load(const std::string& FilePath);
+
+private:
+	static constexpr unsigned MAGIC   = 0x54545156; // "VQTT"
+	static constexpr unsigned VERSION = 1;
+	struct FHeader
+	{
+		unsigned Magic;
+		unsigned Version;
+		unsigned NumTextures;
+		unsigned NumFrameOffsets;
+		unsigned NumUsedTextures;
+	};
+};
+
+//
+// TEXTURE RESIDENCY MANAGER
+//
+// Keeps the resident texture memory under a budget by dropping the most detailed mip levels
+// of the least recently used textures and restores them when the textures are used again.
+// Only does the accounting & the policy, doesn't depend on any D3D12 type: the renderer
+// reallocates the textures w/ their resident mip levels only, see VQRenderer::UpdateTextureResidency().
+//
+// - Textures are fully resident when registered. MarkUsed() is fed w/ the textures of the
+//   visible materials before Update() is called for the frame.
+// - Update() first restores the textures used in the frame one mip level at a time, round robin
+//   in ID order, within the restore budget and only if the budget can be held by evicting the
+//   textures that weren't used in the frame. Then, while over the budget, drops the top mips of
+//   the least recently used texture (ties: lower ID first) down to MinResidentMips before moving
+//   on to the next one.
+// - Restoring a mip level within ThrashWindowFrames of an eviction counts as thrash.
+// - Doesn't measure time and only iterates ordered containers, so it is deterministic for a
+//   given sequence of calls.
+//
+class TextureResidencyManager
+{
+public:
+	struct FBudget
+	{
+		uint64 MaxResidentBytes        = ~0ull;
+		uint64 MaxRestoreBytesPerFrame = 64ull << 20; // the first restored mip of a frame is always allowed
+		uint32 MinResidentMips         = 1;           // the mip tail that's never evicted
+		uint32 ThrashWindowFrames      = 60;
+	};
+	struct FStatistics
+	{
+		uint32 NumTextures          = 0;
+		uint64 ResidentBytes        = 0;
+		uint64 FullyResidentBytes   = 0; // if all mips of all textures were resident
+
+		// last Update()
+		uint32 NumEvictedMips       = 0;
+		uint32 NumRestoredMips      = 0;
+		uint64 EvictedBytes         = 0;
+		uint64 RestoredBytes        = 0;
+
+		uint64 NumTotalEvictedMips  = 0;
+		uint64 NumTotalRestoredMips = 0;
+		uint64 NumTotalThrashedMips = 0;
+		float  ThrashRate           = 0.0f; // [0, 1] : thrashed / restored mips
+	};
+	struct FResidencyChange
+	{
+		TextureID ID;
+		uint32    MostDetailedMip;
+	};
+
+public:
+	void Initialize(const FBudget& Budget);
+	void Reset();
+
+	void Register(TextureID ID, uint32 Width, uint32 Height, uint32 NumMips, uint32 BytesPerPixel);
+	void Unregister(TextureID ID);
+	void MarkUsed(TextureID ID, uint64 Frame); // unregistered textures are ignored
+
+	// Returns the textures whose resident mips changed, in ID order.
+	const std::vector<FResidencyChange>& Update(uint64 Frame);
+
+	inline bool  IsRegistered(TextureID ID) const { return mTextures.find(ID) != mTextures.end(); }
+	uint32       GetMostDetailedResidentMip(TextureID ID) const;
+	FStatistics  GetStatistics() const;
+	inline const FBudget& GetBudget() const { return mBudget; }
+	inline void  SetBudget(const FBudget& Budget) { mBudget = Budget; }
+
+	static uint64 CalculateMipSize(uint32 Width, uint32 Height, uint32 BytesPerPixel, uint32 Mip);
+
+private:
+	struct FTexture
+	{
+		uint32 Width            = 0;
+		uint32 Height           = 0;
+		uint32 NumMips          = 1;
+		uint32 BytesPerPixel    = 4;
+		uint32 MostDetailedMip  = 0; // resident mips: [MostDetailedMip, NumMips)
+		uint64 ResidentBytes    = 0;
+		uint64 LastUsedFrame    = 0;
+		uint64 LastEvictedFrame = 0;
+		bool   bEvicted         = false;
+		bool   bChanged         = false;
+	};
+	using TextureIterator_t = std::map<TextureID, FTexture>::iterator;
+
+	void   RestoreUsedTextures(uint64 Frame);
+	void   EvictLeastRecentlyUsedTextures(uint64 Frame);
+	uint32 GetMaxEvictableMip(const FTexture& t) const; // NumMips - MinResidentMips
+	uint64 GetResidentBytes(const FTexture& t, uint32 MostDetailedMip) const;
+	inline uint64 GetMipSize(const FTexture& t, uint32 Mip) const { return CalculateMipSize(t.Width, t.Height, t.BytesPerPixel, Mip); }
+
+private:
+	FBudget                        mBudget;
+	std::map<TextureID, FTexture>  mTextures;
+	std::vector<FResidencyChange>  mChanges;
+	std::vector<TextureIterator_t> mScratch;
+	FStatistics                    mStats;
+};
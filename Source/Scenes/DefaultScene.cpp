@@ -21,7 +21,7 @@ void DefaultScene::UpdateScene(float dt, FSceneView& SceneView)
 	Camera& cam = mCameras[mIndex_SelectedCamera];
 
 	// handle input
-	if (mInput.IsKeyTriggered('R'))
+	if (mInput.IsActionTriggered(mInputActions.ResetCamera))
 	{
 		FCameraParameters params = mSceneRepresentation.Cameras[mIndex_SelectedCamera];
 		params.ProjectionParams.ViewportWidth  = static_cast<float>(mpWindow->GetWidth() );
@@ -29,7 +29,7 @@ void DefaultScene::UpdateScene(float dt, FSceneView& SceneView)
 		cam.InitializeCamera(params);
 	}
 
-	if (mInput.IsKeyTriggered("Space")) Toggle(this->bObjectAnimation);
+	if (mInput.IsActionTriggered(mInputActions.ToggleAnimation)) Toggle(this->bObjectAnimation);
 
 	Transform* pTF = mpTransforms[pObject->mTransformID];
 
@@ -6,10 +6,10 @@ using namespace DirectX;
 
 void EnvironmentMapUnitTestScene::UpdateScene(float dt, FSceneView& SceneView)
 {
-	if (mInput.IsKeyTriggered("Space"))
+	if (mInput.IsActionTriggered(mInputActions.ToggleAnimation))
 		bAnimateCamera = !bAnimateCamera;
 
-	if (mInput.IsKeyTriggered("L"))
+	if (mInput.IsActionTriggered(mInputActions.LookAtOrigin))
 		this->mCameras[this->mIndex_SelectedCamera].LookAt(XMFLOAT3(0, 0, 0));
 
 	if (bAnimateCamera)
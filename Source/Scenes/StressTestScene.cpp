@@ -31,7 +31,7 @@ static const std::array< XMFLOAT3, NUM_RND_COLORS> Colors =
 
 void StressTestScene::UpdateScene(float dt, FSceneView& SceneView)
 {
-	if (mInput.IsKeyTriggered("Space"))
+	if (mInput.IsActionTriggered(mInputActions.ToggleAnimation))
 		bAnimateEnvironmentMapRotation = !bAnimateEnvironmentMapRotation;
 
 	constexpr float HDRI_ROTATION_SPEED = 0.01f;
@@ -0,0 +1,306 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/AssetStreaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+	// completes the loads after a latency proportional to the asset size, logs every call
+	struct FFakeStreamingBackend : public FAssetStreamingBackend
+	{
+		static constexpr uint32 NOT_FINALIZED = 0xFFFFFFFF;
+
+		uint32                  Frame = 0;
+		uint64                  BytesPerFrame = 8ull << 20; // simulated disk bandwidth
+		std::vector<uint64>     AssetSizes;                 // indexed by AssetRequestID: requested in asset order
+		std::vector<uint32>     FinalizedFrames;
+		std::vector<uint32>     CompletionFrames;
+		std::vector<uint64>     Events;
+		float                   LastFinalizeMs = 0.0f;
+
+		enum EEvent : uint64 { BEGIN_LOAD = 0, FINALIZE, CANCEL };
+		void Log(EEvent e, AssetRequestID ID) { Events.push_back((uint64(Frame) << 32) | (uint64(e) << 30) | ID); }
+		uint32 Count(EEvent e) const { return static_cast<uint32>(std::count_if(Events.begin(), Events.end(), [e](uint64 v) { return ((v >> 30) & 3) == e; })); }
+
+		void Resize(size_t NumAssets)
+		{
+			AssetSizes.resize(NumAssets, 1ull << 20);
+			FinalizedFrames.assign(NumAssets, NOT_FINALIZED);
+			CompletionFrames.assign(NumAssets, 0);
+		}
+
+		void BeginLoad(AssetRequestID ID, const std::string&) override
+		{
+			CompletionFrames[ID] = Frame + 1 + static_cast<uint32>(AssetSizes[ID] / BytesPerFrame);
+			Log(BEGIN_LOAD, ID);
+		}
+		bool IsLoaded(AssetRequestID ID) override { return Frame >= CompletionFrames[ID]; }
+		float Finalize(AssetRequestID ID) override
+		{
+			FinalizedFrames[ID] = Frame;
+			LastFinalizeMs = 0.25f + 0.05f * static_cast<float>(AssetSizes[ID] >> 20);
+			Log(FINALIZE, ID);
+			return LastFinalizeMs;
+		}
+		void Cancel(AssetRequestID ID) override { Log(CANCEL, ID); }
+	};
+
+	// objects along a corridor the camera flies through, instances of an asset are clustered around its center
+	struct FCorridorScene
+	{
+		static constexpr uint32 NUM_PATH_FRAMES = 600;
+		static constexpr float  CORRIDOR_LENGTH = 4000.0f;
+		static constexpr float  NEAR_DISTANCE   = 150.0f;
+		static constexpr uint32 CANCEL_FRAME    = NUM_PATH_FRAMES / 4;
+		static constexpr uint32 CANCEL_STRIDE   = 16;
+
+		uint32 NumObjects;
+		uint32 NumAssets;
+		std::vector<uint64>                         AssetSizes;
+		std::vector<DirectX::XMFLOAT4>              Objects;
+		std::vector<uint32>                         ObjectAssets;
+		std::vector<std::vector<DirectX::XMFLOAT4>> AssetInstances;
+
+		FCorridorScene(uint32 NumObjects) : NumObjects(NumObjects), NumAssets(std::max(1u, NumObjects / 8))
+		{
+			std::mt19937 rng(1234);
+			std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+			std::vector<DirectX::XMFLOAT3> AssetCenters(NumAssets);
+			AssetSizes.resize(NumAssets);
+			Objects.resize(NumObjects);
+			ObjectAssets.resize(NumObjects);
+			AssetInstances.resize(NumAssets);
+			for (uint32 i = 0; i < NumAssets; ++i)
+			{
+				AssetSizes[i] = static_cast<uint64>((1.0f + fnUnit(rng) * 23.0f) * (1 << 20));
+				AssetCenters[i] = DirectX::XMFLOAT3(fnUnit(rng) * CORRIDOR_LENGTH, 0.0f, (fnUnit(rng) - 0.5f) * 400.0f);
+			}
+			for (uint32 i = 0; i < NumObjects; ++i)
+			{
+				const uint32 iAsset = std::uniform_int_distribution<uint32>(0, NumAssets - 1)(rng);
+				const DirectX::XMFLOAT3& c = AssetCenters[iAsset];
+				Objects[i] = DirectX::XMFLOAT4(c.x + (fnUnit(rng) - 0.5f) * 40.0f, c.y, c.z + (fnUnit(rng) - 0.5f) * 40.0f, 1.0f + fnUnit(rng) * 9.0f);
+				ObjectAssets[i] = iAsset;
+				AssetInstances[iAsset].push_back(Objects[i]);
+			}
+		}
+	};
+
+	struct FStreamingResult
+	{
+		std::vector<uint64> Events;
+		uint32 NumFrames          = 0;
+		uint32 NumPreempted       = 0;
+		uint32 NumCancelled       = 0;
+		double NearCoverage       = 0.0; // ratio of the objects near the camera w/ their asset finalized, over the camera path
+		bool   bBudgetsRespected  = true;
+		bool   bCancelsRespected  = true;
+		bool   bAllFinalized      = true;
+	};
+
+	// streams the scene along the camera path, cancels every CANCEL_STRIDE'th asset on CANCEL_FRAME
+	FStreamingResult Simulate(const FCorridorScene& Scene, const FAssetStreamingBudget& Budget, bool bPrioritize)
+	{
+		constexpr uint32 MAX_FRAMES = 100000;
+		using Scheduler_t = AssetStreamingScheduler;
+
+		FFakeStreamingBackend Backend;
+		Backend.Resize(Scene.NumAssets);
+		Backend.AssetSizes = Scene.AssetSizes;
+
+		AssetStreamingScheduler Scheduler;
+		Scheduler.Initialize(&Backend, Budget);
+		for (uint32 i = 0; i < Scene.NumAssets; ++i)
+		{
+			const AssetRequestID ID = Scheduler.Request("Asset_" + std::to_string(i), Scene.AssetSizes[i]);
+			TEST_CHECK(ID == i);
+			Scheduler.SetInstanceBounds(ID, Scene.AssetInstances[i].data(), Scene.AssetInstances[i].size());
+		}
+
+		FStreamingResult Result;
+		std::vector<bool> Cancelled(Scene.NumAssets, false);
+		uint64 NumNear = 0, NumNearFinalized = 0;
+		for (uint32 Frame = 0; Frame < MAX_FRAMES && !Scheduler.IsIdle(); ++Frame)
+		{
+			Backend.Frame = Frame;
+			if (Frame == FCorridorScene::CANCEL_FRAME)
+			{
+				for (uint32 i = 0; i < Scene.NumAssets; i += FCorridorScene::CANCEL_STRIDE)
+				{
+					Cancelled[i] = Scheduler.IsRequested(i);
+					Scheduler.Cancel(i);
+				}
+			}
+
+			// a priority-less view loads in request order
+			FAssetStreamingView View;
+			View.Position = DirectX::XMFLOAT3(FCorridorScene::CORRIDOR_LENGTH * std::min(Frame, FCorridorScene::NUM_PATH_FRAMES) / FCorridorScene::NUM_PATH_FRAMES, 10.0f, 0.0f);
+			View.ProjectionScale = bPrioritize ? 1080.0f / (2.0f * std::tan(DirectX::XM_PIDIV4 * 0.5f)) : 0.0f;
+			Scheduler.Update(View);
+
+			const Scheduler_t::FStatistics& s = Scheduler.GetStatistics();
+			Result.bBudgetsRespected = Result.bBudgetsRespected
+				&& s.NumLoadsStarted <= Budget.MaxLoadsPerFrame
+				&& s.NumRequests[Scheduler_t::LOADING] <= Budget.MaxLoadsInFlight
+				&& (s.NumLoadsStarted <= 1 || s.IOBytesStarted <= Budget.MaxIOBytesPerFrame)
+				&& (s.NumFinalized <= 1 || s.FinalizeMs - Backend.LastFinalizeMs < Budget.MaxFinalizeMsPerFrame + 1e-3f);
+
+			if (Frame < FCorridorScene::NUM_PATH_FRAMES)
+			{
+				for (uint32 i = 0; i < Scene.NumObjects; ++i)
+				{
+					const uint32 iAsset = Scene.ObjectAssets[i];
+					if (Cancelled[iAsset] || std::abs(Scene.Objects[i].x - View.Position.x) > FCorridorScene::NEAR_DISTANCE)
+						continue;
+					++NumNear;
+					NumNearFinalized += Backend.FinalizedFrames[iAsset] <= Frame ? 1 : 0;
+				}
+			}
+			Result.NumFrames = Frame + 1;
+		}
+
+		for (uint32 i = 0; i < Scene.NumAssets; ++i)
+		{
+			const bool bFinalized = Backend.FinalizedFrames[i] != FFakeStreamingBackend::NOT_FINALIZED;
+			if (Cancelled[i])
+				Result.bCancelsRespected = Result.bCancelsRespected && (!bFinalized || Backend.FinalizedFrames[i] < FCorridorScene::CANCEL_FRAME);
+			else
+				Result.bAllFinalized = Result.bAllFinalized && bFinalized;
+		}
+		Result.bAllFinalized = Result.bAllFinalized && Scheduler.IsIdle();
+		Result.NearCoverage  = NumNear > 0 ? static_cast<double>(NumNearFinalized) / NumNear : 1.0;
+		Result.NumPreempted  = Scheduler.GetStatistics().NumTotalPreempted;
+		Result.NumCancelled  = Scheduler.GetStatistics().NumTotalCancelled;
+		Result.Events        = std::move(Backend.Events);
+		return Result;
+	}
+}
+
+// the assets near the camera arrive sooner than in request order, within the budgets
+VQE_TEST(AssetStreaming_CorridorFlyThrough)
+{
+	const FCorridorScene Scene(10000);
+	const FAssetStreamingBudget Budget;
+	const FStreamingResult Prioritized  = Simulate(Scene, Budget, true);
+	const FStreamingResult RequestOrder = Simulate(Scene, Budget, false);
+
+	Test::Report("%u objects, %u assets, %u frame camera path", Scene.NumObjects, Scene.NumAssets, FCorridorScene::NUM_PATH_FRAMES);
+	Test::Report("near assets ready   : %5.1f%% prioritized, %5.1f%% request order", Prioritized.NearCoverage * 100.0, RequestOrder.NearCoverage * 100.0);
+	Test::Report("frames to stream all: %u prioritized, %u request order", Prioritized.NumFrames, RequestOrder.NumFrames);
+	Test::Report("preempted=%u cancelled=%u", Prioritized.NumPreempted, Prioritized.NumCancelled);
+
+	TEST_CHECK(Prioritized.bBudgetsRespected && RequestOrder.bBudgetsRespected);
+	TEST_CHECK(Prioritized.bCancelsRespected && RequestOrder.bCancelsRespected);
+	TEST_CHECK(Prioritized.bAllFinalized && RequestOrder.bAllFinalized);
+	TEST_CHECK(Prioritized.NearCoverage > RequestOrder.NearCoverage);
+	TEST_CHECK(RequestOrder.NumPreempted == 0); // all priorities are 0 w/o a projection
+}
+
+// the same views & backend responses give the same sequence of backend calls
+VQE_TEST(AssetStreaming_Deterministic)
+{
+	const FCorridorScene Scene(4000);
+	const FAssetStreamingBudget Budget;
+	const FStreamingResult a = Simulate(Scene, Budget, true);
+	const FStreamingResult b = Simulate(Scene, Budget, true);
+	TEST_CHECK(!a.Events.empty() && a.Events == b.Events);
+}
+
+// requests are unique per path, cancels & preemptions tell the backend about the in-flight loads
+VQE_TEST(AssetStreaming_RequestsCancelsPreemption)
+{
+	FFakeStreamingBackend Backend;
+	Backend.Resize(8);
+	Backend.AssetSizes.assign(8, 64ull << 20); // 9 frames per load
+
+	FAssetStreamingBudget Budget;
+	Budget.MaxLoadsInFlight = 2;
+	Budget.MaxLoadsPerFrame = 2;
+	Budget.MaxIOBytesPerFrame = 1ull << 30;
+
+	AssetStreamingScheduler Scheduler;
+	Scheduler.Initialize(&Backend, Budget);
+
+	const DirectX::XMFLOAT4 Far  = DirectX::XMFLOAT4(1000.0f, 0.0f, 0.0f, 1.0f);
+	const DirectX::XMFLOAT4 Near = DirectX::XMFLOAT4(10.0f, 0.0f, 0.0f, 5.0f);
+	const AssetRequestID a = Scheduler.Request("a", Backend.AssetSizes[0]);
+	const AssetRequestID b = Scheduler.Request("b", Backend.AssetSizes[1]);
+	TEST_CHECK(Scheduler.Request("a", 0) == a);
+	Scheduler.SetInstanceBounds(a, &Far, 1);
+	Scheduler.SetInstanceBounds(b, &Far, 1);
+
+	FAssetStreamingView View;
+	View.ProjectionScale = 1000.0f;
+	Scheduler.Update(View);
+	TEST_CHECK(Scheduler.GetState(a) == AssetStreamingScheduler::LOADING && Scheduler.GetState(b) == AssetStreamingScheduler::LOADING);
+	TEST_CHECK(std::abs(Scheduler.GetPriority(a) - 1.0f) < 1e-4f);
+
+	// a request covering 500x more of the screen preempts an in-flight load
+	const AssetRequestID c = Scheduler.Request("c", Backend.AssetSizes[2]);
+	Scheduler.SetInstanceBounds(c, &Near, 1);
+	Backend.Frame = 1;
+	Scheduler.Update(View);
+	TEST_CHECK(Scheduler.GetStatistics().NumTotalPreempted == 1);
+	TEST_CHECK(Scheduler.GetState(c) == AssetStreamingScheduler::LOADING);
+	TEST_CHECK(Scheduler.GetStatistics().NumRequests[AssetStreamingScheduler::LOADING] == 2);
+	TEST_CHECK(Backend.Count(FFakeStreamingBackend::CANCEL) == 1);
+
+	// cancelling an in-flight load tells the backend, a pending one doesn't
+	const AssetRequestID Pending = Scheduler.GetState(a) == AssetStreamingScheduler::PENDING ? a : b;
+	const AssetRequestID Loading = Pending == a ? b : a;
+	Scheduler.Cancel(Pending);
+	TEST_CHECK(Backend.Count(FFakeStreamingBackend::CANCEL) == 1 && !Scheduler.IsRequested(Pending));
+	Scheduler.Cancel(Loading);
+	TEST_CHECK(Backend.Count(FFakeStreamingBackend::CANCEL) == 2 && Scheduler.GetState(Loading) == AssetStreamingScheduler::NUM_REQUEST_STATES);
+	Scheduler.Cancel(Loading); // no-op
+	TEST_CHECK(Scheduler.GetStatistics().NumTotalCancelled == 2);
+
+	// a cancelled path can be requested again, finalizing removes the request
+	const AssetRequestID d = Scheduler.Request(Pending == a ? "a" : "b", Backend.AssetSizes[3]);
+	TEST_CHECK(d != a && d != b && d != c);
+	for (uint32 Frame = 2; Frame < 64 && !Scheduler.IsIdle(); ++Frame)
+	{
+		Backend.Frame = Frame;
+		Scheduler.Update(View);
+	}
+	TEST_CHECK(Scheduler.IsIdle() && Backend.Count(FFakeStreamingBackend::FINALIZE) == 2);
+	TEST_CHECK(Backend.FinalizedFrames[c] != FFakeStreamingBackend::NOT_FINALIZED && Backend.FinalizedFrames[d] != FFakeStreamingBackend::NOT_FINALIZED);
+}
+
+VQE_TEST(AssetStreaming_Priority)
+{
+	FAssetStreamingView View;
+	View.Position = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	View.ProjectionScale = 540.0f;
+
+	const DirectX::XMFLOAT4 Spheres[] =
+	{
+		  DirectX::XMFLOAT4(100.0f, 0.0f, 0.0f, 2.0f)  // 10.8
+		, DirectX::XMFLOAT4(0.0f, 0.0f, -20.0f, 1.0f)  // 27
+		, DirectX::XMFLOAT4(0.5f, 0.0f, 0.0f, 4.0f)    // camera inside: clamped to the full scale
+	};
+	TEST_CHECK(std::abs(AssetStreamingScheduler::CalculatePriority(View, Spheres, 1) - 10.8f) < 1e-3f);
+	TEST_CHECK(std::abs(AssetStreamingScheduler::CalculatePriority(View, Spheres, 2) - 27.0f) < 1e-3f);
+	TEST_CHECK(std::abs(AssetStreamingScheduler::CalculatePriority(View, Spheres, 3) - 540.0f) < 1e-3f);
+	TEST_CHECK(AssetStreamingScheduler::CalculatePriority(View, Spheres, 0) == 0.0f);
+}
@@ -0,0 +1,182 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/CameraBenchmark.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+using namespace DirectX;
+
+namespace
+{
+	// a fly-through w/ uneven key spacing, like a recording at a variable frame rate
+	CameraTrack CreateTestTrack()
+	{
+		CameraTrack Track;
+		float Time = 0.5f;
+		for (int i = 0; i < 32; ++i)
+		{
+			FCameraTrackKey Key = {};
+			Key.Time = Time;
+			Key.Position = XMFLOAT3(std::cos(i * 0.3f) * 20.0f, 2.0f + (i % 5) * 0.25f, std::sin(i * 0.3f) * 20.0f);
+			XMStoreFloat4(&Key.Rotation, XMQuaternionRotationRollPitchYaw(0.1f * std::sin(i * 0.7f), i * 0.3f + XM_PIDIV2, 0.0f));
+			Key.FieldOfView = XMConvertToRadians(60.0f + (i % 3) * 5.0f);
+			Key.NearZ = 0.1f;
+			Key.FarZ = 1000.0f + i;
+			Track.AddKey(Key);
+			Time += (i % 4 == 0) ? 0.25f : 0.1f + 0.01f * i;
+		}
+		return Track;
+	}
+
+	bool IsBitIdentical(const FCameraTrackKey& a, const FCameraTrackKey& b) { return memcmp(&a, &b, sizeof(FCameraTrackKey)) == 0; }
+
+	void WriteFile(const std::string& FilePath, const void* pData, size_t Size)
+	{
+		FILE* pFile = fopen(FilePath.c_str(), "wb");
+		if (!pFile)
+			return;
+		fwrite(pData, 1, Size, pFile);
+		fclose(pFile);
+	}
+}
+
+// the interpolation passes through the keys & clamps to the track
+VQE_TEST(CameraTrack_SampleKeys)
+{
+	const CameraTrack Track = CreateTestTrack();
+	bool bKeysMatch = true;
+	for (const FCameraTrackKey& Key : Track.GetKeys())
+	{
+		const FCameraTrackKey s = Track.Sample(Key.Time);
+		const XMVECTOR q0 = XMLoadFloat4(&Key.Rotation);
+		const XMVECTOR q1 = XMLoadFloat4(&s.Rotation);
+		bKeysMatch &= XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&Key.Position), XMLoadFloat3(&s.Position)))) < 1e-4f;
+		bKeysMatch &= std::abs(XMVectorGetX(XMVector4Dot(q0, q1))) > 0.99999f; // q & -q are the same rotation
+		bKeysMatch &= std::abs(s.FieldOfView - Key.FieldOfView) < 1e-6f && std::abs(s.FarZ - Key.FarZ) < 1e-3f;
+	}
+	TEST_CHECK(bKeysMatch);
+	TEST_CHECK(IsBitIdentical(Track.Sample(Track.GetStartTime() - 1.0f), Track.GetKeys().front()));
+	TEST_CHECK(IsBitIdentical(Track.Sample(Track.GetEndTime() + 1.0f), Track.GetKeys().back()));
+
+	// unit quaternions between the keys
+	bool bNormalized = true;
+	for (float t = Track.GetStartTime(); t < Track.GetEndTime(); t += 0.01f)
+	{
+		const FCameraTrackKey s = Track.Sample(t);
+		bNormalized &= std::abs(XMVectorGetX(XMVector4Length(XMLoadFloat4(&s.Rotation))) - 1.0f) < 1e-4f;
+	}
+	TEST_CHECK(bNormalized);
+}
+
+// a saved & loaded track replayed by 2 fixed-timestep benchmark runs produces the same camera bits every frame
+VQE_TEST(CameraTrack_BitExactReplay)
+{
+	constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
+	const CameraTrack Track = CreateTestTrack();
+	const std::string TrackFile = Test::GetTempFilePath("CameraTrack_Replay.vqct");
+	TEST_CHECK(Track.Save(TrackFile));
+
+	CameraTrack Loaded;
+	TEST_CHECK(Loaded.Load(TrackFile));
+	TEST_CHECK(Loaded.GetNumKeys() == Track.GetNumKeys());
+	TEST_CHECK(Loaded.GetNumKeys() == Track.GetNumKeys() && memcmp(Loaded.GetKeys().data(), Track.GetKeys().data(), sizeof(FCameraTrackKey) * Track.GetNumKeys()) == 0);
+
+	CameraBenchmark Runs[2];
+	for (CameraBenchmark& Run : Runs)
+	{
+		TEST_CHECK(Run.Initialize(TrackFile, FIXED_TIMESTEP));
+		for (int iFrame = 0; Run.IsRunning(); ++iFrame)
+			Run.EndFrame(1.0f, 0.5f, 2.0f + (iFrame % 7)); // timings don't affect the camera
+	}
+	const std::vector<CameraBenchmark::FFrameStats>& Frames0 = Runs[0].GetFrameStats();
+	const std::vector<CameraBenchmark::FFrameStats>& Frames1 = Runs[1].GetFrameStats();
+	const size_t NumExpectedFrames = static_cast<size_t>(Track.GetDuration() / FIXED_TIMESTEP) + 1;
+	TEST_CHECK(Runs[0].IsFinished() && Runs[1].IsFinished());
+	TEST_CHECK(Frames0.size() == Frames1.size());
+	TEST_CHECK(Frames0.size() >= NumExpectedFrames - 1 && Frames0.size() <= NumExpectedFrames + 1);
+
+	bool bBitIdentical = Frames0.size() == Frames1.size();
+	bool bMatchesTrack = true;
+	for (size_t i = 0; bBitIdentical && i < Frames0.size(); ++i)
+	{
+		bBitIdentical &= Frames0[i].FrameIndex == i && IsBitIdentical(Frames0[i].Camera, Frames1[i].Camera);
+		bMatchesTrack &= IsBitIdentical(Frames0[i].Camera, Track.Sample(Track.GetStartTime() + static_cast<float>(i) * FIXED_TIMESTEP));
+	}
+	TEST_CHECK(bBitIdentical);
+	TEST_CHECK(bMatchesTrack);
+
+	const std::string ResultsFile = Test::GetTempFilePath("CameraTrack_Replay.csv");
+	TEST_CHECK(Runs[0].WriteResults(ResultsFile));
+
+	std::error_code ec;
+	std::filesystem::remove(TrackFile, ec);
+	std::filesystem::remove(ResultsFile, ec);
+}
+
+// invalid files are rejected w/o touching the loaded track
+VQE_TEST(CameraTrack_RejectCorruptFiles)
+{
+	const CameraTrack Track = CreateTestTrack();
+	const std::string TrackFile = Test::GetTempFilePath("CameraTrack_Valid.vqct");
+	const std::string CorruptFile = Test::GetTempFilePath("CameraTrack_Corrupt.vqct");
+	TEST_CHECK(Track.Save(TrackFile));
+
+	std::vector<char> Bytes(std::filesystem::file_size(TrackFile));
+	FILE* pFile = fopen(TrackFile.c_str(), "rb");
+	TEST_CHECK(pFile != nullptr);
+	if (!pFile)
+		return;
+	TEST_CHECK(fread(Bytes.data(), 1, Bytes.size(), pFile) == Bytes.size());
+	fclose(pFile);
+
+	CameraTrack Loaded;
+	TEST_CHECK(Loaded.Load(TrackFile));
+
+	constexpr size_t HEADER_SIZE = 4 * sizeof(unsigned); // magic, version, key count, key size
+	std::vector<char> Corrupt = Bytes;
+	Corrupt[0] ^= 0x1;                                                    // magic
+	WriteFile(CorruptFile, Corrupt.data(), Corrupt.size());
+	TEST_CHECK(!Loaded.Load(CorruptFile));
+
+	WriteFile(CorruptFile, Bytes.data(), Bytes.size() - sizeof(FCameraTrackKey) / 2); // truncated
+	TEST_CHECK(!Loaded.Load(CorruptFile));
+
+	Corrupt = Bytes;
+	const unsigned HugeKeyCount = 0x7FFFFFFF;
+	memcpy(Corrupt.data() + 2 * sizeof(unsigned), &HugeKeyCount, sizeof(HugeKeyCount)); // key count beyond the file
+	WriteFile(CorruptFile, Corrupt.data(), Corrupt.size());
+	TEST_CHECK(!Loaded.Load(CorruptFile));
+
+	Corrupt = Bytes;
+	const float NaN = std::nanf("");
+	memcpy(Corrupt.data() + HEADER_SIZE + 3 * sizeof(FCameraTrackKey), &NaN, sizeof(NaN)); // key time
+	WriteFile(CorruptFile, Corrupt.data(), Corrupt.size());
+	TEST_CHECK(!Loaded.Load(CorruptFile));
+
+	TEST_CHECK(Loaded.GetNumKeys() == Track.GetNumKeys());
+	TEST_CHECK(!Loaded.Load(Test::GetTempFilePath("CameraTrack_Missing.vqct")));
+
+	std::error_code ec;
+	std::filesystem::remove(TrackFile, ec);
+	std::filesystem::remove(CorruptFile, ec);
+}
@@ -0,0 +1,222 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/CascadedShadowMaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	constexpr uint32 NUM_CASCADES = 4;
+
+	FCascadedShadowMapParameters CreateTestParameters()
+	{
+		FCascadedShadowMapParameters Params;
+		Params.CameraPosition = XMFLOAT3(3.3f, 2.0f, -7.0f);
+		Params.CameraForward  = XMFLOAT3(0.3f, -0.2f, 1.0f);
+		Params.NearZ          = 0.1f;
+		Params.FarZ           = 1000.0f;
+		Params.FieldOfViewY   = 1.0f;
+		Params.AspectRatio    = 16.0f / 9.0f;
+		Params.LightDirection = XMFLOAT3(0.3f, -1.0f, 0.4f);
+		Params.SceneBoundingBox.ExtentMin = XMFLOAT3(-300.0f, -10.0f, -300.0f);
+		Params.SceneBoundingBox.ExtentMax = XMFLOAT3( 300.0f,  80.0f,  300.0f);
+		Params.NumCascades         = NUM_CASCADES;
+		Params.ShadowMapResolution = 2048;
+		Params.MaxShadowDistance   = 500.0f;
+		Params.SplitLambda         = 0.8f;
+		return Params;
+	}
+
+	// shadow map texel coordinates of a world space point
+	XMFLOAT2 GetShadowMapTexel(const FShadowCascade& Cascade, uint32 Resolution, const XMVECTOR& WorldPosition)
+	{
+		XMFLOAT3 NDC;
+		XMStoreFloat3(&NDC, XMVector3TransformCoord(WorldPosition, Cascade.matViewProj));
+		return XMFLOAT2((NDC.x * 0.5f + 0.5f) * Resolution, (0.5f - NDC.y * 0.5f) * Resolution);
+	}
+
+	float GetDistanceToInteger(float f) { return std::abs(f - std::round(f)); }
+}
+
+VQE_TEST(CascadedShadowMaps_SplitDistances)
+{
+	const FCascadedShadowMapParameters Params = CreateTestParameters();
+	FShadowCascade Cascades[NUM_CASCADES];
+	TEST_CHECK(FitShadowCascades(Params, Cascades) == NUM_CASCADES);
+
+	TEST_CHECK(Cascades[0].SplitNear == Params.NearZ);
+	TEST_CHECK(Cascades[NUM_CASCADES - 1].SplitFar == Params.MaxShadowDistance); // FarZ is further
+	for (uint32 i = 0; i < NUM_CASCADES; ++i)
+	{
+		TEST_CHECK(Cascades[i].SplitNear < Cascades[i].SplitFar);
+		if (i > 0)
+		{
+			TEST_CHECK(Cascades[i].SplitNear == Cascades[i - 1].SplitFar);
+			TEST_CHECK(Cascades[i].TexelSize > Cascades[i - 1].TexelSize);
+		}
+	}
+
+	// lambda = 0 is uniform
+	float Splits[NUM_CASCADES + 1];
+	CalculateCascadeSplitDistances(10.0f, 50.0f, NUM_CASCADES, 0.0f, Splits);
+	for (uint32 i = 0; i <= NUM_CASCADES; ++i)
+		TEST_CHECK(std::abs(Splits[i] - (10.0f + 10.0f * i)) < 1e-4f);
+
+	FCascadedShadowMapParameters NoShadows = Params;
+	NoShadows.MaxShadowDistance = Params.NearZ;
+	TEST_CHECK(FitShadowCascades(NoShadows, Cascades) == 0);
+}
+
+// each cascade must contain its frustum slice and have the scene in front of its near plane
+VQE_TEST(CascadedShadowMaps_Coverage)
+{
+	const FCascadedShadowMapParameters Params = CreateTestParameters();
+	FShadowCascade Cascades[NUM_CASCADES];
+	FitShadowCascades(Params, Cascades);
+
+	const float TanY = std::tan(Params.FieldOfViewY * 0.5f);
+	const float TanX = TanY * Params.AspectRatio;
+	const XMVECTOR Forward = XMVector3Normalize(XMLoadFloat3(&Params.CameraForward));
+	const XMMATRIX matViewInverse = XMMatrixInverse(nullptr, XMMatrixLookToLH(XMLoadFloat3(&Params.CameraPosition), Forward, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+
+	uint32 NumOutside = 0;
+	for (const FShadowCascade& Cascade : Cascades)
+	{
+		for (float Distance : { Cascade.SplitNear, Cascade.SplitFar })
+		for (float x : { -1.0f, 1.0f })
+		for (float y : { -1.0f, 1.0f })
+		{
+			const XMVECTOR Corner = XMVector3TransformCoord(XMVectorSet(x * TanX * Distance, y * TanY * Distance, Distance, 1.0f), matViewInverse);
+			XMFLOAT3 NDC;
+			XMStoreFloat3(&NDC, XMVector3TransformCoord(Corner, Cascade.matViewProj));
+			NumOutside += (std::abs(NDC.x) > 1.0001f || std::abs(NDC.y) > 1.0001f || NDC.z < 0.0f || NDC.z > 1.0f) ? 1 : 0;
+		}
+		for (const XMVECTOR& Corner : Params.SceneBoundingBox.GetCornerPointsV3())
+			NumOutside += XMVectorGetZ(XMVector3TransformCoord(Corner, Cascade.matViewProj)) < -1e-4f ? 1 : 0;
+	}
+	TEST_CHECK(NumOutside == 0);
+}
+
+// sub-texel camera motion moves the shadow map contents by whole texels or not at all,
+// rotating the camera in place doesn't change the cascade extents
+VQE_TEST(CascadedShadowMaps_TexelSnapStability)
+{
+	const FCascadedShadowMapParameters Params = CreateTestParameters();
+	FShadowCascade Reference[NUM_CASCADES];
+	FitShadowCascades(Params, Reference);
+
+	const XMVECTOR WorldPoints[] = { XMVectorSet(1.7f, 0.5f, 2.3f, 1.0f), XMVectorSet(-20.0f, 0.0f, 60.0f, 1.0f), XMVectorSet(80.0f, 10.0f, 250.0f, 1.0f) };
+
+	uint32 NumFractionalMoves = 0;
+	uint32 NumWholeTexelMoves = 0;
+	FShadowCascade Previous[NUM_CASCADES];
+	std::copy(Reference, Reference + NUM_CASCADES, Previous);
+	for (int Step = 1; Step <= 400; ++Step)
+	{
+		FCascadedShadowMapParameters Moved = Params;
+		Moved.CameraPosition.x += Step * 0.0007f;
+		Moved.CameraPosition.y += Step * 0.0002f;
+		Moved.CameraPosition.z += Step * 0.0003f;
+		FShadowCascade Cascades[NUM_CASCADES];
+		FitShadowCascades(Moved, Cascades);
+
+		for (uint32 i = 0; i < NUM_CASCADES; ++i)
+		{
+			TEST_CHECK(Cascades[i].BoundingSphereRadius == Reference[i].BoundingSphereRadius);
+			for (const XMVECTOR& P : WorldPoints)
+			{
+				const XMFLOAT2 Texel0 = GetShadowMapTexel(Previous[i], Params.ShadowMapResolution, P);
+				const XMFLOAT2 Texel1 = GetShadowMapTexel(Cascades[i], Params.ShadowMapResolution, P);
+				const float dx = Texel1.x - Texel0.x;
+				const float dy = Texel1.y - Texel0.y;
+				if (GetDistanceToInteger(dx) > 0.02f || GetDistanceToInteger(dy) > 0.02f)
+					++NumFractionalMoves;
+				else if (std::round(dx) != 0.0f || std::round(dy) != 0.0f)
+					++NumWholeTexelMoves;
+			}
+		}
+		std::copy(Cascades, Cascades + NUM_CASCADES, Previous);
+	}
+	Test::Report("%u whole texel moves, %u fractional moves", NumWholeTexelMoves, NumFractionalMoves);
+	TEST_CHECK(NumFractionalMoves == 0);
+	TEST_CHECK(NumWholeTexelMoves > 0); // the path crosses texel boundaries
+
+	// returning to the start reproduces the cascades exactly
+	FShadowCascade Returned[NUM_CASCADES];
+	FitShadowCascades(Params, Returned);
+	for (uint32 i = 0; i < NUM_CASCADES; ++i)
+		TEST_CHECK(std::memcmp(&Returned[i].matViewProj, &Reference[i].matViewProj, sizeof(XMMATRIX)) == 0);
+
+	// rotation in place
+	for (int Step = 0; Step < 36; ++Step)
+	{
+		const float Angle = Step * XM_2PI / 36;
+		FCascadedShadowMapParameters Rotated = Params;
+		Rotated.CameraForward = XMFLOAT3(std::cos(Angle), -0.2f, std::sin(Angle));
+		FShadowCascade Cascades[NUM_CASCADES];
+		FitShadowCascades(Rotated, Cascades);
+		for (uint32 i = 0; i < NUM_CASCADES; ++i)
+		{
+			TEST_CHECK(Cascades[i].BoundingSphereRadius == Reference[i].BoundingSphereRadius);
+			TEST_CHECK(Cascades[i].TexelSize == Reference[i].TexelSize);
+		}
+	}
+}
+
+// the snapped projection still contains the whole bounding sphere of the frustum slice
+VQE_TEST(CascadedShadowMaps_SnappedSphereCoverage)
+{
+	const FCascadedShadowMapParameters Params = CreateTestParameters();
+	const XMVECTOR Forward = XMVector3Normalize(XMLoadFloat3(&Params.CameraForward));
+
+	float MaxExtent = 0.0f;
+	for (int Step = 0; Step < 400; ++Step)
+	{
+		FCascadedShadowMapParameters Moved = Params;
+		Moved.CameraPosition.x += Step * 0.0007f;
+		Moved.CameraPosition.y -= Step * 0.0011f;
+		Moved.CameraPosition.z += Step * 0.0003f;
+		FShadowCascade Cascades[NUM_CASCADES];
+		FitShadowCascades(Moved, Cascades);
+
+		for (const FShadowCascade& Cascade : Cascades)
+		{
+			float CenterDistance = 0.0f;
+			float Radius = 0.0f;
+			CalculateFrustumSliceBoundingSphere(Cascade.SplitNear, Cascade.SplitFar, Params.FieldOfViewY, Params.AspectRatio, CenterDistance, Radius);
+			const XMVECTOR Center = XMVectorAdd(XMLoadFloat3(&Moved.CameraPosition), XMVectorScale(Forward, CenterDistance));
+
+			// the projection is orthographic: the sphere's half extent in NDC is the radius times the axis scale
+			XMFLOAT4X4 M;
+			XMStoreFloat4x4(&M, Cascade.matViewProj);
+			XMFLOAT3 NDC;
+			XMStoreFloat3(&NDC, XMVector3TransformCoord(Center, Cascade.matViewProj));
+			const float ExtentX = std::abs(NDC.x) + Radius * std::sqrt(M.m[0][0] * M.m[0][0] + M.m[1][0] * M.m[1][0] + M.m[2][0] * M.m[2][0]);
+			const float ExtentY = std::abs(NDC.y) + Radius * std::sqrt(M.m[0][1] * M.m[0][1] + M.m[1][1] * M.m[1][1] + M.m[2][1] * M.m[2][1]);
+			MaxExtent = std::max(MaxExtent, std::max(ExtentX, ExtentY));
+		}
+	}
+	Test::Report("max sphere extent in NDC: %.6f", MaxExtent);
+	TEST_CHECK(MaxExtent <= 1.0f + 1e-4f);
+}
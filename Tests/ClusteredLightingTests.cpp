@@ -0,0 +1,236 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	constexpr float NEAR_Z = 0.1f;
+	constexpr float FAR_Z  = 1000.0f;
+
+	struct FClusterTestView
+	{
+		XMMATRIX matView;
+		XMMATRIX matProj;
+	};
+
+	FClusterTestView CreateTestView()
+	{
+		FClusterTestView View;
+		View.matView = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -50.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 100.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		View.matProj = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, NEAR_Z, FAR_Z);
+		return View;
+	}
+
+	// deterministic light distribution in front of the test view: 3/4 point lights, 1/4 spot lights
+	void CreateTestLights(uint32 NumLights, std::vector<VQ_SHADER_DATA::PointLight>& PointLights, std::vector<VQ_SHADER_DATA::SpotLight>& SpotLights)
+	{
+		std::mt19937 rng(1337);
+		std::uniform_real_distribution<float> fnPosX(-200.0f, 200.0f);
+		std::uniform_real_distribution<float> fnPosY(   0.0f,  30.0f);
+		std::uniform_real_distribution<float> fnPosZ( -20.0f, 400.0f);
+		std::uniform_real_distribution<float> fnRange(  2.0f,  20.0f);
+		std::uniform_real_distribution<float> fnAngle(XMConvertToRadians(15.0f), XMConvertToRadians(60.0f));
+		std::uniform_real_distribution<float> fnDir(-1.0f, 1.0f);
+
+		PointLights.resize(NumLights - NumLights / 4);
+		SpotLights.resize(NumLights / 4);
+		for (VQ_SHADER_DATA::PointLight& l : PointLights)
+		{
+			l = {};
+			l.position = XMFLOAT3(fnPosX(rng), fnPosY(rng), fnPosZ(rng));
+			l.range = fnRange(rng);
+		}
+		for (VQ_SHADER_DATA::SpotLight& l : SpotLights)
+		{
+			l = {};
+			l.position = XMFLOAT3(fnPosX(rng), fnPosY(rng), fnPosZ(rng));
+			l.range = fnRange(rng);
+			l.outerConeAngle = fnAngle(rng);
+			l.innerConeAngle = l.outerConeAngle * 0.8f;
+			XMStoreFloat3(&l.spotDir, XMVector3Normalize(XMVectorSet(fnDir(rng), fnDir(rng) - 1.0f, fnDir(rng), 0.0f)));
+		}
+	}
+
+	// cluster of a world space point, false if it's outside the frustum
+	bool GetCluster(const FClusterTestView& View, const FLightClusterGrid& Grid, XMVECTOR WorldPosition, uint32& OutCluster)
+	{
+		const XMVECTOR ViewPosition = XMVector3TransformCoord(WorldPosition, View.matView);
+		const float Depth = XMVectorGetZ(ViewPosition);
+		if (Depth < NEAR_Z || Depth > FAR_Z)
+			return false;
+		const XMVECTOR NDC = XMVector3TransformCoord(ViewPosition, View.matProj);
+		const float x = XMVectorGetX(NDC);
+		const float y = XMVectorGetY(NDC);
+		if (std::abs(x) > 1.0f || std::abs(y) > 1.0f)
+			return false;
+		const int NumX = static_cast<int>(Grid.NumClustersX);
+		const int NumY = static_cast<int>(Grid.NumClustersY);
+		const int NumZ = static_cast<int>(Grid.NumClustersZ);
+		const int ix = std::min(static_cast<int>((x * 0.5f + 0.5f) * NumX), NumX - 1);
+		const int iy = std::min(static_cast<int>((0.5f - y * 0.5f) * NumY), NumY - 1);
+		const int iz = std::clamp(static_cast<int>(std::floor(std::log(Depth) * Grid.SliceScale + Grid.SliceBias)), 0, NumZ - 1);
+		OutCluster = ix + iy * NumX + iz * NumX * NumY;
+		return true;
+	}
+
+	bool IsLightInCluster(const FLightClusterGrid& Grid, uint32 Cluster, uint32 LightIndex, bool bSpotLight)
+	{
+		const FLightCluster& c = Grid.Clusters[Cluster];
+		const uint32 NumPointLights = c.LightCounts & 0xFFFF;
+		const uint32 NumSpotLights  = c.LightCounts >> 16;
+		const uint32 First = c.LightIndexOffset + (bSpotLight ? NumPointLights : 0);
+		const uint32 Count = bSpotLight ? NumSpotLights : NumPointLights;
+		for (uint32 i = 0; i < Count; ++i)
+			if (Grid.LightIndices[First + i] == LightIndex)
+				return true;
+		return false;
+	}
+}
+
+// binning is conservative: every point inside a light volume lies in a cluster listing the light
+VQE_TEST(ClusteredLighting_ConservativeBinning)
+{
+	constexpr int NUM_SAMPLES_PER_LIGHT = 200;
+	const FClusterTestView View = CreateTestView();
+	std::vector<VQ_SHADER_DATA::PointLight> PointLights;
+	std::vector<VQ_SHADER_DATA::SpotLight>  SpotLights;
+	CreateTestLights(1024, PointLights, SpotLights);
+
+	LightClusterBinner Binner;
+	Binner.Initialize();
+	FLightClusterGrid Grid;
+	Binner.Bin(View.matView, View.matProj, NEAR_Z, FAR_Z, PointLights, SpotLights, Grid);
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> fnUnit(-1.0f, 1.0f);
+	int NumSamples = 0;
+	int NumMissedSamples = 0;
+	for (uint32 i = 0; i < PointLights.size(); ++i)
+	{
+		for (int k = 0; k < NUM_SAMPLES_PER_LIGHT; ++k)
+		{
+			const XMVECTOR Offset = XMVectorSet(fnUnit(rng), fnUnit(rng), fnUnit(rng), 0.0f);
+			if (XMVectorGetX(XMVector3Length(Offset)) > 1.0f)
+				continue;
+			const XMVECTOR Position = XMVectorAdd(XMLoadFloat3(&PointLights[i].position), XMVectorScale(Offset, PointLights[i].range * 0.999f));
+			uint32 Cluster;
+			if (!GetCluster(View, Grid, Position, Cluster))
+				continue;
+			++NumSamples;
+			NumMissedSamples += IsLightInCluster(Grid, Cluster, i, false) ? 0 : 1;
+		}
+	}
+	for (uint32 i = 0; i < SpotLights.size(); ++i)
+	{
+		const XMVECTOR SpotDirection = XMLoadFloat3(&SpotLights[i].spotDir);
+		for (int k = 0; k < NUM_SAMPLES_PER_LIGHT; ++k)
+		{
+			const XMVECTOR Offset = XMVectorSet(fnUnit(rng), fnUnit(rng), fnUnit(rng), 0.0f);
+			const float Length = XMVectorGetX(XMVector3Length(Offset));
+			if (Length > 1.0f || Length < 1e-3f)
+				continue;
+			const float CosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(Offset), SpotDirection));
+			if (std::acos(std::min(CosAngle, 1.0f)) > SpotLights[i].outerConeAngle)
+				continue;
+			const XMVECTOR Position = XMVectorAdd(XMLoadFloat3(&SpotLights[i].position), XMVectorScale(Offset, SpotLights[i].range * 0.999f));
+			uint32 Cluster;
+			if (!GetCluster(View, Grid, Position, Cluster))
+				continue;
+			++NumSamples;
+			NumMissedSamples += IsLightInCluster(Grid, Cluster, i, true) ? 0 : 1;
+		}
+	}
+	Test::Report("%d samples inside the frustum, %d missed", NumSamples, NumMissedSamples);
+	TEST_CHECK(NumSamples > 0);
+	TEST_CHECK(NumMissedSamples == 0);
+}
+
+// per cluster light lists are sorted & the counts add up to the index list
+VQE_TEST(ClusteredLighting_CompactedLists)
+{
+	const FClusterTestView View = CreateTestView();
+	std::vector<VQ_SHADER_DATA::PointLight> PointLights;
+	std::vector<VQ_SHADER_DATA::SpotLight>  SpotLights;
+	CreateTestLights(4096, PointLights, SpotLights);
+
+	LightClusterBinner Binner;
+	Binner.Initialize();
+	FLightClusterGrid Grid;
+	for (int iFrame = 0; iFrame < 2; ++iFrame) // the 2nd frame reuses the binner's counts
+	{
+		Binner.Bin(View.matView, View.matProj, NEAR_Z, FAR_Z, PointLights, SpotLights, Grid);
+
+		uint32 NumIndices = 0;
+		bool bSorted = true;
+		for (const FLightCluster& c : Grid.Clusters)
+		{
+			const uint32 NumPointLights = c.LightCounts & 0xFFFF;
+			const uint32 NumSpotLights  = c.LightCounts >> 16;
+			TEST_CHECK(c.LightIndexOffset == NumIndices);
+			const uint32* pPointLights = Grid.LightIndices.data() + c.LightIndexOffset;
+			const uint32* pSpotLights  = pPointLights + NumPointLights;
+			bSorted &= std::is_sorted(pPointLights, pPointLights + NumPointLights) && std::is_sorted(pSpotLights, pSpotLights + NumSpotLights);
+			NumIndices += NumPointLights + NumSpotLights;
+		}
+		TEST_CHECK(bSorted);
+		TEST_CHECK(NumIndices == Grid.LightIndices.size());
+		TEST_CHECK(Binner.GetStatistics().NumLightIndices == NumIndices);
+	}
+}
+
+// bins randomly distributed lights in a fixed view & reports the timings
+VQE_BENCHMARK(ClusteredLighting_BinningCost)
+{
+	constexpr uint32 NUM_LIGHTS = 4096;
+	constexpr uint32 NUM_ITERATIONS = 100;
+	const FClusterTestView View = CreateTestView();
+	std::vector<VQ_SHADER_DATA::PointLight> PointLights;
+	std::vector<VQ_SHADER_DATA::SpotLight>  SpotLights;
+	CreateTestLights(NUM_LIGHTS, PointLights, SpotLights);
+
+	LightClusterBinner Binner;
+	Binner.Initialize();
+	FLightClusterGrid Grid;
+
+	std::vector<float> TimingsMs(NUM_ITERATIONS);
+	for (uint32 i = 0; i < NUM_ITERATIONS; ++i)
+	{
+		Binner.Bin(View.matView, View.matProj, NEAR_Z, FAR_Z, PointLights, SpotLights, Grid);
+		TimingsMs[i] = Binner.GetStatistics().BinningTimeMs;
+	}
+
+	float AvgMs = 0.0f;
+	for (float ms : TimingsMs) AvgMs += ms;
+	AvgMs /= NUM_ITERATIONS;
+	std::sort(TimingsMs.begin(), TimingsMs.end());
+
+	const LightClusterBinner::FStatistics& s = Binner.GetStatistics();
+	Test::Report("%u point + %u spot lights, %ux%ux%u clusters, %u iterations", s.NumPointLights, s.NumSpotLights, Grid.NumClustersX, Grid.NumClustersY, Grid.NumClustersZ, NUM_ITERATIONS);
+	Test::Report("binning: avg=%.3fms median=%.3fms min=%.3fms max=%.3fms", AvgMs, TimingsMs[NUM_ITERATIONS / 2], TimingsMs.front(), TimingsMs.back());
+	Test::Report("%u light indices, %u/%u occupied clusters, max %u lights/cluster, avg %.2f lights/occupied cluster"
+		, s.NumLightIndices, s.NumOccupiedClusters, s.NumClusters, s.MaxLightsPerCluster, s.AvgLightsPerOccupiedCluster);
+	TEST_CHECK(s.NumPointLights + s.NumSpotLights == NUM_LIGHTS);
+}
@@ -0,0 +1,177 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/CommandRecordingScheduler.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	enum EMockPass : uint32
+	{
+		MOCK_PASS_SHADOW_VIEW = 0,
+		MOCK_PASS_DEPTH_PREPASS,
+		MOCK_PASS_SCENE_COLOR_SETUP, // AO, barriers
+		MOCK_PASS_SCENE_COLOR,
+	};
+
+	// what the mock command list records: a prologue & epilogue per work item and the draws in between
+	struct FMockCommand
+	{
+		static constexpr uint32 PROLOGUE = 0xFFFFFFFE;
+		static constexpr uint32 EPILOGUE = 0xFFFFFFFF;
+
+		uint32 PassID;
+		uint32 ViewIndex;
+		uint32 iDraw;
+
+		bool operator==(const FMockCommand& o) const { return PassID == o.PassID && ViewIndex == o.ViewIndex && iDraw == o.iDraw; }
+	};
+
+	struct FMockCommandRecorder : public FCommandRecorder
+	{
+		std::vector<std::vector<FMockCommand>> CommandLists;
+
+		void RecordChunk(uint32 iCommandList, const FRecordingWorkItem& WorkItem, uint32 iDrawBegin, uint32 iDrawEnd) override
+		{
+			std::vector<FMockCommand>& Cmds = CommandLists[iCommandList];
+			if (iDrawBegin == WorkItem.iDrawBegin) Cmds.push_back({ WorkItem.PassID, WorkItem.ViewIndex, FMockCommand::PROLOGUE });
+			for (uint32 iDraw = iDrawBegin; iDraw < iDrawEnd; ++iDraw)
+				Cmds.push_back({ WorkItem.PassID, WorkItem.ViewIndex, iDraw });
+			if (iDrawEnd == WorkItem.iDrawEnd) Cmds.push_back({ WorkItem.PassID, WorkItem.ViewIndex, FMockCommand::EPILOGUE });
+		}
+	};
+
+	// frame layout of the renderer: depth pre-pass, shadow views, scene color
+	std::vector<FRecordingWorkItem> MakeMockFrame(uint32 NumMainViewDraws, const std::vector<uint32>& NumShadowViewDraws)
+	{
+		std::vector<FRecordingWorkItem> Items;
+		Items.push_back({ MOCK_PASS_DEPTH_PREPASS, 0, 0, NumMainViewDraws, true });
+		for (uint32 i = 0; i < NumShadowViewDraws.size(); ++i)
+			Items.push_back({ MOCK_PASS_SHADOW_VIEW, i, 0, NumShadowViewDraws[i], true });
+		Items.push_back({ MOCK_PASS_SCENE_COLOR_SETUP, 0, 0, 0, false });
+		Items.push_back({ MOCK_PASS_SCENE_COLOR, 0, 0, NumMainViewDraws, true });
+		return Items;
+	}
+
+	struct FTestFrame { const char* pName; std::vector<FRecordingWorkItem> WorkItems; };
+	std::vector<FTestFrame> CreateTestFrames()
+	{
+		std::mt19937 rng(1234);
+		auto fnRandomDraws = [&rng](uint32 Min, uint32 Max) { return std::uniform_int_distribution<uint32>(Min, Max)(rng); };
+
+		std::vector<FTestFrame> Frames;
+
+		// StressTest: 64x4x48 object grid + Sponza, 4 directional cascades, 5 spot & 5 point lights
+		{
+			std::vector<uint32> NumShadowViewDraws;
+			for (uint32 i = 0; i < 5; ++i)     NumShadowViewDraws.push_back(fnRandomDraws(200, 2000));  // spot
+			for (uint32 i = 0; i < 5 * 6; ++i) NumShadowViewDraws.push_back(fnRandomDraws(0, 600));     // point faces
+			for (uint32 i = 0; i < 4; ++i)     NumShadowViewDraws.push_back(3000 + i * 3000);           // cascades
+			Frames.push_back({ "StressTest", MakeMockFrame(6500, NumShadowViewDraws) });
+		}
+		// Sponza: ~380 meshes, 4 directional cascades, 1 spot & 2 point lights
+		{
+			std::vector<uint32> NumShadowViewDraws;
+			NumShadowViewDraws.push_back(fnRandomDraws(100, 380));                                      // spot
+			for (uint32 i = 0; i < 2 * 6; ++i) NumShadowViewDraws.push_back(fnRandomDraws(20, 200));    // point faces
+			for (uint32 i = 0; i < 4; ++i)     NumShadowViewDraws.push_back(120 + i * 80);              // cascades
+			Frames.push_back({ "Sponza", MakeMockFrame(380, NumShadowViewDraws) });
+		}
+		// a single unsplittable item
+		Frames.push_back({ "Single", { { MOCK_PASS_SCENE_COLOR_SETUP, 0, 0, 0, false } } });
+		return Frames;
+	}
+
+	constexpr uint32 NUM_COMMAND_LISTS[] = { 1, 2, 3, 4, 8, 16 };
+}
+
+// submitting the command lists in order must match the single threaded recording
+VQE_TEST(CommandRecordingScheduler_SubmissionOrder)
+{
+	for (const FTestFrame& Frame : CreateTestFrames())
+	for (uint32 MaxNumCommandLists : NUM_COMMAND_LISTS)
+	{
+		CommandRecordingScheduler Scheduler;
+		Scheduler.Schedule(Frame.WorkItems, MaxNumCommandLists);
+
+		FMockCommandRecorder Recorder;
+		Recorder.CommandLists.resize(Scheduler.GetNumCommandLists());
+		for (uint32 iCmdList = 0; iCmdList < Scheduler.GetNumCommandLists(); ++iCmdList)
+			Scheduler.RecordCommandList(Recorder, iCmdList);
+
+		std::vector<FMockCommand> Submitted;
+		for (const std::vector<FMockCommand>& Cmds : Recorder.CommandLists)
+			Submitted.insert(Submitted.end(), Cmds.begin(), Cmds.end());
+
+		FMockCommandRecorder SingleThreadedRecorder;
+		SingleThreadedRecorder.CommandLists.resize(1);
+		for (const FRecordingWorkItem& Item : Frame.WorkItems)
+			SingleThreadedRecorder.RecordChunk(0, Item, Item.iDrawBegin, Item.iDrawEnd);
+
+		const bool bOrderPassed = Submitted == SingleThreadedRecorder.CommandLists[0];
+		if (!bOrderPassed)
+			Test::Report("[%s] ordering mismatch on %u command lists", Frame.pName, MaxNumCommandLists);
+		TEST_CHECK(bOrderPassed);
+
+		// no empty command lists
+		for (const std::vector<FMockCommand>& Cmds : Recorder.CommandLists)
+			TEST_CHECK(!Cmds.empty());
+	}
+}
+
+// an optimal contiguous partition can exceed the average by at most one chunk
+VQE_TEST(CommandRecordingScheduler_Balance)
+{
+	const FCommandRecordingCostModel CostModel;
+	for (const FTestFrame& Frame : CreateTestFrames())
+	for (uint32 MaxNumCommandLists : NUM_COMMAND_LISTS)
+	{
+		CommandRecordingScheduler Scheduler;
+		Scheduler.Schedule(Frame.WorkItems, MaxNumCommandLists, CostModel);
+
+		const CommandRecordingScheduler::FStatistics& s = Scheduler.GetStatistics();
+		float MaxChunkCost = 0.0f;
+		for (const FRecordingChunk& Chunk : Scheduler.GetChunks())
+			MaxChunkCost = std::max(MaxChunkCost, Chunk.Cost);
+		const float AvgCost = s.TotalCost / std::max(s.NumCommandLists, 1u);
+
+		TEST_CHECK(s.NumCommandLists >= 1 && s.NumCommandLists <= MaxNumCommandLists);
+		TEST_CHECK(s.MaxCommandListCost <= AvgCost + MaxChunkCost);
+
+		// light frames aren't spread over more command lists than they're worth
+		TEST_CHECK(s.NumCommandLists == 1 || AvgCost >= CostModel.MinCostPerCommandList * 0.5f);
+
+		// chunks respect the minimum size unless the work item is smaller
+		for (const FRecordingChunk& Chunk : Scheduler.GetChunks())
+		{
+			const FRecordingWorkItem& Item = Scheduler.GetWorkItems()[Chunk.iWorkItem];
+			const uint32 NumDraws = Chunk.iDrawEnd - Chunk.iDrawBegin;
+			TEST_CHECK(NumDraws >= CostModel.MinDrawsPerChunk || NumDraws == Item.iDrawEnd - Item.iDrawBegin);
+		}
+
+		if (MaxNumCommandLists == 8)
+		{
+			Test::Report("[%s] %u work items -> %u chunks on %u/%u command lists, cost max=%.0f avg=%.0f imbalance=%.2f, %.3fms"
+				, Frame.pName, s.NumWorkItems, s.NumChunks, s.NumCommandLists, MaxNumCommandLists
+				, s.MaxCommandListCost, AvgCost, s.Imbalance, s.SchedulingTimeMs);
+		}
+	}
+}
@@ -0,0 +1,227 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Renderer/DescriptorAllocator.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	enum ESlotState : uint8 { FREE = 0, ALLOCATED, PENDING_FREE };
+
+	// reference model: one state per descriptor slot
+	struct FSlotModel
+	{
+		std::vector<uint8> Slots;
+
+		bool IsRangeInState(uint32 Offset, uint32 Count, ESlotState State) const
+		{
+			for (uint32 i = Offset; i < Offset + Count; ++i)
+				if (Slots[i] != State)
+					return false;
+			return true;
+		}
+		void SetRangeState(uint32 Offset, uint32 Count, ESlotState State)
+		{
+			for (uint32 i = Offset; i < Offset + Count; ++i)
+				Slots[i] = State;
+		}
+		uint32 CountSlots(ESlotState State) const
+		{
+			uint32 Count = 0;
+			for (uint8 s : Slots)
+				Count += s == State ? 1 : 0;
+			return Count;
+		}
+		void GetFreeRuns(uint32& OutNumRuns, uint32& OutLargestRun) const
+		{
+			OutNumRuns = 0;
+			OutLargestRun = 0;
+			uint32 Run = 0;
+			for (size_t i = 0; i <= Slots.size(); ++i)
+			{
+				if (i < Slots.size() && Slots[i] == FREE)
+				{
+					++Run;
+					continue;
+				}
+				OutNumRuns += Run > 0 ? 1 : 0;
+				OutLargestRun = std::max(OutLargestRun, Run);
+				Run = 0;
+			}
+		}
+	};
+
+	struct FAllocation
+	{
+		uint32 Offset;
+		uint32 Count;
+	};
+}
+
+// random allocations, frees & deferred frees checked against the slot model after every operation:
+// no overlaps, an allocation only fails when no free run fits & the free ranges are fully coalesced.
+VQE_TEST(DescriptorAllocator_Fuzz)
+{
+	constexpr uint32 NUM_DESCRIPTORS = 4096;
+	constexpr int    NUM_OPERATIONS  = 10000;
+	constexpr uint32 MAX_RANGE_SIZE  = 96;
+
+	DescriptorAllocator Allocator;
+	Allocator.Initialize(NUM_DESCRIPTORS);
+	FSlotModel Model;
+	Model.Slots.resize(NUM_DESCRIPTORS, FREE);
+
+	std::vector<FAllocation> Allocations;
+	std::vector<std::pair<FAllocation, uint64>> PendingFrees;
+	uint64 FenceValue = 0;
+	uint64 CompletedFenceValue = 0;
+
+	std::mt19937 rng(26);
+	std::uniform_int_distribution<int>    fnOperation(0, 99);
+	std::uniform_int_distribution<uint32> fnSize(1, MAX_RANGE_SIZE);
+	std::uniform_int_distribution<uint32> fnSmallSize(1, 4); // descriptor tables are mostly small
+
+	int NumFailedChecks = 0;
+	int NumAllocations = 0, NumFailedAllocations = 0, NumFrees = 0, NumDeferredFrees = 0;
+	auto fnCheck = [&](bool bCondition) { NumFailedChecks += bCondition ? 0 : 1; };
+	for (int iOperation = 0; iOperation < NUM_OPERATIONS && NumFailedChecks == 0; ++iOperation)
+	{
+		const int Operation = fnOperation(rng);
+		if (Operation < 50 || Allocations.empty())
+		{
+			const uint32 Count = (Operation % 2) ? fnSize(rng) : fnSmallSize(rng);
+			uint32 NumFreeRuns, LargestFreeRun;
+			Model.GetFreeRuns(NumFreeRuns, LargestFreeRun);
+
+			const uint32 Offset = Allocator.Allocate(Count);
+			if (Offset == DescriptorAllocator::INVALID_OFFSET)
+			{
+				fnCheck(LargestFreeRun < Count);
+				++NumFailedAllocations;
+			}
+			else
+			{
+				fnCheck(Offset + Count <= NUM_DESCRIPTORS && Model.IsRangeInState(Offset, Count, FREE));
+				Model.SetRangeState(Offset, Count, ALLOCATED);
+				Allocations.push_back({ Offset, Count });
+				++NumAllocations;
+			}
+		}
+		else if (Operation < 75)
+		{
+			const size_t i = std::uniform_int_distribution<size_t>(0, Allocations.size() - 1)(rng);
+			const FAllocation a = Allocations[i];
+			Allocations[i] = Allocations.back();
+			Allocations.pop_back();
+			Allocator.Free(a.Offset, a.Count);
+			Model.SetRangeState(a.Offset, a.Count, FREE);
+			++NumFrees;
+		}
+		else if (Operation < 95)
+		{
+			const size_t i = std::uniform_int_distribution<size_t>(0, Allocations.size() - 1)(rng);
+			const FAllocation a = Allocations[i];
+			Allocations[i] = Allocations.back();
+			Allocations.pop_back();
+			const uint64 FreeFenceValue = FenceValue + 1 + (rng() % 3);
+			Allocator.FreeDeferred(a.Offset, a.Count, FreeFenceValue);
+			Model.SetRangeState(a.Offset, a.Count, PENDING_FREE);
+			PendingFrees.push_back({ a, FreeFenceValue });
+			++NumDeferredFrees;
+		}
+		else // end of frame: the GPU completes a fence
+		{
+			++FenceValue;
+			CompletedFenceValue = FenceValue - (rng() % 2);
+			uint32 NumExpectedReleases = 0;
+			for (auto it = PendingFrees.begin(); it != PendingFrees.end();)
+			{
+				if (it->second > CompletedFenceValue)
+				{
+					++it;
+					continue;
+				}
+				Model.SetRangeState(it->first.Offset, it->first.Count, FREE);
+				NumExpectedReleases += it->first.Count;
+				it = PendingFrees.erase(it);
+			}
+			fnCheck(Allocator.ReleaseCompletedFrees(CompletedFenceValue) == NumExpectedReleases);
+		}
+
+		const DescriptorAllocator::FStatistics s = Allocator.GetStatistics();
+		uint32 NumFreeRuns, LargestFreeRun;
+		Model.GetFreeRuns(NumFreeRuns, LargestFreeRun);
+		fnCheck(s.NumAllocatedDescriptors == Model.CountSlots(ALLOCATED) + Model.CountSlots(PENDING_FREE));
+		fnCheck(s.NumPendingFreeDescriptors == Model.CountSlots(PENDING_FREE));
+		fnCheck(s.NumFreeDescriptors + s.NumAllocatedDescriptors == NUM_DESCRIPTORS);
+		fnCheck(s.NumAllocations == Allocations.size() + PendingFrees.size());
+		fnCheck(s.NumFreeRanges == NumFreeRuns);
+		fnCheck(s.LargestFreeRange == LargestFreeRun);
+	}
+	Test::Report("%d allocations (%d failed), %d frees, %d deferred frees", NumAllocations, NumFailedAllocations, NumFrees, NumDeferredFrees);
+	TEST_CHECK(NumFailedChecks == 0);
+	TEST_CHECK(NumFailedAllocations > 0); // the heap got full at some point
+
+	// everything back: a single free range
+	for (const FAllocation& a : Allocations)
+		Allocator.Free(a.Offset, a.Count);
+	Allocator.ReleaseCompletedFrees(~0ull);
+	const DescriptorAllocator::FStatistics s = Allocator.GetStatistics();
+	TEST_CHECK(s.NumAllocations == 0 && s.NumAllocatedDescriptors == 0 && s.NumPendingFreeDescriptors == 0);
+	TEST_CHECK(s.NumFreeRanges == 1 && s.LargestFreeRange == NUM_DESCRIPTORS);
+}
+
+// a deferred free keeps the range allocated until its fence completes
+VQE_TEST(DescriptorAllocator_DeferredFree)
+{
+	DescriptorAllocator Allocator;
+	Allocator.Initialize(16);
+	const uint32 a = Allocator.Allocate(16);
+	TEST_CHECK(a == 0);
+	TEST_CHECK(Allocator.Allocate(1) == DescriptorAllocator::INVALID_OFFSET);
+
+	Allocator.FreeDeferred(a, 16, 2);
+	TEST_CHECK(Allocator.Allocate(1) == DescriptorAllocator::INVALID_OFFSET);
+	TEST_CHECK(Allocator.ReleaseCompletedFrees(1) == 0);
+	TEST_CHECK(Allocator.Allocate(1) == DescriptorAllocator::INVALID_OFFSET);
+	TEST_CHECK(Allocator.ReleaseCompletedFrees(2) == 16);
+	TEST_CHECK(Allocator.Allocate(16) == 0);
+}
+
+// the smallest size class that fits is used, the lowest offset range in it
+VQE_TEST(DescriptorAllocator_SizeClasses)
+{
+	DescriptorAllocator Allocator;
+	Allocator.Initialize(64);
+	const uint32 a = Allocator.Allocate(8);  // [0, 8)
+	const uint32 b = Allocator.Allocate(1);  // [8, 9)
+	const uint32 c = Allocator.Allocate(2);  // [9, 11)
+	const uint32 d = Allocator.Allocate(1);  // [11, 12), the rest is a free range of 52
+	TEST_CHECK(a == 0 && b == 8 && c == 9 && d == 11);
+	Allocator.Free(a, 8);
+	Allocator.Free(c, 2);
+
+	TEST_CHECK(Allocator.Allocate(2) == 9);  // the 2-range, not the start of the 8-range
+	TEST_CHECK(Allocator.Allocate(5) == 0);  // the 8-range, not the 52-range
+	TEST_CHECK(Allocator.Allocate(3) == 5);  // the tail of the 8-range
+	TEST_CHECK(Allocator.Allocate(1) == 12);
+	TEST_CHECK(Allocator.GetStatistics().NumFreeRanges == 1);
+}
@@ -0,0 +1,192 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/FrameStatistics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+using ChannelID = FrameStatistics::ChannelID;
+
+static bool WriteTimingsCSV(const std::string& FilePath, const std::vector<std::string>& Columns, const std::vector<std::vector<float>>& Values)
+{
+	FILE* pFile = fopen(FilePath.c_str(), "w");
+	if (!pFile)
+		return false;
+	fprintf(pFile, "Frame");
+	for (const std::string& c : Columns)
+		fprintf(pFile, ",%s", c.c_str());
+	fprintf(pFile, "\n");
+	for (size_t i = 0; i < Values[0].size(); ++i)
+	{
+		fprintf(pFile, "%d", static_cast<int>(i));
+		for (const std::vector<float>& v : Values)
+			fprintf(pFile, ",%.9g", v[i]);
+		fprintf(pFile, "\n");
+	}
+	fclose(pFile);
+	return true;
+}
+
+// rank error of the estimates on skewed & uniform distributions
+VQE_TEST(FrameStatistics_P2QuantileRankError)
+{
+	constexpr int   NUM_SAMPLES = 100000;
+	constexpr float QUANTILES[5] = { 0.25f, 0.50f, 0.75f, 0.90f, 0.99f };
+	std::mt19937 rng(1337);
+	std::lognormal_distribution<float> LogNormal(2.8f, 0.25f); // frame-time like: ~16ms w/ a long tail
+	std::uniform_real_distribution<float> Uniform(0.0f, 10.0f);
+	for (int iDistribution = 0; iDistribution < 2; ++iDistribution)
+	{
+		P2Quantile Estimates[5] = { QUANTILES[0], QUANTILES[1], QUANTILES[2], QUANTILES[3], QUANTILES[4] };
+		std::vector<float> Samples(NUM_SAMPLES);
+		for (float& s : Samples)
+		{
+			s = iDistribution == 0 ? LogNormal(rng) : Uniform(rng);
+			for (P2Quantile& q : Estimates)
+				q.Add(s);
+		}
+		std::sort(Samples.begin(), Samples.end());
+		for (int q = 0; q < 5; ++q)
+		{
+			const float Estimate = Estimates[q].Get();
+			const double Rank = static_cast<double>(std::lower_bound(Samples.begin(), Samples.end(), Estimate) - Samples.begin()) / NUM_SAMPLES;
+			TEST_CHECK(std::abs(Rank - QUANTILES[q]) < 0.005);
+		}
+	}
+
+	P2Quantile Few(0.5f);
+	Few.Add(3.0f); Few.Add(1.0f); Few.Add(2.0f);
+	TEST_CHECK(Few.Get() == 2.0f);
+}
+
+// history ring buffer, summaries & outlier frames
+VQE_TEST(FrameStatistics_HistoryAndOutliers)
+{
+	constexpr size_t HISTORY_SIZE = 64;
+	constexpr int    NUM_FRAMES = 200;
+	FrameStatistics Stats;
+	Stats.Initialize(HISTORY_SIZE);
+	const ChannelID FrameMs  = Stats.RegisterChannel("FrameMs", true);
+	const ChannelID NumDraws = Stats.RegisterChannel("NumDraws", false);
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> Jitter(-0.5f, 0.5f);
+	for (int i = 0; i < NUM_FRAMES; ++i)
+	{
+		const bool bSpike = i == 100 || i == 150;
+		Stats.Record(FrameMs, bSpike ? 50.0f : 16.0f + Jitter(rng));
+		Stats.Record(NumDraws, static_cast<float>(i));
+		Stats.EndFrame();
+	}
+	TEST_CHECK(Stats.GetNumFrames() == NUM_FRAMES);
+	TEST_CHECK(Stats.GetHistoryCount() == HISTORY_SIZE);
+	bool bHistoryInOrder = true;
+	for (size_t i = 0; i < HISTORY_SIZE; ++i)
+		bHistoryInOrder &= Stats.GetHistoryData(NumDraws)[(Stats.GetHistoryOffset() + i) % HISTORY_SIZE] == static_cast<float>(NUM_FRAMES - HISTORY_SIZE + i);
+	TEST_CHECK(bHistoryInOrder);
+
+	const FrameStatistics::FChannelSummary s = Stats.GetSummary(FrameMs);
+	TEST_CHECK(std::abs(s.P50 - 16.0f) < 0.1f);
+	TEST_CHECK(s.Max == 50.0f && s.P99 < 50.0f);
+	TEST_CHECK(s.NumOutliers == 2);
+	TEST_CHECK(Stats.GetOutlierFrames().size() == 2);
+	TEST_CHECK(Stats.GetOutlierFrames().size() == 2 && Stats.GetOutlierFrames()[0].FrameIndex == 100 && Stats.GetOutlierFrames()[1].FrameIndex == 150);
+	TEST_CHECK(Stats.GetSummary(NumDraws).NumOutliers == 0);
+}
+
+// small exact case, same distribution & shifted distribution
+VQE_TEST(FrameStatistics_MannWhitney)
+{
+	const double p = FrameStatistics::MannWhitneyPValue({ 1, 2, 3, 4, 5 }, { 6, 7, 8, 9, 10 }); // exact one-sided p = 1/252
+	TEST_CHECK(p > 0.003 && p < 0.01);
+	TEST_CHECK(FrameStatistics::MannWhitneyPValue({ 6, 7, 8, 9, 10 }, { 1, 2, 3, 4, 5 }) > 0.99);
+	TEST_CHECK(FrameStatistics::MannWhitneyPValue({ 1, 1, 1 }, { 1, 1, 1 }) == 1.0);
+}
+
+// end to end: CSV files -> regression gate
+VQE_TEST(FrameStatistics_RegressionGate)
+{
+	constexpr int NUM_FRAMES = 600;
+	std::mt19937 rng(42);
+	std::lognormal_distribution<float> Noise(0.0f, 0.05f);
+	const std::vector<std::string> Columns = { "UpdateMs", "RenderMs", "UIMs", "NumDraws" };
+	std::vector<std::vector<float>> Baseline(Columns.size()), Candidate(Columns.size());
+	for (int i = 0; i < NUM_FRAMES; ++i)
+	{
+		Baseline[0].push_back(4.0f * Noise(rng));   Candidate[0].push_back(4.0f * Noise(rng));          // unchanged
+		Baseline[1].push_back(8.0f * Noise(rng));   Candidate[1].push_back(8.0f * 1.15f * Noise(rng));  // +15%: regression
+		Baseline[2].push_back(0.01f * Noise(rng));  Candidate[2].push_back(0.012f * Noise(rng));        // +20% but below MinRegressionMs
+		Baseline[3].push_back(100.0f);              Candidate[3].push_back(200.0f);                     // not a timing
+	}
+	const std::string BaselineFile  = Test::GetTempFilePath("FrameStatistics_Baseline.csv");
+	const std::string CandidateFile = Test::GetTempFilePath("FrameStatistics_Candidate.csv");
+	TEST_CHECK(WriteTimingsCSV(BaselineFile, Columns, Baseline));
+	TEST_CHECK(WriteTimingsCSV(CandidateFile, Columns, Candidate));
+
+	std::vector<std::string> ReadColumns;
+	std::vector<std::vector<float>> ReadValues;
+	std::string Error;
+	TEST_CHECK(FrameStatistics::ReadCSV(BaselineFile, ReadColumns, ReadValues, Error));
+	TEST_CHECK(ReadColumns.size() == Columns.size() + 1 && ReadValues.size() == ReadColumns.size() && ReadValues[2] == Baseline[1]);
+	TEST_CHECK(!FrameStatistics::ReadCSV(Test::GetTempFilePath("FrameStatistics_Missing.csv"), ReadColumns, ReadValues, Error) && !Error.empty());
+
+	const FrameStatistics::FRegressionTestParameters Params;
+	FrameStatistics::FRunComparison Comparison;
+	TEST_CHECK(!FrameStatistics::CompareRuns(BaselineFile, CandidateFile, Params, Comparison));
+	TEST_CHECK(Comparison.Error.empty());
+	TEST_CHECK(Comparison.Stages.size() == 3);
+	TEST_CHECK(Comparison.NumRegressions == 1);
+	for (const FrameStatistics::FStageComparison& c : Comparison.Stages)
+		TEST_CHECK(c.bRegression == (c.Name == "RenderMs"));
+	TEST_CHECK(FrameStatistics::FormatComparison(Comparison, Params).find("RenderMs") != std::string::npos);
+
+	FrameStatistics::FRunComparison SelfComparison;
+	TEST_CHECK(FrameStatistics::CompareRuns(BaselineFile, BaselineFile, Params, SelfComparison));
+	TEST_CHECK(SelfComparison.NumRegressions == 0);
+
+	std::error_code ec;
+	std::filesystem::remove(BaselineFile, ec);
+	std::filesystem::remove(CandidateFile, ec);
+}
+
+// cost of EndFrame()
+VQE_BENCHMARK(FrameStatistics_EndFrameCost)
+{
+	constexpr int NUM_CHANNELS = 64;
+	constexpr int NUM_FRAMES = 20000;
+	FrameStatistics Stats;
+	Stats.Initialize(1024);
+	for (int i = 0; i < NUM_CHANNELS; ++i)
+		Stats.RegisterChannel("Channel" + std::to_string(i) + "Ms", true);
+
+	const auto Start = std::chrono::steady_clock::now();
+	for (int iFrame = 0; iFrame < NUM_FRAMES; ++iFrame)
+	{
+		for (ChannelID c = 0; c < NUM_CHANNELS; ++c)
+			Stats.Record(c, static_cast<float>((iFrame * 31 + c * 17) % 97));
+		Stats.EndFrame();
+	}
+	const double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	Test::Report("%d frames x %d channels in %.2fms (%.2f us per frame)", NUM_FRAMES, NUM_CHANNELS, ElapsedMs, ElapsedMs * 1000.0 / NUM_FRAMES);
+	TEST_CHECK(Stats.GetNumFrames() == NUM_FRAMES);
+}
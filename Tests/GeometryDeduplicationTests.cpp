@@ -0,0 +1,381 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/GeometryDeduplication.h"
+#include "Source/Engine/Geometry.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	using FTestGeometry = GeometryGenerator::GeometryData<FVertexWithNormalAndTangent>;
+	using EMatch = GeometryDeduplicator::EMatch;
+
+	// row vector convention: p' = p * L + T
+	struct FAffineTransform
+	{
+		double L[3][3];
+		double T[3];
+	};
+
+	struct FTestFamily
+	{
+		FTestGeometry Canonical;
+		int           MirroredFamily = -1;
+		uint32        FirstMember = 0xFFFFFFFF;
+	};
+
+	struct FTestGeometryInfo
+	{
+		uint32           Family;
+		FAffineTransform Xform; // from the family's canonical geometry
+	};
+
+	struct FTestScene
+	{
+		std::vector<FTestFamily>                  Families;
+		std::vector<FTestGeometry>                TestGeometries;
+		std::vector<FTestGeometryInfo>            Infos;
+		std::vector<GeometryDeduplicator::FGeometry> Geometries; // views of TestGeometries
+	};
+
+	inline double Dot(const double a[3], const double b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+	inline void TransformRow(const double v[3], const double m[3][3], double o[3])
+	{
+		for (int c = 0; c < 3; ++c)
+			o[c] = v[0] * m[0][c] + v[1] * m[1][c] + v[2] * m[2][c];
+	}
+	void InverseTranspose(const double m[3][3], double o[3][3])
+	{
+		const double Det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+			             - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+		const double InvDet = 1.0 / Det;
+		o[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * InvDet;
+		o[1][0] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * InvDet;
+		o[2][0] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * InvDet;
+		o[0][1] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * InvDet;
+		o[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * InvDet;
+		o[2][1] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * InvDet;
+		o[0][2] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * InvDet;
+		o[1][2] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * InvDet;
+		o[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * InvDet;
+	}
+
+	// of the bounding box, the position tolerance is relative to it
+	double CalculateDiagonal(const FTestGeometry& g)
+	{
+		double Min[3] = { g.Vertices[0].position[0], g.Vertices[0].position[1], g.Vertices[0].position[2] };
+		double Max[3] = { Min[0], Min[1], Min[2] };
+		for (const FVertexWithNormalAndTangent& v : g.Vertices)
+		{
+			for (int d = 0; d < 3; ++d)
+			{
+				Min[d] = std::min<double>(Min[d], v.position[d]);
+				Max[d] = std::max<double>(Max[d], v.position[d]);
+			}
+		}
+		const double Extent[3] = { Max[0] - Min[0], Max[1] - Min[1], Max[2] - Min[2] };
+		return std::sqrt(Dot(Extent, Extent));
+	}
+
+	FAffineTransform GenerateRandomTransform(std::mt19937& rng, bool bMirror)
+	{
+		std::uniform_real_distribution<double> fnAngle(0.0, 6.2831853);
+		std::uniform_real_distribution<double> fnScale(0.5, 2.0);
+		std::uniform_real_distribution<double> fnTranslation(-10.0, 10.0);
+
+		const double x = fnAngle(rng), y = fnAngle(rng), z = fnAngle(rng);
+		const double Rx[3][3] = { {1, 0, 0}, {0, std::cos(x), std::sin(x)}, {0, -std::sin(x), std::cos(x)} };
+		const double Ry[3][3] = { {std::cos(y), 0, -std::sin(y)}, {0, 1, 0}, {std::sin(y), 0, std::cos(y)} };
+		const double Rz[3][3] = { {std::cos(z), std::sin(z), 0}, {-std::sin(z), std::cos(z), 0}, {0, 0, 1} };
+		const double S[3] = { fnScale(rng) * (bMirror ? -1.0 : 1.0), fnScale(rng), fnScale(rng) };
+
+		// L = S * Rx * Ry * Rz
+		double SRx[3][3], SRxRy[3][3];
+		FAffineTransform Xform;
+		for (int r = 0; r < 3; ++r) for (int c = 0; c < 3; ++c) SRx[r][c]     = S[r] * Rx[r][c];
+		for (int r = 0; r < 3; ++r) for (int c = 0; c < 3; ++c) SRxRy[r][c]   = SRx[r][0] * Ry[0][c] + SRx[r][1] * Ry[1][c] + SRx[r][2] * Ry[2][c];
+		for (int r = 0; r < 3; ++r) for (int c = 0; c < 3; ++c) Xform.L[r][c] = SRxRy[r][0] * Rz[0][c] + SRxRy[r][1] * Rz[1][c] + SRxRy[r][2] * Rz[2][c];
+		for (int d = 0; d < 3; ++d) Xform.T[d] = fnTranslation(rng);
+		return Xform;
+	}
+
+	FTestGeometry TransformGeometry(const FTestGeometry& In, const FAffineTransform& Xform)
+	{
+		double NormalMatrix[3][3];
+		InverseTranspose(Xform.L, NormalMatrix);
+
+		auto fnStoreDirection = [](const double v[3], float Out[3])
+		{
+			const double Len = std::sqrt(Dot(v, v));
+			for (int d = 0; d < 3; ++d)
+				Out[d] = Len > 1e-12 ? static_cast<float>(v[d] / Len) : 0.0f;
+		};
+
+		FTestGeometry Out = In;
+		for (FVertexWithNormalAndTangent& v : Out.Vertices)
+		{
+			const double p[3] = { v.position[0], v.position[1], v.position[2] };
+			const double n[3] = { v.normal[0]  , v.normal[1]  , v.normal[2]   };
+			const double t[3] = { v.tangent[0] , v.tangent[1] , v.tangent[2]  };
+			double pT[3], nT[3], tT[3];
+			TransformRow(p, Xform.L, pT);
+			TransformRow(n, NormalMatrix, nT);
+			TransformRow(t, Xform.L, tT);
+			for (int d = 0; d < 3; ++d)
+				v.position[d] = static_cast<float>(pT[d] + Xform.T[d]);
+			fnStoreDirection(nT, v.normal);
+			fnStoreDirection(tT, v.tangent);
+		}
+		return Out;
+	}
+
+	FTestGeometry GenerateBaseGeometry(std::mt19937& rng, bool& bPlanar)
+	{
+		using namespace GeometryGenerator;
+		std::uniform_int_distribution<int> fnShape(0, 4);
+		std::uniform_int_distribution<int> fnTessellation(12, 24); // >= the generators' min LOD tessellation
+		std::uniform_real_distribution<float> fnSize(0.5f, 4.0f);
+		const int Shape = fnShape(rng);
+		bPlanar = Shape == 4;
+		switch (Shape)
+		{
+		case 0 : return Sphere<FVertexWithNormalAndTangent>(fnSize(rng), fnTessellation(rng), fnTessellation(rng));
+		case 1 : return Cube<FVertexWithNormalAndTangent>();
+		case 2 : return Cylinder<FVertexWithNormalAndTangent>(fnSize(rng), fnSize(rng), fnSize(rng), fnTessellation(rng), fnTessellation(rng) / 3);
+		case 3 : return Cone<FVertexWithNormalAndTangent>(fnSize(rng), fnSize(rng), fnTessellation(rng));
+		default: return Grid<FVertexWithNormalAndTangent>(fnSize(rng), fnSize(rng), fnTessellation(rng), fnTessellation(rng)); // planar
+		}
+	}
+
+	// procedural shapes w/ jittered vertices are unique, copies of them are (re-)transformed, mirrored,
+	// perturbed under the tolerance & have their triangles reordered
+	FTestScene GenerateTestScene(uint32 NumGeometries, const GeometryDeduplicator::FSettings& Settings)
+	{
+		enum ECopyType { UNIQUE_JITTERED, EXACT_COPY, TRANSFORMED_COPY, NOISY_COPY, MIRRORED_COPY };
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		auto fnRandomIndex = [&](size_t Count) { return std::uniform_int_distribution<size_t>(0, Count - 1)(rng); };
+
+		FTestScene Scene;
+		std::vector<FTestFamily>&       Families = Scene.Families;
+		std::vector<FTestGeometry>&     TestGeometries = Scene.TestGeometries;
+		std::vector<FTestGeometryInfo>& Infos = Scene.Infos;
+		TestGeometries.resize(NumGeometries);
+		Infos.resize(NumGeometries);
+		FAffineTransform Identity = {};
+		Identity.L[0][0] = Identity.L[1][1] = Identity.L[2][2] = 1.0;
+
+		auto fnJitter = [&](FTestGeometry& g, double Amount, bool bKeepPlanar)
+		{
+			std::uniform_real_distribution<double> fnOffset(-Amount, Amount);
+			for (FVertexWithNormalAndTangent& v : g.Vertices)
+				for (int d = 0; d < 3; ++d)
+					if (!bKeepPlanar || d != 1) // grids are on the XZ plane
+						v.position[d] += static_cast<float>(fnOffset(rng));
+		};
+		auto fnShuffleTriangles = [&](FTestGeometry& g)
+		{
+			std::vector<std::array<uint32, 3>> Triangles(g.Indices.size() / 3);
+			for (size_t iTri = 0; iTri < Triangles.size(); ++iTri)
+			{
+				const uint32 r = static_cast<uint32>(fnRandomIndex(3));
+				for (uint32 k = 0; k < 3; ++k)
+					Triangles[iTri][k] = g.Indices[iTri * 3 + (k + r) % 3];
+			}
+			std::shuffle(Triangles.begin(), Triangles.end(), rng);
+			for (size_t iTri = 0; iTri < Triangles.size(); ++iTri)
+				for (uint32 k = 0; k < 3; ++k)
+					g.Indices[iTri * 3 + k] = Triangles[iTri][k];
+		};
+		auto fnAddToFamily = [&](uint32 i, uint32 iFamily, const FAffineTransform& Xform)
+		{
+			Infos[i] = { iFamily, Xform };
+			if (Families[iFamily].FirstMember == 0xFFFFFFFF)
+				Families[iFamily].FirstMember = i;
+			TestGeometries[i] = TransformGeometry(Families[iFamily].Canonical, Xform);
+		};
+
+		for (uint32 i = 0; i < NumGeometries; ++i)
+		{
+			const float r = fnUnit(rng);
+			const ECopyType Type = i == 0 ? UNIQUE_JITTERED
+				: r < 0.20f ? UNIQUE_JITTERED
+				: r < 0.45f ? EXACT_COPY
+				: r < 0.75f ? TRANSFORMED_COPY
+				: r < 0.90f ? NOISY_COPY
+				: MIRRORED_COPY;
+
+			switch (Type)
+			{
+			case UNIQUE_JITTERED:
+			{
+				FTestFamily Family;
+				bool bPlanar = false;
+				Family.Canonical = GenerateBaseGeometry(rng, bPlanar);
+				fnJitter(Family.Canonical, 0.01 * CalculateDiagonal(Family.Canonical), bPlanar);
+				Families.push_back(std::move(Family));
+				fnAddToFamily(i, static_cast<uint32>(Families.size() - 1), Identity);
+			} break;
+			case EXACT_COPY:
+			{
+				const uint32 iOther = static_cast<uint32>(fnRandomIndex(i));
+				fnAddToFamily(i, Infos[iOther].Family, Infos[iOther].Xform);
+			} break;
+			case TRANSFORMED_COPY:
+			{
+				const uint32 iOther = static_cast<uint32>(fnRandomIndex(i));
+				fnAddToFamily(i, Infos[iOther].Family, GenerateRandomTransform(rng, false));
+			} break;
+			case NOISY_COPY:
+			{
+				// noise relative to the source: transforming noisy anchors would amplify it
+				const uint32 iFamily = Infos[fnRandomIndex(i)].Family;
+				const uint32 iSource = Families[iFamily].FirstMember;
+				fnAddToFamily(i, iFamily, Infos[iSource].Xform);
+				fnJitter(TestGeometries[i], 0.1 * Settings.PositionTolerance * CalculateDiagonal(TestGeometries[i]), false);
+			} break;
+			case MIRRORED_COPY:
+			{
+				// mirrored copies can't share the source's buffers (winding order), but do share each other's
+				const uint32 iFamily = Infos[fnRandomIndex(i)].Family;
+				if (Families[iFamily].MirroredFamily == -1)
+				{
+					FTestFamily Mirrored;
+					Mirrored.Canonical = TransformGeometry(Families[iFamily].Canonical, GenerateRandomTransform(rng, true));
+					Mirrored.MirroredFamily = static_cast<int>(iFamily); // mirroring twice doesn't mirror
+					Families[iFamily].MirroredFamily = static_cast<int>(Families.size());
+					Families.push_back(std::move(Mirrored));
+				}
+				const uint32 iMirroredFamily = static_cast<uint32>(Families[iFamily].MirroredFamily);
+				fnAddToFamily(i, iMirroredFamily, Families[iMirroredFamily].FirstMember == 0xFFFFFFFF ? Identity : GenerateRandomTransform(rng, false));
+			} break;
+			}
+
+			if (Type != UNIQUE_JITTERED && fnUnit(rng) < 0.3f)
+				fnShuffleTriangles(TestGeometries[i]);
+		}
+
+		Scene.Geometries.resize(NumGeometries);
+		for (uint32 i = 0; i < NumGeometries; ++i)
+		{
+			const FTestGeometry& g = TestGeometries[i];
+			Scene.Geometries[i] = { g.Vertices.data(), static_cast<uint32>(g.Vertices.size()), g.Indices.data(), static_cast<uint32>(g.Indices.size()) };
+		}
+		return Scene;
+	}
+}
+
+VQE_TEST(GeometryDeduplication_ProceduralCopies)
+{
+	constexpr uint32 NUM_GEOMETRIES = 1000;
+	const GeometryDeduplicator::FSettings Settings;
+	const FTestScene Scene = GenerateTestScene(NUM_GEOMETRIES, Settings);
+
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "GeometryDedupTestWorkers");
+	const uint32 NumWorkers = static_cast<uint32>(Workers.GetThreadPoolSize());
+	const GeometryDeduplicator::FResult Serial   = GeometryDeduplicator::Deduplicate(Scene.Geometries, Settings, nullptr);
+	const GeometryDeduplicator::FResult Parallel = GeometryDeduplicator::Deduplicate(Scene.Geometries, Settings, &Workers);
+	Workers.Destroy();
+
+	// ground truth: each family is represented by its first member
+	uint32 NumMismatches = 0;
+	uint32 NumTransformErrors = 0;
+	for (uint32 i = 0; i < NUM_GEOMETRIES; ++i)
+	{
+		const uint32 iSource = Scene.Families[Scene.Infos[i].Family].FirstMember;
+		const bool bSameTransform = std::memcmp(&Scene.Infos[i].Xform, &Scene.Infos[iSource].Xform, sizeof(FAffineTransform)) == 0;
+		const EMatch Expected = i == iSource ? EMatch::UNIQUE : bSameTransform ? EMatch::EXACT_DUPLICATE : EMatch::TRANSFORMED_COPY;
+		if (Parallel.SourceIndices[i] != iSource || Parallel.Matches[i] != Expected)
+		{
+			++NumMismatches;
+			continue;
+		}
+
+		// the returned transform maps the source onto the geometry
+		const GeometryDeduplicator::FGeometry& Src = Scene.Geometries[iSource];
+		const GeometryDeduplicator::FGeometry& Dst = Scene.Geometries[i];
+		const XMFLOAT4X4& m = Parallel.Transforms[i];
+		const double Tolerance = 2.0 * Settings.PositionTolerance * CalculateDiagonal(Scene.TestGeometries[i]);
+		for (uint32 v = 0; v < Dst.NumVertices; ++v)
+		{
+			const float* p = Src.pVertices[v].position;
+			double Delta[3];
+			for (int c = 0; c < 3; ++c)
+				Delta[c] = p[0] * m.m[0][c] + p[1] * m.m[1][c] + p[2] * m.m[2][c] + m.m[3][c] - Dst.pVertices[v].position[c];
+			if (Dot(Delta, Delta) > Tolerance * Tolerance)
+			{
+				++NumTransformErrors;
+				break;
+			}
+		}
+	}
+
+	const GeometryDeduplicator::FStatistics& s = Parallel.Stats;
+	Test::Report("%u geometries, %u families", NUM_GEOMETRIES, static_cast<uint32>(Scene.Families.size()));
+	Test::Report("unique         : %8u", s.NumUniqueGeometries);
+	Test::Report("duplicates     : %8u exact, %u transformed", s.NumExactDuplicates, s.NumTransformedCopies);
+	Test::Report("memory         : %8.2f MB -> %.2f MB, %.2f MB saved (%.2fx)", s.InputBytes / (1024.0 * 1024.0), s.UniqueBytes / (1024.0 * 1024.0), s.SavedBytes / (1024.0 * 1024.0), s.DedupRatio);
+	Test::Report("time           : %8.2f ms serial, %.2f ms w/ %u workers", Serial.Stats.DeduplicationTimeMs, s.DeduplicationTimeMs, NumWorkers);
+
+	TEST_CHECK(NumMismatches == 0);
+	TEST_CHECK(NumTransformErrors == 0);
+	TEST_CHECK(s.NumExactDuplicates > 0 && s.NumTransformedCopies > 0);
+
+	// the result doesn't depend on the thread count
+	TEST_CHECK(Serial.SourceIndices == Parallel.SourceIndices);
+	TEST_CHECK(Serial.Matches == Parallel.Matches);
+	TEST_CHECK(std::memcmp(Serial.Transforms.data(), Parallel.Transforms.data(), sizeof(XMFLOAT4X4) * NUM_GEOMETRIES) == 0);
+}
+
+VQE_TEST(GeometryDeduplication_TransformedCopiesDisabled)
+{
+	constexpr uint32 NUM_GEOMETRIES = 200;
+	GeometryDeduplicator::FSettings Settings;
+	Settings.bDetectTransformedCopies = false;
+	const FTestScene Scene = GenerateTestScene(NUM_GEOMETRIES, Settings);
+	const GeometryDeduplicator::FResult Result = GeometryDeduplicator::Deduplicate(Scene.Geometries, Settings, nullptr);
+
+	// only the copies w/ the same transform as their source share its buffers
+	uint32 NumMismatches = 0;
+	for (uint32 i = 0; i < NUM_GEOMETRIES; ++i)
+	{
+		const uint32 iSource = Scene.Families[Scene.Infos[i].Family].FirstMember;
+		const bool bExactCopy = i != iSource && std::memcmp(&Scene.Infos[i].Xform, &Scene.Infos[iSource].Xform, sizeof(FAffineTransform)) == 0;
+		const bool bMatch = bExactCopy
+			? Result.SourceIndices[i] == iSource && Result.Matches[i] == EMatch::EXACT_DUPLICATE
+			: Result.Matches[i] != EMatch::TRANSFORMED_COPY;
+		NumMismatches += bMatch ? 0 : 1;
+	}
+	TEST_CHECK(NumMismatches == 0);
+	TEST_CHECK(Result.Stats.NumTransformedCopies == 0);
+	TEST_CHECK(Result.Stats.NumExactDuplicates > 0);
+	TEST_CHECK(Result.Stats.NumGeometries == NUM_GEOMETRIES);
+}
@@ -0,0 +1,210 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/Core/Input.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	struct FKeyEvent
+	{
+		KeyCode Key;
+		bool    bDown;
+		bool    bMouse;
+	};
+
+	// one frame of the message loop: the input events, then the update queries the actions
+	void RunFrame(Input& input, const std::vector<FKeyEvent>& Events)
+	{
+		for (const FKeyEvent& e : Events)
+		{
+			if (e.bDown) input.UpdateKeyDown(KeyDownEventData(e.Key, e.bMouse, false));
+			else         input.UpdateKeyUp(e.Key, e.bMouse);
+		}
+		input.PreUpdate();
+	}
+	FKeyEvent Down(KeyCode Key) { return { Key, true, false }; }
+	FKeyEvent Up(KeyCode Key)   { return { Key, false, false }; }
+}
+
+VQE_TEST(Input_ParseBindings)
+{
+	InputActionMap Map;
+	TEST_CHECK(Map.RegisterAction("ZoomIn", { "Numpad+", "Ctrl++" }) == 0);
+	TEST_CHECK(Map.RegisterAction("Select", { "MouseLeft" }) == 1);
+	TEST_CHECK(Map.RegisterAction("Broken", { "Ctrl+NotAKey" }) == INVALID_ID);
+	TEST_CHECK(Map.GetActionID("Broken") == INVALID_ID);
+	TEST_CHECK(Map.RegisterAction("ZoomIn", { "PageUp" }) == 0); // adds a binding
+	TEST_CHECK(Map.GetNumActions() == 2);
+	TEST_CHECK(Map.GetBindings().size() == 4);
+
+	const InputActionMap::FBinding& CtrlPlus = Map.GetBindings()[1];
+	TEST_CHECK(CtrlPlus.Modifiers.count() == 1 && CtrlPlus.Modifiers[VK_CONTROL]);
+	TEST_CHECK(CtrlPlus.Keys.count() == 1 && CtrlPlus.Keys[VK_ADD]);
+	TEST_CHECK(CtrlPlus.ExcludedModifiers[VK_SHIFT] && CtrlPlus.ExcludedModifiers[VK_MENU] && !CtrlPlus.ExcludedModifiers[VK_CONTROL]);
+
+	InputActionMap ModifierOnly;
+	TEST_CHECK(ModifierOnly.RegisterAction("Sprint", { "Shift" }) == 0);
+	TEST_CHECK(ModifierOnly.GetBindings()[0].Keys[VK_SHIFT] && ModifierOnly.GetBindings()[0].Modifiers.none());
+}
+
+// the scene hotkeys: C, Shift+C & Ctrl+C don't fire each other
+VQE_TEST(Input_ModifierExclusiveBindings)
+{
+	InputActionMap Map;
+	const ActionID NextCamera     = Map.RegisterAction("NextCamera"    , { "C" });
+	const ActionID PreviousCamera = Map.RegisterAction("PreviousCamera", { "Shift+C" });
+	const ActionID DumpCameraInfo = Map.RegisterAction("DumpCameraInfo", { "Ctrl+C" });
+	const ActionID Redo           = Map.RegisterAction("Redo"          , { "Ctrl+Shift+Z" });
+	Input input;
+	input.SetActionMap(&Map);
+
+	RunFrame(input, { Down('C') });
+	TEST_CHECK(input.IsActionTriggered(NextCamera) && !input.IsActionTriggered(PreviousCamera) && !input.IsActionTriggered(DumpCameraInfo));
+	input.PostUpdate();
+	RunFrame(input, { Up('C') });
+	TEST_CHECK(input.IsActionReleased(NextCamera));
+	input.PostUpdate();
+
+	RunFrame(input, { Down(VK_SHIFT), Down('C') });
+	TEST_CHECK(input.IsActionTriggered(PreviousCamera) && !input.IsActionTriggered(NextCamera) && !input.IsActionTriggered(DumpCameraInfo));
+	input.PostUpdate();
+	RunFrame(input, { Up(VK_SHIFT) }); // C still held: the plain binding isn't triggered by releasing the modifier
+	TEST_CHECK(input.IsActionReleased(PreviousCamera));
+	TEST_CHECK(input.IsActionDown(NextCamera) && !input.IsActionTriggered(NextCamera));
+	input.PostUpdate();
+	RunFrame(input, { Up('C') });
+	input.PostUpdate();
+
+	RunFrame(input, { Down(VK_CONTROL), Down(VK_SHIFT), Down('Z') });
+	TEST_CHECK(input.IsActionTriggered(Redo));
+	input.PostUpdate();
+	RunFrame(input, { Up(VK_SHIFT), Up('Z'), Down('C') });
+	TEST_CHECK(input.IsActionReleased(Redo) && input.IsActionTriggered(DumpCameraInfo) && !input.IsActionTriggered(NextCamera));
+	input.PostUpdate();
+
+	input.SetInputBypassing(true);
+	RunFrame(input, { Up('C'), Up(VK_CONTROL) });
+	input.PostUpdate();
+	RunFrame(input, { Down('C') });
+	TEST_CHECK(!input.IsActionTriggered(NextCamera) && !input.IsActionDown(NextCamera));
+}
+
+// random key & mouse streams against the binding rules: down while the modifiers & keys are held w/o any other
+// modifier, triggered on the first down frame of the keys, released on the first frame it's not down anymore
+VQE_TEST(Input_SyntheticKeyStream)
+{
+	struct FReferenceBinding { std::vector<size_t> Modifiers, Keys; ActionID Action; };
+	const std::vector<std::pair<std::string, std::string>> Bindings =
+	{
+		{ "NextCamera", "C" }, { "PreviousCamera", "Shift+C" }, { "DumpCameraInfo", "Ctrl+C" },
+		{ "NextEnvironmentMap", "PageUp" }, { "PreviousEnvironmentMap", "PageDown" },
+		{ "Redo", "Ctrl+Shift+Z" }, { "Undo", "Ctrl+Z" }, { "Sprint", "Shift" },
+		{ "Select", "MouseLeft" }, { "AddToSelection", "Shift+MouseLeft" }, { "Orbit", "Alt+MouseLeft+MouseRight" },
+		{ "ToggleAnimation", "Space" }, { "ToggleAnimation", "Alt+A" }, // 2 bindings, 1 action
+	};
+	const std::vector<std::pair<KeyCode, bool>> Keys = // key, bMouse
+	{
+		{ VK_SHIFT, false }, { VK_CONTROL, false }, { VK_MENU, false }, { 'C', false }, { 'Z', false }, { 'A', false },
+		{ VK_PRIOR, false }, { VK_NEXT, false }, { VK_SPACE, false },
+		{ Input::MOUSE_BUTTON_LEFT, true }, { Input::MOUSE_BUTTON_RIGHT, true },
+	};
+	auto fnInputCode = [](const std::pair<KeyCode, bool>& Key) -> size_t
+	{
+		if (!Key.second)
+			return Key.first;
+		return NUM_MAX_KEYS + (Key.first == Input::MOUSE_BUTTON_LEFT ? 0 : 1);
+	};
+
+	InputActionMap Map;
+	std::vector<FReferenceBinding> ReferenceBindings;
+	for (const std::pair<std::string, std::string>& b : Bindings)
+	{
+		const ActionID Action = Map.RegisterAction(b.first, { b.second });
+		TEST_CHECK(Action != INVALID_ID);
+		FReferenceBinding r = { {}, {}, Action };
+		size_t Begin = 0;
+		const std::string& Chord = b.second;
+		const bool bSingleKey = Chord.find('+') == std::string::npos;
+		while (Begin <= Chord.size())
+		{
+			const size_t End = std::min(Chord.find('+', Begin), Chord.size());
+			size_t Code = 0;
+			TEST_CHECK(Input::GetInputCode(Chord.substr(Begin, End - Begin), Code));
+			const bool bModifier = Code == VK_SHIFT || Code == VK_CONTROL || Code == VK_MENU;
+			(bModifier && !bSingleKey ? r.Modifiers : r.Keys).push_back(Code);
+			Begin = End + 1;
+		}
+		ReferenceBindings.push_back(r);
+	}
+
+	Input input;
+	input.SetActionMap(&Map);
+	std::mt19937 rng(31);
+	std::vector<bool> bHeld(NUM_INPUT_CODES, false), bHeldPrevious(NUM_INPUT_CODES, false);
+	std::vector<bool> bActionDownPrevious(Map.GetNumActions(), false);
+	int NumMismatches = 0, NumTriggers = 0;
+	constexpr int NUM_FRAMES = 20000;
+	for (int iFrame = 0; iFrame < NUM_FRAMES; ++iFrame)
+	{
+		// 0-3 key transitions per frame
+		std::vector<FKeyEvent> Events;
+		const int NumEvents = rng() % 4;
+		for (int i = 0; i < NumEvents; ++i)
+		{
+			const std::pair<KeyCode, bool>& Key = Keys[rng() % Keys.size()];
+			const size_t Code = fnInputCode(Key);
+			const bool bDown = !bHeld[Code];
+			bHeld[Code] = bDown;
+			Events.push_back({ Key.first, bDown, Key.second });
+		}
+		RunFrame(input, Events);
+
+		std::vector<bool> bActionDown(Map.GetNumActions(), false), bActionTriggered(Map.GetNumActions(), false);
+		for (const FReferenceBinding& r : ReferenceBindings)
+		{
+			bool bDown = true, bKeysHeldPrevious = true;
+			for (size_t m : r.Modifiers) bDown &= bHeld[m];
+			for (size_t k : r.Keys)    { bDown &= bHeld[k]; bKeysHeldPrevious &= bHeldPrevious[k]; }
+			for (size_t Modifier : { VK_SHIFT, VK_CONTROL, VK_MENU })
+			{
+				const bool bPartOfBinding = std::find(r.Modifiers.begin(), r.Modifiers.end(), Modifier) != r.Modifiers.end()
+					|| std::find(r.Keys.begin(), r.Keys.end(), Modifier) != r.Keys.end();
+				bDown &= bPartOfBinding || !bHeld[Modifier];
+			}
+			bActionDown[r.Action] = bActionDown[r.Action] || bDown;
+			bActionTriggered[r.Action] = bActionTriggered[r.Action] || (bDown && !bKeysHeldPrevious);
+		}
+		for (ActionID a = 0; a < Map.GetNumActions(); ++a)
+		{
+			NumMismatches += input.IsActionDown(a)      != bActionDown[a] ? 1 : 0;
+			NumMismatches += input.IsActionTriggered(a) != bActionTriggered[a] ? 1 : 0;
+			NumMismatches += input.IsActionReleased(a)  != (bActionDownPrevious[a] && !bActionDown[a]) ? 1 : 0;
+			NumTriggers += bActionTriggered[a] ? 1 : 0;
+		}
+		input.PostUpdate();
+		bHeldPrevious = bHeld;
+		bActionDownPrevious = bActionDown;
+	}
+	Test::Report("%d frames, %d action triggers, %d mismatches", NUM_FRAMES, NumTriggers, NumMismatches);
+	TEST_CHECK(NumTriggers > 0);
+	TEST_CHECK(NumMismatches == 0);
+}
@@ -0,0 +1,331 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/InstanceBatching.h"
+#include "Shaders/LightingConstantBufferData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// StressTestScene: cubes & spheres, ~400 materials (8 roughness x 10 metallic x 5 colors) + 2 checkerboards
+	constexpr MeshID CUBE_MESH_ID   = 2;
+	constexpr MeshID SPHERE_MESH_ID = 3;
+	constexpr int    NUM_MATERIALS  = 8 * 10 * 5 + 2;
+
+	std::vector<FMeshRenderCommand> CreateStressTestCommands(uint32 NumObjects, int NumMaterials)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<int> fnMaterial(0, NumMaterials - 1);
+		std::uniform_int_distribution<int> fnMesh(0, 1);
+		std::uniform_real_distribution<float> fnPos(-300.0f, 300.0f);
+
+		std::vector<FMeshRenderCommand> MeshRenderCommands(NumObjects);
+		for (FMeshRenderCommand& cmd : MeshRenderCommands)
+		{
+			cmd.meshID = fnMesh(rng) == 0 ? CUBE_MESH_ID : SPHERE_MESH_ID;
+			cmd.matID  = fnMaterial(rng);
+			cmd.matWorldTransformation     = XMMatrixTranslation(fnPos(rng), fnPos(rng), fnPos(rng));
+			cmd.matWorldTransformationPrev = cmd.matWorldTransformation;
+			cmd.matNormalTransformation    = XMMatrixIdentity();
+		}
+		return MeshRenderCommands;
+	}
+
+	//
+	// Submission model of the forward lighting pass, see VQEngine::RenderSceneColor() & DrawInstancedMeshRenderCommands():
+	// the command list appends its calls to a command stream and the constant buffer heap is a linear upload heap,
+	// as the D3D12 runtime does, without the driver's cost. Each draw looks up its mesh & material the way the scene does.
+	//
+	class FMockCommandList
+	{
+	public:
+		void Reset() { mStream.clear(); }
+		void SetGraphicsRootConstantBufferView(uint32 Slot, uint64 Address)      { Write(0, Slot, Address); }
+		void SetGraphicsRootDescriptorTable(uint32 Slot, uint64 DescriptorHandle) { Write(1, Slot, DescriptorHandle); }
+		void IASetPrimitiveTopology(uint32 Topology)                              { Write(2, Topology); }
+		void IASetVertexBuffers(uint64 Address, uint32 Size, uint32 Stride)       { Write(3, Address, Size, Stride); }
+		void IASetIndexBuffer(uint64 Address, uint32 Size, uint32 Format)         { Write(4, Address, Size, Format); }
+		void DrawIndexedInstanced(uint32 NumIndices, uint32 NumInstances, uint32 FirstIndex) { Write(5, NumIndices, NumInstances, FirstIndex); }
+		inline size_t GetStreamSize() const { return mStream.size(); }
+
+	private:
+		template<class... TArgs> void Write(uint32 Opcode, TArgs... Args)
+		{
+			size_t Offset = mStream.size();
+			mStream.resize(Offset + sizeof(Opcode) + (sizeof(Args) + ... + 0));
+			std::memcpy(&mStream[Offset], &Opcode, sizeof(Opcode)); Offset += sizeof(Opcode);
+			((std::memcpy(&mStream[Offset], &Args, sizeof(Args)), Offset += sizeof(Args)), ...);
+		}
+		std::vector<uint8> mStream;
+	};
+	class FMockUploadHeap
+	{
+	public:
+		explicit FMockUploadHeap(size_t Size) : mMemory(Size) {}
+		void Reset() { mOffset = 0; }
+		void* AllocConstantBuffer(size_t Size, uint64* pOutAddress)
+		{
+			const size_t AlignedSize = (Size + 255) & ~size_t(255);
+			if (mOffset + AlignedSize > mMemory.size())
+				mOffset = 0; // wraps around like the per-frame ring buffer
+			*pOutAddress = mOffset;
+			void* pMemory = &mMemory[mOffset];
+			mOffset += AlignedSize;
+			return pMemory;
+		}
+
+	private:
+		std::vector<uint8> mMemory;
+		size_t mOffset = 0;
+	};
+	struct FMockMesh     { uint64 VBAddress, IBAddress; uint32 NumIndices; };
+	struct FMockMaterial { VQ_SHADER_DATA::MaterialData Data; uint64 SRVMaterialMaps; };
+	struct FMockScene
+	{
+		std::unordered_map<MeshID, FMockMesh> Meshes;
+		std::unordered_map<MaterialID, FMockMaterial> Materials;
+		XMMATRIX viewProj, viewProjPrev;
+	};
+
+	FMockScene CreateMockScene(int NumMaterials)
+	{
+		FMockScene Scene;
+		Scene.Meshes[CUBE_MESH_ID]   = { 0x1000, 0x2000, 36 };
+		Scene.Meshes[SPHERE_MESH_ID] = { 0x3000, 0x4000, 2880 };
+		for (int i = 0; i < NumMaterials; ++i)
+		{
+			FMockMaterial& Material = Scene.Materials[i];
+			Material.Data = {};
+			Material.Data.roughness = (i % 8) / 8.0f;
+			Material.Data.metalness = (i % 10) / 10.0f;
+			Material.SRVMaterialMaps = 0x10000 + i * 64;
+		}
+		Scene.viewProj = Scene.viewProjPrev = XMMatrixLookAtLH(XMVectorSet(0.0f, 50.0f, -400.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))
+			* XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+		return Scene;
+	}
+
+	void SetMeshState(FMockCommandList& Cmd, const FMockMesh& Mesh)
+	{
+		Cmd.IASetPrimitiveTopology(4); // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+		Cmd.IASetVertexBuffers(Mesh.VBAddress, Mesh.NumIndices * 32, 32);
+		Cmd.IASetIndexBuffer(Mesh.IBAddress, Mesh.NumIndices * 4, 42); // DXGI_FORMAT_R32_UINT
+	}
+
+	void SubmitUnbatched(FMockCommandList& Cmd, FMockUploadHeap& Heap, const FMockScene& Scene, const std::vector<FMeshRenderCommand>& Commands)
+	{
+		for (const FMeshRenderCommand& cmd : Commands)
+		{
+			const FMockMaterial& Material = Scene.Materials.at(cmd.matID);
+
+			uint64 Address = 0;
+			VQ_SHADER_DATA::PerObjectData* pPerObj = static_cast<VQ_SHADER_DATA::PerObjectData*>(Heap.AllocConstantBuffer(sizeof(VQ_SHADER_DATA::PerObjectData), &Address));
+			pPerObj->matWorldViewProj     = cmd.matWorldTransformation * Scene.viewProj;
+			pPerObj->matWorldViewProjPrev = cmd.matWorldTransformationPrev * Scene.viewProjPrev;
+			pPerObj->matWorld             = cmd.matWorldTransformation;
+			pPerObj->matNormal            = cmd.matNormalTransformation;
+			pPerObj->materialData         = Material.Data;
+			Cmd.SetGraphicsRootConstantBufferView(1, Address);
+			Cmd.SetGraphicsRootDescriptorTable(0, Material.SRVMaterialMaps);
+
+			if (Scene.Meshes.find(cmd.meshID) == Scene.Meshes.end())
+				continue;
+			const FMockMesh& Mesh = Scene.Meshes.at(cmd.meshID);
+			SetMeshState(Cmd, Mesh);
+			Cmd.DrawIndexedInstanced(Mesh.NumIndices, 1, 0);
+		}
+	}
+
+	void SubmitBatched(FMockCommandList& Cmd, FMockUploadHeap& Heap, const FMockScene& Scene, const std::vector<FInstancedMeshRenderCommand>& Batches, const std::vector<FMeshInstanceData>& InstanceData)
+	{
+		for (const FInstancedMeshRenderCommand& Batch : Batches)
+		{
+			if (Scene.Meshes.find(Batch.meshID) == Scene.Meshes.end())
+				continue;
+			const FMockMaterial& Material = Scene.Materials.at(Batch.matID);
+			const FMockMesh& Mesh = Scene.Meshes.at(Batch.meshID);
+
+			uint64 Address = 0;
+			VQ_SHADER_DATA::PerObjectData* pPerObj = static_cast<VQ_SHADER_DATA::PerObjectData*>(Heap.AllocConstantBuffer(sizeof(VQ_SHADER_DATA::PerObjectData) * Batch.NumInstances, &Address));
+			for (uint32 i = 0; i < Batch.NumInstances; ++i)
+			{
+				const FMeshInstanceData& Instance = InstanceData[Batch.iFirstInstance + i];
+				pPerObj[i].matWorldViewProj     = Instance.matWorldTransformation * Scene.viewProj;
+				pPerObj[i].matWorldViewProjPrev = Instance.matWorldTransformationPrev * Scene.viewProjPrev;
+				pPerObj[i].matWorld             = Instance.matWorldTransformation;
+				pPerObj[i].matNormal            = Instance.matNormalTransformation;
+			}
+			pPerObj[0].materialData = Material.Data;
+			Cmd.SetGraphicsRootConstantBufferView(1, Address);
+			Cmd.SetGraphicsRootDescriptorTable(0, Material.SRVMaterialMaps);
+
+			SetMeshState(Cmd, Mesh);
+			Cmd.DrawIndexedInstanced(Mesh.NumIndices, Batch.NumInstances, 0);
+		}
+	}
+
+	template<class TFn> double MeasureMedianMs(uint32 NumIterations, TFn&& fn)
+	{
+		std::vector<double> TimingsMs(NumIterations);
+		for (double& ms : TimingsMs)
+		{
+			const auto Start = std::chrono::steady_clock::now();
+			fn();
+			ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		}
+		std::sort(TimingsMs.begin(), TimingsMs.end());
+		return TimingsMs[NumIterations / 2];
+	}
+}
+
+VQE_TEST(InstanceBatching_Grouping)
+{
+	constexpr uint32 MAX_INSTANCES_PER_BATCH = 8;
+	const std::vector<FMeshRenderCommand> Commands = CreateStressTestCommands(5000, 20);
+
+	MeshInstanceBatcher Batcher;
+	std::vector<FInstancedMeshRenderCommand> Batches;
+	std::vector<FMeshInstanceData> InstanceData;
+	Batcher.Batch(Commands, MAX_INSTANCES_PER_BATCH, Batches, InstanceData);
+	TEST_CHECK(InstanceData.size() == Commands.size());
+
+	// every command ends up in exactly one batch of its mesh & material, in submission order within the group
+	std::vector<uint32> NumInstancesPerCommand(Commands.size(), 0);
+	std::unordered_map<uint64, uint32> LastCommandPerGroup;
+	uint32 NumInstances = 0;
+	uint32 NumMismatches = 0;
+	for (size_t iBatch = 0; iBatch < Batches.size(); ++iBatch)
+	{
+		const FInstancedMeshRenderCommand& Batch = Batches[iBatch];
+		TEST_CHECK(Batch.NumInstances > 0 && Batch.NumInstances <= MAX_INSTANCES_PER_BATCH);
+		TEST_CHECK(Batch.iFirstInstance == NumInstances);
+
+		// a group is only split when the batch is full
+		if (iBatch + 1 < Batches.size() && Batches[iBatch + 1].meshID == Batch.meshID && Batches[iBatch + 1].matID == Batch.matID)
+			TEST_CHECK(Batch.NumInstances == MAX_INSTANCES_PER_BATCH);
+
+		const uint64 GroupKey = (static_cast<uint64>(Batch.meshID) << 32) | static_cast<uint32>(Batch.matID);
+		for (uint32 i = 0; i < Batch.NumInstances; ++i)
+		{
+			const FMeshInstanceData& Instance = InstanceData[Batch.iFirstInstance + i];
+
+			// the test commands have unique transforms: find the command of the instance
+			uint32 iCommand = 0;
+			while (iCommand < Commands.size() && std::memcmp(&Commands[iCommand].matWorldTransformation, &Instance.matWorldTransformation, sizeof(XMMATRIX)) != 0)
+				++iCommand;
+			if (iCommand == Commands.size() || Commands[iCommand].meshID != Batch.meshID || Commands[iCommand].matID != Batch.matID)
+			{
+				++NumMismatches;
+				continue;
+			}
+			++NumInstancesPerCommand[iCommand];
+
+			auto it = LastCommandPerGroup.find(GroupKey);
+			if (it != LastCommandPerGroup.end() && it->second >= iCommand)
+				++NumMismatches;
+			LastCommandPerGroup[GroupKey] = iCommand;
+		}
+		NumInstances += Batch.NumInstances;
+	}
+	TEST_CHECK(NumMismatches == 0);
+	TEST_CHECK(NumInstances == Commands.size());
+	TEST_CHECK(std::all_of(NumInstancesPerCommand.begin(), NumInstancesPerCommand.end(), [](uint32 n) { return n == 1; }));
+
+	const MeshInstanceBatcher::FStatistics& Stats = Batcher.GetStatistics();
+	TEST_CHECK(Stats.NumMeshRenderCommands == Commands.size());
+	TEST_CHECK(Stats.NumBatches == Batches.size());
+	TEST_CHECK(Stats.MaxInstancesPerBatch == MAX_INSTANCES_PER_BATCH);
+}
+
+// skinned commands are drawn from their own skinned vertices: one batch each, the others are still grouped
+VQE_TEST(InstanceBatching_SkinnedMeshes)
+{
+	std::vector<FMeshRenderCommand> Commands = CreateStressTestCommands(1000, 4);
+	uint32 NumSkinnedCommands = 0;
+	for (size_t i = 0; i < Commands.size(); i += 7)
+	{
+		Commands[i].iFirstSkinnedVertex = static_cast<int>(i * 100);
+		++NumSkinnedCommands;
+	}
+
+	MeshInstanceBatcher Batcher;
+	std::vector<FInstancedMeshRenderCommand> Batches;
+	std::vector<FMeshInstanceData> InstanceData;
+	Batcher.Batch(Commands, MAX_INSTANCE_COUNT__SCENE_MESHES, Batches, InstanceData);
+
+	uint32 NumSkinnedBatches = 0;
+	uint32 NumMismatches = 0;
+	for (const FInstancedMeshRenderCommand& Batch : Batches)
+	{
+		if (Batch.iFirstSkinnedVertex == INVALID_ID)
+			continue;
+		++NumSkinnedBatches;
+		const size_t iCommand = static_cast<size_t>(Batch.iFirstSkinnedVertex / 100);
+		if (Batch.NumInstances != 1
+			|| Commands[iCommand].meshID != Batch.meshID
+			|| std::memcmp(&Commands[iCommand].matWorldTransformation, &InstanceData[Batch.iFirstInstance].matWorldTransformation, sizeof(XMMATRIX)) != 0)
+			++NumMismatches;
+	}
+	TEST_CHECK(NumSkinnedBatches == NumSkinnedCommands);
+	TEST_CHECK(NumMismatches == 0);
+	TEST_CHECK(Batches.size() < Commands.size());
+}
+
+// Batches the StressTestScene draws and submits them w/ & w/o instancing through the submission model:
+// fails if sorting the commands into batches costs more than the batched submission saves.
+VQE_BENCHMARK(InstanceBatching_SubmissionCost)
+{
+	constexpr uint32 NUM_OBJECTS = 12288;
+	constexpr uint32 NUM_ITERATIONS = 50;
+	constexpr uint32 MAX_INSTANCES_PER_BATCH = MAX_INSTANCE_COUNT__SCENE_MESHES;
+
+	const std::vector<FMeshRenderCommand> Commands = CreateStressTestCommands(NUM_OBJECTS, NUM_MATERIALS);
+	const FMockScene Scene = CreateMockScene(NUM_MATERIALS);
+	FMockCommandList Cmd;
+	FMockUploadHeap Heap(64ull << 20);
+
+	MeshInstanceBatcher Batcher;
+	std::vector<FInstancedMeshRenderCommand> Batches;
+	std::vector<FMeshInstanceData> InstanceData;
+
+	const double BatchingMs = MeasureMedianMs(NUM_ITERATIONS, [&]() { Batcher.Batch(Commands, MAX_INSTANCES_PER_BATCH, Batches, InstanceData); });
+	const double UnbatchedSubmitMs = MeasureMedianMs(NUM_ITERATIONS, [&]() { Cmd.Reset(); Heap.Reset(); SubmitUnbatched(Cmd, Heap, Scene, Commands); });
+	const size_t UnbatchedStreamSize = Cmd.GetStreamSize();
+	const double BatchedSubmitMs = MeasureMedianMs(NUM_ITERATIONS, [&]() { Cmd.Reset(); Heap.Reset(); SubmitBatched(Cmd, Heap, Scene, Batches, InstanceData); });
+	const size_t BatchedStreamSize = Cmd.GetStreamSize();
+
+	const MeshInstanceBatcher::FStatistics& s = Batcher.GetStatistics();
+	const double SavedMs = UnbatchedSubmitMs - BatchedSubmitMs;
+	Test::Report("%u draws -> %u draws (%u instanced), max %u instances/batch, %d materials"
+		, s.NumMeshRenderCommands, s.NumBatches, s.NumInstancedBatches, s.MaxInstancesPerBatch, NUM_MATERIALS);
+	Test::Report("submission: unbatched %.3fms (%.1f ns/draw, %zu KB) | batched %.3fms (%zu KB)"
+		, UnbatchedSubmitMs, UnbatchedSubmitMs * 1e6 / NUM_OBJECTS, UnbatchedStreamSize / 1024, BatchedSubmitMs, BatchedStreamSize / 1024);
+	Test::Report("batching %.3fms (%.1f ns/command) vs %.3fms saved: net %.3fms"
+		, BatchingMs, BatchingMs * 1e6 / NUM_OBJECTS, SavedMs, SavedMs - BatchingMs);
+
+	TEST_CHECK(s.NumBatches < s.NumMeshRenderCommands);
+	TEST_CHECK(BatchingMs < SavedMs);
+}
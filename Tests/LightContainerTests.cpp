@@ -0,0 +1,267 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/Scene/LightContainer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// deterministic mix of point & spot lights, Brightness identifies the light
+	std::vector<Light> CreateTestLights(uint32 NumLights, uint32 Seed)
+	{
+		std::mt19937 rng(Seed);
+		std::uniform_real_distribution<float> fnPos(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> fnRange(1.0f, 15.0f);
+		std::uniform_real_distribution<float> fnAngle(0.0f, XM_PI);
+		std::uniform_real_distribution<float> fnCone(5.0f, 85.0f);
+
+		std::vector<Light> Lights(NumLights);
+		for (uint32 i = 0; i < NumLights; ++i)
+		{
+			Light& l = Lights[i];
+			l = (i % 3 == 0) ? Light::MakeSpotLight() : Light::MakePointLight();
+			l.Position = XMFLOAT3(fnPos(rng), fnPos(rng), fnPos(rng));
+			l.Range = fnRange(rng);
+			l.Brightness = static_cast<float>(i);
+			l.bEnabled = (i % 7) != 0;
+			l.bCastingShadows = (i % 5) == 0;
+			l.Mobility = Light::EMobility::STATIC;
+			if (l.Type == Light::EType::SPOT)
+			{
+				l.RotationQuaternion = Quaternion::FromAxisAngle(XMFLOAT3(1.0f, 0.0f, 0.0f), fnAngle(rng))
+				                     * Quaternion::FromAxisAngle(XMFLOAT3(0.0f, 1.0f, 0.0f), fnAngle(rng));
+				l.SpotOuterConeAngleDegrees = fnCone(rng);
+				l.SpotInnerConeAngleDegrees = l.SpotOuterConeAngleDegrees * 0.8f;
+			}
+		}
+		return Lights;
+	}
+
+	// signed distance to a plane whose normal isn't normalized
+	float GetDistanceToPlane(const XMFLOAT4& Plane, const XMFLOAT3& Center)
+	{
+		const float NormalLength = std::sqrt(Plane.x * Plane.x + Plane.y * Plane.y + Plane.z * Plane.z);
+		return (Plane.x * Center.x + Plane.y * Center.y + Plane.z * Center.z + Plane.w) / NormalLength;
+	}
+}
+
+VQE_TEST(LightContainer_HandlesAndRemoval)
+{
+	const uint32 NUM_LIGHTS = 103;
+	const std::vector<Light> Lights = CreateTestLights(NUM_LIGHTS, 1);
+
+	LightContainer Container;
+	std::vector<LightHandle> hLights;
+	Container.Add(Lights, &hLights);
+	TEST_CHECK(hLights.size() == NUM_LIGHTS);
+	TEST_CHECK(Container.GetNumLights() == NUM_LIGHTS);
+
+	// bulk remove every 4th light, single remove the last one
+	std::vector<LightHandle> hRemoved;
+	for (uint32 i = 0; i < NUM_LIGHTS; i += 4)
+		hRemoved.push_back(hLights[i]);
+	Container.Remove(hRemoved);
+	Container.Remove(hLights[NUM_LIGHTS - 1]);
+
+	uint32 NumExpectedLights = 0;
+	for (uint32 i = 0; i < NUM_LIGHTS; ++i)
+	{
+		const bool bExpectValid = (i % 4) != 0 && i != NUM_LIGHTS - 1;
+		TEST_CHECK(Container.IsValid(hLights[i]) == bExpectValid);
+		if (!bExpectValid)
+			continue;
+
+		++NumExpectedLights;
+		const Light l = Container.GetLight(hLights[i]);
+		TEST_CHECK(l.Brightness == Lights[i].Brightness);
+		TEST_CHECK(l.Type == Lights[i].Type);
+		TEST_CHECK(l.Range == Lights[i].Range);
+		TEST_CHECK(l.Position.x == Lights[i].Position.x && l.Position.y == Lights[i].Position.y && l.Position.z == Lights[i].Position.z);
+		TEST_CHECK(l.bEnabled == Lights[i].bEnabled && l.bCastingShadows == Lights[i].bCastingShadows);
+	}
+	TEST_CHECK(Container.GetNumLights() == NumExpectedLights);
+
+	// dense indices map back to their handles after the swap-removes
+	for (uint32 iLight = 0; iLight < Container.GetNumLights(); ++iLight)
+	{
+		const LightHandle h = Container.GetHandle(iLight);
+		TEST_CHECK(Container.IsValid(h));
+		TEST_CHECK(Container.GetLightAt(iLight).Brightness == Container.GetLight(h).Brightness);
+	}
+
+	// reused slots get a new generation
+	const LightHandle hNew = Container.Add(Lights[0]);
+	TEST_CHECK(Container.IsValid(hNew));
+	TEST_CHECK(!Container.IsValid(hLights[0]));
+	for (const LightHandle& h : hRemoved)
+		TEST_CHECK(!Container.IsValid(h));
+
+	Container.SetEnabled(hNew, false);
+	TEST_CHECK(!Container.GetLight(hNew).bEnabled);
+
+	Container.Clear();
+	TEST_CHECK(Container.GetNumLights() == 0);
+	TEST_CHECK(!Container.IsValid(hNew));
+	TEST_CHECK(!Container.IsValid(hLights[1]));
+}
+
+// the bounding sphere of a spot light must contain its cone
+VQE_TEST(LightContainer_SpotLightBounds)
+{
+	const std::vector<Light> Lights = CreateTestLights(300, 2);
+
+	LightContainer Container;
+	std::vector<LightHandle> hLights;
+	Container.Add(Lights, &hLights);
+
+	const LightContainer::FHotData& h = Container.GetHotData();
+	uint32 NumSpotLights = 0;
+	for (uint32 iLight = 0; iLight < Container.GetNumLights(); ++iLight)
+	{
+		if (h.Type[iLight] != Light::EType::SPOT)
+			continue;
+		++NumSpotLights;
+
+		const XMVECTOR Apex   = XMVectorSet(h.PositionX[iLight], h.PositionY[iLight], h.PositionZ[iLight], 0.0f);
+		const XMVECTOR Dir    = XMVectorSet(h.DirectionX[iLight], h.DirectionY[iLight], h.DirectionZ[iLight], 0.0f);
+		const XMVECTOR Center = XMVectorSet(h.BoundsX[iLight], h.BoundsY[iLight], h.BoundsZ[iLight], 0.0f);
+		const float Radius = h.BoundsRadius[iLight];
+		const float Range  = h.Range[iLight];
+		const float Tolerance = 1e-3f * Range;
+		TEST_CHECK(Radius > 0.0f && Radius <= Range + Tolerance);
+
+		// orthonormal basis around the cone axis
+		const XMVECTOR Helper = std::abs(XMVectorGetY(Dir)) < 0.9f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		const XMVECTOR U = XMVector3Normalize(XMVector3Cross(Dir, Helper));
+		const XMVECTOR V = XMVector3Cross(Dir, U);
+
+		// apex, the cap tip and the rim of the cone's spherical cap
+		bool bContained = XMVectorGetX(XMVector3Length(XMVectorSubtract(Apex, Center))) <= Radius + Tolerance;
+		bContained = bContained && XMVectorGetX(XMVector3Length(XMVectorSubtract(XMVectorAdd(Apex, XMVectorScale(Dir, Range)), Center))) <= Radius + Tolerance;
+		for (int iRim = 0; iRim < 16; ++iRim)
+		{
+			const float Phi = iRim * XM_2PI / 16;
+			const XMVECTOR Side = XMVectorAdd(XMVectorScale(U, std::cos(Phi)), XMVectorScale(V, std::sin(Phi)));
+			const XMVECTOR RimDir = XMVectorAdd(XMVectorScale(Dir, h.CosOuterConeAngle[iLight]), XMVectorScale(Side, h.SinOuterConeAngle[iLight]));
+			const XMVECTOR RimPoint = XMVectorAdd(Apex, XMVectorScale(RimDir, Range));
+			bContained = bContained && XMVectorGetX(XMVector3Length(XMVectorSubtract(RimPoint, Center))) <= Radius + Tolerance;
+		}
+		TEST_CHECK(bContained);
+	}
+	TEST_CHECK(NumSpotLights > 0);
+}
+
+// compares the SSE gather against a scalar test of each light's bounding sphere
+VQE_TEST(LightContainer_GatherVisibleLights)
+{
+	std::vector<Light> Lights = CreateTestLights(1003, 3); // not a multiple of 4: exercises the tail
+	Light DirectionalLight = Light::MakeDirectionalLight();
+	DirectionalLight.Position = XMFLOAT3(0.0f, 1000.0f, -1000.0f); // far outside the frustum
+	Lights.push_back(DirectionalLight);
+
+	LightContainer Container;
+	Container.Add(Lights);
+
+	const XMMATRIX matView = XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, -60.0f, 1.0f), XMVectorSet(10.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	const XMMATRIX matProj = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, 80.0f);
+	const FFrustumPlaneset FrustumPlanes = FFrustumPlaneset::ExtractFromMatrix(matView * matProj);
+
+	for (uint8 RequiredFlags : { uint8(0), uint8(LightContainer::ENABLED), uint8(LightContainer::ENABLED | LightContainer::CASTING_SHADOWS) })
+	{
+		std::vector<uint32> VisibleLights;
+		Container.GatherVisibleLights(FrustumPlanes, RequiredFlags, VisibleLights);
+		TEST_CHECK(std::is_sorted(VisibleLights.begin(), VisibleLights.end()));
+
+		const LightContainer::FHotData& h = Container.GetHotData();
+		uint32 NumMismatches = 0;
+		uint32 NumCulled = 0;
+		for (uint32 iLight = 0; iLight < Container.GetNumLights(); ++iLight)
+		{
+			const XMFLOAT3 Center(h.BoundsX[iLight], h.BoundsY[iLight], h.BoundsZ[iLight]);
+			const float Radius = h.BoundsRadius[iLight];
+
+			// tolerate the float differences of lights touching a plane
+			float MinDistance = FLT_MAX;
+			for (const XMFLOAT4& Plane : FrustumPlanes.abcd)
+				MinDistance = std::min(MinDistance, GetDistanceToPlane(Plane, Center) + Radius);
+			if (Radius >= 0.0f && std::abs(MinDistance) < 1e-3f)
+				continue;
+
+			const bool bExpectVisible = (Radius < 0.0f || MinDistance >= 0.0f) && (h.Flags[iLight] & RequiredFlags) == RequiredFlags;
+			const bool bVisible = std::binary_search(VisibleLights.begin(), VisibleLights.end(), iLight);
+			NumMismatches += bVisible != bExpectVisible ? 1 : 0;
+			NumCulled += bExpectVisible ? 0 : 1;
+			if (h.Type[iLight] == Light::EType::DIRECTIONAL && (h.Flags[iLight] & RequiredFlags) == RequiredFlags)
+				TEST_CHECK(bVisible);
+		}
+		if (NumMismatches)
+			Test::Report("RequiredFlags=%u: %u mismatches", RequiredFlags, NumMismatches);
+		TEST_CHECK(NumMismatches == 0);
+		TEST_CHECK(NumCulled > 0 && NumCulled < Container.GetNumLights());
+	}
+}
+
+VQE_TEST(LightContainer_ExportGPUData)
+{
+	const std::vector<Light> Lights = CreateTestLights(200, 4);
+
+	LightContainer Container;
+	Container.Add(Lights);
+
+	uint32 NumPointLights = 0, NumSpotLights = 0, NumPointCasters = 0, NumSpotCasters = 0;
+	for (const Light& l : Lights)
+	{
+		if (!l.bEnabled)
+			continue;
+		const bool bSpot = l.Type == Light::EType::SPOT;
+		(bSpot ? NumSpotLights : NumPointLights) += 1;
+		(bSpot ? NumSpotCasters : NumPointCasters) += l.bCastingShadows ? 1 : 0;
+	}
+	const uint32 NumMappedSpotCasters  = std::min<uint32>(NumSpotCasters , NUM_SHADOWING_LIGHTS__SPOT);
+	const uint32 NumMappedPointCasters = std::min<uint32>(NumPointCasters, NUM_SHADOWING_LIGHTS__POINT);
+
+	VQ_SHADER_DATA::SceneLighting Data = {};
+	std::vector<VQ_SHADER_DATA::PointLight> PointLights;
+	std::vector<VQ_SHADER_DATA::SpotLight> SpotLights;
+	Container.ExportGPUData(Data, PointLights, SpotLights);
+
+	// casters over the shadow map budget are exported as non-shadowing lights
+	TEST_CHECK(Data.numSpotCasters  == static_cast<int>(NumMappedSpotCasters));
+	TEST_CHECK(Data.numPointCasters == static_cast<int>(NumMappedPointCasters));
+	TEST_CHECK(Data.numSpotLights   == static_cast<int>(NumSpotLights  - NumMappedSpotCasters));
+	TEST_CHECK(Data.numPointLights  == static_cast<int>(NumPointLights - NumMappedPointCasters));
+	TEST_CHECK(SpotLights.size()  == NumSpotLights  - NumMappedSpotCasters);
+	TEST_CHECK(PointLights.size() == NumPointLights - NumMappedPointCasters);
+	TEST_CHECK(Data.directional.enabled == 0);
+
+	// exported in dense order: the first non-shadowing point light matches the first enabled, non-casting point light
+	for (const Light& l : Lights)
+	{
+		if (!l.bEnabled || l.bCastingShadows || l.Type != Light::EType::POINT)
+			continue;
+		TEST_CHECK(!PointLights.empty() && PointLights[0].brightness == l.Brightness && PointLights[0].range == l.Range);
+		break;
+	}
+}
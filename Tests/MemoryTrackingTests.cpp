@@ -0,0 +1,210 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/Core/MemoryTracking.h"
+#include "Source/Engine/Core/Memory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// the allocations of the tests are tracked by the operator new/delete replaced in MemoryTracking.cpp,
+// the checks compare the counters before & after so the allocations of the test runner don't interfere.
+#if MEMORY_TRACKING__ENABLE
+namespace
+{
+	const FMemoryTagStats& GetTag(const FMemorySnapshot& s, EMemoryTag Tag) { return s.Tags[static_cast<size_t>(Tag)]; }
+}
+
+// tagged scopes, nesting & counts while live and after the free
+VQE_TEST(MemoryTracking_TagScopes)
+{
+	using namespace MemoryTracking;
+	const FMemorySnapshot s0 = CaptureSnapshot();
+	std::vector<uint8>* pOuter = nullptr;
+	std::vector<uint8>* pInner = nullptr;
+	{
+		SCOPED_MEMORY_TAG(EMemoryTag::Scene);
+		pOuter = new std::vector<uint8>(1000);
+		{
+			SCOPED_MEMORY_TAG(EMemoryTag::ModelImport);
+			pInner = new std::vector<uint8>(3000);
+		}
+	}
+	const FMemorySnapshot s1 = CaptureSnapshot();
+	TEST_CHECK(GetTag(s1, EMemoryTag::Scene).CurrentBytes - GetTag(s0, EMemoryTag::Scene).CurrentBytes == static_cast<int64>(sizeof(std::vector<uint8>) + 1000));
+	TEST_CHECK(GetTag(s1, EMemoryTag::ModelImport).CurrentBytes - GetTag(s0, EMemoryTag::ModelImport).CurrentBytes == static_cast<int64>(sizeof(std::vector<uint8>) + 3000));
+	TEST_CHECK(GetTag(s1, EMemoryTag::Scene).NumLiveAllocations - GetTag(s0, EMemoryTag::Scene).NumLiveAllocations == 2);
+	TEST_CHECK(GetTag(s1, EMemoryTag::Scene).PeakBytes >= GetTag(s1, EMemoryTag::Scene).CurrentBytes);
+	delete pOuter; // freed outside of the tag scope: still subtracted from the allocating tag
+	delete pInner;
+	const FMemorySnapshot s2 = CaptureSnapshot();
+	TEST_CHECK(GetTag(s2, EMemoryTag::Scene).CurrentBytes == GetTag(s0, EMemoryTag::Scene).CurrentBytes);
+	TEST_CHECK(GetTag(s2, EMemoryTag::ModelImport).CurrentBytes == GetTag(s0, EMemoryTag::ModelImport).CurrentBytes);
+	TEST_CHECK(GetTag(s2, EMemoryTag::Scene).NumAllocations - GetTag(s0, EMemoryTag::Scene).NumAllocations == 2);
+}
+
+VQE_TEST(MemoryTracking_OverAlignedAllocations)
+{
+	using namespace MemoryTracking;
+	struct alignas(256) FAligned { uint8 Data[300]; };
+	const FMemorySnapshot s0 = CaptureSnapshot();
+	FAligned* pAligned = nullptr;
+	{
+		SCOPED_MEMORY_TAG(EMemoryTag::Animation);
+		pAligned = new FAligned();
+	}
+	TEST_CHECK((reinterpret_cast<uintptr_t>(pAligned) & 255) == 0);
+	TEST_CHECK(GetTag(CaptureSnapshot(), EMemoryTag::Animation).CurrentBytes - GetTag(s0, EMemoryTag::Animation).CurrentBytes == static_cast<int64>(sizeof(FAligned)));
+	delete pAligned;
+	TEST_CHECK(GetTag(CaptureSnapshot(), EMemoryTag::Animation).CurrentBytes == GetTag(s0, EMemoryTag::Animation).CurrentBytes);
+}
+
+// the backing store of the engine pools is recorded w/o going through operator new
+VQE_TEST(MemoryTracking_Pools)
+{
+	using namespace MemoryTracking;
+	const FMemorySnapshot s0 = CaptureSnapshot();
+	{
+		MemoryPool<uint64> Pool(100, 64, EMemoryTag::Streaming);
+		TEST_CHECK(GetTag(CaptureSnapshot(), EMemoryTag::Streaming).CurrentBytes - GetTag(s0, EMemoryTag::Streaming).CurrentBytes == 100 * 64);
+	}
+	TEST_CHECK(GetTag(CaptureSnapshot(), EMemoryTag::Streaming).CurrentBytes == GetTag(s0, EMemoryTag::Streaming).CurrentBytes);
+}
+
+// many threads allocating & freeing, some of the frees on another thread than the allocation
+VQE_TEST(MemoryTracking_CrossThreadFrees)
+{
+	using namespace MemoryTracking;
+	constexpr int NUM_THREADS = 4;
+	constexpr int NUM_ALLOCATIONS_PER_THREAD = 100000;
+
+	const FMemorySnapshot s0 = CaptureSnapshot();
+	std::vector<std::vector<uint8*>> KeptAllocations(NUM_THREADS);
+	std::vector<int64> KeptBytes(NUM_THREADS, 0);
+	std::vector<std::thread> Threads;
+	for (int iThread = 0; iThread < NUM_THREADS; ++iThread)
+	{
+		Threads.emplace_back([iThread, &KeptAllocations, &KeptBytes]()
+		{
+			SCOPED_MEMORY_TAG(EMemoryTag::RayQueries);
+			uint32 Rand = 12345u + iThread;
+			std::vector<uint8*> Kept;
+			std::vector<size_t> KeptSizes;
+			Kept.reserve(NUM_ALLOCATIONS_PER_THREAD);  // the reservations are tagged too, accounted for below
+			KeptSizes.reserve(NUM_ALLOCATIONS_PER_THREAD);
+			for (int i = 0; i < NUM_ALLOCATIONS_PER_THREAD; ++i)
+			{
+				Rand = Rand * 1664525u + 1013904223u;
+				const size_t Size = 1 + (Rand >> 16) % 512;
+				uint8* p = new uint8[Size];
+				if (Rand & 0x80000000u) { delete[] p; continue; }
+				Kept.push_back(p);
+				KeptSizes.push_back(Size);
+			}
+			int64 Bytes = 0;
+			for (size_t s : KeptSizes) Bytes += s;
+			KeptBytes[iThread] = Bytes;
+			KeptAllocations[iThread] = std::move(Kept);
+		});
+	}
+	for (std::thread& t : Threads)
+		t.join();
+
+	// live: the kept allocations + the Kept vectors moved out of the threads (KeptSizes was freed on exit)
+	int64 ExpectedBytes = 0;
+	int64 ExpectedLive = 0;
+	for (int iThread = 0; iThread < NUM_THREADS; ++iThread)
+	{
+		ExpectedBytes += KeptBytes[iThread] + static_cast<int64>(KeptAllocations[iThread].capacity() * sizeof(uint8*));
+		ExpectedLive  += static_cast<int64>(KeptAllocations[iThread].size()) + 1;
+	}
+	const FMemorySnapshot s1 = CaptureSnapshot();
+	TEST_CHECK(GetTag(s1, EMemoryTag::RayQueries).CurrentBytes - GetTag(s0, EMemoryTag::RayQueries).CurrentBytes == ExpectedBytes);
+	TEST_CHECK(GetTag(s1, EMemoryTag::RayQueries).NumLiveAllocations - GetTag(s0, EMemoryTag::RayQueries).NumLiveAllocations == ExpectedLive);
+
+	for (std::vector<uint8*>& Kept : KeptAllocations) // freed on this thread, untagged scope
+	{
+		for (uint8* p : Kept)
+			delete[] p;
+		Kept = std::vector<uint8*>();
+	}
+	const FMemorySnapshot s2 = CaptureSnapshot();
+	TEST_CHECK(GetTag(s2, EMemoryTag::RayQueries).CurrentBytes == GetTag(s0, EMemoryTag::RayQueries).CurrentBytes);
+	TEST_CHECK(GetTag(s2, EMemoryTag::RayQueries).NumLiveAllocations == GetTag(s0, EMemoryTag::RayQueries).NumLiveAllocations);
+}
+
+VQE_TEST(MemoryTracking_FrameCounts)
+{
+	using namespace MemoryTracking;
+	constexpr int NUM_FRAME_ALLOCATIONS = 37;
+	std::vector<uint32*> Allocations(NUM_FRAME_ALLOCATIONS); // kept until the end of the frame: new/delete pairs can be elided
+	EndFrame();
+	{
+		SCOPED_MEMORY_TAG(EMemoryTag::UI);
+		for (int i = 0; i < NUM_FRAME_ALLOCATIONS; ++i)
+			Allocations[i] = new uint32(i);
+	}
+	EndFrame();
+	for (uint32* p : Allocations)
+		delete p;
+	const FMemorySnapshot s = GetFrameSnapshot();
+	TEST_CHECK(GetTag(s, EMemoryTag::UI).NumFrameAllocations == NUM_FRAME_ALLOCATIONS);
+	TEST_CHECK(GetTag(s, EMemoryTag::UI).FrameAllocatedBytes == NUM_FRAME_ALLOCATIONS * sizeof(uint32));
+	EndFrame();
+	TEST_CHECK(GetTag(GetFrameSnapshot(), EMemoryTag::UI).NumFrameAllocations == 0);
+}
+
+// cost of a tracked new/delete pair
+VQE_BENCHMARK(MemoryTracking_NewDelete)
+{
+	constexpr int NUM_ITERATIONS = 1000000;
+	std::vector<void*> Pointers(64);
+	const FMemorySnapshot s0 = MemoryTracking::CaptureSnapshot();
+	float ElapsedMs = 0.0f;
+	{
+		SCOPED_MEMORY_TAG(EMemoryTag::Renderer);
+		const auto Start = std::chrono::steady_clock::now();
+		for (int i = 0; i < NUM_ITERATIONS; ++i)
+		{
+			void*& p = Pointers[i & 63];
+			::operator delete(p);
+			p = ::operator new(16 + (i & 127));
+		}
+		ElapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	}
+	const FMemorySnapshot s1 = MemoryTracking::CaptureSnapshot();
+	for (void*& p : Pointers)
+	{
+		::operator delete(p);
+		p = nullptr;
+	}
+	Test::Report("%d tracked new/delete pairs in %.2fms (%.1f ns per pair)", NUM_ITERATIONS, ElapsedMs, ElapsedMs * 1e6f / NUM_ITERATIONS);
+	TEST_CHECK(GetTag(s1, EMemoryTag::Renderer).NumAllocations - GetTag(s0, EMemoryTag::Renderer).NumAllocations == NUM_ITERATIONS);
+}
+#else
+// the hooks compile to nothing
+VQE_TEST(MemoryTracking_CompiledOut)
+{
+	TEST_CHECK(!MemoryTracking::IsEnabled());
+	TEST_CHECK(MemoryTracking::CaptureSnapshot().Total.NumAllocations == 0);
+}
+#endif
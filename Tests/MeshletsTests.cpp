@@ -0,0 +1,416 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/Meshlets.h"
+#include "Source/Engine/Geometry.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	using FTestMesh = GeometryGenerator::GeometryData<FVertexWithNormalAndTangent>;
+	using FTriangle = std::array<uint32, 3>;
+
+	struct FTestView
+	{
+		XMMATRIX matWorld;
+		XMMATRIX matViewProj;
+		XMFLOAT3 CameraPosition;
+	};
+
+	constexpr uint32 NUM_TEST_MESHES      = 200;
+	constexpr uint32 NUM_VIEWS_PER_MESH   = 16;
+	constexpr uint32 TERRAIN_TESSELLATION = 512;
+
+	inline XMFLOAT3 Add  (const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline XMFLOAT3 Scale(const XMFLOAT3& a, float s)           { return XMFLOAT3(a.x * s, a.y * s, a.z * s); }
+	inline float    DistanceSq(const XMFLOAT3& a, const XMFLOAT3& b) { const float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z; return x * x + y * y + z * z; }
+
+	template<class T>
+	bool IsEqualBitwise(const std::vector<T>& l, const std::vector<T>& r)
+	{
+		return l.size() == r.size() && (l.empty() || std::memcmp(l.data(), r.data(), sizeof(T) * l.size()) == 0);
+	}
+
+	bool IsEqual(const FMeshletData& l, const FMeshletData& r)
+	{
+		return IsEqualBitwise(l.Meshlets, r.Meshlets)
+			&& IsEqualBitwise(l.Bounds, r.Bounds)
+			&& IsEqualBitwise(l.VertexIndices, r.VertexIndices)
+			&& IsEqualBitwise(l.TriangleIndices, r.TriangleIndices)
+			&& IsEqualBitwise(l.Indices, r.Indices);
+	}
+
+	FTestMesh GenerateTestMesh(std::mt19937& rng)
+	{
+		using namespace GeometryGenerator;
+		std::uniform_int_distribution<int> fnShape(0, 4);
+		std::uniform_int_distribution<unsigned> fnTessellation(12, 96);
+		std::uniform_real_distribution<float> fnSize(0.5f, 4.0f);
+		const int      Shape = fnShape(rng);
+		const unsigned Tessellation = fnTessellation(rng);
+		const float    Size0 = fnSize(rng);
+		const float    Size1 = fnSize(rng);
+		switch (Shape)
+		{
+		case 0 : return Sphere<FVertexWithNormalAndTangent>(Size0, Tessellation, Tessellation);
+		case 1 : return Cube<FVertexWithNormalAndTangent>();
+		case 2 : return Cylinder<FVertexWithNormalAndTangent>(Size0, Size1, Size1, Tessellation, Tessellation / 3);
+		case 3 : return Cone<FVertexWithNormalAndTangent>(Size0, Size1, Tessellation);
+		default: return Grid<FVertexWithNormalAndTangent>(Size0, Size1, Tessellation, Tessellation);
+		}
+	}
+
+	FTestMesh GenerateTerrain(unsigned Tessellation)
+	{
+		FTestMesh Mesh = GeometryGenerator::Grid<FVertexWithNormalAndTangent>(100.0f, 100.0f, Tessellation, Tessellation);
+		for (FVertexWithNormalAndTangent& v : Mesh.Vertices)
+			v.position[1] = 4.0f * std::sin(v.position[0] * 0.15f) * std::cos(v.position[2] * 0.1f);
+		return Mesh;
+	}
+
+	void ShuffleTriangles(FTestMesh& Mesh, std::mt19937& rng)
+	{
+		std::vector<FTriangle> Triangles(Mesh.Indices.size() / 3);
+		for (size_t t = 0; t < Triangles.size(); ++t)
+			Triangles[t] = { Mesh.Indices[t * 3 + 0], Mesh.Indices[t * 3 + 1], Mesh.Indices[t * 3 + 2] };
+		std::shuffle(Triangles.begin(), Triangles.end(), rng);
+		for (size_t t = 0; t < Triangles.size(); ++t)
+			for (uint32 k = 0; k < 3; ++k)
+				Mesh.Indices[t * 3 + k] = Triangles[t][k];
+	}
+
+	// GeometryGenerator meshes, half of them w/ a shuffled triangle order, and a large terrain
+	std::vector<FTestMesh> GenerateTestMeshes(uint32 NumMeshes, std::mt19937& rng)
+	{
+		std::vector<FTestMesh> Meshes;
+		Meshes.reserve(NumMeshes + 1);
+		for (uint32 i = 0; i < NumMeshes; ++i)
+		{
+			Meshes.push_back(GenerateTestMesh(rng));
+			if (i % 2 == 1)
+				ShuffleTriangles(Meshes.back(), rng);
+		}
+		Meshes.push_back(GenerateTerrain(TERRAIN_TESSELLATION));
+		return Meshes;
+	}
+
+	FMeshletData BuildMeshlets(const FTestMesh& Mesh, MeshletBuilder::FStatistics* pStats = nullptr)
+	{
+		return MeshletBuilder::Build(Mesh.Vertices[0].position, sizeof(FVertexWithNormalAndTangent), static_cast<uint32>(Mesh.Vertices.size())
+			, Mesh.Indices.data(), static_cast<uint32>(Mesh.Indices.size()), MeshletBuilder::FSettings(), pStats);
+	}
+
+	std::vector<XMFLOAT3> GetPositions(const FTestMesh& Mesh)
+	{
+		std::vector<XMFLOAT3> Positions(Mesh.Vertices.size());
+		for (size_t v = 0; v < Mesh.Vertices.size(); ++v)
+			Positions[v] = XMFLOAT3(Mesh.Vertices[v].position[0], Mesh.Vertices[v].position[1], Mesh.Vertices[v].position[2]);
+		return Positions;
+	}
+
+	std::vector<FTriangle> GetSortedTriangles(const std::vector<uint32>& Indices)
+	{
+		// rotated to start at the smallest index, keeps the winding
+		std::vector<FTriangle> Triangles(Indices.size() / 3);
+		for (size_t t = 0; t < Triangles.size(); ++t)
+		{
+			const uint32* i = &Indices[t * 3];
+			const uint32 r = (i[0] <= i[1] && i[0] <= i[2]) ? 0 : (i[1] <= i[2] ? 1 : 2);
+			Triangles[t] = { i[r], i[(r + 1) % 3], i[(r + 2) % 3] };
+		}
+		std::sort(Triangles.begin(), Triangles.end());
+		return Triangles;
+	}
+
+	FTestView GenerateTestView(const FTestMesh& Mesh, std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		auto fnRange = [&](float Min, float Max) { return Min + (Max - Min) * fnUnit(rng); };
+		auto fnDirection = [&]()
+		{
+			const float z = fnRange(-1.0f, 1.0f);
+			const float Angle = fnRange(0.0f, 2.0f * XM_PI);
+			const float r = std::sqrt(1.0f - z * z);
+			return XMFLOAT3(r * std::cos(Angle), r * std::sin(Angle), z);
+		};
+
+		XMFLOAT3 Min = XMFLOAT3(Mesh.Vertices[0].position[0], Mesh.Vertices[0].position[1], Mesh.Vertices[0].position[2]);
+		XMFLOAT3 Max = Min;
+		for (const FVertexWithNormalAndTangent& v : Mesh.Vertices)
+		{
+			Min = XMFLOAT3(std::min(Min.x, v.position[0]), std::min(Min.y, v.position[1]), std::min(Min.z, v.position[2]));
+			Max = XMFLOAT3(std::max(Max.x, v.position[0]), std::max(Max.y, v.position[1]), std::max(Max.z, v.position[2]));
+		}
+
+		// some of the transforms mirror
+		const float s = fnRange(0.5f, 2.0f);
+		FTestView View;
+		View.matWorld = XMMatrixScaling(fnUnit(rng) < 0.15f ? -s : s, s, s)
+			* XMMatrixRotationRollPitchYaw(fnRange(0.0f, XM_PI), fnRange(0.0f, XM_PI), fnRange(0.0f, XM_PI))
+			* XMMatrixTranslation(fnRange(-10.0f, 10.0f), fnRange(-10.0f, 10.0f), fnRange(-10.0f, 10.0f));
+
+		// cameras from inside the mesh bounds to a few radii away, looking around the mesh
+		XMFLOAT3 Center = Scale(Add(Min, Max), 0.5f);
+		XMStoreFloat3(&Center, XMVector3TransformCoord(XMLoadFloat3(&Center), View.matWorld));
+		const float Radius = 0.5f * s * std::sqrt(DistanceSq(Min, Max));
+		View.CameraPosition = Add(Center, Scale(fnDirection(), Radius * fnRange(0.1f, 4.0f)));
+		const XMFLOAT3 Target = Add(Center, Scale(fnDirection(), Radius * fnRange(0.0f, 1.5f)));
+
+		const XMMATRIX matView = XMMatrixLookAtLH(XMLoadFloat3(&View.CameraPosition), XMLoadFloat3(&Target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const XMMATRIX matProj = XMMatrixPerspectiveFovLH(fnRange(40.0f, 90.0f) * XM_PI / 180.0f, 16.0f / 9.0f, 0.01f * Radius, 100.0f * Radius);
+		View.matViewProj = matView * matProj;
+		return View;
+	}
+
+	// Triangles that may produce pixels: front facing (clockwise on screen) & not entirely outside one of the clip planes.
+	// Facing is evaluated in double precision: small triangles far from the origin lose their shape in float.
+	bool IsTrianglePotentiallyVisible(const XMFLOAT3 (&p)[3], const FTestView& View)
+	{
+		XMFLOAT4X4 World;
+		XMStoreFloat4x4(&World, View.matWorld);
+		double w[3][3];
+		XMFLOAT4 c[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			for (int j = 0; j < 3; ++j)
+				w[k][j] = p[k].x * static_cast<double>(World.m[0][j]) + p[k].y * static_cast<double>(World.m[1][j]) + p[k].z * static_cast<double>(World.m[2][j]) + World.m[3][j];
+			XMStoreFloat4(&c[k], XMVector4Transform(XMVectorSet(static_cast<float>(w[k][0]), static_cast<float>(w[k][1]), static_cast<float>(w[k][2]), 1.0f), View.matViewProj));
+		}
+
+		const double e0[3] = { w[1][0] - w[0][0], w[1][1] - w[0][1], w[1][2] - w[0][2] };
+		const double e1[3] = { w[2][0] - w[0][0], w[2][1] - w[0][1], w[2][2] - w[0][2] };
+		const double n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+		const double ToEye[3] = { View.CameraPosition.x - w[0][0], View.CameraPosition.y - w[0][1], View.CameraPosition.z - w[0][2] };
+		const double NdotE = n[0] * ToEye[0] + n[1] * ToEye[1] + n[2] * ToEye[2];
+		const double Epsilon = 1e-4 * std::sqrt((n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * (ToEye[0] * ToEye[0] + ToEye[1] * ToEye[1] + ToEye[2] * ToEye[2]));
+		if (!(NdotE > Epsilon))
+			return false;
+
+		auto fnAllOutside = [&](auto&& fnIsOutside)
+		{
+			return fnIsOutside(c[0]) && fnIsOutside(c[1]) && fnIsOutside(c[2]);
+		};
+		auto fnMargin = [](const XMFLOAT4& v) { return 1e-4f * std::abs(v.w); };
+		return !(fnAllOutside([&](const XMFLOAT4& v) { return v.x >  v.w + fnMargin(v); })
+			  || fnAllOutside([&](const XMFLOAT4& v) { return v.x < -v.w - fnMargin(v); })
+			  || fnAllOutside([&](const XMFLOAT4& v) { return v.y >  v.w + fnMargin(v); })
+			  || fnAllOutside([&](const XMFLOAT4& v) { return v.y < -v.w - fnMargin(v); })
+			  || fnAllOutside([&](const XMFLOAT4& v) { return v.z >  v.w + fnMargin(v); })
+			  || fnAllOutside([&](const XMFLOAT4& v) { return v.z < -fnMargin(v); }));
+	}
+
+	CookedMeshFile::FCookedMesh CookMesh(const FTestMesh& Mesh, const FMeshletData& Meshlets)
+	{
+		CookedMeshFile::FCookedMesh Cooked;
+		Cooked.VertexStride = sizeof(FVertexWithNormalAndTangent);
+		Cooked.VertexData.resize(sizeof(FVertexWithNormalAndTangent) * Mesh.Vertices.size());
+		std::memcpy(Cooked.VertexData.data(), Mesh.Vertices.data(), Cooked.VertexData.size());
+		Cooked.Meshlets = Meshlets;
+		return Cooked;
+	}
+}
+
+// meshlet limits, the consistency of the local indices w/ the index list, the bounds, the triangle coverage & the determinism
+VQE_TEST(Meshlets_Build)
+{
+	const MeshletBuilder::FSettings Settings;
+	std::mt19937 rng(1234);
+	const std::vector<FTestMesh> Meshes = GenerateTestMeshes(NUM_TEST_MESHES, rng);
+
+	uint32 NumLimitErrors = 0, NumCoverageErrors = 0, NumBoundsErrors = 0, NumNonDeterministic = 0;
+	uint32 NumMeshlets = 0, NumTriangles = 0, NumVertices = 0, NumMeshletVertices = 0, NumDisabledCones = 0;
+	float  BuildTimeMs = 0.0f;
+	for (size_t iMesh = 0; iMesh < Meshes.size(); ++iMesh)
+	{
+		const FTestMesh& Mesh = Meshes[iMesh];
+		MeshletBuilder::FStatistics s;
+		const FMeshletData d = BuildMeshlets(Mesh, &s);
+		NumMeshlets        += s.NumMeshlets;
+		NumTriangles       += s.NumTriangles;
+		NumVertices        += s.NumVertices;
+		NumMeshletVertices += s.NumMeshletVertices;
+		NumDisabledCones   += s.NumDisabledCones;
+		BuildTimeMs        += s.BuildTimeMs;
+
+		const std::vector<XMFLOAT3> Positions = GetPositions(Mesh);
+		uint32 NextFirstIndex = 0;
+		for (size_t i = 0; i < d.Meshlets.size(); ++i)
+		{
+			const FMeshlet& m = d.Meshlets[i];
+			const FMeshletBounds& b = d.Bounds[i];
+			bool bValid = m.NumVertices > 0 && m.NumVertices <= Settings.MaxVertices
+				&& m.NumTriangles > 0 && m.NumTriangles <= Settings.MaxTriangles
+				&& m.FirstIndex == NextFirstIndex;
+			for (uint32 t = 0; bValid && t < m.NumTriangles * 3; ++t)
+				bValid = d.VertexIndices[m.VertexOffset + d.TriangleIndices[m.TriangleOffset * 3 + t]] == d.Indices[m.FirstIndex + t];
+			NumLimitErrors += bValid ? 0 : 1;
+			NextFirstIndex += m.NumTriangles * 3;
+
+			const float RadiusSq = (b.Radius * (1.0f + 1e-5f) + 1e-6f) * (b.Radius * (1.0f + 1e-5f) + 1e-6f);
+			for (uint32 v = 0; v < m.NumVertices; ++v)
+			{
+				const XMFLOAT3& p = Positions[d.VertexIndices[m.VertexOffset + v]];
+				const bool bInside = p.x >= b.AABBMin.x && p.y >= b.AABBMin.y && p.z >= b.AABBMin.z
+					&& p.x <= b.AABBMax.x && p.y <= b.AABBMax.y && p.z <= b.AABBMax.z
+					&& DistanceSq(p, b.Center) <= RadiusSq;
+				if (!bInside)
+				{
+					++NumBoundsErrors;
+					break;
+				}
+			}
+		}
+
+		// every triangle exactly once, w/ its winding
+		NumCoverageErrors += GetSortedTriangles(Mesh.Indices) == GetSortedTriangles(d.Indices) ? 0 : 1;
+
+		if (iMesh % 16 == 0 || iMesh == Meshes.size() - 1)
+			NumNonDeterministic += IsEqual(d, BuildMeshlets(Mesh)) ? 0 : 1;
+	}
+
+	Test::Report("%u meshes (+%ux%u terrain)", NUM_TEST_MESHES, TERRAIN_TESSELLATION, TERRAIN_TESSELLATION);
+	Test::Report("meshlets       : %8u, %.1f vertices & %.1f triangles on average (max %u/%u)", NumMeshlets
+		, static_cast<float>(NumMeshletVertices) / NumMeshlets, static_cast<float>(NumTriangles) / NumMeshlets, Settings.MaxVertices, Settings.MaxTriangles);
+	Test::Report("vertices       : %8u -> %u in meshlets (%.2fx)", NumVertices, NumMeshletVertices, static_cast<float>(NumMeshletVertices) / NumVertices);
+	Test::Report("cones disabled : %8u (%.1f%%)", NumDisabledCones, 100.0 * NumDisabledCones / NumMeshlets);
+	Test::Report("build          : %8.2f ms, %u triangles", BuildTimeMs, NumTriangles);
+
+	TEST_CHECK(NumMeshlets > 0);
+	TEST_CHECK(NumLimitErrors == 0);
+	TEST_CHECK(NumBoundsErrors == 0);
+	TEST_CHECK(NumCoverageErrors == 0);
+	TEST_CHECK(NumNonDeterministic == 0);
+}
+
+VQE_TEST(Meshlets_InvalidTriangleList)
+{
+	const FTestMesh Mesh = GeometryGenerator::Cube<FVertexWithNormalAndTangent>();
+	std::vector<uint32> Indices = Mesh.Indices;
+	Indices.pop_back();
+	const uint32 NumVertices = static_cast<uint32>(Mesh.Vertices.size());
+	TEST_CHECK(MeshletBuilder::Build(Mesh.Vertices[0].position, sizeof(FVertexWithNormalAndTangent), NumVertices, Indices.data(), static_cast<uint32>(Indices.size()), MeshletBuilder::FSettings()).Meshlets.empty());
+
+	Indices = Mesh.Indices;
+	Indices[0] = NumVertices;
+	TEST_CHECK(MeshletBuilder::Build(Mesh.Vertices[0].position, sizeof(FVertexWithNormalAndTangent), NumVertices, Indices.data(), static_cast<uint32>(Indices.size()), MeshletBuilder::FSettings()).Meshlets.empty());
+}
+
+// the culled meshlets can't contain a triangle that may be visible from random cameras
+VQE_TEST(Meshlets_ConservativeCulling)
+{
+	std::mt19937 rng(1234);
+	const std::vector<FTestMesh> Meshes = GenerateTestMeshes(NUM_TEST_MESHES, rng);
+
+	uint32 NumCullingErrors = 0;
+	uint64 NumPotentiallyVisibleTriangles = 0;
+	std::vector<FMeshletData>           MeshletData(Meshes.size());
+	std::vector<std::vector<FTestView>> Views(Meshes.size());
+	std::vector<FIndexRange> Ranges;
+	MeshletCuller Culler;
+	for (size_t iMesh = 0; iMesh < Meshes.size(); ++iMesh)
+	{
+		const FTestMesh& Mesh = Meshes[iMesh];
+		MeshletData[iMesh] = BuildMeshlets(Mesh);
+		const FMeshletData& d = MeshletData[iMesh];
+		const std::vector<XMFLOAT3> Positions = GetPositions(Mesh);
+
+		for (uint32 iView = 0; iView < NUM_VIEWS_PER_MESH; ++iView)
+		{
+			const FTestView View = GenerateTestView(Mesh, rng);
+			Views[iMesh].push_back(View);
+
+			Ranges.clear();
+			Culler.Cull(d, View.matWorld, View.matViewProj, View.CameraPosition, Ranges);
+			std::vector<uint8> bDrawn(d.Indices.size() / 3, 0);
+			for (const FIndexRange& r : Ranges)
+				std::fill(bDrawn.begin() + r.FirstIndex / 3, bDrawn.begin() + (r.FirstIndex + r.NumIndices) / 3, uint8(1));
+
+			for (size_t t = 0; t < bDrawn.size(); ++t)
+			{
+				const XMFLOAT3 p[3] = { Positions[d.Indices[t * 3 + 0]], Positions[d.Indices[t * 3 + 1]], Positions[d.Indices[t * 3 + 2]] };
+				if (!IsTrianglePotentiallyVisible(p, View))
+					continue;
+				++NumPotentiallyVisibleTriangles;
+				NumCullingErrors += bDrawn[t] ? 0 : 1;
+			}
+		}
+	}
+
+	// cull rates & timing
+	Culler.BeginFrame();
+	for (size_t iMesh = 0; iMesh < Meshes.size(); ++iMesh)
+	{
+		for (const FTestView& View : Views[iMesh])
+		{
+			Ranges.clear();
+			Culler.Cull(MeshletData[iMesh], View.matWorld, View.matViewProj, View.CameraPosition, Ranges);
+		}
+	}
+	Culler.EndFrame();
+
+	const MeshletCuller::FStatistics& c = Culler.GetStatistics();
+	auto fnPercent = [](uint64 n, uint64 Total) { return Total > 0 ? 100.0 * n / Total : 0.0; };
+	Test::Report("%u meshes (+%ux%u terrain), %u views per mesh", NUM_TEST_MESHES, TERRAIN_TESSELLATION, TERRAIN_TESSELLATION, NUM_VIEWS_PER_MESH);
+	Test::Report("culling        : %8u meshlets tested, %.1f%% frustum culled, %.1f%% backface culled, %u/%u meshes fully culled", c.NumTestedMeshlets
+		, fnPercent(c.NumFrustumCulledMeshlets, c.NumTestedMeshlets), fnPercent(c.NumBackfaceCulledMeshlets, c.NumTestedMeshlets), c.NumCulledMeshes, c.NumTestedMeshes);
+	Test::Report("triangles      : %8.1f%% drawn, %.1f%% potentially visible, %u index ranges", fnPercent(c.NumVisibleTriangles, c.NumTestedTriangles)
+		, fnPercent(NumPotentiallyVisibleTriangles, c.NumTestedTriangles), c.NumIndexRanges);
+	Test::Report("cull time      : %8.2f ms", c.CullingTimeMs);
+
+	TEST_CHECK(NumCullingErrors == 0);
+	TEST_CHECK(c.NumFrustumCulledMeshlets > 0 && c.NumBackfaceCulledMeshlets > 0);
+}
+
+VQE_TEST(CookedMeshFile_RoundTrip)
+{
+	std::mt19937 rng(1234);
+	const std::string CookedFile = Test::GetTempFilePath("VQE_MeshletTest.vqmesh");
+	for (const FTestMesh& Mesh : { GenerateTestMesh(rng), GenerateTestMesh(rng), GenerateTerrain(64) })
+	{
+		const CookedMeshFile::FCookedMesh Cooked = CookMesh(Mesh, BuildMeshlets(Mesh));
+		CookedMeshFile::FCookedMesh Read;
+		TEST_CHECK(CookedMeshFile::Write(CookedFile, Cooked));
+		TEST_CHECK(CookedMeshFile::Read(CookedFile, Read));
+		TEST_CHECK(CookedMeshFile::IsEqual(Cooked, Read));
+
+		std::ifstream file(CookedFile, std::ios::in | std::ios::binary);
+		std::vector<char> Bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+		TEST_CHECK(!Bytes.empty());
+		if (Bytes.empty())
+			continue;
+
+		// truncated data & an out of range index are rejected
+		TEST_CHECK(!CookedMeshFile::Read(Bytes.data(), Bytes.size() - 4, Read));
+		const uint32 InvalidIndex = static_cast<uint32>(Mesh.Vertices.size());
+		std::memcpy(Bytes.data() + Bytes.size() - sizeof(uint32), &InvalidIndex, sizeof(uint32));
+		TEST_CHECK(!CookedMeshFile::Read(Bytes.data(), Bytes.size(), Read));
+	}
+	std::error_code ec;
+	std::filesystem::remove(CookedFile, ec);
+}
@@ -0,0 +1,176 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/OcclusionCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// camera at the origin looking down +Z, the occluder scene is a 10x10 wall at z=10 and a ground plane at y=-6
+	const std::vector<XMFLOAT3> WALL_VERTICES   = { {-5.0f, -5.0f, 10.0f}, {5.0f, -5.0f, 10.0f}, {5.0f, 5.0f, 10.0f}, {-5.0f, 5.0f, 10.0f} };
+	const std::vector<XMFLOAT3> GROUND_VERTICES = { {-50.0f, -6.0f, -20.0f}, {50.0f, -6.0f, -20.0f}, {50.0f, -6.0f, 200.0f}, {-50.0f, -6.0f, 200.0f} };
+	const std::vector<uint32>   QUAD_INDICES    = { 0, 1, 2, 0, 2, 3 };
+
+	XMMATRIX CreateTestViewProj()
+	{
+		const float AspectRatio = static_cast<float>(OcclusionCuller::DEFAULT_WIDTH) / OcclusionCuller::DEFAULT_HEIGHT;
+		return XMMatrixPerspectiveFovLH(1.2f, AspectRatio, 0.1f, 1000.0f); // view is identity
+	}
+
+	FOccluderMesh CreateOccluder(const std::vector<XMFLOAT3>& Vertices)
+	{
+		FOccluderMesh Occluder;
+		Occluder.pVertices  = Vertices.data();
+		Occluder.pIndices   = QUAD_INDICES.data();
+		Occluder.NumIndices = static_cast<uint32>(QUAD_INDICES.size());
+		Occluder.matWorld   = XMMatrixIdentity();
+		return Occluder;
+	}
+
+	void RasterizeTestScene(OcclusionCuller& Culler, bool bWithGround)
+	{
+		Culler.BeginFrame(CreateTestViewProj());
+		Culler.RasterizeOccluder(CreateOccluder(WALL_VERTICES));
+		if (bWithGround)
+			Culler.RasterizeOccluder(CreateOccluder(GROUND_VERTICES)); // crosses the near plane
+		Culler.EndFrame();
+	}
+
+	FBoundingBox MakeBox(const XMFLOAT3& Min, const XMFLOAT3& Max)
+	{
+		FBoundingBox Box;
+		Box.ExtentMin = Min;
+		Box.ExtentMax = Max;
+		return Box;
+	}
+}
+
+VQE_TEST(OcclusionCulling_SyntheticOccluderScene)
+{
+	struct FCase { const char* pName; FBoundingBox Box; bool bExpectOccluded; };
+	const FCase Cases[] =
+	{
+		{ "behind the wall"         , MakeBox({ -1.0f, -1.0f, 20.0f }, {  1.0f,  1.0f, 22.0f }), true  },
+		{ "wider than the wall"     , MakeBox({ -8.0f, -1.0f, 20.0f }, {  8.0f,  1.0f, 22.0f }), true  }, // perspective shrinks it behind the wall
+		{ "under the ground"        , MakeBox({ -1.0f, -8.0f, 30.0f }, {  1.0f, -7.0f, 32.0f }), true  },
+		{ "in front of the wall"    , MakeBox({ -1.0f, -1.0f,  5.0f }, {  1.0f,  1.0f,  6.0f }), false },
+		{ "next to the wall"        , MakeBox({ 20.0f, -1.0f, 20.0f }, { 22.0f,  1.0f, 22.0f }), false },
+		{ "intersecting the wall"   , MakeBox({ -1.0f, -1.0f,  9.0f }, {  1.0f,  1.0f, 12.0f }), false },
+		{ "containing the camera"   , MakeBox({ -1.0f, -1.0f, -1.0f }, {  1.0f,  1.0f,  1.0f }), false },
+	};
+
+	OcclusionCuller Culler;
+	Culler.Initialize();
+	RasterizeTestScene(Culler, true);
+
+	uint32 NumExpectedOccluded = 0;
+	for (const FCase& c : Cases)
+	{
+		const bool bOccluded = Culler.IsBoundingBoxOccluded(c.Box);
+		if (bOccluded != c.bExpectOccluded)
+			Test::Report("box %s: occluded=%d, expected %d", c.pName, bOccluded, c.bExpectOccluded);
+		TEST_CHECK(bOccluded == c.bExpectOccluded);
+		NumExpectedOccluded += c.bExpectOccluded ? 1 : 0;
+	}
+
+	// statistics are published by the next BeginFrame()
+	Culler.BeginFrame(CreateTestViewProj());
+	const OcclusionCuller::FStatistics Stats = Culler.GetStatistics();
+	TEST_CHECK(Stats.NumOccluders == 2);
+	TEST_CHECK(Stats.NumOccluderTriangles == 4);
+	TEST_CHECK(Stats.NumRasterizedTriangles >= 2 && Stats.NumRasterizedTriangles <= 4 + 2); // near clipping may split the ground
+	TEST_CHECK(Stats.NumTestedBoundingBoxes == sizeof(Cases) / sizeof(Cases[0]));
+	TEST_CHECK(Stats.NumOccludedBoundingBoxes == NumExpectedOccluded);
+}
+
+// every box reported occluded by the wall alone must be entirely inside the wall's frustum and behind it
+VQE_TEST(OcclusionCulling_Conservative)
+{
+	OcclusionCuller Culler;
+	Culler.Initialize();
+	RasterizeTestScene(Culler, false);
+
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> fnPos(-15.0f, 15.0f);
+	std::uniform_real_distribution<float> fnDepth(0.5f, 60.0f);
+	std::uniform_real_distribution<float> fnSize(0.05f, 4.0f);
+
+	uint32 NumOccluded = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		const XMFLOAT3 Min(fnPos(rng), fnPos(rng), fnDepth(rng));
+		const FBoundingBox Box = MakeBox(Min, XMFLOAT3(Min.x + fnSize(rng), Min.y + fnSize(rng), Min.z + fnSize(rng)));
+		if (!Culler.IsBoundingBoxOccluded(Box))
+			continue;
+
+		++NumOccluded;
+		const bool bBehindWall = Box.ExtentMin.z >= 10.0f;
+		const bool bInsideWallFrustum = std::max(std::abs(Box.ExtentMin.x), std::abs(Box.ExtentMax.x)) <= 0.5f * Box.ExtentMin.z
+		                             && std::max(std::abs(Box.ExtentMin.y), std::abs(Box.ExtentMax.y)) <= 0.5f * Box.ExtentMin.z;
+		TEST_CHECK(bBehindWall && bInsideWallFrustum);
+	}
+	Test::Report("%u / 20000 random boxes occluded", NumOccluded);
+	TEST_CHECK(NumOccluded > 0);
+}
+
+VQE_TEST(OcclusionCulling_ScalarMatchesAVX2)
+{
+	if (!OcclusionCuller::IsAVX2Supported())
+	{
+		Test::Report("AVX2 isn't supported, skipping");
+		return;
+	}
+
+	// random triangles in front of the camera, some crossing the near plane
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> fnXY(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> fnZ(-2.0f, 80.0f);
+	std::vector<XMFLOAT3> Vertices(3 * 500);
+	std::vector<uint32> Indices(Vertices.size());
+	for (size_t i = 0; i < Vertices.size(); ++i)
+	{
+		Vertices[i] = XMFLOAT3(fnXY(rng), fnXY(rng), fnZ(rng));
+		Indices[i] = static_cast<uint32>(i);
+	}
+	FOccluderMesh Occluder;
+	Occluder.pVertices  = Vertices.data();
+	Occluder.pIndices   = Indices.data();
+	Occluder.NumIndices = static_cast<uint32>(Indices.size());
+	Occluder.matWorld   = XMMatrixIdentity();
+
+	std::vector<float> DepthBuffers[2];
+	for (int bUseAVX2 = 0; bUseAVX2 < 2; ++bUseAVX2)
+	{
+		OcclusionCuller Culler;
+		Culler.Initialize();
+		Culler.SetUseAVX2(bUseAVX2 == 1);
+		Culler.BeginFrame(CreateTestViewProj());
+		Culler.RasterizeOccluder(Occluder);
+		Culler.EndFrame();
+		DepthBuffers[bUseAVX2] = Culler.GetDepthBuffer();
+	}
+	TEST_CHECK(DepthBuffers[0].size() == DepthBuffers[1].size());
+	TEST_CHECK(std::memcmp(DepthBuffers[0].data(), DepthBuffers[1].data(), DepthBuffers[0].size() * sizeof(float)) == 0);
+}
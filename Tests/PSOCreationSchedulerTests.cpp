@@ -0,0 +1,177 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Renderer/PSOCreationScheduler.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	// counts the compiles per shader stage key, an entry point named "Broken" fails to compile
+	struct FMockShaderCompiler
+	{
+		std::mutex                 Mtx;
+		std::map<std::string, int> NumCompiles;
+		std::atomic<int>           NumPSOCreations { 0 };
+
+		FShaderStageCompileResult Compile(const FShaderStageCompileDesc& Desc)
+		{
+			{
+				std::lock_guard<std::mutex> lk(Mtx);
+				++NumCompiles[ShaderUtils::GetShaderStageKey(Desc)];
+			}
+			FShaderStageCompileResult Result = {};
+			Result.ShaderStageEnum = ShaderUtils::GetShaderStageEnumFromShaderModel(Desc.ShaderModel);
+			if (Desc.EntryPoint != "Broken")
+				D3DCreateBlob(4, &Result.ShaderBlob.pD3DBlob);
+			return Result;
+		}
+
+		// never dereferenced: the scheduler only passes the PSO pointers through
+		ID3D12PipelineState* CreatePSO(const FPSODesc& Desc, const std::vector<FShaderStageCompileResult>& ShaderStages)
+		{
+			++NumPSOCreations;
+			return ShaderStages.size() == Desc.ShaderStageCompileDescs.size() ? reinterpret_cast<ID3D12PipelineState*>(this) : nullptr;
+		}
+	};
+
+	FShaderStageCompileDesc CreateStageDesc(const wchar_t* pFilePath, const char* pEntryPoint, const char* pShaderModel, std::vector<FShaderMacro> Macros = {})
+	{
+		FShaderStageCompileDesc Desc;
+		Desc.FilePath = pFilePath;
+		Desc.EntryPoint = pEntryPoint;
+		Desc.ShaderModel = pShaderModel;
+		Desc.Macros = std::move(Macros);
+		return Desc;
+	}
+
+	FPSODesc CreatePSODesc(const char* pName, std::vector<FShaderStageCompileDesc> Stages)
+	{
+		FPSODesc Desc = {};
+		Desc.PSOName = pName;
+		Desc.ShaderStageCompileDescs = std::move(Stages);
+		return Desc;
+	}
+
+	struct FSchedulerTestContext
+	{
+		ThreadPool ShaderWorkers;
+		ThreadPool PSOWorkers;
+		FMockShaderCompiler Compiler;
+		std::unique_ptr<PSOCreationScheduler> pScheduler;
+
+		FSchedulerTestContext()
+		{
+			ShaderWorkers.Initialize(4, "TestShaderWorkers");
+			PSOWorkers.Initialize(4, "TestPSOWorkers");
+			pScheduler = std::make_unique<PSOCreationScheduler>(ShaderWorkers, PSOWorkers
+				, [this](const FShaderStageCompileDesc& Desc) { return Compiler.Compile(Desc); }
+				, [this](const FPSODesc& Desc, const std::vector<FShaderStageCompileResult>& Stages) { return Compiler.CreatePSO(Desc, Stages); }
+			);
+		}
+		~FSchedulerTestContext()
+		{
+			pScheduler.reset();
+			PSOWorkers.Destroy();
+			ShaderWorkers.Destroy();
+		}
+	};
+}
+
+// a stage shared by several PSOs is compiled once, the macro order doesn't matter
+VQE_TEST(PSOCreationScheduler_SharedStagesCompiledOnce)
+{
+	FSchedulerTestContext ctx;
+	const FShaderStageCompileDesc VS      = CreateStageDesc(L"Shaders/Object.hlsl", "VSMain", "vs_6_0", { { "INSTANCED", "1" }, { "ALPHA_MASK", "0" } });
+	const FShaderStageCompileDesc VSSwap  = CreateStageDesc(L"Shaders/Object.hlsl", "VSMain", "vs_6_0", { { "ALPHA_MASK", "0" }, { "INSTANCED", "1" } });
+	const FShaderStageCompileDesc PSLit   = CreateStageDesc(L"Shaders/Object.hlsl", "PSMain", "ps_6_0");
+	const FShaderStageCompileDesc PSUnlit = CreateStageDesc(L"Shaders/Unlit.hlsl" , "PSMain", "ps_6_0");
+	const FShaderStageCompileDesc CS      = CreateStageDesc(L"Shaders/Tonemapper.hlsl", "CSMain", "cs_6_0");
+
+	PSO_ID IDs[4] = { INVALID_ID, INVALID_ID, INVALID_ID, INVALID_ID };
+	ctx.pScheduler->Enqueue(10, &IDs[0], CreatePSODesc("Lit"     , { VS, PSLit }));
+	ctx.pScheduler->Enqueue(11, &IDs[1], CreatePSODesc("LitSwap" , { VSSwap, PSLit }));
+	ctx.pScheduler->Enqueue(12, &IDs[2], CreatePSODesc("Unlit"   , { VS, PSUnlit }));
+	ctx.pScheduler->Enqueue(13, &IDs[3], CreatePSODesc("Tonemap" , { CS }));
+	ctx.pScheduler->Start();
+	const std::vector<PSOCreationScheduler::FResult> Results = ctx.pScheduler->Wait();
+
+	TEST_CHECK(Results.size() == 4);
+	for (size_t i = 0; i < Results.size(); ++i)
+	{
+		TEST_CHECK(Results[i].ID == static_cast<PSO_ID>(10 + i)); // in Enqueue() order
+		TEST_CHECK(Results[i].pID == &IDs[i]);
+		TEST_CHECK(Results[i].pPSO != nullptr);
+	}
+	const PSOCreationScheduler::FStatistics s = ctx.pScheduler->GetStatistics();
+	TEST_CHECK(s.NumPSOs == 4);
+	TEST_CHECK(s.NumShaderStages == 7);
+	TEST_CHECK(s.NumShaderStageCompiles == 4);
+	TEST_CHECK(ctx.Compiler.NumCompiles.size() == 4);
+	for (const std::pair<const std::string, int>& Compiles : ctx.Compiler.NumCompiles)
+		TEST_CHECK(Compiles.second == 1);
+	TEST_CHECK(ctx.Compiler.NumPSOCreations == 4);
+}
+
+// batches started before the same Wait() share their stages, a later batch compiles again
+VQE_TEST(PSOCreationScheduler_SharedStagesAcrossBatches)
+{
+	FSchedulerTestContext ctx;
+	const FShaderStageCompileDesc VS = CreateStageDesc(L"Shaders/DepthPrePass.hlsl", "VSMain", "vs_6_0");
+	const FShaderStageCompileDesc PS = CreateStageDesc(L"Shaders/DepthPrePass.hlsl", "PSMain", "ps_6_0");
+
+	PSO_ID IDs[3] = {};
+	ctx.pScheduler->Enqueue(0, &IDs[0], CreatePSODesc("DepthOnly", { VS }));
+	ctx.pScheduler->Start();
+	ctx.pScheduler->Enqueue(1, &IDs[1], CreatePSODesc("DepthNormals", { VS, PS }));
+	ctx.pScheduler->Start();
+	TEST_CHECK(ctx.pScheduler->Wait().size() == 2);
+	TEST_CHECK(ctx.pScheduler->GetStatistics().NumShaderStageCompiles == 2);
+
+	ctx.pScheduler->Enqueue(2, &IDs[2], CreatePSODesc("DepthNormalsReload", { VS, PS }));
+	ctx.pScheduler->Start();
+	const std::vector<PSOCreationScheduler::FResult> Results = ctx.pScheduler->Wait();
+	TEST_CHECK(Results.size() == 1 && Results[0].ID == 2 && Results[0].pPSO != nullptr);
+	TEST_CHECK(ctx.pScheduler->GetStatistics().NumShaderStageCompiles == 4);
+	TEST_CHECK(ctx.Compiler.NumCompiles[ShaderUtils::GetShaderStageKey(VS)] == 2);
+}
+
+// a failed stage fails the PSOs using it w/o creating them, the other PSOs aren't affected
+VQE_TEST(PSOCreationScheduler_FailedStage)
+{
+	FSchedulerTestContext ctx;
+	const FShaderStageCompileDesc VS       = CreateStageDesc(L"Shaders/Object.hlsl", "VSMain", "vs_6_0");
+	const FShaderStageCompileDesc PS       = CreateStageDesc(L"Shaders/Object.hlsl", "PSMain", "ps_6_0");
+	const FShaderStageCompileDesc PSBroken = CreateStageDesc(L"Shaders/Object.hlsl", "Broken", "ps_6_0");
+
+	PSO_ID IDs[3] = {};
+	ctx.pScheduler->Enqueue(0, &IDs[0], CreatePSODesc("Working", { VS, PS }));
+	ctx.pScheduler->Enqueue(1, &IDs[1], CreatePSODesc("Broken0", { VS, PSBroken }));
+	ctx.pScheduler->Enqueue(2, &IDs[2], CreatePSODesc("Broken1", { PSBroken }));
+	ctx.pScheduler->Start();
+	const std::vector<PSOCreationScheduler::FResult> Results = ctx.pScheduler->Wait();
+
+	TEST_CHECK(Results.size() == 3);
+	TEST_CHECK(Results.size() == 3 && Results[0].pPSO != nullptr && Results[1].pPSO == nullptr && Results[2].pPSO == nullptr);
+	TEST_CHECK(ctx.Compiler.NumPSOCreations == 1);
+	TEST_CHECK(ctx.Compiler.NumCompiles[ShaderUtils::GetShaderStageKey(PSBroken)] == 1);
+}
@@ -0,0 +1,550 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/RayQueries.h"
+#include "Source/Engine/Geometry.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	using FTestMesh = GeometryGenerator::GeometryData<FVertexWithNormalAndTangent>;
+
+	struct FTestScene
+	{
+		std::vector<FTestMesh>         Meshes;
+		std::vector<FRayQueryInstance> Instances;
+		XMFLOAT3                       InteriorMin;
+		XMFLOAT3                       InteriorMax;
+	};
+
+	enum class EAxisRotation { NONE, X90, Z90 }; // grids: NONE = floor, X90 = facing z, Z90 = facing x
+
+	struct FReferenceTriangle
+	{
+		double V0[3];
+		double E1[3];
+		double E2[3];
+	};
+
+	struct FReferenceInstance
+	{
+		double Min[3];
+		double Max[3];
+		uint32 FirstTriangle;
+		uint32 NumTriangles;
+	};
+
+	struct FReferenceScene
+	{
+		std::vector<FReferenceTriangle> Triangles; // world space, per instance
+		std::vector<FReferenceInstance> Instances;
+	};
+
+	struct FReferenceHit
+	{
+		double T = DBL_MAX;
+		uint32 InstanceIndex = FRayHit::INVALID_INDEX;
+		uint32 TriangleIndex = FRayHit::INVALID_INDEX;
+		inline bool IsHit() const { return InstanceIndex != FRayHit::INVALID_INDEX; }
+	};
+
+	// Maps the bounding box of the (rotated) mesh onto [Min, Max], flat axes are only translated
+	XMFLOAT4X4 CalculateFitTransformation(const FTestMesh& Mesh, EAxisRotation Rotation, const XMFLOAT3& Min, const XMFLOAT3& Max)
+	{
+		const XMMATRIX matRotation = Rotation == EAxisRotation::X90 ? XMMatrixRotationX(XM_PIDIV2)
+			: (Rotation == EAxisRotation::Z90 ? XMMatrixRotationZ(XM_PIDIV2) : XMMatrixIdentity());
+
+		XMVECTOR vMeshMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMeshMax = XMVectorReplicate(-FLT_MAX);
+		for (const FVertexWithNormalAndTangent& v : Mesh.Vertices)
+		{
+			const XMVECTOR p = XMVector3Transform(XMVectorSet(v.position[0], v.position[1], v.position[2], 1.0f), matRotation);
+			vMeshMin = XMVectorMin(vMeshMin, p);
+			vMeshMax = XMVectorMax(vMeshMax, p);
+		}
+		const XMVECTOR vMin = XMLoadFloat3(&Min);
+		const XMVECTOR vMax = XMLoadFloat3(&Max);
+		const XMVECTOR vMeshExtent = XMVectorSubtract(vMeshMax, vMeshMin);
+		const XMVECTOR vFlat = XMVectorLess(vMeshExtent, XMVectorReplicate(1e-6f));
+		const XMVECTOR vScale = XMVectorSelect(XMVectorDivide(XMVectorSubtract(vMax, vMin), XMVectorSelect(vMeshExtent, XMVectorSplatOne(), vFlat)), XMVectorSplatOne(), vFlat);
+		const XMVECTOR vMeshCenter = XMVectorScale(XMVectorAdd(vMeshMin, vMeshMax), 0.5f);
+		const XMVECTOR vCenter = XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f);
+
+		XMFLOAT4X4 matWorld;
+		XMStoreFloat4x4(&matWorld, matRotation * XMMatrixTranslationFromVector(XMVectorNegate(vMeshCenter)) * XMMatrixScalingFromVector(vScale) * XMMatrixTranslationFromVector(vCenter));
+		return matWorld;
+	}
+
+	// Sponza-like atrium: floor & walls, two stories of columns, balconies, beams, drapes & props
+	FTestScene GenerateAtrium(std::mt19937& rng)
+	{
+		using namespace GeometryGenerator;
+		using V = FVertexWithNormalAndTangent;
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		auto fnRange = [&](float Min, float Max) { return Min + (Max - Min) * fnUnit(rng); };
+
+		constexpr float HALF_LENGTH = 16.0f;
+		constexpr float HALF_WIDTH  = 8.0f;
+		constexpr float HEIGHT      = 14.0f;
+		constexpr float FLOOR2      = 5.0f; // second story
+		constexpr uint32 NUM_COLUMNS_PER_ROW = 11;
+		constexpr uint32 NUM_DRAPE_VARIANTS = 4;
+
+		FTestScene Scene;
+		enum EMesh : uint32 { FLOOR, WALL, COLUMN, LEDGE, BEAM, ORNAMENT, VASE, DRAPE0 };
+		Scene.Meshes.push_back(Grid<V>(1.0f, 1.0f, 128, 64));
+		Scene.Meshes.push_back(Grid<V>(1.0f, 1.0f, 64, 32));
+		Scene.Meshes.push_back(Cylinder<V>(1.0f, 1.0f, 1.0f, 48, 24));
+		Scene.Meshes.push_back(Cube<V>());
+		Scene.Meshes.push_back(Cylinder<V>(1.0f, 1.0f, 1.0f, 24, 4));
+		Scene.Meshes.push_back(Sphere<V>(1.0f, 48, 48));
+		Scene.Meshes.push_back(Cone<V>(1.0f, 1.0f, 32));
+		for (uint32 iDrape = 0; iDrape < NUM_DRAPE_VARIANTS; ++iDrape)
+		{
+			FTestMesh Drape = Grid<V>(1.0f, 1.0f, 32, 64);
+			const float Frequency = fnRange(10.0f, 20.0f);
+			const float Phase = fnRange(0.0f, XM_2PI);
+			for (V& v : Drape.Vertices)
+				v.position[1] = (0.6f + 0.4f * v.position[2]) * std::sin(v.position[0] * Frequency + Phase) + 0.2f * std::sin(v.position[2] * 7.0f);
+			Scene.Meshes.push_back(std::move(Drape));
+		}
+
+		auto fnAddInstance = [&](uint32 iMesh, EAxisRotation Rotation, const XMFLOAT3& Min, const XMFLOAT3& Max)
+		{
+			Scene.Instances.push_back({ iMesh, CalculateFitTransformation(Scene.Meshes[iMesh], Rotation, Min, Max) });
+		};
+
+		// shell, open to the sky
+		fnAddInstance(FLOOR, EAxisRotation::NONE, XMFLOAT3(-HALF_LENGTH, 0.0f, -HALF_WIDTH), XMFLOAT3(HALF_LENGTH, 0.0f, HALF_WIDTH));
+		for (float z : { -HALF_WIDTH, HALF_WIDTH })
+			fnAddInstance(WALL, EAxisRotation::X90, XMFLOAT3(-HALF_LENGTH, 0.0f, z), XMFLOAT3(HALF_LENGTH, HEIGHT, z));
+		for (float x : { -HALF_LENGTH, HALF_LENGTH })
+			fnAddInstance(WALL, EAxisRotation::Z90, XMFLOAT3(x, 0.0f, -HALF_WIDTH), XMFLOAT3(x, HEIGHT, HALF_WIDTH));
+
+		for (float Side : { -1.0f, 1.0f })
+		{
+			// balcony & its ledge
+			fnAddInstance(LEDGE, EAxisRotation::NONE, XMFLOAT3(-HALF_LENGTH, FLOOR2 - 0.5f, Side > 0.0f ? 5.0f : -HALF_WIDTH), XMFLOAT3(HALF_LENGTH, FLOOR2, Side > 0.0f ? HALF_WIDTH : -5.0f));
+			fnAddInstance(LEDGE, EAxisRotation::NONE, XMFLOAT3(-HALF_LENGTH, FLOOR2, Side * 5.0f - 0.1f), XMFLOAT3(HALF_LENGTH, FLOOR2 + 1.0f, Side * 5.0f + 0.1f));
+
+			for (uint32 iColumn = 0; iColumn < NUM_COLUMNS_PER_ROW; ++iColumn)
+			{
+				const float x = -14.0f + iColumn * 2.8f;
+				const float z = Side * 5.0f;
+				fnAddInstance(COLUMN, EAxisRotation::NONE, XMFLOAT3(x - 0.4f, 0.0f, z - 0.4f), XMFLOAT3(x + 0.4f, FLOOR2 - 0.5f, z + 0.4f));
+				fnAddInstance(COLUMN, EAxisRotation::NONE, XMFLOAT3(x - 0.3f, FLOOR2 + 1.0f, z + Side * 0.5f - 0.3f), XMFLOAT3(x + 0.3f, HEIGHT - 4.0f, z + Side * 0.5f + 0.3f));
+				if (iColumn + 1 == NUM_COLUMNS_PER_ROW)
+					continue;
+
+				// beam below the balcony, drape hanging between the upper columns
+				fnAddInstance(BEAM, EAxisRotation::Z90, XMFLOAT3(x + 0.4f, FLOOR2 - 0.9f, z - 0.2f), XMFLOAT3(x + 2.4f, FLOOR2 - 0.5f, z + 0.2f));
+				fnAddInstance(DRAPE0 + iColumn % NUM_DRAPE_VARIANTS, EAxisRotation::X90, XMFLOAT3(x + 0.4f, FLOOR2 + 1.5f, z - 0.15f), XMFLOAT3(x + 2.4f, HEIGHT - 4.5f, z + 0.15f));
+			}
+
+			for (uint32 iVase = 0; iVase < 6; ++iVase)
+			{
+				const float x = fnRange(-14.0f, 14.0f);
+				const float z = Side * fnRange(5.8f, 7.5f);
+				fnAddInstance(VASE, EAxisRotation::NONE, XMFLOAT3(x - 0.3f, FLOOR2, z - 0.3f), XMFLOAT3(x + 0.3f, FLOOR2 + 0.8f, z + 0.3f));
+			}
+		}
+
+		for (uint32 iOrnament = 0; iOrnament < 8; ++iOrnament)
+		{
+			const float Radius = fnRange(0.4f, 1.0f);
+			const XMFLOAT3 Center(fnRange(-12.0f, 12.0f), Radius, fnRange(-3.0f, 3.0f));
+			fnAddInstance(ORNAMENT, EAxisRotation::NONE, XMFLOAT3(Center.x - Radius, 0.0f, Center.z - Radius), XMFLOAT3(Center.x + Radius, 2.0f * Radius, Center.z + Radius));
+		}
+
+		Scene.InteriorMin = XMFLOAT3(-HALF_LENGTH + 0.5f, 0.1f, -HALF_WIDTH + 0.5f);
+		Scene.InteriorMax = XMFLOAT3( HALF_LENGTH - 0.5f, HEIGHT - 1.0f, HALF_WIDTH - 0.5f);
+		return Scene;
+	}
+
+	FReferenceScene BuildReferenceScene(const FTestScene& Scene)
+	{
+		FReferenceScene Reference;
+		for (const FRayQueryInstance& Instance : Scene.Instances)
+		{
+			const FTestMesh& Mesh = Scene.Meshes[Instance.MeshIndex];
+			const XMFLOAT4X4& m = Instance.matWorld;
+			FReferenceInstance RefInstance = { { DBL_MAX, DBL_MAX, DBL_MAX }, { -DBL_MAX, -DBL_MAX, -DBL_MAX }, static_cast<uint32>(Reference.Triangles.size()), static_cast<uint32>(Mesh.Indices.size() / 3) };
+			for (size_t iIndex = 0; iIndex + 2 < Mesh.Indices.size(); iIndex += 3)
+			{
+				double p[3][3];
+				for (int k = 0; k < 3; ++k)
+				{
+					const float* v = Mesh.Vertices[Mesh.Indices[iIndex + k]].position;
+					for (int c = 0; c < 3; ++c)
+					{
+						p[k][c] = static_cast<double>(v[0]) * m.m[0][c] + static_cast<double>(v[1]) * m.m[1][c] + static_cast<double>(v[2]) * m.m[2][c] + m.m[3][c];
+						RefInstance.Min[c] = std::min(RefInstance.Min[c], p[k][c]);
+						RefInstance.Max[c] = std::max(RefInstance.Max[c], p[k][c]);
+					}
+				}
+				FReferenceTriangle Triangle;
+				for (int c = 0; c < 3; ++c)
+				{
+					Triangle.V0[c] = p[0][c];
+					Triangle.E1[c] = p[1][c] - p[0][c];
+					Triangle.E2[c] = p[2][c] - p[0][c];
+				}
+				Reference.Triangles.push_back(Triangle);
+			}
+			Reference.Instances.push_back(RefInstance);
+		}
+		return Reference;
+	}
+
+	// Brute force closest hit in double precision, w/ the same inclusive tests as the packets
+	FReferenceHit IntersectReference(const FReferenceScene& Reference, const FRay& Ray)
+	{
+		const double O[3] = { Ray.Origin.x, Ray.Origin.y, Ray.Origin.z };
+		const double D[3] = { Ray.Direction.x, Ray.Direction.y, Ray.Direction.z };
+		FReferenceHit Hit;
+		for (uint32 iInstance = 0; iInstance < Reference.Instances.size(); ++iInstance)
+		{
+			// padded slab test, only to skip the instances far from the ray
+			const FReferenceInstance& Instance = Reference.Instances[iInstance];
+			double Entry = Ray.TMin, Exit = std::min(static_cast<double>(Ray.TMax), Hit.T);
+			for (int c = 0; c < 3 && Entry <= Exit; ++c)
+			{
+				const double Min = Instance.Min[c] - 1e-3, Max = Instance.Max[c] + 1e-3;
+				if (D[c] == 0.0)
+				{
+					if (O[c] < Min || O[c] > Max) Exit = -DBL_MAX;
+					continue;
+				}
+				const double t0 = (Min - O[c]) / D[c], t1 = (Max - O[c]) / D[c];
+				Entry = std::max(Entry, std::min(t0, t1));
+				Exit  = std::min(Exit , std::max(t0, t1));
+			}
+			if (Entry > Exit)
+				continue;
+
+			for (uint32 iTriangle = 0; iTriangle < Instance.NumTriangles; ++iTriangle)
+			{
+				const FReferenceTriangle& Tri = Reference.Triangles[Instance.FirstTriangle + iTriangle];
+				const double P[3] = { D[1] * Tri.E2[2] - D[2] * Tri.E2[1], D[2] * Tri.E2[0] - D[0] * Tri.E2[2], D[0] * Tri.E2[1] - D[1] * Tri.E2[0] };
+				const double Det = Tri.E1[0] * P[0] + Tri.E1[1] * P[1] + Tri.E1[2] * P[2];
+				if (Det == 0.0)
+					continue;
+				const double S[3] = { O[0] - Tri.V0[0], O[1] - Tri.V0[1], O[2] - Tri.V0[2] };
+				const double Q[3] = { S[1] * Tri.E1[2] - S[2] * Tri.E1[1], S[2] * Tri.E1[0] - S[0] * Tri.E1[2], S[0] * Tri.E1[1] - S[1] * Tri.E1[0] };
+				const double u = (S[0] * P[0] + S[1] * P[1] + S[2] * P[2]) / Det;
+				const double v = (D[0] * Q[0] + D[1] * Q[1] + D[2] * Q[2]) / Det;
+				const double t = (Tri.E2[0] * Q[0] + Tri.E2[1] * Q[1] + Tri.E2[2] * Q[2]) / Det;
+				if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && t >= Ray.TMin && t < Ray.TMax && t < Hit.T)
+				{
+					Hit.T = t;
+					Hit.InstanceIndex = iInstance;
+					Hit.TriangleIndex = iTriangle;
+				}
+			}
+		}
+		return Hit;
+	}
+
+	std::vector<FRay> GeneratePrimaryRays(uint32 NumRays)
+	{
+		struct FTestCamera { XMFLOAT3 Position; XMFLOAT3 LookAt; };
+		const FTestCamera Cameras[] =
+		{
+			{ XMFLOAT3(-14.0f, 1.7f,  0.0f), XMFLOAT3( 10.0f, 2.5f,  0.0f) }, // down the nave
+			{ XMFLOAT3( 14.0f, 1.7f,  2.0f), XMFLOAT3(-10.0f, 1.0f, -3.0f) },
+			{ XMFLOAT3( -6.0f, 7.5f, -6.5f), XMFLOAT3(  6.0f, 2.0f,  4.0f) }, // from the balcony
+			{ XMFLOAT3(  0.0f, 1.5f,  0.0f), XMFLOAT3(  2.0f, 14.0f, 1.0f) }, // up to the sky
+		};
+		constexpr uint32 NUM_CAMERAS = sizeof(Cameras) / sizeof(Cameras[0]);
+		constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+		const float TanHalfFov = std::tan(XMConvertToRadians(70.0f) * 0.5f);
+
+		const uint32 NumRaysPerCamera = std::max(1u, NumRays / NUM_CAMERAS);
+		const uint32 Width = std::max(1u, static_cast<uint32>(std::sqrt(NumRaysPerCamera * ASPECT_RATIO)));
+		const uint32 Height = (NumRaysPerCamera + Width - 1) / Width;
+
+		std::vector<FRay> Rays(NumRays);
+		for (uint32 i = 0; i < NumRays; ++i)
+		{
+			const FTestCamera& Cam = Cameras[std::min(i / NumRaysPerCamera, NUM_CAMERAS - 1)];
+			const uint32 iPixel = i % NumRaysPerCamera;
+			const float x = (2.0f * ((iPixel % Width) + 0.5f) / Width - 1.0f) * TanHalfFov * ASPECT_RATIO;
+			const float y = (1.0f - 2.0f * ((iPixel / Width) + 0.5f) / Height) * TanHalfFov;
+
+			const XMVECTOR Position = XMLoadFloat3(&Cam.Position);
+			const XMVECTOR Forward = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&Cam.LookAt), Position));
+			const XMVECTOR Right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), Forward));
+			const XMVECTOR Up = XMVector3Cross(Forward, Right);
+			Rays[i].Origin = Cam.Position;
+			XMStoreFloat3(&Rays[i].Direction, XMVector3Normalize(XMVectorAdd(Forward, XMVectorAdd(XMVectorScale(Right, x), XMVectorScale(Up, y)))));
+		}
+		return Rays;
+	}
+
+	std::vector<FRay> GenerateIncoherentRays(const FTestScene& Scene, uint32 NumRays, std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		auto fnRange = [&](float Min, float Max) { return Min + (Max - Min) * fnUnit(rng); };
+		std::vector<FRay> Rays(NumRays);
+		for (FRay& Ray : Rays)
+		{
+			const float z = fnRange(-1.0f, 1.0f);
+			const float Angle = fnRange(0.0f, XM_2PI);
+			const float r = std::sqrt(1.0f - z * z);
+			Ray.Origin = XMFLOAT3(fnRange(Scene.InteriorMin.x, Scene.InteriorMax.x), fnRange(Scene.InteriorMin.y, Scene.InteriorMax.y), fnRange(Scene.InteriorMin.z, Scene.InteriorMax.z));
+			Ray.Direction = XMFLOAT3(r * std::cos(Angle), r * std::sin(Angle), z);
+		}
+		return Rays;
+	}
+
+	// From the primary hits, pulled back towards the camera: half towards the sun, half as segments to a point light
+	std::vector<FRay> GenerateShadowRays(const std::vector<FRay>& PrimaryRays, const std::vector<FRayHit>& PrimaryHits)
+	{
+		const XMFLOAT3 LightPosition(0.0f, 12.0f, 0.0f);
+		XMFLOAT3 SunDirection;
+		XMStoreFloat3(&SunDirection, XMVector3Normalize(XMVectorSet(0.35f, 1.0f, 0.25f, 0.0f)));
+
+		std::vector<FRay> Rays(PrimaryRays.size());
+		for (size_t i = 0; i < Rays.size(); ++i)
+		{
+			const FRay& Primary = PrimaryRays[i];
+			const float T = PrimaryHits[i].IsHit() ? PrimaryHits[i].T - 1e-3f : 20.0f;
+			const XMFLOAT3 Origin(Primary.Origin.x + T * Primary.Direction.x, Primary.Origin.y + T * Primary.Direction.y, Primary.Origin.z + T * Primary.Direction.z);
+			if (i % 2)
+			{
+				Rays[i] = FRay::FromSegment(Origin, LightPosition, 0.0f);
+			}
+			else
+			{
+				Rays[i].Origin = Origin;
+				Rays[i].Direction = SunDirection;
+			}
+		}
+		return Rays;
+	}
+
+	constexpr uint32 NUM_REFERENCE_RAYS = 1024; // per ray type
+	constexpr uint32 NUM_TEST_RAYS = 16384;     // per ray type
+
+	struct FTestRaySet
+	{
+		const char*       pName;
+		std::vector<FRay> Rays;
+		bool              bAnyHit;
+	};
+
+	struct FTestAtrium
+	{
+		FTestScene                    Scene;
+		RayQueryAccelerationStructure AS;
+		std::vector<FTestRaySet>      RaySets; // primary, incoherent, shadow
+	};
+
+	void GenerateTestAtrium(FTestAtrium& Atrium, uint32 NumRays, ThreadPool& Workers)
+	{
+		std::mt19937 rng(5678);
+		Atrium.Scene = GenerateAtrium(rng);
+		for (const FTestMesh& Mesh : Atrium.Scene.Meshes)
+			Atrium.AS.AddMesh(Mesh.Vertices[0].position, sizeof(FVertexWithNormalAndTangent), static_cast<uint32>(Mesh.Vertices.size()), Mesh.Indices.data(), static_cast<uint32>(Mesh.Indices.size()));
+		Atrium.AS.BuildTopLevel(Atrium.Scene.Instances.data(), static_cast<uint32>(Atrium.Scene.Instances.size()));
+
+		Atrium.RaySets.push_back({ "primary   ", GeneratePrimaryRays(NumRays), false });
+		Atrium.RaySets.push_back({ "incoherent", GenerateIncoherentRays(Atrium.Scene, NumRays, rng), false });
+		std::vector<FRayHit> PrimaryHits(NumRays);
+		Atrium.AS.IntersectBatch(Atrium.RaySets[0].Rays.data(), NumRays, PrimaryHits.data(), &Workers);
+		Atrium.RaySets.push_back({ "shadow    ", GenerateShadowRays(Atrium.RaySets[0].Rays, PrimaryHits), true });
+	}
+
+	template<class TFn> float MeasureMedianMs(uint32 NumIterations, TFn&& fn)
+	{
+		std::vector<float> TimingsMs(NumIterations);
+		for (float& ms : TimingsMs)
+		{
+			const auto Start = std::chrono::steady_clock::now();
+			fn();
+			ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		}
+		std::sort(TimingsMs.begin(), TimingsMs.end());
+		return TimingsMs[NumIterations / 2];
+	}
+}
+
+// closest hits, distances & barycentrics of a subset of each ray type against a double precision brute force reference
+VQE_TEST(RayQueries_ReferenceHits)
+{
+	constexpr double T_TOLERANCE = 1e-3;            // world units, the directions are normalized except for the segments
+	constexpr double POSITION_TOLERANCE = 1e-3;
+	constexpr uint32 MAX_HIT_MISMATCHES_PER_1K = 2; // rays grazing the shared edges of the triangles can go either way in float
+
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "RayQueryTestWorkers");
+	std::unique_ptr<FTestAtrium> pAtrium = std::make_unique<FTestAtrium>();
+	GenerateTestAtrium(*pAtrium, NUM_REFERENCE_RAYS, Workers);
+	const RayQueryAccelerationStructure& AS = pAtrium->AS;
+	const FReferenceScene Reference = BuildReferenceScene(pAtrium->Scene);
+
+	const RayQueryAccelerationStructure::FStatistics& Stats = AS.GetStatistics();
+	TEST_CHECK(Stats.NumMeshes == pAtrium->Scene.Meshes.size());
+	TEST_CHECK(Stats.NumInstances == pAtrium->Scene.Instances.size());
+
+	for (const FTestRaySet& Set : pAtrium->RaySets)
+	{
+		uint32 NumHitMismatches = 0;
+		uint32 NumReferenceHits = 0;
+		uint32 NumDistanceErrors = 0;
+		uint32 NumPositionErrors = 0;
+		double MaxDistanceError = 0.0;
+		double MaxPositionError = 0.0;
+		for (const FRay& Ray : Set.Rays)
+		{
+			const FReferenceHit RefHit = IntersectReference(Reference, Ray);
+			FRayHit Hit;
+			const bool bHit = AS.Intersect(Ray, Hit);
+			NumReferenceHits += RefHit.IsHit() ? 1 : 0;
+			if (bHit != RefHit.IsHit())
+			{
+				++NumHitMismatches;
+				continue;
+			}
+			if (!bHit)
+				continue;
+
+			const double DistanceError = std::abs(Hit.T - RefHit.T);
+			MaxDistanceError = std::max(MaxDistanceError, DistanceError);
+			NumDistanceErrors += DistanceError > T_TOLERANCE ? 1 : 0;
+
+			// the barycentrics must land on the T along the ray
+			const FReferenceInstance& RefInstance = Reference.Instances[Hit.InstanceIndex];
+			TEST_CHECK(Hit.TriangleIndex < RefInstance.NumTriangles);
+			if (Hit.TriangleIndex >= RefInstance.NumTriangles)
+				continue;
+			const FReferenceTriangle& Tri = Reference.Triangles[RefInstance.FirstTriangle + Hit.TriangleIndex];
+			const double O[3] = { Ray.Origin.x, Ray.Origin.y, Ray.Origin.z };
+			const double D[3] = { Ray.Direction.x, Ray.Direction.y, Ray.Direction.z };
+			double PositionError = 0.0;
+			for (int c = 0; c < 3; ++c)
+				PositionError = std::max(PositionError, std::abs(Tri.V0[c] + Hit.U * Tri.E1[c] + Hit.V * Tri.E2[c] - (O[c] + Hit.T * D[c])));
+			MaxPositionError = std::max(MaxPositionError, PositionError);
+			NumPositionErrors += PositionError > POSITION_TOLERANCE ? 1 : 0;
+		}
+		Test::Report("%s: %u/%u reference hits, %u mismatches, T error %.6f, position error %.6f"
+			, Set.pName, NumReferenceHits, NUM_REFERENCE_RAYS, NumHitMismatches, MaxDistanceError, MaxPositionError);
+		TEST_CHECK(NumReferenceHits > 0);
+		TEST_CHECK(NumHitMismatches <= MAX_HIT_MISMATCHES_PER_1K * NUM_REFERENCE_RAYS / 1000);
+		TEST_CHECK(NumDistanceErrors == 0);
+		TEST_CHECK(NumPositionErrors == 0);
+	}
+	Workers.Destroy();
+}
+
+// any hit agrees w/ the closest hit & the batched results don't depend on the thread count
+VQE_TEST(RayQueries_BatchesAndDeterminism)
+{
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "RayQueryTestWorkers");
+	std::unique_ptr<FTestAtrium> pAtrium = std::make_unique<FTestAtrium>();
+	GenerateTestAtrium(*pAtrium, NUM_TEST_RAYS, Workers);
+	const RayQueryAccelerationStructure& AS = pAtrium->AS;
+
+	std::vector<FRayHit> Hits(NUM_TEST_RAYS), ParallelHits(NUM_TEST_RAYS);
+	std::unique_ptr<bool[]> Occluded(new bool[NUM_TEST_RAYS]), ParallelOccluded(new bool[NUM_TEST_RAYS]);
+	for (const FTestRaySet& Set : pAtrium->RaySets)
+	{
+		const FRay* pRays = Set.Rays.data();
+		AS.IntersectBatch(pRays, NUM_TEST_RAYS, Hits.data(), nullptr);
+		AS.IntersectBatch(pRays, NUM_TEST_RAYS, ParallelHits.data(), &Workers);
+		AS.IsOccludedBatch(pRays, NUM_TEST_RAYS, Occluded.get(), nullptr);
+		AS.IsOccludedBatch(pRays, NUM_TEST_RAYS, ParallelOccluded.get(), &Workers);
+		TEST_CHECK(std::memcmp(Hits.data(), ParallelHits.data(), NUM_TEST_RAYS * sizeof(FRayHit)) == 0);
+		TEST_CHECK(std::memcmp(Occluded.get(), ParallelOccluded.get(), NUM_TEST_RAYS * sizeof(bool)) == 0);
+
+		uint32 NumHits = 0;
+		uint32 NumOcclusionErrors = 0;
+		uint32 NumSingleRayErrors = 0;
+		for (uint32 i = 0; i < NUM_TEST_RAYS; ++i)
+		{
+			NumOcclusionErrors += Occluded[i] != Hits[i].IsHit() ? 1 : 0;
+			NumHits += Hits[i].IsHit() ? 1 : 0;
+			if (i % 64 == 0) // the single ray queries match the batches
+			{
+				FRayHit Hit;
+				AS.Intersect(pRays[i], Hit);
+				NumSingleRayErrors += std::memcmp(&Hit, &Hits[i], sizeof(FRayHit)) != 0 || AS.IsOccluded(pRays[i]) != Occluded[i] ? 1 : 0;
+			}
+		}
+		Test::Report("%s: %5.1f%% hits, %u occlusion errors", Set.pName, 100.0 * NumHits / NUM_TEST_RAYS, NumOcclusionErrors);
+		TEST_CHECK(NumOcclusionErrors == 0);
+		TEST_CHECK(NumSingleRayErrors == 0);
+	}
+	Workers.Destroy();
+}
+
+// Closest hit (primary & incoherent rays) & any hit (shadow rays) throughput in the atrium on this thread & w/ the workers.
+VQE_BENCHMARK(RayQueries_Throughput)
+{
+	constexpr uint32 NUM_RAYS = 262144; // per ray type
+	constexpr uint32 NUM_ITERATIONS = 5;
+
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "RayQueryBenchmarkWorkers");
+	const uint32 NumWorkers = static_cast<uint32>(Workers.GetThreadPoolSize());
+	std::unique_ptr<FTestAtrium> pAtrium = std::make_unique<FTestAtrium>();
+	GenerateTestAtrium(*pAtrium, NUM_RAYS, Workers);
+	const RayQueryAccelerationStructure& AS = pAtrium->AS;
+
+	const RayQueryAccelerationStructure::FStatistics& s = AS.GetStatistics();
+	Test::Report("%u meshes w/ %u triangles (%u nodes) in %.2fms, %u instances w/ %u triangles (%u nodes) in %.3fms, %.1f MB"
+		, s.NumMeshes, s.NumMeshTriangles, s.NumMeshNodes, s.MeshBuildTimeMs
+		, s.NumInstances, s.NumInstanceTriangles, s.NumInstanceNodes, s.TopLevelBuildTimeMs
+		, s.MemoryBytes / (1024.0 * 1024.0));
+
+	std::vector<FRayHit> Hits(NUM_RAYS), SerialHits(NUM_RAYS);
+	std::unique_ptr<bool[]> Occluded(new bool[NUM_RAYS]), SerialOccluded(new bool[NUM_RAYS]);
+	for (const FTestRaySet& Set : pAtrium->RaySets)
+	{
+		auto fnQuery = [&](ThreadPool* pWorkers)
+		{
+			if (Set.bAnyHit) AS.IsOccludedBatch(Set.Rays.data(), NUM_RAYS, Occluded.get(), pWorkers);
+			else             AS.IntersectBatch(Set.Rays.data(), NUM_RAYS, Hits.data(), pWorkers);
+		};
+		const float SerialMs = MeasureMedianMs(NUM_ITERATIONS, [&]() { fnQuery(nullptr); });
+		SerialHits = Hits;
+		std::memcpy(SerialOccluded.get(), Occluded.get(), NUM_RAYS * sizeof(bool));
+		const float ParallelMs = MeasureMedianMs(NUM_ITERATIONS, [&]() { fnQuery(&Workers); });
+
+		auto fnMRaysPerSecond = [&](float ms) { return ms > 0.0f ? NUM_RAYS / (ms * 1000.0) : 0.0; };
+		Test::Report("%s (%s): %.2fms serial (%.2f Mrays/s), %.2fms w/ %u workers (%.2f Mrays/s), median of %u"
+			, Set.pName, Set.bAnyHit ? "any hit" : "closest", SerialMs, fnMRaysPerSecond(SerialMs)
+			, ParallelMs, NumWorkers + 1, fnMRaysPerSecond(ParallelMs), NUM_ITERATIONS);
+		TEST_CHECK(Set.bAnyHit
+			? std::memcmp(Occluded.get(), SerialOccluded.get(), NUM_RAYS * sizeof(bool)) == 0
+			: std::memcmp(Hits.data(), SerialHits.data(), NUM_RAYS * sizeof(FRayHit)) == 0);
+	}
+	Workers.Destroy();
+}
@@ -0,0 +1,216 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/VQEngine.h"
+#include "Source/Engine/Scene/SceneSerialization.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace
+{
+	constexpr int NUM_MATERIALS = 64;
+
+	// StressTest-like level: objects w/ builtin meshes, some w/ model files & rotations, materials & lights
+	std::string GenerateLevelXML(uint32 NumObjects)
+	{
+		const char* BUILTIN_MESHES[] = { "Cube", "Sphere", "Cylinder", "Cone" };
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> fnPos(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		std::uniform_int_distribution<int>    fnMaterial(0, NUM_MATERIALS - 1);
+
+		std::string XML;
+		XML.reserve(static_cast<size_t>(NumObjects) * 320);
+		char buf[512];
+		auto fnAppend = [&](const char* pFormat, auto... Args) { snprintf(buf, sizeof(buf), pFormat, Args...); XML += buf; };
+
+		XML += "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<!-- generated by VQETests -->\n<Scene>\n";
+		XML += "\t<EnvironmentMap>\n\t\t<Preset>Stadium01</Preset>\n\t</EnvironmentMap>\n";
+		XML += "\t<Camera>\n\t\t<Position>0.0 30.0 -120</Position>\n\t\t<Pitch>10</Pitch>\n\t\t<Yaw>15</Yaw>\n\t\t<Projection>Perspective</Projection>\n"
+		       "\t\t<FoV>60.0</FoV>\n\t\t<Near>0.1</Near>\n\t\t<Far>5000</Far>\n"
+		       "\t\t<FirstPerson>\n\t\t\t<TranslationSpeed>100</TranslationSpeed>\n\t\t\t<AngularSpeed>0.05</AngularSpeed>\n\t\t\t<Drag>9.5</Drag>\n\t\t</FirstPerson>\n\t</Camera>\n";
+		XML += "\t<Light>\n\t\t<Transform>\n\t\t\t<Position>0 0 0</Position>\n\t\t\t<Rotation>30 0 40</Rotation>\n\t\t</Transform>\n"
+		       "\t\t<Color>1 0.95 0.8</Color>\n\t\t<Brightness>5</Brightness>\n\t\t<Mobility>Stationary</Mobility>\n\t\t<Enabled>true</Enabled>\n"
+		       "\t\t<Shadows>\n\t\t\t<DepthBias>0.0005</DepthBias>\n\t\t\t<NearPlane>0.1</NearPlane>\n\t\t\t<FarPlane>1500</FarPlane>\n\t\t</Shadows>\n"
+		       "\t\t<Directional>\n\t\t\t<ViewPortX>1024</ViewPortX>\n\t\t\t<ViewPortY>1024</ViewPortY>\n\t\t\t<Distance>500</Distance>\n\t\t</Directional>\n\t</Light>\n";
+		for (int i = 0; i < 16; ++i)
+		{
+			fnAppend("\t<Light>\n\t\t<Transform>\n\t\t\t<Position>%.3f %.3f %.3f</Position>\n\t\t\t<Scale>0.1</Scale>\n\t\t</Transform>\n"
+			         "\t\t<Color>%.3f %.3f %.3f</Color>\n\t\t<Range>%.2f</Range>\n\t\t<Brightness>%.2f</Brightness>\n\t\t<Mobility>Static</Mobility>\n"
+			         "\t\t<Point>\n\t\t\t<Attenuation>1 1 1</Attenuation>\n\t\t</Point>\n\t</Light>\n"
+				, fnPos(rng), fnUnit(rng) * 50.0f, fnPos(rng), fnUnit(rng), fnUnit(rng), fnUnit(rng), 50.0f + fnUnit(rng) * 200.0f, 100.0f + fnUnit(rng) * 1000.0f);
+		}
+		for (int i = 0; i < NUM_MATERIALS; ++i)
+		{
+			fnAppend("\t<Material>\n\t\t<Name>Material_%d</Name>\n\t\t<Diffuse>%.3f %.3f %.3f</Diffuse>\n\t\t<Alpha>1.0</Alpha>\n"
+			         "\t\t<Roughness>%.3f</Roughness>\n\t\t<Metalness>%.3f</Metalness>\n"
+				, i, fnUnit(rng), fnUnit(rng), fnUnit(rng), fnUnit(rng), fnUnit(rng));
+			if (i % 4 == 0)
+				fnAppend("\t\t<DiffuseMap>Data/Textures/PBR/Material_%d/BaseColor.png</DiffuseMap>\n\t\t<NormalMap>Data/Textures/PBR/Material_%d/Normal.png</NormalMap>\n", i, i);
+			XML += "\t</Material>\n";
+		}
+		for (uint32 i = 0; i < NumObjects; ++i)
+		{
+			fnAppend("\t<GameObject>\n\t\t<Transform>\n\t\t\t<Position>%.3f %.3f %.3f</Position>\n", fnPos(rng), fnPos(rng), fnPos(rng));
+			if (i % 3 == 0) fnAppend("\t\t\t<Rotation>%.1f %.1f %.1f</Rotation>\n", fnUnit(rng) * 360.0f, fnUnit(rng) * 360.0f, fnUnit(rng) * 360.0f);
+			if (i % 3 == 1) XML += "\t\t\t<Quaternion>0 0.7071068 0 0.7071068</Quaternion>\n";
+			if (i % 2 == 0) fnAppend("\t\t\t<Scale>%.2f</Scale>\n", 0.5f + fnUnit(rng) * 4.0f);
+			else            fnAppend("\t\t\t<Scale>%.2f %.2f %.2f</Scale>\n", 0.5f + fnUnit(rng) * 4.0f, 0.5f + fnUnit(rng) * 4.0f, 0.5f + fnUnit(rng) * 4.0f);
+			XML += "\t\t</Transform>\n\t\t<Model>\n";
+			if (i % 16 == 0) fnAppend("\t\t\t<Path>Data/Models/Model_%u/Model.gltf</Path>\n\t\t\t<Name>Model_%u</Name>\n", i % 256, i % 256);
+			else             fnAppend("\t\t\t<Mesh>%s</Mesh>\n\t\t\t<MaterialName>Material_%d</MaterialName>\n", BUILTIN_MESHES[i % 4], fnMaterial(rng));
+			XML += "\t\t</Model>\n";
+			if (i % 64 == 0) XML += "\t\t<Occluder>true</Occluder>\n";
+			XML += "\t</GameObject>\n";
+		}
+		XML += "</Scene>\n";
+		return XML;
+	}
+
+	bool WriteTextFile(const std::string& FilePath, const std::string& Text)
+	{
+		std::ofstream file(FilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(Text.data(), Text.size());
+		return file.good();
+	}
+
+	double GetElapsedMs(std::chrono::steady_clock::time_point& Start)
+	{
+		const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(Now - Start).count();
+		Start = Now;
+		return ms;
+	}
+}
+
+// the streaming parser & the binary file give back the representation of the tinyxml2 loader
+VQE_TEST(SceneSerialization_RoundTrip)
+{
+	const std::string XMLFile    = Test::GetTempFilePath("SceneSerialization_RoundTrip.xml");
+	const std::string BinaryFile = Test::GetTempFilePath("SceneSerialization_RoundTrip.vqscene");
+	TEST_CHECK(WriteTextFile(XMLFile, GenerateLevelXML(2000)));
+
+	const FSceneRepresentation RepDOM = VQEngine::ParseSceneFile(XMLFile);
+	TEST_CHECK(RepDOM.Objects.size() == 2000 && RepDOM.Materials.size() == NUM_MATERIALS && RepDOM.Lights.size() == 17);
+
+	FSceneRepresentation RepStreaming, RepBinary;
+	TEST_CHECK(SceneStreamingParser::ParseFile(XMLFile, RepStreaming));
+	TEST_CHECK(BinarySceneFile::IsEqual(RepDOM, RepStreaming));
+
+	TEST_CHECK(BinarySceneFile::Write(BinaryFile, RepDOM));
+	TEST_CHECK(BinarySceneFile::Read(BinaryFile, RepBinary));
+	TEST_CHECK(BinarySceneFile::IsEqual(RepDOM, RepBinary));
+
+	// the binary file is rejected when it's truncated
+	std::error_code ec;
+	std::filesystem::resize_file(BinaryFile, std::filesystem::file_size(BinaryFile, ec) / 2, ec);
+	FSceneRepresentation RepTruncated;
+	TEST_CHECK(!BinarySceneFile::Read(BinaryFile, RepTruncated));
+
+	std::filesystem::remove(XMLFile, ec);
+	std::filesystem::remove(BinaryFile, ec);
+}
+
+// XML features the level files use besides plain elements: comments, CDATA, entities, attributes
+VQE_TEST(SceneSerialization_StreamingParserSyntax)
+{
+	const char XML[] =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+		"<Scene>\n"
+		"\t<!-- <GameObject> in a comment isn't parsed -->\n"
+		"\t<Material name=\"ignored\">\n"
+		"\t\t<Name>A &amp; B</Name>\n"
+		"\t\t<DiffuseMap><![CDATA[Data/Textures/<x>.png]]></DiffuseMap>\n"
+		"\t</Material>\n"
+		"\t<GameObject>\n"
+		"\t\t<Transform><Position>1 2 3</Position></Transform>\n"
+		"\t\t<Model><Mesh>Cube</Mesh><MaterialName>A &amp; B</MaterialName></Model>\n"
+		"\t</GameObject>\n"
+		"</Scene>\n";
+
+	FSceneRepresentation Rep;
+	TEST_CHECK(SceneStreamingParser::Parse(XML, sizeof(XML) - 1, Rep));
+	TEST_CHECK(Rep.Materials.size() == 1 && Rep.Objects.size() == 1);
+	if (Rep.Materials.size() == 1 && Rep.Objects.size() == 1)
+	{
+		TEST_CHECK(Rep.Materials[0].Name == "A & B");
+		TEST_CHECK(Rep.Materials[0].DiffuseMapFilePath == "Data/Textures/<x>.png");
+		TEST_CHECK(Rep.Objects[0].MaterialName == "A & B" && Rep.Objects[0].BuiltinMeshName == "Cube");
+	}
+
+	// unterminated elements fail
+	FSceneRepresentation RepInvalid;
+	const char XMLInvalid[] = "<Scene>\n\t<GameObject>\n\t\t<Transform>\n";
+	TEST_CHECK(!SceneStreamingParser::Parse(XMLInvalid, sizeof(XMLInvalid) - 1, RepInvalid));
+}
+
+// load times of the tinyxml2 loader, the streaming parser & the binary scene cache on a 100k object level
+VQE_BENCHMARK(SceneSerialization_LoadTimes)
+{
+	constexpr uint32 NUM_OBJECTS    = 100000;
+	constexpr uint32 NUM_ITERATIONS = 3;
+
+	const std::string XML        = GenerateLevelXML(NUM_OBJECTS);
+	const std::string XMLFile    = Test::GetTempFilePath("SceneSerialization_LoadTimes.xml");
+	const std::string BinaryFile = Test::GetTempFilePath("SceneSerialization_LoadTimes.vqscene");
+	TEST_CHECK(WriteTextFile(XMLFile, XML));
+
+	// load w/ each path, keep the fastest iteration
+	FSceneRepresentation RepDOM, RepStreaming, RepBinary;
+	double DOMMs = 1e9, StreamingMs = 1e9, BinaryMs = 1e9, WriteMs = 1e9;
+	bool bLoaded = true;
+	for (uint32 i = 0; i < NUM_ITERATIONS; ++i)
+	{
+		std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+		RepDOM = VQEngine::ParseSceneFile(XMLFile);
+		DOMMs = std::min(DOMMs, GetElapsedMs(t));
+
+		bLoaded = SceneStreamingParser::ParseFile(XMLFile, RepStreaming) && bLoaded;
+		StreamingMs = std::min(StreamingMs, GetElapsedMs(t));
+
+		bLoaded = BinarySceneFile::Write(BinaryFile, RepDOM) && bLoaded;
+		WriteMs = std::min(WriteMs, GetElapsedMs(t));
+
+		bLoaded = BinarySceneFile::Read(BinaryFile, RepBinary) && bLoaded;
+		BinaryMs = std::min(BinaryMs, GetElapsedMs(t));
+	}
+
+	std::error_code ec;
+	const uint64 BinaryFileSize = std::filesystem::file_size(BinaryFile, ec);
+	std::filesystem::remove(XMLFile, ec);
+	std::filesystem::remove(BinaryFile, ec);
+
+	Test::Report("%u game objects, %d materials, %u lights, best of %u iterations"
+		, NUM_OBJECTS, NUM_MATERIALS, static_cast<uint32>(RepDOM.Lights.size()), NUM_ITERATIONS);
+	Test::Report("file size: xml=%.2fMB binary=%.2fMB", XML.size() / (1024.0 * 1024.0), BinaryFileSize / (1024.0 * 1024.0));
+	Test::Report("tinyxml2 DOM : %8.2fms", DOMMs);
+	Test::Report("streaming xml: %8.2fms (%.1fx)", StreamingMs, DOMMs / std::max(StreamingMs, 1e-3));
+	Test::Report("binary read  : %8.2fms (%.1fx), write=%.2fms", BinaryMs, DOMMs / std::max(BinaryMs, 1e-3), WriteMs);
+
+	TEST_CHECK(bLoaded);
+	TEST_CHECK(BinarySceneFile::IsEqual(RepDOM, RepStreaming));
+	TEST_CHECK(BinarySceneFile::IsEqual(RepDOM, RepBinary));
+	TEST_CHECK(StreamingMs < DOMMs && BinaryMs < StreamingMs);
+}
@@ -0,0 +1,282 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/Scene/SceneSnapshot.h"
+#include "Source/Engine/Scene/Transform.h"
+#include "Source/Engine/Core/Memory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	constexpr uint32 NUM_MATERIALS = 32;
+	constexpr uint32 NUM_LIGHTS    = 64;
+	constexpr uint32 NUM_CAMERAS   = 4;
+
+	inline uint32 GetNumModels(uint32 NumObjects) { return std::max(1u, NumObjects / 8); }
+
+	// models w/ 1-4 meshes, objects w/ & w/o models, lights of each type & mobility, cameras
+	FSceneSnapshot CreateTestSnapshot(uint32 NumObjects)
+	{
+		const uint32 NumModels = GetNumModels(NumObjects);
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> fnPos(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		std::uniform_int_distribution<uint32> fnMaterial(0, NUM_MATERIALS - 1);
+		auto fnFloat3 = [&](float Scale) { return DirectX::XMFLOAT3(fnPos(rng) * Scale, fnPos(rng) * Scale, fnPos(rng) * Scale); };
+
+		FSceneSnapshot Snapshot;
+		for (uint32 i = 0; i < NUM_MATERIALS; ++i)
+			Snapshot.Materials.push_back({ static_cast<MaterialID>(i), Snapshot.AddString("Material_" + std::to_string(i)) });
+		for (uint32 i = 0; i < NumModels; ++i)
+		{
+			FSceneSnapshot::FModelRecord m = {};
+			m.ID                   = static_cast<ModelID>(i);
+			m.Name                 = Snapshot.AddString("Model_" + std::to_string(i));
+			m.Path                 = i % 16 == 0 ? Snapshot.AddString("Data/Models/Model_" + std::to_string(i) + "/Model.gltf") : 0;
+			m.iFirstMeshMaterial   = static_cast<uint32>(Snapshot.MeshMaterials.size());
+			m.NumOpaqueMeshes      = 1 + i % 3;
+			m.NumTransparentMeshes = i % 5 == 0 ? 1 : 0;
+			m.bLoaded              = 1;
+			for (uint32 iMesh = 0; iMesh < m.NumOpaqueMeshes + m.NumTransparentMeshes; ++iMesh)
+				Snapshot.MeshMaterials.push_back({ static_cast<MeshID>(i * 4 + iMesh), iMesh == 3 ? FSceneSnapshot::INVALID_INDEX : fnMaterial(rng) });
+			Snapshot.Models.push_back(m);
+		}
+		Snapshot.Transforms.resize(NumObjects);
+		Snapshot.Objects.resize(NumObjects);
+		for (uint32 i = 0; i < NumObjects; ++i)
+		{
+			const float Angle = fnUnit(rng) * 3.14159f;
+			Snapshot.Transforms[i] = { fnFloat3(1.0f), DirectX::XMFLOAT3(0.0f, std::sin(Angle), 0.0f), std::cos(Angle), fnFloat3(0.01f) };
+
+			FSceneSnapshot::FObjectRecord& o = Snapshot.Objects[i];
+			o.iTransform          = i;
+			o.iModel              = i % 97 == 0 ? FSceneSnapshot::INVALID_INDEX : i % NumModels;
+			o.LocalSpaceBoundsMin = DirectX::XMFLOAT3(-1.0f, -1.0f, -1.0f);
+			o.LocalSpaceBoundsMax = fnFloat3(0.01f);
+			o.bOccluder           = i % 64 == 0 ? 1 : 0;
+		}
+		for (uint32 i = 0; i <= NUM_LIGHTS; ++i)
+		{
+			Light l;
+			l.Type            = i == 0 ? Light::EType::DIRECTIONAL : static_cast<Light::EType>(i % 2);
+			l.Mobility        = static_cast<Light::EMobility>(i % Light::NUM_LIGHT_MOBILITY_TYPES);
+			l.Position        = fnFloat3(1.0f);
+			l.Range           = 50.0f + fnUnit(rng) * 200.0f;
+			l.Color           = DirectX::XMFLOAT3(fnUnit(rng), fnUnit(rng), fnUnit(rng));
+			l.Brightness      = fnUnit(rng) * 1000.0f;
+			l.bCastingShadows = i % 4 == 0;
+			l.ViewportX       = fnUnit(rng);
+			if (i == 0) Snapshot.DirectionalLight = l;
+			else        Snapshot.Lights.push_back(l);
+		}
+		for (uint32 i = 0; i < NUM_CAMERAS; ++i)
+			Snapshot.Cameras.push_back({ 0.0f, fnFloat3(1.0f), DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), 1.0f + fnUnit(rng), 0.1f, 5000.0f });
+		Snapshot.iSelectedCamera = NUM_CAMERAS - 1;
+		return Snapshot;
+	}
+
+	std::vector<char> ReadFileBytes(const std::string& FilePath)
+	{
+		std::ifstream file(FilePath, std::ios::in | std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// restores into pools w/ different ModelIDs than the snapshot & captures back
+	struct FObjectRoundTrip
+	{
+		std::vector<ModelID>                ModelIDs;
+		std::unordered_map<ModelID, uint32> ModelIndices;
+		MemoryPool<GameObject>              GameObjectPool;
+		MemoryPool<Transform>               TransformPool;
+		std::vector<GameObject*>            pObjects;
+		std::vector<Transform*>             pTransforms;
+
+		FObjectRoundTrip(uint32 NumObjects, uint32 NumModels)
+			: GameObjectPool(NumObjects, 64)
+			, TransformPool(NumObjects, 64)
+		{
+			ModelIDs.resize(NumModels);
+			for (uint32 i = 0; i < NumModels; ++i)
+			{
+				ModelIDs[i] = static_cast<ModelID>(1000 + i);
+				ModelIndices[ModelIDs[i]] = i;
+			}
+		}
+		~FObjectRoundTrip()
+		{
+			for (Transform* pTf : pTransforms) TransformPool.Free(pTf);
+			for (GameObject* pObj : pObjects) GameObjectPool.Free(pObj);
+		}
+	};
+}
+
+VQE_TEST(SceneSnapshot_FileRoundTrip)
+{
+	const FSceneSnapshot Snapshot = CreateTestSnapshot(5000);
+	const std::string SnapshotFile = Test::GetTempFilePath("SceneSnapshot_FileRoundTrip.vqsnap");
+
+	FSceneSnapshot Loaded;
+	TEST_CHECK(SceneSnapshot::Save(SnapshotFile, Snapshot));
+	TEST_CHECK(SceneSnapshot::Load(SnapshotFile, Loaded));
+	TEST_CHECK(SceneSnapshot::IsEqual(Snapshot, Loaded));
+
+	// an empty snapshot round trips too
+	const FSceneSnapshot Empty;
+	TEST_CHECK(SceneSnapshot::Save(SnapshotFile, Empty) && SceneSnapshot::Load(SnapshotFile, Loaded) && SceneSnapshot::IsEqual(Empty, Loaded));
+
+	std::error_code ec;
+	std::filesystem::remove(SnapshotFile, ec);
+}
+
+// files that can't be restored safely are rejected, chunks w/ unknown tags are skipped
+VQE_TEST(SceneSnapshot_InvalidFiles)
+{
+	const std::string SnapshotFile = Test::GetTempFilePath("SceneSnapshot_InvalidFiles.vqsnap");
+	const FSceneSnapshot Snapshot = CreateTestSnapshot(500);
+	TEST_CHECK(SceneSnapshot::Save(SnapshotFile, Snapshot));
+	const std::vector<char> File = ReadFileBytes(SnapshotFile);
+	TEST_CHECK(File.size() > sizeof(SceneSnapshot::FHeader) + sizeof(SceneSnapshot::FChunkHeader));
+
+	FSceneSnapshot Loaded;
+	auto fnLoad = [&Loaded](const std::vector<char>& Bytes) { return SceneSnapshot::Load(Bytes.data(), Bytes.size(), Loaded); };
+	TEST_CHECK(fnLoad(File) && SceneSnapshot::IsEqual(Snapshot, Loaded));
+
+	auto fnHeader = [](std::vector<char>& Bytes) { return reinterpret_cast<SceneSnapshot::FHeader*>(Bytes.data()); };
+	auto fnFirstChunk = [](std::vector<char>& Bytes) { return reinterpret_cast<SceneSnapshot::FChunkHeader*>(Bytes.data() + sizeof(SceneSnapshot::FHeader)); };
+
+	std::vector<char> Bytes = File;
+	fnHeader(Bytes)->Version = SceneSnapshot::VERSION + 1;
+	TEST_CHECK(!fnLoad(Bytes));
+
+	Bytes = File;
+	fnFirstChunk(Bytes)->ElementSize += 4; // record layout changed
+	TEST_CHECK(!fnLoad(Bytes));
+
+	Bytes = File;
+	fnFirstChunk(Bytes)->NumElements = ~0ull;
+	TEST_CHECK(!fnLoad(Bytes));
+
+	for (size_t Size : { File.size() / 2, File.size() - 9 /*past the padding of the last chunk*/, sizeof(SceneSnapshot::FHeader) + 4 })
+	{
+		Bytes.assign(File.begin(), File.begin() + Size);
+		TEST_CHECK(!fnLoad(Bytes));
+	}
+
+	// out of range references
+	FSceneSnapshot Invalid = Snapshot;
+	Invalid.Objects[10].iTransform = static_cast<uint32>(Invalid.Transforms.size());
+	TEST_CHECK(SceneSnapshot::Save(SnapshotFile, Invalid) && !SceneSnapshot::Load(SnapshotFile, Loaded));
+	Invalid = Snapshot;
+	Invalid.MeshMaterials.back().iMaterial = NUM_MATERIALS;
+	TEST_CHECK(SceneSnapshot::Save(SnapshotFile, Invalid) && !SceneSnapshot::Load(SnapshotFile, Loaded));
+
+	// a chunk from a newer version is skipped
+	Bytes = File;
+	const SceneSnapshot::FChunkHeader UnknownChunk = { 0x4E4B4E55, 4, 2 }; // "UNKN"
+	const uint32 UnknownData[2] = { 1, 2 };
+	Bytes.insert(Bytes.end(), reinterpret_cast<const char*>(&UnknownChunk), reinterpret_cast<const char*>(&UnknownChunk + 1));
+	Bytes.insert(Bytes.end(), reinterpret_cast<const char*>(UnknownData), reinterpret_cast<const char*>(UnknownData + 2));
+	++fnHeader(Bytes)->NumChunks;
+	TEST_CHECK(fnLoad(Bytes) && SceneSnapshot::IsEqual(Snapshot, Loaded));
+
+	std::error_code ec;
+	std::filesystem::remove(SnapshotFile, ec);
+}
+
+// restoring over the previous objects & capturing back gives the same snapshot every time
+VQE_TEST(SceneSnapshot_ObjectRoundTrip)
+{
+	constexpr uint32 NUM_OBJECTS = 5000;
+	const FSceneSnapshot Snapshot = CreateTestSnapshot(NUM_OBJECTS);
+	FObjectRoundTrip RoundTrip(NUM_OBJECTS, GetNumModels(NUM_OBJECTS));
+
+	for (int i = 0; i < 3; ++i)
+	{
+		FSceneSnapshot Captured = Snapshot; // keeps the non-object tables
+		Captured.Objects.clear();
+		Captured.Transforms.clear();
+		SceneSnapshot::RestoreObjects(Snapshot, RoundTrip.ModelIDs, RoundTrip.GameObjectPool, RoundTrip.TransformPool, RoundTrip.pObjects, RoundTrip.pTransforms);
+		SceneSnapshot::CaptureObjects(RoundTrip.pObjects, RoundTrip.pTransforms, RoundTrip.ModelIndices, Captured);
+		TEST_CHECK(SceneSnapshot::IsEqual(Snapshot, Captured));
+	}
+
+	// the restored objects use the scene's ModelIDs, TransformIDs are the snapshot indices
+	bool bIDsMatch = RoundTrip.pObjects.size() == NUM_OBJECTS;
+	for (size_t i = 0; bIDsMatch && i < RoundTrip.pObjects.size(); ++i)
+	{
+		const FSceneSnapshot::FObjectRecord& r = Snapshot.Objects[i];
+		const GameObject& obj = *RoundTrip.pObjects[i];
+		bIDsMatch = obj.mTransformID == static_cast<TransformID>(r.iTransform)
+			&& obj.mModelID == (r.iModel == FSceneSnapshot::INVALID_INDEX ? INVALID_ID : RoundTrip.ModelIDs[r.iModel]);
+	}
+	TEST_CHECK(bIDsMatch);
+}
+
+// save, load, restore & capture times of a 100k object snapshot
+VQE_BENCHMARK(SceneSnapshot_SaveLoadTimes)
+{
+	constexpr uint32 NUM_OBJECTS    = 100000;
+	constexpr uint32 NUM_ITERATIONS = 3;
+	const FSceneSnapshot Snapshot = CreateTestSnapshot(NUM_OBJECTS);
+	const std::string SnapshotFile = Test::GetTempFilePath("SceneSnapshot_SaveLoadTimes.vqsnap");
+	FObjectRoundTrip RoundTrip(NUM_OBJECTS, GetNumModels(NUM_OBJECTS));
+
+	auto fnTimeMs = [](auto&& fnWork)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		fnWork();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	};
+
+	// keep the fastest iteration
+	FSceneSnapshot Loaded;
+	double SaveMs = 1e9, LoadMs = 1e9, RestoreMs = 1e9, CaptureMs = 1e9;
+	bool bRoundTrip = true;
+	for (uint32 i = 0; i < NUM_ITERATIONS; ++i)
+	{
+		FSceneSnapshot Captured = Snapshot;
+		SaveMs    = std::min(SaveMs   , fnTimeMs([&]() { bRoundTrip = SceneSnapshot::Save(SnapshotFile, Snapshot) && bRoundTrip; }));
+		LoadMs    = std::min(LoadMs   , fnTimeMs([&]() { bRoundTrip = SceneSnapshot::Load(SnapshotFile, Loaded) && bRoundTrip; }));
+		RestoreMs = std::min(RestoreMs, fnTimeMs([&]() { SceneSnapshot::RestoreObjects(Loaded, RoundTrip.ModelIDs, RoundTrip.GameObjectPool, RoundTrip.TransformPool, RoundTrip.pObjects, RoundTrip.pTransforms); }));
+		CaptureMs = std::min(CaptureMs, fnTimeMs([&]() { SceneSnapshot::CaptureObjects(RoundTrip.pObjects, RoundTrip.pTransforms, RoundTrip.ModelIndices, Captured); }));
+		bRoundTrip = bRoundTrip && SceneSnapshot::IsEqual(Snapshot, Loaded) && SceneSnapshot::IsEqual(Snapshot, Captured);
+	}
+
+	std::error_code ec;
+	const uint64 FileSize = std::filesystem::file_size(SnapshotFile, ec);
+	std::filesystem::remove(SnapshotFile, ec);
+
+	Test::Report("%u game objects, %u models, %u mesh materials, %u lights, best of %u iterations"
+		, NUM_OBJECTS, GetNumModels(NUM_OBJECTS), static_cast<uint32>(Snapshot.MeshMaterials.size()), NUM_LIGHTS + 1, NUM_ITERATIONS);
+	Test::Report("file size: %.2fMB", FileSize / (1024.0 * 1024.0));
+	Test::Report("save   : %8.2fms", SaveMs);
+	Test::Report("load   : %8.2fms", LoadMs);
+	Test::Report("restore: %8.2fms", RestoreMs);
+	Test::Report("capture: %8.2fms", CaptureMs);
+	TEST_CHECK(bRoundTrip);
+}
@@ -0,0 +1,246 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/Core/SettingsRegistry.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	enum class ETestDisplayMode { WINDOWED = 0, BORDERLESS = 1, FULLSCREEN = 2 };
+	constexpr FSettingNamedValue DISPLAY_MODE_NAMES[] =
+	{
+		  { "Windowed"  , static_cast<int>(ETestDisplayMode::WINDOWED)   }
+		, { "Borderless", static_cast<int>(ETestDisplayMode::BORDERLESS) }
+		, { "Fullscreen", static_cast<int>(ETestDisplayMode::FULLSCREEN) }
+	};
+	constexpr FSettingNamedValue MAX_FRAME_RATE_NAMES[] =
+	{
+		  { "Auto"     , -1 }
+		, { "Unlimited",  0 }
+	};
+
+	// a settings record w/ a field of each setting type
+	struct FTestSettings
+	{
+		bool             bVSync       = false;
+		int              MaxFrameRate = 0;
+		unsigned         Width        = 0;
+		float            RenderScale  = 0.0f;
+		std::string      LogFile;
+		ETestDisplayMode DisplayMode  = ETestDisplayMode::WINDOWED;
+		bool             bAA          = false;
+		int              NumParsed    = 0;
+	};
+	#define TEST_SETTING(Section, Key, Alias, Field) VQ_SETTING(FTestSettings, Section, Key, Alias, Field, ++p.NumParsed)
+	#define TEST_SETTING_NAMED(Section, Key, Alias, Field, NamedValues) VQ_SETTING_NAMED(FTestSettings, Section, Key, Alias, Field, NamedValues, ++p.NumParsed)
+	constexpr TSettingDesc<FTestSettings> TEST_SCHEMA[] =
+	{
+		  TEST_SETTING      ("Graphics", "VSync"       , nullptr , bVSync)
+		, TEST_SETTING_NAMED("Graphics", "MaxFrameRate", "MaxFPS", MaxFrameRate, MAX_FRAME_RATE_NAMES)
+		, TEST_SETTING      ("Graphics", "RenderScale" , nullptr , RenderScale)
+		, TEST_SETTING      ("Graphics", "AntiAliasing", "AA"    , bAA)
+		, TEST_SETTING      ("Window"  , "Width"       , nullptr , Width)
+		, TEST_SETTING_NAMED("Window"  , "DisplayMode" , nullptr , DisplayMode, DISPLAY_MODE_NAMES)
+		, TEST_SETTING      ("Engine"  , "LogFile"     , nullptr , LogFile)
+	};
+	#undef TEST_SETTING
+	#undef TEST_SETTING_NAMED
+
+	template<class T>  std::string ToString(const T& v) { return SettingValueToString(v, nullptr, 0); }
+	template<class T, size_t N> std::string ToString(const T& v, const FSettingNamedValue(&Names)[N]) { return SettingValueToString(v, Names, N); }
+
+	std::string WriteINI(const FTestSettings& s)
+	{
+		std::string INI = "; written by VQETests\n";
+		INI += "[Graphics]\n";
+		INI += "VSync=" + ToString(s.bVSync) + "\n";
+		INI += "MaxFPS = " + ToString(s.MaxFrameRate, MAX_FRAME_RATE_NAMES) + "\n";
+		INI += "RenderScale=" + ToString(s.RenderScale) + "\n";
+		INI += "AA=" + ToString(s.bAA) + "\n";
+		INI += "\n[Window]\r\n";
+		INI += "Width=" + ToString(s.Width) + "\r\n";
+		INI += "DisplayMode=" + ToString(s.DisplayMode, DISPLAY_MODE_NAMES) + "\r\n";
+		INI += "[ Engine ]\n";
+		INI += "LogFile=" + s.LogFile; // no trailing newline
+		return INI;
+	}
+
+	uint32 ReadINI(const std::string& INI, FTestSettings& s)
+	{
+		INIFile File;
+		File.Parse(INI, "VQETests.ini");
+		uint32 NumErrors = 0;
+		for (const INIFile::FSection& Section : File.GetSections())
+			NumErrors += ApplySettingsSection(File, Section, TEST_SCHEMA, s);
+		return NumErrors;
+	}
+
+	bool IsBitwiseEqual(float a, float b) { return memcmp(&a, &b, sizeof(float)) == 0; }
+}
+
+// writing the settings w/ SettingValueToString() and parsing them back gives the same record
+VQE_TEST(SettingsRegistry_RoundTrip)
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<uint32> fnBits;
+	const char CHARSET[] = "abcXYZ019 _-./\\:=;#[]";
+
+	bool bAllMatch = true;
+	for (int i = 0; i < 2000; ++i)
+	{
+		FTestSettings s;
+		s.bVSync       = fnBits(rng) & 1;
+		s.bAA          = fnBits(rng) & 1;
+		s.MaxFrameRate = static_cast<int>(fnBits(rng) % 400) - 2;
+		s.Width        = (i % 10 == 0) ? fnBits(rng) : fnBits(rng) % 8192;
+		s.DisplayMode  = static_cast<ETestDisplayMode>(fnBits(rng) % 3);
+		do
+		{
+			const uint32 Bits = fnBits(rng);
+			memcpy(&s.RenderScale, &Bits, sizeof(float));
+			if (i % 2 == 0)
+				s.RenderScale = std::ldexp(static_cast<float>(Bits % 1000) / 1000.0f, static_cast<int>(Bits % 7) - 3);
+		} while (!std::isfinite(s.RenderScale));
+		for (uint32 iChar = fnBits(rng) % 24; iChar > 0; --iChar)
+			s.LogFile += CHARSET[fnBits(rng) % (sizeof(CHARSET) - 1)];
+		while (!s.LogFile.empty() && s.LogFile.back()  == ' ') s.LogFile.pop_back(); // values are trimmed
+		while (!s.LogFile.empty() && s.LogFile.front() == ' ') s.LogFile.erase(0, 1);
+
+		FTestSettings r;
+		const uint32 NumErrors = ReadINI(WriteINI(s), r);
+		const bool bMatch = NumErrors == 0 && r.NumParsed == 7
+			&& r.bVSync == s.bVSync && r.bAA == s.bAA && r.MaxFrameRate == s.MaxFrameRate && r.Width == s.Width
+			&& IsBitwiseEqual(r.RenderScale, s.RenderScale) && r.LogFile == s.LogFile && r.DisplayMode == s.DisplayMode;
+		if (!bMatch && bAllMatch)
+			Test::Report("mismatch on iteration %d:\n%s", i, WriteINI(s).c_str());
+		bAllMatch = bAllMatch && bMatch;
+	}
+	TEST_CHECK(bAllMatch);
+
+	// short values stay short
+	TEST_CHECK(ToString(1.5f) == "1.5");
+	TEST_CHECK(ToString(0.1f) == "0.1");
+	TEST_CHECK(ToString(-1, MAX_FRAME_RATE_NAMES) == "Auto");
+	TEST_CHECK(ToString(ETestDisplayMode::BORDERLESS, DISPLAY_MODE_NAMES) == "Borderless");
+}
+
+// sections, comments, malformed lines, unknown keys & invalid values
+VQE_TEST(SettingsRegistry_Parsing)
+{
+	const std::string INI =
+		"\xEF\xBB\xBF" "LogFile=unnamed section\n"
+		"# comment\n"
+		"[Graphics]\n"
+		"  ; indented comment\n"
+		"VSync = YES\n"
+		"MaxFrameRate=unlimited\n"
+		"RenderScale=1.5x\n"      // invalid float
+		"NotASetting=1\n"         // unknown key
+		"missing the equals sign\n"
+		"=1\n"
+		"[Window\n"               // missing ']', the entries stay in [Graphics]
+		"Width=-1\n"              // invalid unsigned, Width isn't in [Graphics] anyway
+		"[Window]\n"
+		"Width=+1920\n"
+		"DisplayMode=3\n"         // not a listed enum value
+		"DisplayMode=2\n"
+		"[Engine]\n"
+		"LogFile=  Logs/VQE.log  \n";
+
+	INIFile File;
+	File.Parse(INI, "VQETests.ini");
+	TEST_CHECK(File.GetSections().size() == 4);
+	TEST_CHECK(File.GetEntries().size() == 10);
+	if (File.GetSections().size() == 4)
+	{
+		TEST_CHECK(File.GetSections()[0].Name.empty() && File.GetSections()[0].NumEntries == 1);
+		TEST_CHECK(File.GetSections()[1].Name == "Graphics" && File.GetSections()[1].NumEntries == 5);
+		TEST_CHECK(File.GetSections()[2].Name == "Window" && File.GetSections()[2].Line == 13);
+	}
+
+	FTestSettings s;
+	s.RenderScale = 0.75f;
+	uint32 NumErrors = 0;
+	for (const INIFile::FSection& Section : File.GetSections())
+		NumErrors += ApplySettingsSection(File, Section, TEST_SCHEMA, s);
+
+	// the unnamed section doesn't match the [Engine] LogFile, RenderScale, NotASetting, Width in [Graphics], DisplayMode=3
+	TEST_CHECK(NumErrors == 5);
+	TEST_CHECK(s.bVSync && s.MaxFrameRate == 0 && s.RenderScale == 0.75f);
+	TEST_CHECK(s.Width == 1920 && s.DisplayMode == ETestDisplayMode::FULLSCREEN);
+	TEST_CHECK(s.LogFile == "Logs/VQE.log");
+
+	// whole tokens only
+	int i = 0; float f = 0.0f; bool b = false; unsigned u = 0;
+	TEST_CHECK(!ParseSettingValue("1.5", i, nullptr, 0) && !ParseSettingValue("", i, nullptr, 0) && !ParseSettingValue("12a", i, nullptr, 0));
+	TEST_CHECK(!ParseSettingValue("", f, nullptr, 0) && !ParseSettingValue("1.0f", f, nullptr, 0));
+	TEST_CHECK(!ParseSettingValue("2", b, nullptr, 0) && !ParseSettingValue("-1", u, nullptr, 0));
+	TEST_CHECK(ParseSettingValue("-3", i, nullptr, 0) && i == -3 && ParseSettingValue("Off", b, nullptr, 0) && !b);
+}
+
+VQE_TEST(SettingsRegistry_ConsoleVariables)
+{
+	FTestSettings s;
+	int NumChanged = 0;
+
+	ConsoleVariables CVars;
+	CVars.Register("r.RenderScale", &s.RenderScale, "render resolution scale", [&]() { ++NumChanged; });
+	CVars.Register("r.VSync", &s.bVSync, "vertical sync");
+	CVars.Register("r.DisplayMode", &s.DisplayMode, "display mode", [&]() { ++NumChanged; }, DISPLAY_MODE_NAMES);
+	CVars.Register("a.Width", &s.Width, nullptr);
+
+	// sorted by name for the lookups
+	TEST_CHECK(CVars.GetVariables().size() == 4 && CVars.GetVariables().front().Name == "a.Width");
+	TEST_CHECK(CVars.Find("r.VSync") && !CVars.Find("r.vsync") && !CVars.Find("r"));
+
+	TEST_CHECK(CVars.Set("r.RenderScale", " 0.8 "));
+	TEST_CHECK(s.RenderScale == 0.8f && NumChanged == 1);
+	TEST_CHECK(CVars.Execute("r.DisplayMode = borderless"));
+	TEST_CHECK(s.DisplayMode == ETestDisplayMode::BORDERLESS && NumChanged == 2);
+	TEST_CHECK(CVars.Execute("r.VSync on") && s.bVSync);
+	TEST_CHECK(CVars.Execute("a.Width 1280") && s.Width == 1280);
+
+	// invalid values & unknown variables don't change anything
+	TEST_CHECK(!CVars.Set("r.RenderScale", "fast"));
+	TEST_CHECK(!CVars.Set("r.DisplayMode", "7"));
+	TEST_CHECK(!CVars.Execute("r.Unknown 1"));
+	TEST_CHECK(s.RenderScale == 0.8f && s.DisplayMode == ETestDisplayMode::BORDERLESS && NumChanged == 2);
+	TEST_CHECK(CVars.Execute("r.VSync")); // logs the value
+	TEST_CHECK(s.bVSync);
+
+	// the value strings round-trip through Set()
+	s.RenderScale = 1.0f / 3.0f;
+	const ConsoleVariables::FVariable* pRenderScale = CVars.Find("r.RenderScale");
+	TEST_CHECK(pRenderScale != nullptr);
+	if (pRenderScale)
+	{
+		const float RenderScale = s.RenderScale;
+		TEST_CHECK(CVars.Set("r.RenderScale", CVars.GetValueString(*pRenderScale)) && IsBitwiseEqual(s.RenderScale, RenderScale));
+	}
+	TEST_CHECK(CVars.GetValueString(*CVars.Find("r.DisplayMode")) == "Borderless");
+
+	// re-registering replaces the binding
+	float OtherRenderScale = 0.0f;
+	CVars.Register("r.RenderScale", &OtherRenderScale, "render resolution scale");
+	TEST_CHECK(CVars.GetVariables().size() == 4);
+	TEST_CHECK(CVars.Set("r.RenderScale", "2") && OtherRenderScale == 2.0f && NumChanged == 3); // w/o the callback
+}
@@ -0,0 +1,228 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/ShadowCache.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	struct FTestCaster
+	{
+		uint32 CasterID;
+		uint32 MeshID;
+		XMFLOAT3 Position;
+		bool bDeforming = false; // skinned
+	};
+
+	// drives a ShadowCache the way the renderer does for a single frame:
+	// every view updates the casters it sees, then builds its signature
+	class FShadowCacheTestScene
+	{
+	public:
+		std::vector<FTestCaster> Casters;
+		std::vector<std::vector<uint32>> ViewCasters; // indices into Casters, per view
+		std::vector<float> LightPositions;            // per view
+
+		ShadowCache::EViewUpdate UpdateView(ShadowCache& Cache, uint32 iView) const
+		{
+			ShadowCache::FViewSignature Signature;
+			Signature.LightHash = ShadowCache::HashMatrix(XMMatrixTranslation(LightPositions[iView], 100.0f, 0.0f));
+			for (uint32 iCaster : ViewCasters[iView])
+			{
+				const FTestCaster& c = Casters[iCaster];
+				Cache.UpdateCaster(c.CasterID, XMMatrixTranslation(c.Position.x, c.Position.y, c.Position.z));
+				Cache.AddCaster(Signature, c.CasterID, c.MeshID, c.bDeforming);
+			}
+			return Cache.UpdateView(iView, Signature);
+		}
+		std::vector<ShadowCache::EViewUpdate> UpdateFrame(ShadowCache& Cache) const
+		{
+			std::vector<ShadowCache::EViewUpdate> Updates;
+			Cache.BeginFrame();
+			for (uint32 iView = 0; iView < ViewCasters.size(); ++iView)
+				Updates.push_back(UpdateView(Cache, iView));
+			return Updates;
+		}
+	};
+
+	// 2 views sharing casters 4..7
+	FShadowCacheTestScene CreateTestScene()
+	{
+		FShadowCacheTestScene Scene;
+		for (uint32 i = 0; i < 12; ++i)
+			Scene.Casters.push_back({ 100 + i, i % 3, XMFLOAT3(static_cast<float>(i), 0.0f, 0.0f) });
+		Scene.ViewCasters = { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 4, 5, 6, 7, 8, 9, 10, 11 } };
+		Scene.LightPositions = { 0.0f, 50.0f };
+		return Scene;
+	}
+
+	using Updates_t = std::vector<ShadowCache::EViewUpdate>;
+	constexpr ShadowCache::EViewUpdate REUSE   = ShadowCache::REUSE_CACHED;
+	constexpr ShadowCache::EViewUpdate DYNAMIC = ShadowCache::REDRAW_DYNAMIC;
+	constexpr ShadowCache::EViewUpdate ALL     = ShadowCache::REDRAW_ALL;
+}
+
+VQE_TEST(ShadowCache_InvalidationRules)
+{
+	FShadowCacheTestScene Scene = CreateTestScene();
+	ShadowCache Cache;
+	Cache.Initialize(2);
+
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, ALL })); // nothing cached yet
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, REUSE }));
+	TEST_CHECK(Cache.GetStatistics().NumReusedViews == 2 && Cache.GetStatistics().NumTrackedCasters == 12);
+
+	// a static caster starts moving: it leaves the static layer of the views it's in
+	Scene.Casters[1].Position.y += 1.0f;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, REUSE }));
+	Scene.Casters[1].Position.y += 1.0f;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ DYNAMIC, REUSE }));
+
+	// a moving caster shared by both views
+	Scene.Casters[5].Position.y += 1.0f;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, ALL }));
+	Scene.Casters[1].Position.y += 1.0f;
+	Scene.Casters[5].Position.y += 1.0f;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ DYNAMIC, DYNAMIC }));
+
+	// the casters stop: cached until they've been still for STATIC_CASTER_FRAME_THRESHOLD frames, then re-cached as static once
+	bool bStillCached = true;
+	for (uint32 i = 1; i < ShadowCache::STATIC_CASTER_FRAME_THRESHOLD; ++i)
+		bStillCached = bStillCached && Scene.UpdateFrame(Cache) == Updates_t({ REUSE, REUSE });
+	TEST_CHECK(bStillCached);
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, ALL }));
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, REUSE }));
+
+	// light moved
+	Scene.LightPositions[1] += 1.0f;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, ALL }));
+
+	// a static caster leaves / enters a view
+	Scene.ViewCasters[0].pop_back();
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, REUSE }));
+	Scene.ViewCasters[0].push_back(7);
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, REUSE }));
+
+	// the signature doesn't depend on the order of the casters
+	std::reverse(Scene.ViewCasters[1].begin(), Scene.ViewCasters[1].end());
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, REUSE }));
+
+	// a different mesh on the same caster
+	Scene.Casters[9].MeshID += 1;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, ALL }));
+
+	// a new caster appearing mid-scene starts out static
+	Scene.Casters.push_back({ 500, 0, XMFLOAT3(0.0f, 5.0f, 0.0f) });
+	Scene.ViewCasters[1].push_back(static_cast<uint32>(Scene.Casters.size() - 1));
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, ALL }));
+	TEST_CHECK(Cache.GetStatistics().NumTrackedCasters == 13);
+
+	// a deforming caster is dynamic every frame w/o moving, and static again once it stops
+	Scene.Casters[2].bDeforming = true;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, REUSE }));
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ DYNAMIC, REUSE }));
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ DYNAMIC, REUSE }));
+	Scene.Casters[2].bDeforming = false;
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, REUSE }));
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ REUSE, REUSE }));
+
+	// explicit invalidation
+	Cache.Invalidate(0);
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, REUSE }));
+	Cache.InvalidateAll();
+	TEST_CHECK(Scene.UpdateFrame(Cache) == Updates_t({ ALL, ALL }));
+	const ShadowCache::FStatistics Stats = Cache.GetStatistics();
+	TEST_CHECK(Stats.NumViews == 2 && Stats.NumFullRedraws == 2 && Stats.NumReusedViews == 0 && Stats.NumDynamicRedraws == 0);
+	TEST_CHECK(Stats.NumTrackedCasters == 13);
+}
+
+// random caster movement, compared against the rendered content of each view:
+// a reused view must be unchanged and a dynamic redraw must find its cached static layer unchanged
+VQE_TEST(ShadowCache_NeverStale)
+{
+	constexpr uint32 NUM_VIEWS = 4;
+	constexpr uint32 NUM_CASTERS = 64;
+	constexpr uint32 NUM_FRAMES = 2000;
+
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<uint32> fnCaster(0, NUM_CASTERS - 1);
+	std::uniform_int_distribution<uint32> fnEvent(0, 99);
+
+	FShadowCacheTestScene Scene;
+	for (uint32 i = 0; i < NUM_CASTERS; ++i)
+		Scene.Casters.push_back({ i, i % 5, XMFLOAT3(static_cast<float>(i), 0.0f, 0.0f) });
+	Scene.ViewCasters.resize(NUM_VIEWS);
+	for (uint32 i = 0; i < NUM_CASTERS; ++i)
+		Scene.ViewCasters[i % NUM_VIEWS].push_back(i);
+	Scene.LightPositions.assign(NUM_VIEWS, 0.0f);
+
+	using ViewContent_t = std::map<uint32, float>; // caster -> position, the light is stored as caster 0xFFFFFFFF
+	std::vector<ViewContent_t> RenderedViews(NUM_VIEWS);
+	std::vector<ViewContent_t> CachedStaticLayers(NUM_VIEWS);
+
+	ShadowCache Cache;
+	Cache.Initialize(NUM_VIEWS);
+	std::vector<bool> bMoving(NUM_CASTERS, false);
+	uint32 NumStale = 0;
+	uint32 NumUpdates[ShadowCache::NUM_VIEW_UPDATE_TYPES] = {};
+	for (uint32 Frame = 0; Frame < NUM_FRAMES; ++Frame)
+	{
+		// a few casters start or stop moving, the lights move rarely
+		const uint32 Event = fnEvent(rng);
+		if (Event < 4) bMoving[fnCaster(rng)] = true;
+		else if (Event < 24) bMoving[fnCaster(rng)] = false;
+		else if (Event == 24) Scene.LightPositions[fnCaster(rng) % NUM_VIEWS] += 1.0f;
+		for (uint32 i = 0; i < NUM_CASTERS; ++i)
+			Scene.Casters[i].Position.y += bMoving[i] ? 0.5f : 0.0f;
+
+		Cache.BeginFrame();
+		for (uint32 iView = 0; iView < NUM_VIEWS; ++iView)
+		{
+			ViewContent_t Content, StaticLayer;
+			Content[0xFFFFFFFF] = StaticLayer[0xFFFFFFFF] = Scene.LightPositions[iView];
+			for (uint32 iCaster : Scene.ViewCasters[iView])
+			{
+				const FTestCaster& c = Scene.Casters[iCaster];
+				Content[c.CasterID] = c.Position.y;
+				if (Cache.UpdateCaster(c.CasterID, XMMatrixTranslation(c.Position.x, c.Position.y, c.Position.z)))
+					StaticLayer[c.CasterID] = c.Position.y;
+			}
+
+			const ShadowCache::EViewUpdate Update = Scene.UpdateView(Cache, iView);
+			++NumUpdates[Update];
+			if (Update == REUSE && Content != RenderedViews[iView])
+				++NumStale;
+			if (Update == DYNAMIC && StaticLayer != CachedStaticLayers[iView])
+				++NumStale;
+			if (Update == ALL)
+				CachedStaticLayers[iView] = StaticLayer;
+			RenderedViews[iView] = Content;
+		}
+	}
+
+	Test::Report("%u views: %u reused, %u dynamic redraws, %u full redraws, %u stale"
+		, NUM_VIEWS * NUM_FRAMES, NumUpdates[REUSE], NumUpdates[DYNAMIC], NumUpdates[ALL], NumStale);
+	TEST_CHECK(NumStale == 0);
+	TEST_CHECK(NumUpdates[REUSE] > 0 && NumUpdates[DYNAMIC] > 0 && NumUpdates[ALL] > 0);
+}
@@ -0,0 +1,584 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Engine/SkeletalAnimation.h"
+#include "Source/Renderer/Buffer.h"
+
+#include "Libs/VQUtils/Source/Multithreading.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	struct FMatrixD { double m[4][4]; }; // row vectors
+
+	struct FTestVertices
+	{
+		std::vector<FVertexWithNormalAndTangent> Vertices;
+		std::vector<FVertexSkinWeights>          Weights;
+	};
+
+	FMatrixD Multiply(const FMatrixD& a, const FMatrixD& b)
+	{
+		FMatrixD o = {};
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				for (int k = 0; k < 4; ++k)
+					o.m[r][c] += a.m[r][k] * b.m[k][c];
+		return o;
+	}
+
+	FMatrixD ToMatrixD(const XMFLOAT4X4& m)
+	{
+		FMatrixD o;
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				o.m[r][c] = m.m[r][c];
+		return o;
+	}
+
+	// S * R * T
+	FMatrixD CalculateBoneMatrixD(const FBonePose& Bone)
+	{
+		XMFLOAT4 q; XMFLOAT3 t; XMFLOAT3 s;
+		XMStoreFloat4(&q, Bone.Rotation);
+		XMStoreFloat3(&t, Bone.Translation);
+		XMStoreFloat3(&s, Bone.Scale);
+
+		const double Len = std::sqrt(static_cast<double>(q.x) * q.x + static_cast<double>(q.y) * q.y + static_cast<double>(q.z) * q.z + static_cast<double>(q.w) * q.w);
+		const double x = q.x / Len, y = q.y / Len, z = q.z / Len, w = q.w / Len;
+		const FMatrixD o = {{
+			{ (1 - 2 * (y * y + z * z)) * s.x,       2 * (x * y + z * w)  * s.x,       2 * (x * z - y * w)  * s.x, 0 },
+			{       2 * (x * y - z * w)  * s.y, (1 - 2 * (x * x + z * z)) * s.y,       2 * (y * z + x * w)  * s.y, 0 },
+			{       2 * (x * z + y * w)  * s.z,       2 * (y * z - x * w)  * s.z, (1 - 2 * (x * x + y * y)) * s.z, 0 },
+			{ t.x, t.y, t.z, 1 }
+		}};
+		return o;
+	}
+
+	void CalculateSkinningMatricesD(const FSkeleton& Skeleton, const FPose& Pose, std::vector<FMatrixD>& OutPalette)
+	{
+		std::vector<FMatrixD> ModelSpace(Skeleton.GetNumBones());
+		OutPalette.resize(Skeleton.GetNumBones());
+		for (uint32 i = 0; i < Skeleton.GetNumBones(); ++i)
+		{
+			const int32 iParent = Skeleton.ParentIndices[i];
+			const FMatrixD Local = CalculateBoneMatrixD(Pose[i]);
+			ModelSpace[i] = iParent == INVALID_BONE ? Local : Multiply(Local, ModelSpace[iParent]);
+			OutPalette[i] = Multiply(ToMatrixD(Skeleton.InverseBindMatrices[i]), ModelSpace[i]);
+		}
+	}
+
+	XMVECTOR GenerateUnitVector(std::mt19937& rng)
+	{
+		std::normal_distribution<float> fnNormal(0.0f, 1.0f);
+		XMVECTOR v = XMVectorZero();
+		while (XMVectorGetX(XMVector3LengthSq(v)) < 1e-4f)
+			v = XMVectorSet(fnNormal(rng), fnNormal(rng), fnNormal(rng), 0.0f);
+		return XMVector3Normalize(v);
+	}
+
+	// limbs: chains of 3-8 bones branching off a random previous bone
+	FSkeleton GenerateSkeleton(std::mt19937& rng, uint32 NumBones)
+	{
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		FSkeleton s;
+		s.BoneNames.resize(NumBones);
+		s.ParentIndices.resize(NumBones);
+		s.BindPose.resize(NumBones);
+
+		uint32 NumChainBonesLeft = 0;
+		for (uint32 i = 0; i < NumBones; ++i)
+		{
+			int32 iParent = INVALID_BONE;
+			if (i > 0 && NumChainBonesLeft > 0)
+			{
+				iParent = static_cast<int32>(i - 1);
+				--NumChainBonesLeft;
+			}
+			else if (i > 0)
+			{
+				iParent = std::uniform_int_distribution<int32>(0, static_cast<int32>(i - 1))(rng);
+				NumChainBonesLeft = std::uniform_int_distribution<uint32>(2, 7)(rng);
+			}
+
+			const float Scale = fnUnit(rng) < 0.1f ? 0.9f + 0.2f * fnUnit(rng) : 1.0f;
+			s.BoneNames[i]     = "Bone" + std::to_string(i);
+			s.ParentIndices[i] = iParent;
+			s.BindPose[i].Rotation    = XMQuaternionRotationNormal(GenerateUnitVector(rng), fnUnit(rng) - 0.5f);
+			s.BindPose[i].Translation = i == 0 ? XMVectorZero() : XMVectorScale(GenerateUnitVector(rng), 0.1f + 0.3f * fnUnit(rng));
+			s.BindPose[i].Scale       = XMVectorSet(Scale, Scale, Scale, 0.0f);
+		}
+
+		std::vector<XMMATRIX> ModelSpace;
+		SkeletalAnimation::CalculateModelSpaceMatrices(s, s.BindPose, ModelSpace);
+		s.InverseBindMatrices.resize(NumBones);
+		for (uint32 i = 0; i < NumBones; ++i)
+			XMStoreFloat4x4(&s.InverseBindMatrices[i], XMMatrixInverse(nullptr, ModelSpace[i]));
+		return s;
+	}
+
+	// oscillating channels, single key & empty channels
+	FRawAnimationClip GenerateRawClip(std::mt19937& rng, const FSkeleton& Skeleton, uint32 iClip)
+	{
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		FRawAnimationClip c;
+		c.Name = "Clip" + std::to_string(iClip);
+		c.Duration = 1.0f + 4.0f * fnUnit(rng);
+		c.Tracks.resize(Skeleton.GetNumBones());
+
+		// keys at the frame rate of the exported clip, some of them removed by the exporter's key reduction
+		const float KeyRates[] = { 24.0f, 30.0f, 60.0f };
+		const float KeyRate = KeyRates[std::uniform_int_distribution<size_t>(0, 2)(rng)];
+		auto fnKeyTimes = [&]()
+		{
+			std::vector<float> Times(1, 0.0f);
+			for (uint32 iKey = 1; iKey / KeyRate < c.Duration; ++iKey)
+				if (fnUnit(rng) < 0.7f)
+					Times.push_back(iKey / KeyRate);
+			Times.push_back(c.Duration);
+			return Times;
+		};
+		auto fnWave = [&]()
+		{
+			const float Frequency = 0.2f + 1.0f * fnUnit(rng);
+			const float Phase = XM_2PI * fnUnit(rng);
+			return [=](float Time) { return std::sin(XM_2PI * Frequency * Time + Phase); };
+		};
+
+		for (uint32 iBone = 0; iBone < Skeleton.GetNumBones(); ++iBone)
+		{
+			const FBonePose& Bind = Skeleton.BindPose[iBone];
+			FRawAnimationClip::FBoneTrack& Track = c.Tracks[iBone];
+
+			const float r = fnUnit(rng);
+			if (r < 0.7f)
+			{
+				const XMVECTOR vAxis = GenerateUnitVector(rng);
+				const float Amplitude = 0.05f + 0.55f * fnUnit(rng);
+				const auto fnAngle = fnWave();
+				for (float Time : fnKeyTimes())
+				{
+					FRawAnimationClip::FQuaternionKey Key = { Time, {} };
+					XMStoreFloat4(&Key.Value, XMQuaternionMultiply(Bind.Rotation, XMQuaternionRotationNormal(vAxis, Amplitude * fnAngle(Time))));
+					Track.Rotations.push_back(Key);
+				}
+			}
+			else if (r < 0.8f)
+			{
+				FRawAnimationClip::FQuaternionKey Key = { 0.0f, {} };
+				XMStoreFloat4(&Key.Value, XMQuaternionRotationNormal(GenerateUnitVector(rng), XM_PI * fnUnit(rng)));
+				Track.Rotations.push_back(Key);
+			}
+
+			// the root walks & bobs, a few other bones stretch
+			if (iBone == 0 || fnUnit(rng) < 0.15f)
+			{
+				const XMVECTOR vAxis = GenerateUnitVector(rng);
+				const auto fnOffset = fnWave();
+				for (float Time : fnKeyTimes())
+				{
+					const XMVECTOR vOffset = iBone == 0
+						? XMVectorSet(1.5f * Time, 0.05f * fnOffset(Time), 0.0f, 0.0f)
+						: XMVectorScale(vAxis, 0.05f * fnOffset(Time));
+					FRawAnimationClip::FVectorKey Key = { Time, {} };
+					XMStoreFloat3(&Key.Value, XMVectorAdd(Bind.Translation, vOffset));
+					Track.Translations.push_back(Key);
+				}
+			}
+
+			if (fnUnit(rng) < 0.1f)
+			{
+				const auto fnScale = fnWave();
+				for (float Time : fnKeyTimes())
+				{
+					FRawAnimationClip::FVectorKey Key = { Time, {} };
+					XMStoreFloat3(&Key.Value, XMVectorScale(Bind.Scale, 1.0f + 0.2f * fnScale(Time)));
+					Track.Scales.push_back(Key);
+				}
+			}
+		}
+		return c;
+	}
+
+	// vertices around the bones in the bind pose, w/ 1-4 influences
+	FTestVertices GenerateTestVertices(std::mt19937& rng, const FSkeleton& Skeleton, uint32 NumVerticesPerBone)
+	{
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		std::vector<XMMATRIX> ModelSpace;
+		SkeletalAnimation::CalculateModelSpaceMatrices(Skeleton, Skeleton.BindPose, ModelSpace);
+
+		const uint32 NumBones = Skeleton.GetNumBones();
+		FTestVertices t;
+		for (uint32 iBone = 0; iBone < NumBones; ++iBone)
+		{
+			for (uint32 i = 0; i < NumVerticesPerBone; ++i)
+			{
+				FVertexWithNormalAndTangent v = {};
+				const XMVECTOR vNormal = GenerateUnitVector(rng);
+				const XMVECTOR vTangent = XMVector3Normalize(XMVector3Cross(vNormal, GenerateUnitVector(rng)));
+				XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(v.position), XMVectorAdd(ModelSpace[iBone].r[3], XMVectorScale(GenerateUnitVector(rng), 0.1f * fnUnit(rng))));
+				XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(v.normal), vNormal);
+				XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(v.tangent), vTangent);
+				v.uv[0] = fnUnit(rng);
+				v.uv[1] = fnUnit(rng);
+
+				FVertexSkinWeights w = {};
+				const uint32 NumInfluences = std::uniform_int_distribution<uint32>(1, MAX_BONE_INFLUENCES)(rng);
+				float WeightSum = 0.0f;
+				for (uint32 k = 0; k < NumInfluences; ++k)
+				{
+					const int32 iParent = Skeleton.ParentIndices[iBone];
+					w.BoneIndices[k] = static_cast<uint16>(k == 0 ? iBone
+						: k == 1 && iParent != INVALID_BONE ? static_cast<uint32>(iParent)
+						: std::uniform_int_distribution<uint32>(0, NumBones - 1)(rng));
+					w.Weights[k] = 0.1f + fnUnit(rng);
+					WeightSum += w.Weights[k];
+				}
+				for (uint32 k = 0; k < NumInfluences; ++k)
+					w.Weights[k] /= WeightSum;
+
+				t.Vertices.push_back(v);
+				t.Weights.push_back(w);
+			}
+		}
+		return t;
+	}
+
+	// max model space distance between the virtual vertices of the bones: their origin & points along their axes
+	float CalculatePoseError(const FSkeleton& Skeleton, const FPose& PoseA, const FPose& PoseB, float VirtualVertexDistance)
+	{
+		std::vector<XMMATRIX> ModelSpaceA, ModelSpaceB;
+		SkeletalAnimation::CalculateModelSpaceMatrices(Skeleton, PoseA, ModelSpaceA);
+		SkeletalAnimation::CalculateModelSpaceMatrices(Skeleton, PoseB, ModelSpaceB);
+
+		const XMVECTOR VirtualVertices[] =
+		{
+			XMVectorZero(),
+			XMVectorSet(VirtualVertexDistance, 0.0f, 0.0f, 0.0f),
+			XMVectorSet(0.0f, VirtualVertexDistance, 0.0f, 0.0f),
+			XMVectorSet(0.0f, 0.0f, VirtualVertexDistance, 0.0f),
+		};
+		float MaxError = 0.0f;
+		for (size_t i = 0; i < ModelSpaceA.size(); ++i)
+			for (const XMVECTOR& v : VirtualVertices)
+				MaxError = std::max(MaxError, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMVector3Transform(v, ModelSpaceA[i]), XMVector3Transform(v, ModelSpaceB[i])))));
+		return MaxError;
+	}
+
+	// a skeleton w/ its clips, raw & compressed
+	struct FTestRig
+	{
+		FSkeleton                            Skeleton;
+		std::vector<FRawAnimationClip>       RawClips;
+		std::vector<FAnimationClip>          Clips;
+		AnimationClipCompressor::FStatistics Compression;
+	};
+
+	constexpr uint32 RIG_BONE_COUNTS[] = { 24, 64, 160 };
+	constexpr uint32 NUM_CLIPS_PER_RIG = 4;
+	constexpr uint32 NUM_TEST_POSES = 32;
+	constexpr float  VIRTUAL_VERTEX_DISTANCE = 0.1f; // the pose errors are measured on the bones & this far from them
+	constexpr float  FRAME_ERROR_TOLERANCE = 1e-3f;  // at the resampled frames: quantization only
+	constexpr float  BLEND_ERROR_TOLERANCE = 1e-4f;
+
+	FTestRig GenerateTestRig(std::mt19937& rng, uint32 NumBones)
+	{
+		const AnimationClipCompressor::FSettings CompressionSettings;
+		FTestRig Rig;
+		Rig.Skeleton = GenerateSkeleton(rng, NumBones);
+		for (uint32 iClip = 0; iClip < NUM_CLIPS_PER_RIG; ++iClip)
+		{
+			AnimationClipCompressor::FStatistics s;
+			Rig.RawClips.push_back(GenerateRawClip(rng, Rig.Skeleton, iClip));
+			Rig.Clips.push_back(AnimationClipCompressor::Compress(Rig.Skeleton, Rig.RawClips.back(), CompressionSettings, &s));
+			Rig.Compression.NumFrames           += s.NumFrames;
+			Rig.Compression.NumTracks           += s.NumTracks;
+			Rig.Compression.NumConstantChannels += s.NumConstantChannels;
+			Rig.Compression.RawBytes            += s.RawBytes;
+			Rig.Compression.CompressedBytes     += s.CompressedBytes;
+			Rig.Compression.CompressionTimeMs   += s.CompressionTimeMs;
+		}
+		return Rig;
+	}
+
+	// random clips & times, half of them blended, the first one is in the bind pose
+	std::vector<SkeletalAnimation::FAnimationInstance> GenerateInstances(std::mt19937& rng, const FTestRig& Rig, uint32 NumInstances)
+	{
+		std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+		std::vector<SkeletalAnimation::FAnimationInstance> Instances(NumInstances);
+		for (size_t i = 0; i < Instances.size(); ++i)
+		{
+			SkeletalAnimation::FAnimationInstance& Instance = Instances[i];
+			Instance.pClip = i == 0 ? nullptr : &Rig.Clips[i % NUM_CLIPS_PER_RIG];
+			Instance.Time = 10.0f * fnUnit(rng);
+			if (i > 0 && fnUnit(rng) < 0.5f)
+			{
+				Instance.pBlendClip = &Rig.Clips[(i + 1) % NUM_CLIPS_PER_RIG];
+				Instance.BlendTime = 10.0f * fnUnit(rng);
+				Instance.BlendWeight = fnUnit(rng);
+			}
+		}
+		return Instances;
+	}
+
+	template<class TFn> float MeasureMedianMs(uint32 NumIterations, TFn&& fn)
+	{
+		std::vector<float> TimingsMs(NumIterations);
+		for (float& ms : TimingsMs)
+		{
+			const auto Start = std::chrono::steady_clock::now();
+			fn();
+			ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		}
+		std::sort(TimingsMs.begin(), TimingsMs.end());
+		return TimingsMs[NumIterations / 2];
+	}
+}
+
+// the compression error against the raw keys: quantization at the frames, + resampling between them,
+// & the channels w/ less than 2 keys are stored as constants
+VQE_TEST(SkeletalAnimation_Compression)
+{
+	std::mt19937 rng(1234);
+	FPose Pose, RawPose;
+	for (uint32 NumBones : RIG_BONE_COUNTS)
+	{
+		const FTestRig Rig = GenerateTestRig(rng, NumBones);
+		TEST_CHECK(Rig.Skeleton.IsValid());
+
+		float MaxFrameError = 0.0f;
+		float MaxResamplingError = 0.0f;
+		uint32 NumTrackErrors = 0;
+		for (uint32 iClip = 0; iClip < NUM_CLIPS_PER_RIG; ++iClip)
+		{
+			const FAnimationClip& Clip = Rig.Clips[iClip];
+			for (uint32 iFrame = 0; iFrame < Clip.NumFrames; ++iFrame)
+			{
+				const float Time = iFrame == Clip.NumFrames - 1 ? Clip.Duration : iFrame / Clip.SampleRate;
+				SkeletalAnimation::SamplePose(Clip, Time, false, Pose);
+				SkeletalAnimation::SampleRawPose(Rig.Skeleton, Rig.RawClips[iClip], Time, false, RawPose);
+				MaxFrameError = std::max(MaxFrameError, CalculatePoseError(Rig.Skeleton, Pose, RawPose, VIRTUAL_VERTEX_DISTANCE));
+
+				if (iFrame + 1 < Clip.NumFrames)
+				{
+					const float MidTime = (iFrame + 0.5f) / Clip.SampleRate;
+					SkeletalAnimation::SamplePose(Clip, MidTime, false, Pose);
+					SkeletalAnimation::SampleRawPose(Rig.Skeleton, Rig.RawClips[iClip], MidTime, false, RawPose);
+					MaxResamplingError = std::max(MaxResamplingError, CalculatePoseError(Rig.Skeleton, Pose, RawPose, VIRTUAL_VERTEX_DISTANCE));
+				}
+			}
+
+			for (uint32 iBone = 0; iBone < NumBones; ++iBone)
+			{
+				const FRawAnimationClip::FBoneTrack& Track = Rig.RawClips[iClip].Tracks[iBone];
+				const bool bRotationTrack    = std::binary_search(Clip.RotationTracks.begin()   , Clip.RotationTracks.end()   , static_cast<uint16>(iBone));
+				const bool bTranslationTrack = std::binary_search(Clip.TranslationTracks.begin(), Clip.TranslationTracks.end(), static_cast<uint16>(iBone));
+				const bool bScaleTrack       = std::binary_search(Clip.ScaleTracks.begin()      , Clip.ScaleTracks.end()      , static_cast<uint16>(iBone));
+				NumTrackErrors += bRotationTrack    != (Track.Rotations.size() > 1)    ? 1 : 0;
+				NumTrackErrors += bTranslationTrack != (Track.Translations.size() > 1) ? 1 : 0;
+				NumTrackErrors += bScaleTrack       != (Track.Scales.size() > 1)       ? 1 : 0;
+			}
+		}
+
+		const AnimationClipCompressor::FStatistics& c = Rig.Compression;
+		Test::Report("%3u bones: %u frames, %u tracks + %u constant channels, %.1f KB keys -> %.1f KB, error %.6f at the frames, %.6f between them"
+			, NumBones, c.NumFrames, c.NumTracks, c.NumConstantChannels, c.RawBytes / 1024.0, c.CompressedBytes / 1024.0, MaxFrameError, MaxResamplingError);
+		TEST_CHECK(MaxFrameError <= FRAME_ERROR_TOLERANCE);
+		TEST_CHECK(NumTrackErrors == 0);
+	}
+}
+
+VQE_TEST(SkeletalAnimation_LoopingAndBlending)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> fnUnit(0.0f, 1.0f);
+	FPose Pose, PoseA, PoseB, Blended;
+	for (uint32 NumBones : RIG_BONE_COUNTS)
+	{
+		const FTestRig Rig = GenerateTestRig(rng, NumBones);
+		uint32 NumLoopErrors = 0;
+		uint32 NumBlendErrors = 0;
+		for (uint32 i = 0; i < NUM_TEST_POSES; ++i)
+		{
+			const FAnimationClip& ClipA = Rig.Clips[i % NUM_CLIPS_PER_RIG];
+			const FAnimationClip& ClipB = Rig.Clips[(i + 1) % NUM_CLIPS_PER_RIG];
+			const float Time = ClipA.Duration * fnUnit(rng);
+			SkeletalAnimation::SamplePose(ClipA, Time, true, PoseA);
+			SkeletalAnimation::SamplePose(ClipA, Time + 2.0f * ClipA.Duration, true, Pose);
+			NumLoopErrors += CalculatePoseError(Rig.Skeleton, PoseA, Pose, VIRTUAL_VERTEX_DISTANCE) > FRAME_ERROR_TOLERANCE ? 1 : 0;
+
+			SkeletalAnimation::SamplePose(ClipB, ClipB.Duration * fnUnit(rng), true, PoseB);
+			SkeletalAnimation::BlendPoses(PoseA, PoseB, 0.0f, Blended);
+			NumBlendErrors += CalculatePoseError(Rig.Skeleton, PoseA, Blended, VIRTUAL_VERTEX_DISTANCE) > BLEND_ERROR_TOLERANCE ? 1 : 0;
+			SkeletalAnimation::BlendPoses(PoseA, PoseB, 1.0f, Blended);
+			NumBlendErrors += CalculatePoseError(Rig.Skeleton, PoseB, Blended, VIRTUAL_VERTEX_DISTANCE) > BLEND_ERROR_TOLERANCE ? 1 : 0;
+
+			// q & -q are the same rotation: the blend has to take the shortest path either way
+			SkeletalAnimation::BlendPoses(PoseA, PoseB, 0.5f, Blended);
+			for (FBonePose& Bone : PoseB)
+				Bone.Rotation = XMVectorNegate(Bone.Rotation);
+			SkeletalAnimation::BlendPoses(PoseA, PoseB, 0.5f, Pose);
+			NumBlendErrors += CalculatePoseError(Rig.Skeleton, Blended, Pose, VIRTUAL_VERTEX_DISTANCE) > BLEND_ERROR_TOLERANCE ? 1 : 0;
+		}
+		TEST_CHECK(NumLoopErrors == 0);
+		TEST_CHECK(NumBlendErrors == 0);
+	}
+}
+
+// palettes & CPU skinning against the double precision references, the bind pose palette is the identity.
+// The palettes don't depend on the number of threads evaluating them.
+VQE_TEST(SkeletalAnimation_PalettesAndSkinning)
+{
+	constexpr double PALETTE_TOLERANCE = 1e-3;
+	constexpr double SKINNING_TOLERANCE = 1e-3;
+
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "AnimationTestWorkers");
+
+	std::mt19937 rng(1234);
+	FPose Pose, PoseB;
+	std::vector<FMatrixD> PaletteD;
+	for (uint32 NumBones : RIG_BONE_COUNTS)
+	{
+		const FTestRig Rig = GenerateTestRig(rng, NumBones);
+		const std::vector<SkeletalAnimation::FAnimationInstance> Instances = GenerateInstances(rng, Rig, 256);
+		std::vector<XMFLOAT4X4> Palettes(Instances.size() * NumBones);
+		std::vector<XMFLOAT4X4> ParallelPalettes(Instances.size() * NumBones);
+		SkeletalAnimation::EvaluateInstances(Rig.Skeleton, Instances.data(), static_cast<uint32>(Instances.size()), Palettes.data());
+		SkeletalAnimation::EvaluateInstances(Rig.Skeleton, Instances.data(), static_cast<uint32>(Instances.size()), ParallelPalettes.data(), &Workers);
+		TEST_CHECK(std::memcmp(Palettes.data(), ParallelPalettes.data(), Palettes.size() * sizeof(XMFLOAT4X4)) == 0);
+
+		const FTestVertices Test = GenerateTestVertices(rng, Rig.Skeleton, 4);
+		std::vector<FVertexWithNormalAndTangent> Skinned(Test.Vertices.size());
+		double MaxPaletteError = 0.0;
+		double MaxSkinningError = 0.0;
+		for (uint32 i = 0; i < NUM_TEST_POSES; ++i)
+		{
+			const SkeletalAnimation::FAnimationInstance& Instance = Instances[i];
+			if (Instance.pClip)
+				SkeletalAnimation::SamplePose(*Instance.pClip, Instance.Time, Instance.bLoop, Pose);
+			else
+				Pose = Rig.Skeleton.BindPose;
+			if (Instance.pBlendClip && Instance.BlendWeight > 0.0f)
+			{
+				SkeletalAnimation::SamplePose(*Instance.pBlendClip, Instance.BlendTime, Instance.bLoop, PoseB);
+				SkeletalAnimation::BlendPoses(Pose, PoseB, Instance.BlendWeight, Pose);
+			}
+			CalculateSkinningMatricesD(Rig.Skeleton, Pose, PaletteD);
+
+			const XMFLOAT4X4* pPalette = &Palettes[i * NumBones];
+			for (uint32 iBone = 0; iBone < NumBones; ++iBone)
+				for (int r = 0; r < 4; ++r)
+					for (int c = 0; c < 4; ++c)
+					{
+						const double Expected = i == 0 ? (r == c ? 1.0 : 0.0) : PaletteD[iBone].m[r][c];
+						MaxPaletteError = std::max(MaxPaletteError, std::abs(pPalette[iBone].m[r][c] - Expected));
+					}
+
+			SkeletalAnimation::SkinVertices(Test.Vertices.data(), Test.Weights.data(), static_cast<uint32>(Test.Vertices.size()), pPalette, Skinned.data());
+			for (size_t v = 0; v < Test.Vertices.size(); ++v)
+			{
+				double Position[3] = {};
+				double Normal[3] = {};
+				for (uint32 k = 0; k < MAX_BONE_INFLUENCES; ++k)
+				{
+					const FMatrixD& m = PaletteD[Test.Weights[v].BoneIndices[k]];
+					const double w = Test.Weights[v].Weights[k];
+					const float* p = Test.Vertices[v].position;
+					const float* n = Test.Vertices[v].normal;
+					for (int c = 0; c < 3; ++c)
+					{
+						Position[c] += w * (p[0] * m.m[0][c] + p[1] * m.m[1][c] + p[2] * m.m[2][c] + m.m[3][c]);
+						Normal[c]   += w * (n[0] * m.m[0][c] + n[1] * m.m[1][c] + n[2] * m.m[2][c]);
+					}
+				}
+				const double NormalLength = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+				for (int c = 0; c < 3; ++c)
+				{
+					MaxSkinningError = std::max(MaxSkinningError, std::abs(Skinned[v].position[c] - Position[c]));
+					MaxSkinningError = std::max(MaxSkinningError, std::abs(Skinned[v].normal[c] - Normal[c] / NormalLength));
+				}
+			}
+		}
+		Test::Report("%3u bones: palette error %.6f, skinning error %.6f", NumBones, MaxPaletteError, MaxSkinningError);
+		TEST_CHECK(MaxPaletteError <= PALETTE_TOLERANCE);
+		TEST_CHECK(MaxSkinningError <= SKINNING_TOLERANCE);
+	}
+	Workers.Destroy();
+}
+
+// Sampling throughput of the compressed clips vs the raw keys, & the evaluation throughput (sample, blend & palettes)
+// of 1000 instances per rig on this thread & w/ the workers.
+VQE_BENCHMARK(SkeletalAnimation_Evaluation)
+{
+	constexpr uint32 NUM_INSTANCES = 1000;
+	constexpr uint32 NUM_ITERATIONS = 20;
+
+	ThreadPool Workers;
+	Workers.Initialize(ThreadPool::sHardwareThreadCount, "AnimationBenchmarkWorkers");
+	const uint32 NumWorkers = static_cast<uint32>(Workers.GetThreadPoolSize());
+
+	std::mt19937 rng(1234);
+	FPose Pose, RawPose;
+	for (uint32 NumBones : RIG_BONE_COUNTS)
+	{
+		const FTestRig Rig = GenerateTestRig(rng, NumBones);
+		const std::vector<SkeletalAnimation::FAnimationInstance> Instances = GenerateInstances(rng, Rig, NUM_INSTANCES);
+		std::vector<XMFLOAT4X4> Palettes(Instances.size() * NumBones);
+
+		auto fnSampleInstances = [&]()
+		{
+			for (const SkeletalAnimation::FAnimationInstance& Instance : Instances)
+				SkeletalAnimation::SamplePose(*(Instance.pClip ? Instance.pClip : &Rig.Clips[0]), Instance.Time, true, Pose);
+		};
+		auto fnSampleInstancesRaw = [&]()
+		{
+			for (const SkeletalAnimation::FAnimationInstance& Instance : Instances)
+				SkeletalAnimation::SampleRawPose(Rig.Skeleton, Rig.RawClips[Instance.pClip ? Instance.pClip - Rig.Clips.data() : 0], Instance.Time, true, RawPose);
+		};
+		auto fnEvaluate = [&](ThreadPool* pWorkers)
+		{
+			SkeletalAnimation::EvaluateInstances(Rig.Skeleton, Instances.data(), static_cast<uint32>(Instances.size()), Palettes.data(), pWorkers);
+		};
+		const float SamplingMs    = MeasureMedianMs(NUM_ITERATIONS, fnSampleInstances);
+		const float RawSamplingMs = MeasureMedianMs(NUM_ITERATIONS, fnSampleInstancesRaw);
+		const float SerialMs      = MeasureMedianMs(NUM_ITERATIONS, [&]() { fnEvaluate(nullptr); });
+		const float ParallelMs    = MeasureMedianMs(NUM_ITERATIONS, [&]() { fnEvaluate(&Workers); });
+
+		const double NumEvaluatedBones = static_cast<double>(Instances.size()) * NumBones;
+		auto fnMBonesPerSecond = [&](float ms) { return ms > 0.0f ? NumEvaluatedBones / (ms * 1000.0) : 0.0; };
+		const AnimationClipCompressor::FStatistics& c = Rig.Compression;
+		Test::Report("%3u bones: %.1f KB keys -> %.1f KB (%.2fx) in %.2fms", NumBones, c.RawBytes / 1024.0, c.CompressedBytes / 1024.0
+			, c.CompressedBytes > 0 ? static_cast<double>(c.RawBytes) / c.CompressedBytes : 1.0, c.CompressionTimeMs);
+		Test::Report("           sampling: %.1f Mbones/s compressed, %.1f Mbones/s raw keys", fnMBonesPerSecond(SamplingMs), fnMBonesPerSecond(RawSamplingMs));
+		Test::Report("           evaluation: %.3fms serial (%.1f Mbones/s), %.3fms w/ %u workers (%.1f Mbones/s), median of %u"
+			, SerialMs, fnMBonesPerSecond(SerialMs), ParallelMs, NumWorkers + 1, fnMBonesPerSecond(ParallelMs), NUM_ITERATIONS);
+
+		TEST_CHECK(c.CompressedBytes < c.RawBytes);
+		TEST_CHECK(SamplingMs <= RawSamplingMs);
+	}
+	Workers.Destroy();
+}
@@ -0,0 +1,210 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Renderer/TLSFAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace
+{
+	// reference model: one bit per granularity unit
+	struct FUnitModel
+	{
+		std::vector<uint8> bUsed;
+
+		bool IsRangeFree(uint32 Offset, uint32 Count) const
+		{
+			for (uint32 i = Offset; i < Offset + Count; ++i)
+				if (bUsed[i])
+					return false;
+			return true;
+		}
+		void SetRange(uint32 Offset, uint32 Count, bool bValue)
+		{
+			for (uint32 i = Offset; i < Offset + Count; ++i)
+				bUsed[i] = bValue ? 1 : 0;
+		}
+		void GetFreeRuns(uint32& OutNumRuns, uint32& OutLargestRun) const
+		{
+			OutNumRuns = 0;
+			OutLargestRun = 0;
+			uint32 Run = 0;
+			for (size_t i = 0; i <= bUsed.size(); ++i)
+			{
+				if (i < bUsed.size() && !bUsed[i])
+				{
+					++Run;
+					continue;
+				}
+				OutNumRuns += Run > 0 ? 1 : 0;
+				OutLargestRun = std::max(OutLargestRun, Run);
+				Run = 0;
+			}
+		}
+	};
+
+	struct FAllocation
+	{
+		uint32 Offset;
+		uint32 NumUnits;
+	};
+}
+
+// random allocations & frees checked against the unit model after every operation: aligned & non-overlapping
+// allocations, merged free neighbors & the statistics. TLSF is a good-fit allocator: a request can fail while
+// a free block in the same second level bin would fit, but never when a block one bin above the request fits.
+VQE_TEST(TLSFAllocator_Fuzz)
+{
+	constexpr uint32 GRANULARITY = 256;
+	constexpr uint32 NUM_UNITS   = 4096;
+	constexpr int    NUM_OPERATIONS = 10000;
+
+	TLSFAllocator Allocator;
+	Allocator.Initialize(NUM_UNITS * GRANULARITY + GRANULARITY / 2, GRANULARITY); // the partial unit is dropped
+	TEST_CHECK(Allocator.GetTotalSize() == NUM_UNITS * GRANULARITY);
+
+	FUnitModel Model;
+	Model.bUsed.resize(NUM_UNITS, 0);
+	std::vector<FAllocation> Allocations;
+
+	std::mt19937 rng(27);
+	std::uniform_int_distribution<int>    fnOperation(0, 99);
+	std::uniform_int_distribution<uint32> fnVertexBufferSize(1, 64 * GRANULARITY);
+	std::uniform_int_distribution<uint32> fnIndexBufferSize(1, 4 * GRANULARITY);
+
+	int NumFailedChecks = 0;
+	int NumAllocations = 0, NumFailedAllocations = 0, NumFrees = 0;
+	auto fnCheck = [&](bool bCondition) { NumFailedChecks += bCondition ? 0 : 1; };
+	for (int iOperation = 0; iOperation < NUM_OPERATIONS && NumFailedChecks == 0; ++iOperation)
+	{
+		const int Operation = fnOperation(rng);
+		if (Operation < 55 || Allocations.empty())
+		{
+			const uint32 Size = (Operation % 2) ? fnVertexBufferSize(rng) : fnIndexBufferSize(rng);
+			const uint32 NumUnits = (Size + GRANULARITY - 1) / GRANULARITY;
+			uint32 NumFreeRuns, LargestFreeRun;
+			Model.GetFreeRuns(NumFreeRuns, LargestFreeRun);
+
+			const uint32 Offset = Allocator.Allocate(Size);
+			if (Offset == TLSFAllocator::INVALID_OFFSET)
+			{
+				fnCheck(LargestFreeRun < NumUnits + std::max(NumUnits / 8, 1u)); // no block in the bins above
+				++NumFailedAllocations;
+			}
+			else
+			{
+				fnCheck(Offset % GRANULARITY == 0);
+				const uint32 Unit = Offset / GRANULARITY;
+				fnCheck(Unit + NumUnits <= NUM_UNITS && Model.IsRangeFree(Unit, NumUnits));
+				Model.SetRange(Unit, NumUnits, true);
+				Allocations.push_back({ Unit, NumUnits });
+				++NumAllocations;
+			}
+		}
+		else
+		{
+			const size_t i = std::uniform_int_distribution<size_t>(0, Allocations.size() - 1)(rng);
+			const FAllocation a = Allocations[i];
+			Allocations[i] = Allocations.back();
+			Allocations.pop_back();
+			Allocator.Free(a.Offset * GRANULARITY);
+			Model.SetRange(a.Offset, a.NumUnits, false);
+			++NumFrees;
+		}
+
+		const TLSFAllocator::FStatistics s = Allocator.GetStatistics();
+		uint32 NumFreeRuns, LargestFreeRun;
+		Model.GetFreeRuns(NumFreeRuns, LargestFreeRun);
+		const uint32 UsedUnits = static_cast<uint32>(std::count(Model.bUsed.begin(), Model.bUsed.end(), uint8(1)));
+		fnCheck(s.UsedSize == UsedUnits * GRANULARITY);
+		fnCheck(s.UsedSize + s.FreeSize == s.TotalSize);
+		fnCheck(s.NumAllocations == Allocations.size());
+		fnCheck(s.NumFreeBlocks == NumFreeRuns);
+		fnCheck(s.LargestFreeBlock == LargestFreeRun * GRANULARITY);
+	}
+	Test::Report("%d allocations (%d failed), %d frees", NumAllocations, NumFailedAllocations, NumFrees);
+	TEST_CHECK(NumFailedChecks == 0);
+	TEST_CHECK(NumFailedAllocations > 0); // the page got full at some point
+
+	// a scene unload frees everything: a single free block
+	for (const FAllocation& a : Allocations)
+		Allocator.Free(a.Offset * GRANULARITY);
+	const TLSFAllocator::FStatistics s = Allocator.GetStatistics();
+	TEST_CHECK(Allocator.IsEmpty());
+	TEST_CHECK(s.UsedSize == 0 && s.NumFreeBlocks == 1 && s.LargestFreeBlock == s.TotalSize);
+	TEST_CHECK(s.Fragmentation == 0.0f);
+}
+
+// freed blocks merge w/ both physical neighbors, the fragmentation follows
+VQE_TEST(TLSFAllocator_Coalescing)
+{
+	TLSFAllocator Allocator;
+	Allocator.Initialize(4096, 256);
+	uint32 Offsets[16];
+	for (uint32& Offset : Offsets)
+		Offset = Allocator.Allocate(200);
+	TEST_CHECK(Offsets[0] == 0 && Offsets[15] == 15 * 256);
+	TEST_CHECK(Allocator.Allocate(1) == TLSFAllocator::INVALID_OFFSET);
+
+	for (int i = 0; i < 16; i += 2)
+		Allocator.Free(Offsets[i]);
+	TLSFAllocator::FStatistics s = Allocator.GetStatistics();
+	TEST_CHECK(s.NumFreeBlocks == 8 && s.LargestFreeBlock == 256);
+	TEST_CHECK(s.Fragmentation > 0.8f);
+	TEST_CHECK(Allocator.Allocate(512) == TLSFAllocator::INVALID_OFFSET);
+
+	Allocator.Free(Offsets[1]); // merges [0, 3)
+	s = Allocator.GetStatistics();
+	TEST_CHECK(s.NumFreeBlocks == 7 && s.LargestFreeBlock == 3 * 256);
+	TEST_CHECK(Allocator.Allocate(512) == 0);
+}
+
+// cost of an allocate/free pair on a fragmented page
+VQE_BENCHMARK(TLSFAllocator_AllocateFreeCost)
+{
+	constexpr uint32 GRANULARITY = 256;
+	constexpr uint32 PAGE_SIZE = 256u << 20;
+	constexpr int    NUM_LIVE_ALLOCATIONS = 16384;
+	constexpr int    NUM_OPERATIONS = 1000000;
+
+	TLSFAllocator Allocator;
+	Allocator.Initialize(PAGE_SIZE, GRANULARITY);
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<uint32> fnSize(GRANULARITY, 16 * 1024);
+	std::vector<uint32> Offsets;
+	for (int i = 0; i < NUM_LIVE_ALLOCATIONS; ++i)
+		Offsets.push_back(Allocator.Allocate(fnSize(rng)));
+
+	const auto Start = std::chrono::steady_clock::now();
+	int NumFailedAllocations = 0;
+	for (int i = 0; i < NUM_OPERATIONS; ++i)
+	{
+		uint32& Offset = Offsets[rng() % NUM_LIVE_ALLOCATIONS];
+		Allocator.Free(Offset);
+		Offset = Allocator.Allocate(fnSize(rng));
+		NumFailedAllocations += Offset == TLSFAllocator::INVALID_OFFSET ? 1 : 0;
+	}
+	const double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	const TLSFAllocator::FStatistics s = Allocator.GetStatistics();
+	Test::Report("%d free+allocate pairs w/ %d live allocations in %.2fms (%.1f ns per pair), fragmentation %.3f"
+		, NUM_OPERATIONS, NUM_LIVE_ALLOCATIONS, ElapsedMs, ElapsedMs * 1e6 / NUM_OPERATIONS, s.Fragmentation);
+	TEST_CHECK(NumFailedAllocations == 0);
+}
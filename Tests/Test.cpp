@@ -0,0 +1,147 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+
+#ifdef _WIN32
+#include "Libs/VQUtils/Source/Log.h" // the engine modules log through VQUtils
+#endif
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+struct FTestCase
+{
+	const char*    pName;
+	Test::TestFn_t pfnRun;
+	bool           bBenchmark;
+};
+
+static std::vector<FTestCase>& GetTestCases()
+{
+	static std::vector<FTestCase> TestCases; // function static: registrars run during static initialization
+	return TestCases;
+}
+
+static const char* spRunningTest = nullptr;
+static int         sNumFailedChecks = 0;
+
+namespace Test
+{
+	FRegistrar::FRegistrar(const char* pName, TestFn_t pfnRun, bool bBenchmark)
+	{
+		GetTestCases().push_back({ pName, pfnRun, bBenchmark });
+	}
+
+	void Check(bool bCondition, const char* pCondition, const char* pFile, int Line)
+	{
+		if (bCondition)
+			return;
+		++sNumFailedChecks;
+		fprintf(stderr, "%s:%d: %s: check failed: %s\n", pFile, Line, spRunningTest, pCondition);
+	}
+
+	void Report(const char* pFormat, ...)
+	{
+		printf("  %s: ", spRunningTest);
+		va_list Args;
+		va_start(Args, pFormat);
+		vprintf(pFormat, Args);
+		va_end(Args);
+		printf("\n");
+	}
+
+	std::string GetTempFilePath(const std::string& FileName)
+	{
+		std::error_code ec;
+		const std::filesystem::path TempDirectory = std::filesystem::temp_directory_path(ec);
+		return ec ? FileName : (TempDirectory / ("VQETests_" + FileName)).string();
+	}
+}
+
+static bool IsSelected(const FTestCase& TestCase, const std::vector<const char*>& NamePrefixes, bool bBenchmarks)
+{
+	if (TestCase.bBenchmark != bBenchmarks)
+		return false;
+	if (NamePrefixes.empty())
+		return true;
+	for (const char* pPrefix : NamePrefixes)
+		if (strncmp(TestCase.pName, pPrefix, strlen(pPrefix)) == 0)
+			return true;
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	bool bList = false;
+	bool bBenchmarks = false;
+	std::vector<const char*> NamePrefixes;
+	for (int i = 1; i < argc; ++i)
+	{
+		if      (strcmp(argv[i], "--list") == 0)       bList = true;
+		else if (strcmp(argv[i], "--benchmarks") == 0) bBenchmarks = true;
+		else                                           NamePrefixes.push_back(argv[i]);
+	}
+
+	if (bList)
+	{
+		for (const FTestCase& TestCase : GetTestCases())
+			printf("%s%s\n", TestCase.pName, TestCase.bBenchmark ? " (benchmark)" : "");
+		return 0;
+	}
+
+#ifdef _WIN32
+	Log::LogInitializeParams LogParams;
+	LogParams.bLogConsole = true;
+	Log::Initialize(LogParams);
+#endif
+
+	int NumRun = 0;
+	int NumFailed = 0;
+	for (const FTestCase& TestCase : GetTestCases())
+	{
+		if (!IsSelected(TestCase, NamePrefixes, bBenchmarks))
+			continue;
+
+		printf("[ RUN    ] %s\n", TestCase.pName);
+		fflush(stdout);
+		spRunningTest = TestCase.pName;
+		sNumFailedChecks = 0;
+		TestCase.pfnRun();
+		++NumRun;
+		NumFailed += sNumFailedChecks > 0 ? 1 : 0;
+		printf("[ %s ] %s\n", sNumFailedChecks > 0 ? "FAILED" : "    OK", TestCase.pName);
+		fflush(stdout);
+	}
+	spRunningTest = nullptr;
+
+#ifdef _WIN32
+	Log::Destroy();
+#endif
+
+	printf("%d %s run, %d failed\n", NumRun, bBenchmarks ? "benchmarks" : "tests", NumFailed);
+	if (NumRun == 0)
+	{
+		fprintf(stderr, "no %s matched\n", bBenchmarks ? "benchmarks" : "tests");
+		return 1;
+	}
+	return NumFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#pragma once
+
+#include <string>
+
+//
+// TEST
+//
+// Test registry of the VQETests executable (Tests/CMakeLists.txt) for the engine modules that run without a device.
+// - VQE_TEST(Module_Case) defines & registers a test, VQE_BENCHMARK(Module_Case) a benchmark. Benchmarks only run
+//   w/ --benchmarks: they report their timings and fail when their acceptance checks fail.
+// - TEST_CHECK(condition) records a failure w/ the file & line and continues, a test passes if none of its checks fail.
+// - VQETests [--list] [--benchmarks] [<name prefix>...] runs the tests (or benchmarks) whose name starts w/ a prefix.
+//
+namespace Test
+{
+	using TestFn_t = void(*)();
+	struct FRegistrar
+	{
+		FRegistrar(const char* pName, TestFn_t pfnRun, bool bBenchmark);
+	};
+
+	void        Check(bool bCondition, const char* pCondition, const char* pFile, int Line);
+	void        Report(const char* pFormat, ...); // printed w/ the name of the running test
+	std::string GetTempFilePath(const std::string& FileName);
+}
+
+#define VQE_TEST(Name)      static void Name(); static const Test::FRegistrar sTestRegistrar_##Name(#Name, &Name, false); static void Name()
+#define VQE_BENCHMARK(Name) static void Name(); static const Test::FRegistrar sTestRegistrar_##Name(#Name, &Name, true); static void Name()
+#define TEST_CHECK(Condition) Test::Check((Condition), #Condition, __FILE__, __LINE__)
@@ -0,0 +1,250 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+#include "Test.h"
+#include "Source/Renderer/TextureResidency.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+namespace
+{
+	struct FResidencyReplayResult
+	{
+		std::vector<uint64> Changes;           // frame | ID | mip
+		double UsedFullyResidentRatio = 0.0;   // of the used textures after each Update()
+		double AverageResidentMB      = 0.0;
+		TextureResidencyManager::FStatistics Stats;
+		bool   bBudgetsRespected      = true;
+		bool   bAccountingValid       = true;
+		bool   bLRUOrderRespected     = true;
+	};
+
+	// textures of rooms visited back & forth + shared textures used in every frame
+	FTextureVisibilityTrace GenerateSyntheticVisibilityTrace()
+	{
+		constexpr uint32 NUM_ROOMS             = 30;
+		constexpr uint32 NUM_TEXTURES_PER_ROOM = 20;
+		constexpr uint32 NUM_SHARED_TEXTURES   = 40;
+		constexpr uint32 NUM_FRAMES_PER_ROOM   = 50;
+		constexpr uint32 NUM_TRANSITION_FRAMES = 10; // the next room's textures are visible too
+		constexpr uint32 NUM_FRAMES            = 2 * NUM_ROOMS * NUM_FRAMES_PER_ROOM;
+
+		FTextureVisibilityTrace Trace;
+		std::mt19937 rng(1234);
+		const uint32 NumTextures = NUM_ROOMS * NUM_TEXTURES_PER_ROOM + NUM_SHARED_TEXTURES;
+		for (uint32 i = 0; i < NumTextures; ++i)
+		{
+			const uint32 Log2Size = std::uniform_int_distribution<uint32>(8, 12)(rng); // 256 - 4096
+			FTextureVisibilityTrace::FTexture t;
+			t.ID            = static_cast<TextureID>(i);
+			t.Width         = 1u << Log2Size;
+			t.Height        = 1u << Log2Size;
+			t.NumMips       = Log2Size + 1;
+			t.BytesPerPixel = 4;
+			Trace.Textures.push_back(t);
+		}
+
+		std::vector<TextureID> FrameTextures;
+		auto fnAddRoom = [&](uint32 iRoom)
+		{
+			for (uint32 i = 0; i < NUM_TEXTURES_PER_ROOM; ++i)
+				FrameTextures.push_back(static_cast<TextureID>(NUM_SHARED_TEXTURES + iRoom * NUM_TEXTURES_PER_ROOM + i));
+		};
+		for (uint32 Frame = 0; Frame < NUM_FRAMES; ++Frame)
+		{
+			// ping-pong through the rooms
+			const uint32 iStep = Frame / NUM_FRAMES_PER_ROOM;
+			const bool   bForward = iStep < NUM_ROOMS;
+			const uint32 iRoom = bForward ? iStep : 2 * NUM_ROOMS - 1 - iStep;
+
+			FrameTextures.clear();
+			for (uint32 i = 0; i < NUM_SHARED_TEXTURES; ++i)
+				FrameTextures.push_back(static_cast<TextureID>(i));
+			fnAddRoom(iRoom);
+			if (Frame % NUM_FRAMES_PER_ROOM >= NUM_FRAMES_PER_ROOM - NUM_TRANSITION_FRAMES)
+			{
+				if (bForward && iRoom + 1 < NUM_ROOMS) fnAddRoom(iRoom + 1);
+				if (!bForward && iRoom > 0)            fnAddRoom(iRoom - 1);
+			}
+			Trace.AddFrame(FrameTextures);
+		}
+		return Trace;
+	}
+
+	uint64 CalculateFullyResidentBytes(const FTextureVisibilityTrace& Trace)
+	{
+		uint64 Bytes = 0;
+		for (const FTextureVisibilityTrace::FTexture& t : Trace.Textures)
+			for (uint32 Mip = 0; Mip < t.NumMips; ++Mip)
+				Bytes += TextureResidencyManager::CalculateMipSize(t.Width, t.Height, t.BytesPerPixel, Mip);
+		return Bytes;
+	}
+
+	FResidencyReplayResult ReplayVisibilityTrace(const FTextureVisibilityTrace& Trace, const TextureResidencyManager::FBudget& Budget)
+	{
+		FResidencyReplayResult Result;
+		TextureResidencyManager Manager;
+		Manager.Initialize(Budget);
+
+		std::unordered_map<TextureID, uint32> PrevMips;
+		uint64 MinResidentBytes = 0; // the budget can't go lower than the mip tails
+		for (const FTextureVisibilityTrace::FTexture& t : Trace.Textures)
+		{
+			Manager.Register(t.ID, t.Width, t.Height, t.NumMips, t.BytesPerPixel);
+			PrevMips[t.ID] = 0;
+			const uint32 NumTailMips = std::min(t.NumMips, std::max(Budget.MinResidentMips, 1u));
+			for (uint32 Mip = t.NumMips - NumTailMips; Mip < t.NumMips; ++Mip)
+				MinResidentBytes += TextureResidencyManager::CalculateMipSize(t.Width, t.Height, t.BytesPerPixel, Mip);
+		}
+
+		uint64 NumUsed = 0, NumUsedFullyResident = 0;
+		double SumResidentMB = 0.0;
+		std::unordered_map<TextureID, bool> UsedThisFrame;
+		for (uint32 iFrame = 0; iFrame < Trace.GetNumFrames(); ++iFrame)
+		{
+			const uint64 Frame = iFrame + 1; // 0: never used
+			UsedThisFrame.clear();
+			for (uint32 i = Trace.FrameOffsets[iFrame]; i < Trace.FrameOffsets[iFrame + 1]; ++i)
+			{
+				Manager.MarkUsed(Trace.UsedTextures[i], Frame);
+				UsedThisFrame[Trace.UsedTextures[i]] = true;
+			}
+
+			for (const TextureResidencyManager::FResidencyChange& c : Manager.Update(Frame))
+				Result.Changes.push_back((Frame << 32) | (static_cast<uint64>(c.ID & 0xFFFFFF) << 8) | c.MostDetailedMip);
+
+			const TextureResidencyManager::FStatistics s = Manager.GetStatistics();
+			Result.bBudgetsRespected = Result.bBudgetsRespected
+				&& (s.ResidentBytes <= Budget.MaxResidentBytes || s.ResidentBytes == MinResidentBytes)
+				&& (s.NumRestoredMips <= 1 || s.RestoredBytes <= Budget.MaxRestoreBytesPerFrame);
+
+			// recompute the resident bytes, check the LRU order: a used texture loses mips only if no unused one can
+			uint64 ResidentBytes = 0;
+			bool bEvictedUsedTexture = false, bUnusedTextureEvictable = false;
+			for (const FTextureVisibilityTrace::FTexture& t : Trace.Textures)
+			{
+				const uint32 Mip = Manager.GetMostDetailedResidentMip(t.ID);
+				for (uint32 m = Mip; m < t.NumMips; ++m)
+					ResidentBytes += TextureResidencyManager::CalculateMipSize(t.Width, t.Height, t.BytesPerPixel, m);
+
+				const bool bUsed = UsedThisFrame.find(t.ID) != UsedThisFrame.end();
+				bEvictedUsedTexture     = bEvictedUsedTexture     || (bUsed && Mip > PrevMips[t.ID]);
+				bUnusedTextureEvictable = bUnusedTextureEvictable || (!bUsed && Mip + std::max(Budget.MinResidentMips, 1u) < t.NumMips);
+				PrevMips[t.ID] = Mip;
+
+				NumUsed              += bUsed ? 1 : 0;
+				NumUsedFullyResident += bUsed && Mip == 0 ? 1 : 0;
+			}
+			Result.bAccountingValid   = Result.bAccountingValid && ResidentBytes == s.ResidentBytes;
+			Result.bLRUOrderRespected = Result.bLRUOrderRespected && !(bEvictedUsedTexture && bUnusedTextureEvictable);
+			SumResidentMB += static_cast<double>(s.ResidentBytes) / (1 << 20);
+		}
+
+		Result.UsedFullyResidentRatio = NumUsed > 0 ? static_cast<double>(NumUsedFullyResident) / NumUsed : 1.0;
+		Result.AverageResidentMB      = Trace.GetNumFrames() > 0 ? SumResidentMB / Trace.GetNumFrames() : 0.0;
+		Result.Stats                  = Manager.GetStatistics();
+		return Result;
+	}
+}
+
+VQE_TEST(TextureResidency_SyntheticTraceReplay)
+{
+	constexpr double BUDGET_RATIO = 0.4;
+
+	const FTextureVisibilityTrace Trace = GenerateSyntheticVisibilityTrace();
+	const uint64 FullyResidentBytes = CalculateFullyResidentBytes(Trace);
+
+	TextureResidencyManager::FBudget Budget;
+	Budget.MaxResidentBytes = static_cast<uint64>(FullyResidentBytes * BUDGET_RATIO);
+
+	const FResidencyReplayResult Result    = ReplayVisibilityTrace(Trace, Budget);
+	const FResidencyReplayResult Repeated  = ReplayVisibilityTrace(Trace, Budget);
+	const FResidencyReplayResult Unlimited = ReplayVisibilityTrace(Trace, TextureResidencyManager::FBudget());
+
+	const TextureResidencyManager::FStatistics& s = Result.Stats;
+	Test::Report("%u textures, %u frames", static_cast<uint32>(Trace.Textures.size()), Trace.GetNumFrames());
+	Test::Report("budget         : %8.2f MB of %.2f MB fully resident", Budget.MaxResidentBytes / (1024.0 * 1024.0), FullyResidentBytes / (1024.0 * 1024.0));
+	Test::Report("avg resident   : %8.2f MB", Result.AverageResidentMB);
+	Test::Report("used textures  : %8.2f%% at full resolution", Result.UsedFullyResidentRatio * 100.0);
+	Test::Report("evicted mips   : %8llu", s.NumTotalEvictedMips);
+	Test::Report("restored mips  : %8llu, thrash rate %.2f%%", s.NumTotalRestoredMips, s.ThrashRate * 100.0f);
+
+	TEST_CHECK(Result.bBudgetsRespected);
+	TEST_CHECK(Result.bAccountingValid);
+	TEST_CHECK(Result.bLRUOrderRespected);
+	TEST_CHECK(s.NumTotalEvictedMips > 0 && s.NumTotalRestoredMips > 0);
+	TEST_CHECK(Unlimited.bAccountingValid);
+	TEST_CHECK(Unlimited.Stats.NumTotalEvictedMips == 0);
+	TEST_CHECK(Result.Changes == Repeated.Changes);
+}
+
+VQE_TEST(TextureResidency_MinResidentMips)
+{
+	TextureResidencyManager::FBudget Budget;
+	Budget.MaxResidentBytes = 0; // evict everything that can be evicted
+	Budget.MinResidentMips  = 3;
+
+	TextureResidencyManager Manager;
+	Manager.Initialize(Budget);
+	Manager.Register(0, 1024, 1024, 11, 4);
+	Manager.Register(1, 4, 4, 3, 4);
+	Manager.Register(2, 1, 1, 1, 4);
+
+	Manager.Update(1);
+	TEST_CHECK(Manager.GetMostDetailedResidentMip(0) == 8);
+	TEST_CHECK(Manager.GetMostDetailedResidentMip(1) == 0);
+	TEST_CHECK(Manager.GetMostDetailedResidentMip(2) == 0);
+
+	// a used texture is only restored if the budget can be held
+	Manager.MarkUsed(0, 2);
+	TEST_CHECK(Manager.Update(2).empty());
+
+	Budget.MaxResidentBytes = ~0ull;
+	Manager.SetBudget(Budget);
+	Manager.MarkUsed(0, 3);
+	const std::vector<TextureResidencyManager::FResidencyChange> Changes = Manager.Update(3);
+	TEST_CHECK(Changes.size() == 1 && Changes[0].ID == 0 && Changes[0].MostDetailedMip < 8);
+	TEST_CHECK(Manager.GetStatistics().NumTotalThrashedMips > 0);
+}
+
+VQE_TEST(TextureResidency_TraceFileRoundTrip)
+{
+	const FTextureVisibilityTrace Trace = GenerateSyntheticVisibilityTrace();
+	const std::string FilePath = Test::GetTempFilePath("TextureResidency_TraceFileRoundTrip.vqtt");
+	TEST_CHECK(Trace.Save(FilePath));
+
+	FTextureVisibilityTrace Loaded;
+	TEST_CHECK(Loaded.Load(FilePath));
+	TEST_CHECK(Loaded.GetNumFrames() == Trace.GetNumFrames());
+	TEST_CHECK(Loaded.FrameOffsets == Trace.FrameOffsets);
+	TEST_CHECK(Loaded.UsedTextures == Trace.UsedTextures);
+	TEST_CHECK(Loaded.Textures.size() == Trace.Textures.size());
+	TEST_CHECK(std::equal(Loaded.Textures.begin(), Loaded.Textures.end(), Trace.Textures.begin(), [](const FTextureVisibilityTrace::FTexture& l, const FTextureVisibilityTrace::FTexture& r)
+	{
+		return l.ID == r.ID && l.Width == r.Width && l.Height == r.Height && l.NumMips == r.NumMips && l.BytesPerPixel == r.BytesPerPixel;
+	}));
+
+	// the replay of the loaded trace makes the same decisions
+	TextureResidencyManager::FBudget Budget;
+	Budget.MaxResidentBytes = CalculateFullyResidentBytes(Trace) / 2;
+	TEST_CHECK(ReplayVisibilityTrace(Loaded, Budget).Changes == ReplayVisibilityTrace(Trace, Budget).Changes);
+
+	TEST_CHECK(!Loaded.Load(Test::GetTempFilePath("TextureResidency_Missing.vqtt")));
+}
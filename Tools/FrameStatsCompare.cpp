@@ -0,0 +1,89 @@
+//	VQE
+//	Copyright(C) 2020  - Volkan Ilbeyli
+//
+//	This program is free software : you can redistribute it and / or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation, either version 3 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program.If not, see <http://www.gnu.org/licenses/>.
+//
+//	Contact: volkanilbeyli@gmail.com
+
+//
+// FRAME STATS COMPARE
+//
+// Regression gate on two frame timing CSVs, e.g. a baseline & a candidate run of the camera benchmark or the
+// F9 frame statistics dumps. Compares the *Ms columns w/ FrameStatistics::CompareRuns().
+//
+// Usage  : VQEFrameStatsCompare <baseline.csv> <candidate.csv> [--threshold=<percent>] [--min-ms=<ms>] [--p=<significance>]
+// Returns: 0 if no stage regressed, 1 on a regression, 2 if the runs couldn't be compared
+//
+#include "Source/Engine/FrameStatistics.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void PrintUsage()
+{
+	fprintf(stderr, "usage: VQEFrameStatsCompare <baseline.csv> <candidate.csv> [--threshold=<percent>] [--min-ms=<ms>] [--p=<significance>]\n");
+}
+
+static bool ParseFloatOption(const char* pArg, const char* pOption, float& OutValue)
+{
+	const size_t OptionLength = strlen(pOption);
+	if (strncmp(pArg, pOption, OptionLength) != 0)
+		return false;
+	char* pEnd = nullptr;
+	const float Value = strtof(pArg + OptionLength, &pEnd);
+	if (pEnd == pArg + OptionLength || *pEnd != '\0' || Value < 0.0f)
+	{
+		fprintf(stderr, "invalid value: %s\n", pArg);
+		exit(2);
+	}
+	OutValue = Value;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	FrameStatistics::FRegressionTestParameters Params;
+	const char* pFiles[2] = {};
+	int NumFiles = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* pArg = argv[i];
+		if (ParseFloatOption(pArg, "--threshold=", Params.MaxRegressionPercent)
+		 || ParseFloatOption(pArg, "--min-ms="   , Params.MinRegressionMs)
+		 || ParseFloatOption(pArg, "--p="        , Params.SignificanceLevel))
+			continue;
+		if (pArg[0] == '-' || NumFiles == 2)
+		{
+			PrintUsage();
+			return 2;
+		}
+		pFiles[NumFiles++] = pArg;
+	}
+	if (NumFiles != 2)
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	FrameStatistics::FRunComparison Comparison;
+	const bool bPassed = FrameStatistics::CompareRuns(pFiles[0], pFiles[1], Params, Comparison);
+	if (!Comparison.Error.empty())
+	{
+		fprintf(stderr, "%s\n", Comparison.Error.c_str());
+		return 2;
+	}
+	printf("%s", FrameStatistics::FormatComparison(Comparison, Params).c_str());
+	return bPassed ? 0 : 1;
+}